@@ -32,7 +32,13 @@
 // ==================== CORE SYSTEM INCLUDES ====================
 #include <Arduino.h>
 #include <WiFi.h>
+#include "include/ESP32_S3_Config.h"   // FEATURE_ASYNC_WEBSERVER selects the HTTP server
+#if FEATURE_ASYNC_WEBSERVER
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#else
 #include <WebServer.h>
+#endif
 #include <WebSocketsServer.h>
 #include <ArduinoJson.h>
 #include <Preferences.h>
@@ -70,6 +76,24 @@
 #include "include/SystemStateManager.h"
 #include "include/Triangulator.h"
 #include "include/RSSISmoother.h"
+#include "include/TelemetryCodec.h"
+#include "include/TelemetryDelta.h"
+#include "include/MqttOutbox.h"
+#include "include/OutboxFlashStorage.h"
+#include "include/CollarSettings.h"
+#include "include/MqttStreamWriter.h"
+#include "include/WsFanout.h"
+#include "include/WsStreams.h"
+#include "include/CommandRegistry.h"
+#include "include/HttpSnapshotCache.h"
+#include "include/WebAssets.h"
+#include "include/WiFiRoamer.h"
+#include "include/LoopProfiler.h"
+#include "include/HeapProfiler.h"
+#include "include/TraceBuffer.h"
+#include "include/DeferredLog.h"
+#include "include/StatusView.h"
+#include "include/DisplayFlusher.h"
 #include "missing_definitions.h"
 
 // ==================== FIRMWARE CONFIGURATION ====================
@@ -87,6 +111,7 @@
 #define DEVICE_ID "001"                          // Unique collar ID
 #define MQTT_TELEMETRY_INTERVAL 30000           // 30 seconds
 #define MQTT_HEARTBEAT_INTERVAL 60000           // 1 minute
+#define MQTT_BUFFER_SIZE 512                    // Incoming commands and publish headers (payloads are streamed)
 
 // Display configuration
 #define SCREEN_WIDTH 128
@@ -104,9 +129,23 @@ SystemStateManager systemStateManager;
 Triangulator triangulator;
 
 // Hardware interfaces
+#if FEATURE_ASYNC_WEBSERVER
+AsyncWebServer server(80);
+#else
 WebServer server(80);
+#endif
+HttpSnapshotCache httpCache;      // Prebuilt /api/status and /api/discover bodies
+volatile bool httpBroadcastRequested = false;  // /api/data from the AsyncTCP task
 WebSocketsServer webSocket(8080);
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET_PIN);
+WsFanout wsFanout;    // Shared broadcast frames and per-client send queues
+WsStreamHub wsStreams(wsFanout);  // Subscribed live beacon/position feeds
+CommandRegistry commandRegistry;  // Commands shared by WebSocket, MQTT and serial
+LoopProfiler loopProfiler;        // Cycle-counter timing of loop() stages (perf command)
+
+static_assert(WS_FANOUT_MAX_CLIENTS >= WEBSOCKETS_SERVER_CLIENT_MAX,
+              "WsFanout needs a queue for every WebSocket client slot");
+// Same bus clock during and after its transfers, so the display flush task also runs at I2C_FREQUENCY
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET_PIN, I2C_FREQUENCY, I2C_FREQUENCY);
 Preferences preferences;
 BLEScan* pBLEScan = nullptr;
 
@@ -1111,12 +1150,68 @@ struct MQTTState {
     bool enabled = ENABLE_MQTT_CLOUD;
     unsigned long lastTelemetry = 0;
     unsigned long lastHeartbeat = 0;
+    unsigned long lastPerfReport = 0;
+    unsigned long lastHeapReport = 0;
     unsigned long lastReconnect = 0;
     int reconnectAttempts = 0;
     int messagesPublished = 0;
     int connectionFailures = 0;
 } mqttState;
 
+// Payload encoding (JSON by default, CBOR opt-in per device)
+TelemetryFormat telemetryFormat = TelemetryFormat::JSON;
+static uint8_t telemetryBuffer[TELEMETRY_BUFFER_SIZE];
+CborWriter telemetryWriter(telemetryBuffer, sizeof(telemetryBuffer));
+TelemetryDeltaEncoder telemetryDelta;
+
+// Store-and-forward outbox for messages raised while MQTT is unreachable
+PartitionOutboxStorage outboxFlash;
+RamOutboxStorage* outboxPsram = nullptr;
+MqttOutbox mqttOutbox;
+unsigned long lastOfflineTelemetry = 0;
+
+// Settings kept across reboots (proximity configs, filters, telemetry, WiFi)
+PartitionOutboxStorage settingsFlash;
+CollarSettingsStore collarSettings;
+
+enum class DeliveryResult : uint8_t {
+    SENT,                   ///< Published to the broker
+    QUEUED,                 ///< Stored in the outbox for later replay
+    FAILED                  ///< Neither (outbox unavailable or refused it)
+};
+
+// MQTT topics, formatted once by initializeMqttTopics() as pet-collar/<id>/<suffix>
+enum MqttTopicId : uint8_t {
+    TOPIC_STATUS,
+    TOPIC_TELEMETRY,
+    TOPIC_ZONES,
+    TOPIC_LOCATION,
+    TOPIC_BEACON_DETECTION,
+    TOPIC_ALERT,
+    TOPIC_EVENT,
+    TOPIC_PROXIMITY_CONFIG,
+    TOPIC_DIAGNOSTICS,
+    TOPIC_HEAP,
+    TOPIC_TRACE,
+    TOPIC_COMMAND,
+    TOPIC_COMMAND_ANY,
+    TOPIC_COUNT
+};
+
+struct MqttTopic {
+    const char* suffix;     ///< Also the topic stored with outbox records
+    char path[48];
+};
+
+MqttTopic mqttTopics[TOPIC_COUNT] = {
+    {"status"}, {"telemetry"}, {"zones"}, {"location"}, {"beacon-detection"},
+    {"alert"}, {"event"}, {"proximity-config"}, {"diagnostics"}, {"diagnostics/heap"}, {"diagnostics/trace"},
+    {"command"}, {"command/+"}
+};
+
+// Serialized payload for the outbox when a message cannot be streamed
+static uint8_t outboxScratch[OUTBOX_MAX_PAYLOAD];
+
 // Network discovery
 WiFiUDP udp;
 const int DISCOVERY_PORT = 47808;
@@ -1143,9 +1238,20 @@ SimpleWiFiCredentials wifiNetworks[] = {
 };
 const int numNetworks = sizeof(wifiNetworks) / sizeof(wifiNetworks[0]);
 int currentNetworkIndex = -1;
+WiFiRoamer wifiRoamer;  // Access points of wifiNetworks, ranked by RSSI
 
 // ==================== MQTT CLOUD FUNCTIONS ====================
 
+/**
+ * @brief Format every MQTT topic once so publishing never builds strings
+ */
+void initializeMqttTopics() {
+    for (int i = 0; i < TOPIC_COUNT; i++) {
+        snprintf(mqttTopics[i].path, sizeof(mqttTopics[i].path), "pet-collar/%s/%s",
+                 DEVICE_ID, mqttTopics[i].suffix);
+    }
+}
+
 /**
  * @brief Initialize MQTT cloud connection
  */
@@ -1155,6 +1261,8 @@ void initializeMQTTCloud() {
         return;
     }
     
+    initializeMqttTopics();
+    
     Serial.println("🌐 Initializing MQTT Cloud connection...");
     
     // Configure TLS (for production, add proper certificates)
@@ -1165,8 +1273,365 @@ void initializeMQTTCloud() {
     mqttClient.setCallback(onMqttMessage);
     mqttClient.setKeepAlive(60);
     mqttClient.setSocketTimeout(15);
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
     
     Serial.printf("📡 MQTT Server: %s:%d\n", MQTT_SERVER, MQTT_PORT);
+    Serial.printf("📦 Telemetry format: %s\n", telemetryFormatToString(telemetryFormat));
+}
+
+/**
+ * @brief Select and persist the MQTT payload encoding for this device
+ * @param format JSON or CBOR
+ */
+void setTelemetryFormat(TelemetryFormat format) {
+    telemetryFormat = format;
+    telemetryDelta.requestKeyframe();
+    collarSettings.edit(millis()).telemetryFormat = (uint8_t)format;
+    Serial.printf("📦 Telemetry format set to %s\n", telemetryFormatToString(format));
+}
+
+/**
+ * @brief Publish a payload written straight to the socket (no PubSubClient buffer copy)
+ * @param topic MQTT topic
+ * @param retained Retain flag
+ * @return true if the whole payload was sent
+ */
+bool publishStream(const char* topic, const uint8_t* payload, size_t length, bool retained = false) {
+    if (!mqttClient.beginPublish(topic, length, retained)) {
+        return false;
+    }
+    size_t written = mqttClient.write(payload, length);
+    bool sent = mqttClient.endPublish() && written == length;
+    if (sent) {
+        mqttState.messagesPublished++;
+    }
+    TRACE(MQTT_PUBLISH, length, sent);
+    return sent;
+}
+
+/**
+ * @brief Serialize a JSON document directly into an MQTT publish
+ * @param topic MQTT topic
+ * @param doc Document to send
+ * @param retained Retain flag
+ * @return true if the whole payload was sent
+ */
+bool publishJson(const char* topic, const JsonDocument& doc, bool retained = false) {
+    size_t length = measureJson(doc);
+    if (!mqttClient.beginPublish(topic, length, retained)) {
+        return false;
+    }
+    
+    MqttStreamWriter writer(mqttClient);
+    serializeJson(doc, writer);
+    writer.flush();
+    
+    bool sent = mqttClient.endPublish() && !writer.hasFailed() && writer.getWritten() == length;
+    if (sent) {
+        mqttState.messagesPublished++;
+    }
+    TRACE(MQTT_PUBLISH, length, sent);
+    return sent;
+}
+
+/**
+ * @brief Publish the CBOR payload currently held in telemetryWriter
+ * @param topic MQTT topic
+ * @param length Encoded length (0 = encoding overflowed)
+ * @return true if published
+ */
+bool publishBinaryPayload(const char* topic, size_t length) {
+    if (length == 0) {
+        Serial.printf("❌ CBOR payload exceeds %d byte buffer\n", TELEMETRY_BUFFER_SIZE);
+        return false;
+    }
+    return publishStream(topic, telemetryWriter.data(), length);
+}
+
+/**
+ * @brief Publish a replayed outbox record (MqttOutbox publisher hook)
+ *
+ * Replays go to the record's original topic. The outbox sequence number is
+ * spliced in as the payload's first field ("outbox_seq" in JSON,
+ * TF_OUTBOX_SEQ in CBOR) so subscribers can drop the duplicate a reset
+ * between publish and retirement can cause.
+ */
+bool publishOutboxRecord(const char* suffix, uint32_t sequence, const uint8_t* payload,
+                         size_t length, void* context) {
+    const char* topic = nullptr;
+    for (int i = 0; i < TOPIC_COUNT && !topic; i++) {
+        if (strcmp(mqttTopics[i].suffix, suffix) == 0) {
+            topic = mqttTopics[i].path;
+        }
+    }
+    if (!topic) {
+        return false;
+    }
+    
+    // JSON: after the opening brace. CBOR: after the self-describe tag and map head
+    uint8_t field[24];
+    size_t fieldLength = 0;
+    size_t split = 0;
+    if (length >= 2 && payload[0] == '{') {
+        split = 1;
+        fieldLength = snprintf((char*)field, sizeof(field), "\"outbox_seq\":%lu%s",
+                               (unsigned long)sequence, payload[1] == '}' ? "" : ",");
+    } else if (length >= 4 && payload[0] == 0xD9 && payload[1] == 0xD9 && payload[2] == 0xF7) {
+        CborWriter writer(field, sizeof(field));
+        writer.field(TF_OUTBOX_SEQ, sequence);
+        split = 4;
+        fieldLength = writer.length();
+    }
+    
+    if (!mqttClient.beginPublish(topic, length + fieldLength, false)) {
+        return false;
+    }
+    size_t written = mqttClient.write(payload, split);
+    written += mqttClient.write(field, fieldLength);
+    written += mqttClient.write(payload + split, length - split);
+    bool sent = mqttClient.endPublish() && written == length + fieldLength;
+    if (sent) {
+        mqttState.messagesPublished++;
+    }
+    TRACE(MQTT_PUBLISH, length + fieldLength, sent);
+    return sent;
+}
+
+/**
+ * @brief Open the outbox on the flash partition (PSRAM if the partition is missing)
+ */
+void initializeOutbox() {
+    OutboxStorage* storage = nullptr;
+    const char* location = nullptr;
+    
+    if (outboxFlash.begin(OUTBOX_PARTITION_LABEL, OUTBOX_FLASH_BYTES)) {
+        storage = &outboxFlash;
+        location = "flash";
+    } else if (psramFound()) {
+        uint8_t* buffer = (uint8_t*)ps_malloc(OUTBOX_PSRAM_BYTES);
+        if (buffer) {
+            memset(buffer, 0xFF, OUTBOX_PSRAM_BYTES);
+            outboxPsram = new RamOutboxStorage(buffer, OUTBOX_PSRAM_BYTES, 4096);
+            storage = outboxPsram;
+            location = "PSRAM";
+        }
+    }
+    
+    if (!storage || !mqttOutbox.begin(storage)) {
+        Serial.println("⚠️ MQTT outbox unavailable - offline messages will be dropped");
+        return;
+    }
+    
+    mqttOutbox.setPublisher(publishOutboxRecord, nullptr);
+    Serial.printf("📥 MQTT outbox: %u KB in %s, %lu pending, next #%lu\n",
+                 (unsigned)(storage->size() / 1024), location,
+                 (unsigned long)mqttOutbox.getPendingCount(),
+                 (unsigned long)mqttOutbox.getNextSequence());
+}
+
+/**
+ * @brief Carry over what older firmware kept in Preferences
+ * @return true if anything was found
+ */
+bool migrateLegacyPreferences() {
+    CollarSettings& settings = collarSettings.edit(millis());
+    bool found = false;
+    
+    if (preferences.begin("wifi_creds", true)) {
+        if (preferences.isKey("ssid")) {
+            preferences.getString("ssid", settings.wifiSsid, sizeof(settings.wifiSsid));
+            preferences.getString("password", settings.wifiPassword, sizeof(settings.wifiPassword));
+            found = true;
+        }
+        WiFiFastRecord record;
+        if (preferences.isKey("fast") &&
+            preferences.getBytes("fast", &record, sizeof(record)) == sizeof(record)) {
+            settings.wifiFast = record;
+            found = true;
+        }
+        preferences.end();
+    }
+    
+    if (preferences.begin("petcollar", true)) {
+        if (preferences.isKey("telem_fmt")) {
+            settings.telemetryFormat = preferences.getUChar("telem_fmt", 0);
+            found = true;
+        }
+        preferences.end();
+    }
+    return found;
+}
+
+/**
+ * @brief Drop the Preferences namespaces once their contents are in the settings store
+ */
+void clearLegacyPreferences() {
+    const char* namespaces[] = {"wifi_creds", "petcollar"};
+    for (const char* name : namespaces) {
+        if (preferences.begin(name, false)) {
+            preferences.clear();
+            preferences.end();
+        }
+    }
+}
+
+/**
+ * @brief Load the settings record once at boot (migrating Preferences on first boot)
+ */
+void initializeSettings() {
+    bool flashOK = settingsFlash.begin(OUTBOX_PARTITION_LABEL, SETTINGS_FLASH_BYTES, SETTINGS_FLASH_OFFSET);
+    if (collarSettings.begin(flashOK ? &settingsFlash : nullptr)) {
+        const ConfigStoreStats& stats = collarSettings.getStats();
+        Serial.printf("⚙️ Settings: generation %lu (schema v%u), %u proximity configs\n",
+                     (unsigned long)stats.generation, collarSettings.getLoadedVersion(),
+                     collarSettings.get().proximityCount);
+        return;
+    }
+    
+    if (collarSettings.hasNewerRecord()) {
+        Serial.printf("⚠️ Settings: record is schema v%u from newer firmware - kept on flash, "
+                     "running on defaults (changes last until reboot)\n",
+                     collarSettings.getLoadedVersion());
+        return;
+    }
+    
+    // No record yet: take what Preferences held, then forget it there
+    bool migrated = migrateLegacyPreferences();
+    bool saved = collarSettings.saveNow();
+    if (migrated && saved) {
+        clearLegacyPreferences();
+    }
+    if (!flashOK) {
+        Serial.println("⚠️ Settings store unavailable - changes last until reboot");
+    }
+    Serial.printf("⚙️ Settings: %s\n", migrated ? "migrated from Preferences" : "defaults");
+}
+
+/**
+ * @brief Hand the loaded settings to the subsystems that use them
+ */
+void applySettings() {
+    const CollarSettings& settings = collarSettings.get();
+    
+    telemetryFormat = settings.telemetryFormat == (uint8_t)TelemetryFormat::CBOR ?
+                      TelemetryFormat::CBOR : TelemetryFormat::JSON;
+    TelemetryDeadbands deadbands;
+    deadbands.rssiDbm = settings.deadbandRssiDbm;
+    deadbands.heapBytes = settings.deadbandHeapBytes;
+    deadbands.positionM = settings.deadbandPositionM;
+    deadbands.confidence = settings.deadbandConfidence;
+    telemetryDelta.setDeadbands(deadbands);
+    telemetryDelta.setKeyframeInterval(settings.keyframeInterval, settings.keyframeMaxMs);
+    
+    globalRSSISmoother.setIIRAlpha(settings.iirAlpha);
+    globalRSSISmoother.setKalmanParameters(settings.kalmanQ, settings.kalmanR);
+    
+    for (uint8_t i = 0; i < settings.proximityCount; i++) {
+        const ProximitySetting& proximity = settings.proximity[i];
+        beaconManager.configureProximityBeacon(
+            proximity.beaconId,
+            proximity.beaconName,
+            proximity.macAddress,
+            proximity.alertMode,
+            proximity.triggerDistance,
+            proximity.alertDuration,
+            proximity.alertIntensity,
+            proximity.enableProximityDelay,
+            proximity.proximityDelayTime,
+            proximity.cooldownPeriod
+        );
+    }
+}
+
+/**
+ * @brief Copy the beacon manager's proximity configs into the settings record
+ */
+void saveProximitySettings() {
+    const std::vector<ProximityBeaconConfig>& configs = beaconManager.getProximityConfigs();
+    CollarSettings& settings = collarSettings.edit(millis());
+    
+    uint8_t count = 0;
+    for (const ProximityBeaconConfig& config : configs) {
+        if (count == SETTINGS_MAX_PROXIMITY) {
+            Serial.printf("⚠️ Only the first %d proximity configs survive a reboot\n", SETTINGS_MAX_PROXIMITY);
+            break;
+        }
+        ProximitySetting& proximity = settings.proximity[count++];
+        memset(&proximity, 0, sizeof(proximity));
+        strlcpy(proximity.beaconId, config.beaconId.c_str(), sizeof(proximity.beaconId));
+        strlcpy(proximity.beaconName, config.beaconName.c_str(), sizeof(proximity.beaconName));
+        strlcpy(proximity.macAddress, config.macAddress.c_str(), sizeof(proximity.macAddress));
+        strlcpy(proximity.alertMode, config.alertMode.c_str(), sizeof(proximity.alertMode));
+        proximity.triggerDistance = (uint16_t)constrain(config.triggerDistance, 0, UINT16_MAX);
+        proximity.alertIntensity = (uint8_t)constrain(config.alertIntensity, 0, UINT8_MAX);
+        proximity.enableProximityDelay = config.enableProximityDelay;
+        proximity.alertDuration = (uint32_t)max(config.alertDuration, 0);
+        proximity.proximityDelayTime = (uint32_t)max(config.proximityDelayTime, 0);
+        proximity.cooldownPeriod = (uint32_t)max(config.cooldownPeriod, 0);
+    }
+    settings.proximityCount = count;
+}
+
+/**
+ * @brief Append a message to the outbox
+ * @return QUEUED, or FAILED if the outbox refused it
+ */
+DeliveryResult queueInOutbox(OutboxKind kind, MqttTopicId topic, const uint8_t* payload, size_t length) {
+    uint32_t sequence = mqttOutbox.append(kind, mqttTopics[topic].suffix, payload, length);
+    if (sequence == 0) {
+        return DeliveryResult::FAILED;
+    }
+    LOGI("📥 Outbox #%lu: %s (%lu pending)", (unsigned long)sequence,
+         outboxKindToString(kind), (unsigned long)mqttOutbox.getPendingCount());
+    return DeliveryResult::QUEUED;
+}
+
+/**
+ * @brief Publish now, or keep the message in the outbox until MQTT is back
+ * @param kind Outbox record kind
+ * @param topic Destination topic
+ * @return How the message was handled
+ */
+DeliveryResult publishDurable(OutboxKind kind, MqttTopicId topic, const uint8_t* payload, size_t length) {
+    // Publish directly only when nothing older is waiting, to keep ordering
+    if (mqttState.connected && mqttOutbox.isEmpty() &&
+        publishStream(mqttTopics[topic].path, payload, length)) {
+        return DeliveryResult::SENT;
+    }
+    return queueInOutbox(kind, topic, payload, length);
+}
+
+/**
+ * @brief publishDurable() for a JSON document, serialized only if it has to be stored
+ */
+DeliveryResult publishDurableJson(OutboxKind kind, MqttTopicId topic, const JsonDocument& doc) {
+    if (mqttState.connected && mqttOutbox.isEmpty() && publishJson(mqttTopics[topic].path, doc)) {
+        return DeliveryResult::SENT;
+    }
+    
+    size_t length = measureJson(doc);
+    if (length > sizeof(outboxScratch)) {
+        return DeliveryResult::FAILED;
+    }
+    serializeJson(doc, (char*)outboxScratch, sizeof(outboxScratch));
+    return queueInOutbox(kind, topic, outboxScratch, length);
+}
+
+/**
+ * @brief Report a state transition (queued in the outbox while offline)
+ * @param event Event name
+ * @param from Previous state
+ * @param to New state
+ */
+void publishTransitionEvent(const char* event, const char* from, const char* to) {
+    StaticJsonDocument<256> doc;
+    doc["device_id"] = DEVICE_ID;
+    doc["timestamp"] = millis();
+    doc["event"] = event;
+    doc["from"] = from;
+    doc["to"] = to;
+    
+    publishDurableJson(OutboxKind::TRANSITION, TOPIC_EVENT, doc);
 }
 
 /**
@@ -1182,29 +1647,34 @@ void connectToMQTTCloud() {
     Serial.println("🔗 Attempting MQTT cloud connection...");
     
     // Generate fixed client ID (no random suffix)
-    String clientId = "PetCollar-" + String(DEVICE_ID);
+    char clientId[32];
+    snprintf(clientId, sizeof(clientId), "PetCollar-%s", DEVICE_ID);
     
     // Last Will and Testament
-    String statusTopic = "pet-collar/" + String(DEVICE_ID) + "/status";
-    String offlineMessage = "{\"device_id\":\"" + String(DEVICE_ID) + "\",\"status\":\"offline\",\"timestamp\":" + String(millis()) + "}";
+    char offlineMessage[96];
+    snprintf(offlineMessage, sizeof(offlineMessage),
+             "{\"device_id\":\"%s\",\"status\":\"offline\",\"timestamp\":%lu}",
+             DEVICE_ID, millis());
     
-    if (mqttClient.connect(clientId.c_str(), MQTT_USER, MQTT_PASSWORD,
-                          statusTopic.c_str(), 1, true, offlineMessage.c_str())) {
+    if (mqttClient.connect(clientId, MQTT_USER, MQTT_PASSWORD,
+                          mqttTopics[TOPIC_STATUS].path, 1, true, offlineMessage)) {
         Serial.println("✅ MQTT Cloud connected!");
         mqttState.connected = true;
         mqttState.reconnectAttempts = 0;
+        telemetryDelta.requestKeyframe();  // Backend state may be stale after an outage
         
         // Subscribe to command topics (both base and subtopics)
-        String commandTopic = "pet-collar/" + String(DEVICE_ID) + "/command/+";
-        String baseCommandTopic = "pet-collar/" + String(DEVICE_ID) + "/command";
-        mqttClient.subscribe(commandTopic.c_str(), 1);
-        mqttClient.subscribe(baseCommandTopic.c_str(), 1);
+        mqttClient.subscribe(mqttTopics[TOPIC_COMMAND_ANY].path, 1);
+        mqttClient.subscribe(mqttTopics[TOPIC_COMMAND].path, 1);
         
-        // Publish online status
+        // Publish online status, and the proximity config set so the
+        // dashboard only sends what changed while the collar was away
         publishMQTTStatus("online");
+        publishProximityState("report");
         
         Serial.printf("📡 Subscribed to commands for device %s\n", DEVICE_ID);
-        Serial.printf("📡 Topics: %s and %s\n", commandTopic.c_str(), baseCommandTopic.c_str());
+        Serial.printf("📡 Topics: %s and %s\n", mqttTopics[TOPIC_COMMAND_ANY].path,
+                     mqttTopics[TOPIC_COMMAND].path);
         
     } else {
         Serial.printf("❌ MQTT connection failed, rc=%d\n", mqttClient.state());
@@ -1222,353 +1692,390 @@ void connectToMQTTCloud() {
 
 /**
  * @brief Handle incoming MQTT messages
+ *
+ * The command name is the "cmd" key, or the subtopic (.../command/locate)
+ * when there is none. Handlers live in COMMAND_TABLE.
  */
 void onMqttMessage(char* topic, byte* payload, unsigned int length) {
-    String topicStr = String(topic);
-    String message = "";
-    
-    for (int i = 0; i < length; i++) {
-        message += (char)payload[i];
+    Serial.printf("📨 MQTT Command: %s = %.*s\n", topic, (int)length, (const char*)payload);
+    
+    // Handlers may publish, and publishing reuses PubSubClient's buffer that
+    // payload and topic point into, so the command is parsed from a copy
+    static char commandBuffer[MQTT_BUFFER_SIZE];
+    static char commandTopic[64];
+    if (length >= sizeof(commandBuffer)) {
+        Serial.println("❌ MQTT command too large");
+        return;
     }
+    memcpy(commandBuffer, payload, length);
+    commandBuffer[length] = '\0';
+    strlcpy(commandTopic, topic, sizeof(commandTopic));
     
-    Serial.printf("📨 MQTT Command: %s = %s\n", topic, message.c_str());
+    const char* subtopic = strstr(commandTopic, "/command/");
+    const char* fallbackName = subtopic ? subtopic + strlen("/command/") : nullptr;
     
-    // Parse JSON command
-    DynamicJsonDocument doc(1024);
-    if (deserializeJson(doc, message) != DeserializationError::Ok) {
+    CommandStatus status = commandRegistry.dispatchJson(CMD_SRC_MQTT, 0, commandBuffer, length,
+                                                        "cmd", fallbackName);
+    if (status == CommandStatus::PARSE_ERROR) {
         Serial.println("❌ Invalid JSON in MQTT command");
-        return;
-    }
-    
-    // Handle different command types
-    if (topicStr.indexOf("/command/buzz") > 0) {
-        int duration = doc["duration_ms"] | 3000;
-        String pattern = doc["pattern"] | "pulse";
-        
-        // Use existing alert system with cloud command
-        alertManager.startAlert(AlertReason::REMOTE_COMMAND, AlertMode::BUZZER);
-        Serial.printf("🔊 Cloud buzzer command: %dms, pattern: %s\n", duration, pattern.c_str());
-        
-    } else if (topicStr.endsWith("/command") || (topicStr.indexOf("/command") > 0 && doc.containsKey("cmd"))) {
-        // Handle generic command format (pet-collar/001/command)
-        String cmd = doc["cmd"] | "";
-        
-        if (cmd == "test-alert") {
-            String alertMode = doc["alertMode"] | "buzzer";
-            int durationMs = doc["durationMs"] | 1200;
-            int intensity = doc["intensity"] | 128;
-            
-            Serial.printf("🧪 Test Alert Command: mode=%s, duration=%dms, intensity=%d, pin=%d\n", 
-                         alertMode.c_str(), durationMs, intensity, BUZZER_PIN);
-            
-            // Map alert mode to AlertMode enum
-            AlertMode mode = AlertMode::BUZZER;
-            if (alertMode == "vibration") {
-                mode = AlertMode::VIBRATION;
-            } else if (alertMode == "both") {
-                mode = AlertMode::BOTH;
-            }
-            
-            // Trigger alert with test command
-            alertManager.startAlert(AlertReason::REMOTE_COMMAND, mode);
-            
-            // Also trigger buzzer directly for immediate feedback
-            if (alertMode == "buzzer" || alertMode == "both") {
-                Serial.printf("🔊 Direct buzzer test on GPIO %d\n", BUZZER_PIN);
-                pinMode(BUZZER_PIN, OUTPUT);
-                
-                // Generate tone for test duration
-                ledcAttach(BUZZER_PIN, 1000, 8);  // 1kHz frequency, 8-bit resolution
-                ledcWrite(BUZZER_PIN, intensity / 2);  // Convert 0-255 to 0-127 for 8-bit
-                delay(durationMs);
-                ledcWrite(BUZZER_PIN, 0);  // Turn off
-                ledcDetach(BUZZER_PIN);
-                
-                Serial.println("✅ Buzzer test completed");
-            }
-            
-        } else if (cmd == "configure_beacon") {
-            // 🚀 PROXIMITY-BASED BEACON CONFIGURATION
-            Serial.println("📡 Received beacon configuration from transmitter");
-            
-            if (doc.containsKey("beacon")) {
-                JsonObject beacon = doc["beacon"];
-                
-                // Extract exact transmitter settings
-                String beaconId = beacon["id"] | "";
-                String beaconName = beacon["name"] | "";
-                String macAddress = beacon["macAddress"] | "";
-                String alertMode = beacon["alertMode"] | "buzzer";
-                
-                int triggerDistance = beacon["triggerDistance"] | 5;     // cm
-                int alertDuration = beacon["alertDuration"] | 2000;     // ms
-                int alertIntensity = beacon["alertIntensity"] | 3;      // 1-5
-                bool enableProximityDelay = beacon["enableProximityDelay"] | false;
-                int proximityDelayTime = beacon["proximityDelayTime"] | 0; // ms
-                int cooldownPeriod = beacon["cooldownPeriod"] | 5000;   // ms
-                
-                // Configure the beacon manager with exact settings
-                beaconManager.configureProximityBeacon(
-                    beaconId, 
-                    beaconName, 
-                    macAddress, 
-                    alertMode, 
-                    triggerDistance, 
-                    alertDuration, 
-                    alertIntensity, 
-                    enableProximityDelay, 
-                    proximityDelayTime, 
-                    cooldownPeriod
-                );
-                
-                Serial.printf("✅ Configured beacon '%s' - Distance: %dcm, Duration: %dms, Intensity: %d\n", 
-                             beaconName.c_str(), triggerDistance, alertDuration, alertIntensity);
-                             
-                if (enableProximityDelay) {
-                    Serial.printf("   Proximity delay: %dms, Cooldown: %dms\n", proximityDelayTime, cooldownPeriod);
-                }
-            }
-            
-        } else if (cmd == "configure_beacons_batch") {
-            // 🚀 BATCH BEACON CONFIGURATION
-            Serial.println("📡 Received batch beacon configuration from transmitter");
-            
-            if (doc.containsKey("beacons") && doc["beacons"].is<JsonArray>()) {
-                JsonArray beacons = doc["beacons"];
-                int configuredCount = 0;
-                
-                beaconManager.clearProximityConfigurations(); // Clear existing configs
-                
-                for (JsonObject beacon : beacons) {
-                    String beaconId = beacon["id"] | "";
-                    String beaconName = beacon["name"] | "";
-                    String macAddress = beacon["macAddress"] | "";
-                    String alertMode = beacon["alertMode"] | "buzzer";
-                    
-                    int triggerDistance = beacon["triggerDistance"] | 5;
-                    int alertDuration = beacon["alertDuration"] | 2000;
-                    int alertIntensity = beacon["alertIntensity"] | 3;
-                    bool enableProximityDelay = beacon["enableProximityDelay"] | false;
-                    int proximityDelayTime = beacon["proximityDelayTime"] | 0;
-                    int cooldownPeriod = beacon["cooldownPeriod"] | 5000;
-                    
-                    beaconManager.configureProximityBeacon(
-                        beaconId, 
-                        beaconName, 
-                        macAddress, 
-                        alertMode, 
-                        triggerDistance, 
-                        alertDuration, 
-                        alertIntensity, 
-                        enableProximityDelay, 
-                        proximityDelayTime, 
-                        cooldownPeriod
-                    );
-                    
-                    configuredCount++;
-                }
-                
-                Serial.printf("✅ Configured %d proximity beacons from transmitter\n", configuredCount);
-            }
-            
-        } else if (cmd == "debug_proximity_configs") {
-            // 🐛 DEBUG: List all proximity configurations
-            Serial.println("📋 === PROXIMITY CONFIGURATIONS ===");
-            
-            // This will help debug configuration issues
-            auto configs = beaconManager.getProximityConfigs();
-            if (configs.empty()) {
-                Serial.println("⚠️ No proximity configurations found!");
-            } else {
-                Serial.printf("📊 Found %d proximity configurations:\n", configs.size());
-                for (const auto& config : configs) {
-                    Serial.printf("  🏷️ ID: %s\n", config.beaconId.c_str());
-                    Serial.printf("     Name: %s\n", config.beaconName.c_str());
-                    Serial.printf("     MAC: %s\n", config.macAddress.c_str());
-                    Serial.printf("     Alert: %s (%d intensity)\n", config.alertMode.c_str(), config.alertIntensity);
-                    Serial.printf("     Trigger: %dcm, Duration: %dms\n", config.triggerDistance, config.alertDuration);
-                    Serial.printf("     Delay: %s (%dms), Cooldown: %dms\n", 
-                                 config.enableProximityDelay ? "enabled" : "disabled", 
-                                 config.proximityDelayTime, config.cooldownPeriod);
-                    Serial.printf("     State: %s, In Range: %s\n", 
-                                 config.alertActive ? "active" : "inactive",
-                                 config.inProximityRange ? "yes" : "no");
-                    Serial.println();
-                }
-            }
-            Serial.println("📋 === END CONFIGURATIONS ===");
-            
-        } else if (cmd == "list_detected_beacons") {
-            // 🐛 DEBUG: List all currently detected beacons
-            Serial.println("📡 === DETECTED BEACONS ===");
-            auto beacons = beaconManager.getActiveBeacons();
-            if (beacons.empty()) {
-                Serial.println("⚠️ No beacons currently detected!");
-            } else {
-                Serial.printf("📊 Found %d active beacons:\n", beacons.size());
-                for (const auto& beacon : beacons) {
-                    Serial.printf("  📡 Name: %s\n", beacon.name.c_str());
-                    Serial.printf("     Address: %s\n", beacon.address.c_str());
-                    Serial.printf("     RSSI: %ddBm, Distance: %.1fcm\n", beacon.rssi, beacon.distance);
-                    Serial.printf("     Confidence: %.1f%%, Active: %s\n", 
-                                 beacon.confidence * 100, beacon.isActive ? "yes" : "no");
-                    Serial.printf("     Last seen: %lums ago\n", millis() - beacon.lastSeen);
-                    Serial.println();
-                }
-            }
-            Serial.println("📡 === END BEACONS ===");
-            
-        } else {
-            Serial.printf("❓ Unknown command: %s\n", cmd.c_str());
-        }
-        
-    } else if (topicStr.indexOf("/command/zone") > 0) {
-        String action = doc["action"] | "status";
-        
-        if (action == "list") {
-            // Publish zone information using existing ZoneManager
-            publishZoneStatus();
-        } else if (action == "alert") {
-            String zoneId = doc["zone_id"] | "";
-            alertManager.startAlert(AlertReason::ZONE_BREACH, AlertMode::BOTH);
-        }
-        
-    } else if (topicStr.indexOf("/command/locate") > 0) {
-        // Trigger location beacon using existing triangulator
-        alertManager.startAlert(AlertReason::LOCATE_REQUEST, AlertMode::BOTH);
-        publishCurrentLocation();
+    } else if (status != CommandStatus::OK) {
+        Serial.printf("❓ Unknown command: %s (%s)\n", commandRegistry.getLastName(),
+                     commandStatusToString(status));
     }
 }
 
 /**
  * @brief Publish status to MQTT cloud
  */
-void publishMQTTStatus(String status) {
+void publishMQTTStatus(const char* status) {
     if (!mqttState.connected) return;
     
-    DynamicJsonDocument doc(512);
-    doc["device_id"] = String(DEVICE_ID);
+    IPAddress ip = WiFi.localIP();
+    char ipAddress[16];
+    snprintf(ipAddress, sizeof(ipAddress), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    
+    StaticJsonDocument<256> doc;
+    doc["device_id"] = DEVICE_ID;
     doc["status"] = status;
     doc["timestamp"] = millis();
-    doc["ip_address"] = WiFi.localIP().toString();
+    doc["ip_address"] = (const char*)ipAddress;
     doc["firmware_version"] = FIRMWARE_VERSION;
     
-    String message;
-    serializeJson(doc, message);
+    publishJson(mqttTopics[TOPIC_STATUS].path, doc, true);
+}
+
+/**
+ * @brief Publish the proximity config set hash and per-beacon hashes (retained)
+ * @param result Outcome of the command that prompted it: report, ok, mismatch or resync
+ *
+ * The dashboard diffs the entry hashes against its own list and sends a
+ * proximity-sync delta, or a full configure_beacons_batch on "resync".
+ */
+void publishProximityState(const char* result) {
+    if (!mqttState.connected) return;
+    
+    const CollarSettings& settings = collarSettings.get();
+    char setHash[9];
+    char entryHashes[SETTINGS_MAX_PROXIMITY][9];
+    snprintf(setHash, sizeof(setHash), "%08lx", (unsigned long)proximitySetHash(settings));
+    
+    StaticJsonDocument<1024> doc;
+    doc["device_id"] = DEVICE_ID;
+    doc["result"] = result;
+    doc["hash"] = (const char*)setHash;
+    doc["count"] = settings.proximityCount;
+    JsonObject entries = doc.createNestedObject("entries");
+    for (uint8_t i = 0; i < settings.proximityCount; i++) {
+        const ProximitySetting& proximity = settings.proximity[i];
+        snprintf(entryHashes[i], sizeof(entryHashes[i]), "%08lx",
+                 (unsigned long)proximitySettingHash(proximity));
+        entries[(const char*)proximity.beaconId] = (const char*)entryHashes[i];
+    }
     
-    String topic = "pet-collar/" + String(DEVICE_ID) + "/status";
-    mqttClient.publish(topic.c_str(), message.c_str(), true);
-    mqttState.messagesPublished++;
+    publishJson(mqttTopics[TOPIC_PROXIMITY_CONFIG].path, doc, true);
 }
 
 /**
- * @brief Publish comprehensive telemetry to MQTT cloud
+ * @brief Publish loop timing per stage and start a new histogram window
+ *
+ * stages holds [stage, count, p50 us, p99 us, max us] for every stage that
+ * ran since the previous report; loop_avg_us/loop_max_us cover all passes
+ * since boot (or perf reset).
  */
-void publishMQTTTelemetry() {
+void publishPerfReport() {
     if (!mqttState.connected) return;
     
-    DynamicJsonDocument doc(2048);
+    const PerformanceMetrics& performance = systemStateManager.getSystemStatus().performance;
+    static StaticJsonDocument<1536> doc;    // 13 stage arrays; kept off the loop stack
+    doc.clear();
+    doc["device_id"] = DEVICE_ID;
+    doc["timestamp"] = millis();
+    doc["window_ms"] = millis() - loopProfiler.getWindowStartMs();
+    doc["loops"] = performance.loopIterations;
+    doc["loop_avg_us"] = performance.averageLoopTimeUs;
+    doc["loop_max_us"] = performance.maxLoopTimeUs;
+    loopProfiler.writeJson(doc.createNestedArray("stages"));
+    
+    publishJson(mqttTopics[TOPIC_DIAGNOSTICS].path, doc, false);
+    loopProfiler.reset(millis());
+}
+
+/**
+ * @brief Publish heap state and, in profiling builds, allocations per tag
+ *
+ * frag is 100 - largest free block / free bytes. tags holds [tag, live
+ * bytes, live blocks, peak bytes, allocs, alloc bytes]; allocs and alloc
+ * bytes cover the window since the previous report.
+ */
+void publishHeapReport() {
+    if (!mqttState.connected) return;
     
-    // Basic device info
-    doc["device_id"] = String(DEVICE_ID);
+    HeapSummary heap = readHeapSummary();
+    static StaticJsonDocument<768> doc;     // 6 tag arrays; kept off the loop stack
+    doc.clear();
+    doc["device_id"] = DEVICE_ID;
     doc["timestamp"] = millis();
-    doc["uptime"] = millis() - bootTime;
-    doc["firmware_version"] = FIRMWARE_VERSION;
-    doc["free_heap"] = ESP.getFreeHeap();
+    doc["free"] = heap.freeBytes;
+    doc["min_free"] = heap.minFreeBytes;
+    doc["largest"] = heap.largestFreeBlock;
+    doc["frag"] = heap.fragmentation;
+#if FEATURE_MEMORY_PROFILING
+    doc["window_ms"] = millis() - heapProfiler.getWindowStartMs();
+    doc["tracked"] = heapProfiler.getTrackedBlocks();
+    doc["untracked"] = heapProfiler.getUntrackedAllocs();
+    heapProfiler.writeJson(doc.createNestedArray("tags"));
+#endif
+    
+    publishJson(mqttTopics[TOPIC_HEAP].path, doc, false);
+#if FEATURE_MEMORY_PROFILING
+    heapProfiler.resetWindow(millis());
+#endif
+}
+
+#if FEATURE_TRACE
+/**
+ * @brief Send pending trace records to whoever asked for them
+ *
+ * MQTT gets one binary message per batch on diagnostics/trace, a WebSocket
+ * client one binary frame per batch, serial one "TRACE <hex>" line per
+ * batch; firmware/tools/trace_to_chrome.py reads all three. Stops after
+ * one ring's worth so records traced while sending cannot keep it going.
+ * @return Records sent
+ */
+uint32_t drainTrace(CommandSource destination, uint8_t clientNum) {
+    static uint8_t batch[TRACE_BATCH_BYTES];
+    uint32_t records = 0;
+    
+    for (uint8_t i = 0; i <= TRACE_BUFFER_RECORDS / TRACE_BATCH_RECORDS; i++) {
+        size_t length = traceBuffer.writeBatch(batch, sizeof(batch));
+        if (length == 0) {
+            break;
+        }
+        bool sent = true;
+        if (destination == CMD_SRC_MQTT) {
+            sent = mqttState.connected && publishStream(mqttTopics[TOPIC_TRACE].path, batch, length);
+        } else if (destination == CMD_SRC_WEBSOCKET) {
+            sent = webSocket.sendBIN(clientNum, batch, length);
+        } else {
+            Serial.print("TRACE ");
+            for (size_t j = 0; j < length; j++) {
+                Serial.printf("%02x", batch[j]);
+            }
+            Serial.println();
+        }
+        if (!sent) {
+            break;      // This batch is dropped; the rest stay queued
+        }
+        records += (length - sizeof(TraceBatchHeader)) / sizeof(TraceRecord);
+    }
+    return records;
+}
+#endif
+
+/**
+ * @brief Gather the values published by periodic telemetry
+ * @param snapshot Snapshot to fill
+ */
+void collectTelemetrySnapshot(TelemetrySnapshot& snapshot) {
+    memset(&snapshot, 0, sizeof(snapshot));
+    
+    // Basic device info
+    snapshot.timestamp = millis();
+    snapshot.uptime = millis() - bootTime;
+    snapshot.firmware = FIRMWARE_VERSION;
+    snapshot.freeHeap = ESP.getFreeHeap();
     
     // Network status
-    doc["wifi_connected"] = WiFi.isConnected();
-    doc["wifi_rssi"] = WiFi.RSSI();
-    doc["local_ip"] = WiFi.localIP().toString();
+    snapshot.wifiConnected = WiFi.isConnected();
+    snapshot.wifiRssi = WiFi.RSSI();
+    IPAddress ip = WiFi.localIP();
+    snprintf(snapshot.localIp, sizeof(snapshot.localIp), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
     
     // System status from existing SystemStateManager
-    doc["system_state"] = systemStateManager.getCurrentState();
-    doc["battery_level"] = systemStateManager.getBatteryLevel();
-    doc["alert_active"] = alertManager.isAlertActive();
+    snapshot.systemState = (uint8_t)systemStateManager.getCurrentState();
+    snapshot.batteryLevel = systemStateManager.getBatteryLevel();
+    snapshot.alertActive = alertManager.isAlertActive();
     
     // Zone information from existing ZoneManager
-    JsonObject zones = doc.createNestedObject("zones");
-    zones["total_zones"] = zoneManager.getZoneCount();
-    zones["current_zone"] = zoneManager.getCurrentZone();
-    zones["zone_breaches"] = zoneManager.getBreachCount();
+    snapshot.totalZones = zoneManager.getZoneCount();
+    zoneManager.getCurrentZone(snapshot.currentZone, sizeof(snapshot.currentZone));
+    snapshot.zoneBreaches = zoneManager.getBreachCount();
     
     // Beacon data from existing BeaconManager
-    JsonObject beacons = doc.createNestedObject("beacons");
-    beacons["detected_count"] = beaconManager.getDetectedBeaconCount();
-    beacons["active_beacons"] = beaconManager.getActiveBeaconCount();
-    beacons["last_scan"] = beaconManager.getLastScanTime();
+    snapshot.detectedBeacons = beaconManager.getDetectedBeaconCount();
+    snapshot.activeBeacons = beaconManager.getActiveBeaconCount();
+    snapshot.lastScan = beaconManager.getLastScanTime();
     
     // Task 2: Temporal filter telemetry
-    if (BLE_TEMPORAL_FILTER_ENABLED) {
-        JsonObject filter = doc.createNestedObject("temporal_filter");
-        filter["enabled"] = true;
-        filter["type"] = BLE_TEMPORAL_FILTER_TYPE == 0 ? "IIR" : "Kalman";
-        filter["iir_alpha"] = globalRSSISmoother.getIIRAlpha();
-        filter["kalman_q"] = globalRSSISmoother.getKalmanQ();
-        filter["kalman_r"] = globalRSSISmoother.getKalmanR();
+    snapshot.filterEnabled = BLE_TEMPORAL_FILTER_ENABLED;
+    if (snapshot.filterEnabled) {
+        snapshot.filterType = BLE_TEMPORAL_FILTER_TYPE == 0 ? 0 : 1;
+        snapshot.iirAlpha = globalRSSISmoother.getIIRAlpha();
+        snapshot.kalmanQ = globalRSSISmoother.getKalmanQ();
+        snapshot.kalmanR = globalRSSISmoother.getKalmanR();
         
-        // Add sample filtered distance for first active beacon (if any)
         uint32_t processed, discarded;
         uint8_t activeBeacons;
         globalRSSISmoother.getGlobalStats(processed, discarded, activeBeacons);
-        filter["active_filters"] = activeBeacons;
-        filter["total_updates"] = processed;
-    } else {
-        doc["temporal_filter"]["enabled"] = false;
+        snapshot.activeFilters = activeBeacons;
+        snapshot.filterUpdates = processed;
     }
     
     // Position data from existing Triangulator
-    if (triangulator.isReady()) {
-        JsonObject position = doc.createNestedObject("position");
+    snapshot.hasPosition = triangulator.isReady();
+    if (snapshot.hasPosition) {
         auto lastPos = triangulator.getLastPosition();
-        position["x"] = lastPos.position.x;
-        position["y"] = lastPos.position.y;
-        position["confidence"] = lastPos.confidence;
-        position["accuracy"] = lastPos.accuracy;
+        snapshot.posX = lastPos.position.x;
+        snapshot.posY = lastPos.position.y;
+        snapshot.posConfidence = lastPos.confidence;
+        snapshot.posAccuracy = lastPos.accuracy;
     }
-    
-    String message;
-    serializeJson(doc, message);
-    
-    String topic = "pet-collar/" + String(DEVICE_ID) + "/telemetry";
-    mqttClient.publish(topic.c_str(), message.c_str());
-    mqttState.messagesPublished++;
-    mqttState.lastTelemetry = millis();
 }
 
 /**
- * @brief Publish zone status using existing ZoneManager
+ * @brief Publish comprehensive telemetry to MQTT cloud
  */
-void publishZoneStatus() {
-    if (!mqttState.connected) return;
+void publishMQTTTelemetry() {
+    if (!mqttState.connected && !mqttOutbox.isReady()) return;
     
-    String zonesJson = zoneManager.getStatusJson();
-    String topic = "pet-collar/" + String(DEVICE_ID) + "/zones";
-    mqttClient.publish(topic.c_str(), zonesJson.c_str());
-}
-
-/**
- * @brief Publish current location using existing Triangulator
- */
-void publishCurrentLocation() {
-    if (!mqttState.connected || !triangulator.isReady()) return;
+    TelemetrySnapshot snapshot;
+    collectTelemetrySnapshot(snapshot);
     
-    auto lastPos = triangulator.getLastPosition();
+    if (telemetryFormat == TelemetryFormat::CBOR && !mqttState.connected) {
+        // Offline: store a full snapshot, deltas need a live baseline
+        size_t length = encodeTelemetryCbor(telemetryWriter, DEVICE_ID, snapshot);
+        if (length > 0) {
+            queueInOutbox(OutboxKind::TELEMETRY, TOPIC_TELEMETRY, telemetryWriter.data(), length);
+        }
+        mqttState.lastTelemetry = millis();
+        return;
+    }
     
-    DynamicJsonDocument doc(512);
-    doc["device_id"] = String(DEVICE_ID);
-    doc["timestamp"] = millis();
-    doc["position"]["x"] = lastPos.position.x;
-    doc["position"]["y"] = lastPos.position.y;
-    doc["confidence"] = lastPos.confidence;
-    doc["accuracy"] = lastPos.accuracy;
-    doc["method"] = "triangulation";
+    if (telemetryFormat == TelemetryFormat::CBOR) {
+        // Keyframe or changed fields only; unchanged telemetry is not published
+        TelemetryFrame frame = telemetryDelta.encode(telemetryWriter, DEVICE_ID, snapshot, millis());
+        if (frame != TelemetryFrame::SUPPRESSED) {
+            bool sent = publishBinaryPayload(mqttTopics[TOPIC_TELEMETRY].path,
+                                             telemetryDelta.getPendingLength());
+            telemetryDelta.markSent(sent);
+        }
+        mqttState.lastTelemetry = millis();
+        return;
+    }
     
-    String message;
-    serializeJson(doc, message);
+    // Static: too large for the loop task stack, and only used from loop()
+    static StaticJsonDocument<2048> doc;
+    doc.clear();
+    
+    // Basic device info
+    doc["device_id"] = DEVICE_ID;
+    doc["timestamp"] = snapshot.timestamp;
+    doc["uptime"] = snapshot.uptime;
+    doc["firmware_version"] = snapshot.firmware;
+    doc["free_heap"] = snapshot.freeHeap;
+    
+    // Network status
+    doc["wifi_connected"] = snapshot.wifiConnected;
+    doc["wifi_rssi"] = snapshot.wifiRssi;
+    doc["local_ip"] = snapshot.localIp;
+    
+    // System status
+    doc["system_state"] = systemStateManager.getCurrentState();
+    doc["battery_level"] = snapshot.batteryLevel;
+    doc["alert_active"] = snapshot.alertActive;
+    
+    // Zone information
+    JsonObject zones = doc.createNestedObject("zones");
+    zones["total_zones"] = snapshot.totalZones;
+    zones["current_zone"] = snapshot.currentZone;
+    zones["zone_breaches"] = snapshot.zoneBreaches;
+    
+    // Beacon data
+    JsonObject beacons = doc.createNestedObject("beacons");
+    beacons["detected_count"] = snapshot.detectedBeacons;
+    beacons["active_beacons"] = snapshot.activeBeacons;
+    beacons["last_scan"] = snapshot.lastScan;
+    
+    // Task 2: Temporal filter telemetry
+    if (snapshot.filterEnabled) {
+        JsonObject filter = doc.createNestedObject("temporal_filter");
+        filter["enabled"] = true;
+        filter["type"] = snapshot.filterType == 0 ? "IIR" : "Kalman";
+        filter["iir_alpha"] = snapshot.iirAlpha;
+        filter["kalman_q"] = snapshot.kalmanQ;
+        filter["kalman_r"] = snapshot.kalmanR;
+        filter["active_filters"] = snapshot.activeFilters;
+        filter["total_updates"] = snapshot.filterUpdates;
+    } else {
+        doc["temporal_filter"]["enabled"] = false;
+    }
+    
+    // Position data
+    if (snapshot.hasPosition) {
+        JsonObject position = doc.createNestedObject("position");
+        position["x"] = snapshot.posX;
+        position["y"] = snapshot.posY;
+        position["confidence"] = snapshot.posConfidence;
+        position["accuracy"] = snapshot.posAccuracy;
+    }
+    
+    publishDurableJson(OutboxKind::TELEMETRY, TOPIC_TELEMETRY, doc);
+    mqttState.lastTelemetry = millis();
+}
+
+/**
+ * @brief Publish zone status using existing ZoneManager
+ */
+void publishZoneStatus() {
+    if (!mqttState.connected) return;
+    
+    char currentZone[24];
+    zoneManager.getCurrentZone(currentZone, sizeof(currentZone));
+    
+    if (telemetryFormat == TelemetryFormat::CBOR) {
+        size_t length = encodeZoneStatusCbor(telemetryWriter, DEVICE_ID, millis(),
+                                             zoneManager.getZoneCount(), currentZone,
+                                             zoneManager.getBreachCount());
+        publishBinaryPayload(mqttTopics[TOPIC_ZONES].path, length);
+        return;
+    }
+    
+    // Same fields as ZoneManager_Enhanced::getStatusJson(), without the String round trip
+    StaticJsonDocument<256> doc;
+    doc["zone_count"] = zoneManager.getZoneCount();
+    doc["current_zone"] = currentZone;
+    doc["breach_count"] = zoneManager.getBreachCount();
+    doc["timestamp"] = millis();
+    
+    publishJson(mqttTopics[TOPIC_ZONES].path, doc);
+}
+
+/**
+ * @brief Publish current location using existing Triangulator
+ */
+void publishCurrentLocation() {
+    if (!mqttState.connected || !triangulator.isReady()) return;
+    
+    auto lastPos = triangulator.getLastPosition();
+    
+    if (telemetryFormat == TelemetryFormat::CBOR) {
+        size_t length = encodeLocationCbor(telemetryWriter, DEVICE_ID, millis(),
+                                           lastPos.position.x, lastPos.position.y,
+                                           lastPos.confidence, lastPos.accuracy);
+        publishBinaryPayload(mqttTopics[TOPIC_LOCATION].path, length);
+        return;
+    }
+    
+    StaticJsonDocument<384> doc;
+    doc["device_id"] = DEVICE_ID;
+    doc["timestamp"] = millis();
+    doc["position"]["x"] = lastPos.position.x;
+    doc["position"]["y"] = lastPos.position.y;
+    doc["confidence"] = lastPos.confidence;
+    doc["accuracy"] = lastPos.accuracy;
+    doc["method"] = "triangulation";
     
-    String topic = "pet-collar/" + String(DEVICE_ID) + "/location";
-    mqttClient.publish(topic.c_str(), message.c_str());
+    publishJson(mqttTopics[TOPIC_LOCATION].path, doc);
 }
 
 /**
@@ -1578,11 +2085,24 @@ void maintainMQTTConnection() {
     if (!mqttState.enabled) return;
     
     if (!mqttClient.connected()) {
+        if (mqttState.connected) {
+            mqttOutbox.onDisconnect();  // Refusals on a dead link do not count against records
+        }
         mqttState.connected = false;
         connectToMQTTCloud();
+        
+        // Keep a sparse telemetry trail in the outbox while offline
+        if (!mqttState.connected && mqttOutbox.isReady() &&
+            millis() - lastOfflineTelemetry > OUTBOX_OFFLINE_TELEMETRY_MS) {
+            publishMQTTTelemetry();
+            lastOfflineTelemetry = millis();
+        }
     } else {
         mqttClient.loop();
         
+        // Replay messages stored while offline (bounded, paced batches)
+        mqttOutbox.drain(millis());
+        
         // Periodic telemetry
         if (millis() - mqttState.lastTelemetry > MQTT_TELEMETRY_INTERVAL) {
             publishMQTTTelemetry();
@@ -1593,6 +2113,20 @@ void maintainMQTTConnection() {
             publishMQTTStatus("online");
             mqttState.lastHeartbeat = millis();
         }
+        
+#if FEATURE_LOOP_PROFILING
+        // Loop timing report; each one starts a new histogram window
+        if (millis() - mqttState.lastPerfReport > PERF_REPORT_INTERVAL_MS) {
+            publishPerfReport();
+            mqttState.lastPerfReport = millis();
+        }
+#endif
+        
+        // Heap fragmentation (and allocation rates per tag when profiling)
+        if (millis() - mqttState.lastHeapReport > HEAP_REPORT_INTERVAL_MS) {
+            publishHeapReport();
+            mqttState.lastHeapReport = millis();
+        }
     }
 }
 
@@ -1604,6 +2138,9 @@ void maintainMQTTConnection() {
 class AdvancedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks {
 public:
     void onResult(BLEAdvertisedDevice advertisedDevice) {
+        PERF_SCOPE(BLE_CALLBACK);
+        HEAP_TAG(BLE);
+        
         // 🚀 ENHANCED: Accept ALL BLE devices with names for universal compatibility
         // This allows the collar to work with ANY transmitter/beacon, not just "PetZone" branded ones
         if (!advertisedDevice.haveName()) {
@@ -1617,21 +2154,21 @@ public:
         
         String deviceMac = advertisedDevice.getAddress().toString().c_str();
         int16_t rawRssi = advertisedDevice.getRSSI();
+        TRACE(BLE_ADVERT, traceNameHash(deviceName.c_str()), rawRssi);
         
         // 📡 PACKET-LEVEL RSSI SMOOTHING
         // Add raw RSSI packet to smoother for quality filtering and aggregation
         bool packetAccepted = globalRSSISmoother.addRSSIPacket(deviceMac.c_str(), rawRssi, true);
         
         if (DEBUG_BLE && !packetAccepted) {
-            Serial.printf("🚫 RSSI packet rejected: %s, RSSI: %d dBm (below threshold or outlier)\n",
-                         deviceName.c_str(), rawRssi);
+            LOGV("🚫 RSSI packet rejected: %s, RSSI: %d dBm (below threshold or outlier)",
+                 deviceName.c_str(), rawRssi);
         }
         
         // Check if we have enough smoothed data to proceed
         if (!globalRSSISmoother.hasSmoothedData(deviceMac.c_str())) {
             if (DEBUG_BLE) {
-                Serial.printf("⏳ Collecting packets for %s: raw RSSI %d dBm\n", 
-                             deviceName.c_str(), rawRssi);
+                LOGV("⏳ Collecting packets for %s: raw RSSI %d dBm", deviceName.c_str(), rawRssi);
             }
             return; // Not enough packets yet, wait for more
         }
@@ -1659,17 +2196,16 @@ public:
         
         // Enhanced debug output showing smoothing effects
         if (DEBUG_BLE) {
-            Serial.printf("🔍 Beacon processed: %s (MAC: %s)\n", beacon.name.c_str(), beacon.address.c_str());
-            Serial.printf("   Raw RSSI: %d dBm → Smoothed: %d dBm (Δ: %d dB)\n", 
-                         rawRssi, smoothedRssi, smoothedRssi - rawRssi);
-            Serial.printf("   Distance: %.2f cm, Confidence: %.1f%%\n", 
-                         beacon.distance, beacon.confidence);
-            Serial.printf("   Smoothing: %d/%d packets, latency: %u ms\n", 
-                         stats.validPackets, stats.totalPackets, stats.latencyMs);
+            LOGD("🔍 Beacon processed: %s (MAC: %s), RSSI %d → %d dBm, %.2f cm, %.1f%% (%d/%d packets, %lu ms)",
+                 beacon.name.c_str(), beacon.address.c_str(), rawRssi, smoothedRssi,
+                 beacon.distance, beacon.confidence, stats.validPackets, stats.totalPackets,
+                 (unsigned long)stats.latencyMs);
         }
         
         // Update beacon manager with smoothed detection
         beaconManager.updateBeacon(beacon);
+        wsStreams.updateBeacon(beacon.name.c_str(), rawRssi, smoothedRssi,
+                               beacon.distance, beacon.confidence);
         
         // 🚨 CRITICAL: Check for proximity alerts using smoothed data
         // This provides more stable and reliable proximity detection
@@ -1680,8 +2216,10 @@ public:
         
         // Send smoothed beacon detection to MQTT cloud
         if (mqttState.connected) {
-            DynamicJsonDocument doc(768);
-            doc["device_id"] = String(DEVICE_ID);
+            // Static: scan callbacks run on the BLE host task's small stack
+            static StaticJsonDocument<768> doc;
+            doc.clear();
+            doc["device_id"] = DEVICE_ID;
             doc["timestamp"] = millis();
             doc["beacon_name"] = beacon.name;
             doc["rssi_raw"] = rawRssi;           // Include raw RSSI for comparison
@@ -1697,42 +2235,56 @@ public:
             smoothing["latency_ms"] = stats.latencyMs;
             smoothing["method"] = (BLE_RSSI_SMOOTHING_METHOD == 0) ? "median" : "trimmed_mean";
             
-            String message;
-            serializeJson(doc, message);
-            
-            String topic = "pet-collar/" + String(DEVICE_ID) + "/beacon-detection";
-            mqttClient.publish(topic.c_str(), message.c_str());
+            publishJson(mqttTopics[TOPIC_BEACON_DETECTION].path, doc);
         }
     }
 };
 
 // ==================== I2C SCANNING UTILITY ====================
+/**
+ * @brief I2cBus over the Arduino Wire driver
+ *
+ * Each write is one transaction; the driver's bus lock keeps the flush
+ * task and loop-side probes from interleaving.
+ */
+class WireI2cBus : public I2cBus {
+private:
+    TwoWire& m_wire;
+
+public:
+    explicit WireI2cBus(TwoWire& wire) : m_wire(wire) {}
+
+    bool write(uint8_t address, const uint8_t* data, size_t length) override {
+        m_wire.beginTransmission(address);
+        if (length > 0) {
+            m_wire.write(data, length);
+        }
+        return m_wire.endTransmission() == 0;
+    }
+};
+
+WireI2cBus wireBus(Wire);
+
 /**
  * @brief Scan I2C bus for connected devices
- * @return bool True if any devices found
+ * @return bool True if the display answered
  */
 bool scanI2CBus() {
     if (DEBUG_I2C) {
         Serial.println("🔍 Scanning I2C bus for devices...");
     }
     
-    int deviceCount = 0;
+    uint8_t found[16];
+    uint8_t deviceCount = scanI2cAddresses(wireBus, found, sizeof(found));
     bool displayFound = false;
     
-    for (byte address = 1; address < 127; address++) {
-        Wire.beginTransmission(address);
-        byte error = Wire.endTransmission();
-        
-        if (error == 0) {
-            deviceCount++;
-            if (DEBUG_I2C) {
-                Serial.printf("✅ I2C device found at address 0x%02X", address);
-                if (address == OLED_ADDRESS) {
-                    Serial.print(" (OLED Display)");
-                    displayFound = true;
-                }
-                Serial.println();
-            }
+    for (uint8_t i = 0; i < deviceCount && i < sizeof(found); i++) {
+        if (found[i] == OLED_ADDRESS) {
+            displayFound = true;
+        }
+        if (DEBUG_I2C) {
+            Serial.printf("✅ I2C device found at address 0x%02X%s\n", found[i],
+                         found[i] == OLED_ADDRESS ? " (OLED Display)" : "");
         }
     }
     
@@ -1744,6 +2296,78 @@ bool scanI2CBus() {
 }
 
 // ==================== DISPLAY MANAGEMENT ====================
+bool displayOnline = false;         // Panel answered display.begin()
+
+// Flush task's copy of the frame buffer; the loop keeps drawing into display's
+static uint8_t displayFrontBuffer[SCREEN_WIDTH * SCREEN_HEIGHT / 8];
+DisplayFlusher displayFlusher(wireBus, OLED_ADDRESS, displayFrontBuffer, SCREEN_WIDTH, SCREEN_HEIGHT / 8);
+TaskHandle_t displayFlushTaskHandle = nullptr;
+
+/**
+ * @brief Sends what updateDisplay() handed over, off the main loop
+ */
+void displayFlushTask(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        displayFlusher.service();
+    }
+}
+
+/**
+ * @brief DisplayWakeFn: wake the flush task
+ */
+void wakeDisplayFlushTask(void* context) {
+    xTaskNotifyGive(static_cast<TaskHandle_t>(context));
+}
+
+/**
+ * @brief DisplayClockFn over micros()
+ */
+uint32_t displayFlushClock() {
+    return micros();
+}
+
+/**
+ * @brief Attach the frame buffer and start the flush task (loop flushes if it cannot start)
+ */
+void startDisplayFlusher() {
+    displayFlusher.begin(display.getBuffer());
+    displayFlusher.setClock(displayFlushClock);
+    if (displayFlushTaskHandle) {
+        return;
+    }
+    if (xTaskCreate(displayFlushTask, "display_flush", DISPLAY_TASK_STACK, nullptr,
+                    DISPLAY_TASK_PRIORITY, &displayFlushTaskHandle) != pdPASS) {
+        displayFlushTaskHandle = nullptr;
+        Serial.println("❌ Display flusher: task create failed, flushing from the loop");
+        return;
+    }
+    displayFlusher.setWakeHook(wakeDisplayFlushTask, displayFlushTaskHandle);
+}
+
+// Status screen fields (6x8 character cells, one text row per 8-pixel page)
+enum DisplayField : uint8_t {
+    FIELD_TITLE,
+    FIELD_WIFI,
+    FIELD_BEACONS,
+    FIELD_BATTERY,
+    FIELD_STATUS,
+    FIELD_DETAIL,
+    FIELD_COUNT
+};
+
+const StatusFieldLayout DISPLAY_LAYOUT[FIELD_COUNT] = {
+    // page, x, width, wakes
+    {0, 0,  10, false},     // PetCollar
+    {0, 64, 10, true},      // WiFi:OK / WiFi:--
+    {1, 0,  10, true},      // Beacons:n
+    {1, 64, 10, false},     // Bat:n%
+    {2, 0,  21, true},      // Ready, errors or alert
+    {3, 0,  21, false},     // Rotating IP, heap, uptime, signal
+};
+
+StatusView statusView(DISPLAY_LAYOUT, FIELD_COUNT, DISPLAY_TIMEOUT_MS);
+
 /**
  * @brief Initialize OLED display with comprehensive error handling
  * @return bool Success status
@@ -1779,7 +2403,7 @@ bool initializeDisplay() {
     }
     
     // Initialize display with error handling (supports both SSD1306 and SH1106)
-    bool displayOnline = false;
+    displayOnline = false;
     if (!display.begin(SSD1306_SWITCHCAPVCC, OLED_ADDRESS)) {
         if (DEBUG_DISPLAY) {
             Serial.println("❌ OLED display initialization failed!");
@@ -1826,6 +2450,9 @@ bool initializeDisplay() {
         display.println("WiFi Connecting...");
         display.display();
         
+        // From here on the panel is only written by the flush task
+        startDisplayFlusher();
+        
         if (DEBUG_DISPLAY) {
             Serial.printf("✅ OLED display initialized (%dx%d)\n", SCREEN_WIDTH, SCREEN_HEIGHT);
             Serial.printf("📐 Full display area utilized: %d chars x %d lines\n", 
@@ -1833,105 +2460,110 @@ bool initializeDisplay() {
         }
     }
     
+    statusView.wake(millis());
     return displayOnline;
 }
 
 /**
  * @brief Check if display is currently working
- * @return bool True if display is responsive
+ * @return bool True if the panel acknowledges its I2C address
  */
 bool isDisplayActive() {
-    // Simple test: try to clear display and check if it responds
-    try {
-        display.clearDisplay();
-        display.setCursor(0, 0);
-        display.print("Test");
-        display.display();
-        return true;
-    } catch (...) {
-        return false;
-    }
+    // Probe only: drawing here would desync the panel from the status view
+    return wireBus.write(OLED_ADDRESS, nullptr, 0);
+}
+
+/**
+ * @brief StatusGlyphWriter drawing into the SSD1306 frame buffer
+ */
+void drawStatusGlyph(void* context, uint8_t x, uint8_t page, char c) {
+    display.drawChar(x, page * STATUS_GLYPH_HEIGHT, c, SSD1306_WHITE, SSD1306_BLACK, 1);
 }
 
 /**
  * @brief Update display with current system status (optimized for 128×32 display)
+ *
+ * Fields are sampled every DISPLAY_SAMPLE_MS; only characters that changed
+ * are redrawn and only their columns are handed to the flush task, which
+ * sends them over I2C while the loop moves on. The panel is switched off
+ * after DISPLAY_TIMEOUT_MS without beacon, WiFi or status changes, and
+ * stays on while an alert sounds.
  */
 void updateDisplay() {
-    static unsigned long lastUpdate = 0;
-    static int displayMode = 0;
-    
-    if (millis() - lastUpdate < 1000) return; // Limit update rate
-    
-    // Clear display buffer completely before drawing
-    display.clearDisplay();
+    static unsigned long lastSample = 0;
+    static unsigned long lastModeChange = 0;
+    static uint8_t displayMode = 0;
+    static bool startupCleared = false;
     
-    int line = 0;
-    const int lineHeight = 8;
+    unsigned long now = millis();
+    if (!displayOnline || now - lastSample < DISPLAY_SAMPLE_MS) return;
+    lastSample = now;
     
-    // Line 0: Compact header with key status
-    display.setCursor(0, line * lineHeight);
-    display.setTextSize(1);
-    display.print("PetCollar");
-    display.setCursor(64, line * lineHeight);
-    if (systemStateData.wifiConnected) {
-        display.print("WiFi:OK");
-    } else {
-        display.print("WiFi:--");
+    // Replace the startup screen once; after that only changed cells are drawn
+    DisplayDirtyPages pages = {};
+    if (!startupCleared) {
+        display.clearDisplay();
+        statusView.invalidate();
+        pages.addAll(SCREEN_HEIGHT / 8, SCREEN_WIDTH);
+        startupCleared = true;
     }
-    line++;
     
-    // Line 1: Beacon status and battery
-    display.setCursor(0, line * lineHeight);
-    int activeBeacons = beaconManager.getActiveBeaconCount();
-    display.printf("Beacons:%d", activeBeacons);
-    display.setCursor(64, line * lineHeight);
-    display.printf("Bat:%d%%", systemStateManager.getBatteryPercent());
-    line++;
+    // Rows 0-1: header, WiFi, beacons and battery
+    statusView.set(FIELD_TITLE, "PetCollar", now);
+    statusView.set(FIELD_WIFI, systemStateData.wifiConnected ? "WiFi:OK" : "WiFi:--", now);
+    statusView.setf(FIELD_BEACONS, now, "Beacons:%d", beaconManager.getActiveBeaconCount());
+    statusView.setf(FIELD_BATTERY, now, "Bat:%d%%", systemStateManager.getBatteryPercent());
     
-    // Line 2: Status or Alert
-    display.setCursor(0, line * lineHeight);
+    // Row 2: Status or Alert
     if (alertManager.isAlertActive()) {
-        display.print("*** ALERT ACTIVE ***");
+        statusView.set(FIELD_STATUS, "*** ALERT ACTIVE ***", now);
+        statusView.wake(now);   // Keep the panel lit for the whole alert
     } else if (systemStateManager.getErrorCount() > 0) {
-        display.printf("Errors:%d", systemStateManager.getErrorCount());
+        statusView.setf(FIELD_STATUS, now, "Errors:%d", systemStateManager.getErrorCount());
     } else {
-        display.print("All Systems Ready");
+        statusView.set(FIELD_STATUS, "All Systems Ready", now);
     }
-    line++;
     
-    // Line 3: Rotating detailed information
-    display.setCursor(0, line * lineHeight);
+    // Row 3: Rotating detailed information, next item every 3 seconds
+    if (now - lastModeChange > 3000) {
+        displayMode++;
+        lastModeChange = now;
+    }
     switch (displayMode % 4) {
         case 0:
             {
-                String currentIP = getCurrentIPAddress();
-                if (currentIP != "Disconnected") {
-                    display.printf("IP:%s", currentIP.c_str());
+                IPAddress ip = WiFi.localIP();
+                if (WiFi.status() == WL_CONNECTED && (uint32_t)ip != 0) {
+                    statusView.setf(FIELD_DETAIL, now, "IP:%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
                 } else {
-                    display.print("Setup mode active");
+                    statusView.set(FIELD_DETAIL, "Setup mode active", now);
                 }
             }
             break;
         case 1:
-            display.printf("Free:%dKB", ESP.getFreeHeap() / 1024);
+            statusView.setf(FIELD_DETAIL, now, "Free:%luKB", (unsigned long)(ESP.getFreeHeap() / 1024));
             break;
         case 2:
-            display.printf("Uptime:%lum", millis() / 60000);
+            statusView.setf(FIELD_DETAIL, now, "Uptime:%lum", (unsigned long)(now / 60000));
             break;
         case 3:
-            display.printf("Signal:%ddBm", WiFi.RSSI());
+            statusView.setf(FIELD_DETAIL, now, "Signal:%ddBm", WiFi.RSSI());
             break;
     }
     
-    // Push all changes to display
-    display.display();
-    lastUpdate = millis();
+    // Draw only while lit; changes wait in the view while dark
+    bool powerChanged = statusView.updateBlanking(now);
+    if (!statusView.isBlanked()) {
+        statusView.render(drawStatusGlyph, nullptr, pages);
+    }
     
-    // Rotate display mode every 3 seconds
-    static unsigned long lastModeChange = 0;
-    if (millis() - lastModeChange > 3000) {
-        displayMode++;
-        lastModeChange = millis();
+    // Hand the spans to the flush task (also picks up spans deferred while it was busy)
+    if (powerChanged) {
+        displayFlusher.setPanelOn(!statusView.isBlanked());
+    }
+    displayFlusher.submit(pages);
+    if (!displayFlusher.isAsync()) {
+        displayFlusher.service();
     }
 }
 
@@ -2009,6 +2641,7 @@ bool initializeWiFi() {
         if (WiFi.status() == WL_CONNECTED) {
             connected = true;
             Serial.printf("\n✅ Connected to stored network: %s\n", WiFi.SSID().c_str());
+            wifiManager.rememberConnection(millis() - startTime);
         } else {
             Serial.printf("\n❌ Stored credential connection failed (Status: %d)\n", WiFi.status());
         }
@@ -2050,6 +2683,7 @@ bool initializeWiFi() {
     if (connected) {
         systemStateData.wifiConnected = true;
         digitalWrite(STATUS_LED_WIFI, HIGH);
+        noteWiFiJoined();
         
         Serial.printf("\n🎉 WiFi connection successful!\n");
         String networkName = (currentNetworkIndex >= 0) ? 
@@ -2073,6 +2707,122 @@ bool initializeWiFi() {
     }
 }
 
+/**
+ * @brief Index of @p ssid in wifiNetworks, or -1
+ */
+int8_t findConfiguredNetwork(const char* ssid) {
+    for (int i = 0; i < numNetworks; i++) {
+        if (strcmp(wifiNetworks[i].ssid, ssid) == 0) {
+            return (int8_t)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Tell the roamer which access point the station is on
+ */
+void noteWiFiJoined() {
+    int8_t network = findConfiguredNetwork(WiFi.SSID().c_str());
+    if (network >= 0) {
+        currentNetworkIndex = network;
+    }
+    wifiRoamer.setConnected(WiFi.BSSID(), WiFi.channel(), network, WiFi.RSSI(), millis());
+}
+
+/**
+ * @brief Join a roaming candidate by BSSID and channel
+ */
+bool joinRoamCandidate(const RoamCandidate& candidate) {
+    if (candidate.network < 0 || candidate.network >= numNetworks) {
+        return false;
+    }
+    const SimpleWiFiCredentials& network = wifiNetworks[candidate.network];
+    if (wifiManager.roamTo(network.ssid, network.password, candidate.bssid, candidate.channel)) {
+        noteWiFiJoined();
+        return true;
+    }
+    wifiRoamer.connectFailed(candidate.bssid, millis());
+    return false;
+}
+
+/**
+ * @brief Background roaming: link sampling, passive scans between other radio
+ *        work, proactive roams and ranked reconnects after a link loss
+ */
+void serviceWiFiRoaming() {
+    if (!systemStateData.wifiConnected) {
+        return;     // Setup mode, or initializeWiFi() still owns the radio
+    }
+    uint32_t now = millis();
+    
+    if (WiFi.status() != WL_CONNECTED) {
+        // Try the ranked access points now instead of waiting for the
+        // maintenance check; if none answers, that check reconnects by scanning
+        if (!wifiRoamer.isConnected()) {
+            return;
+        }
+        if (wifiRoamer.isScanning()) {
+            WiFi.scanDelete();
+            wifiRoamer.scanFinished();
+        }
+        wifiRoamer.setDisconnected();
+        wifiRoamer.reconnectStarted();
+        const RoamCandidate* ranked[ROAM_MAX_CANDIDATES];
+        uint8_t count = wifiRoamer.rank(ranked, ROAM_MAX_CANDIDATES, now);
+        for (uint8_t i = 0; i < count; i++) {
+            if (joinRoamCandidate(*ranked[i])) {
+                return;
+            }
+        }
+        return;
+    }
+    
+    if (!wifiRoamer.isConnected()) {
+        noteWiFiJoined();   // The driver reconnected on its own
+    }
+    
+    static uint32_t lastSampleMs = 0;
+    if (now - lastSampleMs >= WIFI_ROAM_SAMPLE_MS) {
+        lastSampleMs = now;
+        wifiRoamer.reportLinkRssi(WiFi.RSSI());
+    }
+    
+    if (wifiRoamer.isScanning()) {
+        int16_t found = WiFi.scanComplete();
+        if (found == WIFI_SCAN_RUNNING) {
+            return;
+        }
+        for (int16_t i = 0; i < found; i++) {
+            int8_t network = findConfiguredNetwork(WiFi.SSID(i).c_str());
+            if (network >= 0) {
+                wifiRoamer.reportScanResult(WiFi.BSSID(i), WiFi.channel(i), network,
+                                            WiFi.RSSI(i), now);
+            }
+        }
+        WiFi.scanDelete();
+        wifiRoamer.scanFinished();
+    } else {
+        // Radio idle: no outbox backlog being replayed (BLE scans block the loop)
+        bool radioIdle = !mqttState.connected || mqttOutbox.isEmpty();
+        RoamScanRequest scan = wifiRoamer.nextScan(now, radioIdle);
+        if (scan.type != RoamScanType::NONE) {
+            uint8_t channel = scan.type == RoamScanType::CHANNEL ? scan.channel : 0;
+            if (WiFi.scanNetworks(true, false, true, WIFI_ROAM_SCAN_DWELL_MS, channel) == WIFI_SCAN_FAILED) {
+                wifiRoamer.scanFinished();
+            }
+        }
+    }
+    
+    const RoamCandidate* target = wifiRoamer.pickRoamTarget(now);
+    if (target) {
+        RoamCandidate candidate = *target;
+        Serial.printf("📶 Link %d dBm, candidate %d dBm\n", wifiRoamer.getLinkRssi(), candidate.rssi);
+        wifiRoamer.roamStarted(candidate, now);
+        joinRoamCandidate(candidate);   // On failure the next pass reconnects from the ranking
+    }
+}
+
 /**
  * @brief Initialize web server and WebSocket endpoints
  */
@@ -2082,10 +2832,16 @@ void initializeWebServices() {
     Serial.println("🌐 Initializing web services...");
     
     // HTTP endpoints
+    refreshHttpSnapshots();
     server.on("/", HTTP_GET, handleRoot);
     server.on("/api/discover", HTTP_GET, handleDiscover);
     server.on("/api/status", HTTP_GET, handleStatus);
+    server.on("/api/metrics", HTTP_GET, handleMetrics);
     server.on("/api/data", HTTP_GET, handleData);
+#if !FEATURE_ASYNC_WEBSERVER
+    const char* cacheHeaders[] = {"If-None-Match", "Accept-Encoding"};
+    server.collectHeaders(cacheHeaders, 2);
+#endif
     
     server.begin();
     systemStateData.webServerRunning = true;
@@ -2093,6 +2849,7 @@ void initializeWebServices() {
     // WebSocket initialization
     webSocket.begin();
     webSocket.onEvent(webSocketEvent);
+    wsFanout.setTransport(sendWebSocketFrame, dropSlowWebSocketClient, nullptr);
     
     String currentIP = getCurrentIPAddress();
     Serial.printf("✅ Web server started: http://%s\n", currentIP.c_str());
@@ -2172,30 +2929,16 @@ void checkProximityAlerts(const BeaconData& beacon) {
         config = beaconManager.getBeaconConfig(beacon.address);
     }
     
-    // Skip if no configuration exists for this beacon
+    // Runs for every advertisement: trace instead of printing (trace command)
     if (!config) {
-        Serial.printf("📍 Unconfigured beacon nearby: %s (%.1fcm) - Add configuration to enable alerts\n", 
-                     beacon.name.c_str(), beacon.distance);
+        TRACE(PROXIMITY_UNCONFIGURED, traceNameHash(beacon.name.c_str()), beacon.distance);
         return;
     }
-    
-    // 🚀 FOUND CONFIGURATION! Log it for debugging
-    Serial.printf("✅ Found configuration for beacon: %s\n", beacon.name.c_str());
-    Serial.printf("    Alert Mode: %s\n", config->alertMode.c_str());
-    Serial.printf("    Trigger Distance: %.1fcm (current: %.1fcm)\n", config->triggerDistanceCm, beacon.distance);
-    Serial.printf("    Alert Duration: %dms\n", config->alertDurationMs);
-    Serial.printf("    Alert Intensity: %d\n", config->alertIntensity);
+    TRACE(PROXIMITY_CHECK, traceNameHash(beacon.name.c_str()), beacon.distance);
     
     // Check if beacon is within trigger distance
     if (beacon.distance <= config->triggerDistanceCm) {
-        Serial.printf("🎯 Beacon %s is within trigger range (%.1fcm <= %.1fcm)\n", 
-                     beacon.name.c_str(), beacon.distance, config->triggerDistanceCm);
-        
-        // Trigger the proximity alert
         triggerProximityAlert(*config, beacon);
-    } else {
-        Serial.printf("📏 Beacon %s is outside trigger range (%.1fcm > %.1fcm) - no alert\n", 
-                     beacon.name.c_str(), beacon.distance, config->triggerDistanceCm);
     }
 }
 
@@ -2212,49 +2955,77 @@ void triggerProximityAlert(BeaconConfig& config, const BeaconData& beacon) {
     if (config.lastAlertTime > 0 && 
         (currentTime - config.lastAlertTime) < config.cooldownPeriodMs) {
         
-        unsigned long timeRemaining = config.cooldownPeriodMs - (currentTime - config.lastAlertTime);
-        Serial.printf("⏳ Alert cooldown active for %s: %lums remaining\n", 
-                     beacon.name.c_str(), timeRemaining);
+        TRACE(PROXIMITY_COOLDOWN, traceNameHash(beacon.name.c_str()),
+              config.cooldownPeriodMs - (currentTime - config.lastAlertTime));
         return;
     }
     
-    // 🛑 STOP ANY CURRENT ALERT
-    alertManager.stopAlert();
-    
     // 🚨 CONFIGURE NEW ALERT
-    AlertConfig alertConfig;
-    alertConfig.mode = alertManager.stringToAlertMode(config.alertMode);
-    alertConfig.intensity = config.alertIntensity;
-    alertConfig.duration = config.alertDurationMs;
-    alertConfig.reason = AlertReason::PROXIMITY_DETECTED;
-    
-    // 📢 DETAILED LOGGING
-    Serial.printf("\n🚨 PROXIMITY ALERT TRIGGERED! 🚨\n");
-    Serial.printf("   Beacon: %s\n", beacon.name.c_str());
-    Serial.printf("   Distance: %.1fcm (trigger: %dcm)\n", beacon.distance, config.triggerDistanceCm);
-    Serial.printf("   Alert Mode: %s\n", config.alertMode.c_str());
-    Serial.printf("   Intensity: %d/5\n", config.alertIntensity);
-    Serial.printf("   Duration: %dms\n", config.alertDurationMs);
-    Serial.printf("   RSSI: %d dBm\n", beacon.rssi);
-    
-    // 🔊 TRIGGER THE ALERT
-    bool alertStarted = alertManager.triggerAlert(alertConfig);
-    
-    if (alertStarted) {
+    // The arbiter decides whether it preempts, queues behind or merges with
+    // whatever is already sounding, so the current alert is not stopped here
+    AlertRequest alertRequest;
+    alertRequest.source = AlertSource::PROXIMITY;
+    alertRequest.reason = AlertReason::PROXIMITY_DETECTED;
+    alertRequest.priority = alertPriorityForReason(AlertReason::PROXIMITY_DETECTED);
+    alertRequest.mode = alertManager.stringToAlertMode(config.alertMode);
+    alertRequest.pattern = AlertPattern::CONTINUOUS;
+    alertRequest.intensity = config.alertIntensity;
+    alertRequest.durationMs = config.alertDurationMs;
+    
+    LOGI("🚨 PROXIMITY ALERT: %s at %.1fcm (trigger: %.0fcm, RSSI: %d dBm), %s %u/5 for %ums",
+         beacon.name.c_str(), beacon.distance, config.triggerDistanceCm, beacon.rssi,
+         config.alertMode.c_str(), config.alertIntensity, config.alertDurationMs);
+    
+    // 🔊 SUBMIT THE ALERT
+    ArbiterDecision decision = alertManager.submitAlert(alertRequest);
+    TRACE(PROXIMITY_ALERT, traceNameHash(beacon.name.c_str()), decision);
+    
+    if (decision == ArbiterDecision::MERGED || decision == ArbiterDecision::QUEUED) {
+        // Covered by an alert that is already sounding or waiting: start this
+        // beacon's cooldown but don't re-announce it to clients and the cloud
+        config.lastAlertTime = currentTime;
+        LOGI("🔗 Alert for %s %s - not re-published",
+             beacon.name.c_str(), arbiterDecisionToString(decision));
+        
+    } else if (decision != ArbiterDecision::DROPPED) {
         // Update configuration state
         config.alertActive = true;
         config.lastAlertTime = currentTime;
         systemStateManager.updateProximityAlerts(1);
         
-        Serial.printf("✅ Alert successfully started for %s\n", beacon.name.c_str());
+        LOGI("✅ Alert successfully started for %s", beacon.name.c_str());
         
         // 📡 BROADCAST ALERT VIA WEBSOCKET
         broadcastAlertStatus(config, beacon);
         
-        // ☁️ SEND ALERT TO MQTT CLOUD
-        if (mqttState.connected) {
-            DynamicJsonDocument doc(512);
-            doc["device_id"] = String(DEVICE_ID);
+        // ☁️ SEND ALERT TO MQTT CLOUD (kept in the outbox while offline)
+        DeliveryResult delivery;
+        if (telemetryFormat == TelemetryFormat::CBOR) {
+            AlertTelemetry alertTelemetry = {};
+            alertTelemetry.timestamp = currentTime;
+            alertTelemetry.beaconName = beacon.name.c_str();
+            alertTelemetry.beaconAddress = beacon.address.c_str();
+            alertTelemetry.distanceCm = beacon.distance;
+            alertTelemetry.rssi = beacon.rssi;
+            alertTelemetry.alertMode = config.alertMode.c_str();
+            alertTelemetry.intensity = config.alertIntensity;
+            alertTelemetry.durationMs = config.alertDurationMs;
+            alertTelemetry.triggerDistanceCm = config.triggerDistanceCm;
+            alertTelemetry.hasPosition = triangulator.isReady();
+            if (alertTelemetry.hasPosition) {
+                auto lastPos = triangulator.getLastPosition();
+                alertTelemetry.posX = lastPos.position.x;
+                alertTelemetry.posY = lastPos.position.y;
+                alertTelemetry.posConfidence = lastPos.confidence;
+            }
+            
+            size_t length = encodeAlertCbor(telemetryWriter, DEVICE_ID, alertTelemetry);
+            delivery = length > 0 ?
+                       publishDurable(OutboxKind::ALERT, TOPIC_ALERT, telemetryWriter.data(), length) :
+                       DeliveryResult::FAILED;
+        } else {
+            StaticJsonDocument<512> doc;
+            doc["device_id"] = DEVICE_ID;
             doc["timestamp"] = currentTime;
             doc["alert_type"] = "proximity";
             doc["beacon_name"] = beacon.name;
@@ -2275,27 +3046,22 @@ void triggerProximityAlert(BeaconConfig& config, const BeaconData& beacon) {
                 position["confidence"] = lastPos.confidence;
             }
             
-            String message;
-            serializeJson(doc, message);
-            
-            String topic = "pet-collar/" + String(DEVICE_ID) + "/alert";
-            bool mqttSent = mqttClient.publish(topic.c_str(), message.c_str());
-            
-            if (mqttSent) {
-                Serial.printf("☁️ Proximity alert sent to MQTT cloud\n");
-            } else {
-                Serial.printf("❌ Failed to send alert to MQTT cloud\n");
-            }
+            delivery = publishDurableJson(OutboxKind::ALERT, TOPIC_ALERT, doc);
+        }
+        
+        if (delivery == DeliveryResult::SENT) {
+            LOGI("☁️ Proximity alert sent to MQTT cloud");
+        } else if (delivery == DeliveryResult::QUEUED) {
+            LOGI("📥 MQTT unavailable - alert queued for delivery");
         } else {
-            Serial.printf("⚠️ MQTT not connected - alert not sent to cloud\n");
+            LOGW("❌ Failed to send alert to MQTT cloud");
         }
         
-        Serial.printf("🔄 Next alert available in %dms\n", config.cooldownPeriodMs);
-        Serial.printf("═══════════════════════════════════════\n\n");
+        LOGD("🔄 Next alert available in %ums", config.cooldownPeriodMs);
         
     } else {
-        Serial.printf("❌ Failed to start alert for %s\n", beacon.name.c_str());
-        Serial.printf("   Check alert manager and hardware connections\n");
+        LOGE("❌ Failed to start alert for %s - check alert manager and hardware connections",
+             beacon.name.c_str());
     }
 }
 
@@ -2311,12 +3077,16 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
     switch(type) {
         case WStype_DISCONNECTED:
             Serial.printf("🔌 WebSocket client %u disconnected\n", num);
+            wsFanout.onDisconnect(num);
+            wsStreams.unsubscribe(num);
             break;
             
         case WStype_CONNECTED: {
             IPAddress ip = webSocket.remoteIP(num);
             Serial.printf("🔌 WebSocket client %u connected from %d.%d.%d.%d\n", 
                          num, ip[0], ip[1], ip[2], ip[3]);
+            wsFanout.onConnect(num);
+            wsStreams.unsubscribe(num);     // Slot may be reused without a disconnect event
             
             // Send initial status
             sendSystemStatus(num);
@@ -2324,7 +3094,7 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
         }
         
         case WStype_TEXT:
-            handleWebSocketMessage(String((char*)payload), num);
+            handleWebSocketMessage((char*)payload, length, num);
             break;
             
         default:
@@ -2334,111 +3104,52 @@ void webSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length
 
 /**
  * @brief Handle WebSocket message commands
- * @param message JSON message string
+ * @param message JSON message (parsed in place)
+ * @param length Message length
  * @param clientNum Client number
  */
-void handleWebSocketMessage(const String& message, uint8_t clientNum) {
-    DynamicJsonDocument doc(1024);
-    DeserializationError error = deserializeJson(doc, message);
-    
-    if (error) {
-        Serial.printf("❌ JSON parsing failed: %s\n", error.c_str());
+void handleWebSocketMessage(char* message, size_t length, uint8_t clientNum) {
+    CommandStatus status = commandRegistry.dispatchJson(CMD_SRC_WEBSOCKET, clientNum, message, length,
+                                                        "command");
+    if (status == CommandStatus::PARSE_ERROR) {
+        Serial.println("❌ JSON parsing failed");
         sendErrorResponse(clientNum, "Invalid JSON format");
-        return;
-    }
-    
-    String command = doc["command"];
-    Serial.printf("🎯 Executing command: %s\n", command.c_str());
-    
-    if (command == "get_status") {
-        sendSystemStatus(clientNum);
-    } else if (command == "test_buzzer") {
-        testAlert(AlertMode::BUZZER, clientNum);
-    } else if (command == "test_vibration") {
-        testAlert(AlertMode::VIBRATION, clientNum);
-    } else if (command == "stop_alert") {
-        alertManager.stopAlert();
-        sendCommandResponse(clientNum, command, "stopped");
-    } else if (command == "get_beacons") {
-        sendBeaconData(clientNum);
-    } else if (command == "update_beacon_config") {
-        handleBeaconConfigUpdate(doc, clientNum);
-    } else if (command == "debug_proximity_configs") {
-        // 🐛 DEBUG: List all proximity configurations
-        Serial.println("📋 === PROXIMITY CONFIGURATIONS ===");
-        
-        // This will help debug configuration issues
-        auto configs = beaconManager.getProximityConfigs();
-        if (configs.empty()) {
-            Serial.println("⚠️ No proximity configurations found!");
-        } else {
-            Serial.printf("📊 Found %d proximity configurations:\n", configs.size());
-            for (const auto& config : configs) {
-                Serial.printf("  🏷️ ID: %s\n", config.beaconId.c_str());
-                Serial.printf("     Name: %s\n", config.beaconName.c_str());
-                Serial.printf("     MAC: %s\n", config.macAddress.c_str());
-                Serial.printf("     Alert: %s (%d intensity)\n", config.alertMode.c_str(), config.alertIntensity);
-                Serial.printf("     Trigger: %dcm, Duration: %dms\n", config.triggerDistance, config.alertDuration);
-                Serial.printf("     Delay: %s (%dms), Cooldown: %dms\n", 
-                             config.enableProximityDelay ? "enabled" : "disabled", 
-                             config.proximityDelayTime, config.cooldownPeriod);
-                Serial.printf("     State: %s, In Range: %s\n", 
-                             config.alertActive ? "active" : "inactive",
-                             config.inProximityRange ? "yes" : "no");
-                Serial.println();
-            }
-        }
-        Serial.println("📋 === END CONFIGURATIONS ===");
-        sendCommandResponse(clientNum, command, "debug_complete");
-        
-    } else if (command == "list_detected_beacons") {
-        // 🐛 DEBUG: List all currently detected beacons
-        Serial.println("📡 === DETECTED BEACONS ===");
-        auto beacons = beaconManager.getActiveBeacons();
-        if (beacons.empty()) {
-            Serial.println("⚠️ No beacons currently detected!");
-        } else {
-            Serial.printf("📊 Found %d active beacons:\n", beacons.size());
-            for (const auto& beacon : beacons) {
-                Serial.printf("  📡 Name: %s\n", beacon.name.c_str());
-                Serial.printf("     Address: %s\n", beacon.address.c_str());
-                Serial.printf("     RSSI: %ddBm, Distance: %.1fcm\n", beacon.rssi, beacon.distance);
-                Serial.printf("     Confidence: %.1f%%, Active: %s\n", 
-                             beacon.confidence * 100, beacon.isActive ? "yes" : "no");
-                Serial.printf("     Last seen: %lums ago\n", millis() - beacon.lastSeen);
-                Serial.println();
-            }
-        }
-        Serial.println("📡 === END BEACONS ===");
-        sendCommandResponse(clientNum, command, "debug_complete");
-        
-    } else {
-        sendErrorResponse(clientNum, "Unknown command: " + command);
+    } else if (status != CommandStatus::OK) {
+        sendErrorResponse(clientNum, "Unknown command: " + String(commandRegistry.getLastName()));
     }
 }
 
 // ==================== HTTP HANDLERS ====================
 /**
- * @brief Handle root HTTP request
+ * @brief Plain-text banner for clients that do not accept gzip
  */
-void handleRoot() {
+String buildRootBanner() {
     String response = "ESP32-S3 Pet Collar - Refactored Firmware v" + String(FIRMWARE_VERSION);
     response += "\nFeatures: Multi-WiFi, Live Proximity Alerts, Advanced Configuration";
     response += "\nBuild: " + String(BUILD_DATE);
-    server.send(200, "text/plain", response);
+    return response;
 }
 
 /**
- * @brief Handle discovery API endpoint
+ * @brief Fill the discovery document served at /api/discover
+ *
+ * Configuration and network identity only: the body is hashed into its
+ * ETag, so anything that changes on its own (RSSI, clocks) belongs in
+ * /api/metrics instead.
  */
-void handleDiscover() {
-    DynamicJsonDocument doc(512);
+void buildDiscoverJson(JsonDocument& doc) {
+    IPAddress ip = WiFi.localIP();
+    char localIp[16];
+    char websocketUrl[32];
+    snprintf(localIp, sizeof(localIp), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    snprintf(websocketUrl, sizeof(websocketUrl), "ws://%s:8080", localIp);
+    
     doc["device"] = "petg_collar_refactored";
     doc["version"] = FIRMWARE_VERSION;
     doc["platform"] = HARDWARE_PLATFORM;
     doc["features"] = "multi_wifi,advanced_alerts,enhanced_ble,system_monitoring";
-    doc["local_ip"] = WiFi.localIP().toString();
-    doc["websocket_url"] = "ws://" + WiFi.localIP().toString() + ":8080";
+    doc["local_ip"] = localIp;
+    doc["websocket_url"] = websocketUrl;
     doc["websocket_port"] = 8080;
     doc["status"] = "active";
     doc["build_date"] = BUILD_DATE;
@@ -2446,65 +3157,318 @@ void handleDiscover() {
     if (currentNetworkIndex >= 0) {
         doc["current_network"] = wifiNetworks[currentNetworkIndex].location;
         doc["current_ssid"] = wifiNetworks[currentNetworkIndex].ssid;
-        doc["signal_strength"] = WiFi.RSSI();
     }
-    
-    String response;
-    serializeJson(doc, response);
-    server.send(200, "application/json", response);
 }
 
 /**
- * @brief Handle status API endpoint
+ * @brief Counters that change every poll, served uncached at /api/metrics
+ * @return Body length
  */
-void handleStatus() {
-    String statusJson = systemStateManager.getSystemStatusJSON();
-    server.send(200, "application/json", statusJson);
+size_t buildMetricsJson(char* body, size_t size) {
+    StaticJsonDocument<192> doc;
+    doc["uptime"] = millis();
+    doc["timestamp"] = millis();
+    doc["freeHeap"] = ESP.getFreeHeap();
+    if (WiFi.isConnected()) {
+        doc["signal_strength"] = WiFi.RSSI();
+    }
+    return serializeJson(doc, body, size);
 }
 
 /**
- * @brief Handle data API endpoint
+ * @brief Rebuild one cached API response
  */
-void handleData() {
-    sendSystemStatusBroadcast();
-    server.send(200, "application/json", "{\"status\":\"data_sent_via_websocket\"}");
+void refreshHttpSnapshot(HttpSnapshotId id, uint32_t now) {
+    char body[512];
+    size_t length;
+    if (id == HttpSnapshotId::STATUS) {
+        length = systemStateManager.getSystemStateJSON(body, sizeof(body));
+    } else {
+        StaticJsonDocument<512> doc;
+        buildDiscoverJson(doc);
+        length = serializeJson(doc, body, sizeof(body));
+    }
+    httpCache.update(id, body, length, now);
 }
 
-// ==================== UTILITY FUNCTIONS ====================
 /**
- * @brief Test alert system
- * @param mode Alert mode to test
- * @param clientNum WebSocket client number
+ * @brief Main loop: rebuild due API snapshots and run deferred /api/data requests
  */
-void testAlert(AlertMode mode, uint8_t clientNum) {
-    AlertConfig testConfig;
-    testConfig.mode = mode;
-    testConfig.intensity = 3;
-    testConfig.duration = 1000;
-    testConfig.reason = AlertReason::MANUAL_TEST;
-    
-    if (alertManager.triggerAlert(testConfig)) {
-        String modeStr = (mode == AlertMode::BUZZER) ? "buzzer" : "vibration";
-        sendCommandResponse(clientNum, "test_" + modeStr, "triggered");
-        Serial.printf("🧪 %s test triggered\n", modeStr.c_str());
-    } else {
-        sendErrorResponse(clientNum, "Alert test failed");
+void refreshHttpSnapshots() {
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < (uint8_t)HttpSnapshotId::COUNT; i++) {
+        HttpSnapshotId id = (HttpSnapshotId)i;
+        if (httpCache.needsRefresh(id, now)) {
+            refreshHttpSnapshot(id, now);
+        }
+    }
+    if (httpBroadcastRequested) {
+        httpBroadcastRequested = false;
+        sendSystemStatusBroadcast();
     }
 }
 
+#if FEATURE_ASYNC_WEBSERVER
 /**
- * @brief Send system status to WebSocket client
- * @param clientNum Client number (optional, -1 for broadcast)
+ * @brief Send a precompressed asset, or 304 if the client has it
  */
-void sendSystemStatus(uint8_t clientNum) {
-    String statusJson = systemStateManager.getSystemStatusJSON();
-    webSocket.sendTXT(clientNum, statusJson);
+void sendWebAsset(AsyncWebServerRequest* request, const WebAsset& asset) {
+    if (request->hasHeader("If-None-Match") &&
+        HttpSnapshotCache::etagMatches(asset.etag, request->header("If-None-Match").c_str())) {
+        request->send(304);
+        return;
+    }
+    AsyncWebServerResponse* response =
+        request->beginResponse_P(200, asset.contentType, asset.data, asset.length);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", "max-age=" + String(HTTP_ASSET_MAX_AGE_S));
+    request->send(response);
+}
+
+/**
+ * @brief Send a cached API response, or 304 if its ETag matches
+ *
+ * Runs on the AsyncTCP task: the body is copied into the response before
+ * the snapshot is released, since the response is sent after this returns.
+ */
+void sendSnapshot(AsyncWebServerRequest* request, HttpSnapshotId id) {
+    HttpSnapshot* snapshot = httpCache.acquire(id, millis());
+    if (!snapshot) {
+        request->send(503, "application/json", "{\"error\":\"starting\"}");
+        return;
+    }
+    bool notModified = request->hasHeader("If-None-Match") &&
+        HttpSnapshotCache::etagMatches(snapshot->etag, request->header("If-None-Match").c_str());
+    AsyncWebServerResponse* response = notModified
+        ? request->beginResponse(304)
+        : request->beginResponse(200, "application/json", String(snapshot->data));
+    response->addHeader("ETag", snapshot->etag);
+    response->addHeader("Cache-Control", "no-cache");
+    httpCache.countServed(notModified);
+    httpCache.release(snapshot);
+    request->send(response);
+}
+
+/**
+ * @brief Handle root HTTP request
+ */
+void handleRoot(AsyncWebServerRequest* request) {
+    if (request->hasHeader("Accept-Encoding") &&
+        strstr(request->header("Accept-Encoding").c_str(), "gzip")) {
+        sendWebAsset(request, WEB_ASSETS[0]);
+    } else {
+        request->send(200, "text/plain", buildRootBanner());
+    }
+}
+
+/**
+ * @brief Handle discovery API endpoint
+ */
+void handleDiscover(AsyncWebServerRequest* request) {
+    sendSnapshot(request, HttpSnapshotId::DISCOVER);
+}
+
+/**
+ * @brief Handle status API endpoint
+ */
+void handleStatus(AsyncWebServerRequest* request) {
+    sendSnapshot(request, HttpSnapshotId::STATUS);
+}
+
+/**
+ * @brief Handle metrics API endpoint (built per request, never cached)
+ */
+void handleMetrics(AsyncWebServerRequest* request) {
+    char body[192];
+    buildMetricsJson(body, sizeof(body));
+    AsyncWebServerResponse* response = request->beginResponse(200, "application/json", body);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+/**
+ * @brief Handle data API endpoint (the broadcast runs on the next loop pass)
+ */
+void handleData(AsyncWebServerRequest* request) {
+    httpBroadcastRequested = true;
+    request->send(200, "application/json", "{\"status\":\"data_sent_via_websocket\"}");
+}
+#else
+/**
+ * @brief Send a precompressed asset, or 304 if the client has it
+ */
+void sendWebAsset(const WebAsset& asset) {
+    server.sendHeader("ETag", asset.etag);
+    server.sendHeader("Cache-Control", "max-age=" + String(HTTP_ASSET_MAX_AGE_S));
+    if (HttpSnapshotCache::etagMatches(asset.etag, server.header("If-None-Match").c_str())) {
+        server.send(304);
+        return;
+    }
+    server.sendHeader("Content-Encoding", "gzip");
+    server.send_P(200, asset.contentType, (const char*)asset.data, asset.length);
+}
+
+/**
+ * @brief Send a cached API response, or 304 if its ETag matches
+ */
+void sendSnapshot(HttpSnapshotId id) {
+    uint32_t now = millis();
+    httpCache.markRequested(id, now);
+    if (httpCache.needsRefresh(id, now)) {
+        refreshHttpSnapshot(id, now);
+    }
+    HttpSnapshot* snapshot = httpCache.acquire(id, now);
+    if (!snapshot) {
+        server.send(503, "application/json", "{\"error\":\"starting\"}");
+        return;
+    }
+    bool notModified = HttpSnapshotCache::etagMatches(snapshot->etag,
+                                                      server.header("If-None-Match").c_str());
+    server.sendHeader("ETag", snapshot->etag);
+    server.sendHeader("Cache-Control", "no-cache");
+    if (notModified) {
+        server.send(304);
+    } else {
+        server.send_P(200, "application/json", snapshot->data, snapshot->length);
+    }
+    httpCache.countServed(notModified);
+    httpCache.release(snapshot);
+}
+
+/**
+ * @brief Handle root HTTP request
+ */
+void handleRoot() {
+    if (strstr(server.header("Accept-Encoding").c_str(), "gzip")) {
+        sendWebAsset(WEB_ASSETS[0]);
+    } else {
+        server.send(200, "text/plain", buildRootBanner());
+    }
+}
+
+/**
+ * @brief Handle discovery API endpoint
+ */
+void handleDiscover() {
+    sendSnapshot(HttpSnapshotId::DISCOVER);
+}
+
+/**
+ * @brief Handle status API endpoint
+ */
+void handleStatus() {
+    sendSnapshot(HttpSnapshotId::STATUS);
+}
+
+/**
+ * @brief Handle metrics API endpoint (built per request, never cached)
+ */
+void handleMetrics() {
+    char body[192];
+    size_t length = buildMetricsJson(body, sizeof(body));
+    server.sendHeader("Cache-Control", "no-store");
+    server.send_P(200, "application/json", body, length);
+}
+
+/**
+ * @brief Handle data API endpoint
+ */
+void handleData() {
+    sendSystemStatusBroadcast();
+    server.send(200, "application/json", "{\"status\":\"data_sent_via_websocket\"}");
+}
+#endif
+
+// ==================== UTILITY FUNCTIONS ====================
+/**
+ * @brief Test alert system
+ * @param mode Alert mode to test
+ * @param ctx Command that asked for the test
+ */
+void testAlert(AlertMode mode, const CommandContext& ctx) {
+    AlertConfig testConfig;
+    testConfig.mode = mode;
+    testConfig.intensity = 3;
+    testConfig.duration = 1000;
+    testConfig.reason = AlertReason::MANUAL_TEST;
+    
+    if (alertManager.triggerAlert(testConfig)) {
+        String modeStr = (mode == AlertMode::BUZZER) ? "buzzer" : "vibration";
+        replyCommand(ctx, "triggered");
+        Serial.printf("🧪 %s test triggered\n", modeStr.c_str());
+    } else {
+        replyCommandError(ctx, "Alert test failed");
+    }
+}
+
+/**
+ * @brief WsFanout transport: send one queued frame
+ */
+bool sendWebSocketFrame(uint8_t clientNum, const char* data, size_t length, void* context) {
+    return webSocket.sendTXT(clientNum, data, length);
+}
+
+/**
+ * @brief WsFanout transport: close a client that keeps stalling sends
+ */
+void dropSlowWebSocketClient(uint8_t clientNum, void* context) {
+    Serial.printf("🐢 WebSocket client %u too slow - disconnecting\n", clientNum);
+    webSocket.disconnect(clientNum);
+}
+
+/**
+ * @brief Queue a frame for one client, or for all clients
+ * @param clientNum Client number (-1 for broadcast)
+ * @param frame Frame from wsFanout.createFrame() (ownership passes to the fan-out)
+ */
+void queueWebSocketFrame(int clientNum, WsFrame* frame) {
+    if (!frame) {
+        Serial.println("❌ WebSocket frame allocation failed");
+        return;
+    }
+    if (clientNum < 0) {
+        wsFanout.broadcast(frame);
+    } else {
+        wsFanout.send((uint8_t)clientNum, frame);
+    }
+}
+
+/**
+ * @brief Serialize a JSON document once into a queued frame
+ * @param clientNum Client number (-1 for broadcast)
+ */
+void queueWebSocketJson(int clientNum, WsFrameKind kind, const JsonDocument& doc) {
+    size_t length = measureJson(doc);
+    WsFrame* frame = wsFanout.createFrame(kind, length);
+    if (frame) {
+        serializeJson(doc, frame->data, length + 1);
+    }
+    queueWebSocketFrame(clientNum, frame);
+}
+
+/**
+ * @brief Send system status to WebSocket client
+ * @param clientNum Client number (optional, -1 for broadcast)
+ */
+void sendSystemStatus(uint8_t clientNum) {
+    String statusJson = systemStateManager.getSystemStatusJSON();
+    queueWebSocketFrame(clientNum, wsFanout.createFrame(WsFrameKind::STATUS, statusJson.c_str(),
+                                                        statusJson.length()));
 }
 
 // Add overload for broadcast
 void sendSystemStatusBroadcast() {
+    // Stream subscribers get their feeds instead of the periodic full status
+    uint8_t legacyClients = wsFanout.getClientMask() & ~wsStreams.getSubscriberMask();
+    if (legacyClients == 0) return;
+    
     String statusJson = systemStateManager.getSystemStatusJSON();
-    webSocket.broadcastTXT(statusJson);
+    WsFrame* frame = wsFanout.createFrame(WsFrameKind::STATUS, statusJson.c_str(),
+                                          statusJson.length());
+    if (frame) {
+        wsFanout.multicast(legacyClients, frame);
+    }
 }
 
 /**
@@ -2513,7 +3477,8 @@ void sendSystemStatusBroadcast() {
  */
 void sendBeaconData(uint8_t clientNum) {
     String beaconJson = beaconManager.getBeaconDataJSON();
-    webSocket.sendTXT(clientNum, beaconJson);
+    queueWebSocketFrame(clientNum, wsFanout.createFrame(WsFrameKind::BEACONS, beaconJson.c_str(),
+                                                        beaconJson.length()));
 }
 
 /**
@@ -2523,15 +3488,13 @@ void sendBeaconData(uint8_t clientNum) {
  * @param status Status result
  */
 void sendCommandResponse(uint8_t clientNum, const String& command, const String& status) {
-    DynamicJsonDocument doc(256);
+    StaticJsonDocument<256> doc;
     doc["type"] = "response";
     doc["command"] = command;
     doc["status"] = status;
     doc["timestamp"] = millis();
     
-    String response;
-    serializeJson(doc, response);
-    webSocket.sendTXT(clientNum, response);
+    queueWebSocketJson(clientNum, WsFrameKind::RESPONSE, doc);
 }
 
 /**
@@ -2540,27 +3503,74 @@ void sendCommandResponse(uint8_t clientNum, const String& command, const String&
  * @param message Error message
  */
 void sendErrorResponse(uint8_t clientNum, const String& message) {
-    DynamicJsonDocument doc(256);
+    StaticJsonDocument<256> doc;
     doc["type"] = "error";
     doc["message"] = message;
     doc["timestamp"] = millis();
     
-    String response;
-    serializeJson(doc, response);
-    webSocket.sendTXT(clientNum, response);
+    queueWebSocketJson(clientNum, WsFrameKind::RESPONSE, doc);
 }
 
 /**
  * @brief Handle beacon configuration updates
- * @param doc JSON document with update data
- * @param clientNum WebSocket client number
+ * @param ctx Command with the update data in args
  */
-void handleBeaconConfigUpdate(const DynamicJsonDocument& doc, uint8_t clientNum) {
-    String beaconId = doc["beacon_id"];
+void handleBeaconConfigUpdate(const CommandContext& ctx) {
+    String beaconId = ctx.args["beacon_id"] | "";
     // Skip config processing for now to avoid ArduinoJson v7 issues
     
     Serial.printf("✅ Beacon config update request: %s\n", beaconId.c_str());
-    sendCommandResponse(clientNum, "update_beacon_config", "received");
+    replyCommand(ctx, "received");
+}
+
+/**
+ * @brief Handle a live stream subscription
+ * @param ctx Command with args {"streams":{"<name>":<min interval ms>,...}}
+ */
+void handleStreamSubscribe(const CommandContext& ctx) {
+    uint8_t clientNum = ctx.clientNum;
+    JsonObjectConst streams = ctx.args["streams"].as<JsonObjectConst>();
+    if (streams.isNull()) {
+        replyCommandError(ctx, "subscribe needs a streams object");
+        return;
+    }
+    
+    uint8_t mask = 0;
+    uint16_t intervals[(uint8_t)WsStream::COUNT] = {0};
+    for (JsonPairConst stream : streams) {
+        WsStream id = wsStreamFromString(stream.key().c_str());
+        if (id == WsStream::COUNT) {
+            replyCommandError(ctx, String("Unknown stream: ") + stream.key().c_str());
+            return;
+        }
+        uint32_t intervalMs = stream.value().as<uint32_t>();
+        mask |= WS_STREAM_BIT(id);
+        intervals[(uint8_t)id] = (uint16_t)min(intervalMs, (uint32_t)WS_STREAM_MAX_INTERVAL_MS);
+    }
+    
+    wsStreams.subscribe(clientNum, mask, intervals);
+    Serial.printf("📡 WebSocket client %u subscribed to streams 0x%02X\n", clientNum, mask);
+    replyCommand(ctx, mask ? "subscribed" : "unsubscribed");
+}
+
+/**
+ * @brief Feed position and zone into the live streams and send due frames
+ */
+void updateWebSocketStreams() {
+    if (wsStreams.getSubscriberMask() == 0) return;
+    
+    bool hasFix = triangulator.isReady();
+    if (hasFix) {
+        auto lastPos = triangulator.getLastPosition();
+        wsStreams.updatePosition(true, lastPos.position.x, lastPos.position.y,
+                                 lastPos.confidence, lastPos.accuracy);
+    } else {
+        wsStreams.updatePosition(false, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    char currentZone[WS_STREAM_NAME_LENGTH];
+    zoneManager.getCurrentZone(currentZone, sizeof(currentZone));
+    wsStreams.updateZone(currentZone);
+    wsStreams.poll(millis());
 }
 
 /**
@@ -2569,7 +3579,7 @@ void handleBeaconConfigUpdate(const DynamicJsonDocument& doc, uint8_t clientNum)
  * @param beacon Beacon data
  */
 void broadcastAlertStatus(const BeaconConfig& config, const BeaconData& beacon) {
-    DynamicJsonDocument doc(512);
+    StaticJsonDocument<512> doc;
     doc["type"] = "proximity_alert";
     doc["beacon_id"] = config.id;
     doc["beacon_name"] = beacon.name;
@@ -2578,9 +3588,18 @@ void broadcastAlertStatus(const BeaconConfig& config, const BeaconData& beacon)
     doc["intensity"] = config.alertIntensity;
     doc["timestamp"] = millis();
     
-    String message;
-    serializeJson(doc, message);
-    webSocket.broadcastTXT(message);
+    wsStreams.publishAlert(beacon.name.c_str(), beacon.distance, config.alertMode.c_str());
+    
+    // Stream subscribers get the compact alert frame instead
+    uint8_t legacyClients = wsFanout.getClientMask() & ~wsStreams.getSubscriberMask();
+    if (legacyClients == 0) return;
+    
+    size_t length = measureJson(doc);
+    WsFrame* frame = wsFanout.createFrame(WsFrameKind::ALERT, length);
+    if (frame) {
+        serializeJson(doc, frame->data, length + 1);
+        wsFanout.multicast(legacyClients, frame);
+    }
 }
 
 /**
@@ -2656,6 +3675,27 @@ void performSystemMaintenance() {
     // Update battery status
     systemStateManager.updateBatteryStatus();
     
+    // Battery alerts are low priority (critical preempts everything); the
+    // arbiter's battery cooldown keeps them from repeating every check
+    int batteryPercent = systemStateManager.getBatteryPercent();
+    
+    static const char* const batteryBands[] = {"normal", "low", "critical"};
+    static uint8_t lastBatteryBand = 0;
+    uint8_t batteryBand = batteryPercent <= ALERT_CRITICAL_BATTERY_PERCENT ? 2 :
+                          batteryPercent <= ALERT_LOW_BATTERY_PERCENT ? 1 : 0;
+    if (batteryBand != lastBatteryBand) {
+        publishTransitionEvent("battery", batteryBands[lastBatteryBand], batteryBands[batteryBand]);
+        lastBatteryBand = batteryBand;
+    }
+    
+    if (batteryPercent <= ALERT_CRITICAL_BATTERY_PERCENT) {
+        alertManager.startAlert(AlertReason::CRITICAL_BATTERY, AlertMode::BOTH,
+                                (int)AlertPattern::SOS_PATTERN);
+    } else if (batteryPercent <= ALERT_LOW_BATTERY_PERCENT) {
+        alertManager.startAlert(AlertReason::LOW_BATTERY, AlertMode::BUZZER,
+                                (int)AlertPattern::TRIPLE_BEEP);
+    }
+    
     // Check system health
     if (systemStateManager.getErrorCount() > 10) {
         Serial.println("⚠️ High error count detected, performing system recovery...");
@@ -2692,25 +3732,19 @@ void printSystemStatus() {
 
 // ==================== BUZZER TEST FUNCTION ====================
 /**
- * @brief Test buzzer on GPIO 18 with tone() function
+ * @brief Test buzzer on GPIO 18 with a single-tone engine pattern
  * @param frequency Frequency in Hz (default 2000)
  * @param duration Duration in milliseconds (default 500)
  */
 void testBuzzer(int frequency = 2000, int duration = 500) {
     Serial.printf("🔊 Testing buzzer on GPIO %d: %dHz for %dms\n", BUZZER_PIN, frequency, duration);
     
-    // Method 1: Using ESP32 tone() function
-    tone(BUZZER_PIN, frequency, duration);
-    delay(duration + 100);
-    
-    // Method 2: Using LEDC for confirmation (ESP32 Arduino Core 3.x compatible)
-    ledcAttach(BUZZER_PIN, frequency, 8);  // pin, frequency, resolution
-    ledcWrite(BUZZER_PIN, 128); // 50% duty cycle
-    delay(duration);
-    ledcWrite(BUZZER_PIN, 0);   // Turn off
-    ledcDetach(BUZZER_PIN);
-    
-    Serial.printf("✅ Buzzer test complete on GPIO %d\n", BUZZER_PIN);
+    // Played through the alert pattern engine so LEDC stays attached to it
+    if (alertManager.playTone(frequency, duration)) {
+        Serial.printf("✅ Buzzer test started on GPIO %d\n", BUZZER_PIN);
+    } else {
+        Serial.printf("❌ Buzzer test failed on GPIO %d\n", BUZZER_PIN);
+    }
 }
 
 // ==================== RSSI SMOOTHING INTERFACE ====================
@@ -2757,13 +3791,965 @@ void printGlobalRSSIStats() {
     printRSSISmootherStats();
 }
 
+// ==================== COMMAND HANDLERS ====================
+// One handler per command, shared by WebSocket, MQTT and serial through
+// commandRegistry. JSON arguments arrive in ctx.args, serial plain-text
+// arguments in ctx.text.
+
+/**
+ * @brief Answer a command on the channel it came from
+ * @param ctx Command context
+ * @param status Status result
+ */
+void replyCommand(const CommandContext& ctx, const char* status) {
+    if (ctx.source == CMD_SRC_WEBSOCKET) {
+        sendCommandResponse(ctx.clientNum, ctx.name, status);
+    } else if (ctx.source == CMD_SRC_SERIAL) {
+        Serial.printf("✅ %s: %s\n", ctx.name, status);
+    }
+}
+
+/**
+ * @brief Report a command failure on the channel it came from
+ * @param ctx Command context
+ * @param message Error message
+ */
+void replyCommandError(const CommandContext& ctx, const String& message) {
+    if (ctx.source == CMD_SRC_WEBSOCKET) {
+        sendErrorResponse(ctx.clientNum, message);
+    } else {
+        Serial.printf("❌ %s: %s\n", ctx.name, message.c_str());
+    }
+}
+
+void cmdGetStatus(const CommandContext& ctx) {
+    sendSystemStatus(ctx.clientNum);
+}
+
+void cmdGetBeacons(const CommandContext& ctx) {
+    sendBeaconData(ctx.clientNum);
+}
+
+void cmdTestBuzzerAlert(const CommandContext& ctx) {
+    testAlert(AlertMode::BUZZER, ctx);
+}
+
+void cmdTestVibrationAlert(const CommandContext& ctx) {
+    testAlert(AlertMode::VIBRATION, ctx);
+}
+
+void cmdStopAlert(const CommandContext& ctx) {
+    alertManager.stopAlert();
+    replyCommand(ctx, "stopped");
+}
+
+void cmdUpdateBeaconConfig(const CommandContext& ctx) {
+    handleBeaconConfigUpdate(ctx);
+}
+
+void cmdSubscribe(const CommandContext& ctx) {
+    handleStreamSubscribe(ctx);
+}
+
+void cmdUnsubscribe(const CommandContext& ctx) {
+    wsStreams.unsubscribe(ctx.clientNum);
+    replyCommand(ctx, "unsubscribed");
+}
+
+void cmdDebugProximityConfigs(const CommandContext& ctx) {
+    // 🐛 DEBUG: List all proximity configurations
+    Serial.println("📋 === PROXIMITY CONFIGURATIONS ===");
+
+    // This will help debug configuration issues
+    auto configs = beaconManager.getProximityConfigs();
+    if (configs.empty()) {
+        Serial.println("⚠️ No proximity configurations found!");
+    } else {
+        Serial.printf("📊 Found %d proximity configurations:\n", configs.size());
+        for (const auto& config : configs) {
+            Serial.printf("  🏷️ ID: %s\n", config.beaconId.c_str());
+            Serial.printf("     Name: %s\n", config.beaconName.c_str());
+            Serial.printf("     MAC: %s\n", config.macAddress.c_str());
+            Serial.printf("     Alert: %s (%d intensity)\n", config.alertMode.c_str(), config.alertIntensity);
+            Serial.printf("     Trigger: %dcm, Duration: %dms\n", config.triggerDistance, config.alertDuration);
+            Serial.printf("     Delay: %s (%dms), Cooldown: %dms\n",
+                         config.enableProximityDelay ? "enabled" : "disabled",
+                         config.proximityDelayTime, config.cooldownPeriod);
+            Serial.printf("     State: %s, In Range: %s\n",
+                         config.alertActive ? "active" : "inactive",
+                         config.inProximityRange ? "yes" : "no");
+            Serial.println();
+        }
+    }
+    Serial.println("📋 === END CONFIGURATIONS ===");
+    replyCommand(ctx, "debug_complete");
+}
+
+void cmdListDetectedBeacons(const CommandContext& ctx) {
+    // 🐛 DEBUG: List all currently detected beacons
+    Serial.println("📡 === DETECTED BEACONS ===");
+    auto beacons = beaconManager.getActiveBeacons();
+    if (beacons.empty()) {
+        Serial.println("⚠️ No beacons currently detected!");
+    } else {
+        Serial.printf("📊 Found %d active beacons:\n", beacons.size());
+        for (const auto& beacon : beacons) {
+            Serial.printf("  📡 Name: %s\n", beacon.name.c_str());
+            Serial.printf("     Address: %s\n", beacon.address.c_str());
+            Serial.printf("     RSSI: %ddBm, Distance: %.1fcm\n", beacon.rssi, beacon.distance);
+            Serial.printf("     Confidence: %.1f%%, Active: %s\n",
+                         beacon.confidence * 100, beacon.isActive ? "yes" : "no");
+            Serial.printf("     Last seen: %lums ago\n", millis() - beacon.lastSeen);
+            Serial.println();
+        }
+    }
+    Serial.println("📡 === END BEACONS ===");
+    replyCommand(ctx, "debug_complete");
+}
+
+void cmdBuzz(const CommandContext& ctx) {
+    int duration = ctx.args["duration_ms"] | 3000;
+    String pattern = ctx.args["pattern"] | "pulse";
+
+    // Use existing alert system with cloud command
+    alertManager.startAlert(AlertReason::REMOTE_COMMAND, AlertMode::BUZZER);
+    Serial.printf("🔊 Cloud buzzer command: %dms, pattern: %s\n", duration, pattern.c_str());
+}
+
+void cmdZone(const CommandContext& ctx) {
+    String action = ctx.args["action"] | "status";
+
+    if (action == "list") {
+        // Publish zone information using existing ZoneManager
+        publishZoneStatus();
+    } else if (action == "alert") {
+        String zoneId = ctx.args["zone_id"] | "";
+        alertManager.startAlert(AlertReason::ZONE_BREACH, AlertMode::BOTH,
+                                (int)AlertPattern::PULSE_FAST);
+    }
+}
+
+void cmdLocate(const CommandContext& ctx) {
+    // Trigger location beacon using existing triangulator
+    alertManager.startAlert(AlertReason::LOCATE_REQUEST, AlertMode::BOTH);
+    publishCurrentLocation();
+}
+
+void cmdTestAlert(const CommandContext& ctx) {
+    String alertMode = ctx.args["alertMode"] | "buzzer";
+    int durationMs = ctx.args["durationMs"] | 1200;
+    int intensity = ctx.args["intensity"] | 128;
+
+    Serial.printf("🧪 Test Alert Command: mode=%s, duration=%dms, intensity=%d, pin=%d\n",
+                 alertMode.c_str(), durationMs, intensity, BUZZER_PIN);
+
+    // Map alert mode to AlertMode enum
+    AlertMode mode = AlertMode::BUZZER;
+    if (alertMode == "vibration") {
+        mode = AlertMode::VIBRATION;
+    } else if (alertMode == "both") {
+        mode = AlertMode::BOTH;
+    }
+
+    // Trigger alert with the requested duration and intensity; the
+    // pattern engine times it without blocking the main loop
+    AlertConfig testConfig;
+    testConfig.mode = mode;
+    testConfig.intensity = constrain(intensity, 0, 255);
+    testConfig.duration = constrain(durationMs, 1, 65535);
+    testConfig.reason = AlertReason::REMOTE_COMMAND;
+    alertManager.triggerAlert(testConfig);
+}
+
+void cmdSetTelemetryFormat(const CommandContext& ctx) {
+    String format = ctx.args["format"] | "json";
+    if (format == "cbor") {
+        setTelemetryFormat(TelemetryFormat::CBOR);
+    } else if (format == "json") {
+        setTelemetryFormat(TelemetryFormat::JSON);
+    } else {
+        Serial.printf("❌ Unknown telemetry format: %s\n", format.c_str());
+    }
+}
+
+void cmdTelemetryKeyframe(const CommandContext& ctx) {
+    // Backend lost track of this device's state (sequence gap)
+    telemetryDelta.requestKeyframe();
+}
+
+void cmdSetTelemetryDelta(const CommandContext& ctx) {
+    TelemetryDeadbands deadbands = telemetryDelta.getDeadbands();
+    deadbands.rssiDbm = ctx.args["rssi_dbm"] | deadbands.rssiDbm;
+    deadbands.heapBytes = ctx.args["heap_bytes"] | deadbands.heapBytes;
+    deadbands.positionM = ctx.args["position_m"] | deadbands.positionM;
+    deadbands.confidence = ctx.args["confidence"] | deadbands.confidence;
+    telemetryDelta.setDeadbands(deadbands);
+
+    CollarSettings& settings = collarSettings.edit(millis());
+    settings.deadbandRssiDbm = deadbands.rssiDbm;
+    settings.deadbandHeapBytes = deadbands.heapBytes;
+    settings.deadbandPositionM = deadbands.positionM;
+    settings.deadbandConfidence = deadbands.confidence;
+    if (ctx.args.containsKey("keyframe_interval")) {
+        settings.keyframeInterval = ctx.args["keyframe_interval"] | TELEMETRY_KEYFRAME_INTERVAL;
+        settings.keyframeMaxMs = ctx.args["keyframe_max_ms"] | TELEMETRY_KEYFRAME_MAX_MS;
+        telemetryDelta.setKeyframeInterval(settings.keyframeInterval, settings.keyframeMaxMs);
+    }
+    Serial.printf("📦 Telemetry deadbands: RSSI %u dBm, heap %lu B, position %.2f m\n",
+                 deadbands.rssiDbm, (unsigned long)deadbands.heapBytes, deadbands.positionM);
+}
+
+/**
+ * @brief Add or update one proximity beacon from its dashboard JSON
+ *
+ * An existing config is updated in place, so its cooldown and in-range
+ * state carry on.
+ */
+void applyProximityBeacon(JsonObjectConst beacon) {
+    // Extract exact transmitter settings
+    String beaconId = beacon["id"] | "";
+    String beaconName = beacon["name"] | "";
+    String macAddress = beacon["macAddress"] | "";
+    String alertMode = beacon["alertMode"] | "buzzer";
+
+    int triggerDistance = beacon["triggerDistance"] | 5;     // cm
+    int alertDuration = beacon["alertDuration"] | 2000;     // ms
+    int alertIntensity = beacon["alertIntensity"] | 3;      // 1-5
+    bool enableProximityDelay = beacon["enableProximityDelay"] | false;
+    int proximityDelayTime = beacon["proximityDelayTime"] | 0; // ms
+    int cooldownPeriod = beacon["cooldownPeriod"] | 5000;   // ms
+
+    // Configure the beacon manager with exact settings
+    beaconManager.configureProximityBeacon(
+        beaconId,
+        beaconName,
+        macAddress,
+        alertMode,
+        triggerDistance,
+        alertDuration,
+        alertIntensity,
+        enableProximityDelay,
+        proximityDelayTime,
+        cooldownPeriod
+    );
+}
+
+void cmdConfigureBeacon(const CommandContext& ctx) {
+    // 🚀 PROXIMITY-BASED BEACON CONFIGURATION
+    Serial.println("📡 Received beacon configuration from transmitter");
+
+    if (ctx.args.containsKey("beacon")) {
+        JsonObjectConst beacon = ctx.args["beacon"].as<JsonObjectConst>();
+        applyProximityBeacon(beacon);
+        saveProximitySettings();
+        publishProximityState("ok");
+
+        Serial.printf("✅ Configured beacon '%s' - Distance: %dcm, Duration: %dms, Intensity: %d\n",
+                     (const char*)(beacon["name"] | ""), beacon["triggerDistance"] | 5,
+                     beacon["alertDuration"] | 2000, beacon["alertIntensity"] | 3);
+        if (beacon["enableProximityDelay"] | false) {
+            Serial.printf("   Proximity delay: %dms, Cooldown: %dms\n",
+                         beacon["proximityDelayTime"] | 0, beacon["cooldownPeriod"] | 5000);
+        }
+    }
+}
+
+void cmdConfigureBeaconsBatch(const CommandContext& ctx) {
+    // 🚀 BATCH BEACON CONFIGURATION
+    Serial.println("📡 Received batch beacon configuration from transmitter");
+
+    if (ctx.args.containsKey("beacons") && ctx.args["beacons"].is<JsonArrayConst>()) {
+        JsonArrayConst beacons = ctx.args["beacons"].as<JsonArrayConst>();
+        int configuredCount = 0;
+
+        // Drop only the beacons missing from the batch; the rest are updated
+        // in place so active cooldowns are not reset
+        const std::vector<ProximityBeaconConfig>& configs = beaconManager.getProximityConfigs();
+        for (size_t i = configs.size(); i-- > 0; ) {
+            String beaconId = configs[i].beaconId;
+            bool kept = false;
+            for (JsonObjectConst beacon : beacons) {
+                if (beaconId == (beacon["id"] | "")) {
+                    kept = true;
+                    break;
+                }
+            }
+            if (!kept) {
+                beaconManager.removeProximityBeacon(beaconId);
+            }
+        }
+
+        for (JsonObjectConst beacon : beacons) {
+            applyProximityBeacon(beacon);
+            configuredCount++;
+        }
+        saveProximitySettings();
+        publishProximityState("ok");
+
+        Serial.printf("✅ Configured %d proximity beacons from transmitter\n", configuredCount);
+    }
+}
+
+void cmdProximitySync(const CommandContext& ctx) {
+    // Delta from the dashboard: {"base":"<set hash>","upsert":[...],"remove":["id",...],"hash":"<expected>"}
+    char current[9];
+    snprintf(current, sizeof(current), "%08lx", (unsigned long)proximitySetHash(collarSettings.get()));
+    const char* base = ctx.args["base"] | "";
+    if (base[0] && strcasecmp(base, current) != 0) {
+        Serial.printf("⚠️ Proximity delta is against %s, collar has %s - full resync needed\n", base, current);
+        publishProximityState("resync");
+        return;
+    }
+
+    uint8_t removed = 0;
+    uint8_t upserted = 0;
+    for (JsonVariantConst beaconId : ctx.args["remove"].as<JsonArrayConst>()) {
+        if (beaconManager.removeProximityBeacon(beaconId | "")) {
+            removed++;
+        }
+    }
+    for (JsonObjectConst beacon : ctx.args["upsert"].as<JsonArrayConst>()) {
+        applyProximityBeacon(beacon);
+        upserted++;
+    }
+    if (removed > 0 || upserted > 0) {
+        saveProximitySettings();
+    }
+
+    snprintf(current, sizeof(current), "%08lx", (unsigned long)proximitySetHash(collarSettings.get()));
+    const char* expected = ctx.args["hash"] | "";
+    bool matched = !expected[0] || strcasecmp(expected, current) == 0;
+    Serial.printf("%s Proximity sync: %u updated, %u removed, set %s%s\n", matched ? "✅" : "⚠️",
+                 upserted, removed, current, matched ? "" : " (dashboard expected another set)");
+    publishProximityState(matched ? "ok" : "mismatch");
+}
+
+void cmdProximityState(const CommandContext& ctx) {
+    const CollarSettings& settings = collarSettings.get();
+    Serial.printf("📋 Proximity set %08lx, %u configs\n",
+                 (unsigned long)proximitySetHash(settings), settings.proximityCount);
+    for (uint8_t i = 0; i < settings.proximityCount; i++) {
+        Serial.printf("   %08lx %s (%s)\n", (unsigned long)proximitySettingHash(settings.proximity[i]),
+                     settings.proximity[i].beaconId, settings.proximity[i].beaconName);
+    }
+    publishProximityState("report");
+}
+
+void cmdRssiTest(const CommandContext& ctx) {
+    Serial.println("🧪 Running RSSI smoother unit tests...");
+    runRSSISmootherTests();
+}
+
+void cmdPerf(const CommandContext& ctx) {
+    if (ctx.source == CMD_SRC_MQTT) {
+        publishPerfReport();
+        return;
+    }
+    if (strcmp(ctx.text, "reset") == 0) {
+        systemStateManager.resetPerformanceStats();
+        Serial.println("⏱️ Loop timing reset");
+        return;
+    }
+    
+    const PerformanceMetrics& performance = systemStateManager.getSystemStatus().performance;
+    Serial.printf("⏱️ Loop: %lu passes, avg %lu us, max %lu us\n",
+                 (unsigned long)performance.loopIterations, (unsigned long)performance.averageLoopTimeUs,
+                 (unsigned long)performance.maxLoopTimeUs);
+    Serial.printf("   Stages over the last %lu s:\n", (millis() - loopProfiler.getWindowStartMs()) / 1000);
+    Serial.println("   stage            count     p50 us     p99 us     max us");
+    for (uint8_t i = 0; i < (uint8_t)PerfStage::COUNT; i++) {
+        PerfSummary summary = loopProfiler.summarize((PerfStage)i);
+        if (summary.count == 0) {
+            continue;
+        }
+        Serial.printf("   %-12s %9lu %10.1f %10.1f %10.1f\n", perfStageToString((PerfStage)i),
+                     (unsigned long)summary.count, summary.p50Us, summary.p99Us, summary.maxUs);
+    }
+}
+
+void cmdPerfTest(const CommandContext& ctx) {
+    runLoopProfilerTests();
+}
+
+void cmdHeap(const CommandContext& ctx) {
+    if (ctx.source == CMD_SRC_MQTT) {
+        publishHeapReport();
+        return;
+    }
+#if FEATURE_MEMORY_PROFILING
+    if (strcmp(ctx.text, "reset") == 0) {
+        heapProfiler.resetWindow(millis());
+        Serial.println("🧠 Allocation window reset");
+        return;
+    }
+#endif
+    
+    HeapSummary heap = readHeapSummary();
+    Serial.printf("🧠 Heap: %lu free (min %lu), largest block %lu, %u%% fragmented\n",
+                 (unsigned long)heap.freeBytes, (unsigned long)heap.minFreeBytes,
+                 (unsigned long)heap.largestFreeBlock, heap.fragmentation);
+#if FEATURE_MEMORY_PROFILING
+    Serial.printf("   %lu blocks tracked, %lu untracked allocs, %lu untracked frees\n",
+                 (unsigned long)heapProfiler.getTrackedBlocks(), (unsigned long)heapProfiler.getUntrackedAllocs(),
+                 (unsigned long)heapProfiler.getUntrackedFrees());
+    Serial.printf("   Allocations over the last %lu s:\n", (millis() - heapProfiler.getWindowStartMs()) / 1000);
+    Serial.println("   tag          live bytes  blocks  peak bytes   allocs  alloc bytes");
+    for (uint8_t i = 0; i < (uint8_t)HeapTag::COUNT; i++) {
+        HeapTagStats stats = heapProfiler.getTagStats((HeapTag)i);
+        if (stats.liveBlocks == 0 && stats.allocs == 0) {
+            continue;
+        }
+        Serial.printf("   %-10s %12lu %7lu %11lu %8lu %12lu\n", heapTagToString((HeapTag)i),
+                     (unsigned long)stats.liveBytes, (unsigned long)stats.liveBlocks,
+                     (unsigned long)stats.peakBytes, (unsigned long)stats.allocs,
+                     (unsigned long)stats.allocBytes);
+    }
+#else
+    Serial.println("   Per-tag tracking needs the esp32-s3-petcollar-heapprof build");
+#endif
+}
+
+void cmdHeapTest(const CommandContext& ctx) {
+    runHeapProfilerTests();
+}
+
+void cmdTrace(const CommandContext& ctx) {
+#if FEATURE_TRACE
+    String action = ctx.source == CMD_SRC_SERIAL ? String(ctx.text) : String(ctx.args["action"] | "");
+    
+    if (action == "clear") {
+        traceBuffer.clear();
+    } else if (action.startsWith("mark")) {
+        TRACE(MARK, ctx.source == CMD_SRC_SERIAL ? atoi(action.c_str() + 4) : (ctx.args["value"] | 0), 0);
+    } else {
+        uint32_t sent = drainTrace(ctx.source, ctx.clientNum);
+        if (ctx.source == CMD_SRC_SERIAL) {
+            Serial.printf("📼 %lu records sent, %lu recorded, %lu lost since boot\n", (unsigned long)sent,
+                         (unsigned long)traceBuffer.getRecorded(), (unsigned long)traceBuffer.getTotalLost());
+        }
+    }
+#else
+    Serial.println("📼 Tracing is compiled out (FEATURE_TRACE)");
+#endif
+}
+
+void cmdTraceTest(const CommandContext& ctx) {
+    runTraceBufferTests();
+}
+
+void cmdDisplay(const CommandContext& ctx) {
+    unsigned long now = millis();
+    Serial.printf("🖥️ Display: %s, %s (idle %lu s, blanks after %d s)\n",
+                 displayOnline ? "online" : "offline", statusView.isBlanked() ? "blanked" : "lit",
+                 (unsigned long)(statusView.getIdleMs(now) / 1000), DISPLAY_TIMEOUT_MS / 1000);
+    DisplayFlushStats stats = displayFlusher.getStats();
+    Serial.printf("   %lu updates, %lu glyphs drawn, %lu bytes sent (%lu per update, full frame %d)\n",
+                 (unsigned long)stats.flushes, (unsigned long)statusView.getGlyphsDrawn(),
+                 (unsigned long)stats.bytes, (unsigned long)(stats.flushes ? stats.bytes / stats.flushes : 0),
+                 SCREEN_WIDTH * SCREEN_HEIGHT / 8);
+    Serial.printf("   Flush %s: longest %lu us, %lu deferred while busy, %lu bus errors\n",
+                 displayFlusher.isAsync() ? "task" : "in loop", (unsigned long)stats.maxFlushUs,
+                 (unsigned long)stats.deferred, (unsigned long)stats.busErrors);
+}
+
+void cmdDisplayTest(const CommandContext& ctx) {
+    // The flusher is covered on the host by firmware/tools/display_flush_test.cpp
+    runStatusViewTests();
+}
+
+void cmdLog(const CommandContext& ctx) {
+    collarLog.flush();
+    Serial.printf("📝 Log level %d (%s build), %lu lines queued since boot, %lu dropped\n",
+                 COLLAR_LOG_LEVEL, COLLAR_LOG_LEVEL >= DEBUG_LOG_LEVEL_DEBUG ? "debug" : "release",
+                 (unsigned long)collarLog.getLines(), (unsigned long)collarLog.getDropped());
+    Serial.printf("   Buffer high water %lu / %u bytes\n",
+                 (unsigned long)collarLog.getHighWater(), LOG_BUFFER_SIZE);
+}
+
+void cmdLogTest(const CommandContext& ctx) {
+    runDeferredLogTests();
+}
+
+void cmdRssiStats(const CommandContext& ctx) {
+    Serial.println("📊 RSSI Smoother Global Statistics:");
+    printRSSISmootherStats();
+}
+
+void cmdRssiClear(const CommandContext& ctx) {
+    if (!ctx.text[0]) {
+        Serial.println("❌ Usage: rssi-clear <mac>");
+        return;
+    }
+    globalRSSISmoother.clearBeacon(ctx.text);
+    Serial.printf("🗑️ Cleared RSSI data for beacon: %s\n", ctx.text);
+}
+
+void cmdRssiClearAll(const CommandContext& ctx) {
+    globalRSSISmoother.clearAll();
+    Serial.println("🗑️ Cleared all RSSI smoothing data");
+}
+
+void cmdRssiGet(const CommandContext& ctx) {
+    int16_t smoothedRssi = globalRSSISmoother.getSmoothedRssi(ctx.text);
+    if (smoothedRssi != 0) {
+        RSSIStats stats = globalRSSISmoother.getStats(ctx.text);
+        Serial.printf("📡 Beacon %s: %d dBm (smoothed)\n", ctx.text, smoothedRssi);
+        Serial.printf("   Stats: %s\n", formatRSSIStats(stats).c_str());
+    } else {
+        Serial.printf("❌ No smoothed RSSI data for beacon: %s\n", ctx.text);
+    }
+}
+
+void cmdRssiHelp(const CommandContext& ctx) {
+    Serial.println("🔧 RSSI Smoother Commands:");
+    commandRegistry.printHelp(CMD_SRC_SERIAL, "rssi-");
+}
+
+void cmdRssiConfig(const CommandContext& ctx) {
+    Serial.println("⚙️ RSSI Smoothing Configuration:");
+    Serial.printf("  Enabled: %s\n", BLE_RSSI_SMOOTHING_ENABLED ? "Yes" : "No");
+    Serial.printf("  Packet Count (N): %d\n", BLE_RSSI_PACKET_COUNT);
+    Serial.printf("  Quality Threshold: %d dBm\n", BLE_RSSI_QUALITY_THRESHOLD);
+    Serial.printf("  Max Latency: %d ms\n", BLE_RSSI_MAX_LATENCY_MS);
+    Serial.printf("  Method: %s\n", (BLE_RSSI_SMOOTHING_METHOD == 0) ? "Median" : "Trimmed Mean");
+    Serial.printf("  CRC Check: %s\n", BLE_RSSI_CRC_CHECK_ENABLED ? "Enabled" : "Disabled");
+    Serial.printf("  Max Beacons: %d\n", BLE_RSSI_MAX_BEACONS);
+
+    // Task 2: Temporal filter configuration
+    if (BLE_TEMPORAL_FILTER_ENABLED) {
+        Serial.println("  🔄 Temporal Filter Configuration:");
+        Serial.printf("    Filter Type: %s\n", BLE_TEMPORAL_FILTER_TYPE == 0 ? "IIR Exponential" : "1D Kalman");
+        Serial.printf("    IIR Alpha: %.3f (runtime: %.3f)\n", (float)BLE_IIR_ALPHA, globalRSSISmoother.getIIRAlpha());
+        Serial.printf("    Kalman Q: %.3f (runtime: %.3f)\n", (float)BLE_KALMAN_PROCESS_NOISE, globalRSSISmoother.getKalmanQ());
+        Serial.printf("    Kalman R: %.3f (runtime: %.3f)\n", (float)BLE_KALMAN_MEASUREMENT_NOISE, globalRSSISmoother.getKalmanR());
+        Serial.printf("    Min Update: %d ms\n", BLE_FILTER_MIN_UPDATE_MS);
+        Serial.printf("    Convergence Time: %d ms\n", BLE_FILTER_CONVERGENCE_TIME);
+    } else {
+        Serial.println("  🚫 Temporal Filter: Disabled");
+    }
+}
+
+// Task 2: Temporal filter commands
+void cmdFilterStats(const CommandContext& ctx) {
+    Serial.println("📊 Temporal Filter Statistics:");
+    printTemporalFilterStats();
+}
+
+void cmdFilterAlpha(const CommandContext& ctx) {
+    float alpha = String(ctx.text).toFloat();
+    if (ctx.text[0] && alpha >= 0.0f && alpha <= 1.0f) {
+        globalRSSISmoother.setIIRAlpha(alpha);
+        collarSettings.edit(millis()).iirAlpha = alpha;
+        Serial.printf("✅ IIR Alpha updated to: %.3f\n", alpha);
+    } else {
+        Serial.println("❌ Invalid alpha value (must be 0.0-1.0)");
+    }
+}
+
+void cmdFilterKalman(const CommandContext& ctx) {
+    // Expected format: filter-kalman Q R
+    String params = ctx.text;
+    int spaceIndex = params.indexOf(' ');
+    if (spaceIndex > 0) {
+        float q = params.substring(0, spaceIndex).toFloat();
+        float r = params.substring(spaceIndex + 1).toFloat();
+        if (q > 0.0f && r > 0.0f) {
+            globalRSSISmoother.setKalmanParameters(q, r);
+            CollarSettings& settings = collarSettings.edit(millis());
+            settings.kalmanQ = q;
+            settings.kalmanR = r;
+            Serial.printf("✅ Kalman parameters updated: Q=%.3f, R=%.3f\n", q, r);
+        } else {
+            Serial.println("❌ Invalid parameters (must be > 0.0)");
+        }
+    } else {
+        Serial.println("❌ Usage: filter-kalman <Q> <R>");
+    }
+}
+
+void cmdFilterReset(const CommandContext& ctx) {
+    if (!ctx.text[0]) {
+        Serial.println("❌ Usage: filter-reset <mac>");
+        return;
+    }
+    globalRSSISmoother.resetFilter(ctx.text);
+    Serial.printf("🔄 Filter reset for beacon: %s\n", ctx.text);
+}
+
+void cmdFilterResetAll(const CommandContext& ctx) {
+    globalRSSISmoother.resetAllFilters();
+    Serial.println("🔄 All temporal filters reset");
+}
+
+void cmdFilterDistance(const CommandContext& ctx) {
+    const char* mac = ctx.text;
+    if (globalRSSISmoother.hasFilteredData(mac)) {
+        float filteredRssi = globalRSSISmoother.getFilteredRssi(mac);
+        float distance = globalRSSISmoother.getFilteredDistance(mac);
+        bool converged = globalRSSISmoother.isFilterConverged(mac);
+        FilterStats stats = globalRSSISmoother.getFilterStats(mac);
+
+        Serial.printf("📏 Beacon %s:\n", mac);
+        Serial.printf("   Filtered RSSI: %.1f dBm\n", filteredRssi);
+        Serial.printf("   Distance: %.1f cm\n", distance);
+        Serial.printf("   Status: %s\n", converged ? "Converged" : "Converging");
+        Serial.printf("   Stats: %s\n", formatFilterStats(stats).c_str());
+    } else {
+        Serial.printf("❌ No filtered data for beacon: %s\n", mac);
+    }
+}
+
+void cmdFilterTest(const CommandContext& ctx) {
+    Serial.println("🧪 Running temporal filter unit tests...");
+    runTemporalFilterTests();
+}
+
+void cmdFilterHelp(const CommandContext& ctx) {
+    Serial.println("🔧 Temporal Filter Commands:");
+    commandRegistry.printHelp(CMD_SRC_SERIAL, "filter-");
+}
+
+void cmdHelp(const CommandContext& ctx) {
+    Serial.println("🔧 Available Commands:");
+    commandRegistry.printHelp(CMD_SRC_SERIAL);
+    Serial.println("  JSON commands take their arguments inline: test-alert {\"alertMode\":\"both\"}");
+}
+
+void cmdStatus(const CommandContext& ctx) {
+    printSystemStatus();
+}
+
+void cmdTestBuzzer(const CommandContext& ctx) {
+    Serial.println("🔊 Testing buzzer...");
+    testBuzzer(2000, 1000);
+}
+
+void cmdAlertEngineTest(const CommandContext& ctx) {
+    runAlertPatternEngineSmokeTest(alertManager.getPatternEngine());
+}
+
+void cmdAlertEngineStats(const CommandContext& ctx) {
+    AlertPatternEngine& engine = alertManager.getPatternEngine();
+    Serial.printf("⏱️ Alert engine: %s, step %u, max lateness %u us, timer errors %u\n",
+                 engine.isPlaying() ? "playing" : "idle",
+                 engine.getCurrentStep(), engine.getMaxLatenessUs(), engine.getTimerErrors());
+#if FEATURE_BUZZER_WAVEFORM
+    AlertAudioPlayer& audio = alertManager.getAudioPlayer();
+    Serial.printf("🎵 Alert audio: %s, %s, max clip render %u us\n",
+                 audio.isReady() ? "ready" : "unavailable",
+                 audio.isPlaying() ? "playing" : "idle", audio.getMaxRenderUs());
+#endif
+}
+
+void cmdAlertArbiterTest(const CommandContext& ctx) {
+    runAlertArbiterTests();
+}
+
+void cmdAlertQueue(const CommandContext& ctx) {
+    AlertArbiter& arbiter = alertManager.getArbiter();
+    const AlertArbiterStats& stats = arbiter.getStats();
+    if (arbiter.hasActive()) {
+        const AlertRequest& active = arbiter.getActive();
+        Serial.printf("🚦 Active: %s (%s priority, %u merged)\n",
+                     alertSourceToString(active.source),
+                     alertPriorityToString(active.priority), active.mergeCount);
+    } else {
+        Serial.println("🚦 Active: none");
+    }
+    Serial.printf("   Queued: %u\n", arbiter.getQueueCount());
+    Serial.printf("   Submitted %lu, started %lu, preempted %lu, queued %lu, merged %lu, dropped %lu, expired %lu\n",
+                 stats.submitted, stats.started, stats.preempted, stats.queued,
+                 stats.merged, stats.dropped, stats.expired);
+}
+
+void cmdTelemetryFormat(const CommandContext& ctx) {
+    String format = ctx.text;
+    if (format == "cbor") {
+        setTelemetryFormat(TelemetryFormat::CBOR);
+    } else if (format == "json") {
+        setTelemetryFormat(TelemetryFormat::JSON);
+    } else if (format.length() == 0) {
+        Serial.printf("📦 Telemetry format: %s\n", telemetryFormatToString(telemetryFormat));
+    } else {
+        Serial.println("❌ Usage: telemetry-format [json|cbor]");
+    }
+}
+
+void cmdTelemetryStats(const CommandContext& ctx) {
+    const TelemetryDeltaStats& stats = telemetryDelta.getStats();
+    Serial.printf("📦 Telemetry: %s, sequence %lu\n",
+                 telemetryFormatToString(telemetryFormat), (unsigned long)telemetryDelta.getSequence());
+    Serial.printf("   Keyframes %lu, deltas %lu, suppressed %lu, failed %lu\n",
+                 stats.keyframes, stats.deltas, stats.suppressed, stats.failed);
+    if (stats.bytesSent > 0) {
+        Serial.printf("   Sent %lu bytes vs %lu as keyframes (%.1fx)\n",
+                     stats.bytesSent, stats.fullBytesEquivalent,
+                     (float)stats.fullBytesEquivalent / stats.bytesSent);
+    }
+}
+
+void cmdOutboxStats(const CommandContext& ctx) {
+    const OutboxStats& stats = mqttOutbox.getStats();
+    Serial.printf("📥 Outbox: %s, %lu pending (%u%% full), next #%lu\n",
+                 mqttOutbox.isReady() ? "ready" : "unavailable",
+                 (unsigned long)mqttOutbox.getPendingCount(), mqttOutbox.getFillPercent(),
+                 (unsigned long)mqttOutbox.getNextSequence());
+    Serial.printf("   Appended %lu, published %lu, refused %lu by the connection\n",
+                 stats.appended, stats.published, stats.failed);
+    Serial.printf("   Evicted %lu, expired %lu, not stored %lu, corrupt %lu, recovered %lu\n",
+                 stats.evicted, stats.expired, stats.refused, stats.corrupt, stats.recovered);
+}
+
+void cmdSettings(const CommandContext& ctx) {
+    const CollarSettings& settings = collarSettings.get();
+    const ConfigStoreStats& stats = collarSettings.getStats();
+    Serial.printf("⚙️ Settings: %s, generation %lu, %u-byte record (schema v%u)%s\n",
+                 collarSettings.isReady() ? "flash" : "RAM only", (unsigned long)stats.generation,
+                 (unsigned)sizeof(CollarSettings), COLLAR_SETTINGS_VERSION,
+                 collarSettings.isDirty() ? ", save pending" : "");
+    Serial.printf("   Saves %lu, erases %lu, failures %lu, corrupt %lu\n",
+                 (unsigned long)stats.saves, (unsigned long)stats.erases,
+                 (unsigned long)stats.failures, (unsigned long)stats.corrupt);
+    Serial.printf("   WiFi: %s, fast record %s\n", settings.wifiSsid[0] ? settings.wifiSsid : "(none)",
+                 settings.wifiFast.version ? "cached" : "none");
+    Serial.printf("   Filter: alpha %.3f, Q %.3f, R %.3f\n", settings.iirAlpha, settings.kalmanQ, settings.kalmanR);
+    Serial.printf("   Telemetry: %s, keyframe every %u / %lu ms\n",
+                 telemetryFormatToString((TelemetryFormat)settings.telemetryFormat),
+                 settings.keyframeInterval, (unsigned long)settings.keyframeMaxMs);
+    Serial.printf("   Proximity configs: %u of %d\n", settings.proximityCount, SETTINGS_MAX_PROXIMITY);
+}
+
+void cmdSettingsTest(const CommandContext& ctx) {
+    runCollarSettingsTests();
+}
+
+void cmdWsStats(const CommandContext& ctx) {
+    const WsFanoutStats& stats = wsFanout.getStats();
+    Serial.printf("🔌 WebSocket: %u clients, %lu frames (%lu live), %lu sent\n",
+                 wsFanout.getClientCount(), (unsigned long)stats.frames,
+                 (unsigned long)stats.liveFrames, (unsigned long)stats.sent);
+    Serial.printf("   Coalesced %lu, dropped %lu, slow sends %lu, disconnected %lu, max service %lums\n",
+                 (unsigned long)stats.coalesced, (unsigned long)stats.dropped,
+                 (unsigned long)stats.slowSends, (unsigned long)stats.disconnects,
+                 (unsigned long)stats.maxServiceMs);
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        if (wsFanout.getQueuedCount(i) > 0 || wsFanout.getStrikes(i) > 0) {
+            Serial.printf("   Client %u: %u queued, %u strikes\n", i,
+                         wsFanout.getQueuedCount(i), wsFanout.getStrikes(i));
+        }
+    }
+    const WsStreamStats& streamStats = wsStreams.getStats();
+    Serial.printf("   Streams: subscribers 0x%02X, %lu delta, %lu key, %lu per-packet, %lu alert frames\n",
+                 wsStreams.getSubscriberMask(), (unsigned long)streamStats.deltaFrames,
+                 (unsigned long)streamStats.keyframes, (unsigned long)streamStats.packetFrames,
+                 (unsigned long)streamStats.eventFrames);
+}
+
+void cmdWsFanoutTest(const CommandContext& ctx) {
+    runWsFanoutTests();
+}
+
+void cmdWsStreamTest(const CommandContext& ctx) {
+    runWsStreamTests();
+}
+
+void cmdTelemetryDeltaTest(const CommandContext& ctx) {
+    runTelemetryDeltaTests();
+}
+
+void cmdCommandStats(const CommandContext& ctx) {
+    const CommandStats& stats = commandRegistry.getStats();
+    Serial.printf("🎯 Commands: %u registered, %lu dispatched, %lu unknown, %lu not allowed, %lu bad JSON\n",
+                 (unsigned)commandRegistry.getCount(), (unsigned long)stats.dispatched,
+                 (unsigned long)stats.unknown, (unsigned long)stats.rejected,
+                 (unsigned long)stats.parseErrors);
+    Serial.printf("   Arena peak %u of %u bytes, slowest handler %lu us\n",
+                 stats.maxArenaBytes, COMMAND_ARENA_BYTES, (unsigned long)stats.maxHandlerUs);
+}
+
+void cmdCommandTest(const CommandContext& ctx) {
+    runCommandRegistryTests();
+}
+
+void cmdHttpStats(const CommandContext& ctx) {
+    const HttpSnapshotStats& stats = httpCache.getStats();
+    Serial.printf("🌐 HTTP cache: %lu served, %lu not modified, %lu misses (%s server)\n",
+                 (unsigned long)stats.served, (unsigned long)stats.notModified,
+                 (unsigned long)stats.misses, FEATURE_ASYNC_WEBSERVER ? "async" : "sync");
+    Serial.printf("   Rebuilds %lu (%lu unchanged), %lu live snapshots\n",
+                 (unsigned long)stats.rebuilds, (unsigned long)stats.unchanged,
+                 (unsigned long)stats.liveSnapshots);
+    for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        Serial.printf("   Asset %s: %u bytes gzip (%u raw)\n", WEB_ASSETS[i].path,
+                     (unsigned)WEB_ASSETS[i].length, (unsigned)WEB_ASSETS[i].originalLength);
+    }
+}
+
+void cmdHttpCacheTest(const CommandContext& ctx) {
+    runHttpSnapshotTests();
+}
+
+void cmdWifiInfo(const CommandContext& ctx) {
+    String ip = getCurrentIPAddress();
+    Serial.printf("📡 WiFi Status: %s\n", WiFi.isConnected() ? "Connected" : "Disconnected");
+    Serial.printf("🌐 IP Address: %s\n", ip.c_str());
+    if (WiFi.isConnected()) {
+        Serial.printf("🏷️ SSID: %s\n", WiFi.SSID().c_str());
+        Serial.printf("📶 Signal: %d dBm\n", WiFi.RSSI());
+    }
+    const WiFiFastConnect& fast = wifiManager.getFastConnect();
+    const WiFiFastStats& stats = fast.getStats();
+    Serial.printf("⚡ Last connect: %lu ms via %s\n", (unsigned long)stats.lastConnectMs,
+                 wifiFastPathToString(stats.lastPath));
+    Serial.printf("   Fast %lu/%lu (%lu failed), %lu scans, %lu cache writes\n",
+                 (unsigned long)stats.fastConnects, (unsigned long)stats.fastAttempts,
+                 (unsigned long)stats.fastFailures, (unsigned long)stats.scanConnects,
+                 (unsigned long)stats.saves);
+    if (fast.isValid()) {
+        const WiFiFastRecord& record = fast.getRecord();
+        Serial.printf("   Cached: %s %02X:%02X:%02X:%02X:%02X:%02X ch %u, lease %s used %u/%d\n",
+                     record.ssid, record.bssid[0], record.bssid[1], record.bssid[2],
+                     record.bssid[3], record.bssid[4], record.bssid[5], record.channel,
+                     IPAddress(record.ip).toString().c_str(), record.leaseUses,
+                     WIFI_FAST_LEASE_REUSES);
+    } else {
+        Serial.println("   Cached: none (next connect scans)");
+    }
+}
+
+void cmdWifiRoam(const CommandContext& ctx) {
+    const RoamStats& stats = wifiRoamer.getStats();
+    uint32_t now = millis();
+    Serial.printf("📶 Roaming: link %d dBm%s, %lu roams, %lu reconnects, %lu refused\n",
+                 wifiRoamer.getLinkRssi(), wifiRoamer.isConnected() ? "" : " (down)",
+                 (unsigned long)stats.roams, (unsigned long)stats.reconnects,
+                 (unsigned long)stats.failures);
+    Serial.printf("   Scans: %lu channel, %lu full; last roam %d -> %d dBm\n",
+                 (unsigned long)stats.channelScans, (unsigned long)stats.fullScans,
+                 stats.lastRoamFromRssi, stats.lastRoamToRssi);
+    for (uint8_t i = 0; i < wifiRoamer.getCount(); i++) {
+        const RoamCandidate& candidate = wifiRoamer.getCandidate(i);
+        Serial.printf("   %02X:%02X:%02X:%02X:%02X:%02X ch %2u %4d dBm %5lus ago %s\n",
+                     candidate.bssid[0], candidate.bssid[1], candidate.bssid[2],
+                     candidate.bssid[3], candidate.bssid[4], candidate.bssid[5],
+                     candidate.channel, candidate.rssi,
+                     (unsigned long)((now - candidate.seenMs) / 1000),
+                     candidate.network >= 0 ? wifiNetworks[candidate.network].ssid : "?");
+    }
+}
+
+void cmdWifiFastTest(const CommandContext& ctx) {
+    runWiFiFastConnectTests();
+}
+
+void cmdBleScan(const CommandContext& ctx) {
+    if (systemStateData.bleInitialized && pBLEScan) {
+        Serial.println("📡 Starting BLE scan...");
+        pBLEScan->start(BLE_SCAN_DURATION_SEC, false);
+        Serial.println("✅ BLE scan completed");
+    } else {
+        Serial.println("❌ BLE scanner not initialized");
+    }
+}
+
+void cmdReboot(const CommandContext& ctx) {
+    Serial.println("🔄 Rebooting ESP32-S3...");
+    collarLog.flush();
+    delay(1000);
+    ESP.restart();
+}
+
+#define CMD_SRC_WS_SERIAL   (CMD_SRC_WEBSOCKET | CMD_SRC_SERIAL)
+#define CMD_SRC_MQTT_SERIAL (CMD_SRC_MQTT | CMD_SRC_SERIAL)
+
+// Sorted by strcmp() ('-' < '_' < letters); commandRegistry.begin() checks it
+const CommandEntry COMMAND_TABLE[] = {
+    {"alert-arbiter-test",      cmdAlertArbiterTest,      CMD_SRC_SERIAL,      "",            "Run alert arbitration tests"},
+    {"alert-engine-stats",      cmdAlertEngineStats,      CMD_SRC_SERIAL,      "",            "Show alert pattern timing stats"},
+    {"alert-engine-test",       cmdAlertEngineTest,       CMD_SRC_SERIAL,      "",            "Play a muted pattern on the alert timer"},
+    {"alert-queue",             cmdAlertQueue,            CMD_SRC_SERIAL,      "",            "Show active and queued alerts"},
+    {"ble-scan",                cmdBleScan,               CMD_SRC_SERIAL,      "",            "Force BLE scan"},
+    {"buzz",                    cmdBuzz,                  CMD_SRC_MQTT_SERIAL, "{json}",      "Cloud buzzer (duration_ms, pattern)"},
+    {"cmd-stats",               cmdCommandStats,          CMD_SRC_SERIAL,      "",            "Show command dispatch stats"},
+    {"cmd-test",                cmdCommandTest,           CMD_SRC_SERIAL,      "",            "Run command registry tests"},
+    {"configure_beacon",        cmdConfigureBeacon,       CMD_SRC_MQTT_SERIAL, "{json}",      "Configure one proximity beacon"},
+    {"configure_beacons_batch", cmdConfigureBeaconsBatch, CMD_SRC_MQTT_SERIAL, "{json}",      "Replace all proximity beacons"},
+    {"debug_proximity_configs", cmdDebugProximityConfigs, CMD_SRC_ALL,         "",            "List proximity configurations"},
+    {"display",                 cmdDisplay,               CMD_SRC_SERIAL,      "",            "Show status screen flush and blanking stats"},
+    {"display-test",            cmdDisplayTest,           CMD_SRC_SERIAL,      "",            "Run status view tests"},
+    {"filter-alpha",            cmdFilterAlpha,           CMD_SRC_SERIAL,      "<value>",     "Set IIR alpha (0.0-1.0)"},
+    {"filter-distance",         cmdFilterDistance,        CMD_SRC_SERIAL,      "<mac>",       "Show filtered distance"},
+    {"filter-help",             cmdFilterHelp,            CMD_SRC_SERIAL,      "",            "Temporal filter commands"},
+    {"filter-kalman",           cmdFilterKalman,          CMD_SRC_SERIAL,      "<Q> <R>",     "Set Kalman parameters"},
+    {"filter-reset",            cmdFilterReset,           CMD_SRC_SERIAL,      "<mac>",       "Reset filter for beacon"},
+    {"filter-reset-all",        cmdFilterResetAll,        CMD_SRC_SERIAL,      "",            "Reset all filters"},
+    {"filter-stats",            cmdFilterStats,           CMD_SRC_SERIAL,      "",            "Show filter statistics"},
+    {"filter-test",             cmdFilterTest,            CMD_SRC_SERIAL,      "",            "Run temporal filter unit tests"},
+    {"get_beacons",             cmdGetBeacons,            CMD_SRC_WEBSOCKET,   "",            "Send detected beacons"},
+    {"get_status",              cmdGetStatus,             CMD_SRC_WEBSOCKET,   "",            "Send system status"},
+    {"heap",                    cmdHeap,                  CMD_SRC_MQTT_SERIAL, "[reset]",     "Heap fragmentation and allocations per tag"},
+    {"heap-test",               cmdHeapTest,              CMD_SRC_SERIAL,      "",            "Run heap profiler tests"},
+    {"help",                    cmdHelp,                  CMD_SRC_SERIAL,      "",            "Show all commands"},
+    {"http-cache-test",         cmdHttpCacheTest,         CMD_SRC_SERIAL,      "",            "Run HTTP snapshot cache self-tests"},
+    {"http-stats",              cmdHttpStats,             CMD_SRC_SERIAL,      "",            "HTTP response cache statistics"},
+    {"list_detected_beacons",   cmdListDetectedBeacons,   CMD_SRC_ALL,         "",            "List detected beacons"},
+    {"locate",                  cmdLocate,                CMD_SRC_MQTT_SERIAL, "",            "Locator alert and publish position"},
+    {"log",                     cmdLog,                   CMD_SRC_SERIAL,      "",            "Flush deferred log and show its counters"},
+    {"log-test",                cmdLogTest,               CMD_SRC_SERIAL,      "",            "Run deferred log tests"},
+    {"outbox-stats",            cmdOutboxStats,           CMD_SRC_SERIAL,      "",            "Show MQTT store-and-forward outbox"},
+    {"perf",                    cmdPerf,                  CMD_SRC_MQTT_SERIAL, "[reset]",     "Loop timing per stage (p50/p99/max)"},
+    {"perf-test",               cmdPerfTest,              CMD_SRC_SERIAL,      "",            "Run loop profiler tests"},
+    {"proximity-state",         cmdProximityState,        CMD_SRC_MQTT_SERIAL, "",            "Publish proximity config set hashes"},
+    {"proximity-sync",          cmdProximitySync,         CMD_SRC_MQTT_SERIAL, "{json}",      "Apply a proximity config delta"},
+    {"reboot",                  cmdReboot,                CMD_SRC_SERIAL,      "",            "Restart system"},
+    {"rssi-clear",              cmdRssiClear,             CMD_SRC_SERIAL,      "<mac>",       "Clear data for specific beacon"},
+    {"rssi-clear-all",          cmdRssiClearAll,          CMD_SRC_SERIAL,      "",            "Clear all smoothing data"},
+    {"rssi-config",             cmdRssiConfig,            CMD_SRC_SERIAL,      "",            "Show current configuration"},
+    {"rssi-get",                cmdRssiGet,               CMD_SRC_SERIAL,      "<mac>",       "Get smoothed RSSI for beacon"},
+    {"rssi-help",               cmdRssiHelp,              CMD_SRC_SERIAL,      "",            "RSSI smoother commands"},
+    {"rssi-stats",              cmdRssiStats,             CMD_SRC_SERIAL,      "",            "Show global statistics"},
+    {"rssi-test",               cmdRssiTest,              CMD_SRC_SERIAL,      "",            "Run RSSI smoother unit tests"},
+    {"set-telemetry-delta",     cmdSetTelemetryDelta,     CMD_SRC_MQTT_SERIAL, "{json}",      "Set telemetry deadbands"},
+    {"set-telemetry-format",    cmdSetTelemetryFormat,    CMD_SRC_MQTT_SERIAL, "{json}",      "Set MQTT payload encoding"},
+    {"settings",                cmdSettings,              CMD_SRC_SERIAL,      "",            "Show persisted settings store"},
+    {"settings-test",           cmdSettingsTest,          CMD_SRC_SERIAL,      "",            "Run settings store tests"},
+    {"status",                  cmdStatus,                CMD_SRC_SERIAL,      "",            "Show system status"},
+    {"stop_alert",              cmdStopAlert,             CMD_SRC_ALL,         "",            "Stop the active alert"},
+    {"subscribe",               cmdSubscribe,             CMD_SRC_WEBSOCKET,   "",            "Subscribe to live streams"},
+    {"telemetry-delta-test",    cmdTelemetryDeltaTest,    CMD_SRC_SERIAL,      "",            "Run telemetry delta tests"},
+    {"telemetry-format",        cmdTelemetryFormat,       CMD_SRC_SERIAL,      "[json|cbor]", "Show/set MQTT payload encoding"},
+    {"telemetry-keyframe",      cmdTelemetryKeyframe,     CMD_SRC_MQTT_SERIAL, "",            "Send a telemetry keyframe next"},
+    {"telemetry-stats",         cmdTelemetryStats,        CMD_SRC_SERIAL,      "",            "Show CBOR delta compression stats"},
+    {"test-alert",              cmdTestAlert,             CMD_SRC_MQTT_SERIAL, "{json}",      "Alert with alertMode, durationMs, intensity"},
+    {"test-buzzer",             cmdTestBuzzer,            CMD_SRC_SERIAL,      "",            "Test buzzer tone"},
+    {"test_buzzer",             cmdTestBuzzerAlert,       CMD_SRC_WS_SERIAL,   "",            "Trigger a buzzer test alert"},
+    {"test_vibration",          cmdTestVibrationAlert,    CMD_SRC_WS_SERIAL,   "",            "Trigger a vibration test alert"},
+    {"trace",                   cmdTrace,                 CMD_SRC_ALL,         "[clear|mark]", "Send the binary event trace (trace_to_chrome.py)"},
+    {"trace-test",              cmdTraceTest,             CMD_SRC_SERIAL,      "",            "Run trace buffer tests"},
+    {"unsubscribe",             cmdUnsubscribe,           CMD_SRC_WEBSOCKET,   "",            "Stop live streams"},
+    {"update_beacon_config",    cmdUpdateBeaconConfig,    CMD_SRC_WEBSOCKET,   "",            "Update a beacon configuration"},
+    {"wifi-fast-test",          cmdWifiFastTest,          CMD_SRC_SERIAL,      "",            "Run WiFi fast-connect cache tests"},
+    {"wifi-info",               cmdWifiInfo,              CMD_SRC_SERIAL,      "",            "WiFi connection info"},
+    {"wifi-roam",               cmdWifiRoam,              CMD_SRC_SERIAL,      "",            "Roaming candidates and statistics"},
+    {"ws-fanout-test",          cmdWsFanoutTest,          CMD_SRC_SERIAL,      "",            "Run WebSocket fan-out tests"},
+    {"ws-stats",                cmdWsStats,               CMD_SRC_SERIAL,      "",            "Show WebSocket fan-out queues"},
+    {"ws-stream-test",          cmdWsStreamTest,          CMD_SRC_SERIAL,      "",            "Run WebSocket live stream tests"},
+    {"zone",                    cmdZone,                  CMD_SRC_MQTT_SERIAL, "{json}",      "Zone list or alert (action)"},
+};
+
+const size_t COMMAND_TABLE_SIZE = sizeof(COMMAND_TABLE) / sizeof(COMMAND_TABLE[0]);
+
 // ==================== ARDUINO CORE FUNCTIONS ====================
 /**
  * @brief Arduino setup function - Initialize all systems
  */
 void setup() {
+#if FEATURE_MEMORY_PROFILING
+    heapProfiler.begin(millis());   // Before anything worth attributing is allocated
+#endif
     Serial.begin(115200);
     delay(2000); // Allow serial to stabilize
+    collarLog.begin();
     
     bootTime = millis();
     
@@ -2786,20 +4772,27 @@ void setup() {
     // Power on indicator
     digitalWrite(STATUS_LED_POWER, HIGH);
     
-    // Initialize preferences storage
-    preferences.begin("petcollar", false);
-    
     // Initialize system managers
     systemStateManager.initialize();
+    loopProfiler.begin(ESP.getCpuFreqMHz(), millis());
+    wsStreams.setProfiler(&loopProfiler);
     alertManager.initialize();
     beaconManager.initialize();
     zoneManager.initialize();
+    commandRegistry.begin(COMMAND_TABLE, COMMAND_TABLE_SIZE);
+    
+    // Settings first: WiFi credentials, filters and proximity configs come from them
+    initializeSettings();
+    applySettings();
     
     // Initialize hardware systems
     bool displayOK = initializeDisplay();
     bool wifiOK = initializeWiFi();
     bool bleOK = initializeBLE();
     
+    // Outbox first: alerts raised before WiFi comes up are kept for later
+    initializeOutbox();
+    
     // Initialize network services if WiFi is available
     if (wifiOK) {
         initializeWebServices();
@@ -2849,189 +4842,19 @@ void setup() {
  */
 void handleSerialCommands() {
     if (Serial.available()) {
-        String command = Serial.readStringUntil('\n');
-        command.trim();
-        command.toLowerCase();
+        static char line[COMMAND_LINE_MAX];
+        size_t length = Serial.readBytesUntil('\n', line, sizeof(line) - 1);
+        line[length] = '\0';
         
-        Serial.printf("🎯 Command received: %s\n", command.c_str());
+        Serial.printf("🎯 Command received: %s\n", line);
         
-        if (command == "rssi-test") {
-            Serial.println("🧪 Running RSSI smoother unit tests...");
-            runRSSISmootherTests();
-            
-        } else if (command == "rssi-stats") {
-            Serial.println("📊 RSSI Smoother Global Statistics:");
-            printRSSISmootherStats();
-            
-        } else if (command.startsWith("rssi-clear ")) {
-            String mac = command.substring(11);
-            globalRSSISmoother.clearBeacon(mac.c_str());
-            Serial.printf("🗑️ Cleared RSSI data for beacon: %s\n", mac.c_str());
-            
-        } else if (command == "rssi-clear-all") {
-            globalRSSISmoother.clearAll();
-            Serial.println("🗑️ Cleared all RSSI smoothing data");
-            
-        } else if (command.startsWith("rssi-get ")) {
-            String mac = command.substring(9);
-            int16_t smoothedRssi = globalRSSISmoother.getSmoothedRssi(mac.c_str());
-            if (smoothedRssi != 0) {
-                RSSIStats stats = globalRSSISmoother.getStats(mac.c_str());
-                Serial.printf("📡 Beacon %s: %d dBm (smoothed)\n", mac.c_str(), smoothedRssi);
-                Serial.printf("   Stats: %s\n", formatRSSIStats(stats).c_str());
-            } else {
-                Serial.printf("❌ No smoothed RSSI data for beacon: %s\n", mac.c_str());
-            }
-            
-        } else if (command == "rssi-help") {
-            Serial.println("🔧 RSSI Smoother Commands:");
-            Serial.println("  rssi-test          - Run unit tests");
-            Serial.println("  rssi-stats         - Show global statistics");
-            Serial.println("  rssi-get <mac>     - Get smoothed RSSI for beacon");
-            Serial.println("  rssi-clear <mac>   - Clear data for specific beacon");
-            Serial.println("  rssi-clear-all     - Clear all smoothing data");
-            Serial.println("  rssi-config        - Show current configuration");
-            Serial.println("  filter-help        - Temporal filter commands");
-            Serial.println("  help               - Show all commands");
-            
-        } else if (command == "rssi-config") {
-            Serial.println("⚙️ RSSI Smoothing Configuration:");
-            Serial.printf("  Enabled: %s\n", BLE_RSSI_SMOOTHING_ENABLED ? "Yes" : "No");
-            Serial.printf("  Packet Count (N): %d\n", BLE_RSSI_PACKET_COUNT);
-            Serial.printf("  Quality Threshold: %d dBm\n", BLE_RSSI_QUALITY_THRESHOLD);
-            Serial.printf("  Max Latency: %d ms\n", BLE_RSSI_MAX_LATENCY_MS);
-            Serial.printf("  Method: %s\n", (BLE_RSSI_SMOOTHING_METHOD == 0) ? "Median" : "Trimmed Mean");
-            Serial.printf("  CRC Check: %s\n", BLE_RSSI_CRC_CHECK_ENABLED ? "Enabled" : "Disabled");
-            Serial.printf("  Max Beacons: %d\n", BLE_RSSI_MAX_BEACONS);
-            
-            // Task 2: Temporal filter configuration
-            if (BLE_TEMPORAL_FILTER_ENABLED) {
-                Serial.println("  🔄 Temporal Filter Configuration:");
-                Serial.printf("    Filter Type: %s\n", BLE_TEMPORAL_FILTER_TYPE == 0 ? "IIR Exponential" : "1D Kalman");
-                Serial.printf("    IIR Alpha: %.3f (runtime: %.3f)\n", (float)BLE_IIR_ALPHA, globalRSSISmoother.getIIRAlpha());
-                Serial.printf("    Kalman Q: %.3f (runtime: %.3f)\n", (float)BLE_KALMAN_PROCESS_NOISE, globalRSSISmoother.getKalmanQ());
-                Serial.printf("    Kalman R: %.3f (runtime: %.3f)\n", (float)BLE_KALMAN_MEASUREMENT_NOISE, globalRSSISmoother.getKalmanR());
-                Serial.printf("    Min Update: %d ms\n", BLE_FILTER_MIN_UPDATE_MS);
-                Serial.printf("    Convergence Time: %d ms\n", BLE_FILTER_CONVERGENCE_TIME);
-            } else {
-                Serial.println("  🚫 Temporal Filter: Disabled");
-            }
-            
-        // Task 2: Temporal filter commands
-        } else if (command == "filter-stats") {
-            Serial.println("📊 Temporal Filter Statistics:");
-            printTemporalFilterStats();
-            
-        } else if (command.startsWith("filter-alpha ")) {
-            String alphaStr = command.substring(13);
-            float alpha = alphaStr.toFloat();
-            if (alpha >= 0.0f && alpha <= 1.0f) {
-                globalRSSISmoother.setIIRAlpha(alpha);
-                Serial.printf("✅ IIR Alpha updated to: %.3f\n", alpha);
-            } else {
-                Serial.println("❌ Invalid alpha value (must be 0.0-1.0)");
-            }
-            
-        } else if (command.startsWith("filter-kalman ")) {
-            // Expected format: filter-kalman Q R
-            String params = command.substring(14);
-            int spaceIndex = params.indexOf(' ');
-            if (spaceIndex > 0) {
-                float q = params.substring(0, spaceIndex).toFloat();
-                float r = params.substring(spaceIndex + 1).toFloat();
-                if (q > 0.0f && r > 0.0f) {
-                    globalRSSISmoother.setKalmanParameters(q, r);
-                    Serial.printf("✅ Kalman parameters updated: Q=%.3f, R=%.3f\n", q, r);
-                } else {
-                    Serial.println("❌ Invalid parameters (must be > 0.0)");
-                }
-            } else {
-                Serial.println("❌ Usage: filter-kalman <Q> <R>");
-            }
-            
-        } else if (command.startsWith("filter-reset ")) {
-            String mac = command.substring(13);
-            globalRSSISmoother.resetFilter(mac.c_str());
-            Serial.printf("🔄 Filter reset for beacon: %s\n", mac.c_str());
-            
-        } else if (command == "filter-reset-all") {
-            globalRSSISmoother.resetAllFilters();
-            Serial.println("🔄 All temporal filters reset");
-            
-        } else if (command.startsWith("filter-distance ")) {
-            String mac = command.substring(16);
-            if (globalRSSISmoother.hasFilteredData(mac.c_str())) {
-                float filteredRssi = globalRSSISmoother.getFilteredRssi(mac.c_str());
-                float distance = globalRSSISmoother.getFilteredDistance(mac.c_str());
-                bool converged = globalRSSISmoother.isFilterConverged(mac.c_str());
-                FilterStats stats = globalRSSISmoother.getFilterStats(mac.c_str());
-                
-                Serial.printf("📏 Beacon %s:\n", mac.c_str());
-                Serial.printf("   Filtered RSSI: %.1f dBm\n", filteredRssi);
-                Serial.printf("   Distance: %.1f cm\n", distance);
-                Serial.printf("   Status: %s\n", converged ? "Converged" : "Converging");
-                Serial.printf("   Stats: %s\n", formatFilterStats(stats).c_str());
-            } else {
-                Serial.printf("❌ No filtered data for beacon: %s\n", mac.c_str());
-            }
-            
-        } else if (command == "filter-test") {
-            Serial.println("🧪 Running temporal filter unit tests...");
-            runTemporalFilterTests();
-            
-        } else if (command == "filter-help") {
-            Serial.println("🔧 Temporal Filter Commands:");
-            Serial.println("  filter-stats                - Show filter statistics");
-            Serial.println("  filter-alpha <value>        - Set IIR alpha (0.0-1.0)");
-            Serial.println("  filter-kalman <Q> <R>       - Set Kalman parameters");
-            Serial.println("  filter-reset <mac>          - Reset filter for beacon");
-            Serial.println("  filter-reset-all            - Reset all filters");
-            Serial.println("  filter-distance <mac>       - Show filtered distance");
-            Serial.println("  filter-test                 - Run unit tests");
-            Serial.println("  filter-config               - Show filter configuration");
-            
-        } else if (command == "help") {
-            Serial.println("🔧 Available Commands:");
-            Serial.println("  status             - Show system status");
-            Serial.println("  rssi-help          - RSSI smoother commands");
-            Serial.println("  filter-help        - Temporal filter commands");
-            Serial.println("  test-buzzer        - Test buzzer on GPIO 18");
-            Serial.println("  wifi-info          - WiFi connection info");
-            Serial.println("  ble-scan           - Force BLE scan");
-            Serial.println("  reboot             - Restart system");
-            
-        } else if (command == "status") {
-            printSystemStatus();
-            
-        } else if (command == "test-buzzer") {
-            Serial.println("🔊 Testing buzzer...");
-            testBuzzer(2000, 1000);
-            
-        } else if (command == "wifi-info") {
-            String ip = getCurrentIPAddress();
-            Serial.printf("📡 WiFi Status: %s\n", WiFi.isConnected() ? "Connected" : "Disconnected");
-            Serial.printf("🌐 IP Address: %s\n", ip.c_str());
-            if (WiFi.isConnected()) {
-                Serial.printf("🏷️ SSID: %s\n", WiFi.SSID().c_str());
-                Serial.printf("📶 Signal: %d dBm\n", WiFi.RSSI());
-            }
-            
-        } else if (command == "ble-scan") {
-            if (systemStateData.bleInitialized && pBLEScan) {
-                Serial.println("📡 Starting BLE scan...");
-                pBLEScan->start(BLE_SCAN_DURATION_SEC, false);
-                Serial.println("✅ BLE scan completed");
-            } else {
-                Serial.println("❌ BLE scanner not initialized");
-            }
-            
-        } else if (command == "reboot") {
-            Serial.println("🔄 Rebooting ESP32-S3...");
-            delay(1000);
-            ESP.restart();
-            
-        } else if (command.length() > 0) {
-            Serial.printf("❓ Unknown command: %s (type 'help' for commands)\n", command.c_str());
+        CommandStatus status = commandRegistry.dispatchLine(line);
+        if (status == CommandStatus::UNKNOWN) {
+            Serial.printf("❓ Unknown command: %s (type 'help' for commands)\n", commandRegistry.getLastName());
+        } else if (status == CommandStatus::NOT_ALLOWED) {
+            Serial.printf("❌ %s is not available from the serial console\n", commandRegistry.getLastName());
+        } else if (status == CommandStatus::PARSE_ERROR) {
+            Serial.printf("❌ %s: invalid JSON arguments\n", commandRegistry.getLastName());
         }
     }
 }
@@ -3040,30 +4863,65 @@ void handleSerialCommands() {
  * @brief Arduino main loop - Handle all system operations
  */
 void loop() {
+    systemStateManager.beginLoop();
     unsigned long currentTime = millis();
     
     // Handle serial commands for testing and debugging
-    handleSerialCommands();
+    {
+        PERF_SCOPE(SERIAL_COMMANDS);
+        HEAP_TAG(JSON);
+        handleSerialCommands();
+    }
     
     // Handle web server and WebSocket
     if (systemStateData.webServerRunning) {
+        PERF_SCOPE(WEB);
+        HEAP_TAG(WEBSOCKET);
+#if !FEATURE_ASYNC_WEBSERVER
         server.handleClient();
+#endif
+        refreshHttpSnapshots();
         webSocket.loop();
+        updateWebSocketStreams();
+        wsFanout.service();     // Queued frames, bounded by WS_SEND_BUDGET_MS
     }
     
     // Maintain MQTT cloud connection and telemetry
-    maintainMQTTConnection();
+    {
+        PERF_SCOPE(MQTT);
+        HEAP_TAG(MQTT);
+        maintainMQTTConnection();
+    }
+    
+    // Roam to a stronger access point before the link drops
+    {
+        PERF_SCOPE(WIFI_ROAMING);
+        serviceWiFiRoaming();
+    }
     
     // 🚀 CRITICAL: Process proximity-based triggering
     // This ensures that configured beacons trigger alerts when in range
-    beaconManager.processProximityTriggers();
+    {
+        PERF_SCOPE(PROXIMITY);
+        beaconManager.processProximityTriggers();
+    }
+    
+    // Write settings changes once they settle
+    {
+        PERF_SCOPE(SETTINGS);
+        collarSettings.service(currentTime);
+    }
     
     // Perform BLE scanning
     if (systemStateData.bleInitialized) {
         static unsigned long lastBLEScan = 0;
         if (currentTime - lastBLEScan >= BLE_SCAN_PERIOD) {
+            PERF_SCOPE(BLE_SCAN);
+            HEAP_TAG(BLE);
             try {
+                TRACE(BLE_SCAN_BEGIN, BLE_SCAN_DURATION, 0);
                 pBLEScan->start(BLE_SCAN_DURATION, false);
+                TRACE(BLE_SCAN_END, 0, 0);
                 pBLEScan->clearResults();
                 lastBLEScan = currentTime;
             } catch (const std::exception& e) {
@@ -3074,26 +4932,39 @@ void loop() {
     }
     
     // Update display
-    updateDisplay();
+    {
+        PERF_SCOPE(DISPLAY);
+        HEAP_TAG(DISPLAY);
+        updateDisplay();
+    }
     
     // Handle alert management
-    alertManager.update();
+    {
+        PERF_SCOPE(ALERTS);
+        alertManager.update();
+    }
     
     // System maintenance and monitoring
-    performSystemMaintenance();
-    
-    // Print periodic status
-    printSystemStatus();
-    
-    // Broadcast system status via WebSocket
-    sendSystemStatusBroadcastTimed();
+    {
+        PERF_SCOPE(MAINTENANCE);
+        performSystemMaintenance();
+    }
     
-    // Broadcast collar presence for discovery
-    if (systemStateData.wifiConnected && (currentTime - lastBroadcast > BROADCAST_INTERVAL)) {
-        broadcastCollarPresence();
-        lastBroadcast = currentTime;
+    // Print periodic status, broadcast it and announce the collar for discovery
+    {
+        PERF_SCOPE(STATUS);
+        HEAP_TAG(JSON);
+        printSystemStatus();
+        sendSystemStatusBroadcastTimed();
+        if (systemStateData.wifiConnected && (currentTime - lastBroadcast > BROADCAST_INTERVAL)) {
+            broadcastCollarPresence();
+            lastBroadcast = currentTime;
+        }
     }
     
+    // Loop time excludes the stability delay below
+    systemStateManager.endLoop();
+    
     // Watchdog and system stability
     delay(10); // Small delay for system stability
 } 
@@ -0,0 +1,432 @@
+/**
+ * @file alert_arbiter.cpp
+ * @brief Priority-preemptive arbitration between competing alert sources
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/AlertArbiter.h"
+#include "include/DeferredLog.h"
+
+// ==================== ARBITER IMPLEMENTATION ====================
+
+AlertArbiter::AlertArbiter() :
+    m_queueCount(0),
+    m_hasActive(false),
+    m_activeStartMs(0),
+    m_startHook(nullptr),
+    m_stopHook(nullptr),
+    m_hookContext(nullptr) {
+    for (uint8_t i = 0; i < (uint8_t)AlertSource::COUNT; i++) {
+        m_cooldownMs[i] = 0;
+        m_lastStartMs[i] = 0;
+        m_lastPriority[i] = AlertPriority::ALERT_LOW;
+        m_hasStarted[i] = false;
+    }
+
+    m_cooldownMs[(uint8_t)AlertSource::PROXIMITY] = ALERT_COOLDOWN_PROXIMITY_MS;
+    m_cooldownMs[(uint8_t)AlertSource::ZONE] = ALERT_COOLDOWN_ZONE_MS;
+    m_cooldownMs[(uint8_t)AlertSource::BATTERY] = ALERT_COOLDOWN_BATTERY_MS;
+    m_cooldownMs[(uint8_t)AlertSource::REMOTE] = ALERT_COOLDOWN_REMOTE_MS;
+
+    resetStats();
+}
+
+void AlertArbiter::setHooks(AlertStartFn start, AlertStopFn stop, void* context) {
+    m_startHook = start;
+    m_stopHook = stop;
+    m_hookContext = context;
+}
+
+void AlertArbiter::setCooldown(AlertSource source, uint32_t cooldownMs) {
+    if (source < AlertSource::COUNT) {
+        m_cooldownMs[(uint8_t)source] = cooldownMs;
+    }
+}
+
+ArbiterDecision AlertArbiter::submit(const AlertRequest& request, uint32_t nowMs) {
+    if (request.source >= AlertSource::COUNT) {
+        m_stats.dropped++;
+        return ArbiterDecision::DROPPED;
+    }
+
+    m_stats.submitted++;
+
+    AlertRequest incoming = request;
+    incoming.submittedMs = nowMs;
+    incoming.mergeCount = 0;
+
+    uint8_t src = (uint8_t)incoming.source;
+    bool merges = m_cooldownMs[src] > 0;
+
+    if (merges) {
+        // Same source already sounding: several beacons at once become one alert
+        if (m_hasActive && m_active.source == incoming.source &&
+            incoming.priority <= m_active.priority) {
+            m_active.mergeCount++;
+            m_stats.merged++;
+            return ArbiterDecision::MERGED;
+        }
+
+        // Same source already waiting: keep the strongest of the two requests
+        for (uint8_t i = 0; i < m_queueCount; i++) {
+            AlertRequest& queued = m_queue[i];
+            if (queued.source != incoming.source) {
+                continue;
+            }
+            if (incoming.priority > queued.priority) {
+                queued.priority = incoming.priority;
+                queued.reason = incoming.reason;
+                queued.mode = incoming.mode;
+                queued.pattern = incoming.pattern;
+                queued.frequency = incoming.frequency;
+            }
+            queued.intensity = max(queued.intensity, incoming.intensity);
+            queued.durationMs = max(queued.durationMs, incoming.durationMs);
+            queued.mergeCount++;
+            m_stats.merged++;
+            return ArbiterDecision::MERGED;
+        }
+
+        // Same source sounded recently at this priority or higher
+        if (m_hasStarted[src] && (nowMs - m_lastStartMs[src]) < m_cooldownMs[src] &&
+            incoming.priority <= m_lastPriority[src]) {
+            m_stats.merged++;
+            return ArbiterDecision::MERGED;
+        }
+    }
+
+    if (!m_hasActive) {
+        if (!startRequest(incoming, nowMs)) {
+            m_stats.dropped++;
+            return ArbiterDecision::DROPPED;
+        }
+        return ArbiterDecision::STARTED;
+    }
+
+    if (incoming.priority > m_active.priority) {
+        // Remember what is left of the displaced alert before replacing it
+        AlertRequest displaced = m_active;
+        uint32_t elapsed = nowMs - m_activeStartMs;
+        displaced.durationMs = elapsed < displaced.durationMs ? displaced.durationMs - elapsed : 0;
+
+        if (!startRequest(incoming, nowMs)) {
+            m_stats.dropped++;
+            return ArbiterDecision::DROPPED;
+        }
+        m_stats.preempted++;
+
+        if (displaced.source != incoming.source &&
+            displaced.durationMs >= ALERT_ARBITER_MIN_RESUME_MS &&
+            !enqueue(displaced)) {
+            // Queue full of alerts that outrank it: the rest of it is lost
+            m_stats.dropped++;
+            LOGW("🚦 Displaced %s alert dropped (%lums left, queue full)",
+                 alertSourceToString(displaced.source), (unsigned long)displaced.durationMs);
+        }
+        return ArbiterDecision::PREEMPTED;
+    }
+
+    if (!enqueue(incoming)) {
+        m_stats.dropped++;
+        return ArbiterDecision::DROPPED;
+    }
+    m_stats.queued++;
+    return ArbiterDecision::QUEUED;
+}
+
+void AlertArbiter::update(uint32_t nowMs, bool outputIdle) {
+    if (m_hasActive && outputIdle) {
+        m_hasActive = false;
+    }
+
+    expireQueue(nowMs);
+
+    while (!m_hasActive && m_queueCount > 0) {
+        int index = nextIndex();
+        AlertRequest next = m_queue[index];
+        removeAt(index);
+
+        if (!startRequest(next, nowMs)) {
+            m_stats.dropped++;
+        }
+    }
+}
+
+bool AlertArbiter::clear() {
+    bool hadAlerts = m_hasActive || m_queueCount > 0;
+
+    m_hasActive = false;
+    m_queueCount = 0;
+
+    if (m_stopHook) {
+        m_stopHook(m_hookContext);
+    }
+    return hadAlerts;
+}
+
+bool AlertArbiter::startRequest(const AlertRequest& request, uint32_t nowMs) {
+    if (!m_startHook || !m_startHook(request, m_hookContext)) {
+        return false;
+    }
+
+    uint8_t src = (uint8_t)request.source;
+    m_active = request;
+    m_hasActive = true;
+    m_activeStartMs = nowMs;
+    m_lastStartMs[src] = nowMs;
+    m_lastPriority[src] = request.priority;
+    m_hasStarted[src] = true;
+    m_stats.started++;
+    return true;
+}
+
+bool AlertArbiter::enqueue(const AlertRequest& request) {
+    if (m_queueCount < ALERT_ARBITER_QUEUE_SIZE) {
+        m_queue[m_queueCount++] = request;
+        return true;
+    }
+
+    // Full: evict the oldest of the lowest priority entries if the newcomer outranks it
+    uint8_t victim = 0;
+    for (uint8_t i = 1; i < m_queueCount; i++) {
+        if (m_queue[i].priority < m_queue[victim].priority ||
+            (m_queue[i].priority == m_queue[victim].priority &&
+             (int32_t)(m_queue[i].submittedMs - m_queue[victim].submittedMs) < 0)) {
+            victim = i;
+        }
+    }
+
+    if (m_queue[victim].priority >= request.priority) {
+        return false;
+    }
+
+    m_queue[victim] = request;
+    m_stats.dropped++;
+    return true;
+}
+
+int AlertArbiter::nextIndex() const {
+    int best = -1;
+    for (uint8_t i = 0; i < m_queueCount; i++) {
+        if (best < 0 ||
+            m_queue[i].priority > m_queue[best].priority ||
+            (m_queue[i].priority == m_queue[best].priority &&
+             (int32_t)(m_queue[i].submittedMs - m_queue[best].submittedMs) < 0)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+void AlertArbiter::removeAt(uint8_t index) {
+    for (uint8_t i = index; i + 1 < m_queueCount; i++) {
+        m_queue[i] = m_queue[i + 1];
+    }
+    m_queueCount--;
+}
+
+void AlertArbiter::expireQueue(uint32_t nowMs) {
+    uint8_t i = 0;
+    while (i < m_queueCount) {
+        if (nowMs - m_queue[i].submittedMs >= ALERT_ARBITER_QUEUE_TTL_MS) {
+            removeAt(i);
+            m_stats.expired++;
+        } else {
+            i++;
+        }
+    }
+}
+
+// ==================== FAKE-CLOCK UNIT TESTS ====================
+
+namespace {
+
+/**
+ * @brief Captures arbiter output calls instead of driving the alert engine
+ */
+struct FakeAlertOutput {
+    uint8_t starts;
+    uint8_t stops;
+    AlertRequest last;
+};
+
+bool recordFakeStart(const AlertRequest& request, void* context) {
+    FakeAlertOutput* out = static_cast<FakeAlertOutput*>(context);
+    out->starts++;
+    out->last = request;
+    return true;
+}
+
+void recordFakeStop(void* context) {
+    static_cast<FakeAlertOutput*>(context)->stops++;
+}
+
+AlertRequest makeRequest(AlertReason reason, uint32_t durationMs) {
+    AlertRequest request;
+    request.source = alertSourceForReason(reason);
+    request.reason = reason;
+    request.priority = alertPriorityForReason(reason);
+    request.durationMs = durationMs;
+    return request;
+}
+
+/**
+ * @brief A zone breach preempts proximity, which then resumes with its remaining time
+ */
+bool testPreemptAndResume() {
+    Serial.println("📊 Test 1: Higher priority preempts, displaced alert resumes");
+
+    AlertArbiter arbiter;
+    FakeAlertOutput out = {};
+    arbiter.setHooks(recordFakeStart, recordFakeStop, &out);
+
+    bool passed = arbiter.submit(makeRequest(AlertReason::PROXIMITY_DETECTED, 3000), 0) ==
+                  ArbiterDecision::STARTED;
+    passed = passed && arbiter.submit(makeRequest(AlertReason::ZONE_BREACH, 2000), 1000) ==
+                       ArbiterDecision::PREEMPTED;
+    passed = passed && out.last.source == AlertSource::ZONE && arbiter.getQueueCount() == 1;
+
+    // Zone alert still playing: nothing changes
+    arbiter.update(2000, false);
+    passed = passed && out.starts == 2;
+
+    // Zone alert finished: proximity resumes for the 2000ms it had left
+    arbiter.update(3000, true);
+    passed = passed && out.starts == 3 && out.last.source == AlertSource::PROXIMITY &&
+             out.last.durationMs == 2000 && arbiter.getQueueCount() == 0;
+    passed = passed && out.stops == 0;
+
+    Serial.printf("   Starts: %u, resumed duration: %lums\n", out.starts, (unsigned long)out.last.durationMs);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Several beacons triggering together produce one alert
+ */
+bool testBurstMerging() {
+    Serial.println("📊 Test 2: Simultaneous proximity triggers merge within cooldown");
+
+    AlertArbiter arbiter;
+    FakeAlertOutput out = {};
+    arbiter.setHooks(recordFakeStart, recordFakeStop, &out);
+
+    uint8_t started = 0;
+    uint8_t merged = 0;
+    for (uint32_t t = 0; t < 50; t += 10) {
+        ArbiterDecision decision = arbiter.submit(makeRequest(AlertReason::PROXIMITY_DETECTED, 1000), t);
+        if (decision == ArbiterDecision::STARTED) started++;
+        if (decision == ArbiterDecision::MERGED) merged++;
+    }
+
+    bool passed = started == 1 && merged == 4 && out.starts == 1 &&
+                  arbiter.getActive().mergeCount == 4;
+
+    // Finished, but still inside the proximity cooldown window
+    arbiter.update(1000, true);
+    passed = passed && !arbiter.hasActive();
+    passed = passed && arbiter.submit(makeRequest(AlertReason::PROXIMITY_DETECTED, 1000), 2000) ==
+                       ArbiterDecision::MERGED;
+
+    // A higher priority request from the same source is never suppressed
+    AlertRequest urgent = makeRequest(AlertReason::PROXIMITY_DETECTED, 1000);
+    urgent.priority = AlertPriority::ALERT_HIGH;
+    passed = passed && arbiter.submit(urgent, 2500) == ArbiterDecision::STARTED;
+
+    arbiter.update(3500, true);
+    passed = passed && arbiter.submit(makeRequest(AlertReason::PROXIMITY_DETECTED, 1000),
+                                      2500 + ALERT_COOLDOWN_PROXIMITY_MS) == ArbiterDecision::STARTED;
+
+    Serial.printf("   Burst of 5: %u started, %u merged\n", started, merged);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Lower priority requests queue, expire, and overflow by priority
+ */
+bool testQueueing() {
+    Serial.println("📊 Test 3: Queueing, expiry, overflow and clear");
+
+    AlertArbiter arbiter;
+    FakeAlertOutput out = {};
+    arbiter.setHooks(recordFakeStart, recordFakeStop, &out);
+
+    bool passed = arbiter.submit(makeRequest(AlertReason::REMOTE_COMMAND, 60000), 0) ==
+                  ArbiterDecision::STARTED;
+    passed = passed && arbiter.submit(makeRequest(AlertReason::LOW_BATTERY, 1000), 100) ==
+                       ArbiterDecision::QUEUED;
+
+    // Still waiting after the TTL: dropped instead of played late
+    arbiter.update(100 + ALERT_ARBITER_QUEUE_TTL_MS, false);
+    passed = passed && arbiter.getQueueCount() == 0 && arbiter.getStats().expired == 1;
+
+    // Fill the queue with low priority local alerts, then overflow it
+    uint32_t t = 20000;
+    for (uint8_t i = 0; i < ALERT_ARBITER_QUEUE_SIZE; i++, t++) {
+        AlertRequest low = makeRequest(AlertReason::MANUAL_TEST, 500);
+        low.priority = AlertPriority::ALERT_LOW;
+        passed = passed && arbiter.submit(low, t) == ArbiterDecision::QUEUED;
+    }
+
+    AlertRequest low = makeRequest(AlertReason::MANUAL_TEST, 500);
+    low.priority = AlertPriority::ALERT_LOW;
+    passed = passed && arbiter.submit(low, t++) == ArbiterDecision::DROPPED;
+    passed = passed && arbiter.submit(makeRequest(AlertReason::MANUAL_TEST, 500), t++) ==
+                       ArbiterDecision::QUEUED;
+    passed = passed && arbiter.getQueueCount() == ALERT_ARBITER_QUEUE_SIZE;
+
+    // The NORMAL entry plays first once the remote alert finishes
+    arbiter.update(t, true);
+    passed = passed && out.last.priority == AlertPriority::NORMAL;
+
+    passed = passed && arbiter.clear() && out.stops == 1 &&
+             !arbiter.hasActive() && arbiter.getQueueCount() == 0;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A displaced alert that finds the queue full of equal or higher priority is counted
+ */
+bool testDisplacedOverflow() {
+    Serial.println("📊 Test 4: Displaced alert dropped by a full queue is counted");
+
+    AlertArbiter arbiter;
+    FakeAlertOutput out = {};
+    arbiter.setHooks(recordFakeStart, recordFakeStop, &out);
+
+    bool passed = arbiter.submit(makeRequest(AlertReason::PROXIMITY_DETECTED, 3000), 0) ==
+                  ArbiterDecision::STARTED;
+    for (uint8_t i = 0; i < ALERT_ARBITER_QUEUE_SIZE; i++) {
+        passed = passed && arbiter.submit(makeRequest(AlertReason::MANUAL_TEST, 500), 1 + i) ==
+                           ArbiterDecision::QUEUED;
+    }
+
+    // Proximity has 2000ms left but every queued alert is as important
+    passed = passed && arbiter.submit(makeRequest(AlertReason::ZONE_BREACH, 2000), 1000) ==
+                       ArbiterDecision::PREEMPTED;
+    passed = passed && arbiter.getQueueCount() == ALERT_ARBITER_QUEUE_SIZE &&
+             arbiter.getStats().dropped == 1 && arbiter.getStats().preempted == 1;
+
+    Serial.printf("   Dropped: %lu\n", (unsigned long)arbiter.getStats().dropped);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runAlertArbiterTests() {
+    Serial.println("\n🧪 Running Alert Arbiter Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testPreemptAndResume();
+    passed &= testBurstMerging();
+    passed &= testQueueing();
+    passed &= testDisplacedOverflow();
+
+    Serial.printf("\n%s Alert Arbiter Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
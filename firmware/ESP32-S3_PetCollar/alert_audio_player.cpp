@@ -0,0 +1,263 @@
+/**
+ * @file alert_audio_player.cpp
+ * @brief I2S PDM waveform playback for the buzzer
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/AlertAudioPlayer.h"
+
+#if FEATURE_BUZZER_WAVEFORM
+
+// ==================== PLAYER IMPLEMENTATION ====================
+
+AlertAudioPlayer::AlertAudioPlayer() :
+    m_channel(nullptr),
+    m_task(nullptr),
+    m_pendingClip(ALERT_AUDIO_STOP),
+    m_pendingRepeats(0),
+    m_pendingLevel(0),
+    m_pendingFrequency(0),
+    m_pendingDurationMs(0),
+    m_generation(0),
+    m_playing(false),
+    m_maxRenderUs(0),
+    m_arena(nullptr) {
+    portMUX_INITIALIZE(&m_mux);
+    memset(m_clips, 0, sizeof(m_clips));
+}
+
+bool AlertAudioPlayer::begin(uint8_t buzzerPin) {
+    // One cycle of every library waveform plus the tone loop, rendered on first use
+    uint32_t arenaSamples = WAVEFORM_TONE_LOOP_SAMPLES;
+    for (uint8_t i = 0; i < WAVEFORM_PATTERN_COUNT; i++) {
+        arenaSamples += waveCycleSamples(getWavePattern(i));
+    }
+
+    m_arena = psramFound() ? (int16_t*)ps_malloc(arenaSamples * sizeof(int16_t)) : nullptr;
+    if (!m_arena) {
+        Serial.printf("❌ Alert audio: no PSRAM for %lu KB of samples\n",
+                     (unsigned long)(arenaSamples * sizeof(int16_t) / 1024));
+        return false;
+    }
+
+    int16_t* next = m_arena;
+    for (uint8_t i = 0; i <= WAVEFORM_PATTERN_COUNT; i++) {
+        uint32_t capacity = i == ALERT_AUDIO_TONE ? WAVEFORM_TONE_LOOP_SAMPLES
+                                                  : waveCycleSamples(getWavePattern(i));
+        m_clips[i] = {next, capacity, 0, 0, 0};
+        next += capacity;
+    }
+
+    i2s_chan_config_t chanConfig = I2S_CHANNEL_DEFAULT_CONFIG(WAVEFORM_I2S_PORT, I2S_ROLE_MASTER);
+    chanConfig.dma_desc_num = WAVEFORM_DMA_DESCRIPTORS;
+    chanConfig.dma_frame_num = WAVEFORM_DMA_FRAMES;
+    chanConfig.auto_clear = true;  // Underruns play silence, not stale samples
+
+    if (i2s_new_channel(&chanConfig, &m_channel, nullptr) != ESP_OK) {
+        m_channel = nullptr;
+        free(m_arena);
+        m_arena = nullptr;
+        Serial.println("❌ Alert audio: I2S channel unavailable");
+        return false;
+    }
+
+    i2s_pdm_tx_config_t pdmConfig = {
+        .clk_cfg = I2S_PDM_TX_CLK_DEFAULT_CONFIG(WAVEFORM_SAMPLE_RATE_HZ),
+        .slot_cfg = I2S_PDM_TX_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO),
+        .gpio_cfg = {
+            .clk = (gpio_num_t)WAVEFORM_PDM_CLK_PIN,
+            .dout = (gpio_num_t)buzzerPin,
+            .dout2 = I2S_GPIO_UNUSED,
+            .invert_flags = {
+                .clk_inv = false,
+            },
+        },
+    };
+
+    if (i2s_channel_init_pdm_tx_mode(m_channel, &pdmConfig) != ESP_OK) {
+        i2s_del_channel(m_channel);
+        m_channel = nullptr;
+        free(m_arena);
+        m_arena = nullptr;
+        Serial.println("❌ Alert audio: PDM TX init failed");
+        return false;
+    }
+
+    if (xTaskCreate(&AlertAudioPlayer::feederTask, "alert_audio", WAVEFORM_TASK_STACK,
+                    this, WAVEFORM_TASK_PRIORITY, &m_task) != pdPASS) {
+        m_task = nullptr;
+        i2s_del_channel(m_channel);
+        m_channel = nullptr;
+        free(m_arena);
+        m_arena = nullptr;
+        Serial.println("❌ Alert audio: feeder task create failed");
+        return false;
+    }
+
+    Serial.printf("🎵 Alert audio: PDM on GPIO %u, %u Hz, %lu KB sample cache\n", buzzerPin,
+                 WAVEFORM_SAMPLE_RATE_HZ, (unsigned long)(arenaSamples * sizeof(int16_t) / 1024));
+    return true;
+}
+
+bool AlertAudioPlayer::playPattern(const WavePattern* pattern, uint8_t repeats, uint8_t level) {
+    if (!isReady() || !pattern || pattern->count == 0) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < WAVEFORM_PATTERN_COUNT; i++) {
+        if (getWavePattern(i) == pattern) {
+            submit(i, repeats, level, 0, 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AlertAudioPlayer::playTone(uint16_t frequency, uint16_t durationMs, uint8_t level) {
+    if (!isReady() || frequency == 0 || durationMs == 0) {
+        return false;
+    }
+    submit(ALERT_AUDIO_TONE, 1, level, frequency, durationMs);
+    return true;
+}
+
+void AlertAudioPlayer::stop() {
+    if (!isReady()) {
+        return;
+    }
+    submit(ALERT_AUDIO_STOP, 0, 0, 0, 0);
+}
+
+void AlertAudioPlayer::submit(uint8_t clip, uint8_t repeats, uint8_t level,
+                              uint16_t frequency, uint16_t durationMs) {
+    portENTER_CRITICAL(&m_mux);
+    m_pendingClip = clip;
+    m_pendingRepeats = repeats;
+    m_pendingLevel = level;
+    m_pendingFrequency = frequency;
+    m_pendingDurationMs = durationMs;
+    m_generation++;
+    m_playing = clip != ALERT_AUDIO_STOP;
+    portEXIT_CRITICAL(&m_mux);
+
+    xTaskNotifyGive(m_task);
+}
+
+bool AlertAudioPlayer::prepareClip(uint8_t index, uint16_t frequency, uint8_t level) {
+    AlertAudioClip& clip = m_clips[index];
+    bool tone = index == ALERT_AUDIO_TONE;
+    if (clip.length > 0 && clip.level == level && (!tone || clip.frequency == frequency)) {
+        return true;
+    }
+
+    int64_t startUs = esp_timer_get_time();
+    clip.length = tone ? renderToneLoop(frequency, level, clip.samples, clip.capacity)
+                       : renderWaveCycle(getWavePattern(index), level, clip.samples, clip.capacity);
+    clip.frequency = frequency;
+    clip.level = level;
+
+    uint32_t renderUs = (uint32_t)(esp_timer_get_time() - startUs);
+    if (renderUs > m_maxRenderUs) {
+        m_maxRenderUs = renderUs;
+    }
+    return clip.length > 0;
+}
+
+void AlertAudioPlayer::feederTask(void* arg) {
+    static_cast<AlertAudioPlayer*>(arg)->runFeeder();
+}
+
+void AlertAudioPlayer::runFeeder() {
+    const uint32_t rampSamples = WaveformRenderer::samplesFor(WAVEFORM_RAMP_MS);
+    uint32_t seenGeneration = 0;
+    bool enabled = false;
+    size_t written = 0;
+
+    // Stream state: samples [0, total) of the clip repeated end to end
+    const AlertAudioClip* clip = nullptr;
+    uint32_t position = 0;
+    uint32_t total = 0;         // 0 = until stopped
+    bool ramped = false;        // Tone loops get their attack/release here
+
+    for (;;) {
+        if (!clip && !enabled) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        // Pick up the latest command; anything older is superseded
+        uint8_t next = ALERT_AUDIO_STOP;
+        uint8_t repeats = 0, level = 0;
+        uint16_t frequency = 0, durationMs = 0;
+        bool changed = false;
+
+        portENTER_CRITICAL(&m_mux);
+        if (m_generation != seenGeneration) {
+            seenGeneration = m_generation;
+            next = m_pendingClip;
+            repeats = m_pendingRepeats;
+            level = m_pendingLevel;
+            frequency = m_pendingFrequency;
+            durationMs = m_pendingDurationMs;
+            changed = true;
+        }
+        portEXIT_CRITICAL(&m_mux);
+
+        if (changed) {
+            clip = nullptr;
+            if (next != ALERT_AUDIO_STOP && prepareClip(next, frequency, level)) {
+                clip = &m_clips[next];
+                position = 0;
+                ramped = next == ALERT_AUDIO_TONE;
+                total = ramped ? WaveformRenderer::samplesFor(durationMs) : repeats * clip->length;
+                if (!enabled) {
+                    enabled = i2s_channel_enable(m_channel) == ESP_OK;
+                }
+            }
+        }
+
+        if (clip) {
+            // Hand DMA a slice of the prerendered clip; only the few tone
+            // samples inside a ramp are touched on the way
+            uint32_t offset = position % clip->length;
+            uint32_t count = min(clip->length - offset, (uint32_t)WAVEFORM_DMA_FRAMES);
+            if (total > 0) {
+                count = min(count, total - position);
+            }
+
+            const int16_t* samples = clip->samples + offset;
+            if (ramped && (position < rampSamples || position + count + rampSamples > total)) {
+                memcpy(m_block, samples, count * sizeof(int16_t));
+                applyToneRamp(m_block, count, position, total);
+                samples = m_block;
+            }
+
+            // Blocks until DMA has a free buffer; the CPU is idle meanwhile
+            i2s_channel_write(m_channel, samples, count * sizeof(int16_t), &written, portMAX_DELAY);
+            position += count;
+            if (total > 0 && position >= total) {
+                clip = nullptr;
+            }
+            continue;
+        }
+
+        if (enabled) {
+            // Flush silence through the DMA ring, then release the pin
+            memset(m_block, 0, sizeof(m_block));
+            for (uint8_t i = 0; i < WAVEFORM_DMA_DESCRIPTORS; i++) {
+                i2s_channel_write(m_channel, m_block, sizeof(m_block), &written, portMAX_DELAY);
+            }
+            i2s_channel_disable(m_channel);
+            enabled = false;
+        }
+
+        // Finished unless a new command arrived while flushing
+        portENTER_CRITICAL(&m_mux);
+        if (m_generation == seenGeneration) {
+            m_playing = false;
+        }
+        portEXIT_CRITICAL(&m_mux);
+    }
+}
+
+#endif // FEATURE_BUZZER_WAVEFORM
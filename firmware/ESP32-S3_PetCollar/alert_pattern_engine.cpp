@@ -0,0 +1,278 @@
+/**
+ * @file alert_pattern_engine.cpp
+ * @brief esp_timer-driven playback of compiled alert step tables
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/AlertPatternEngine.h"
+
+// ==================== ENGINE IMPLEMENTATION ====================
+
+AlertPatternEngine::AlertPatternEngine() :
+    m_timer(nullptr),
+    m_buzzerPin(0),
+    m_vibrationPin(0),
+    m_resolutionBits(8),
+    m_attached(false),
+    m_generation(0),
+    m_timerErrors(0),
+    m_lastBuzzerFreq(0),
+    m_lastBuzzerDuty(-1),
+    m_lastVibrationDuty(-1),
+    m_outputHook(nullptr),
+    m_outputContext(nullptr) {
+    portMUX_INITIALIZE(&m_mux);
+}
+
+AlertPatternEngine::~AlertPatternEngine() {
+    if (m_timer) {
+        esp_timer_stop(m_timer);
+        esp_timer_delete(m_timer);
+        m_timer = nullptr;
+    }
+}
+
+bool AlertPatternEngine::begin(uint8_t buzzerPin, uint8_t vibrationPin,
+                               uint32_t buzzerFreq, uint32_t vibrationFreq, uint8_t resolutionBits) {
+    m_buzzerPin = buzzerPin;
+    m_vibrationPin = vibrationPin;
+    m_resolutionBits = resolutionBits;
+
+    if ((buzzerPin != ALERT_ENGINE_NO_PIN && !ledcAttach(buzzerPin, buzzerFreq, resolutionBits)) ||
+        !ledcAttach(vibrationPin, vibrationFreq, resolutionBits)) {
+        Serial.println("❌ Alert engine: LEDC attach failed");
+        return false;
+    }
+
+    m_attached = true;
+    m_lastBuzzerFreq = buzzerFreq;
+    applyOutputs(0, 0, 0);
+
+    if (!m_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = &AlertPatternEngine::onTimer;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "alert_pattern";
+
+        if (esp_timer_create(&args, &m_timer) != ESP_OK) {
+            m_timer = nullptr;
+            Serial.println("❌ Alert engine: esp_timer create failed");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool AlertPatternEngine::play(const PatternStep* steps, uint8_t count, uint8_t repeats, int64_t nowUs) {
+    if (!PatternSequencer::isValid(steps, count)) {
+        return false;
+    }
+
+    if (nowUs < 0) {
+        nowUs = esp_timer_get_time();
+    }
+
+    portENTER_CRITICAL(&m_mux);
+    m_sequencer.start(steps, count, repeats, nowUs);
+    m_generation++;
+    portEXIT_CRITICAL(&m_mux);
+
+    if (m_timer) {
+        kick();
+    } else {
+        advance(nowUs);
+    }
+    return true;
+}
+
+void AlertPatternEngine::stop() {
+    portENTER_CRITICAL(&m_mux);
+    m_sequencer.stop();
+    m_generation++;
+    portEXIT_CRITICAL(&m_mux);
+
+    if (m_timer) {
+        kick();
+    } else {
+        applyOutputs(0, 0, 0);
+    }
+}
+
+int64_t AlertPatternEngine::advance(int64_t nowUs) {
+    PatternStep current;
+
+    portENTER_CRITICAL(&m_mux);
+    int64_t nextDeadline = m_sequencer.advance(nowUs, current);
+    portEXIT_CRITICAL(&m_mux);
+
+    applyOutputs(current.buzzerFreq, current.buzzerDuty, current.vibrationDuty);
+    return nextDeadline;
+}
+
+void AlertPatternEngine::setOutputHook(PatternOutputFn hook, void* context) {
+    m_outputHook = hook;
+    m_outputContext = context;
+    m_lastBuzzerDuty = -1;
+    m_lastVibrationDuty = -1;
+}
+
+void AlertPatternEngine::onTimer(void* arg) {
+    AlertPatternEngine* engine = static_cast<AlertPatternEngine*>(arg);
+
+    portENTER_CRITICAL(&engine->m_mux);
+    uint32_t generation = engine->m_generation;
+    portEXIT_CRITICAL(&engine->m_mux);
+
+    engine->scheduleAt(engine->advance(esp_timer_get_time()), generation);
+}
+
+void AlertPatternEngine::scheduleAt(int64_t deadlineUs, uint32_t generation) {
+    if (!m_timer || deadlineUs < 0) {
+        return;
+    }
+
+    // play()/stop() ran while this callback was in flight and kicked the
+    // timer for the new generation; re-arming here would fight that kick
+    portENTER_CRITICAL(&m_mux);
+    bool stale = generation != m_generation;
+    portEXIT_CRITICAL(&m_mux);
+    if (stale) {
+        return;
+    }
+
+    int64_t delayUs = deadlineUs - esp_timer_get_time();
+    if (delayUs < 0) {
+        delayUs = 0;
+    }
+
+    // ESP_ERR_INVALID_STATE: a kick() armed the timer since the check above
+    // and owns the next callback
+    esp_err_t err = esp_timer_start_once(m_timer, (uint64_t)delayUs);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        m_timerErrors++;
+    }
+}
+
+void AlertPatternEngine::kick() {
+    // Outputs are only ever written from the timer task, so play()/stop()
+    // hand the first write over instead of racing a callback in flight.
+    // A timer still armed for the previous generation is replaced
+    esp_err_t err = esp_timer_start_once(m_timer, 0);
+    if (err == ESP_ERR_INVALID_STATE) {
+        esp_timer_stop(m_timer);
+        err = esp_timer_start_once(m_timer, 0);
+    }
+    if (err != ESP_OK) {
+        m_timerErrors++;
+        Serial.printf("❌ Alert engine: timer start failed (%s)\n", esp_err_to_name(err));
+    }
+}
+
+void AlertPatternEngine::applyOutputs(uint16_t buzzerFreq, uint8_t buzzerDuty, uint8_t vibrationDuty) {
+    bool freqChanged = buzzerDuty > 0 && buzzerFreq != 0 && buzzerFreq != m_lastBuzzerFreq;
+    bool buzzerChanged = freqChanged || buzzerDuty != m_lastBuzzerDuty;
+    bool vibrationChanged = vibrationDuty != m_lastVibrationDuty;
+
+    if (!buzzerChanged && !vibrationChanged) {
+        return;
+    }
+
+    if (freqChanged) {
+        m_lastBuzzerFreq = buzzerFreq;
+    }
+    m_lastBuzzerDuty = buzzerDuty;
+    m_lastVibrationDuty = vibrationDuty;
+
+    if (m_outputHook) {
+        m_outputHook(m_lastBuzzerFreq, buzzerDuty, vibrationDuty, m_outputContext);
+        return;
+    }
+
+    if (!m_attached) {
+        return;
+    }
+
+    if (m_buzzerPin != ALERT_ENGINE_NO_PIN) {
+        if (freqChanged) {
+            ledcChangeFrequency(m_buzzerPin, buzzerFreq, m_resolutionBits);
+        }
+        if (buzzerChanged) {
+            ledcWrite(m_buzzerPin, scaleDuty(buzzerDuty));
+        }
+    }
+    if (vibrationChanged) {
+        ledcWrite(m_vibrationPin, scaleDuty(vibrationDuty));
+    }
+}
+
+uint32_t AlertPatternEngine::scaleDuty(uint8_t duty) const {
+    if (m_resolutionBits == 8) {
+        return duty;
+    }
+    uint32_t maxDuty = (1UL << m_resolutionBits) - 1;
+    return ((uint32_t)duty * maxDuty) / 255;
+}
+
+// ==================== HARDWARE SMOKE TEST ====================
+
+namespace {
+
+/**
+ * @brief Counts engine outputs instead of driving LEDC
+ */
+struct SmokeOutput {
+    volatile uint16_t writes;
+    volatile uint8_t buzzerDuty;
+};
+
+void recordSmokeOutput(uint16_t buzzerFreq, uint8_t buzzerDuty, uint8_t vibrationDuty, void* context) {
+    (void)buzzerFreq;
+    (void)vibrationDuty;
+    SmokeOutput* out = static_cast<SmokeOutput*>(context);
+    out->buzzerDuty = buzzerDuty;
+    out->writes++;
+}
+
+} // namespace
+
+bool runAlertPatternEngineSmokeTest(AlertPatternEngine& engine) {
+    Serial.println("\n🧪 Alert pattern engine smoke test (real esp_timer, outputs muted)...\n");
+
+    if (engine.isPlaying()) {
+        Serial.println("   ⚠️ An alert is playing - try again when it ends");
+        return false;
+    }
+
+    // Two passes of on/off/on: 7 output writes ending in silence
+    const PatternStep steps[] = {
+        {20, 2000, 200, 0},
+        {20, 0,    0,   0},
+        {20, 3000, 255, 0}
+    };
+    SmokeOutput out = {};
+    uint32_t timerErrors = engine.getTimerErrors();
+
+    engine.resetStats();
+    engine.setOutputHook(recordSmokeOutput, &out);
+    bool passed = engine.play(steps, 3, 2);
+
+    uint32_t startMs = millis();
+    while (engine.isPlaying() && millis() - startMs < 500) {
+        delay(5);
+    }
+    delay(5);   // Final silence is written just after isPlaying() clears
+    passed = passed && !engine.isPlaying();
+    engine.setOutputHook(nullptr);
+
+    passed = passed && out.writes == 7 && out.buzzerDuty == 0 &&
+             engine.getTimerErrors() == timerErrors && engine.getMaxLatenessUs() <= 1000;
+
+    Serial.printf("   Writes: %u, max lateness: %u us, timer errors: %u\n",
+                  out.writes, engine.getMaxLatenessUs(), engine.getTimerErrors() - timerErrors);
+    Serial.printf("   Result: %s (timing logic is covered by tools/alert_engine_test)\n\n",
+                  passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
@@ -0,0 +1,286 @@
+/**
+ * @file alert_waveforms.cpp
+ * @brief Buzzer waveform library and block renderer (no Arduino dependencies)
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/AlertWaveforms.h"
+
+// ==================== SINE TABLE ====================
+
+// One period, 256 points, Q15
+static const int16_t WAVE_SINE_TABLE[256] = {
+         0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+      6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+     12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+     18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+     23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+     27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+     30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+     32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+     32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+     32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+     30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+     27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+     23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+     18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+     12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+      6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+         0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+     -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+    -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+    -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+    -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+    -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+    -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+    -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+     -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804,
+};
+
+// ==================== PATTERN LIBRARY ====================
+
+// Segment durations mirror the LEDC shapes in manager_implementations.cpp so
+// vibration (still driven by the pattern engine) stays in step with audio
+
+static const WaveSegment WAVE_CONTINUOUS[] = {
+    {WAVE_TONE, 1000, 2000, 0, 255}
+};
+
+static const WaveSegment WAVE_PULSE_SLOW[] = {
+    {WAVE_TONE, 500, 2000, 0, 255}, {WAVE_SILENCE, 500, 0, 0, 0}
+};
+
+static const WaveSegment WAVE_PULSE_FAST[] = {
+    {WAVE_CHIRP, 125, 1800, 2800, 255}, {WAVE_SILENCE, 125, 0, 0, 0}
+};
+
+static const WaveSegment WAVE_TRIPLE_BEEP[] = {
+    {WAVE_TWO_TONE, 150, 2000, 2500, 255}, {WAVE_SILENCE, 100, 0, 0, 0},
+    {WAVE_TWO_TONE, 150, 2000, 2500, 255}, {WAVE_SILENCE, 100, 0, 0, 0},
+    {WAVE_TWO_TONE, 150, 2500, 3000, 255}, {WAVE_SILENCE, 600, 0, 0, 0}
+};
+
+static const WaveSegment WAVE_SOS[] = {
+    {WAVE_TONE, 150, 2200, 0, 255}, {WAVE_SILENCE, 150, 0, 0, 0},
+    {WAVE_TONE, 150, 2200, 0, 255}, {WAVE_SILENCE, 150, 0, 0, 0},
+    {WAVE_TONE, 150, 2200, 0, 255}, {WAVE_SILENCE, 450, 0, 0, 0},
+    {WAVE_TONE, 450, 2200, 0, 255}, {WAVE_SILENCE, 150, 0, 0, 0},
+    {WAVE_TONE, 450, 2200, 0, 255}, {WAVE_SILENCE, 150, 0, 0, 0},
+    {WAVE_TONE, 450, 2200, 0, 255}, {WAVE_SILENCE, 450, 0, 0, 0},
+    {WAVE_TONE, 150, 2200, 0, 255}, {WAVE_SILENCE, 150, 0, 0, 0},
+    {WAVE_TONE, 150, 2200, 0, 255}, {WAVE_SILENCE, 150, 0, 0, 0},
+    {WAVE_TONE, 150, 2200, 0, 255}, {WAVE_SILENCE, 1050, 0, 0, 0}
+};
+
+// Rising sweeps at rising level, matching the 75/90/110/125% pitch steps
+static const WaveSegment WAVE_ESCALATING[] = {
+    {WAVE_CHIRP, 400, 1300, 1500, 64},  {WAVE_SILENCE, 100, 0, 0, 0},
+    {WAVE_CHIRP, 400, 1600, 1800, 128}, {WAVE_SILENCE, 100, 0, 0, 0},
+    {WAVE_CHIRP, 400, 2000, 2200, 192}, {WAVE_SILENCE, 100, 0, 0, 0},
+    {WAVE_CHIRP, 400, 2300, 2600, 255}, {WAVE_SILENCE, 100, 0, 0, 0}
+};
+
+#define WAVE_PATTERN(name, table) {name, table, (uint8_t)(sizeof(table) / sizeof(table[0]))}
+
+// Indexed by AlertPattern value
+static const WavePattern WAVE_LIBRARY[WAVEFORM_PATTERN_COUNT] = {
+    WAVE_PATTERN("continuous", WAVE_CONTINUOUS),
+    WAVE_PATTERN("pulse_slow", WAVE_PULSE_SLOW),
+    WAVE_PATTERN("pulse_fast", WAVE_PULSE_FAST),
+    WAVE_PATTERN("triple_beep", WAVE_TRIPLE_BEEP),
+    WAVE_PATTERN("sos", WAVE_SOS),
+    WAVE_PATTERN("escalating", WAVE_ESCALATING)
+};
+
+const WavePattern* getWavePattern(uint8_t patternId) {
+    if (patternId >= WAVEFORM_PATTERN_COUNT) {
+        return nullptr;
+    }
+    return &WAVE_LIBRARY[patternId];
+}
+
+uint32_t waveCycleDurationMs(const WavePattern* pattern) {
+    uint32_t total = 0;
+    if (!pattern) return 0;
+    for (uint8_t i = 0; i < pattern->count; i++) {
+        total += pattern->segments[i].durationMs;
+    }
+    return total;
+}
+
+uint32_t waveCycleSamples(const WavePattern* pattern) {
+    return WaveformRenderer::samplesFor(waveCycleDurationMs(pattern));
+}
+
+size_t renderWaveCycle(const WavePattern* pattern, uint8_t level, int16_t* out, size_t capacity) {
+    WaveformRenderer renderer;
+    if (!pattern || waveCycleSamples(pattern) > capacity ||
+        !renderer.start(pattern->segments, pattern->count, 1, level)) {
+        return 0;
+    }
+    return renderer.render(out, capacity);
+}
+
+// ==================== TONE LOOPS ====================
+
+static inline uint32_t phaseIncrement(uint32_t frequency) {
+    return (uint32_t)(((uint64_t)frequency << 32) / WAVEFORM_SAMPLE_RATE_HZ);
+}
+
+static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b) {
+    while (b != 0) {
+        uint32_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+size_t renderToneLoop(uint16_t frequency, uint8_t level, int16_t* out, size_t capacity) {
+    if (frequency == 0) {
+        return 0;
+    }
+
+    // Shortest span holding a whole number of periods; it starts and ends on
+    // phase 0, so back-to-back copies join without a seam
+    uint32_t period = WAVEFORM_SAMPLE_RATE_HZ / greatestCommonDivisor(frequency, WAVEFORM_SAMPLE_RATE_HZ);
+    if (period > capacity) {
+        return 0;
+    }
+
+    size_t length = capacity - capacity % period;
+    uint32_t increment = phaseIncrement(frequency);
+    int32_t gain = ((int32_t)255 * level) >> 8;  // Same scale as a full-level segment
+    for (size_t i = 0; i < length; i++) {
+        // Phase from the index, not an accumulator, so truncation error cannot
+        // build up; advanced before the lookup like WaveformRenderer
+        uint32_t phase = (uint32_t)((uint64_t)increment * (i % period + 1));
+        out[i] = (int16_t)(((int32_t)WAVE_SINE_TABLE[phase >> 24] * gain) >> 8);
+    }
+    return length;
+}
+
+void applyToneRamp(int16_t* samples, size_t count, uint32_t first, uint32_t total) {
+    const uint32_t rampSamples = WaveformRenderer::samplesFor(WAVEFORM_RAMP_MS);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = first + i;
+        uint32_t edge = index < total - index - 1 ? index : total - index - 1;
+        if (edge < rampSamples) {
+            samples[i] = (int16_t)((int32_t)samples[i] * (int32_t)edge / (int32_t)rampSamples);
+        }
+    }
+}
+
+// ==================== RENDERER IMPLEMENTATION ====================
+
+WaveformRenderer::WaveformRenderer() :
+    m_segments(nullptr),
+    m_count(0),
+    m_repeats(0),
+    m_pass(0),
+    m_level(0),
+    m_segment(0),
+    m_sample(0),
+    m_segmentSamples(0),
+    m_phaseA(0),
+    m_phaseB(0),
+    m_active(false) {
+}
+
+bool WaveformRenderer::start(const WaveSegment* segments, uint8_t count, uint8_t repeats, uint8_t level) {
+    if (!segments || count == 0) {
+        return false;
+    }
+
+    m_segments = segments;
+    m_count = count;
+    m_repeats = repeats;
+    m_level = level;
+    m_pass = 0;
+    m_segment = 0;
+    m_phaseA = 0;
+    m_phaseB = 0;
+    m_active = true;
+    loadSegment();
+    return true;
+}
+
+void WaveformRenderer::loadSegment() {
+    m_sample = 0;
+    m_segmentSamples = samplesFor(m_segments[m_segment].durationMs);
+}
+
+size_t WaveformRenderer::render(int16_t* out, size_t maxSamples) {
+    const uint32_t rampSamples = samplesFor(WAVEFORM_RAMP_MS);
+    size_t written = 0;
+
+    while (m_active && written < maxSamples) {
+        if (m_sample >= m_segmentSamples) {
+            // Advance to the next segment, wrapping into the next pass
+            if (++m_segment >= m_count) {
+                m_segment = 0;
+                m_pass++;
+                if (m_repeats != WAVEFORM_REPEAT_FOREVER && m_pass >= m_repeats) {
+                    m_active = false;
+                    break;
+                }
+            }
+            loadSegment();
+            continue;
+        }
+
+        const WaveSegment& seg = m_segments[m_segment];
+        uint32_t span = m_segmentSamples - m_sample;
+        if (span > maxSamples - written) {
+            span = maxSamples - written;
+        }
+
+        if (seg.type == WAVE_SILENCE || seg.level == 0 || m_level == 0) {
+            for (uint32_t i = 0; i < span; i++) {
+                out[written++] = 0;
+            }
+            m_sample += span;
+            continue;
+        }
+
+        uint32_t incA = phaseIncrement(seg.freqA);
+        uint32_t incB = phaseIncrement(seg.freqB);
+        int32_t gain = ((int32_t)seg.level * m_level) >> 8;  // 0-254
+
+        for (uint32_t i = 0; i < span; i++, m_sample++) {
+            int32_t value;
+            if (seg.type == WAVE_CHIRP) {
+                int64_t delta = (int64_t)incB - (int64_t)incA;
+                m_phaseA += incA + (int32_t)(delta * m_sample / m_segmentSamples);
+                value = WAVE_SINE_TABLE[m_phaseA >> 24];
+            } else if (seg.type == WAVE_TWO_TONE) {
+                m_phaseA += incA;
+                m_phaseB += incB;
+                value = ((int32_t)WAVE_SINE_TABLE[m_phaseA >> 24] +
+                         (int32_t)WAVE_SINE_TABLE[m_phaseB >> 24]) / 2;
+            } else {
+                m_phaseA += incA;
+                value = WAVE_SINE_TABLE[m_phaseA >> 24];
+            }
+
+            // Linear attack/release ramps remove the clicks of hard edges
+            uint32_t edge = m_sample < m_segmentSamples - m_sample - 1 ?
+                            m_sample : m_segmentSamples - m_sample - 1;
+            if (edge < rampSamples) {
+                value = value * (int32_t)edge / (int32_t)rampSamples;
+            }
+
+            out[written++] = (int16_t)((value * gain) >> 8);
+        }
+    }
+
+    return written;
+}
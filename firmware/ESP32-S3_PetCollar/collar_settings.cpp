@@ -0,0 +1,341 @@
+/**
+ * @file collar_settings.cpp
+ * @brief Typed settings record with schema migration and debounced saves
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/CollarSettings.h"
+#include "include/TelemetryCodec.h"
+
+#include <stddef.h>
+
+#define TERMINATE(field) (field)[sizeof(field) - 1] = '\0'
+
+// ==================== SCHEMA ====================
+
+void defaultCollarSettings(CollarSettings& settings) {
+    memset(&settings, 0, sizeof(settings));
+    settings.telemetryFormat = (uint8_t)TelemetryFormat::JSON;
+    settings.deadbandRssiDbm = TELEMETRY_DEADBAND_RSSI_DBM;
+    settings.keyframeInterval = TELEMETRY_KEYFRAME_INTERVAL;
+    settings.keyframeMaxMs = TELEMETRY_KEYFRAME_MAX_MS;
+    settings.deadbandHeapBytes = TELEMETRY_DEADBAND_HEAP_BYTES;
+    settings.deadbandPositionM = TELEMETRY_DEADBAND_POSITION_M;
+    settings.deadbandConfidence = TELEMETRY_DEADBAND_CONFIDENCE;
+    settings.iirAlpha = BLE_IIR_ALPHA;
+    settings.kalmanQ = BLE_KALMAN_PROCESS_NOISE;
+    settings.kalmanR = BLE_KALMAN_MEASUREMENT_NOISE;
+}
+
+bool migrateCollarSettings(CollarSettings& settings, const void* data, size_t length, uint16_t version) {
+    defaultCollarSettings(settings);
+    if (version == 0 || version > COLLAR_SETTINGS_VERSION || !data) {
+        return false;
+    }
+
+    // Fields appended after this record's version keep their defaults
+    memcpy(&settings, data, length < sizeof(settings) ? length : sizeof(settings));
+
+    // Per-version fixups go here as the schema grows, oldest first:
+    //   if (version < 2) { ... }
+
+    // Never trust a stored string to be terminated
+    TERMINATE(settings.wifiSsid);
+    TERMINATE(settings.wifiPassword);
+    if (settings.proximityCount > SETTINGS_MAX_PROXIMITY) {
+        settings.proximityCount = SETTINGS_MAX_PROXIMITY;
+    }
+    for (uint8_t i = 0; i < settings.proximityCount; i++) {
+        ProximitySetting& proximity = settings.proximity[i];
+        TERMINATE(proximity.beaconId);
+        TERMINATE(proximity.beaconName);
+        TERMINATE(proximity.macAddress);
+        TERMINATE(proximity.alertMode);
+    }
+    return true;
+}
+
+uint32_t proximitySettingHash(const ProximitySetting& proximity) {
+    char canonical[160];
+    int length = snprintf(canonical, sizeof(canonical), "%s|%s|%s|%s|%u|%lu|%u|%u|%lu|%lu",
+                          proximity.beaconId, proximity.beaconName, proximity.macAddress,
+                          proximity.alertMode, proximity.triggerDistance,
+                          (unsigned long)proximity.alertDuration, proximity.alertIntensity,
+                          proximity.enableProximityDelay ? 1 : 0,
+                          (unsigned long)proximity.proximityDelayTime,
+                          (unsigned long)proximity.cooldownPeriod);
+    if (length < 0) {
+        return 0;
+    }
+    if ((size_t)length >= sizeof(canonical)) {
+        length = sizeof(canonical) - 1;
+    }
+
+    uint32_t hash = 2166136261UL;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)canonical[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+uint32_t proximitySetHash(const CollarSettings& settings) {
+    uint32_t hash = 0;
+    for (uint8_t i = 0; i < settings.proximityCount && i < SETTINGS_MAX_PROXIMITY; i++) {
+        hash += proximitySettingHash(settings.proximity[i]);
+    }
+    return hash;
+}
+
+// ==================== STORE IMPLEMENTATION ====================
+
+CollarSettingsStore::CollarSettingsStore() :
+    m_loaded(false),
+    m_newerRecord(false),
+    m_loadedVersion(0),
+    m_dirty(false),
+    m_changedMs(0) {
+    defaultCollarSettings(m_settings);
+}
+
+bool CollarSettingsStore::begin(OutboxStorage* storage) {
+    m_loaded = false;
+    m_newerRecord = false;
+    m_loadedVersion = 0;
+    m_dirty = false;
+    defaultCollarSettings(m_settings);
+    if (!m_store.begin(storage) || !m_store.hasRecord()) {
+        return false;
+    }
+
+    m_loadedVersion = m_store.getVersion();
+    if (m_loadedVersion > COLLAR_SETTINGS_VERSION) {
+        m_newerRecord = true;   // Keep it for the firmware that wrote it
+        return false;
+    }
+
+    // Static: the record is too big for the setup() stack
+    static CollarSettings stored;
+    size_t length = m_store.load(&stored, sizeof(stored));
+    m_loaded = length > 0 && migrateCollarSettings(m_settings, &stored, length, m_loadedVersion);
+    return m_loaded;
+}
+
+CollarSettings& CollarSettingsStore::edit(uint32_t nowMs) {
+    m_dirty = true;
+    m_changedMs = nowMs;
+    return m_settings;
+}
+
+void CollarSettingsStore::service(uint32_t nowMs) {
+    if (!m_dirty || nowMs - m_changedMs < SETTINGS_SAVE_DELAY_MS) {
+        return;
+    }
+    if (!saveNow()) {
+        m_changedMs = nowMs;    // Try again after another delay
+    }
+}
+
+bool CollarSettingsStore::saveNow() {
+    if (!m_dirty) {
+        return true;
+    }
+    if (!m_store.isReady() || m_newerRecord) {
+        m_dirty = false;        // Nowhere to save: settings last until reboot
+        return false;
+    }
+    if (!m_store.save(&m_settings, sizeof(m_settings), COLLAR_SETTINGS_VERSION)) {
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+const size_t TEST_SECTOR_SIZE = 4096;
+const size_t TEST_SECTORS = 2;
+const uint32_t PROXIMITY_HASH_REFERENCE = 0xD8CA9298UL;  // "beacon-1|Kitchen|AA:BB:CC:DD:EE:FF|buzzer|5|2000|3|0|0|5000"
+
+/**
+ * @brief Changes are written once they settle and come back after a reboot
+ */
+bool testDebouncedSaveAndReload() {
+    Serial.println("📊 Test 1: Debounced save and reload");
+
+    uint8_t* flash = new uint8_t[TEST_SECTOR_SIZE * TEST_SECTORS];
+    memset(flash, 0xFF, TEST_SECTOR_SIZE * TEST_SECTORS);
+    RamOutboxStorage storage(flash, TEST_SECTOR_SIZE * TEST_SECTORS, TEST_SECTOR_SIZE);
+
+    static CollarSettingsStore store;     // Records are too big for the loop stack
+    bool passed = !store.begin(&storage) && store.get().iirAlpha == BLE_IIR_ALPHA;
+
+    // A burst of edits (a beacon batch) makes one record
+    for (uint8_t i = 0; i < 5; i++) {
+        CollarSettings& settings = store.edit(1000 + i * 100);
+        snprintf(settings.proximity[i].beaconId, sizeof(settings.proximity[i].beaconId), "beacon-%u", i);
+        settings.proximityCount = i + 1;
+    }
+    store.edit(1400).iirAlpha = 0.3f;
+    store.service(1400 + SETTINGS_SAVE_DELAY_MS - 1);
+    passed = passed && store.isDirty() && store.getStats().saves == 0;
+    store.service(1400 + SETTINGS_SAVE_DELAY_MS);
+    passed = passed && !store.isDirty() && store.getStats().saves == 1;
+
+    static CollarSettingsStore rebooted;
+    passed = passed && rebooted.begin(&storage) && rebooted.getLoadedVersion() == COLLAR_SETTINGS_VERSION &&
+             memcmp(&rebooted.get(), &store.get(), sizeof(CollarSettings)) == 0 &&
+             rebooted.get().proximityCount == 5 && strcmp(rebooted.get().proximity[4].beaconId, "beacon-4") == 0;
+
+    delete[] flash;
+    Serial.printf("   Record: %u bytes, %u per sector\n", (unsigned)sizeof(CollarSettings),
+                 (unsigned)(TEST_SECTOR_SIZE / (sizeof(CollarSettings) + CONFIG_STORE_HEADER_SIZE)));
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Older (shorter) records keep defaults for appended fields; newer ones are refused
+ */
+bool testMigration() {
+    Serial.println("📊 Test 2: Schema migration");
+
+    static CollarSettings stored;
+    defaultCollarSettings(stored);
+    strlcpy(stored.wifiSsid, "HomeAP", sizeof(stored.wifiSsid));
+    stored.kalmanQ = 2.5f;
+    stored.proximityCount = 3;
+
+    // A record that ends before the fast-connect record was added
+    static CollarSettings settings;
+    size_t oldLength = offsetof(CollarSettings, wifiFast);
+    bool passed = migrateCollarSettings(settings, &stored, oldLength, 1) &&
+                  strcmp(settings.wifiSsid, "HomeAP") == 0 && settings.kalmanQ == 2.5f &&
+                  settings.proximityCount == 0;
+
+    // A record from newer firmware is not guessed at
+    passed = passed && !migrateCollarSettings(settings, &stored, sizeof(stored), COLLAR_SETTINGS_VERSION + 1) &&
+             settings.wifiSsid[0] == '\0' && settings.kalmanQ == BLE_KALMAN_PROCESS_NOISE;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A newer record survives a boot of older firmware, edits included
+ */
+bool testNewerRecordKept() {
+    Serial.println("📊 Test 3: Newer record stays on flash");
+
+    uint8_t* flash = new uint8_t[TEST_SECTOR_SIZE * TEST_SECTORS];
+    memset(flash, 0xFF, TEST_SECTOR_SIZE * TEST_SECTORS);
+    RamOutboxStorage storage(flash, TEST_SECTOR_SIZE * TEST_SECTORS, TEST_SECTOR_SIZE);
+
+    static CollarSettings newer;
+    defaultCollarSettings(newer);
+    strlcpy(newer.wifiSsid, "FutureAP", sizeof(newer.wifiSsid));
+    ConfigStore writer;
+    bool passed = writer.begin(&storage) &&
+                  writer.save(&newer, sizeof(newer), COLLAR_SETTINGS_VERSION + 1);
+
+    // Boot this firmware: defaults in RAM, edits never reach flash
+    static CollarSettingsStore store;
+    passed = passed && !store.begin(&storage) && store.hasNewerRecord() &&
+             store.getLoadedVersion() == COLLAR_SETTINGS_VERSION + 1 && store.get().wifiSsid[0] == '\0';
+    store.edit(0).kalmanQ = 9.0f;
+    store.service(SETTINGS_SAVE_DELAY_MS);
+    store.edit(SETTINGS_SAVE_DELAY_MS).kalmanR = 9.0f;
+    passed = passed && !store.saveNow() && !store.isDirty() && store.getStats().saves == 0 &&
+             store.get().kalmanQ == 9.0f && store.get().kalmanR == 9.0f;
+
+    // The newer firmware still finds its record
+    ConfigStore reader;
+    static CollarSettings reloaded;
+    passed = passed && reader.begin(&storage) && reader.getVersion() == COLLAR_SETTINGS_VERSION + 1 &&
+             reader.load(&reloaded, sizeof(reloaded)) == sizeof(reloaded) &&
+             strcmp(reloaded.wifiSsid, "FutureAP") == 0;
+
+    delete[] flash;
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Unterminated strings and out-of-range counts are repaired
+ */
+bool testSanitizing() {
+    Serial.println("📊 Test 4: Damaged fields are repaired");
+
+    static CollarSettings stored;
+    memset(&stored, 'A', sizeof(stored));
+    stored.proximityCount = 200;
+
+    static CollarSettings settings;
+    bool passed = migrateCollarSettings(settings, &stored, sizeof(stored), COLLAR_SETTINGS_VERSION) &&
+                  strlen(settings.wifiSsid) == sizeof(settings.wifiSsid) - 1 &&
+                  settings.proximityCount == SETTINGS_MAX_PROXIMITY &&
+                  strlen(settings.proximity[SETTINGS_MAX_PROXIMITY - 1].alertMode) ==
+                      sizeof(settings.proximity[0].alertMode) - 1;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Proximity hashes match the dashboard's and ignore order
+ */
+bool testProximityHash() {
+    Serial.println("📊 Test 5: Proximity config set hash");
+
+    static CollarSettings settings;
+    defaultCollarSettings(settings);
+    ProximitySetting& first = settings.proximity[0];
+    strlcpy(first.beaconId, "beacon-1", sizeof(first.beaconId));
+    strlcpy(first.beaconName, "Kitchen", sizeof(first.beaconName));
+    strlcpy(first.macAddress, "AA:BB:CC:DD:EE:FF", sizeof(first.macAddress));
+    strlcpy(first.alertMode, "buzzer", sizeof(first.alertMode));
+    first.triggerDistance = 5;
+    first.alertDuration = 2000;
+    first.alertIntensity = 3;
+    first.cooldownPeriod = 5000;
+    ProximitySetting& second = settings.proximity[1];
+    second = first;
+    strlcpy(second.beaconId, "beacon-2", sizeof(second.beaconId));
+    second.enableProximityDelay = 1;
+    second.proximityDelayTime = 1500;
+    settings.proximityCount = 2;
+
+    // Reference value from src/lib/proximity-sync.ts
+    uint32_t hash = proximitySetHash(settings);
+    bool passed = proximitySettingHash(first) == PROXIMITY_HASH_REFERENCE;
+
+    ProximitySetting swapped = first;
+    first = second;
+    second = swapped;
+    passed = passed && proximitySetHash(settings) == hash;
+
+    second.cooldownPeriod = 5001;
+    passed = passed && proximitySetHash(settings) != hash;
+
+    Serial.printf("   Set hash: %08lx\n", (unsigned long)hash);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runCollarSettingsTests() {
+    Serial.println("\n🧪 Running Settings Store Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testDebouncedSaveAndReload();
+    passed &= testMigration();
+    passed &= testNewerRecordKept();
+    passed &= testSanitizing();
+    passed &= testProximityHash();
+
+    Serial.printf("\n%s Settings Store Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
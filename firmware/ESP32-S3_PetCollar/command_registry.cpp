@@ -0,0 +1,396 @@
+/**
+ * @file command_registry.cpp
+ * @brief Shared command table for WebSocket, MQTT and serial
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/CommandRegistry.h"
+#include <ctype.h>
+
+// ==================== REGISTRY IMPLEMENTATION ====================
+
+CommandRegistry::CommandRegistry() :
+    m_table(nullptr),
+    m_count(0),
+    m_lastName(""),
+    m_busy(false) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool CommandRegistry::begin(const CommandEntry* table, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        if (strcmp(table[i - 1].name, table[i].name) >= 0) {
+            Serial.printf("❌ Command table out of order at '%s'\n", table[i].name);
+            return false;
+        }
+    }
+    m_table = table;
+    m_count = count;
+    return true;
+}
+
+const CommandEntry* CommandRegistry::find(const char* name) const {
+    size_t low = 0;
+    size_t high = m_count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int order = strcmp(name, m_table[mid].name);
+        if (order == 0) {
+            return &m_table[mid];
+        }
+        if (order < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return nullptr;
+}
+
+CommandStatus CommandRegistry::run(CommandSource source, uint8_t clientNum, const char* name,
+                                   JsonVariantConst args, const char* text) {
+    m_lastName = name;
+    const CommandEntry* entry = find(name);
+    if (!entry) {
+        m_stats.unknown++;
+        return CommandStatus::UNKNOWN;
+    }
+    if (!(entry->sources & source)) {
+        m_stats.rejected++;
+        return CommandStatus::NOT_ALLOWED;
+    }
+
+    uint16_t arenaBytes = (uint16_t)m_arena.memoryUsage();
+    if (arenaBytes > m_stats.maxArenaBytes) {
+        m_stats.maxArenaBytes = arenaBytes;
+    }
+
+    CommandContext ctx;
+    ctx.source = source;
+    ctx.clientNum = clientNum;
+    ctx.name = entry->name;
+    ctx.args = args;
+    ctx.text = text;
+
+    uint32_t startUs = micros();
+    m_busy = true;
+    entry->handler(ctx);
+    m_busy = false;
+    uint32_t elapsedUs = micros() - startUs;
+
+    m_stats.dispatched++;
+    if (elapsedUs > m_stats.maxHandlerUs) {
+        m_stats.maxHandlerUs = elapsedUs;
+    }
+    return CommandStatus::OK;
+}
+
+CommandStatus CommandRegistry::dispatchJson(CommandSource source, uint8_t clientNum, char* json,
+                                            size_t length, const char* nameKey,
+                                            const char* fallbackName) {
+    if (m_busy) {
+        return CommandStatus::BUSY;
+    }
+    m_lastName = "";
+
+    // char* input: ArduinoJson points into the caller's buffer instead of copying strings
+    m_arena.clear();
+    if (deserializeJson(m_arena, json, length) != DeserializationError::Ok) {
+        m_stats.parseErrors++;
+        return CommandStatus::PARSE_ERROR;
+    }
+
+    const char* name = m_arena[nameKey].as<const char*>();
+    if (!name) {
+        name = fallbackName;
+    }
+    if (!name || !*name) {
+        return CommandStatus::NO_COMMAND;
+    }
+    return run(source, clientNum, name, m_arena.as<JsonVariantConst>(), "");
+}
+
+CommandStatus CommandRegistry::dispatchLine(char* line) {
+    if (m_busy) {
+        return CommandStatus::BUSY;
+    }
+    m_lastName = "";
+    m_arena.clear();
+
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    size_t length = strlen(line);
+    while (length > 0 && isspace((unsigned char)line[length - 1])) {
+        line[--length] = '\0';
+    }
+    if (length == 0) {
+        return CommandStatus::NO_COMMAND;
+    }
+
+    // Name ends at the first space; the rest is the argument text
+    char* text = line;
+    while (*text && *text != ' ') {
+        *text = tolower((unsigned char)*text);
+        text++;
+    }
+    if (*text) {
+        *text++ = '\0';
+        while (*text == ' ') {
+            text++;
+        }
+    }
+
+    JsonVariantConst args;
+    const char* textArgs = text;
+    if (*text == '{') {
+        // Parsed in place: the text now holds the unescaped strings
+        if (deserializeJson(m_arena, text) != DeserializationError::Ok) {
+            m_lastName = line;
+            m_stats.parseErrors++;
+            return CommandStatus::PARSE_ERROR;
+        }
+        args = m_arena.as<JsonVariantConst>();
+        textArgs = "";
+    } else {
+        // Serial commands have always been case-insensitive
+        for (char* c = text; *c; c++) {
+            *c = tolower((unsigned char)*c);
+        }
+    }
+
+    return run(CMD_SRC_SERIAL, 0, line, args, textArgs);
+}
+
+void CommandRegistry::printHelp(uint8_t sources, const char* prefix) const {
+    size_t prefixLength = prefix ? strlen(prefix) : 0;
+    for (size_t i = 0; i < m_count; i++) {
+        const CommandEntry& entry = m_table[i];
+        if (!(entry.sources & sources)) {
+            continue;
+        }
+        if (prefixLength > 0 && strncmp(entry.name, prefix, prefixLength) != 0) {
+            continue;
+        }
+        char synopsis[48];
+        snprintf(synopsis, sizeof(synopsis), "%s%s%s", entry.name,
+                 entry.usage[0] ? " " : "", entry.usage);
+        Serial.printf("  %-27s - %s\n", synopsis, entry.help);
+    }
+}
+
+const char* commandStatusToString(CommandStatus status) {
+    switch (status) {
+        case CommandStatus::OK:          return "ok";
+        case CommandStatus::UNKNOWN:     return "unknown command";
+        case CommandStatus::NOT_ALLOWED: return "not available from this source";
+        case CommandStatus::PARSE_ERROR: return "invalid JSON";
+        case CommandStatus::NO_COMMAND:  return "no command";
+        case CommandStatus::BUSY:        return "busy";
+        default:                         return "unknown";
+    }
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+/**
+ * @brief What the last test handler saw
+ */
+struct HandlerProbe {
+    uint8_t calls;
+    CommandSource source;
+    uint8_t clientNum;
+    const char* name;
+    const char* text;
+    const char* beacon;     ///< args["beacon"]
+    int value;              ///< args["value"]
+    CommandStatus nested;
+};
+
+HandlerProbe probe;
+
+void recordCommand(const CommandContext& ctx) {
+    probe.calls++;
+    probe.source = ctx.source;
+    probe.clientNum = ctx.clientNum;
+    probe.name = ctx.name;
+    probe.text = ctx.text;
+    probe.beacon = ctx.args["beacon"].as<const char*>();
+    probe.value = ctx.args["value"] | -1;
+}
+
+CommandRegistry* nestedRegistry = nullptr;
+
+void dispatchNested(const CommandContext& ctx) {
+    char line[] = "get_status";
+    probe.calls++;
+    probe.nested = nestedRegistry->dispatchLine(line);
+}
+
+// Sorted by strcmp: '-' < '_' < letters
+const CommandEntry TEST_TABLE[] = {
+    {"alert-queue",  recordCommand,  CMD_SRC_SERIAL,                    "",      "Serial only"},
+    {"get_status",   recordCommand,  CMD_SRC_WEBSOCKET | CMD_SRC_SERIAL, "",      "WebSocket and serial"},
+    {"locate",       recordCommand,  CMD_SRC_MQTT,                      "",      "MQTT subtopic"},
+    {"nested",       dispatchNested, CMD_SRC_ALL,                       "",      "Dispatches again"},
+    {"rssi-get",     recordCommand,  CMD_SRC_ALL,                       "<mac>", "Text argument"},
+    {"test-alert",   recordCommand,  CMD_SRC_MQTT | CMD_SRC_SERIAL,     "",      "JSON arguments"},
+};
+
+const size_t TEST_TABLE_SIZE = sizeof(TEST_TABLE) / sizeof(TEST_TABLE[0]);
+
+void resetProbe() {
+    memset(&probe, 0, sizeof(probe));
+}
+
+/**
+ * @brief Every name is found by binary search and unsorted tables are refused
+ */
+bool testLookup(CommandRegistry& registry) {
+    Serial.println("📊 Test 1: Sorted table lookup");
+
+    bool passed = registry.begin(TEST_TABLE, TEST_TABLE_SIZE);
+    for (size_t i = 0; i < TEST_TABLE_SIZE; i++) {
+        passed = passed && registry.find(TEST_TABLE[i].name) == &TEST_TABLE[i];
+    }
+    passed = passed && registry.find("reboot") == nullptr && registry.find("") == nullptr &&
+             registry.find("zzz") == nullptr;
+
+    static CommandRegistry unsorted;
+    const CommandEntry reversed[] = {TEST_TABLE[1], TEST_TABLE[0]};
+    passed = passed && !unsorted.begin(reversed, 2) && unsorted.getCount() == 0;
+
+    Serial.printf("   %u entries found, unsorted table refused\n", (unsigned)registry.getCount());
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief WebSocket and MQTT messages reach the handler with their arguments, in place
+ */
+bool testJsonDispatch(CommandRegistry& registry) {
+    Serial.println("📊 Test 2: JSON dispatch from WebSocket and MQTT");
+
+    resetProbe();
+    char wsMessage[] = "{\"command\":\"get_status\",\"beacon\":\"Kitchen\",\"value\":7}";
+    CommandStatus status = registry.dispatchJson(CMD_SRC_WEBSOCKET, 3, wsMessage, strlen(wsMessage),
+                                                 "command");
+    bool passed = status == CommandStatus::OK && probe.calls == 1 &&
+                  probe.source == CMD_SRC_WEBSOCKET && probe.clientNum == 3 &&
+                  strcmp(probe.name, "get_status") == 0 && probe.value == 7 &&
+                  probe.beacon && strcmp(probe.beacon, "Kitchen") == 0;
+    // Zero-copy: the argument string lives in the caller's buffer
+    passed = passed && probe.beacon >= wsMessage && probe.beacon < wsMessage + sizeof(wsMessage);
+
+    // MQTT: "cmd" key, or the subtopic name when there is none
+    char mqttCmd[] = "{\"cmd\":\"test-alert\",\"value\":3}";
+    status = registry.dispatchJson(CMD_SRC_MQTT, 0, mqttCmd, strlen(mqttCmd), "cmd", "buzz");
+    passed = passed && status == CommandStatus::OK && strcmp(probe.name, "test-alert") == 0 &&
+             probe.value == 3;
+    char mqttLocate[] = "{}";
+    status = registry.dispatchJson(CMD_SRC_MQTT, 0, mqttLocate, strlen(mqttLocate), "cmd", "locate");
+    passed = passed && status == CommandStatus::OK && strcmp(probe.name, "locate") == 0 &&
+             probe.value == -1 && probe.calls == 3;
+
+    // Source mask, unknown name, bad JSON, missing name
+    char wsLocate[] = "{\"command\":\"locate\"}";
+    passed = passed && registry.dispatchJson(CMD_SRC_WEBSOCKET, 0, wsLocate, strlen(wsLocate),
+                                             "command") == CommandStatus::NOT_ALLOWED;
+    char wsUnknown[] = "{\"command\":\"format_flash\"}";
+    passed = passed && registry.dispatchJson(CMD_SRC_WEBSOCKET, 0, wsUnknown, strlen(wsUnknown),
+                                             "command") == CommandStatus::UNKNOWN &&
+             strcmp(registry.getLastName(), "format_flash") == 0;
+    char broken[] = "{\"command\":";
+    passed = passed && registry.dispatchJson(CMD_SRC_WEBSOCKET, 0, broken, strlen(broken),
+                                             "command") == CommandStatus::PARSE_ERROR;
+    char nameless[] = "{\"value\":1}";
+    passed = passed && registry.dispatchJson(CMD_SRC_WEBSOCKET, 0, nameless, strlen(nameless),
+                                             "command") == CommandStatus::NO_COMMAND;
+    passed = passed && probe.calls == 3;
+
+    const CommandStats& stats = registry.getStats();
+    Serial.printf("   Dispatched %lu, unknown %lu, rejected %lu, parse errors %lu, arena peak %u bytes\n",
+                 (unsigned long)stats.dispatched, (unsigned long)stats.unknown,
+                 (unsigned long)stats.rejected, (unsigned long)stats.parseErrors, stats.maxArenaBytes);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Serial lines split into name plus text or JSON arguments
+ */
+bool testSerialLines(CommandRegistry& registry) {
+    Serial.println("📊 Test 3: Serial line parsing");
+
+    resetProbe();
+    char textLine[] = "  RSSI-Get AA:BB:CC:DD:EE:FF \r\n";
+    bool passed = registry.dispatchLine(textLine) == CommandStatus::OK &&
+                  probe.source == CMD_SRC_SERIAL && strcmp(probe.name, "rssi-get") == 0 &&
+                  strcmp(probe.text, "aa:bb:cc:dd:ee:ff") == 0 && probe.beacon == nullptr;
+
+    char jsonLine[] = "test-alert {\"beacon\":\"Yard\",\"value\":200}";
+    passed = passed && registry.dispatchLine(jsonLine) == CommandStatus::OK &&
+             strcmp(probe.name, "test-alert") == 0 && probe.value == 200 &&
+             probe.beacon && strcmp(probe.beacon, "Yard") == 0 && probe.text[0] == '\0';
+
+    char bare[] = "alert-queue";
+    passed = passed && registry.dispatchLine(bare) == CommandStatus::OK &&
+             strcmp(probe.name, "alert-queue") == 0 && probe.text[0] == '\0';
+
+    char empty[] = "   \r\n";
+    char mqttOnly[] = "locate";
+    char badJson[] = "test-alert {\"value\":";
+    passed = passed && registry.dispatchLine(empty) == CommandStatus::NO_COMMAND &&
+             registry.dispatchLine(mqttOnly) == CommandStatus::NOT_ALLOWED &&
+             registry.dispatchLine(badJson) == CommandStatus::PARSE_ERROR &&
+             strcmp(registry.getLastName(), "test-alert") == 0;
+    passed = passed && probe.calls == 3;
+
+    Serial.printf("   %u lines run (text, JSON, bare); empty, MQTT-only and bad JSON refused\n",
+                 probe.calls);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A handler cannot re-enter the registry while the arena is in use
+ */
+bool testReentry(CommandRegistry& registry) {
+    Serial.println("📊 Test 4: Nested dispatch is refused");
+
+    resetProbe();
+    nestedRegistry = &registry;
+    char line[] = "nested";
+    bool passed = registry.dispatchLine(line) == CommandStatus::OK && probe.calls == 1 &&
+                  probe.nested == CommandStatus::BUSY;
+
+    // The registry is usable again afterwards
+    char again[] = "get_status";
+    passed = passed && registry.dispatchLine(again) == CommandStatus::OK && probe.calls == 2;
+    nestedRegistry = nullptr;
+
+    Serial.printf("   Nested dispatch returned: %s\n", commandStatusToString(probe.nested));
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runCommandRegistryTests() {
+    Serial.println("\n🧪 Running Command Registry Unit Tests...\n");
+
+    // Static: the argument arena does not belong on the loop task stack
+    static CommandRegistry registry;
+
+    bool passed = true;
+    passed &= testLookup(registry);
+    passed &= testJsonDispatch(registry);
+    passed &= testSerialLines(registry);
+    passed &= testReentry(registry);
+
+    Serial.printf("\n%s Command Registry Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
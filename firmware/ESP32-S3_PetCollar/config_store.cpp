@@ -0,0 +1,241 @@
+/**
+ * @file config_store.cpp
+ * @brief Wear-leveled log of versioned settings records (no Arduino dependencies)
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/ConfigStore.h"
+
+#include <string.h>
+
+// ==================== LOG FORMAT ====================
+//
+// Sector:  [record] [record] ... [0xFF...]
+// Record:  [header 16 bytes] [payload] [pad to 4 bytes]
+//
+// The payload is written before the header, so a record torn by a reset
+// has no magic and ends its sector. The write position only follows the
+// current record if the rest of that sector is still erased.
+
+#define CONFIG_RECORD_MAGIC         0x31474643UL   // "CFG1"
+#define CONFIG_ERASED_WORD          0xFFFFFFFFUL
+#define CONFIG_CRC_CHUNK            32
+
+struct ConfigRecordHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t generation;
+    uint32_t crc;           ///< CRC-32 of version, length, generation and payload
+};
+
+static_assert(sizeof(ConfigRecordHeader) == CONFIG_STORE_HEADER_SIZE, "Config record header layout");
+
+static uint32_t recordSize(uint16_t length) {
+    return (CONFIG_STORE_HEADER_SIZE + length + 3) & ~3UL;
+}
+
+/**
+ * @brief CRC-32 (IEEE, reflected), chainable
+ */
+static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+// ==================== STORE IMPLEMENTATION ====================
+
+ConfigStore::ConfigStore() :
+    m_storage(nullptr),
+    m_sectorCount(0),
+    m_sectorSize(0),
+    m_found(false),
+    m_sector(0),
+    m_offset(0),
+    m_version(0),
+    m_length(0),
+    m_writeSector(0),
+    m_writeOffset(0) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool ConfigStore::checkRecord(uint32_t address, uint16_t& version, uint16_t& length,
+                              uint32_t& generation) {
+    ConfigRecordHeader header;
+    if (!m_storage->read(address, &header, sizeof(header)) ||
+        header.magic != CONFIG_RECORD_MAGIC ||
+        header.length > maxPayload() ||
+        (address % m_sectorSize) + recordSize(header.length) > m_sectorSize) {
+        return false;
+    }
+
+    // Stream the payload through the CRC; nothing is buffered
+    uint32_t crc = crc32(reinterpret_cast<const uint8_t*>(&header.version), 8);
+    uint8_t chunk[CONFIG_CRC_CHUNK];
+    for (uint32_t done = 0; done < header.length; ) {
+        uint32_t part = header.length - done < sizeof(chunk) ? header.length - done : sizeof(chunk);
+        if (!m_storage->read(address + CONFIG_STORE_HEADER_SIZE + done, chunk, part)) {
+            return false;
+        }
+        crc = crc32(chunk, part, crc);
+        done += part;
+    }
+    if (crc != header.crc) {
+        return false;
+    }
+    version = header.version;
+    length = header.length;
+    generation = header.generation;
+    return true;
+}
+
+bool ConfigStore::isErased(uint32_t address, uint32_t length) {
+    uint8_t chunk[CONFIG_CRC_CHUNK];
+    for (uint32_t done = 0; done < length; ) {
+        uint32_t part = length - done < sizeof(chunk) ? length - done : sizeof(chunk);
+        if (!m_storage->read(address + done, chunk, part)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < part; i++) {
+            if (chunk[i] != 0xFF) {
+                return false;
+            }
+        }
+        done += part;
+    }
+    return true;
+}
+
+bool ConfigStore::begin(OutboxStorage* storage) {
+    m_storage = storage;
+    m_found = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+    if (!storage || storage->sectorSize() <= CONFIG_STORE_HEADER_SIZE ||
+        storage->size() / storage->sectorSize() < 2) {
+        m_storage = nullptr;
+        return false;
+    }
+    m_sectorSize = storage->sectorSize();
+    m_sectorCount = storage->size() / m_sectorSize;
+
+    for (uint16_t sector = 0; sector < m_sectorCount; sector++) {
+        uint32_t base = (uint32_t)sector * m_sectorSize;
+        for (uint32_t offset = 0; offset + CONFIG_STORE_HEADER_SIZE <= m_sectorSize; ) {
+            uint32_t magic;
+            if (!storage->read(base + offset, &magic, sizeof(magic)) || magic == CONFIG_ERASED_WORD) {
+                break;
+            }
+            uint16_t version, length;
+            uint32_t generation;
+            if (!checkRecord(base + offset, version, length, generation)) {
+                m_stats.corrupt++;
+                break;      // Length can't be trusted: the rest of the sector is unreadable
+            }
+            if (!m_found || generation > m_stats.generation) {
+                m_found = true;
+                m_sector = sector;
+                m_offset = offset;
+                m_version = version;
+                m_length = length;
+                m_stats.generation = generation;
+            }
+            offset += recordSize(length);
+        }
+    }
+
+    // Append after the current record if its sector is clean past it;
+    // otherwise (or with no record) the next save starts a fresh sector
+    m_writeSector = m_found ? m_sector : m_sectorCount - 1;
+    m_writeOffset = m_sectorSize;
+    if (m_found) {
+        uint32_t end = m_offset + recordSize(m_length);
+        if (end >= m_sectorSize ||
+            isErased((uint32_t)m_sector * m_sectorSize + end, m_sectorSize - end)) {
+            m_writeOffset = end;
+        }
+    }
+    return true;
+}
+
+size_t ConfigStore::load(void* data, size_t capacity) {
+    if (!m_storage || !m_found || !data) {
+        return 0;
+    }
+    size_t length = m_length < capacity ? m_length : capacity;
+    uint32_t address = (uint32_t)m_sector * m_sectorSize + m_offset + CONFIG_STORE_HEADER_SIZE;
+    if (length > 0 && !m_storage->read(address, data, length)) {
+        return 0;
+    }
+    return length;
+}
+
+bool ConfigStore::append(const void* data, uint16_t length, uint16_t version) {
+    uint32_t size = recordSize(length);
+    if (m_writeOffset + size > m_sectorSize) {
+        // Never erase the sector holding the current record
+        uint16_t next = (m_writeSector + 1) % m_sectorCount;
+        if (m_found && next == m_sector) {
+            next = (next + 1) % m_sectorCount;
+        }
+        if (!m_storage->eraseSector((uint32_t)next * m_sectorSize)) {
+            return false;
+        }
+        m_stats.erases++;
+        m_writeSector = next;
+        m_writeOffset = 0;
+    }
+
+    ConfigRecordHeader header;
+    header.magic = CONFIG_RECORD_MAGIC;
+    header.version = version;
+    header.length = length;
+    header.generation = m_stats.generation + 1;
+    header.crc = crc32(reinterpret_cast<const uint8_t*>(&header.version), 8);
+    header.crc = crc32(static_cast<const uint8_t*>(data), length, header.crc);
+
+    uint32_t address = (uint32_t)m_writeSector * m_sectorSize + m_writeOffset;
+    m_writeOffset += size;     // Used even if the write fails: those bytes are dirty
+    if ((length > 0 && !m_storage->write(address + CONFIG_STORE_HEADER_SIZE, data, length)) ||
+        !m_storage->write(address, &header, sizeof(header))) {
+        return false;
+    }
+
+    uint16_t readVersion, readLength;
+    uint32_t readGeneration;
+    if (!checkRecord(address, readVersion, readLength, readGeneration) ||
+        readGeneration != header.generation) {
+        return false;
+    }
+    m_found = true;
+    m_sector = m_writeSector;
+    m_offset = address % m_sectorSize;
+    m_version = version;
+    m_length = length;
+    m_stats.generation = header.generation;
+    m_stats.saves++;
+    return true;
+}
+
+bool ConfigStore::save(const void* data, uint16_t length, uint16_t version) {
+    if (!m_storage || (!data && length > 0) || length > maxPayload()) {
+        return false;
+    }
+    if (append(data, length, version)) {
+        return true;
+    }
+    // Retry once in a freshly erased sector
+    m_stats.failures++;
+    m_writeOffset = m_sectorSize;
+    if (append(data, length, version)) {
+        return true;
+    }
+    m_stats.failures++;
+    return false;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file deferred_log.cpp
+ * @brief Leveled logging drained to serial by a low-priority task
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/DeferredLog.h"
+
+#include <stdarg.h>
+
+#define LOG_ENTRY_HEADER 2      // Level byte, length byte
+
+static uint8_t logBuffer[LOG_BUFFER_SIZE];
+DeferredLog collarLog(logBuffer, LOG_BUFFER_SIZE);
+
+static_assert(LOG_LINE_MAX <= 256, "Line length must fit the entry's length byte");
+
+// ==================== RING ====================
+
+DeferredLog::DeferredLog(uint8_t* buffer, uint32_t size) :
+    m_data(buffer),
+    m_mask(size - 1),
+    m_head(0),
+    m_tail(0),
+    m_dropped(0),
+    m_reportedDrops(0),
+    m_lines(0),
+    m_highWater(0),
+    m_task(nullptr) {
+    portMUX_INITIALIZE(&m_mux);
+}
+
+void DeferredLog::copyIn(uint32_t offset, const void* source, uint32_t length) {
+    uint32_t start = offset & m_mask;
+    uint32_t first = min(length, m_mask + 1 - start);
+    memcpy(m_data + start, source, first);
+    memcpy(m_data, (const uint8_t*)source + first, length - first);
+}
+
+void DeferredLog::copyOut(uint32_t offset, void* destination, uint32_t length) const {
+    uint32_t start = offset & m_mask;
+    uint32_t first = min(length, m_mask + 1 - start);
+    memcpy(destination, m_data + start, first);
+    memcpy((uint8_t*)destination + first, m_data, length - first);
+}
+
+bool DeferredLog::push(LogLevel level, const char* text, size_t length) {
+    if (length > LOG_LINE_MAX - 1) {
+        length = LOG_LINE_MAX - 1;
+    }
+    uint8_t header[LOG_ENTRY_HEADER] = {(uint8_t)level, (uint8_t)length};
+    uint32_t needed = LOG_ENTRY_HEADER + length;
+
+    portENTER_CRITICAL(&m_mux);
+    bool fits = (m_mask + 1) - (m_head - m_tail) >= needed;
+    if (fits) {
+        copyIn(m_head, header, LOG_ENTRY_HEADER);
+        copyIn(m_head + LOG_ENTRY_HEADER, text, length);
+        m_head += needed;
+        m_lines++;
+        if (m_head - m_tail > m_highWater) {
+            m_highWater = m_head - m_tail;
+        }
+    } else {
+        m_dropped++;
+    }
+    portEXIT_CRITICAL(&m_mux);
+
+    if (fits && m_task) {
+        xTaskNotifyGive(m_task);
+    }
+    return fits;
+}
+
+bool DeferredLog::pop(char* out, size_t capacity, LogLevel& level) {
+    portENTER_CRITICAL(&m_mux);
+    if (m_head == m_tail) {
+        portEXIT_CRITICAL(&m_mux);
+        return false;
+    }
+    uint8_t header[LOG_ENTRY_HEADER];
+    copyOut(m_tail, header, LOG_ENTRY_HEADER);
+    size_t length = min((size_t)header[1], capacity - 1);
+    copyOut(m_tail + LOG_ENTRY_HEADER, out, length);
+    m_tail += LOG_ENTRY_HEADER + header[1];
+    portEXIT_CRITICAL(&m_mux);
+
+    out[length] = '\0';
+    level = (LogLevel)header[0];
+    return true;
+}
+
+void DeferredLog::log(LogLevel level, const char* format, ...) {
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    }
+    if ((size_t)length >= sizeof(line)) {
+        length = sizeof(line) - 1;
+    }
+    // Lines are printed with println(); drop the newline of converted printf formats
+    if (length > 0 && line[length - 1] == '\n') {
+        length--;
+    }
+    push(level, line, length);
+}
+
+// ==================== DRAIN TASK ====================
+
+bool DeferredLog::begin() {
+    if (m_task) {
+        return true;
+    }
+    if (xTaskCreate(&DeferredLog::drainTask, "log_drain", LOG_TASK_STACK,
+                    this, LOG_TASK_PRIORITY, &m_task) != pdPASS) {
+        m_task = nullptr;
+        Serial.println("❌ Deferred log: drain task create failed");
+        return false;
+    }
+    xTaskNotifyGive(m_task);    // Print what was logged before begin()
+    return true;
+}
+
+void DeferredLog::flush() {
+    char line[LOG_LINE_MAX];
+    LogLevel level;
+    while (pop(line, sizeof(line), level)) {
+        Serial.println(line);
+    }
+
+    uint32_t dropped = m_dropped;
+    if (dropped != m_reportedDrops) {
+        Serial.printf("⚠️ %lu log lines dropped (buffer full)\n", (unsigned long)(dropped - m_reportedDrops));
+        m_reportedDrops = dropped;
+    }
+}
+
+void DeferredLog::drainTask(void* arg) {
+    DeferredLog* log = static_cast<DeferredLog*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        log->flush();
+    }
+}
+
+const char* logLevelToString(LogLevel level) {
+    switch (level) {
+        case LogLevel::ERROR: return "error";
+        case LogLevel::WARNING: return "warning";
+        case LogLevel::INFO: return "info";
+        case LogLevel::DEBUG: return "debug";
+        case LogLevel::VERBOSE: return "verbose";
+    }
+    return "unknown";
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+/**
+ * @brief Lines come back in order, with their level, truncated to LOG_LINE_MAX
+ */
+bool testOrderAndTruncation() {
+    Serial.println("📊 Test 1: Line order, levels and truncation");
+
+    static uint8_t buffer[1024];
+    DeferredLog log(buffer, sizeof(buffer));
+    log.log(LogLevel::INFO, "🔍 Updated beacon: %s, RSSI: %d dBm\n", "Kitchen", -61);
+    log.log(LogLevel::WARNING, "second");
+    char longLine[LOG_LINE_MAX * 2];
+    memset(longLine, 'x', sizeof(longLine) - 1);
+    longLine[sizeof(longLine) - 1] = '\0';
+    log.log(LogLevel::DEBUG, "%s", longLine);
+
+    log.push(LogLevel::INFO, "", 0);
+
+    char line[LOG_LINE_MAX];
+    LogLevel level;
+    bool passed = log.pop(line, sizeof(line), level) &&
+                  strcmp(line, "🔍 Updated beacon: Kitchen, RSSI: -61 dBm") == 0 && level == LogLevel::INFO;
+    passed = passed && log.pop(line, sizeof(line), level) && strcmp(line, "second") == 0 &&
+             level == LogLevel::WARNING;
+    passed = passed && log.pop(line, sizeof(line), level) && strlen(line) == LOG_LINE_MAX - 1 &&
+             level == LogLevel::DEBUG;
+    passed = passed && log.pop(line, sizeof(line), level) && line[0] == '\0';
+    passed = passed && !log.pop(line, sizeof(line), level) && log.getQueuedBytes() == 0 &&
+             log.getLines() == 4;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A full ring drops new lines; entries split across the wrap read back whole
+ */
+bool testWrapAndDrops() {
+    Serial.println("📊 Test 2: Full ring and wrap-around");
+
+    static uint8_t buffer[64];
+    DeferredLog log(buffer, sizeof(buffer));
+    char text[11];
+    for (uint8_t i = 0; i < 6; i++) {
+        snprintf(text, sizeof(text), "line %05u", i);
+        log.push(LogLevel::INFO, text, 10);
+    }
+    bool passed = log.getDropped() == 1 && log.getQueuedBytes() == 60 && log.getHighWater() == 60;
+
+    char line[LOG_LINE_MAX];
+    LogLevel level;
+    log.pop(line, sizeof(line), level);
+    log.pop(line, sizeof(line), level);
+    passed = passed && strcmp(line, "line 00001") == 0;
+
+    // These two straddle the end of the buffer
+    passed = passed && log.push(LogLevel::ERROR, "wrapped 01", 10) && log.push(LogLevel::ERROR, "wrapped 02", 10);
+    const char* expected[] = {"line 00002", "line 00003", "line 00004", "wrapped 01", "wrapped 02"};
+    for (const char* want : expected) {
+        passed = passed && log.pop(line, sizeof(line), level) && strcmp(line, want) == 0;
+    }
+    passed = passed && level == LogLevel::ERROR && !log.pop(line, sizeof(line), level);
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Calls above the build level are removed with their arguments
+ */
+bool testCompileTimeLevel() {
+    Serial.println("📊 Test 3: Compile-time level elimination");
+
+    int evaluated = 0;
+    LOGV("verbose %d", ++evaluated);
+    int expected = COLLAR_LOG_LEVEL >= DEBUG_LOG_LEVEL_VERBOSE ? 1 : 0;
+    bool passed = evaluated == expected;
+
+    Serial.printf("   Build level %d, verbose arguments evaluated %d time(s)\n", COLLAR_LOG_LEVEL, evaluated);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runDeferredLogTests() {
+    Serial.println("\n🧪 Running Deferred Log Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testOrderAndTruncation();
+    passed &= testWrapAndDrops();
+    passed &= testCompileTimeLevel();
+
+    Serial.printf("\n%s Deferred Log Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file display_flusher.cpp
+ * @brief Double-buffered SSD1306 page flushes on a background task
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/DisplayFlusher.h"
+
+#include <string.h>
+#include <algorithm>
+
+using std::min;
+
+// ==================== BUS ====================
+
+uint8_t scanI2cAddresses(I2cBus& bus, uint8_t* found, uint8_t capacity) {
+    uint8_t count = 0;
+    for (uint8_t address = 1; address < 127; address++) {
+        if (!bus.write(address, nullptr, 0)) {
+            continue;
+        }
+        if (found && count < capacity) {
+            found[count] = address;
+        }
+        count++;
+    }
+    return count;
+}
+
+// ==================== FAKE PANEL ====================
+
+/**
+ * @brief Argument bytes that follow an SSD1306 command
+ */
+static uint8_t ssd1306ArgumentCount(uint8_t command) {
+    switch (command) {
+        case SSD1306_CMD_COLUMN_ADDRESS:
+        case SSD1306_CMD_PAGE_ADDRESS:
+        case 0xA3:                          // Vertical scroll area
+            return 2;
+        case 0x26: case 0x27:               // Horizontal scroll setup
+            return 6;
+        case 0x29: case 0x2A:               // Vertical and horizontal scroll setup
+            return 5;
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+        case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+FakeSsd1306::FakeSsd1306(uint8_t address) :
+    m_address(address),
+    m_columnStart(0),
+    m_columnEnd(SSD1306_MAX_WIDTH - 1),
+    m_pageStart(0),
+    m_pageEnd(DISPLAY_MAX_PAGES - 1),
+    m_column(0),
+    m_page(0),
+    m_on(false),
+    m_writes(0),
+    m_dataBytes(0),
+    m_failWrites(0) {
+    memset(m_gddram, 0, sizeof(m_gddram));
+}
+
+void FakeSsd1306::command(const uint8_t* bytes, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+        uint8_t command = bytes[i++];
+        uint8_t arguments = ssd1306ArgumentCount(command);
+        if (i + arguments > length) {
+            return;                         // Truncated command: ignored, as on the panel
+        }
+        const uint8_t* args = bytes + i;
+        i += arguments;
+
+        switch (command) {
+            case SSD1306_CMD_COLUMN_ADDRESS:
+                m_columnStart = min(args[0], (uint8_t)(SSD1306_MAX_WIDTH - 1));
+                m_columnEnd = min(args[1], (uint8_t)(SSD1306_MAX_WIDTH - 1));
+                m_column = m_columnStart;
+                break;
+            case SSD1306_CMD_PAGE_ADDRESS:
+                m_pageStart = min(args[0], (uint8_t)(DISPLAY_MAX_PAGES - 1));
+                m_pageEnd = min(args[1], (uint8_t)(DISPLAY_MAX_PAGES - 1));
+                m_page = m_pageStart;
+                break;
+            case SSD1306_CMD_DISPLAY_OFF:
+                m_on = false;
+                break;
+            case SSD1306_CMD_DISPLAY_ON:
+                m_on = true;
+                break;
+        }
+    }
+}
+
+bool FakeSsd1306::write(uint8_t address, const uint8_t* data, size_t length) {
+    if (address != m_address) {
+        return false;
+    }
+    if (m_failWrites > 0) {
+        m_failWrites--;
+        return false;
+    }
+    m_writes++;
+    if (length == 0) {
+        return true;                        // Address probe
+    }
+
+    if (data[0] == SSD1306_CONTROL_COMMANDS) {
+        command(data + 1, length - 1);
+    } else if (data[0] == SSD1306_CONTROL_DATA) {
+        // Horizontal addressing: next column, wrapping to the next page of the window
+        for (size_t i = 1; i < length; i++) {
+            m_gddram[m_page * SSD1306_MAX_WIDTH + m_column] = data[i];
+            if (m_column >= m_columnEnd) {
+                m_column = m_columnStart;
+                m_page = m_page >= m_pageEnd ? m_pageStart : m_page + 1;
+            } else {
+                m_column++;
+            }
+        }
+        m_dataBytes += length - 1;
+    }
+    return true;
+}
+
+// ==================== FLUSHER ====================
+
+DisplayFlusher::DisplayFlusher(I2cBus& bus, uint8_t address, uint8_t* frontBuffer, uint8_t width,
+                               uint8_t pages) :
+    m_bus(bus),
+    m_address(address),
+    m_render(nullptr),
+    m_front(frontBuffer),
+    m_width(min(width, (uint8_t)SSD1306_MAX_WIDTH)),
+    m_pages(min(pages, (uint8_t)DISPLAY_MAX_PAGES)),
+    m_wantOn(true),             // display.begin() leaves the panel on
+    m_inFlightOn(true),
+    m_isOn(true),
+    m_busy(false),
+    m_stats(),
+    m_wake(nullptr),
+    m_wakeContext(nullptr),
+    m_clock(nullptr) {
+    m_pending.clear();
+    m_inFlight.clear();
+}
+
+void DisplayFlusher::setWakeHook(DisplayWakeFn wake, void* context) {
+    m_wake = wake;
+    m_wakeContext = context;
+}
+
+void DisplayFlusher::submit(const DisplayDirtyPages& pages) {
+    if (!m_render) {
+        return;
+    }
+    m_pending.add(pages);
+
+    if (m_busy.load(std::memory_order_acquire)) {
+        if (!pages.isEmpty()) {
+            m_stats.deferred++;
+        }
+        return;
+    }
+    handOver();
+}
+
+void DisplayFlusher::setPanelOn(bool on) {
+    m_wantOn = on;
+    if (m_render && !m_busy.load(std::memory_order_acquire)) {
+        handOver();
+    }
+}
+
+void DisplayFlusher::handOver() {
+    // Only called while not busy: the flush context is done with the batch
+    if (m_pending.isEmpty() && m_wantOn == m_isOn) {
+        return;
+    }
+
+    for (uint8_t page = 0; page < m_pages; page++) {
+        if (m_pending.mask & (1 << page)) {
+            uint8_t first = m_pending.firstColumn[page];
+            uint8_t last = min(m_pending.lastColumn[page], (uint8_t)(m_width - 1));
+            uint16_t offset = page * m_width + first;
+            memcpy(m_front + offset, m_render + offset, last - first + 1);
+        }
+    }
+    m_inFlight = m_pending;
+    m_inFlightOn = m_wantOn;
+    m_pending.clear();
+
+    m_busy.store(true, std::memory_order_release);
+    if (m_wake) {
+        m_wake(m_wakeContext);
+    }
+}
+
+bool DisplayFlusher::isBusy() const {
+    if (m_busy.load(std::memory_order_acquire)) {
+        return true;
+    }
+    // A power command the panel did not acknowledge is resent with the next batch
+    return !m_pending.isEmpty() || m_wantOn != m_isOn;
+}
+
+bool DisplayFlusher::sendCommand(const uint8_t* bytes, size_t length) {
+    uint8_t packet[8];
+    if (length > sizeof(packet) - 1) {
+        return false;
+    }
+    packet[0] = SSD1306_CONTROL_COMMANDS;
+    memcpy(packet + 1, bytes, length);
+    if (!m_bus.write(m_address, packet, length + 1)) {
+        m_stats.busErrors++;
+        return false;
+    }
+    return true;
+}
+
+bool DisplayFlusher::sendPage(uint8_t page, uint8_t first, uint8_t last) {
+    // Column/page window: data wraps inside it, so one stream fills the span
+    const uint8_t window[] = {SSD1306_CMD_COLUMN_ADDRESS, first, last, SSD1306_CMD_PAGE_ADDRESS, page, page};
+    if (!sendCommand(window, sizeof(window))) {
+        return false;
+    }
+
+    uint8_t packet[DISPLAY_I2C_CHUNK_BYTES + 1];
+    packet[0] = SSD1306_CONTROL_DATA;
+    const uint8_t* data = m_front + page * m_width + first;
+    uint16_t remaining = last - first + 1;
+    while (remaining > 0) {
+        uint16_t chunk = min(remaining, (uint16_t)DISPLAY_I2C_CHUNK_BYTES);
+        memcpy(packet + 1, data, chunk);
+        if (!m_bus.write(m_address, packet, chunk + 1)) {
+            m_stats.busErrors++;
+            return false;
+        }
+        m_stats.bytes += chunk;
+        data += chunk;
+        remaining -= chunk;
+    }
+    return true;
+}
+
+bool DisplayFlusher::service() {
+    if (!m_busy.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    uint32_t started = m_clock ? m_clock() : 0;
+    for (uint8_t page = 0; page < m_pages; page++) {
+        if (m_inFlight.mask & (1 << page)) {
+            // A failed page is dropped; the next change to it redraws it
+            sendPage(page, m_inFlight.firstColumn[page],
+                     min(m_inFlight.lastColumn[page], (uint8_t)(m_width - 1)));
+        }
+    }
+    // After the data, so a panel switched on shows the new frame
+    if (m_inFlightOn != m_isOn) {
+        uint8_t command = m_inFlightOn ? SSD1306_CMD_DISPLAY_ON : SSD1306_CMD_DISPLAY_OFF;
+        if (sendCommand(&command, 1)) {
+            m_isOn = m_inFlightOn;
+        }
+    }
+
+    if (!m_inFlight.isEmpty()) {
+        uint32_t elapsed = m_clock ? m_clock() - started : 0;
+        m_stats.flushes++;
+        if (elapsed > m_stats.maxFlushUs) {
+            m_stats.maxFlushUs = elapsed;
+        }
+    }
+
+    m_busy.store(false, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,395 @@
+/**
+ * @file heap_profiler.cpp
+ * @brief Heap fragmentation and tagged allocation tracking (malloc --wrap)
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/HeapProfiler.h"
+
+static const char* const TAG_NAMES[] = {"other", "ble", "json", "mqtt", "websocket", "display"};
+
+static_assert(sizeof(TAG_NAMES) / sizeof(TAG_NAMES[0]) == (size_t)HeapTag::COUNT,
+              "One name per tag");
+
+#define BLOCK_SIZE(block) ((block).sizeAndTag & HEAP_PROFILE_MAX_SIZE)
+#define BLOCK_TAG(block) ((uint8_t)((block).sizeAndTag >> 24))
+#define NO_SLOT 0xFFFFFFFFUL
+
+// Tag of the running task's allocations (set by HeapTagScope)
+static __thread HeapTag t_heapTag = HeapTag::OTHER;
+
+// ==================== PROFILER ====================
+
+HeapProfiler::HeapProfiler(HeapBlock* blocks, uint32_t capacity) :
+    m_blocks(blocks),
+    m_mask(capacity - 1),
+    m_used(0),
+    m_ready(false),
+    m_untrackedAllocs(0),
+    m_untrackedFrees(0),
+    m_windowStartMs(0) {
+    portMUX_INITIALIZE(&m_mux);
+    memset(m_tags, 0, sizeof(m_tags));
+}
+
+void HeapProfiler::begin(uint32_t nowMs) {
+    portENTER_CRITICAL(&m_mux);
+    memset(m_blocks, 0, (m_mask + 1) * sizeof(HeapBlock));
+    memset(m_tags, 0, sizeof(m_tags));
+    m_used = 0;
+    m_untrackedAllocs = 0;
+    m_untrackedFrees = 0;
+    m_windowStartMs = nowMs;
+    m_ready = true;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+uint32_t HeapProfiler::slotOf(uintptr_t address) const {
+    uint32_t hash = (uint32_t)(address >> 2) * 2654435761UL;
+    return (hash ^ (hash >> 16)) & m_mask;
+}
+
+uint32_t HeapProfiler::findLocked(uintptr_t address) const {
+    for (uint32_t slot = slotOf(address); m_blocks[slot].address != 0; slot = (slot + 1) & m_mask) {
+        if (m_blocks[slot].address == address) {
+            return slot;
+        }
+    }
+    return NO_SLOT;
+}
+
+void HeapProfiler::removeSlotLocked(uint32_t slot) {
+    HeapTagStats& stats = m_tags[BLOCK_TAG(m_blocks[slot])];
+    stats.liveBytes -= BLOCK_SIZE(m_blocks[slot]);
+    stats.liveBlocks--;
+
+    // Backward-shift deletion: pull later entries of the probe chain into
+    // the hole unless that would move them before their home slot
+    uint32_t hole = slot;
+    for (uint32_t next = (hole + 1) & m_mask; m_blocks[next].address != 0; next = (next + 1) & m_mask) {
+        uint32_t home = slotOf(m_blocks[next].address);
+        if (((next - home) & m_mask) >= ((next - hole) & m_mask)) {
+            m_blocks[hole] = m_blocks[next];
+            hole = next;
+        }
+    }
+    m_blocks[hole].address = 0;
+    m_used--;
+}
+
+void HeapProfiler::recordAlloc(void* address, size_t size, HeapTag tag) {
+    if (!address || !m_ready) {
+        return;
+    }
+    uintptr_t key = (uintptr_t)address;
+    uint32_t clamped = size < HEAP_PROFILE_MAX_SIZE ? (uint32_t)size : HEAP_PROFILE_MAX_SIZE;
+
+    portENTER_CRITICAL(&m_mux);
+    HeapTagStats& stats = m_tags[(uint8_t)tag];
+    stats.allocs++;
+    stats.allocBytes += clamped;
+
+    // A free we never saw (e.g. a block freed through heap_caps_free)
+    uint32_t stale = findLocked(key);
+    if (stale != NO_SLOT) {
+        removeSlotLocked(stale);
+    }
+
+    if (m_used >= (m_mask + 1) / 4 * 3) {
+        m_untrackedAllocs++;
+    } else {
+        uint32_t slot = slotOf(key);
+        while (m_blocks[slot].address != 0) {
+            slot = (slot + 1) & m_mask;
+        }
+        m_blocks[slot].address = key;
+        m_blocks[slot].sizeAndTag = clamped | ((uint32_t)tag << 24);
+        m_used++;
+        stats.liveBytes += clamped;
+        stats.liveBlocks++;
+        if (stats.liveBytes > stats.peakBytes) {
+            stats.peakBytes = stats.liveBytes;
+        }
+    }
+    portEXIT_CRITICAL(&m_mux);
+}
+
+bool HeapProfiler::recordFree(void* address) {
+    if (!address || !m_ready) {
+        return false;
+    }
+    portENTER_CRITICAL(&m_mux);
+    uint32_t slot = findLocked((uintptr_t)address);
+    if (slot != NO_SLOT) {
+        removeSlotLocked(slot);
+    } else {
+        m_untrackedFrees++;
+    }
+    portEXIT_CRITICAL(&m_mux);
+    return slot != NO_SLOT;
+}
+
+bool HeapProfiler::lookup(void* address, size_t& size, HeapTag& tag) {
+    if (!address || !m_ready) {
+        return false;
+    }
+    portENTER_CRITICAL(&m_mux);
+    uint32_t slot = findLocked((uintptr_t)address);
+    if (slot != NO_SLOT) {
+        size = BLOCK_SIZE(m_blocks[slot]);
+        tag = (HeapTag)BLOCK_TAG(m_blocks[slot]);
+    }
+    portEXIT_CRITICAL(&m_mux);
+    return slot != NO_SLOT;
+}
+
+HeapTagStats HeapProfiler::getTagStats(HeapTag tag) {
+    portENTER_CRITICAL(&m_mux);
+    HeapTagStats stats = m_tags[(uint8_t)tag];
+    portEXIT_CRITICAL(&m_mux);
+    return stats;
+}
+
+void HeapProfiler::resetWindow(uint32_t nowMs) {
+    portENTER_CRITICAL(&m_mux);
+    for (HeapTagStats& stats : m_tags) {
+        stats.allocs = 0;
+        stats.allocBytes = 0;
+    }
+    m_windowStartMs = nowMs;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+void HeapProfiler::writeJson(JsonArray tags) {
+    // Copy first: building the document may allocate, which re-enters recordAlloc()
+    HeapTagStats stats[(uint8_t)HeapTag::COUNT];
+    portENTER_CRITICAL(&m_mux);
+    memcpy(stats, m_tags, sizeof(stats));
+    portEXIT_CRITICAL(&m_mux);
+
+    for (uint8_t i = 0; i < (uint8_t)HeapTag::COUNT; i++) {
+        if (stats[i].liveBlocks == 0 && stats[i].allocs == 0) {
+            continue;
+        }
+        JsonArray entry = tags.createNestedArray();
+        entry.add(TAG_NAMES[i]);
+        entry.add(stats[i].liveBytes);
+        entry.add(stats[i].liveBlocks);
+        entry.add(stats[i].peakBytes);
+        entry.add(stats[i].allocs);
+        entry.add(stats[i].allocBytes);
+    }
+}
+
+// ==================== TAGS AND SUMMARY ====================
+
+HeapTagScope::HeapTagScope(HeapTag tag) : m_previous(t_heapTag) {
+    t_heapTag = tag;
+}
+
+HeapTagScope::~HeapTagScope() {
+    t_heapTag = m_previous;
+}
+
+HeapTag currentHeapTag() {
+    return t_heapTag;
+}
+
+uint8_t heapFragmentationPercent(uint32_t freeBytes, uint32_t largestFreeBlock) {
+    if (freeBytes == 0 || largestFreeBlock >= freeBytes) {
+        return 0;
+    }
+    return (uint8_t)(100 - (uint64_t)largestFreeBlock * 100 / freeBytes);
+}
+
+HeapSummary readHeapSummary() {
+    HeapSummary summary;
+    summary.freeBytes = ESP.getFreeHeap();
+    summary.minFreeBytes = ESP.getMinFreeHeap();
+    summary.largestFreeBlock = ESP.getMaxAllocHeap();
+    summary.fragmentation = heapFragmentationPercent(summary.freeBytes, summary.largestFreeBlock);
+    return summary;
+}
+
+const char* heapTagToString(HeapTag tag) {
+    return tag < HeapTag::COUNT ? TAG_NAMES[(uint8_t)tag] : "unknown";
+}
+
+// ==================== MALLOC WRAPPERS ====================
+
+#if FEATURE_MEMORY_PROFILING
+
+static HeapBlock heapBlocks[HEAP_PROFILE_TABLE_SIZE];
+HeapProfiler heapProfiler(heapBlocks, HEAP_PROFILE_TABLE_SIZE);
+
+// Linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* address, size_t size);
+void __real_free(void* address);
+
+void* __wrap_malloc(size_t size) {
+    void* address = __real_malloc(size);
+    heapProfiler.recordAlloc(address, size, t_heapTag);
+    return address;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* address = __real_calloc(count, size);
+    heapProfiler.recordAlloc(address, count * size, t_heapTag);
+    return address;
+}
+
+void* __wrap_realloc(void* address, size_t size) {
+    // Forget the old block before the heap can hand its address to another task
+    size_t oldSize = 0;
+    HeapTag oldTag = HeapTag::OTHER;
+    bool tracked = heapProfiler.lookup(address, oldSize, oldTag);
+    heapProfiler.recordFree(address);
+
+    void* resized = __real_realloc(address, size);
+    if (resized) {
+        heapProfiler.recordAlloc(resized, size, t_heapTag);
+    } else if (tracked && size > 0) {
+        heapProfiler.recordAlloc(address, oldSize, oldTag);    // Failed: the old block stays
+    }
+    return resized;
+}
+
+void __wrap_free(void* address) {
+    heapProfiler.recordFree(address);
+    __real_free(address);
+}
+}
+
+#endif // FEATURE_MEMORY_PROFILING
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+const uint32_t TEST_TABLE_SIZE = 64;
+const uintptr_t TEST_BASE = 0x3FC90000;
+
+/**
+ * @brief Live bytes follow allocations and frees per tag
+ */
+bool testTagAccounting() {
+    Serial.println("📊 Test 1: Live bytes per tag");
+
+    static HeapBlock blocks[TEST_TABLE_SIZE];
+    HeapProfiler profiler(blocks, TEST_TABLE_SIZE);
+    profiler.recordAlloc((void*)TEST_BASE, 100, HeapTag::BLE);     // Before begin(): ignored
+    profiler.begin(0);
+    bool passed = profiler.getTagStats(HeapTag::BLE).allocs == 0;
+
+    profiler.recordAlloc((void*)(TEST_BASE + 0x10), 120, HeapTag::BLE);
+    profiler.recordAlloc((void*)(TEST_BASE + 0x20), 300, HeapTag::JSON);
+    profiler.recordAlloc((void*)(TEST_BASE + 0x40), 80, HeapTag::BLE);
+    passed = passed && profiler.recordFree((void*)(TEST_BASE + 0x10)) &&
+             !profiler.recordFree((void*)(TEST_BASE + 0x800));
+
+    HeapTagStats ble = profiler.getTagStats(HeapTag::BLE);
+    HeapTagStats json = profiler.getTagStats(HeapTag::JSON);
+    passed = passed && ble.liveBytes == 80 && ble.liveBlocks == 1 && ble.peakBytes == 200 &&
+             ble.allocs == 2 && ble.allocBytes == 200 && json.liveBytes == 300 &&
+             profiler.getUntrackedFrees() == 1 && profiler.getTrackedBlocks() == 2;
+
+    // A new window keeps live bytes
+    profiler.resetWindow(1000);
+    ble = profiler.getTagStats(HeapTag::BLE);
+    passed = passed && ble.allocs == 0 && ble.liveBytes == 80;
+
+    size_t size = 0;
+    HeapTag tag = HeapTag::OTHER;
+    passed = passed && profiler.lookup((void*)(TEST_BASE + 0x20), size, tag) &&
+             size == 300 && tag == HeapTag::JSON;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Colliding blocks stay findable through deletions; a full table stops tracking
+ */
+bool testTableIntegrity() {
+    Serial.println("📊 Test 2: Probe chains survive deletion, full table degrades");
+
+    static HeapBlock blocks[TEST_TABLE_SIZE];
+    HeapProfiler profiler(blocks, TEST_TABLE_SIZE);
+    profiler.begin(0);
+
+    const uint32_t limit = TEST_TABLE_SIZE / 4 * 3;
+    for (uint32_t i = 0; i < limit + 4; i++) {
+        profiler.recordAlloc((void*)(TEST_BASE + i * 24), 16, HeapTag::MQTT);
+    }
+    bool passed = profiler.getTrackedBlocks() == limit && profiler.getUntrackedAllocs() == 4;
+
+    // Free every third block, then every remaining one must still be found
+    for (uint32_t i = 0; i < limit; i += 3) {
+        passed = passed && profiler.recordFree((void*)(TEST_BASE + i * 24));
+    }
+    size_t size;
+    HeapTag tag;
+    for (uint32_t i = 0; i < limit; i++) {
+        bool found = profiler.lookup((void*)(TEST_BASE + i * 24), size, tag);
+        passed = passed && found == (i % 3 != 0);
+    }
+    for (uint32_t i = 0; i < limit; i++) {
+        if (i % 3 != 0) {
+            passed = passed && profiler.recordFree((void*)(TEST_BASE + i * 24));
+        }
+    }
+    HeapTagStats mqtt = profiler.getTagStats(HeapTag::MQTT);
+    passed = passed && profiler.getTrackedBlocks() == 0 && mqtt.liveBytes == 0 && mqtt.liveBlocks == 0;
+
+    Serial.printf("   %lu blocks tracked, %lu untracked when full\n",
+                 (unsigned long)limit, (unsigned long)profiler.getUntrackedAllocs());
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Fragmentation from the largest block, and tag scopes nest
+ */
+bool testFragmentationAndScopes() {
+    Serial.println("📊 Test 3: Fragmentation ratio and tag scopes");
+
+    bool passed = heapFragmentationPercent(200000, 200000) == 0 &&
+                  heapFragmentationPercent(200000, 50000) == 75 &&
+                  heapFragmentationPercent(0, 0) == 0;
+
+    HeapTag outside = currentHeapTag();
+    {
+        HeapTagScope ble(HeapTag::BLE);
+        {
+            HeapTagScope json(HeapTag::JSON);
+            passed = passed && currentHeapTag() == HeapTag::JSON;
+        }
+        passed = passed && currentHeapTag() == HeapTag::BLE;
+    }
+    passed = passed && currentHeapTag() == outside;
+
+    HeapSummary summary = readHeapSummary();
+    Serial.printf("   Heap: %lu free, largest block %lu, %u%% fragmented\n",
+                 (unsigned long)summary.freeBytes, (unsigned long)summary.largestFreeBlock,
+                 summary.fragmentation);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runHeapProfilerTests() {
+    Serial.println("\n🧪 Running Heap Profiler Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testTagAccounting();
+    passed &= testTableIntegrity();
+    passed &= testFragmentationAndScopes();
+
+    Serial.printf("\n%s Heap Profiler Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
@@ -0,0 +1,305 @@
+/**
+ * @file http_snapshot_cache.cpp
+ * @brief Reference-counted HTTP response snapshots with ETags
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/HttpSnapshotCache.h"
+
+/**
+ * @brief FNV-1a hash of a response body (ETag source)
+ */
+static uint32_t hashBody(const char* data, size_t length) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+// ==================== CACHE IMPLEMENTATION ====================
+
+HttpSnapshotCache::HttpSnapshotCache() {
+    portMUX_INITIALIZE(&m_mux);
+    memset(m_slots, 0, sizeof(m_slots));
+    memset(m_lastRequestMs, 0, sizeof(m_lastRequestMs));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+HttpSnapshotCache::~HttpSnapshotCache() {
+    for (uint8_t i = 0; i < (uint8_t)HttpSnapshotId::COUNT; i++) {
+        if (m_slots[i]) {
+            release(m_slots[i]);
+            m_slots[i] = nullptr;
+        }
+    }
+}
+
+void HttpSnapshotCache::releaseLocked(HttpSnapshot* snapshot, HttpSnapshot** toFree) {
+    if (--snapshot->refs == 0) {
+        m_stats.liveSnapshots--;
+        *toFree = snapshot;
+    }
+}
+
+bool HttpSnapshotCache::needsRefresh(HttpSnapshotId id, uint32_t nowMs) const {
+    uint8_t slot = (uint8_t)id;
+    const HttpSnapshot* snapshot = m_slots[slot];
+    if (!snapshot) {
+        return true;
+    }
+    uint32_t ageMs = nowMs - snapshot->builtMs;
+    if (nowMs - m_lastRequestMs[slot] > HTTP_SNAPSHOT_IDLE_MS) {
+        return ageMs >= HTTP_SNAPSHOT_IDLE_MS;
+    }
+    return ageMs >= HTTP_SNAPSHOT_REFRESH_MS;
+}
+
+void HttpSnapshotCache::markRequested(HttpSnapshotId id, uint32_t nowMs) {
+    portENTER_CRITICAL(&m_mux);
+    m_lastRequestMs[(uint8_t)id] = nowMs;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+bool HttpSnapshotCache::update(HttpSnapshotId id, const char* body, size_t length, uint32_t nowMs) {
+    uint8_t slot = (uint8_t)id;
+    uint32_t hash = hashBody(body, length);
+    m_stats.rebuilds++;
+
+    // Only the loop writes slots, so the current one can be compared unlocked
+    HttpSnapshot* current = m_slots[slot];
+    if (current && current->hash == hash && current->length == length &&
+        memcmp(current->data, body, length) == 0) {
+        current->builtMs = nowMs;
+        m_stats.unchanged++;
+        return false;
+    }
+
+    HttpSnapshot* snapshot = (HttpSnapshot*)malloc(sizeof(HttpSnapshot) + length);
+    if (!snapshot) {
+        return false;
+    }
+    snapshot->refs = 1;
+    snapshot->hash = hash;
+    snapshot->builtMs = nowMs;
+    snapshot->length = length;
+    memcpy(snapshot->data, body, length);
+    snapshot->data[length] = '\0';
+    snprintf(snapshot->etag, sizeof(snapshot->etag), "\"%08lx\"", (unsigned long)hash);
+
+    HttpSnapshot* toFree = nullptr;
+    portENTER_CRITICAL(&m_mux);
+    m_slots[slot] = snapshot;
+    m_stats.liveSnapshots++;
+    if (current) {
+        releaseLocked(current, &toFree);
+    }
+    portEXIT_CRITICAL(&m_mux);
+
+    free(toFree);
+    return true;
+}
+
+HttpSnapshot* HttpSnapshotCache::acquire(HttpSnapshotId id, uint32_t nowMs) {
+    uint8_t slot = (uint8_t)id;
+
+    portENTER_CRITICAL(&m_mux);
+    HttpSnapshot* snapshot = m_slots[slot];
+    if (snapshot) {
+        snapshot->refs++;
+    } else {
+        m_stats.misses++;
+    }
+    m_lastRequestMs[slot] = nowMs;
+    portEXIT_CRITICAL(&m_mux);
+
+    return snapshot;
+}
+
+void HttpSnapshotCache::release(HttpSnapshot* snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    HttpSnapshot* toFree = nullptr;
+    portENTER_CRITICAL(&m_mux);
+    releaseLocked(snapshot, &toFree);
+    portEXIT_CRITICAL(&m_mux);
+    free(toFree);
+}
+
+bool HttpSnapshotCache::etagMatches(const char* etag, const char* ifNoneMatch) {
+    if (!etag || !ifNoneMatch) {
+        return false;
+    }
+    while (*ifNoneMatch == ' ') {
+        ifNoneMatch++;
+    }
+    if (strcmp(ifNoneMatch, "*") == 0) {
+        return true;
+    }
+    // Covers lists ("a", "b") and weak validators (W/"a")
+    return strstr(ifNoneMatch, etag) != nullptr;
+}
+
+void HttpSnapshotCache::countServed(bool notModified) {
+    portENTER_CRITICAL(&m_mux);
+    if (notModified) {
+        m_stats.notModified++;
+    } else {
+        m_stats.served++;
+    }
+    portEXIT_CRITICAL(&m_mux);
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+bool updateText(HttpSnapshotCache& cache, const char* body, uint32_t nowMs) {
+    return cache.update(HttpSnapshotId::STATUS, body, strlen(body), nowMs);
+}
+
+/**
+ * @brief An identical rebuild keeps the snapshot and its ETag
+ */
+bool testUnchangedBody() {
+    Serial.println("📊 Test 1: Identical rebuild keeps the ETag");
+
+    HttpSnapshotCache cache;
+    bool passed = updateText(cache, "{\"state\":\"ACTIVE\"}", 0);
+    HttpSnapshot* first = cache.acquire(HttpSnapshotId::STATUS, 0);
+    char firstEtag[sizeof(first->etag)];
+    strcpy(firstEtag, first->etag);
+    cache.release(first);
+
+    passed = passed && !updateText(cache, "{\"state\":\"ACTIVE\"}", 1000);
+    HttpSnapshot* same = cache.acquire(HttpSnapshotId::STATUS, 1000);
+    passed = passed && same == first && strcmp(same->etag, firstEtag) == 0;
+    cache.release(same);
+
+    passed = passed && updateText(cache, "{\"state\":\"ALERT\"}", 2000);
+    HttpSnapshot* changed = cache.acquire(HttpSnapshotId::STATUS, 2000);
+    passed = passed && strcmp(changed->etag, firstEtag) != 0 &&
+             strcmp(changed->data, "{\"state\":\"ALERT\"}") == 0;
+    cache.release(changed);
+
+    const HttpSnapshotStats& stats = cache.getStats();
+    passed = passed && stats.rebuilds == 3 && stats.unchanged == 1 && stats.liveSnapshots == 1;
+
+    Serial.printf("   ETag %s -> %s, %lu of %lu rebuilds unchanged\n", firstEtag,
+                 changed->etag, (unsigned long)stats.unchanged, (unsigned long)stats.rebuilds);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A snapshot being served survives being replaced
+ */
+bool testReaderKeepsSnapshot() {
+    Serial.println("📊 Test 2: Snapshot in use outlives its replacement");
+
+    HttpSnapshotCache cache;
+    updateText(cache, "{\"uptime\":1}", 0);
+    HttpSnapshot* reading = cache.acquire(HttpSnapshotId::STATUS, 0);
+
+    updateText(cache, "{\"uptime\":2}", 1000);
+    bool passed = cache.getStats().liveSnapshots == 2 &&
+                  strcmp(reading->data, "{\"uptime\":1}") == 0;
+
+    cache.release(reading);
+    passed = passed && cache.getStats().liveSnapshots == 1;
+
+    HttpSnapshot* latest = cache.acquire(HttpSnapshotId::STATUS, 1000);
+    passed = passed && latest && strcmp(latest->data, "{\"uptime\":2}") == 0;
+    cache.release(latest);
+
+    passed = passed && cache.acquire(HttpSnapshotId::DISCOVER, 1000) == nullptr &&
+             cache.getStats().misses == 1;
+
+    Serial.printf("   Live snapshots after release: %lu\n", (unsigned long)cache.getStats().liveSnapshots);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief If-None-Match parsing
+ */
+bool testEtagMatching() {
+    Serial.println("📊 Test 3: If-None-Match matching");
+
+    HttpSnapshotCache cache;
+    updateText(cache, "{}", 0);
+    HttpSnapshot* snapshot = cache.acquire(HttpSnapshotId::STATUS, 0);
+
+    char list[48];
+    snprintf(list, sizeof(list), "\"00000000\", %s", snapshot->etag);
+    char weak[24];
+    snprintf(weak, sizeof(weak), "W/%s", snapshot->etag);
+
+    const char* etag = snapshot->etag;
+    bool passed = HttpSnapshotCache::etagMatches(etag, etag) &&
+                  HttpSnapshotCache::etagMatches(etag, list) &&
+                  HttpSnapshotCache::etagMatches(etag, weak) &&
+                  HttpSnapshotCache::etagMatches(etag, " *") &&
+                  !HttpSnapshotCache::etagMatches(etag, "\"00000000\"") &&
+                  !HttpSnapshotCache::etagMatches(etag, "") &&
+                  !HttpSnapshotCache::etagMatches(etag, nullptr);
+    cache.release(snapshot);
+
+    Serial.printf("   Exact, list, weak and wildcard validators matched\n");
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Fast rebuilds only while clients poll, slow ones otherwise
+ */
+bool testRefreshOnlyWhilePolled() {
+    Serial.println("📊 Test 4: Rebuild rate follows polling");
+
+    // Start past the idle window so the zeroed poll times count as idle
+    uint32_t start = HTTP_SNAPSHOT_IDLE_MS + 1;
+    HttpSnapshotCache cache;
+    bool passed = cache.needsRefresh(HttpSnapshotId::STATUS, start);
+    updateText(cache, "{}", start);
+
+    // Never requested: only the slow background rebuild
+    passed = passed && !cache.needsRefresh(HttpSnapshotId::STATUS, start + HTTP_SNAPSHOT_REFRESH_MS) &&
+             !cache.needsRefresh(HttpSnapshotId::STATUS, start + HTTP_SNAPSHOT_IDLE_MS - 1) &&
+             cache.needsRefresh(HttpSnapshotId::STATUS, start + HTTP_SNAPSHOT_IDLE_MS);
+
+    // Polled: due again after the refresh interval
+    uint32_t polled = start + HTTP_SNAPSHOT_IDLE_MS;
+    updateText(cache, "{\"polled\":1}", polled);
+    cache.markRequested(HttpSnapshotId::STATUS, polled);
+    passed = passed && !cache.needsRefresh(HttpSnapshotId::STATUS, polled + HTTP_SNAPSHOT_REFRESH_MS - 1) &&
+             cache.needsRefresh(HttpSnapshotId::STATUS, polled + HTTP_SNAPSHOT_REFRESH_MS);
+
+    // Polling stops: back to the slow rate after the idle window
+    uint32_t rebuilt = polled + HTTP_SNAPSHOT_REFRESH_MS;
+    updateText(cache, "{\"polled\":2}", rebuilt);
+    passed = passed && !cache.needsRefresh(HttpSnapshotId::STATUS, polled + HTTP_SNAPSHOT_IDLE_MS + 1) &&
+             cache.needsRefresh(HttpSnapshotId::STATUS, rebuilt + HTTP_SNAPSHOT_IDLE_MS);
+
+    Serial.printf("   Rebuild every %u ms while polled, every %lu ms otherwise\n",
+                 (unsigned)HTTP_SNAPSHOT_REFRESH_MS, (unsigned long)HTTP_SNAPSHOT_IDLE_MS);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runHttpSnapshotTests() {
+    Serial.println("\n🧪 Running HTTP Snapshot Cache Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testUnchangedBody();
+    passed &= testReaderKeepsSnapshot();
+    passed &= testEtagMatching();
+    passed &= testRefreshOnlyWhilePolled();
+
+    Serial.printf("\n%s HTTP Snapshot Cache Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
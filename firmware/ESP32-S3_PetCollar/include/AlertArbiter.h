@@ -0,0 +1,276 @@
+#ifndef ALERT_ARBITER_H
+#define ALERT_ARBITER_H
+
+/**
+ * @file AlertArbiter.h
+ * @brief Priority-preemptive alert arbitration for ESP32-S3 Pet Collar
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Every alert source (proximity, zone breach, battery, remote command)
+ * submits requests here instead of driving the alert outputs directly:
+ * - A higher priority request preempts the active alert, which is resumed later
+ * - Equal or lower priority requests wait in a small fixed-size queue
+ * - Requests from a source that already has an alert active, queued or
+ *   started within its cooldown window are merged instead of restarted
+ * - The clock is passed in, so the arbiter can be tested with a fake clock
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+#include "BeaconTypes.h"
+
+// ==========================================
+// ARBITRATION TYPES
+// ==========================================
+
+/**
+ * @brief Subsystem an alert request originates from
+ */
+enum class AlertSource : uint8_t {
+    PROXIMITY = 0,          ///< Configured beacon within trigger distance
+    ZONE,                   ///< Zone boundary breach
+    BATTERY,                ///< Low or critical battery
+    REMOTE,                 ///< MQTT or WebSocket remote command
+    LOCAL,                  ///< Local tests (serial, buzzer test)
+    COUNT
+};
+
+/**
+ * @brief Outcome of submitting an alert request
+ */
+enum class ArbiterDecision : uint8_t {
+    STARTED = 0,            ///< Started immediately (nothing was active)
+    PREEMPTED,              ///< Started and displaced a lower priority alert
+    QUEUED,                 ///< Waiting behind an equal or higher priority alert
+    MERGED,                 ///< Folded into an active, queued or recent alert
+    DROPPED                 ///< Rejected (queue full or output failure)
+};
+
+/**
+ * @brief One pending or active alert
+ */
+struct AlertRequest {
+    AlertSource source;
+    AlertReason reason;
+    AlertPriority priority;
+    AlertMode mode;
+    AlertPattern pattern;
+    uint8_t intensity;      ///< 1-5 scale or 0-255 duty
+    uint16_t frequency;     ///< Buzzer frequency in Hz (0 = default)
+    uint32_t durationMs;
+    uint32_t submittedMs;   ///< Time of first submission (queue expiry)
+    uint16_t mergeCount;    ///< Requests folded into this one
+
+    AlertRequest() :
+        source(AlertSource::LOCAL),
+        reason(AlertReason::NONE),
+        priority(AlertPriority::NORMAL),
+        mode(AlertMode::BOTH),
+        pattern(AlertPattern::CONTINUOUS),
+        intensity(128),
+        frequency(0),
+        durationMs(1000),
+        submittedMs(0),
+        mergeCount(0) {}
+};
+
+/**
+ * @brief Output hook that starts playing a request (returns false on failure)
+ */
+typedef bool (*AlertStartFn)(const AlertRequest& request, void* context);
+
+/**
+ * @brief Output hook that silences the outputs
+ */
+typedef void (*AlertStopFn)(void* context);
+
+/**
+ * @brief Arbitration counters
+ */
+struct AlertArbiterStats {
+    uint32_t submitted;
+    uint32_t started;
+    uint32_t preempted;
+    uint32_t queued;
+    uint32_t merged;
+    uint32_t dropped;
+    uint32_t expired;
+};
+
+// ==========================================
+// ALERT ARBITER CLASS
+// ==========================================
+
+/**
+ * @brief Chooses which alert plays when several sources compete
+ */
+class AlertArbiter {
+private:
+    AlertRequest m_queue[ALERT_ARBITER_QUEUE_SIZE];
+    uint8_t m_queueCount;
+
+    AlertRequest m_active;
+    bool m_hasActive;
+    uint32_t m_activeStartMs;
+
+    // Per-source cooldown state
+    uint32_t m_cooldownMs[(uint8_t)AlertSource::COUNT];
+    uint32_t m_lastStartMs[(uint8_t)AlertSource::COUNT];
+    AlertPriority m_lastPriority[(uint8_t)AlertSource::COUNT];
+    bool m_hasStarted[(uint8_t)AlertSource::COUNT];
+
+    AlertStartFn m_startHook;
+    AlertStopFn m_stopHook;
+    void* m_hookContext;
+
+    AlertArbiterStats m_stats;
+
+    /**
+     * @brief Hand a request to the output and record it as active
+     * @return true if the output accepted it
+     */
+    bool startRequest(const AlertRequest& request, uint32_t nowMs);
+
+    /**
+     * @brief Add a request to the queue, evicting a lower priority one if full
+     * @return true if the request was queued
+     */
+    bool enqueue(const AlertRequest& request);
+
+    /**
+     * @brief Index of the queued request to play next (-1 if empty)
+     */
+    int nextIndex() const;
+
+    /**
+     * @brief Remove a queued request by index
+     */
+    void removeAt(uint8_t index);
+
+    /**
+     * @brief Drop queued requests older than ALERT_ARBITER_QUEUE_TTL_MS
+     */
+    void expireQueue(uint32_t nowMs);
+
+public:
+    /**
+     * @brief Constructor - default per-source cooldowns from ESP32_S3_Config.h
+     */
+    AlertArbiter();
+
+    /**
+     * @brief Set the output hooks used to play and silence alerts
+     * @param start Start hook
+     * @param stop Stop hook
+     * @param context Opaque pointer passed to both hooks
+     */
+    void setHooks(AlertStartFn start, AlertStopFn stop, void* context);
+
+    /**
+     * @brief Set the merge window for a source (0 = never merge)
+     */
+    void setCooldown(AlertSource source, uint32_t cooldownMs);
+
+    /**
+     * @brief Submit an alert request
+     * @param request Request to arbitrate
+     * @param nowMs Current time in milliseconds
+     * @return What happened to the request
+     */
+    ArbiterDecision submit(const AlertRequest& request, uint32_t nowMs);
+
+    /**
+     * @brief Advance arbitration (call from the main loop)
+     * @param nowMs Current time in milliseconds
+     * @param outputIdle true when the active alert has finished playing
+     */
+    void update(uint32_t nowMs, bool outputIdle);
+
+    /**
+     * @brief Stop the active alert and flush the queue
+     * @return true if an alert was active or queued
+     */
+    bool clear();
+
+    // Status
+    bool hasActive() const { return m_hasActive; }
+    const AlertRequest& getActive() const { return m_active; }
+    uint8_t getQueueCount() const { return m_queueCount; }
+    const AlertArbiterStats& getStats() const { return m_stats; }
+    void resetStats() { memset(&m_stats, 0, sizeof(m_stats)); }
+};
+
+// ==========================================
+// UTILITY FUNCTIONS
+// ==========================================
+
+/**
+ * @brief Map an alert reason to the source that arbitrates it
+ */
+inline AlertSource alertSourceForReason(AlertReason reason) {
+    switch (reason) {
+        case AlertReason::PROXIMITY_DETECTED:
+        case AlertReason::PROXIMITY_TRIGGER:
+        case AlertReason::BEACON_FOUND: return AlertSource::PROXIMITY;
+        case AlertReason::ZONE_BREACH:
+        case AlertReason::ZONE_ENTERED:
+        case AlertReason::ZONE_EXITED: return AlertSource::ZONE;
+        case AlertReason::LOW_BATTERY:
+        case AlertReason::CRITICAL_BATTERY: return AlertSource::BATTERY;
+        case AlertReason::REMOTE_COMMAND:
+        case AlertReason::LOCATE_REQUEST: return AlertSource::REMOTE;
+        default: return AlertSource::LOCAL;
+    }
+}
+
+/**
+ * @brief Default priority for an alert reason
+ */
+inline AlertPriority alertPriorityForReason(AlertReason reason) {
+    switch (reason) {
+        case AlertReason::CRITICAL_BATTERY: return AlertPriority::CRITICAL;
+        case AlertReason::ZONE_BREACH:
+        case AlertReason::ZONE_EXITED:
+        case AlertReason::LOCATE_REQUEST:
+        case AlertReason::REMOTE_COMMAND: return AlertPriority::ALERT_HIGH;
+        case AlertReason::LOW_BATTERY: return AlertPriority::ALERT_LOW;
+        default: return AlertPriority::NORMAL;
+    }
+}
+
+/**
+ * @brief Convert alert source enum to string
+ */
+inline const char* alertSourceToString(AlertSource source) {
+    switch (source) {
+        case AlertSource::PROXIMITY: return "proximity";
+        case AlertSource::ZONE: return "zone";
+        case AlertSource::BATTERY: return "battery";
+        case AlertSource::REMOTE: return "remote";
+        case AlertSource::LOCAL: return "local";
+        default: return "unknown";
+    }
+}
+
+/**
+ * @brief Convert arbiter decision enum to string
+ */
+inline const char* arbiterDecisionToString(ArbiterDecision decision) {
+    switch (decision) {
+        case ArbiterDecision::STARTED: return "started";
+        case ArbiterDecision::PREEMPTED: return "preempted";
+        case ArbiterDecision::QUEUED: return "queued";
+        case ArbiterDecision::MERGED: return "merged";
+        case ArbiterDecision::DROPPED: return "dropped";
+        default: return "unknown";
+    }
+}
+
+/**
+ * @brief Run fake-clock arbitration tests
+ * @return true if all tests passed
+ */
+bool runAlertArbiterTests();
+
+#endif // ALERT_ARBITER_H
@@ -0,0 +1,134 @@
+#ifndef ALERT_AUDIO_PLAYER_H
+#define ALERT_AUDIO_PLAYER_H
+
+/**
+ * @file AlertAudioPlayer.h
+ * @brief DMA-fed buzzer waveform playback over I2S PDM for ESP32-S3 Pet Collar
+ * @version 1.0.0
+ * @date 2024
+ *
+ * The buzzer pin is driven by the I2S peripheral in PDM TX mode. Samples
+ * are never synthesized while they play:
+ * - Each library waveform is rendered once per output level into a PSRAM
+ *   cache and replayed pass after pass
+ * - Tones loop a buffer holding a whole number of periods; only the 2ms
+ *   attack and release ramps are scaled at play time
+ * A low-priority feeder task hands DMA-sized slices of those buffers to the
+ * I2S driver whenever a DMA buffer frees up. Enabled with
+ * FEATURE_BUZZER_WAVEFORM; otherwise alerts keep the LEDC square-wave path
+ * of AlertPatternEngine.
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+#include "AlertWaveforms.h"
+
+#if FEATURE_BUZZER_WAVEFORM
+
+#include <driver/i2s_pdm.h>
+
+#define ALERT_AUDIO_TONE    WAVEFORM_PATTERN_COUNT  // Clip index of the tone loop
+#define ALERT_AUDIO_STOP    0xFF                    // Clip index that stops playback
+
+/**
+ * @brief A prerendered sample buffer and the parameters it was rendered for
+ */
+struct AlertAudioClip {
+    int16_t* samples;
+    uint32_t capacity;      ///< Buffer size in samples
+    uint32_t length;        ///< Valid samples (0 = not rendered)
+    uint16_t frequency;     ///< Tone loop only
+    uint8_t level;
+};
+
+/**
+ * @brief Streams prerendered waveform samples to the buzzer through I2S DMA
+ */
+class AlertAudioPlayer {
+private:
+    i2s_chan_handle_t m_channel;
+    TaskHandle_t m_task;
+    portMUX_TYPE m_mux;
+
+    // Pending command (written by play/stop, consumed by the feeder task)
+    uint8_t m_pendingClip;
+    uint8_t m_pendingRepeats;
+    uint8_t m_pendingLevel;
+    uint16_t m_pendingFrequency;
+    uint16_t m_pendingDurationMs;
+    uint32_t m_generation;
+
+    volatile bool m_playing;
+    uint32_t m_maxRenderUs;
+
+    // Sample buffers, one per library waveform plus the tone loop (PSRAM,
+    // owned by the feeder task after begin())
+    int16_t* m_arena;
+    AlertAudioClip m_clips[WAVEFORM_PATTERN_COUNT + 1];
+    int16_t m_block[WAVEFORM_DMA_FRAMES];   ///< Ramped tone edges and silence
+
+    /**
+     * @brief FreeRTOS task trampoline
+     */
+    static void feederTask(void* arg);
+
+    /**
+     * @brief Feeder loop: pick up commands and stream clips to DMA
+     */
+    void runFeeder();
+
+    /**
+     * @brief Make sure a clip holds samples for the requested sound
+     * @return true if the clip is ready to play
+     */
+    bool prepareClip(uint8_t clip, uint16_t frequency, uint8_t level);
+
+    /**
+     * @brief Queue a command for the feeder task
+     */
+    void submit(uint8_t clip, uint8_t repeats, uint8_t level, uint16_t frequency, uint16_t durationMs);
+
+public:
+    AlertAudioPlayer();
+
+    /**
+     * @brief Allocate the sample buffers, create the PDM TX channel and feeder task
+     * @param buzzerPin GPIO driven with the PDM bitstream
+     * @return true if playback is available (needs PSRAM for the buffers)
+     */
+    bool begin(uint8_t buzzerPin);
+
+    /**
+     * @brief Play a library waveform (replaces any current playback)
+     * @param pattern Waveform from getWavePattern()
+     * @param repeats Number of passes (0 = until stopped)
+     * @param level Output level (0-255)
+     */
+    bool playPattern(const WavePattern* pattern, uint8_t repeats, uint8_t level);
+
+    /**
+     * @brief Play a single sine tone
+     * @param frequency Tone frequency in Hz
+     * @param durationMs Duration in milliseconds
+     * @param level Output level (0-255)
+     */
+    bool playTone(uint16_t frequency, uint16_t durationMs, uint8_t level);
+
+    /**
+     * @brief Stop playback (the DMA queue drains within ~64ms)
+     */
+    void stop();
+
+    bool isReady() const { return m_channel != nullptr && m_task != nullptr; }
+    bool isPlaying() const { return m_playing; }
+
+    /**
+     * @brief Worst time spent rendering one clip in microseconds (once per
+     *        waveform and level, not per block)
+     */
+    uint32_t getMaxRenderUs() const { return m_maxRenderUs; }
+};
+
+#endif // FEATURE_BUZZER_WAVEFORM
+
+#endif // ALERT_AUDIO_PLAYER_H
@@ -19,35 +19,15 @@
 #include "ESP32_S3_Config.h"
 #include "MicroConfig.h"
 #include "BeaconTypes.h"
+#include "AlertPatternEngine.h"
+#include "AlertArbiter.h"
+#include "AlertAudioPlayer.h"
 
 // ==========================================
 // ALERT PATTERNS & DEFINITIONS
 // ==========================================
 
-// AlertReason now defined in BeaconTypes.h
-
-/**
- * @brief Alert pattern types
- */
-enum class AlertPattern : uint8_t {
-    CONTINUOUS = 0,         ///< Continuous alert
-    PULSE_SLOW,             ///< Slow pulsing (1 Hz)
-    PULSE_FAST,             ///< Fast pulsing (4 Hz)
-    TRIPLE_BEEP,            ///< Three short beeps
-    SOS_PATTERN,            ///< SOS morse code pattern
-    ESCALATING,             ///< Gradually increasing intensity
-    CUSTOM                  ///< Custom pattern
-};
-
-/**
- * @brief Alert priority levels
- */
-enum class AlertPriority : uint8_t {
-    ALERT_LOW = 0,          ///< Low priority (can be overridden)
-    NORMAL,                 ///< Normal priority  
-    ALERT_HIGH,             ///< High priority (overrides normal)
-    CRITICAL                ///< Critical priority (overrides all)
-};
+// AlertReason, AlertPattern and AlertPriority now defined in BeaconTypes.h
 
 /**
  * @brief Alert step in a pattern sequence
@@ -112,9 +92,6 @@ private:
     
     // Pattern control
     AlertSequence m_activeSequence;
-    uint8_t m_currentStep;
-    uint8_t m_repeatCount;
-    unsigned long m_stepStartTime;
     unsigned long m_alertStartTime;
     
     // Configuration
@@ -142,11 +119,6 @@ private:
      */
     AlertSequence getPatternSequence(AlertPattern pattern, AlertMode mode);
     
-    /**
-     * @brief Update current alert step
-     */
-    void updateAlertStep();
-    
     /**
      * @brief Apply power saving adjustments to alert parameters
      * @param volume Input volume
@@ -187,9 +159,6 @@ public:
         m_currentReason(AlertReason::NONE),
         m_currentPriority(AlertPriority::NORMAL),
         m_currentPattern(AlertPattern::CONTINUOUS),
-        m_currentStep(0),
-        m_repeatCount(0),
-        m_stepStartTime(0),
         m_alertStartTime(0),
         m_defaultVolume(BUZZER_DEFAULT_VOLUME),
         m_defaultVibrationIntensity(VIBRATION_DEFAULT_INTENSITY),
@@ -208,6 +177,9 @@ public:
     
     /**
      * @brief Main update loop - call regularly from main loop
+     * 
+     * Pattern steps are advanced by the engine timer; update() only
+     * handles auto-stop and state bookkeeping.
      */
     void update();
     
@@ -436,6 +408,41 @@ inline const char* alertPriorityToString(AlertPriority priority) {
     }
 }
 
+/**
+ * @brief Compile a predefined pattern into a flat step table
+ * @param pattern Pattern type (CUSTOM compiles to nothing)
+ * @param mode Alert mode selecting which outputs are driven
+ * @param volume Buzzer duty (0-255)
+ * @param intensity Vibration duty (0-255)
+ * @param frequency Base buzzer frequency in Hz
+ * @param out Output step table
+ * @param maxSteps Capacity of the output table
+ * @return Number of steps written
+ */
+uint8_t compileAlertPattern(AlertPattern pattern, AlertMode mode, uint8_t volume,
+                            uint8_t intensity, uint16_t frequency,
+                            PatternStep* out, uint8_t maxSteps);
+
+/**
+ * @brief Flatten a custom alert sequence into a step table
+ * @param sequence Source sequence
+ * @param mode Alert mode selecting which outputs are driven
+ * @param out Output step table
+ * @param maxSteps Capacity of the output table
+ * @return Number of steps written
+ */
+uint8_t compileAlertSequence(const AlertSequence& sequence, AlertMode mode,
+                             PatternStep* out, uint8_t maxSteps);
+
+/**
+ * @brief Number of pattern passes needed to fill a duration
+ * @param steps Compiled step table
+ * @param count Number of steps
+ * @param durationMs Requested alert duration
+ * @return Repeat count for AlertPatternEngine::play (at least 1)
+ */
+uint8_t alertRepeatsForDuration(const PatternStep* steps, uint8_t count, uint32_t durationMs);
+
 // ==========================================
 // ENHANCED ALERT MANAGER CLASS
 // ==========================================
@@ -448,6 +455,33 @@ private:
     uint8_t buzzerPin;
     uint8_t vibrationPin;
     bool alertActive;
+    AlertPatternEngine patternEngine;
+    AlertArbiter arbiter;
+    bool waveformBuzzer;        // Buzzer driven by I2S waveforms instead of LEDC
+#if FEATURE_BUZZER_WAVEFORM
+    AlertAudioPlayer audioPlayer;
+#endif
+    
+    /**
+     * @brief Check if the engine or the waveform player is still sounding
+     */
+    bool outputsPlaying() const;
+    
+    /**
+     * @brief Compile and start a pattern on the engine
+     * @param pattern Pattern type
+     * @param mode Alert mode
+     * @param intensity Intensity (1-5 scale or 0-255 duty)
+     * @param durationMs Total alert duration in milliseconds
+     * @param frequency Buzzer frequency in Hz (0 = default)
+     * @return true if playback started
+     */
+    bool playPattern(AlertPattern pattern, AlertMode mode, uint8_t intensity, uint32_t durationMs,
+                     uint16_t frequency = 0);
+    
+    // Arbiter output hooks
+    static bool arbiterStart(const AlertRequest& request, void* context);
+    static void arbiterStop(void* context);
     
 public:
     AlertManager_Enhanced(uint8_t buzzerPin, uint8_t vibrationPin);
@@ -458,7 +492,22 @@ public:
     bool isAlertActive() const;
     bool initialize();
     bool triggerAlert(const AlertConfig& config);
-    bool startAlert(AlertReason reason, AlertMode mode = AlertMode::BOTH, int pattern = 1, int priority = 1, const String& customReason = "");
+    bool startAlert(AlertReason reason, AlertMode mode = AlertMode::BOTH, int pattern = 1, int priority = -1, const String& customReason = "");
+    bool playTone(uint16_t frequency, uint16_t durationMs, uint8_t volume = BUZZER_DEFAULT_VOLUME);
+    
+    /**
+     * @brief Submit an alert through priority arbitration
+     * @param request Alert request (source, priority, pattern, duration)
+     * @return Whether the alert started, preempted, queued, merged or was dropped
+     */
+    ArbiterDecision submitAlert(const AlertRequest& request);
+    
+    // Diagnostics
+    AlertPatternEngine& getPatternEngine() { return patternEngine; }
+    AlertArbiter& getArbiter() { return arbiter; }
+#if FEATURE_BUZZER_WAVEFORM
+    AlertAudioPlayer& getAudioPlayer() { return audioPlayer; }
+#endif
     
     // Utility functions
     AlertMode stringToAlertMode(const String& modeStr);
@@ -0,0 +1,194 @@
+#ifndef ALERT_PATTERN_ENGINE_H
+#define ALERT_PATTERN_ENGINE_H
+
+/**
+ * @file AlertPatternEngine.h
+ * @brief Table-driven alert pattern playback for ESP32-S3 Pet Collar
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Alert patterns are compiled into a flat table of PatternStep entries and
+ * played back from an esp_timer callback that drives LEDC directly:
+ * - Step deadlines are absolute, so timer latency never accumulates as drift
+ * - Playback does not depend on loop() cadence (BLE scans, MQTT, WebSocket)
+ * - Outputs are written from a single context (the timer task)
+ * - A manual clock mode (no timer, output hook) allows deterministic testing
+ * - play() and stop() bump a generation counter; a callback that started
+ *   under an older generation does not re-arm the timer, so a pattern that
+ *   was replaced or stopped can never keep itself alive
+ *
+ * The step state machine itself is PatternSequencer, which has no Arduino
+ * dependencies and is covered by firmware/tools/alert_engine_test.cpp.
+ */
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "PatternSequencer.h"
+
+/**
+ * @brief Output hook used instead of LEDC (testing and simulation)
+ */
+typedef void (*PatternOutputFn)(uint16_t buzzerFreq, uint8_t buzzerDuty,
+                                uint8_t vibrationDuty, void* context);
+
+/**
+ * @brief Plays compiled PatternStep tables from an esp_timer
+ */
+class AlertPatternEngine {
+private:
+    esp_timer_handle_t m_timer;
+    portMUX_TYPE m_mux;
+
+    // Hardware
+    uint8_t m_buzzerPin;
+    uint8_t m_vibrationPin;
+    uint8_t m_resolutionBits;
+    bool m_attached;
+
+    // Playback state (guarded by m_mux)
+    PatternSequencer m_sequencer;
+    uint32_t m_generation;      ///< Bumped by play()/stop()
+    uint32_t m_timerErrors;     ///< esp_timer arms that failed
+
+    // Last applied outputs (written only from the output context)
+    uint16_t m_lastBuzzerFreq;
+    int16_t m_lastBuzzerDuty;
+    int16_t m_lastVibrationDuty;
+
+    PatternOutputFn m_outputHook;
+    void* m_outputContext;
+
+    /**
+     * @brief esp_timer callback trampoline
+     * @param arg Engine instance
+     */
+    static void onTimer(void* arg);
+
+    /**
+     * @brief Re-arm the timer for an absolute deadline from the callback
+     * @param deadlineUs Deadline in esp_timer microseconds (<0 = none)
+     * @param generation Generation the callback started under; a stale one is not re-armed
+     */
+    void scheduleAt(int64_t deadlineUs, uint32_t generation);
+
+    /**
+     * @brief Kick the timer so the next output write happens in timer context
+     */
+    void kick();
+
+    /**
+     * @brief Write outputs to LEDC or the output hook (skips unchanged values)
+     */
+    void applyOutputs(uint16_t buzzerFreq, uint8_t buzzerDuty, uint8_t vibrationDuty);
+
+    /**
+     * @brief Scale an 8-bit duty to the configured LEDC resolution
+     */
+    uint32_t scaleDuty(uint8_t duty) const;
+
+public:
+    /**
+     * @brief Constructor
+     */
+    AlertPatternEngine();
+
+    /**
+     * @brief Destructor - stops and releases the timer
+     */
+    ~AlertPatternEngine();
+
+    /**
+     * @brief Attach LEDC outputs and create the playback timer
+     * @param buzzerPin Buzzer GPIO (ALERT_ENGINE_NO_PIN = leave undriven)
+     * @param vibrationPin Vibration motor GPIO
+     * @param buzzerFreq Initial buzzer frequency in Hz
+     * @param vibrationFreq Vibration PWM frequency in Hz
+     * @param resolutionBits LEDC resolution in bits
+     * @return true if outputs and timer are ready
+     */
+    bool begin(uint8_t buzzerPin, uint8_t vibrationPin,
+               uint32_t buzzerFreq, uint32_t vibrationFreq, uint8_t resolutionBits);
+
+    /**
+     * @brief Start playing a compiled step table (replaces any current pattern)
+     * @param steps Step table (copied into the engine)
+     * @param count Number of steps
+     * @param repeats Number of passes through the table (0 = until stopped)
+     * @param nowUs Start time in microseconds (<0 = esp_timer_get_time())
+     * @return true if playback started
+     */
+    bool play(const PatternStep* steps, uint8_t count, uint8_t repeats, int64_t nowUs = -1);
+
+    /**
+     * @brief Stop playback and silence all outputs
+     */
+    void stop();
+
+    /**
+     * @brief Advance the step state machine to a point in time
+     *
+     * Called from the timer callback with the real clock, or directly with
+     * a fake clock when no timer is attached. All steps whose deadlines have
+     * passed are consumed so late callbacks never shift the schedule.
+     *
+     * @param nowUs Current time in microseconds
+     * @return Absolute deadline of the next step change, or -1 when finished
+     */
+    int64_t advance(int64_t nowUs);
+
+    /**
+     * @brief Route outputs to a hook instead of LEDC
+     * @param hook Output function (nullptr restores LEDC)
+     * @param context Opaque pointer passed to the hook
+     */
+    void setOutputHook(PatternOutputFn hook, void* context = nullptr);
+
+    /**
+     * @brief Check if a pattern is playing
+     */
+    bool isPlaying() const { return m_sequencer.isPlaying(); }
+
+    /**
+     * @brief Get index of the step currently playing
+     */
+    uint8_t getCurrentStep() const { return m_sequencer.getCurrentStep(); }
+
+    /**
+     * @brief Get worst observed lateness of a step change in microseconds
+     */
+    uint32_t getMaxLatenessUs() const { return m_sequencer.getMaxLatenessUs(); }
+
+    /**
+     * @brief Get number of times the playback timer could not be armed
+     */
+    uint32_t getTimerErrors() const { return m_timerErrors; }
+
+    /**
+     * @brief Reset timing statistics
+     */
+    void resetStats() { m_sequencer.resetStats(); }
+
+    /**
+     * @brief Total duration of one pass through a table
+     * @param steps Step table
+     * @param count Number of steps
+     * @return Cycle length in milliseconds
+     */
+    static uint32_t cycleDurationMs(const PatternStep* steps, uint8_t count) {
+        return PatternSequencer::cycleDurationMs(steps, count);
+    }
+};
+
+/**
+ * @brief Play a short muted pattern on an engine's real timer
+ *
+ * Checks the esp_timer path on hardware: every step is written, the pattern
+ * ends silent and no step change is more than 1 ms late. The sequencing
+ * logic itself is tested on the host (firmware/tools/alert_engine_test.cpp).
+ *
+ * @param engine Engine set up with begin(); must be idle
+ * @return true if the pattern played on time
+ */
+bool runAlertPatternEngineSmokeTest(AlertPatternEngine& engine);
+
+#endif // ALERT_PATTERN_ENGINE_H
@@ -0,0 +1,177 @@
+#ifndef ALERT_WAVEFORMS_H
+#define ALERT_WAVEFORMS_H
+
+/**
+ * @file AlertWaveforms.h
+ * @brief Flash-resident buzzer waveform library for ESP32-S3 Pet Collar
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Each AlertPattern has a waveform made of short segments (tones, linear
+ * chirps, two-tone chords, silence). Segments are rendered into sample
+ * blocks with a phase accumulator and a sine table, so frequency sweeps
+ * cost nothing per step and every segment gets click-free attack/release
+ * ramps instead of a hard square-wave edge. The firmware renders each
+ * waveform's cycle once and replays the samples; every cycle ends in a
+ * ramp or silence, so repeating it is seamless.
+ *
+ * This header and alert_waveforms.cpp have no Arduino dependencies so the
+ * host renderer (firmware/tools/render_alert_wavs.cpp) plays the exact
+ * same tables into WAV files.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==========================================
+// WAVEFORM PARAMETERS
+// ==========================================
+
+#define WAVEFORM_SAMPLE_RATE_HZ     16000  // Output sample rate
+#define WAVEFORM_RAMP_MS            2      // Attack/release ramp per segment
+#define WAVEFORM_REPEAT_FOREVER     0      // Repeat count meaning "until stopped"
+#define WAVEFORM_PATTERN_COUNT      6      // Waveforms for AlertPattern::CONTINUOUS..ESCALATING
+#define WAVEFORM_TONE_LOOP_SAMPLES  WAVEFORM_SAMPLE_RATE_HZ  // 1s holds whole periods of any integer frequency
+
+/**
+ * @brief Segment synthesis types
+ */
+enum WaveSegmentType : uint8_t {
+    WAVE_SILENCE = 0,       ///< No output
+    WAVE_TONE,              ///< Sine at freqA
+    WAVE_CHIRP,             ///< Linear sweep from freqA to freqB
+    WAVE_TWO_TONE           ///< freqA and freqB mixed
+};
+
+/**
+ * @brief One segment of a waveform
+ */
+struct WaveSegment {
+    uint8_t type;           ///< WaveSegmentType
+    uint16_t durationMs;    ///< Segment duration in milliseconds
+    uint16_t freqA;         ///< Tone / sweep start frequency in Hz
+    uint16_t freqB;         ///< Sweep end / second tone frequency in Hz
+    uint8_t level;          ///< Relative amplitude (0-255)
+};
+
+/**
+ * @brief Named waveform in the library
+ */
+struct WavePattern {
+    const char* name;
+    const WaveSegment* segments;
+    uint8_t count;
+};
+
+/**
+ * @brief Look up the waveform for an AlertPattern value
+ * @param patternId (uint8_t)AlertPattern
+ * @return Waveform, or nullptr if the pattern has none (CUSTOM)
+ */
+const WavePattern* getWavePattern(uint8_t patternId);
+
+/**
+ * @brief Duration of one pass through a waveform
+ */
+uint32_t waveCycleDurationMs(const WavePattern* pattern);
+
+/**
+ * @brief Number of samples in one pass through a waveform
+ */
+uint32_t waveCycleSamples(const WavePattern* pattern);
+
+/**
+ * @brief Render one pass of a waveform
+ * @param pattern Waveform from getWavePattern()
+ * @param level Output scale (0-255)
+ * @param out Sample buffer
+ * @param capacity Buffer capacity in samples
+ * @return Samples written (0 if the cycle does not fit)
+ */
+size_t renderWaveCycle(const WavePattern* pattern, uint8_t level, int16_t* out, size_t capacity);
+
+/**
+ * @brief Render a loopable sine tone: a whole number of periods, no ramps
+ * @param frequency Tone frequency in Hz
+ * @param level Output scale (0-255)
+ * @param out Sample buffer
+ * @param capacity Buffer capacity (WAVEFORM_TONE_LOOP_SAMPLES fits any frequency)
+ * @return Samples written (whole periods), 0 if one period does not fit
+ */
+size_t renderToneLoop(uint16_t frequency, uint8_t level, int16_t* out, size_t capacity);
+
+/**
+ * @brief Apply the attack/release ramp to part of a looped tone
+ * @param samples Samples starting at index @p first of the tone
+ * @param count Number of samples
+ * @param first Index of samples[0] within the tone
+ * @param total Tone length in samples
+ */
+void applyToneRamp(int16_t* samples, size_t count, uint32_t first, uint32_t total);
+
+// ==========================================
+// WAVEFORM RENDERER
+// ==========================================
+
+/**
+ * @brief Renders waveform segments into 16-bit mono sample blocks
+ *
+ * Phase is carried across blocks and segments, so a pattern can be
+ * rendered in DMA-sized pieces without discontinuities.
+ */
+class WaveformRenderer {
+private:
+    const WaveSegment* m_segments;
+    uint8_t m_count;
+    uint8_t m_repeats;
+    uint8_t m_pass;
+    uint8_t m_level;
+    uint8_t m_segment;
+    uint32_t m_sample;          // Sample index within the current segment
+    uint32_t m_segmentSamples;  // Length of the current segment in samples
+    uint32_t m_phaseA;          // Q32 phase accumulators
+    uint32_t m_phaseB;
+    bool m_active;
+
+    void loadSegment();
+
+public:
+    WaveformRenderer();
+
+    /**
+     * @brief Start rendering a segment list
+     * @param segments Segment table (must outlive playback)
+     * @param count Number of segments
+     * @param repeats Number of passes (0 = until stopped)
+     * @param level Output scale (0-255)
+     * @return true if rendering started
+     */
+    bool start(const WaveSegment* segments, uint8_t count, uint8_t repeats, uint8_t level);
+
+    /**
+     * @brief Stop rendering
+     */
+    void stop() { m_active = false; }
+
+    /**
+     * @brief Check if samples remain
+     */
+    bool isActive() const { return m_active; }
+
+    /**
+     * @brief Render the next block of samples
+     * @param out Sample buffer
+     * @param maxSamples Buffer capacity
+     * @return Samples written (less than maxSamples only when finished)
+     */
+    size_t render(int16_t* out, size_t maxSamples);
+
+    /**
+     * @brief Number of samples in a duration
+     */
+    static uint32_t samplesFor(uint32_t durationMs) {
+        return durationMs * (WAVEFORM_SAMPLE_RATE_HZ / 1000);
+    }
+};
+
+#endif // ALERT_WAVEFORMS_H
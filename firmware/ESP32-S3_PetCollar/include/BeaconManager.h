@@ -632,6 +632,13 @@ public:
         int cooldownPeriod
     );
     
+    /**
+     * @brief Remove one proximity configuration (the others keep their runtime state)
+     * @param beaconId Beacon identifier
+     * @return true if it existed
+     */
+    bool removeProximityBeacon(const String& beaconId);
+    
     /**
      * @brief Clear all proximity configurations
      */
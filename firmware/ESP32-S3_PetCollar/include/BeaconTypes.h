@@ -37,6 +37,29 @@ enum class AlertReason : uint8_t {
     PROXIMITY_TRIGGER       ///< Proximity-based triggering from transmitter
 };
 
+/**
+ * @brief Alert pattern types
+ */
+enum class AlertPattern : uint8_t {
+    CONTINUOUS = 0,         ///< Continuous alert
+    PULSE_SLOW,             ///< Slow pulsing (1 Hz)
+    PULSE_FAST,             ///< Fast pulsing (4 Hz)
+    TRIPLE_BEEP,            ///< Three short beeps
+    SOS_PATTERN,            ///< SOS morse code pattern
+    ESCALATING,             ///< Gradually increasing intensity
+    CUSTOM                  ///< Custom pattern
+};
+
+/**
+ * @brief Alert priority levels
+ */
+enum class AlertPriority : uint8_t {
+    ALERT_LOW = 0,          ///< Low priority (can be overridden)
+    NORMAL,                 ///< Normal priority  
+    ALERT_HIGH,             ///< High priority (overrides normal)
+    CRITICAL                ///< Critical priority (overrides all)
+};
+
 // ==================== SHARED STRUCTS ====================
 
 /**
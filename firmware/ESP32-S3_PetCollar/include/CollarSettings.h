@@ -0,0 +1,160 @@
+#ifndef COLLAR_SETTINGS_H
+#define COLLAR_SETTINGS_H
+
+/**
+ * @file CollarSettings.h
+ * @brief Typed, versioned settings record kept in the ConfigStore
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Everything the collar used to forget on reboot (proximity beacon configs,
+ * RSSI filter parameters, telemetry deadbands) and what it kept in
+ * Preferences (WiFi credentials, fast-connect record, telemetry format)
+ * lives in one fixed-size struct. It is read once at boot and then only
+ * accessed through get(); changes go through edit() and are written as one
+ * record once they have settled for SETTINGS_SAVE_DELAY_MS, so a batch of
+ * beacon configs costs a single flash write.
+ *
+ * Schema changes only append fields and bump COLLAR_SETTINGS_VERSION. A
+ * record from an older version is copied over the defaults, so appended
+ * fields keep their default values, and migrateCollarSettings() fixes up
+ * anything that changed meaning. A record from a newer firmware is left on
+ * flash untouched: the collar runs on defaults and never saves over it, so
+ * reinstalling that firmware finds its settings again.
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+#include "ConfigStore.h"
+#include "WiFiFastConnect.h"
+
+#define COLLAR_SETTINGS_VERSION     1
+#define SETTINGS_MAX_PROXIMITY      16      // Proximity beacon configs kept across reboots
+
+/**
+ * @brief One proximity beacon config (ProximityBeaconConfig without runtime state)
+ */
+struct ProximitySetting {
+    char beaconId[24];
+    char beaconName[32];
+    char macAddress[18];
+    char alertMode[14];         ///< buzzer, vibration, both, none
+    uint16_t triggerDistance;   ///< cm
+    uint8_t alertIntensity;     ///< 1-5
+    uint8_t enableProximityDelay;
+    uint32_t alertDuration;     ///< ms
+    uint32_t proximityDelayTime;///< ms
+    uint32_t cooldownPeriod;    ///< ms
+};
+
+static_assert(sizeof(ProximitySetting) == 104, "Proximity setting layout");
+
+/**
+ * @brief Persisted settings, schema COLLAR_SETTINGS_VERSION
+ */
+struct CollarSettings {
+    // ---- Version 1 ----
+    char wifiSsid[33];          ///< Primary network
+    char wifiPassword[65];
+    uint8_t telemetryFormat;    ///< TelemetryFormat
+    uint8_t deadbandRssiDbm;
+    uint16_t keyframeInterval;
+    uint16_t reserved;
+    uint32_t keyframeMaxMs;
+    uint32_t deadbandHeapBytes;
+    float deadbandPositionM;
+    float deadbandConfidence;
+    float iirAlpha;
+    float kalmanQ;
+    float kalmanR;
+    WiFiFastRecord wifiFast;    ///< version 0 = nothing cached
+    uint8_t proximityCount;
+    uint8_t reserved2[3];
+    ProximitySetting proximity[SETTINGS_MAX_PROXIMITY];
+};
+
+/**
+ * @brief Defaults from ESP32_S3_Config.h
+ */
+void defaultCollarSettings(CollarSettings& settings);
+
+/**
+ * @brief Rebuild settings from a stored record of schema @p version
+ * @return false if the record is from a newer firmware (defaults kept)
+ */
+bool migrateCollarSettings(CollarSettings& settings, const void* data, size_t length, uint16_t version);
+
+/**
+ * @brief Hash of one proximity config, identical to the dashboard's (src/lib/proximity-sync.ts)
+ *
+ * 32-bit FNV-1a over "id|name|mac|alertMode|distance|duration|intensity|
+ * delay(0/1)|delayTime|cooldown", strings as stored (truncated to their
+ * field sizes) and numbers in decimal.
+ */
+uint32_t proximitySettingHash(const ProximitySetting& proximity);
+
+/**
+ * @brief Hash of the proximity config set: the sum of the entry hashes, so order does not matter
+ */
+uint32_t proximitySetHash(const CollarSettings& settings);
+
+/**
+ * @brief Settings loaded at boot with debounced write-back
+ */
+class CollarSettingsStore {
+private:
+    ConfigStore m_store;
+    CollarSettings m_settings;
+    bool m_loaded;              ///< Settings came from a stored record
+    bool m_newerRecord;         ///< Stored record is from newer firmware (store is read-only)
+    uint16_t m_loadedVersion;
+    bool m_dirty;
+    uint32_t m_changedMs;
+
+public:
+    CollarSettingsStore();
+
+    /**
+     * @brief Load the current record (or defaults) from @p storage
+     * @return true if a stored record was restored (false with defaults
+     *         for a newer record, see hasNewerRecord())
+     */
+    bool begin(OutboxStorage* storage);
+
+    const CollarSettings& get() const { return m_settings; }
+
+    /**
+     * @brief Settings to change; they are saved once changes stop for SETTINGS_SAVE_DELAY_MS
+     */
+    CollarSettings& edit(uint32_t nowMs);
+
+    /**
+     * @brief Write pending changes when they have settled
+     */
+    void service(uint32_t nowMs);
+
+    /**
+     * @brief Write pending changes now
+     * @return true if nothing was pending or the record was written; false
+     *         (changes dropped, kept until reboot) without storage or while
+     *         a newer record is being preserved
+     */
+    bool saveNow();
+
+    bool isReady() const { return m_store.isReady(); }
+    bool isLoaded() const { return m_loaded; }
+    bool hasNewerRecord() const { return m_newerRecord; }
+    bool isDirty() const { return m_dirty; }
+    uint16_t getLoadedVersion() const { return m_loadedVersion; }
+    const ConfigStoreStats& getStats() const { return m_store.getStats(); }
+};
+
+extern CollarSettingsStore collarSettings;
+
+/**
+ * @brief Run settings store self-tests
+ * @return true if all tests passed
+ */
+bool runCollarSettingsTests();
+
+#endif // COLLAR_SETTINGS_H
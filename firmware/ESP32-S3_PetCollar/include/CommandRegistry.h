@@ -0,0 +1,169 @@
+#ifndef COMMAND_REGISTRY_H
+#define COMMAND_REGISTRY_H
+
+/**
+ * @file CommandRegistry.h
+ * @brief One command table shared by WebSocket, MQTT and serial
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Commands are registered once as a table sorted by name and looked up by
+ * binary search, instead of three String if/else chains. Every entry says
+ * which sources may run it. Arguments are parsed into a single
+ * StaticJsonDocument owned by the registry (zero-copy from the caller's
+ * buffer), so dispatching a command allocates nothing on the heap.
+ *
+ * Sources and argument forms:
+ * - WebSocket: {"command":"get_status", ...}
+ * - MQTT:      {"cmd":"test-alert", ...} on .../command, or the subtopic
+ *              name (.../command/locate) when there is no "cmd" key
+ * - Serial:    name followed by plain text ("rssi-get aa:bb:...") or by a
+ *              JSON object ("test-alert {\"alertMode\":\"both\"}")
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "ESP32_S3_Config.h"
+
+// ==========================================
+// COMMAND DEFINITIONS
+// ==========================================
+
+/**
+ * @brief Where a command came from (bit values, combined in CommandEntry::sources)
+ */
+enum CommandSource : uint8_t {
+    CMD_SRC_WEBSOCKET = 0x01,
+    CMD_SRC_MQTT      = 0x02,
+    CMD_SRC_SERIAL    = 0x04,
+    CMD_SRC_ALL       = 0x07
+};
+
+/**
+ * @brief Everything a handler needs to run and answer a command
+ */
+struct CommandContext {
+    CommandSource source;
+    uint8_t clientNum;      ///< WebSocket client (WebSocket source only)
+    const char* name;       ///< Command name as looked up
+    JsonVariantConst args;  ///< Parsed JSON arguments (null if none)
+    const char* text;       ///< Serial plain-text arguments ("" if none)
+};
+
+typedef void (*CommandHandler)(const CommandContext& ctx);
+
+/**
+ * @brief One registered command
+ */
+struct CommandEntry {
+    const char* name;
+    CommandHandler handler;
+    uint8_t sources;        ///< CommandSource bits allowed to run it
+    const char* usage;      ///< Serial argument synopsis ("" if none)
+    const char* help;       ///< One-line description for help
+};
+
+/**
+ * @brief Outcome of a dispatch
+ */
+enum class CommandStatus : uint8_t {
+    OK = 0,
+    UNKNOWN,                ///< No such command
+    NOT_ALLOWED,            ///< Command not available from this source
+    PARSE_ERROR,            ///< Arguments are not valid JSON or do not fit the arena
+    NO_COMMAND,             ///< Empty line or no command name
+    BUSY                    ///< A handler tried to dispatch another command
+};
+
+/**
+ * @brief Dispatch statistics
+ */
+struct CommandStats {
+    uint32_t dispatched;
+    uint32_t unknown;
+    uint32_t rejected;      ///< NOT_ALLOWED
+    uint32_t parseErrors;
+    uint16_t maxArenaBytes; ///< Largest arena use by one command
+    uint32_t maxHandlerUs;  ///< Slowest handler
+};
+
+// ==========================================
+// REGISTRY
+// ==========================================
+
+/**
+ * @brief Sorted command table with a preallocated argument arena
+ */
+class CommandRegistry {
+private:
+    const CommandEntry* m_table;
+    size_t m_count;
+    StaticJsonDocument<COMMAND_ARENA_BYTES> m_arena;
+    const char* m_lastName;
+    bool m_busy;
+    CommandStats m_stats;
+
+    /**
+     * @brief Look up @p name and run it with m_arena as arguments
+     */
+    CommandStatus run(CommandSource source, uint8_t clientNum, const char* name,
+                      JsonVariantConst args, const char* text);
+
+public:
+    CommandRegistry();
+
+    /**
+     * @brief Install the command table
+     * @param table Entries sorted by strcmp() of their names, no duplicates
+     * @return false (and the table is not installed) if it is not sorted
+     */
+    bool begin(const CommandEntry* table, size_t count);
+
+    /**
+     * @brief Binary search for a command
+     * @return Entry or nullptr
+     */
+    const CommandEntry* find(const char* name) const;
+
+    /**
+     * @brief Parse a JSON command in place and run it
+     * @param json Mutable buffer holding the message (strings are not copied)
+     * @param nameKey Key holding the command name ("command", "cmd")
+     * @param fallbackName Name used when @p nameKey is missing (may be nullptr)
+     */
+    CommandStatus dispatchJson(CommandSource source, uint8_t clientNum, char* json, size_t length,
+                               const char* nameKey, const char* fallbackName = nullptr);
+
+    /**
+     * @brief Split a serial line into name and arguments and run it
+     * @param line Mutable NUL-terminated line (modified in place)
+     */
+    CommandStatus dispatchLine(char* line);
+
+    /**
+     * @brief Name of the last dispatched command (valid until the next dispatch)
+     */
+    const char* getLastName() const { return m_lastName; }
+
+    /**
+     * @brief Print usage of the commands available from @p sources
+     * @param prefix Only names starting with this (nullptr for all)
+     */
+    void printHelp(uint8_t sources, const char* prefix = nullptr) const;
+
+    size_t getCount() const { return m_count; }
+    const CommandStats& getStats() const { return m_stats; }
+};
+
+/**
+ * @brief Readable name of a dispatch status
+ */
+const char* commandStatusToString(CommandStatus status);
+
+/**
+ * @brief Run command registry self-tests
+ * @return true if all tests passed
+ */
+bool runCommandRegistryTests();
+
+#endif // COMMAND_REGISTRY_H
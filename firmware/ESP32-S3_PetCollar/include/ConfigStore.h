@@ -0,0 +1,103 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+/**
+ * @file ConfigStore.h
+ * @brief Versioned, CRC-checked settings blob in a wear-leveled flash log
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Holds one binary settings record (see CollarSettings.h) so the collar
+ * boots with its proximity configs, filter parameters and telemetry
+ * settings without a round of Preferences string lookups or the dashboard
+ * re-sending them:
+ * - Each save appends a new record [magic | version | length | generation
+ *   | CRC-32] + payload after the previous one, rotating through the
+ *   sectors of the region, so erases are spread evenly
+ * - The payload is written before the header and read back before the
+ *   save counts; a record torn by a reset has no valid header and the
+ *   previous one stays current (the sector holding it is never erased)
+ * - At boot the valid record with the highest generation wins, and its
+ *   schema version is handed to the caller for migration
+ *
+ * It shares the NOR-semantics OutboxStorage interface with the MQTT
+ * outbox. This header and config_store.cpp have no Arduino dependencies
+ * so the host test (firmware/tools/config_store_test.cpp) runs the same
+ * code with injected power cuts.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "MqttOutbox.h"
+
+#define CONFIG_STORE_HEADER_SIZE    16
+
+/**
+ * @brief Store statistics
+ */
+struct ConfigStoreStats {
+    uint32_t saves;         ///< Records written since boot
+    uint32_t erases;        ///< Sectors erased since boot
+    uint32_t failures;      ///< Saves that did not read back intact
+    uint32_t corrupt;       ///< Records skipped at boot on a CRC mismatch
+    uint32_t generation;    ///< Generation of the current record (0 = none)
+};
+
+/**
+ * @brief Log of settings records on erasable storage
+ */
+class ConfigStore {
+private:
+    OutboxStorage* m_storage;
+    uint16_t m_sectorCount;
+    uint32_t m_sectorSize;
+
+    bool m_found;           ///< A valid record exists
+    uint16_t m_sector;      ///< Location of the current record
+    uint32_t m_offset;
+    uint16_t m_version;
+    uint16_t m_length;
+
+    uint16_t m_writeSector; ///< Where the next record goes
+    uint32_t m_writeOffset;
+    ConfigStoreStats m_stats;
+
+    bool checkRecord(uint32_t address, uint16_t& version, uint16_t& length, uint32_t& generation);
+    bool isErased(uint32_t address, uint32_t length);
+    bool append(const void* data, uint16_t length, uint16_t version);
+
+public:
+    ConfigStore();
+
+    /**
+     * @brief Scan the storage for the current record
+     * @return false if the storage is unusable (fewer than two sectors)
+     */
+    bool begin(OutboxStorage* storage);
+
+    bool isReady() const { return m_storage != nullptr; }
+    bool hasRecord() const { return m_found; }
+    uint16_t getVersion() const { return m_version; }
+    uint16_t getLength() const { return m_length; }
+
+    /**
+     * @brief Copy the current record's payload
+     * @return Bytes copied (at most @p capacity), 0 if there is no record
+     */
+    size_t load(void* data, size_t capacity);
+
+    /**
+     * @brief Write a new current record
+     * @return true once the record is on storage and reads back intact
+     */
+    bool save(const void* data, uint16_t length, uint16_t version);
+
+    /**
+     * @brief Largest payload a record can hold
+     */
+    size_t maxPayload() const { return m_sectorSize > CONFIG_STORE_HEADER_SIZE ? m_sectorSize - CONFIG_STORE_HEADER_SIZE : 0; }
+
+    const ConfigStoreStats& getStats() const { return m_stats; }
+};
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,147 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+/**
+ * @file DeferredLog.h
+ * @brief Leveled logging with compile-time elimination and deferred serial output
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Serial.printf on the BLE callback or alert path blocks that task for as
+ * long as the UART (or USB CDC) takes to accept the line. LOGE/LOGW/LOGI/
+ * LOGD/LOGV replace it there:
+ * - A call above COLLAR_LOG_LEVEL is removed by the preprocessor, format
+ *   string, arguments and all (set per build with -DCOLLAR_LOG_LEVEL=n)
+ * - A call at or below the level formats the line on the caller's stack
+ *   and copies it into a byte ring; nothing touches the serial port
+ * - A task at LOG_TASK_PRIORITY writes queued lines to Serial whenever
+ *   nothing more important is ready
+ *
+ * When the ring is full new lines are dropped and counted; the drain task
+ * reports the count. Lines logged before begin() are kept and written
+ * once the task starts. Not for ISRs (use TRACE()).
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+
+/**
+ * @brief Log levels (DEBUG_LOG_LEVEL_* values)
+ */
+enum class LogLevel : uint8_t {
+    ERROR = DEBUG_LOG_LEVEL_ERROR,
+    WARNING = DEBUG_LOG_LEVEL_WARNING,
+    INFO = DEBUG_LOG_LEVEL_INFO,
+    DEBUG = DEBUG_LOG_LEVEL_DEBUG,
+    VERBOSE = DEBUG_LOG_LEVEL_VERBOSE
+};
+
+/**
+ * @brief Byte ring of formatted lines plus the task that prints them
+ *
+ * Entries are [level][length][text], packed back to back and wrapping at
+ * the end of the buffer.
+ */
+class DeferredLog {
+private:
+    uint8_t* m_data;
+    uint32_t m_mask;            ///< Buffer size - 1
+    uint32_t m_head;            ///< Total bytes written
+    uint32_t m_tail;            ///< Total bytes consumed
+    uint32_t m_dropped;         ///< Lines refused because the ring was full
+    uint32_t m_reportedDrops;   ///< m_dropped already announced by the drain task
+    uint32_t m_lines;           ///< Lines queued since boot
+    uint32_t m_highWater;       ///< Most bytes queued at once
+    TaskHandle_t m_task;
+    portMUX_TYPE m_mux;
+
+    void copyIn(uint32_t offset, const void* source, uint32_t length);
+    void copyOut(uint32_t offset, void* destination, uint32_t length) const;
+
+    static void drainTask(void* arg);
+
+public:
+    /**
+     * @param buffer Ring storage, @p size bytes (a power of two)
+     */
+    DeferredLog(uint8_t* buffer, uint32_t size);
+
+    /**
+     * @brief Start the drain task
+     * @return false if it could not be created (lines then wait for flush())
+     */
+    bool begin();
+
+    /**
+     * @brief Format and queue one line (a newline is added)
+     */
+    void log(LogLevel level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+    /**
+     * @brief Queue preformatted text
+     * @return false if the ring was full
+     */
+    bool push(LogLevel level, const char* text, size_t length);
+
+    /**
+     * @brief Take the oldest line
+     * @param out Receives the text, NUL-terminated (truncated to @p capacity - 1)
+     * @return false if the ring is empty
+     */
+    bool pop(char* out, size_t capacity, LogLevel& level);
+
+    /**
+     * @brief Write everything queued from the calling task (before a restart)
+     */
+    void flush();
+
+    uint32_t getQueuedBytes() const { return m_head - m_tail; }
+    uint32_t getDropped() const { return m_dropped; }
+    uint32_t getLines() const { return m_lines; }
+    uint32_t getHighWater() const { return m_highWater; }
+};
+
+extern DeferredLog collarLog;
+
+#if COLLAR_LOG_LEVEL >= DEBUG_LOG_LEVEL_ERROR
+#define LOGE(...) collarLog.log(LogLevel::ERROR, __VA_ARGS__)
+#else
+#define LOGE(...) do {} while (0)
+#endif
+
+#if COLLAR_LOG_LEVEL >= DEBUG_LOG_LEVEL_WARNING
+#define LOGW(...) collarLog.log(LogLevel::WARNING, __VA_ARGS__)
+#else
+#define LOGW(...) do {} while (0)
+#endif
+
+#if COLLAR_LOG_LEVEL >= DEBUG_LOG_LEVEL_INFO
+#define LOGI(...) collarLog.log(LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOGI(...) do {} while (0)
+#endif
+
+#if COLLAR_LOG_LEVEL >= DEBUG_LOG_LEVEL_DEBUG
+#define LOGD(...) collarLog.log(LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOGD(...) do {} while (0)
+#endif
+
+#if COLLAR_LOG_LEVEL >= DEBUG_LOG_LEVEL_VERBOSE
+#define LOGV(...) collarLog.log(LogLevel::VERBOSE, __VA_ARGS__)
+#else
+#define LOGV(...) do {} while (0)
+#endif
+
+/**
+ * @brief Level name used in stats
+ */
+const char* logLevelToString(LogLevel level);
+
+/**
+ * @brief Run deferred log self-tests
+ * @return true if all tests passed
+ */
+bool runDeferredLogTests();
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,84 @@
+#ifndef DISPLAY_DIRTY_PAGES_H
+#define DISPLAY_DIRTY_PAGES_H
+
+/**
+ * @file DisplayDirtyPages.h
+ * @brief Per-page column spans of an SSD1306 frame that need sending
+ * @version 1.0.0
+ * @date 2024
+ *
+ * StatusView fills these as it draws; DisplayFlusher copies and sends
+ * them. No Arduino dependencies, so the flusher's host test
+ * (firmware/tools/display_flush_test.cpp) can use them too.
+ */
+
+#include <stdint.h>
+
+#define DISPLAY_MAX_PAGES           8       // 64 px tall panels
+
+static_assert(DISPLAY_MAX_PAGES <= 8, "Dirty pages are one bit per page in a uint8_t");
+
+/**
+ * @brief Column span per page that has to be sent to the panel
+ */
+struct DisplayDirtyPages {
+    uint8_t mask;                               ///< Bit n set: page n is dirty
+    uint8_t firstColumn[DISPLAY_MAX_PAGES];
+    uint8_t lastColumn[DISPLAY_MAX_PAGES];      ///< Inclusive
+
+    void clear() { mask = 0; }
+    bool isEmpty() const { return mask == 0; }
+
+    /**
+     * @brief Merge one span into a page
+     */
+    void add(uint8_t page, uint8_t first, uint8_t last) {
+        if (page >= DISPLAY_MAX_PAGES || first > last) {
+            return;
+        }
+        uint8_t bit = 1 << page;
+        if (mask & bit) {
+            firstColumn[page] = first < firstColumn[page] ? first : firstColumn[page];
+            lastColumn[page] = last > lastColumn[page] ? last : lastColumn[page];
+        } else {
+            firstColumn[page] = first;
+            lastColumn[page] = last;
+            mask |= bit;
+        }
+    }
+
+    /**
+     * @brief Merge every span of @p other
+     */
+    void add(const DisplayDirtyPages& other) {
+        for (uint8_t page = 0; page < DISPLAY_MAX_PAGES; page++) {
+            if (other.mask & (1 << page)) {
+                add(page, other.firstColumn[page], other.lastColumn[page]);
+            }
+        }
+    }
+
+    /**
+     * @brief Mark @p pages full-width pages of @p width columns
+     */
+    void addAll(uint8_t pages, uint8_t width) {
+        for (uint8_t page = 0; page < pages && page < DISPLAY_MAX_PAGES; page++) {
+            add(page, 0, width - 1);
+        }
+    }
+
+    /**
+     * @brief Bytes the spans cover (one byte per column per page)
+     */
+    uint32_t getBytes() const {
+        uint32_t bytes = 0;
+        for (uint8_t page = 0; page < DISPLAY_MAX_PAGES; page++) {
+            if (mask & (1 << page)) {
+                bytes += lastColumn[page] - firstColumn[page] + 1;
+            }
+        }
+        return bytes;
+    }
+};
+
+#endif // DISPLAY_DIRTY_PAGES_H
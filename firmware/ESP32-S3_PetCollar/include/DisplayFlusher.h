@@ -0,0 +1,222 @@
+#ifndef DISPLAY_FLUSHER_H
+#define DISPLAY_FLUSHER_H
+
+/**
+ * @file DisplayFlusher.h
+ * @brief Double-buffered SSD1306 page flushes on a background task
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Sending even a few dirty page spans is a blocking I2C transfer, and at
+ * 400 kHz a full 128x32 frame keeps the main loop on the bus for about
+ * 13 ms. DisplayFlusher moves the transfer off the loop:
+ * - The loop keeps drawing into the render buffer (the Adafruit frame
+ *   buffer) and hands over the spans it changed with submit()
+ * - If no flush is in flight, submit() copies just those spans into the
+ *   front buffer, which only the flusher reads, and wakes the flush task
+ * - If one is in flight, the spans are merged and copied on a later
+ *   submit(); the loop never waits for the bus
+ * - The task sets the SSD1306 column/page window for each dirty page and
+ *   streams its bytes; panel on/off requests are handed over the same way
+ *   and sent after the batch's data, so commands never interleave with a
+ *   data stream
+ *
+ * The bus is an I2cBus: WireI2cBus on the collar, FakeSsd1306 in tests,
+ * which decodes the command stream into its own GDDRAM so a test can
+ * compare it with the frame buffer. The task itself lives in the sketch
+ * and reaches the flusher through the wake hook.
+ *
+ * This header and display_flusher.cpp have no Arduino dependencies so the
+ * host test (firmware/tools/display_flush_test.cpp) runs the same code
+ * against the fake panel.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "DisplayDirtyPages.h"
+
+#define SSD1306_CONTROL_COMMANDS    0x00    // Control byte: command stream follows
+#define SSD1306_CONTROL_DATA        0x40    // Control byte: GDDRAM data follows
+#define SSD1306_CMD_COLUMN_ADDRESS  0x21
+#define SSD1306_CMD_PAGE_ADDRESS    0x22
+#define SSD1306_CMD_DISPLAY_OFF     0xAE
+#define SSD1306_CMD_DISPLAY_ON      0xAF
+#define SSD1306_MAX_WIDTH           128
+#define DISPLAY_I2C_CHUNK_BYTES     127     // Data bytes per I2C write (Wire buffer less the control byte)
+
+// ==========================================
+// BUS
+// ==========================================
+
+/**
+ * @brief One I2C master write per call
+ */
+class I2cBus {
+public:
+    virtual ~I2cBus() {}
+
+    /**
+     * @brief Write @p length bytes to @p address (0 bytes: address probe)
+     * @return true if the device acknowledged
+     */
+    virtual bool write(uint8_t address, const uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * @brief Addresses 1-126 that acknowledge an empty write
+ * @param found Receives up to @p capacity addresses (may be null)
+ * @return Devices found (may exceed @p capacity)
+ */
+uint8_t scanI2cAddresses(I2cBus& bus, uint8_t* found, uint8_t capacity);
+
+/**
+ * @brief Fake of an SSD1306 in horizontal addressing mode
+ *
+ * Decodes command streams (column and page windows, display on/off; other
+ * commands are skipped with their argument bytes) and writes data streams
+ * into GDDRAM, wrapping inside the window as the panel does.
+ */
+class FakeSsd1306 : public I2cBus {
+private:
+    uint8_t m_address;
+    uint8_t m_gddram[SSD1306_MAX_WIDTH * DISPLAY_MAX_PAGES];
+    uint8_t m_columnStart, m_columnEnd, m_pageStart, m_pageEnd;
+    uint8_t m_column, m_page;
+    bool m_on;
+    uint32_t m_writes;
+    uint32_t m_dataBytes;
+    uint32_t m_failWrites;      ///< NACK this many writes next
+
+    void command(const uint8_t* bytes, size_t length);
+
+public:
+    explicit FakeSsd1306(uint8_t address);
+
+    bool write(uint8_t address, const uint8_t* data, size_t length) override;
+
+    /**
+     * @brief NACK the next @p count writes to the device
+     */
+    void failNextWrites(uint32_t count) { m_failWrites = count; }
+
+    const uint8_t* getGddram() const { return m_gddram; }
+    bool isOn() const { return m_on; }
+    uint32_t getWrites() const { return m_writes; }
+    uint32_t getDataBytes() const { return m_dataBytes; }
+};
+
+// ==========================================
+// FLUSHER
+// ==========================================
+
+/**
+ * @brief Flush statistics
+ */
+struct DisplayFlushStats {
+    uint32_t flushes;           ///< Batches sent
+    uint32_t bytes;             ///< GDDRAM bytes sent
+    uint32_t deferred;          ///< submit() calls that found a flush in flight
+    uint32_t busErrors;         ///< Writes the panel did not acknowledge
+    uint32_t maxFlushUs;        ///< Longest batch on the bus
+};
+
+/**
+ * @brief Tells the flush task there is work for service()
+ */
+typedef void (*DisplayWakeFn)(void* context);
+
+/**
+ * @brief Microsecond clock used to time flushes
+ */
+typedef uint32_t (*DisplayClockFn)();
+
+/**
+ * @brief Copies dirty spans to a front buffer and sends them from a task
+ *
+ * One loop (submit, setPanelOn, isBusy) and one flush context (service)
+ * may run concurrently. Each batch is handed over through m_busy: the loop
+ * writes m_inFlight and m_inFlightOn, and reads m_isOn, only while it is
+ * clear; the flush context touches them only while it is set.
+ */
+class DisplayFlusher {
+private:
+    I2cBus& m_bus;
+    uint8_t m_address;
+    const uint8_t* m_render;    ///< Drawn by the loop
+    uint8_t* m_front;           ///< Read by the flush context
+    uint8_t m_width;
+    uint8_t m_pages;
+
+    DisplayDirtyPages m_pending;    ///< Drawn, not yet copied (loop only)
+    bool m_wantOn;                  ///< Requested panel state (loop only)
+    DisplayDirtyPages m_inFlight;   ///< Copied, being sent (batch)
+    bool m_inFlightOn;              ///< Panel state to send after the data (batch)
+    bool m_isOn;                    ///< Last state the panel acknowledged (batch)
+    std::atomic<bool> m_busy;       ///< Batch handed to the flush context
+    DisplayFlushStats m_stats;
+
+    DisplayWakeFn m_wake;
+    void* m_wakeContext;
+    DisplayClockFn m_clock;
+
+    bool sendPage(uint8_t page, uint8_t first, uint8_t last);
+    bool sendCommand(const uint8_t* bytes, size_t length);
+    void handOver();
+
+public:
+    /**
+     * @param bus Where the panel is
+     * @param frontBuffer @p width x @p pages bytes, owned by the flusher
+     */
+    DisplayFlusher(I2cBus& bus, uint8_t address, uint8_t* frontBuffer, uint8_t width, uint8_t pages);
+
+    /**
+     * @brief Attach the render buffer; nothing is sent before this
+     * @param renderBuffer Frame buffer the loop draws into (page-major, width bytes per page)
+     */
+    void begin(const uint8_t* renderBuffer) { m_render = renderBuffer; }
+
+    /**
+     * @brief Run service() elsewhere: @p wake is called whenever there is work
+     * @param wake Wake function (nullptr: the caller runs service() itself)
+     */
+    void setWakeHook(DisplayWakeFn wake, void* context = nullptr);
+
+    /**
+     * @brief Time flushes with @p clock (nullptr: maxFlushUs stays 0)
+     */
+    void setClock(DisplayClockFn clock) { m_clock = clock; }
+
+    /**
+     * @brief Hand over spans drawn since the last call (never blocks on the bus)
+     *
+     * Call with empty @p pages too: spans deferred while a flush was in
+     * flight are copied once it has finished.
+     */
+    void submit(const DisplayDirtyPages& pages);
+
+    /**
+     * @brief Request the panel on or off (sent with the next batch, after its data)
+     *
+     * Call before submit() so a change and the spans drawn with it go out
+     * together.
+     */
+    void setPanelOn(bool on);
+
+    /**
+     * @brief Send what was handed over; run by the flush task
+     * @return false if there was nothing to do
+     */
+    bool service();
+
+    /**
+     * @brief True while spans or a power change wait to be sent
+     */
+    bool isBusy() const;
+
+    bool isAsync() const { return m_wake != nullptr; }
+    DisplayFlushStats getStats() const { return m_stats; }
+};
+
+#endif // DISPLAY_FLUSHER_H
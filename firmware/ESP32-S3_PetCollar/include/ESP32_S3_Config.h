@@ -46,6 +46,7 @@
 #define FEATURE_BLE_SCANNER_ENABLED true
 #define FEATURE_WEBSOCKET_ENABLED   true
 #define FEATURE_WEB_INTERFACE       true
+#define FEATURE_ASYNC_WEBSERVER     false  // ESPAsyncWebServer + AsyncTCP (see INSTALL_LIBRARIES.md)
 #define FEATURE_OTA_UPDATES         true
 
 /* User Interface Features */
@@ -53,6 +54,7 @@
 #define FEATURE_STATUS_LEDS         true
 #define FEATURE_BUZZER_ALERTS       true
 #define FEATURE_VIBRATION_ALERTS    true
+#define FEATURE_BUZZER_WAVEFORM     false  // I2S PDM waveform playback (passive buzzer + RC filter, needs PSRAM)
 
 /* Sensor & Monitoring Features */
 #define FEATURE_BATTERY_MONITOR     true
@@ -69,7 +71,13 @@
 /* Development & Debug Features */
 #define FEATURE_SERIAL_DEBUG        true
 #define FEATURE_WEB_DEBUG           false
-#define FEATURE_MEMORY_PROFILING    false
+#ifndef FEATURE_MEMORY_PROFILING
+#define FEATURE_MEMORY_PROFILING    false  // Per-tag heap tracking; needs the esp32-s3-petcollar-heapprof build (malloc --wrap)
+#endif
+#define FEATURE_LOOP_PROFILING      true   // Cycle-counter timing of loop() stages (perf command)
+#ifndef FEATURE_TRACE
+#define FEATURE_TRACE               true   // Binary event trace ring (trace command); false compiles TRACE() out
+#endif
 
 // ==========================================
 // ESP32-S3 OPTIMIZED PIN CONFIGURATION
@@ -154,6 +162,9 @@
 #define DISPLAY_BRIGHTNESS          128   // 0-255 brightness level
 #define DISPLAY_CONTRAST            128   // 0-255 contrast level
 #define DISPLAY_REFRESH_RATE_MS     1000  // Update every second
+#define DISPLAY_SAMPLE_MS           250   // Field polling; unchanged fields cost a compare, no I2C
+#define DISPLAY_TASK_PRIORITY       1     // Flushes share time with the loop, never preempt it
+#define DISPLAY_TASK_STACK          2560
 
 /* Alternative for SH1106 displays (1.3-inch modules) */
 #define DISPLAY_TYPE_SSD1306        true  // Set to false for SH1106
@@ -171,6 +182,11 @@
 #define WIFI_SCAN_TIMEOUT_MS        10000  // 10 seconds scan timeout
 #define WIFI_AP_CHANNEL             1      // Default AP channel
 #define WIFI_USE_MAX_POWER          true   // Use maximum WiFi power
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000  // Cached BSSID/lease connect before scanning
+#define WIFI_FAST_LEASE_REUSES      16     // Connects on a cached lease before DHCP renews it
+#define WIFI_FAST_MAX_FAILURES      2      // Failed fast connects before the cache is dropped
+#define WIFI_ROAM_SCAN_DWELL_MS     120    // Passive scan time per channel while roaming
+#define WIFI_ROAM_SAMPLE_MS         1000   // Link RSSI sampling period for roaming
 
 /* Preferred WiFi Networks (hardcoded for priority) */
 #define PREFERRED_SSID              "JenoviceAP"
@@ -194,6 +210,51 @@
 #define WEB_UPDATE_INTERVAL_MS      500    // WebSocket update interval
 #define WEB_SESSION_TIMEOUT_MS      300000 // 5 minutes session timeout
 
+/* WebSocket Broadcast Fan-out */
+#define WS_FANOUT_MAX_CLIENTS       5      // Matches WEBSOCKETS_SERVER_CLIENT_MAX
+#define WS_CLIENT_QUEUE_DEPTH       8      // Frames waiting per client
+#define WS_SEND_BUDGET_MS           20     // WebSocket send time per loop() pass
+#define WS_SLOW_SEND_MS             50     // A send this slow earns the client a strike
+#define WS_SLOW_CLIENT_STRIKES      5      // Consecutive strikes before disconnecting
+
+/* WebSocket Live Streams (subscribe command) */
+#define WS_STREAM_MAX_BEACONS       8      // Beacons tracked for rssi/distance streams
+#define WS_STREAM_NAME_LENGTH       24     // Beacon and zone name length kept per entry
+#define WS_STREAM_KEYFRAME_MS       30000  // Full-state frame interval per subscriber
+#define WS_STREAM_MAX_INTERVAL_MS   60000  // Largest per-stream interval a client can ask for
+
+/* Command Registry (WebSocket, MQTT and serial) */
+#define COMMAND_ARENA_BYTES         1024   // Parsed JSON of one command (reused, never freed)
+#define COMMAND_LINE_MAX            256    // Longest serial command line
+
+/* HTTP API Response Cache */
+#define HTTP_SNAPSHOT_REFRESH_MS    2000   // Rebuild /api/status at most this often
+#define HTTP_SNAPSHOT_IDLE_MS       60000  // Stop rebuilding when nobody polled for this long
+#define HTTP_ASSET_MAX_AGE_S        86400  // Browser cache lifetime of embedded static assets
+
+/* Telemetry Delta Compression (CBOR format) */
+#define TELEMETRY_KEYFRAME_INTERVAL   10     // Full snapshot every 10th telemetry message
+#define TELEMETRY_KEYFRAME_MAX_MS     600000 // ...and at least every 10 minutes
+#define TELEMETRY_DEADBAND_RSSI_DBM   4      // WiFi RSSI change worth reporting
+#define TELEMETRY_DEADBAND_HEAP_BYTES 4096   // Free heap change worth reporting
+#define TELEMETRY_DEADBAND_POSITION_M 0.25f  // Position/accuracy change in meters
+#define TELEMETRY_DEADBAND_CONFIDENCE 0.05f  // Position confidence change
+
+/* MQTT Store-and-Forward Outbox */
+#define OUTBOX_PARTITION_LABEL      "spiffs"    // Flash partition holding the outbox log
+#define OUTBOX_FLASH_BYTES          (64 * 1024) // Log size in flash
+#define OUTBOX_PSRAM_BYTES          (64 * 1024) // Log size in PSRAM if the partition is missing
+#define OUTBOX_OFFLINE_TELEMETRY_MS 300000      // Telemetry kept while offline: one per 5 minutes
+
+/* Settings Store (proximity configs, filters, telemetry, WiFi) */
+#define SETTINGS_FLASH_OFFSET       OUTBOX_FLASH_BYTES  // In the outbox partition, after the log
+#define SETTINGS_FLASH_BYTES        (16 * 1024) // Wear-leveled record log (4 sectors)
+#define SETTINGS_SAVE_DELAY_MS      2000        // Changes settle this long before one write
+
+/* Loop Timing (perf command, "perf" stream, diagnostics topic) */
+#define PERF_REPORT_INTERVAL_MS     60000  // MQTT diagnostics report and histogram window
+#define PERF_STREAM_MIN_INTERVAL_MS 1000   // Fastest "perf" WebSocket stream rate
+
 /* Network Security */
 #define SECURITY_ENABLE_WPA3        true   // Use WPA3 when available
 #define SECURITY_ENABLE_ENTERPRISE  false  // Enterprise WPA support
@@ -321,6 +382,15 @@
 #define BUZZER_MAX_DURATION_MS      5000   // 5 seconds maximum
 #endif
 
+#if FEATURE_BUZZER_WAVEFORM
+#define WAVEFORM_I2S_PORT           I2S_NUM_0
+#define WAVEFORM_PDM_CLK_PIN        PIN_GPIO_SPARE_1 // PDM clock (unused by a plain piezo)
+#define WAVEFORM_DMA_DESCRIPTORS    4      // DMA buffers in flight
+#define WAVEFORM_DMA_FRAMES         256    // Samples per DMA buffer (16ms at 16kHz)
+#define WAVEFORM_TASK_PRIORITY      1      // Feeder runs below the main loop
+#define WAVEFORM_TASK_STACK         3072
+#endif
+
 #if FEATURE_VIBRATION_ALERTS
 #define VIBRATION_PWM_CHANNEL       1
 #define VIBRATION_PWM_FREQUENCY_HZ  150    // 150Hz vibration
@@ -337,6 +407,17 @@
 #define ALERT_TYPE_BEACON_FOUND     3      // Target beacon found
 #define ALERT_TYPE_SYSTEM_ERROR     4      // System error
 
+/* Alert Arbitration */
+#define ALERT_ARBITER_QUEUE_SIZE    6      // Pending alerts held behind the active one
+#define ALERT_ARBITER_QUEUE_TTL_MS  10000  // Drop queued alerts older than 10 seconds
+#define ALERT_ARBITER_MIN_RESUME_MS 250    // Preempted alerts shorter than this are not resumed
+#define ALERT_COOLDOWN_PROXIMITY_MS 5000   // Merge proximity alerts within 5 seconds
+#define ALERT_COOLDOWN_ZONE_MS      10000  // Merge zone breach alerts within 10 seconds
+#define ALERT_COOLDOWN_BATTERY_MS   600000 // Repeat battery alerts every 10 minutes
+#define ALERT_COOLDOWN_REMOTE_MS    1000   // Merge repeated remote commands within 1 second
+#define ALERT_LOW_BATTERY_PERCENT   15     // Low battery alert threshold
+#define ALERT_CRITICAL_BATTERY_PERCENT 5   // Critical battery alert threshold
+
 // ==========================================
 // TIMING CONFIGURATION
 // ==========================================
@@ -390,15 +471,30 @@
 // ==========================================
 // DEBUGGING & LOGGING
 // ==========================================
-#if FEATURE_SERIAL_DEBUG
-#define DEBUG_SERIAL_BAUD           115200
-#define DEBUG_BUFFER_SIZE           256
+#define DEBUG_LOG_LEVEL_NONE        -1
 #define DEBUG_LOG_LEVEL_ERROR       0
 #define DEBUG_LOG_LEVEL_WARNING     1
 #define DEBUG_LOG_LEVEL_INFO        2
 #define DEBUG_LOG_LEVEL_DEBUG       3
 #define DEBUG_LOG_LEVEL_VERBOSE     4
 
+/* Deferred logging (LOGE/LOGW/LOGI/LOGD/LOGV, DeferredLog.h) */
+#ifndef COLLAR_LOG_LEVEL
+#if FEATURE_SERIAL_DEBUG
+#define COLLAR_LOG_LEVEL            DEBUG_LOG_LEVEL_INFO   // Log calls above this level compile away
+#else
+#define COLLAR_LOG_LEVEL            DEBUG_LOG_LEVEL_NONE
+#endif
+#endif
+#define LOG_BUFFER_SIZE             4096   // Queued log text, power of two
+#define LOG_LINE_MAX                160    // Longer lines are truncated
+#define LOG_TASK_PRIORITY           0      // Writes to serial only when nothing else is ready
+#define LOG_TASK_STACK              3072
+
+#if FEATURE_SERIAL_DEBUG
+#define DEBUG_SERIAL_BAUD           115200
+#define DEBUG_BUFFER_SIZE           256
+
 /* Debug Macros */
 #define DEBUG_PRINT(x)              Serial.print(x)
 #define DEBUG_PRINTLN(x)            Serial.println(x)
@@ -0,0 +1,207 @@
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+/**
+ * @file HeapProfiler.h
+ * @brief Heap fragmentation and per-call-site allocation tracking
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Long-uptime collars lose heap slowly until an allocation fails. Two
+ * views show where it goes:
+ * - Fragmentation (always available): 100 - largest free block / free
+ *   bytes, from the 8-bit capable heap. Free heap can look healthy while
+ *   the largest block shrinks below what a TLS record or JSON document
+ *   needs.
+ * - Allocation tracking (FEATURE_MEMORY_PROFILING, the
+ *   esp32-s3-petcollar-heapprof build): malloc, calloc, realloc and free
+ *   are wrapped at link time (-Wl,--wrap). Each block is recorded in a
+ *   fixed open-addressing table with its size and the HeapTag of the task
+ *   that allocated it, set by HEAP_TAG() scopes around BLE ingest, JSON,
+ *   MQTT, WebSocket and display code. Live bytes per tag show a leak;
+ *   allocations per window show churn that fragments.
+ *
+ * Blocks allocated before begin() (called from setup()), or while the
+ * table is 3/4 full, are not tracked; their frees are counted as
+ * untracked. The tag is thread-local, so allocations by WiFi, lwIP and
+ * other system tasks land in "other" unless they happen inside a tagged
+ * scope of their own task.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "ESP32_S3_Config.h"
+
+#define HEAP_PROFILE_TABLE_SIZE     4096    // Tracked blocks, power of two (32 KB, profiling builds only)
+#define HEAP_PROFILE_MAX_SIZE       0xFFFFFF
+#define HEAP_REPORT_INTERVAL_MS     300000  // MQTT heap summary and allocation-rate window
+
+/**
+ * @brief Call sites allocations are attributed to
+ */
+enum class HeapTag : uint8_t {
+    OTHER = 0,              ///< Untagged code and system tasks
+    BLE,                    ///< BLE advertisement ingest
+    JSON,                   ///< JSON documents (status, HTTP snapshots, commands)
+    MQTT,
+    WEBSOCKET,
+    DISPLAY,
+    COUNT
+};
+
+/**
+ * @brief One tracked block
+ */
+struct HeapBlock {
+    uintptr_t address;      ///< 0 = empty slot
+    uint32_t sizeAndTag;    ///< Size in the low 24 bits, HeapTag in the top 8
+};
+
+/**
+ * @brief Allocation counters of one tag
+ */
+struct HeapTagStats {
+    uint32_t liveBytes;     ///< Requested bytes of tracked blocks not yet freed
+    uint32_t liveBlocks;
+    uint32_t peakBytes;     ///< Highest liveBytes
+    uint32_t allocs;        ///< Allocations in the current window
+    uint32_t allocBytes;    ///< Bytes allocated in the current window
+};
+
+/**
+ * @brief 8-bit heap state
+ */
+struct HeapSummary {
+    uint32_t freeBytes;
+    uint32_t minFreeBytes;      ///< Low-water mark since boot
+    uint32_t largestFreeBlock;
+    uint8_t fragmentation;      ///< Percent: 100 - largest block / free bytes
+};
+
+/**
+ * @brief Live block table and per-tag counters
+ */
+class HeapProfiler {
+private:
+    HeapBlock* m_blocks;
+    uint32_t m_mask;            ///< Table size - 1
+    uint32_t m_used;
+    volatile bool m_ready;      ///< Set by begin(); allocations before it are ignored
+    HeapTagStats m_tags[(uint8_t)HeapTag::COUNT];
+    uint32_t m_untrackedAllocs; ///< Table too full
+    uint32_t m_untrackedFrees;  ///< Blocks allocated before tracking (or while full)
+    uint32_t m_windowStartMs;
+    portMUX_TYPE m_mux;
+
+    uint32_t slotOf(uintptr_t address) const;
+
+    /**
+     * @brief Slot holding @p address, or 0xFFFFFFFF (caller holds m_mux)
+     */
+    uint32_t findLocked(uintptr_t address) const;
+
+    /**
+     * @brief Remove the block in @p slot, keeping probe chains intact (caller holds m_mux)
+     */
+    void removeSlotLocked(uint32_t slot);
+
+public:
+    /**
+     * @param blocks Table storage, @p capacity entries (a power of two)
+     */
+    HeapProfiler(HeapBlock* blocks, uint32_t capacity);
+
+    /**
+     * @brief Clear the table and start tracking
+     */
+    void begin(uint32_t nowMs);
+
+    bool isReady() const { return m_ready; }
+
+    /**
+     * @brief Record a new block (safe from any task)
+     */
+    void recordAlloc(void* address, size_t size, HeapTag tag);
+
+    /**
+     * @brief Forget a block about to be freed
+     * @return false if it was not tracked
+     */
+    bool recordFree(void* address);
+
+    /**
+     * @brief Tag of a tracked block (for realloc)
+     * @return false if it is not tracked
+     */
+    bool lookup(void* address, size_t& size, HeapTag& tag);
+
+    /**
+     * @brief Copy one tag's counters
+     */
+    HeapTagStats getTagStats(HeapTag tag);
+
+    uint32_t getTrackedBlocks() const { return m_used; }
+    uint32_t getUntrackedAllocs() const { return m_untrackedAllocs; }
+    uint32_t getUntrackedFrees() const { return m_untrackedFrees; }
+    uint32_t getWindowStartMs() const { return m_windowStartMs; }
+
+    /**
+     * @brief Start a new allocation-rate window (live counts are kept)
+     */
+    void resetWindow(uint32_t nowMs);
+
+    /**
+     * @brief Append [tag, live bytes, live blocks, peak bytes, allocs, alloc bytes] per active tag
+     */
+    void writeJson(JsonArray tags);
+};
+
+/**
+ * @brief Tags allocations of the current task for the enclosing scope
+ */
+class HeapTagScope {
+private:
+    HeapTag m_previous;
+
+public:
+    explicit HeapTagScope(HeapTag tag);
+    ~HeapTagScope();
+
+    HeapTagScope(const HeapTagScope&) = delete;
+    HeapTagScope& operator=(const HeapTagScope&) = delete;
+};
+
+/**
+ * @brief Tag the current task's allocations are attributed to
+ */
+HeapTag currentHeapTag();
+
+#if FEATURE_MEMORY_PROFILING
+#define HEAP_TAG(tag) HeapTagScope heapTag_##tag(HeapTag::tag)
+extern HeapProfiler heapProfiler;
+#else
+#define HEAP_TAG(tag) do {} while (0)
+#endif
+
+/**
+ * @brief Current heap state, with a real fragmentation figure
+ */
+HeapSummary readHeapSummary();
+
+/**
+ * @brief Fragmentation percent from free bytes and the largest free block
+ */
+uint8_t heapFragmentationPercent(uint32_t freeBytes, uint32_t largestFreeBlock);
+
+/**
+ * @brief Tag name used in reports
+ */
+const char* heapTagToString(HeapTag tag);
+
+/**
+ * @brief Run heap profiler self-tests
+ * @return true if all tests passed
+ */
+bool runHeapProfilerTests();
+
+#endif // HEAP_PROFILER_H
@@ -0,0 +1,126 @@
+#ifndef HTTP_SNAPSHOT_CACHE_H
+#define HTTP_SNAPSHOT_CACHE_H
+
+/**
+ * @file HttpSnapshotCache.h
+ * @brief Prebuilt JSON responses with ETags for the HTTP API
+ * @version 1.0.0
+ * @date 2024
+ *
+ * /api/status and /api/discover used to rebuild their JSON for every
+ * request. The main loop now builds each body into a reference-counted
+ * snapshot at most once per HTTP_SNAPSHOT_REFRESH_MS while clients poll
+ * it, and once per HTTP_SNAPSHOT_IDLE_MS otherwise, so the first poll
+ * after a quiet spell is never far behind. Request handlers (on the loop
+ * with WebServer, on the AsyncTCP task with FEATURE_ASYNC_WEBSERVER) only
+ * take a reference, so a snapshot being sent stays valid while the loop
+ * swaps in a newer one.
+ *
+ * The ETag is a hash of the body: a rebuild that produces the same bytes
+ * keeps the old snapshot and ETag, and a poll with a matching
+ * If-None-Match gets 304 Not Modified without a body. Snapshot bodies
+ * therefore hold state fields only; clocks, heap and RSSI are served
+ * uncached from /api/metrics.
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+
+/**
+ * @brief Cached responses
+ */
+enum class HttpSnapshotId : uint8_t {
+    STATUS = 0,             ///< /api/status
+    DISCOVER,               ///< /api/discover
+    COUNT
+};
+
+/**
+ * @brief One immutable response body
+ */
+struct HttpSnapshot {
+    uint8_t refs;           ///< Cache reference plus one per request being served
+    char etag[12];          ///< Quoted hash, e.g. "\"1a2b3c4d\""
+    uint32_t hash;
+    uint32_t builtMs;
+    size_t length;
+    char data[1];           ///< length bytes plus NUL
+};
+
+/**
+ * @brief Cache statistics
+ */
+struct HttpSnapshotStats {
+    uint32_t rebuilds;      ///< Bodies built by the loop
+    uint32_t unchanged;     ///< Rebuilds identical to the cached body (ETag kept)
+    uint32_t served;        ///< Full responses (200)
+    uint32_t notModified;   ///< 304 responses
+    uint32_t misses;        ///< Requests before the first snapshot existed
+    uint32_t liveSnapshots; ///< Snapshots not yet freed
+};
+
+/**
+ * @brief Reference-counted response snapshots, built by the loop and read anywhere
+ */
+class HttpSnapshotCache {
+private:
+    HttpSnapshot* m_slots[(uint8_t)HttpSnapshotId::COUNT];
+    uint32_t m_lastRequestMs[(uint8_t)HttpSnapshotId::COUNT];
+    portMUX_TYPE m_mux;
+    HttpSnapshotStats m_stats;
+
+    void releaseLocked(HttpSnapshot* snapshot, HttpSnapshot** toFree);
+
+public:
+    HttpSnapshotCache();
+    ~HttpSnapshotCache();
+
+    /**
+     * @brief true if the snapshot of @p id should be rebuilt
+     *
+     * Due after HTTP_SNAPSHOT_REFRESH_MS if polled within the last
+     * HTTP_SNAPSHOT_IDLE_MS, else after HTTP_SNAPSHOT_IDLE_MS; an empty
+     * slot is always due.
+     */
+    bool needsRefresh(HttpSnapshotId id, uint32_t nowMs) const;
+
+    /**
+     * @brief Record a poll of @p id without taking a reference
+     */
+    void markRequested(HttpSnapshotId id, uint32_t nowMs);
+
+    /**
+     * @brief Replace the body of @p id (main loop)
+     * @return true if the body changed (new ETag)
+     */
+    bool update(HttpSnapshotId id, const char* body, size_t length, uint32_t nowMs);
+
+    /**
+     * @brief Take a reference to the current snapshot (any task)
+     * @return Snapshot to pass to release(), or nullptr if none was built yet
+     */
+    HttpSnapshot* acquire(HttpSnapshotId id, uint32_t nowMs);
+
+    /**
+     * @brief Drop a reference taken by acquire()
+     */
+    void release(HttpSnapshot* snapshot);
+
+    /**
+     * @brief Check an If-None-Match header against an ETag
+     * @param etag Quoted ETag of the response
+     * @param ifNoneMatch Header value (may list several ETags, or be "*")
+     */
+    static bool etagMatches(const char* etag, const char* ifNoneMatch);
+
+    void countServed(bool notModified);
+    const HttpSnapshotStats& getStats() const { return m_stats; }
+};
+
+/**
+ * @brief Run snapshot cache self-tests
+ * @return true if all tests passed
+ */
+bool runHttpSnapshotTests();
+
+#endif // HTTP_SNAPSHOT_CACHE_H
@@ -0,0 +1,198 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+/**
+ * @file LoopProfiler.h
+ * @brief Cycle-counter timing of loop() stages and the BLE callback
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Alert latency is bounded by how long one loop() pass takes, and a single
+ * slow stage (a blocking BLE scan start, a WebSocket send, a flash write)
+ * hides inside the loop average. Each stage is wrapped in a PerfScope that
+ * reads the CPU cycle counter on entry and exit and adds the difference to
+ * that stage's histogram:
+ * - Buckets are log-scale, 2^PERF_HISTOGRAM_SUB_BITS per power of two, so
+ *   a percentile (reported as its bucket's upper bound) overstates the true
+ *   value by at most 25%, from PERF_HISTOGRAM_MIN_CYCLES up to the 32-bit
+ *   cycle range (about 17 s at 240 MHz)
+ * - Recording is a count-leading-zeros, a shift and an increment: no
+ *   floats, no locks, no allocation
+ * - A histogram has one writer (the loop task, or the BLE task for the
+ *   callback stage); readers may see a sample half recorded, which only
+ *   skews a report by one count
+ *
+ * Reports (p50, p99, max per stage) cover the window since the last reset;
+ * the MQTT diagnostics report resets it every PERF_REPORT_INTERVAL_MS.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "ESP32_S3_Config.h"
+
+/**
+ * @brief Timed stages
+ */
+enum class PerfStage : uint8_t {
+    LOOP = 0,               ///< Whole loop() pass (SystemStateManager beginLoop/endLoop)
+    SERIAL_COMMANDS,
+    WEB,                    ///< HTTP, WebSocket and stream frames
+    MQTT,
+    WIFI_ROAMING,
+    PROXIMITY,              ///< Proximity trigger evaluation
+    SETTINGS,
+    BLE_SCAN,               ///< Starting (and waiting for) a BLE scan
+    DISPLAY,
+    ALERTS,
+    MAINTENANCE,
+    STATUS,                 ///< Status prints and broadcasts
+    BLE_CALLBACK,           ///< One advertisement in the BLE task
+    COUNT
+};
+
+#define PERF_HISTOGRAM_SUB_BITS     2       // 4 buckets per power of two
+#define PERF_HISTOGRAM_MIN_SHIFT    6       // Values below 2^6 cycles share bucket 0
+#define PERF_HISTOGRAM_MIN_CYCLES   (1UL << PERF_HISTOGRAM_MIN_SHIFT)
+#define PERF_HISTOGRAM_BUCKETS      (1 + ((32 - PERF_HISTOGRAM_MIN_SHIFT) << PERF_HISTOGRAM_SUB_BITS))
+
+/**
+ * @brief Current CPU cycle count (per core; wraps every 2^32 cycles)
+ */
+static inline uint32_t perfCycles() {
+    return ESP.getCycleCount();
+}
+
+/**
+ * @brief Latency histogram of one stage, in CPU cycles
+ */
+class PerfHistogram {
+private:
+    uint32_t m_buckets[PERF_HISTOGRAM_BUCKETS];
+    uint32_t m_count;
+    uint32_t m_max;
+
+public:
+    PerfHistogram() { reset(); }
+
+    void reset();
+
+    void record(uint32_t cycles) {
+        m_buckets[bucketOf(cycles)]++;
+        m_count++;
+        if (cycles > m_max) {
+            m_max = cycles;
+        }
+    }
+
+    uint32_t getCount() const { return m_count; }
+    uint32_t getMax() const { return m_max; }
+
+    /**
+     * @brief Upper bound of the bucket holding the @p permille-th sample (capped at max)
+     */
+    uint32_t percentile(uint16_t permille) const;
+
+    static uint16_t bucketOf(uint32_t cycles) {
+        if (cycles < PERF_HISTOGRAM_MIN_CYCLES) {
+            return 0;
+        }
+        uint8_t msb = 31 - __builtin_clz(cycles);
+        uint8_t sub = (cycles >> (msb - PERF_HISTOGRAM_SUB_BITS)) & ((1 << PERF_HISTOGRAM_SUB_BITS) - 1);
+        return 1 + ((msb - PERF_HISTOGRAM_MIN_SHIFT) << PERF_HISTOGRAM_SUB_BITS) + sub;
+    }
+
+    /**
+     * @brief Largest value that falls in @p bucket
+     */
+    static uint32_t bucketLimit(uint16_t bucket);
+};
+
+/**
+ * @brief Summary of one stage in microseconds
+ */
+struct PerfSummary {
+    uint32_t count;
+    float p50Us;
+    float p99Us;
+    float maxUs;
+};
+
+/**
+ * @brief Histograms for every stage
+ */
+class LoopProfiler {
+private:
+    PerfHistogram m_stages[(uint8_t)PerfStage::COUNT];
+    uint32_t m_cyclesPerUs;
+    uint32_t m_windowStartMs;
+
+public:
+    LoopProfiler();
+
+    /**
+     * @brief Set the cycle counter rate (CPU clock in MHz)
+     */
+    void begin(uint32_t cpuMHz, uint32_t nowMs);
+
+    void record(PerfStage stage, uint32_t cycles) {
+        m_stages[(uint8_t)stage].record(cycles);
+    }
+
+    const PerfHistogram& getHistogram(PerfStage stage) const { return m_stages[(uint8_t)stage]; }
+
+    PerfSummary summarize(PerfStage stage) const;
+
+    float cyclesToUs(uint32_t cycles) const { return (float)cycles / m_cyclesPerUs; }
+
+    /**
+     * @brief Start a new report window
+     */
+    void reset(uint32_t nowMs);
+
+    uint32_t getWindowStartMs() const { return m_windowStartMs; }
+
+    /**
+     * @brief Append [stage, count, p50 us, p99 us, max us] for each stage with samples
+     */
+    void writeJson(JsonArray stages) const;
+};
+
+/**
+ * @brief Times the enclosing scope into one stage
+ */
+class PerfScope {
+private:
+    LoopProfiler& m_profiler;
+    PerfStage m_stage;
+    uint32_t m_start;
+
+public:
+    PerfScope(LoopProfiler& profiler, PerfStage stage) :
+        m_profiler(profiler), m_stage(stage), m_start(perfCycles()) {}
+
+    ~PerfScope() { m_profiler.record(m_stage, perfCycles() - m_start); }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+};
+
+#if FEATURE_LOOP_PROFILING
+#define PERF_SCOPE(stage) PerfScope perfScope_##stage(loopProfiler, PerfStage::stage)
+#else
+#define PERF_SCOPE(stage) do {} while (0)
+#endif
+
+extern LoopProfiler loopProfiler;
+
+/**
+ * @brief Stage name used in reports
+ */
+const char* perfStageToString(PerfStage stage);
+
+/**
+ * @brief Run loop profiler self-tests
+ * @return true if all tests passed
+ */
+bool runLoopProfilerTests();
+
+#endif // LOOP_PROFILER_H
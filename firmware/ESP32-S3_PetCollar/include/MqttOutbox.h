@@ -0,0 +1,249 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+/**
+ * @file MqttOutbox.h
+ * @brief Store-and-forward outbox for MQTT messages raised while offline
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Messages that cannot be published (no WiFi, broker down, publish failed)
+ * are appended to a sector-based ring log and replayed after reconnect:
+ * - Every record gets a sequence number that survives reboots
+ * - The log lives in flash (or PSRAM) behind OutboxStorage, written with
+ *   NOR semantics: erase a sector to 0xFF, then only clear bits
+ * - Replay goes out in batches bounded by record count and bytes, paced
+ *   by a token bucket so a long backlog does not swamp the link
+ * - A record is retired once the broker connection accepts its publish.
+ *   PubSubClient publishes at QoS 0, so that is the only completion there
+ *   is. A refused publish is retried after OUTBOX_RETRY_MS and given up on
+ *   after OUTBOX_MAX_ATTEMPTS refusals on one connection
+ * - A reset between a publish and its retirement replays the record, so
+ *   subscribers drop duplicates by sequence number
+ * - When the log is full the oldest sector is evicted; telemetry is refused
+ *   once the log passes OUTBOX_TELEMETRY_MAX_FILL_PCT so it cannot push
+ *   out alerts
+ *
+ * This header and mqtt_outbox.cpp have no Arduino dependencies so the host
+ * test (firmware/tools/outbox_broker_test.cpp) runs the same code against
+ * a mock broker.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==========================================
+// OUTBOX PARAMETERS
+// ==========================================
+
+#define OUTBOX_MAX_TOPIC_LENGTH     23     // Topic suffix stored per record ("alert", "event", ...)
+#define OUTBOX_MAX_PAYLOAD          1024   // Largest payload a record can hold
+#define OUTBOX_BATCH_MAX_RECORDS    8      // Records published per drain() call
+#define OUTBOX_BATCH_MAX_BYTES      2048   // Payload bytes published per drain() call
+#define OUTBOX_DRAIN_RATE_PER_SEC   4      // Sustained replay rate (burst = one batch)
+#define OUTBOX_RETRY_MS             1000   // Wait after a refused publish before retrying
+#define OUTBOX_MAX_ATTEMPTS         5      // Give up on a record after this many refused publishes
+#define OUTBOX_TELEMETRY_MAX_FILL_PCT 50   // Refuse telemetry above this fill level
+
+/**
+ * @brief What a record carries (alerts are never refused for space)
+ */
+enum class OutboxKind : uint8_t {
+    ALERT = 1,              ///< Proximity/zone alerts
+    TRANSITION = 2,         ///< State transitions (battery level band, ...)
+    TELEMETRY = 3           ///< Periodic telemetry snapshots
+};
+
+// ==========================================
+// STORAGE BACKENDS
+// ==========================================
+
+/**
+ * @brief Erasable storage region holding the outbox log
+ *
+ * Implementations must behave like NOR flash: eraseSector() sets a sector
+ * to 0xFF and write() can only clear bits.
+ */
+class OutboxStorage {
+public:
+    virtual ~OutboxStorage() {}
+    virtual size_t size() const = 0;
+    virtual size_t sectorSize() const = 0;
+    virtual bool read(uint32_t offset, void* data, size_t length) = 0;
+    virtual bool write(uint32_t offset, const void* data, size_t length) = 0;
+    virtual bool eraseSector(uint32_t offset) = 0;
+};
+
+/**
+ * @brief Outbox storage in RAM (PSRAM on the collar, plain memory on the host)
+ */
+class RamOutboxStorage : public OutboxStorage {
+private:
+    uint8_t* m_buffer;
+    size_t m_size;
+    size_t m_sectorSize;
+
+public:
+    /**
+     * @param buffer Backing memory (contents are scanned as-is by MqttOutbox::begin)
+     * @param size Buffer size, a multiple of sectorSize
+     * @param sectorSize Erase unit
+     */
+    RamOutboxStorage(uint8_t* buffer, size_t size, size_t sectorSize);
+
+    size_t size() const override { return m_size; }
+    size_t sectorSize() const override { return m_sectorSize; }
+    bool read(uint32_t offset, void* data, size_t length) override;
+    bool write(uint32_t offset, const void* data, size_t length) override;
+    bool eraseSector(uint32_t offset) override;
+};
+
+// ==========================================
+// OUTBOX
+// ==========================================
+
+/**
+ * @brief Publish one outbox record
+ * @param topic Topic suffix stored with the record
+ * @param sequence Record sequence number
+ * @return true if handed to the broker connection
+ */
+typedef bool (*OutboxPublishFn)(const char* topic, uint32_t sequence,
+                                const uint8_t* payload, size_t length, void* context);
+
+/**
+ * @brief Position of a record in the log
+ */
+struct OutboxCursor {
+    uint16_t sector;
+    uint16_t offset;
+
+    bool operator==(const OutboxCursor& other) const {
+        return sector == other.sector && offset == other.offset;
+    }
+    bool operator!=(const OutboxCursor& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Outbox statistics
+ */
+struct OutboxStats {
+    uint32_t appended;      ///< Records written
+    uint32_t published;     ///< Records the broker connection accepted (retired)
+    uint32_t failed;        ///< Publishes the connection refused
+    uint32_t evicted;       ///< Unpublished records overwritten when full
+    uint32_t expired;       ///< Records given up on after OUTBOX_MAX_ATTEMPTS
+    uint32_t refused;       ///< Appends refused (too large, telemetry over fill limit)
+    uint32_t corrupt;       ///< Records skipped on CRC mismatch
+    uint32_t recovered;     ///< Unpublished records found at begin()
+};
+
+struct OutboxRecordHeader;
+
+/**
+ * @brief Sequence-numbered ring log with batched, paced replay
+ */
+class MqttOutbox {
+private:
+    OutboxStorage* m_storage;
+    uint16_t m_sectorCount;
+    uint16_t m_sectorSize;
+
+    OutboxCursor m_write;       ///< Next append position
+    OutboxCursor m_tail;        ///< Oldest unpublished record, the next to publish
+    uint32_t m_nextSequence;
+    uint32_t m_nextSectorSequence;
+    uint32_t m_pendingCount;
+
+    // Publishes of the tail record the connection refused
+    uint8_t m_attempts;
+    uint32_t m_failedMs;
+
+    // Token bucket, in thousandths of a record
+    uint32_t m_tokens;
+    uint32_t m_lastRefillMs;
+    bool m_refillStarted;
+    uint16_t m_ratePerSec;
+
+    OutboxPublishFn m_publish;
+    void* m_publishContext;
+    OutboxStats m_stats;
+
+    uint8_t m_record[12 + OUTBOX_MAX_TOPIC_LENGTH + OUTBOX_MAX_PAYLOAD];
+
+    uint32_t sectorBase(uint16_t sector) const { return (uint32_t)sector * m_sectorSize; }
+    uint16_t nextSector(uint16_t sector) const { return (sector + 1) % m_sectorCount; }
+    bool sectorValid(uint16_t sector, uint32_t* sectorSequence = nullptr);
+    bool readHeader(const OutboxCursor& cursor, OutboxRecordHeader& header);
+    void normalize(OutboxCursor& cursor);
+    void step(OutboxCursor& cursor);
+    bool markAcked(const OutboxCursor& cursor);
+    bool isErasedFrom(const OutboxCursor& cursor);
+    void openNextSector();
+    void advanceTail();
+    void retire(uint32_t sequence, uint32_t& counter);
+    void refillTokens(uint32_t nowMs);
+
+public:
+    MqttOutbox();
+
+    /**
+     * @brief Attach storage and recover pending records left by a previous run
+     * @return true if the storage geometry is usable
+     */
+    bool begin(OutboxStorage* storage);
+
+    bool isReady() const { return m_storage != nullptr; }
+
+    /**
+     * @brief Set the function that publishes replayed records
+     */
+    void setPublisher(OutboxPublishFn publish, void* context) {
+        m_publish = publish;
+        m_publishContext = context;
+    }
+
+    void setRateLimit(uint16_t recordsPerSec) { m_ratePerSec = recordsPerSec > 0 ? recordsPerSec : 1; }
+
+    /**
+     * @brief Append a record
+     * @param kind Record kind (telemetry may be refused when the log is filling up)
+     * @param topic Topic suffix (truncated to OUTBOX_MAX_TOPIC_LENGTH)
+     * @return Sequence number, or 0 if the record was refused
+     */
+    uint32_t append(OutboxKind kind, const char* topic, const uint8_t* payload, size_t length);
+
+    /**
+     * @brief Publish the next batch, oldest first, retiring each accepted record
+     * @param nowMs Current time in milliseconds
+     * @return Number of records published by this call
+     *
+     * Call from the MQTT loop while connected. Stops at the first refused
+     * publish; that record is retried after OUTBOX_RETRY_MS and expired
+     * after OUTBOX_MAX_ATTEMPTS refusals.
+     */
+    uint8_t drain(uint32_t nowMs);
+
+    /**
+     * @brief Connection dropped: refusals so far were not the record's fault
+     */
+    void onDisconnect() { m_attempts = 0; }
+
+    bool isEmpty() const { return m_pendingCount == 0; }
+    uint32_t getPendingCount() const { return m_pendingCount; }
+    uint32_t getNextSequence() const { return m_nextSequence; }
+
+    /**
+     * @brief Percentage of sectors holding unpublished records
+     */
+    uint8_t getFillPercent() const;
+
+    const OutboxStats& getStats() const { return m_stats; }
+};
+
+/**
+ * @brief Convert a record kind to a string
+ */
+const char* outboxKindToString(OutboxKind kind);
+
+#endif // MQTT_OUTBOX_H
@@ -0,0 +1,94 @@
+#ifndef MQTT_STREAM_WRITER_H
+#define MQTT_STREAM_WRITER_H
+
+/**
+ * @file MqttStreamWriter.h
+ * @brief Streams MQTT publish payloads straight into the network client
+ * @version 1.0.0
+ * @date 2024
+ *
+ * PubSubClient::beginPublish() sends the packet header and leaves the
+ * payload to be written directly to the socket, so payloads are neither
+ * copied into a String nor limited by the PubSubClient packet buffer.
+ * Writing byte by byte would turn every character into its own TLS
+ * record, so writes are gathered into a small fixed chunk first.
+ */
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+#define MQTT_STREAM_CHUNK_SIZE  128    // Bytes gathered per socket write
+
+/**
+ * @brief Print adapter that chunks writes into an open MQTT publish
+ *
+ * Usage:
+ *   mqttClient.beginPublish(topic, measureJson(doc), false);
+ *   MqttStreamWriter writer(mqttClient);
+ *   serializeJson(doc, writer);
+ *   writer.flush();
+ *   mqttClient.endPublish();
+ */
+class MqttStreamWriter : public Print {
+private:
+    PubSubClient& m_client;
+    uint8_t m_chunk[MQTT_STREAM_CHUNK_SIZE];
+    size_t m_used;
+    size_t m_written;
+    bool m_failed;
+
+public:
+    explicit MqttStreamWriter(PubSubClient& client) :
+        m_client(client), m_used(0), m_written(0), m_failed(false) {}
+
+    size_t write(uint8_t data) override {
+        if (m_used == sizeof(m_chunk)) {
+            flush();
+        }
+        m_chunk[m_used++] = data;
+        return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t length) override {
+        if (length >= sizeof(m_chunk)) {
+            // Large blocks (CBOR payloads, long strings) bypass the chunk
+            flush();
+            send(data, length);
+            return length;
+        }
+        if (m_used + length > sizeof(m_chunk)) {
+            flush();
+        }
+        memcpy(m_chunk + m_used, data, length);
+        m_used += length;
+        return length;
+    }
+
+    void flush() override {
+        if (m_used > 0) {
+            send(m_chunk, m_used);
+            m_used = 0;
+        }
+    }
+
+    /**
+     * @brief Payload bytes handed to the client so far (after flush())
+     */
+    size_t getWritten() const { return m_written; }
+
+    /**
+     * @brief true if the client accepted fewer bytes than written
+     */
+    bool hasFailed() const { return m_failed; }
+
+private:
+    void send(const uint8_t* data, size_t length) {
+        size_t sent = m_client.write(data, length);
+        m_written += sent;
+        if (sent != length) {
+            m_failed = true;
+        }
+    }
+};
+
+#endif // MQTT_STREAM_WRITER_H
@@ -0,0 +1,50 @@
+#ifndef OUTBOX_FLASH_STORAGE_H
+#define OUTBOX_FLASH_STORAGE_H
+
+/**
+ * @file OutboxFlashStorage.h
+ * @brief MQTT outbox storage on a raw flash data partition
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Uses the first OUTBOX_FLASH_BYTES of the partition labelled
+ * OUTBOX_PARTITION_LABEL (the default table's "spiffs" partition, which
+ * this firmware does not mount). Requires flash encryption to be off for
+ * the single-byte acknowledgement writes. The settings store uses a second
+ * instance on the SETTINGS_FLASH_BYTES that follow.
+ */
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "ESP32_S3_Config.h"
+#include "MqttOutbox.h"
+
+/**
+ * @brief OutboxStorage backed by esp_partition reads/writes/erases
+ */
+class PartitionOutboxStorage : public OutboxStorage {
+private:
+    const esp_partition_t* m_partition;
+    size_t m_offset;
+    size_t m_size;
+
+public:
+    PartitionOutboxStorage() : m_partition(nullptr), m_offset(0), m_size(0) {}
+
+    /**
+     * @brief Find the partition
+     * @param label Partition label
+     * @param maxBytes Bytes of the partition to use
+     * @param offset Where in the partition they start (sector aligned)
+     * @return true if the partition exists and holds at least two sectors there
+     */
+    bool begin(const char* label, size_t maxBytes, size_t offset = 0);
+
+    size_t size() const override { return m_size; }
+    size_t sectorSize() const override { return SPI_FLASH_SEC_SIZE; }
+    bool read(uint32_t offset, void* data, size_t length) override;
+    bool write(uint32_t offset, const void* data, size_t length) override;
+    bool eraseSector(uint32_t offset) override;
+};
+
+#endif // OUTBOX_FLASH_STORAGE_H
@@ -0,0 +1,100 @@
+#ifndef PATTERN_SEQUENCER_H
+#define PATTERN_SEQUENCER_H
+
+/**
+ * @file PatternSequencer.h
+ * @brief Step state machine for compiled alert patterns
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Walks a flat table of PatternStep entries against absolute deadlines:
+ * - Each step deadline is derived from the previous one, never from the
+ *   time advance() happened to be called, so late calls do not drift
+ * - A late call consumes every step whose deadline has passed
+ * - Lateness of step changes is tracked for the alert-engine command
+ *
+ * AlertPatternEngine runs this from its esp_timer callback and owns the
+ * locking. This header and pattern_sequencer.cpp have no Arduino
+ * dependencies so the host test (firmware/tools/alert_engine_test.cpp)
+ * runs the same code against a fake clock.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==========================================
+// ENGINE LIMITS
+// ==========================================
+
+#define ALERT_ENGINE_MAX_STEPS      32     // Maximum steps in one compiled table
+#define ALERT_ENGINE_REPEAT_FOREVER 0      // Repeat count meaning "until stopped"
+#define ALERT_ENGINE_NO_PIN         0xFF   // Output not driven by the engine (e.g. buzzer on I2S)
+
+/**
+ * @brief One step of a compiled alert pattern
+ */
+struct PatternStep {
+    uint16_t durationMs;    ///< Step duration in milliseconds (must be > 0)
+    uint16_t buzzerFreq;    ///< Buzzer frequency in Hz (0 = keep previous)
+    uint8_t buzzerDuty;     ///< Buzzer duty (0-255, 0=off)
+    uint8_t vibrationDuty;  ///< Vibration duty (0-255, 0=off)
+};
+
+/**
+ * @brief Absolute-deadline step state machine (not thread-safe)
+ */
+class PatternSequencer {
+private:
+    PatternStep m_table[ALERT_ENGINE_MAX_STEPS];
+    uint8_t m_stepCount;
+    volatile uint8_t m_step;
+    uint8_t m_repeats;
+    uint8_t m_repeatCount;
+    volatile bool m_playing;
+    int64_t m_stepDeadlineUs;
+    uint32_t m_maxLatenessUs;
+
+public:
+    PatternSequencer();
+
+    /**
+     * @brief Check a table before playing it
+     * @return false for a null or empty table, too many steps, or a zero-length step
+     */
+    static bool isValid(const PatternStep* steps, uint8_t count);
+
+    /**
+     * @brief Start a table from its first step (replaces any current table)
+     * @param steps Step table (copied; must pass isValid())
+     * @param count Number of steps
+     * @param repeats Number of passes through the table (0 = until stopped)
+     * @param nowUs Start time in microseconds
+     */
+    void start(const PatternStep* steps, uint8_t count, uint8_t repeats, int64_t nowUs);
+
+    /**
+     * @brief Stop playback
+     */
+    void stop() { m_playing = false; }
+
+    /**
+     * @brief Consume every step whose deadline has passed
+     * @param nowUs Current time in microseconds
+     * @param current Receives the step now playing (all zero when finished)
+     * @return Absolute deadline of the next step change, or -1 when finished
+     */
+    int64_t advance(int64_t nowUs, PatternStep& current);
+
+    bool isPlaying() const { return m_playing; }
+    uint8_t getCurrentStep() const { return m_step; }
+    uint32_t getMaxLatenessUs() const { return m_maxLatenessUs; }
+    void resetStats() { m_maxLatenessUs = 0; }
+
+    /**
+     * @brief Total duration of one pass through a table
+     * @return Cycle length in milliseconds
+     */
+    static uint32_t cycleDurationMs(const PatternStep* steps, uint8_t count);
+};
+
+#endif // PATTERN_SEQUENCER_H
@@ -0,0 +1,119 @@
+#ifndef STATUS_VIEW_H
+#define STATUS_VIEW_H
+
+/**
+ * @file StatusView.h
+ * @brief Retained-mode text fields for the SSD1306 status screen
+ * @version 1.0.0
+ * @date 2024
+ *
+ * The status screen used to be cleared, redrawn and pushed to the panel in
+ * full (512 bytes over I2C) every second, whether or not anything on it had
+ * changed. StatusView keeps the text last drawn in each field instead:
+ * - set() compares new text with the retained text and marks only the
+ *   characters that differ
+ * - render() redraws just those character cells and reports, per SSD1306
+ *   page (8 pixel rows), the column span that now differs from the panel
+ * - The caller flushes those spans and nothing else; an unchanged screen
+ *   costs a few string compares and no I2C traffic
+ * - After a timeout with no change to a field marked `wakes` (and no
+ *   wake() call) the view asks for the panel to be switched off; changes
+ *   keep accumulating while it is dark and are drawn when it wakes
+ *
+ * Fields are laid out on 6x8 pixel character cells (the GFX built-in
+ * font at size 1), one text row per page.
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+#include "DisplayDirtyPages.h"
+
+#define STATUS_VIEW_MAX_FIELDS      8
+#define STATUS_VIEW_MAX_CHARS       21      // 128 px / 6 px
+#define STATUS_VIEW_MAX_PAGES       DISPLAY_MAX_PAGES
+#define STATUS_GLYPH_WIDTH          6
+#define STATUS_GLYPH_HEIGHT         8
+
+/**
+ * @brief Where a field sits on the panel
+ */
+struct StatusFieldLayout {
+    uint8_t page;           ///< Text row (SSD1306 page)
+    uint8_t x;              ///< Left pixel column
+    uint8_t width;          ///< Characters; shorter text is padded with spaces
+    bool wakes;             ///< A change to this field counts as activity
+};
+
+/**
+ * @brief Draws one character cell: @p c at pixel (x, page * 8), background filled
+ */
+typedef void (*StatusGlyphWriter)(void* context, uint8_t x, uint8_t page, char c);
+
+/**
+ * @brief Retained text fields with per-character dirty tracking and blanking
+ */
+class StatusView {
+private:
+    const StatusFieldLayout* m_layout;
+    uint8_t m_fieldCount;
+    char m_text[STATUS_VIEW_MAX_FIELDS][STATUS_VIEW_MAX_CHARS];     ///< Not NUL-terminated
+    uint32_t m_dirty[STATUS_VIEW_MAX_FIELDS];                       ///< Bit n: character n
+    uint32_t m_timeoutMs;
+    uint32_t m_lastActivityMs;
+    bool m_blanked;
+    uint32_t m_glyphsDrawn;
+
+public:
+    /**
+     * @param layout Field table, @p count entries, indexed by field number
+     * @param timeoutMs Inactivity before blanking (0 never blanks)
+     */
+    StatusView(const StatusFieldLayout* layout, uint8_t count, uint32_t timeoutMs);
+
+    /**
+     * @brief Replace a field's text (truncated or space-padded to its width)
+     * @return true if any character changed
+     */
+    bool set(uint8_t field, const char* text, uint32_t nowMs);
+
+    /**
+     * @brief set() with printf formatting
+     */
+    bool setf(uint8_t field, uint32_t nowMs, const char* format, ...) __attribute__((format(printf, 4, 5)));
+
+    /**
+     * @brief Mark every character dirty (after the frame buffer was cleared)
+     */
+    void invalidate();
+
+    /**
+     * @brief Draw dirty characters and clear their marks
+     * @param pages Receives the spans drawn (merged with what it holds)
+     * @return Characters drawn
+     */
+    uint16_t render(StatusGlyphWriter writer, void* context, DisplayDirtyPages& pages);
+
+    /**
+     * @brief Count activity now (an alert, a command)
+     */
+    void wake(uint32_t nowMs) { m_lastActivityMs = nowMs; }
+
+    /**
+     * @brief Blank after the inactivity timeout, unblank after activity
+     * @return true if isBlanked() changed (switch the panel off or on)
+     */
+    bool updateBlanking(uint32_t nowMs);
+
+    bool hasDirty() const;
+    bool isBlanked() const { return m_blanked; }
+    uint32_t getIdleMs(uint32_t nowMs) const { return nowMs - m_lastActivityMs; }
+    uint32_t getGlyphsDrawn() const { return m_glyphsDrawn; }
+};
+
+/**
+ * @brief Run status view self-tests
+ * @return true if all tests passed
+ */
+bool runStatusViewTests();
+
+#endif // STATUS_VIEW_H
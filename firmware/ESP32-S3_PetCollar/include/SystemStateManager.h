@@ -19,6 +19,7 @@
 #include <vector>
 #include "ESP32_S3_Config.h"
 #include "MicroConfig.h"
+#include "HeapProfiler.h"
 
 // ==========================================
 // SYSTEM STATUS DEFINITIONS
@@ -44,6 +45,7 @@ struct PerformanceMetrics {
     uint32_t freeHeapBytes;         ///< Available heap memory
     uint32_t totalHeapBytes;        ///< Total heap memory
     uint32_t minFreeHeapBytes;      ///< Minimum free heap observed
+    uint32_t largestFreeBlockBytes; ///< Largest single allocation possible
     uint32_t heapFragmentation;     ///< Heap fragmentation percentage
     
     // CPU metrics
@@ -65,6 +67,7 @@ struct PerformanceMetrics {
         freeHeapBytes(0),
         totalHeapBytes(0),
         minFreeHeapBytes(0),
+        largestFreeBlockBytes(0),
         heapFragmentation(0),
         cpuFrequencyMHz(0),
         cpuTemperatureCelsius(0.0f),
@@ -77,10 +80,12 @@ struct PerformanceMetrics {
         webSocketConnections(0) {}
     
     void update() {
-        freeHeapBytes = ESP.getFreeHeap();
+        HeapSummary heap = readHeapSummary();
+        freeHeapBytes = heap.freeBytes;
         totalHeapBytes = ESP.getHeapSize();
-        minFreeHeapBytes = ESP.getMinFreeHeap();
-        heapFragmentation = ESP.getMaxAllocHeap();
+        minFreeHeapBytes = heap.minFreeBytes;
+        largestFreeBlockBytes = heap.largestFreeBlock;
+        heapFragmentation = heap.fragmentation;
         cpuFrequencyMHz = ESP.getCpuFreqMHz();
         uptimeSeconds = millis() / 1000;
         
@@ -261,8 +266,8 @@ private:
     uint32_t m_batteryCheckInterval;
     
     // Loop timing
-    unsigned long m_loopStartTime;
-    unsigned long m_totalLoopTime;
+    uint32_t m_loopStartTime;       ///< CPU cycle count at beginLoop()
+    uint64_t m_totalLoopTime;       ///< Microseconds over m_loopCount passes
     uint32_t m_loopCount;
     
     // Error tracking
@@ -326,6 +331,8 @@ public:
     
     /**
      * @brief End loop timing - call at end of main loop
+     *
+     * Updates the loop metrics and the loop profiler's "loop" stage.
      */
     void endLoop();
     
@@ -539,6 +546,15 @@ public:
      * @return JSON status string
      */
     String getSystemStatusJSON() const;
+    
+    /**
+     * @brief Write the state fields of the status JSON (no clock or heap readings)
+     *
+     * Body of the cached /api/status response; it is hashed into the ETag,
+     * so it must only change when the state does.
+     * @return Length written (0 if @p size was too small)
+     */
+    size_t getSystemStateJSON(char* buffer, size_t size) const;
 };
 
 // ==========================================
@@ -0,0 +1,281 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+/**
+ * @file TelemetryCodec.h
+ * @brief Schema-versioned CBOR telemetry encoding for ESP32-S3 Pet Collar
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Binary alternative to the JSON MQTT payloads, enabled per device:
+ * - Messages are CBOR maps keyed by small integer field IDs instead of names
+ * - Every payload starts with the CBOR self-describe tag (0xD9D9F7), so the
+ *   backend can tell it apart from JSON on the same topic
+ * - Field 0 carries TELEMETRY_SCHEMA_VERSION; IDs are only ever appended
+ * - Encoding writes into a caller-provided buffer, no heap allocation
+ *
+ * The host decoder (firmware/tools/decode_telemetry.py) reads the
+ * TELEMETRY_FIELDS table below, so this file is the schema's single source.
+ */
+
+#include <Arduino.h>
+
+// ==========================================
+// SCHEMA DEFINITION
+// ==========================================
+
+#define TELEMETRY_SCHEMA_VERSION    1
+#define TELEMETRY_BUFFER_SIZE       512    // Preallocated payload buffer
+#define TELEMETRY_SELF_DESCRIBE_TAG 55799  // CBOR magic (0xD9 0xD9 0xF7)
+
+/**
+ * @brief Payload encoding selected for a device
+ */
+enum class TelemetryFormat : uint8_t {
+    JSON = 0,               ///< Named-field JSON (default)
+    CBOR = 1                ///< Integer-keyed CBOR
+};
+
+/**
+ * @brief Message types carried in TF_MESSAGE
+ */
+enum class TelemetryMessage : uint8_t {
+    TELEMETRY = 1,          ///< Periodic device telemetry
+    ALERT = 2,              ///< Proximity alert
+    ZONES = 3,              ///< Zone status
+    LOCATION = 4,           ///< Triangulated position
+    TELEMETRY_DELTA = 5     ///< Changed fields since the previous telemetry message
+};
+
+// Field ID table: FIELD(NAME, id, "json_name"). Append only - never renumber.
+#define TELEMETRY_FIELDS(FIELD) \
+    FIELD(SCHEMA,           0,  "schema")           \
+    FIELD(MESSAGE,          1,  "message")          \
+    FIELD(DEVICE_ID,        2,  "device_id")        \
+    FIELD(TIMESTAMP,        3,  "timestamp")        \
+    FIELD(UPTIME,           4,  "uptime")           \
+    FIELD(FIRMWARE,         5,  "firmware_version") \
+    FIELD(FREE_HEAP,        6,  "free_heap")        \
+    FIELD(WIFI_CONNECTED,   7,  "wifi_connected")   \
+    FIELD(WIFI_RSSI,        8,  "wifi_rssi")        \
+    FIELD(LOCAL_IP,         9,  "local_ip")         \
+    FIELD(SYSTEM_STATE,     10, "system_state")     \
+    FIELD(BATTERY_LEVEL,    11, "battery_level")    \
+    FIELD(ALERT_ACTIVE,     12, "alert_active")     \
+    FIELD(ZONES,            13, "zones")            \
+    FIELD(TOTAL_ZONES,      14, "total_zones")      \
+    FIELD(CURRENT_ZONE,     15, "current_zone")     \
+    FIELD(ZONE_BREACHES,    16, "zone_breaches")    \
+    FIELD(BEACONS,          17, "beacons")          \
+    FIELD(DETECTED_COUNT,   18, "detected_count")   \
+    FIELD(ACTIVE_BEACONS,   19, "active_beacons")   \
+    FIELD(LAST_SCAN,        20, "last_scan")        \
+    FIELD(TEMPORAL_FILTER,  21, "temporal_filter")  \
+    FIELD(ENABLED,          22, "enabled")          \
+    FIELD(FILTER_TYPE,      23, "type")             \
+    FIELD(IIR_ALPHA,        24, "iir_alpha")        \
+    FIELD(KALMAN_Q,         25, "kalman_q")         \
+    FIELD(KALMAN_R,         26, "kalman_r")         \
+    FIELD(ACTIVE_FILTERS,   27, "active_filters")   \
+    FIELD(TOTAL_UPDATES,    28, "total_updates")    \
+    FIELD(POSITION,         29, "position")         \
+    FIELD(POS_X,            30, "x")                \
+    FIELD(POS_Y,            31, "y")                \
+    FIELD(CONFIDENCE,       32, "confidence")       \
+    FIELD(ACCURACY,         33, "accuracy")         \
+    FIELD(ALERT_TYPE,       34, "alert_type")       \
+    FIELD(BEACON_NAME,      35, "beacon_name")      \
+    FIELD(BEACON_ADDRESS,   36, "beacon_address")   \
+    FIELD(DISTANCE_CM,      37, "distance_cm")      \
+    FIELD(RSSI,             38, "rssi")             \
+    FIELD(ALERT_MODE,       39, "alert_mode")       \
+    FIELD(ALERT_INTENSITY,  40, "alert_intensity")  \
+    FIELD(ALERT_DURATION,   41, "alert_duration")   \
+    FIELD(TRIGGER_DISTANCE, 42, "trigger_distance") \
+    FIELD(COLLAR_POSITION,  43, "collar_position")  \
+    FIELD(ZONE_COUNT,       44, "zone_count")       \
+    FIELD(BREACH_COUNT,     45, "breach_count")     \
+    FIELD(METHOD,           46, "method")           \
+    FIELD(SEQUENCE,         47, "sequence")         \
+    FIELD(OUTBOX_SEQ,       48, "outbox_seq")
+
+#define TELEMETRY_FIELD_ENUM(name, id, json) TF_##name = id,
+
+/**
+ * @brief CBOR map keys
+ */
+enum TelemetryField : uint8_t {
+    TELEMETRY_FIELDS(TELEMETRY_FIELD_ENUM)
+};
+
+// Field masks select which telemetry fields a message carries
+#define TELEMETRY_FIELD_BIT(field)  (1ULL << (field))
+#define TELEMETRY_ALL_FIELDS        (~0ULL)
+
+// ==========================================
+// MESSAGE CONTENTS
+// ==========================================
+
+/**
+ * @brief Values published by the periodic telemetry message
+ */
+struct TelemetrySnapshot {
+    uint32_t timestamp;
+    uint32_t uptime;
+    const char* firmware;
+    uint32_t freeHeap;
+    bool wifiConnected;
+    int8_t wifiRssi;
+    char localIp[16];
+    uint8_t systemState;
+    int16_t batteryLevel;
+    bool alertActive;
+
+    uint16_t totalZones;
+    char currentZone[24];
+    uint16_t zoneBreaches;
+
+    uint16_t detectedBeacons;
+    uint16_t activeBeacons;
+    uint32_t lastScan;
+
+    bool filterEnabled;
+    uint8_t filterType;     ///< 0 = IIR, 1 = Kalman
+    float iirAlpha;
+    float kalmanQ;
+    float kalmanR;
+    uint8_t activeFilters;
+    uint32_t filterUpdates;
+
+    bool hasPosition;
+    float posX;
+    float posY;
+    float posConfidence;
+    float posAccuracy;
+};
+
+/**
+ * @brief Values published with a proximity alert
+ */
+struct AlertTelemetry {
+    uint32_t timestamp;
+    const char* beaconName;
+    const char* beaconAddress;
+    float distanceCm;
+    int16_t rssi;
+    const char* alertMode;
+    uint8_t intensity;
+    uint16_t durationMs;
+    float triggerDistanceCm;
+    bool hasPosition;
+    float posX;
+    float posY;
+    float posConfidence;
+};
+
+// ==========================================
+// CBOR WRITER
+// ==========================================
+
+/**
+ * @brief Minimal CBOR (RFC 8949) encoder over a fixed buffer
+ *
+ * Writes past the end set an overflow flag instead of failing per call, so
+ * encoders can emit a whole message and check ok() once.
+ */
+class CborWriter {
+private:
+    uint8_t* m_buffer;
+    size_t m_capacity;
+    size_t m_length;
+    bool m_overflow;
+
+    void writeHead(uint8_t majorType, uint64_t value);
+    void writeRaw(const uint8_t* data, size_t length);
+
+public:
+    CborWriter(uint8_t* buffer, size_t capacity);
+
+    void reset() { m_length = 0; m_overflow = false; }
+
+    // Containers (indefinite length, closed with endContainer)
+    void beginMap();
+    void beginArray();
+    void endContainer();
+
+    // Scalars
+    void writeTag(uint64_t tag);
+    void writeUInt(uint64_t value);
+    void writeInt(int64_t value);
+    void writeFloat(float value);
+    void writeBool(bool value);
+    void writeNull();
+    void writeText(const char* text);
+    void writeText(const char* text, size_t length);
+    void writeBytes(const uint8_t* data, size_t length);
+
+    // Keyed helpers for integer-keyed maps
+    void key(TelemetryField field) { writeUInt(field); }
+    void field(TelemetryField f, uint32_t value) { key(f); writeUInt(value); }
+    void fieldInt(TelemetryField f, int32_t value) { key(f); writeInt(value); }
+    void field(TelemetryField f, float value) { key(f); writeFloat(value); }
+    void field(TelemetryField f, bool value) { key(f); writeBool(value); }
+    void field(TelemetryField f, const char* value) { key(f); writeText(value); }
+
+    const uint8_t* data() const { return m_buffer; }
+    size_t length() const { return m_length; }
+    bool ok() const { return !m_overflow; }
+};
+
+// ==========================================
+// MESSAGE ENCODERS
+// ==========================================
+
+/**
+ * @brief Write the self-describe tag and open a message map with its header
+ * @param writer Target writer (reset by this call)
+ * @param type Message type
+ * @param deviceId Device identifier
+ */
+void beginTelemetryMessage(CborWriter& writer, TelemetryMessage type, const char* deviceId);
+
+/**
+ * @brief Encode the periodic telemetry message
+ * @param sequence Telemetry sequence number
+ * @param fieldMask TELEMETRY_FIELD_BIT()s to include (header fields are always written)
+ * @param type TELEMETRY for a full message, TELEMETRY_DELTA for changed fields only;
+ *             a delta with TF_POSITION set and no position encodes position as null
+ * @return Payload length, or 0 if the buffer was too small
+ */
+size_t encodeTelemetryCbor(CborWriter& writer, const char* deviceId, const TelemetrySnapshot& snapshot,
+                           uint32_t sequence = 0, uint64_t fieldMask = TELEMETRY_ALL_FIELDS,
+                           TelemetryMessage type = TelemetryMessage::TELEMETRY);
+
+/**
+ * @brief Encode a proximity alert message
+ * @return Payload length, or 0 if the buffer was too small
+ */
+size_t encodeAlertCbor(CborWriter& writer, const char* deviceId, const AlertTelemetry& alert);
+
+/**
+ * @brief Encode a zone status message
+ * @return Payload length, or 0 if the buffer was too small
+ */
+size_t encodeZoneStatusCbor(CborWriter& writer, const char* deviceId, uint32_t timestamp,
+                            uint16_t zoneCount, const char* currentZone, uint16_t breachCount);
+
+/**
+ * @brief Encode a location message
+ * @return Payload length, or 0 if the buffer was too small
+ */
+size_t encodeLocationCbor(CborWriter& writer, const char* deviceId, uint32_t timestamp,
+                          float x, float y, float confidence, float accuracy);
+
+/**
+ * @brief Convert a telemetry format to its name ("json" / "cbor")
+ */
+inline const char* telemetryFormatToString(TelemetryFormat format) {
+    return format == TelemetryFormat::CBOR ? "cbor" : "json";
+}
+
+#endif // TELEMETRY_CODEC_H
@@ -0,0 +1,144 @@
+#ifndef TELEMETRY_DELTA_H
+#define TELEMETRY_DELTA_H
+
+/**
+ * @file TelemetryDelta.h
+ * @brief Keyframe + delta compression for CBOR telemetry
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Keeps the last telemetry snapshot the broker accepted and publishes only
+ * the fields that changed since then:
+ * - Keyframes (TELEMETRY) carry every field and reset the backend's state
+ * - Deltas (TELEMETRY_DELTA) carry changed fields, merged over the last state
+ * - Noisy values (RSSI, free heap, position) only count as changed once they
+ *   move past a deadband from the last *sent* value, so drift still arrives
+ * - Counters (uptime, last scan, filter updates) ride along with keyframes
+ * - Fields that stop existing (lost position, disabled temporal filter) are
+ *   sent once as null so the backend drops them instead of keeping old values
+ * - Every message has a sequence number; a backend that sees a gap waits for
+ *   the next keyframe or requests one with the "telemetry-keyframe" command
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+#include "TelemetryCodec.h"
+
+/**
+ * @brief What the encoder decided to publish
+ */
+enum class TelemetryFrame : uint8_t {
+    KEYFRAME,               ///< Full snapshot
+    DELTA,                  ///< Changed fields only
+    SUPPRESSED              ///< Nothing changed, publish nothing
+};
+
+/**
+ * @brief Change thresholds for noisy fields
+ */
+struct TelemetryDeadbands {
+    uint8_t rssiDbm;
+    uint32_t heapBytes;
+    float positionM;
+    float confidence;
+
+    TelemetryDeadbands() :
+        rssiDbm(TELEMETRY_DEADBAND_RSSI_DBM),
+        heapBytes(TELEMETRY_DEADBAND_HEAP_BYTES),
+        positionM(TELEMETRY_DEADBAND_POSITION_M),
+        confidence(TELEMETRY_DEADBAND_CONFIDENCE) {}
+};
+
+/**
+ * @brief Delta compression statistics
+ */
+struct TelemetryDeltaStats {
+    uint32_t keyframes;
+    uint32_t deltas;
+    uint32_t suppressed;
+    uint32_t failed;
+    uint32_t bytesSent;
+    uint32_t fullBytesEquivalent;   ///< What the same messages cost as keyframes
+};
+
+/**
+ * @brief Chooses keyframe/delta/suppress and encodes the telemetry message
+ *
+ * Usage: encode() the current snapshot, publish the writer contents unless
+ * the frame is SUPPRESSED, then report the outcome with markSent().
+ */
+class TelemetryDeltaEncoder {
+private:
+    TelemetrySnapshot m_lastSent;
+    TelemetrySnapshot m_pending;
+    bool m_hasBaseline;
+    bool m_forceKeyframe;
+    uint32_t m_sequence;
+    uint16_t m_sinceKeyframe;
+    uint32_t m_lastKeyframeMs;
+
+    TelemetryFrame m_pendingFrame;
+    uint64_t m_pendingMask;
+    size_t m_pendingLength;
+    size_t m_pendingFullLength;
+
+    uint16_t m_keyframeInterval;
+    uint32_t m_keyframeMaxMs;
+    TelemetryDeadbands m_deadbands;
+    TelemetryDeltaStats m_stats;
+
+    /**
+     * @brief Fields of @p current that differ from the last sent snapshot
+     */
+    uint64_t changedFields(const TelemetrySnapshot& current) const;
+
+public:
+    TelemetryDeltaEncoder();
+
+    /**
+     * @brief Encode the next telemetry message into @p writer
+     * @param writer Target writer
+     * @param deviceId Device identifier
+     * @param snapshot Current values
+     * @param nowMs Current time in milliseconds
+     * @return Frame type; the payload is writer.data()/getPendingLength()
+     */
+    TelemetryFrame encode(CborWriter& writer, const char* deviceId,
+                          const TelemetrySnapshot& snapshot, uint32_t nowMs);
+
+    /**
+     * @brief Report whether the last encoded message reached the broker
+     * @param published true if the publish succeeded
+     *
+     * A failed publish forces the next message to be a keyframe, since the
+     * backend's state no longer matches ours.
+     */
+    void markSent(bool published);
+
+    /**
+     * @brief Make the next message a keyframe (reconnect, backend resync)
+     */
+    void requestKeyframe() { m_forceKeyframe = true; }
+
+    void setKeyframeInterval(uint16_t publishes, uint32_t maxMs);
+    void setDeadbands(const TelemetryDeadbands& deadbands) { m_deadbands = deadbands; }
+    const TelemetryDeadbands& getDeadbands() const { return m_deadbands; }
+
+    uint64_t getPendingMask() const { return m_pendingMask; }
+    size_t getPendingLength() const { return m_pendingLength; }
+    uint32_t getSequence() const { return m_sequence; }
+    const TelemetryDeltaStats& getStats() const { return m_stats; }
+};
+
+/**
+ * @brief Convert a frame type to a string
+ */
+const char* telemetryFrameToString(TelemetryFrame frame);
+
+/**
+ * @brief Run delta encoder self-tests (deadbands, keyframes, failed publishes)
+ * @return true if all tests pass
+ */
+bool runTelemetryDeltaTests();
+
+#endif // TELEMETRY_DELTA_H
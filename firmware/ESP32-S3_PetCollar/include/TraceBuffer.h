@@ -0,0 +1,190 @@
+#ifndef TRACE_BUFFER_H
+#define TRACE_BUFFER_H
+
+/**
+ * @file TraceBuffer.h
+ * @brief Lock-free binary event trace ring for ESP32-S3 Pet Collar
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Hot paths (the BLE callback, proximity checks, beacon updates) used to
+ * explain themselves with Serial.printf, which costs milliseconds per line
+ * at 115200 baud. TRACE(EVENT, a, b) instead stores a 16-byte record
+ * (microsecond timestamp, event ID, core, two integer arguments) in a ring:
+ * - Writers claim a slot with one atomic increment and publish it with a
+ *   sequence stamp, so any task or ISR can trace without a lock
+ * - When the ring wraps the oldest records are overwritten; the reader
+ *   counts them as lost instead of blocking writers
+ * - Records are only read on demand (trace command over serial, MQTT or
+ *   WebSocket), in batches with a TraceBatchHeader
+ * - With FEATURE_TRACE false, TRACE() compiles to nothing and its
+ *   arguments are not evaluated
+ *
+ * The host converter (firmware/tools/trace_to_chrome.py) reads the
+ * TRACE_EVENTS table below and writes Chrome trace JSON for
+ * chrome://tracing or Perfetto.
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include "ESP32_S3_Config.h"
+
+// ==========================================
+// EVENT DEFINITION
+// ==========================================
+
+#define TRACE_BUFFER_RECORDS        512     // Ring size, power of two (10 KB)
+#define TRACE_BATCH_RECORDS         32      // Records per serial line / MQTT message / WebSocket frame
+#define TRACE_BATCH_MAGIC           "PCTR"
+#define TRACE_BATCH_VERSION         1
+
+// Event table: EVENT(NAME, id, 'phase', "name", "arg0", "arg1"). Append only.
+// Phases follow Chrome trace: 'i' instant, 'B'/'E' begin/end on the same core.
+// "beacon" arguments are traceNameHash() of the beacon name.
+#define TRACE_EVENTS(EVENT) \
+    EVENT(MARK,                   0,  'i', "mark",                   "value",       "")            \
+    EVENT(BLE_ADVERT,             1,  'i', "ble_advert",             "beacon",      "rssi")        \
+    EVENT(BEACON_UPDATE,          2,  'i', "beacon_update",          "beacon",      "rssi")        \
+    EVENT(PROXIMITY_CHECK,        3,  'i', "proximity_check",        "beacon",      "distance_cm") \
+    EVENT(PROXIMITY_UNCONFIGURED, 4,  'i', "proximity_unconfigured", "beacon",      "distance_cm") \
+    EVENT(PROXIMITY_COOLDOWN,     5,  'i', "proximity_cooldown",     "beacon",      "remaining_ms") \
+    EVENT(PROXIMITY_ALERT,        6,  'i', "proximity_alert",        "beacon",      "decision")    \
+    EVENT(PROXIMITY_ENTER,        7,  'i', "proximity_enter",        "beacon",      "distance_cm") \
+    EVENT(PROXIMITY_EXIT,         8,  'i', "proximity_exit",         "beacon",      "distance_cm") \
+    EVENT(BLE_SCAN_BEGIN,         9,  'B', "ble_scan",               "duration_s",  "")            \
+    EVENT(BLE_SCAN_END,           10, 'E', "ble_scan",               "",            "")            \
+    EVENT(MQTT_PUBLISH,           11, 'i', "mqtt_publish",           "bytes",       "sent")
+
+#define TRACE_EVENT_ENUM(name, id, phase, label, arg0, arg1) name = id,
+
+/**
+ * @brief Traced events
+ */
+enum class TraceEvent : uint16_t {
+    TRACE_EVENTS(TRACE_EVENT_ENUM)
+};
+
+/**
+ * @brief One event as stored and transmitted (little-endian)
+ */
+struct TraceRecord {
+    uint32_t timestampUs;   ///< micros(); wraps every 71 minutes
+    uint16_t event;         ///< TraceEvent
+    uint8_t core;           ///< CPU core that recorded it
+    uint8_t reserved;
+    int32_t arg0;
+    int32_t arg1;
+};
+
+/**
+ * @brief Prefix of every drained batch, followed by count records
+ */
+struct TraceBatchHeader {
+    char magic[4];          ///< TRACE_BATCH_MAGIC
+    uint8_t version;        ///< TRACE_BATCH_VERSION
+    uint8_t recordSize;     ///< sizeof(TraceRecord)
+    uint16_t count;
+    uint32_t lost;          ///< Records overwritten since the previous batch
+    uint32_t nowUs;         ///< micros() when drained
+};
+
+static_assert(sizeof(TraceRecord) == 16, "Trace records are 16 bytes on the wire");
+static_assert(sizeof(TraceBatchHeader) == 16, "Trace batch header is 16 bytes on the wire");
+
+// ==========================================
+// TRACE RING
+// ==========================================
+
+/**
+ * @brief One ring entry
+ */
+struct TraceSlot {
+    std::atomic<uint32_t> sequence;         ///< Index + 1 once written, 0 while being written
+    TraceRecord record;
+};
+
+/**
+ * @brief Multi-writer, single-reader ring of trace records
+ */
+class TraceBuffer {
+private:
+    TraceSlot* m_slots;
+    uint32_t m_mask;                        ///< Capacity - 1
+    std::atomic<uint32_t> m_head;           ///< Next index to claim
+    uint32_t m_readCursor;                  ///< Next index to drain (reader only)
+    uint32_t m_totalLost;
+
+public:
+    /**
+     * @param slots Zeroed ring storage, @p capacity entries (a power of two)
+     *
+     * constexpr so the global ring is usable before static constructors run.
+     */
+    constexpr TraceBuffer(TraceSlot* slots, uint32_t capacity) :
+        m_slots(slots),
+        m_mask(capacity - 1),
+        m_head(0),
+        m_readCursor(0),
+        m_totalLost(0) {}
+
+    /**
+     * @brief Append one record (any task or ISR)
+     */
+    void IRAM_ATTR record(TraceEvent event, int32_t arg0, int32_t arg1);
+
+    /**
+     * @brief Copy committed records after the read cursor, oldest first
+     * @param out Destination, @p maxRecords entries
+     * @param lost Incremented by records overwritten before they were read
+     * @return Records copied
+     */
+    size_t drain(TraceRecord* out, size_t maxRecords, uint32_t& lost);
+
+    /**
+     * @brief Drain up to TRACE_BATCH_RECORDS records into a header-prefixed batch
+     * @return Batch size in bytes, 0 if there was nothing to report
+     */
+    size_t writeBatch(uint8_t* buffer, size_t capacity);
+
+    /**
+     * @brief Skip everything recorded so far
+     */
+    void clear();
+
+    uint32_t getRecorded() const { return m_head.load(std::memory_order_relaxed); }
+    uint32_t getPending() const { return getRecorded() - m_readCursor; }
+    uint32_t getTotalLost() const { return m_totalLost; }
+};
+
+#define TRACE_BATCH_BYTES (sizeof(TraceBatchHeader) + TRACE_BATCH_RECORDS * sizeof(TraceRecord))
+
+/**
+ * @brief FNV-1a of a beacon name, used as its "beacon" argument
+ */
+static inline int32_t traceNameHash(const char* name) {
+    uint32_t hash = 2166136261UL;
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619UL;
+    }
+    return (int32_t)hash;
+}
+
+#if FEATURE_TRACE
+#define TRACE(event, arg0, arg1) traceBuffer.record(TraceEvent::event, (int32_t)(arg0), (int32_t)(arg1))
+extern TraceBuffer traceBuffer;
+#else
+#define TRACE(event, arg0, arg1) do {} while (0)
+#endif
+
+/**
+ * @brief Event name used by the converter
+ */
+const char* traceEventToString(TraceEvent event);
+
+/**
+ * @brief Run trace buffer self-tests
+ * @return true if all tests passed
+ */
+bool runTraceBufferTests();
+
+#endif // TRACE_BUFFER_H
@@ -0,0 +1,75 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+/**
+ * @file WebAssets.h
+ * @brief Gzip-compressed static web assets
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Generated by firmware/tools/embed_web_assets.py from ESP32-S3_PetCollar/web/.
+ * Do not edit by hand; edit the source file and re-run the script.
+ */
+
+#include <Arduino.h>
+
+/**
+ * @brief One precompressed asset
+ */
+struct WebAsset {
+    const char* path;           ///< URL path
+    const char* contentType;
+    const uint8_t* data;        ///< gzip stream
+    size_t length;
+    size_t originalLength;      ///< Size before compression
+    const char* etag;           ///< Quoted hash of the gzip stream
+};
+
+// web/index.html: 1067 -> 591 bytes
+static const uint8_t WEB_ASSET_INDEX_HTML[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x85, 0x54, 0x51, 0x6b, 0xdb, 0x30,
+    0x10, 0x7e, 0xf7, 0xaf, 0xb8, 0x79, 0x0f, 0x49, 0x68, 0x6c, 0xaf, 0x69, 0x1f, 0x46, 0x62, 0xfb,
+    0x61, 0x59, 0x06, 0x1b, 0x65, 0x0d, 0x64, 0x30, 0xf6, 0x54, 0x14, 0xeb, 0xec, 0x68, 0x91, 0x25,
+    0x23, 0x9d, 0x93, 0x86, 0xd2, 0xff, 0x3e, 0x29, 0x72, 0x58, 0x0b, 0x65, 0xc3, 0x0f, 0xd2, 0x7d,
+    0x3a, 0x7d, 0xba, 0xef, 0xbb, 0xc3, 0xf9, 0xbb, 0xcf, 0xf7, 0xcb, 0x1f, 0xbf, 0xd6, 0x2b, 0xd8,
+    0x51, 0x2b, 0xcb, 0x28, 0xf7, 0x0b, 0x48, 0xa6, 0x9a, 0x22, 0x46, 0x15, 0x7b, 0x00, 0x19, 0x77,
+    0x4b, 0x8b, 0xc4, 0xa0, 0xda, 0x31, 0x63, 0x91, 0x8a, 0xb8, 0xa7, 0x3a, 0xf9, 0x18, 0x5f, 0x60,
+    0xc5, 0x5a, 0x2c, 0xe2, 0x83, 0xc0, 0x63, 0xa7, 0x0d, 0xc5, 0x50, 0x69, 0x45, 0xa8, 0x5c, 0xda,
+    0x51, 0x70, 0xda, 0x15, 0x1c, 0x0f, 0xa2, 0xc2, 0xe4, 0x1c, 0x4c, 0x41, 0x28, 0x41, 0x82, 0xc9,
+    0xc4, 0x56, 0x4c, 0x62, 0x71, 0xed, 0x49, 0x48, 0x90, 0xc4, 0x72, 0xb5, 0x59, 0xdf, 0xcc, 0x92,
+    0xcd, 0x0d, 0xac, 0x91, 0x60, 0xa9, 0xa5, 0x64, 0x26, 0xcf, 0xc2, 0x51, 0x94, 0x5b, 0x3a, 0xf9,
+    0x75, 0xab, 0xf9, 0x09, 0x9e, 0xa0, 0x76, 0x0f, 0x24, 0x35, 0x6b, 0x85, 0x3c, 0xcd, 0xc1, 0x9e,
+    0x2c, 0x61, 0x9b, 0xf4, 0x62, 0x0a, 0x96, 0x29, 0x9b, 0x58, 0x34, 0xa2, 0x5e, 0x40, 0xcb, 0x4c,
+    0x23, 0xd4, 0x1c, 0x66, 0xd8, 0x02, 0xeb, 0x49, 0x7b, 0xe4, 0x31, 0x14, 0x31, 0x87, 0x5b, 0x87,
+    0x2e, 0xa0, 0x63, 0x9c, 0x0b, 0xd5, 0xcc, 0xe1, 0x03, 0x5c, 0xfb, 0xf8, 0x39, 0xea, 0x0c, 0x3a,
+    0xfa, 0x2d, 0xab, 0xf6, 0x8d, 0xd1, 0xbd, 0xe2, 0x73, 0x78, 0x5f, 0xdf, 0xfa, 0xef, 0x45, 0xf2,
+    0x39, 0x55, 0x1f, 0xd0, 0xd4, 0x52, 0x1f, 0xe7, 0x03, 0xf7, 0x73, 0x94, 0x67, 0x43, 0x8d, 0x79,
+    0x36, 0x58, 0xe6, 0x8b, 0xf5, 0x06, 0x5e, 0xbf, 0x2d, 0xcd, 0xe1, 0x51, 0xde, 0x81, 0xe0, 0x45,
+    0x2c, 0x54, 0xad, 0xe3, 0xf2, 0x4e, 0x33, 0xff, 0x02, 0x04, 0xbf, 0xc0, 0x83, 0xa6, 0x65, 0x24,
+    0xb4, 0x4a, 0xd3, 0x34, 0xcf, 0x3a, 0x97, 0xde, 0xfb, 0x16, 0x49, 0x51, 0xe6, 0x0c, 0x76, 0x06,
+    0xeb, 0x22, 0xce, 0x58, 0x27, 0x32, 0x2e, 0x6c, 0xe5, 0x0b, 0x8a, 0xcb, 0x57, 0x61, 0x9e, 0xb1,
+    0x12, 0x92, 0x0b, 0x1d, 0x53, 0x1c, 0x14, 0xd2, 0x51, 0x9b, 0x7d, 0x9e, 0x39, 0x8a, 0x37, 0x78,
+    0x2c, 0x31, 0xea, 0xed, 0xc0, 0x12, 0x82, 0x81, 0x23, 0x78, 0x0c, 0x17, 0xec, 0xed, 0xeb, 0x6e,
+    0x16, 0x8c, 0xa8, 0x2e, 0xf7, 0x87, 0x68, 0x20, 0xe8, 0x3b, 0x12, 0x2d, 0x4e, 0xc1, 0x59, 0xd3,
+    0x9d, 0x4b, 0xb1, 0xa2, 0x51, 0x4c, 0x0e, 0x54, 0xd9, 0x59, 0x97, 0x37, 0xdf, 0xbb, 0x71, 0x29,
+    0xc3, 0x49, 0x36, 0xe7, 0xde, 0x57, 0x46, 0x74, 0x54, 0x46, 0x35, 0x52, 0xb5, 0x1b, 0x8f, 0x5e,
+    0x69, 0x1c, 0x4d, 0x52, 0xda, 0xa1, 0x1a, 0x1b, 0x28, 0x4a, 0x30, 0xe9, 0x6f, 0xab, 0xd5, 0x78,
+    0x32, 0x60, 0xdc, 0x63, 0x4f, 0x11, 0x00, 0xd7, 0x55, 0xdf, 0xba, 0x81, 0x4c, 0x1b, 0xa4, 0x95,
+    0x44, 0xbf, 0xfd, 0x74, 0xfa, 0xca, 0xc7, 0x23, 0x6f, 0xb1, 0x67, 0xc0, 0x47, 0x5a, 0x86, 0x99,
+    0x85, 0xc2, 0xe5, 0x03, 0x8c, 0xbe, 0x08, 0xd3, 0x1e, 0x99, 0x2b, 0xe8, 0x30, 0x82, 0x2b, 0xe0,
+    0xa9, 0x7b, 0xca, 0xba, 0x46, 0xb8, 0xfd, 0x08, 0xc6, 0x01, 0xda, 0xf6, 0x42, 0xf2, 0x07, 0xce,
+    0x08, 0x3d, 0x3a, 0x01, 0x77, 0x1a, 0x0e, 0x3a, 0xc9, 0xc8, 0xb7, 0x0e, 0xae, 0x02, 0x97, 0x93,
+    0xff, 0x13, 0xb7, 0x1b, 0x5d, 0xed, 0x5d, 0xf7, 0x43, 0xca, 0x11, 0xb7, 0xf6, 0x1c, 0x3f, 0xf4,
+    0x46, 0x2e, 0xa2, 0xe7, 0xc9, 0xe2, 0x95, 0xba, 0xe0, 0xc0, 0xbf, 0xb4, 0xd9, 0xff, 0x6a, 0xfb,
+    0xcb, 0xf1, 0x52, 0x1d, 0x7c, 0xdb, 0xdc, 0x7f, 0x4f, 0xad, 0x6b, 0x8d, 0x6a, 0x44, 0x7d, 0x1a,
+    0xdb, 0x29, 0xa8, 0x5e, 0xca, 0x29, 0xcc, 0x26, 0xa1, 0x0c, 0x37, 0xc6, 0x83, 0xdd, 0x79, 0x36,
+    0x0c, 0x70, 0x16, 0x7e, 0x0d, 0x7f, 0x00, 0x45, 0x49, 0x22, 0x39, 0x2b, 0x04, 0x00, 0x00,
+};
+
+static const WebAsset WEB_ASSETS[] = {
+    {"/", "text/html", WEB_ASSET_INDEX_HTML, sizeof(WEB_ASSET_INDEX_HTML), 1067, "\"cbe5ba7c0503\""},
+};
+
+static const size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);
+
+#endif // WEB_ASSETS_H
@@ -0,0 +1,127 @@
+#ifndef WIFI_FAST_CONNECT_H
+#define WIFI_FAST_CONNECT_H
+
+/**
+ * @file WiFiFastConnect.h
+ * @brief Cached access point and DHCP lease for fast WiFi reconnects
+ * @version 1.0.0
+ * @date 2024
+ *
+ * A plain WiFi.begin(ssid, password) scans every channel and then runs
+ * DHCP, which takes seconds on every boot and reconnect. After each
+ * successful connection the BSSID, channel and lease (IP, gateway, subnet,
+ * DNS) are remembered; the next connect to the same SSID targets that
+ * access point on that channel and reuses the lease as a static address,
+ * so association is a single probe and there is no DHCP exchange.
+ *
+ * A lease reused WIFI_FAST_LEASE_REUSES times is renewed by one DHCP
+ * connect (still on the cached BSSID and channel), and a record that fails
+ * WIFI_FAST_MAX_FAILURES fast connects in a row is dropped so the next
+ * connect scans.
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+
+#define WIFI_FAST_RECORD_VERSION 1
+
+/**
+ * @brief What a connect may take from the cache
+ */
+enum class WiFiFastPath : uint8_t {
+    SCAN = 0,               ///< Nothing cached for this SSID: full scan and DHCP
+    TARGETED,               ///< Cached BSSID and channel, DHCP renews the lease
+    FULL                    ///< Cached BSSID, channel and static lease
+};
+
+/**
+ * @brief Persisted connection record (stored as one blob)
+ */
+struct WiFiFastRecord {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t bssid[6];
+    uint32_t ip;            ///< IPv4 addresses as IPAddress casts them
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns1;
+    uint32_t dns2;
+    uint8_t leaseUses;      ///< Connects on the cached lease since DHCP last ran
+    uint8_t failures;       ///< Fast connects failed in a row
+    char ssid[33];
+};
+
+/**
+ * @brief Connect statistics since boot
+ */
+struct WiFiFastStats {
+    uint32_t fastAttempts;
+    uint32_t fastConnects;
+    uint32_t fastFailures;
+    uint32_t scanConnects;  ///< Connects that needed a full scan
+    uint32_t saves;         ///< Records written to flash
+    uint32_t lastConnectMs; ///< Time the last connect took
+    WiFiFastPath lastPath;
+};
+
+/**
+ * @brief Fast-connect decisions and record bookkeeping (no radio access)
+ */
+class WiFiFastConnect {
+private:
+    WiFiFastRecord m_record;
+    bool m_valid;
+    WiFiFastPath m_pendingPath;     ///< Path of the connect in progress
+    WiFiFastStats m_stats;
+
+public:
+    WiFiFastConnect();
+
+    /**
+     * @brief Adopt a record read from flash
+     * @return false if it is the wrong size or version (cache stays empty)
+     */
+    bool restore(const void* data, size_t length);
+
+    /**
+     * @brief Path to use for a connect to @p ssid
+     */
+    WiFiFastPath plan(const char* ssid) const;
+
+    /**
+     * @brief Note that a connect using @p path is starting
+     */
+    void beginAttempt(WiFiFastPath path);
+
+    /**
+     * @brief A fast connect failed
+     * @return true if the record changed and should be saved
+     */
+    bool recordFailure(uint32_t elapsedMs);
+
+    /**
+     * @brief Remember the connection just made
+     * @param bssid Access point MAC (6 bytes)
+     * @return true if the record changed and should be saved
+     */
+    bool recordConnected(const char* ssid, const uint8_t* bssid, uint8_t channel,
+                         uint32_t ip, uint32_t gateway, uint32_t subnet,
+                         uint32_t dns1, uint32_t dns2, uint32_t elapsedMs);
+
+    void clear();
+    void countSave() { m_stats.saves++; }
+
+    bool isValid() const { return m_valid; }
+    const WiFiFastRecord& getRecord() const { return m_record; }
+    const WiFiFastStats& getStats() const { return m_stats; }
+};
+
+const char* wifiFastPathToString(WiFiFastPath path);
+
+/**
+ * @brief Run fast-connect cache self-tests
+ * @return true if all tests passed
+ */
+bool runWiFiFastConnectTests();
+
+#endif // WIFI_FAST_CONNECT_H
@@ -24,6 +24,7 @@
 #include <ArduinoJson.h>
 #include "ESP32_S3_Config.h"
 #include "MicroConfig.h"
+#include "WiFiFastConnect.h"
 
 // ==========================================
 // WIFI MANAGER CONFIGURATION
@@ -525,6 +526,36 @@ public:
      */
     bool attemptConnection(const String& ssid, const String& password);
     
+    /**
+     * @brief Connect to the cached BSSID and channel, reusing the cached lease
+     * @param ssid Network SSID
+     * @param password Network password
+     * @return true if connected; false if nothing is cached or it failed
+     *         (the caller then scans)
+     */
+    bool connectFast(const String& ssid, const String& password);
+    
+    /**
+     * @brief Move to a known access point without scanning
+     * @param ssid Network SSID
+     * @param password Network password
+     * @param bssid Access point MAC (6 bytes)
+     * @param channel Access point channel
+     * @return true if connected
+     */
+    bool roamTo(const String& ssid, const String& password, const uint8_t* bssid, uint8_t channel);
+    
+    /**
+     * @brief Cache the current connection for the next connectFast()
+     * @param elapsedMs Time the connect took
+     */
+    void rememberConnection(uint32_t elapsedMs);
+    
+    /**
+     * @brief Fast-connect cache and statistics
+     */
+    const WiFiFastConnect& getFastConnect() const;
+    
          /**
       * @brief Check if setup mode timeout has been reached
       * @return True if should start setup AP
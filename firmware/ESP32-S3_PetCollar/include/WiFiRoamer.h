@@ -0,0 +1,185 @@
+#ifndef WIFI_ROAMER_H
+#define WIFI_ROAMER_H
+
+/**
+ * @file WiFiRoamer.h
+ * @brief Background roaming between access points of the configured networks
+ * @version 1.0.0
+ * @date 2024
+ *
+ * In mesh and multi-AP homes the station used to stay on the AP it joined
+ * until the link dropped, then spent a maintenance period noticing and a
+ * full scan reconnecting. The roamer keeps a table of access points seen
+ * for the configured SSIDs, ranked by RSSI, and moves the collar before
+ * the link dies:
+ * - The link RSSI is smoothed (1/2^ROAM_RSSI_SHIFT per sample)
+ * - Below ROAM_SCAN_RSSI it asks for passive scans of one known channel at
+ *   a time (ROAM_SCAN_FAST_MS apart, ROAM_SCAN_SLOW_MS while the link is
+ *   good), and an all-channel scan at most every ROAM_FULL_SCAN_MS to find
+ *   new APs. Scans are only requested while the caller says the radio is
+ *   otherwise idle
+ * - Below ROAM_TRIGGER_RSSI it roams to the best fresh candidate that is
+ *   at least ROAM_HYSTERESIS_DB stronger, no sooner than ROAM_HOLD_MS after
+ *   the last roam, so two similar APs do not ping-pong
+ * - After a link loss the ranked table gives the reconnect order; an AP
+ *   that refused a connect is skipped for ROAM_FAIL_BACKOFF_MS
+ *
+ * This header and wifi_roamer.cpp have no Arduino dependencies so the host
+ * test (firmware/tools/wifi_roaming_test.cpp) runs the same code against
+ * simulated RSSI curves.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==========================================
+// ROAMING PARAMETERS
+// ==========================================
+
+#define ROAM_MAX_CANDIDATES         8       // Access points tracked
+#define ROAM_SCAN_RSSI              -67     // Link RSSI (dBm) below which candidates are refreshed quickly
+#define ROAM_TRIGGER_RSSI           -72     // Link RSSI (dBm) below which the collar roams
+#define ROAM_HYSTERESIS_DB          8       // A candidate must beat the link by this much
+#define ROAM_RSSI_SHIFT             2       // Link RSSI smoothing: 1/4 of each new sample
+#define ROAM_SCAN_FAST_MS           4000    // Channel scan period while the link is weak
+#define ROAM_SCAN_SLOW_MS           60000   // Channel scan period while the link is good
+#define ROAM_FULL_SCAN_MS           300000  // All-channel scans at most this often
+#define ROAM_CANDIDATE_MAX_AGE_MS   30000   // Scan results older than this are not roamed to
+#define ROAM_HOLD_MS                15000   // Minimum time between roams
+#define ROAM_FAIL_BACKOFF_MS        60000   // An AP that refused a connect is skipped this long
+
+/**
+ * @brief One access point of a configured network
+ */
+struct RoamCandidate {
+    uint8_t bssid[6];
+    uint8_t channel;
+    int8_t network;         ///< Index of the configured network (SSID/password)
+    int8_t rssi;            ///< dBm, averaged over recent scans
+    uint32_t seenMs;        ///< Last scan that saw it
+    uint32_t failedMs;      ///< Last refused connect (0 = none)
+};
+
+/**
+ * @brief Scan the caller should start
+ */
+enum class RoamScanType : uint8_t {
+    NONE = 0,
+    CHANNEL,                ///< Passive scan of one channel
+    FULL                    ///< Passive scan of every channel
+};
+
+struct RoamScanRequest {
+    RoamScanType type;
+    uint8_t channel;        ///< For CHANNEL scans
+};
+
+/**
+ * @brief Roaming statistics
+ */
+struct RoamStats {
+    uint32_t channelScans;
+    uint32_t fullScans;
+    uint32_t roams;         ///< Proactive moves to a stronger AP
+    uint32_t reconnects;    ///< Connects after a link loss
+    uint32_t failures;      ///< Connects an AP refused
+    int8_t lastRoamFromRssi;
+    int8_t lastRoamToRssi;
+};
+
+/**
+ * @brief RSSI-ranked candidate table and roaming decisions (no radio access)
+ */
+class WiFiRoamer {
+private:
+    RoamCandidate m_candidates[ROAM_MAX_CANDIDATES];
+    uint8_t m_count;
+
+    bool m_connected;
+    uint8_t m_currentBssid[6];
+    int8_t m_currentNetwork;
+    int16_t m_linkRssiQ4;   ///< Smoothed link RSSI, 1/16 dB
+
+    bool m_scanning;
+    uint32_t m_lastScanMs;
+    uint32_t m_lastFullScanMs;
+    uint8_t m_nextChannel;  ///< Rotation through known channels
+    uint32_t m_lastRoamMs;
+    RoamStats m_stats;
+
+    RoamCandidate* find(const uint8_t* bssid);
+    bool isCurrent(const RoamCandidate& candidate) const;
+    bool isUsable(const RoamCandidate& candidate, uint32_t nowMs) const;
+    uint8_t knownChannels(uint8_t* channels) const;
+
+public:
+    WiFiRoamer();
+
+    /**
+     * @brief The station joined @p bssid (the AP is added to the table)
+     */
+    void setConnected(const uint8_t* bssid, uint8_t channel, int8_t network,
+                      int8_t rssi, uint32_t nowMs);
+
+    /**
+     * @brief The link was lost
+     */
+    void setDisconnected();
+
+    /**
+     * @brief A link RSSI sample of the current AP
+     */
+    void reportLinkRssi(int8_t rssi);
+
+    /**
+     * @brief Scan to start now, if any
+     * @param radioIdle false while the radio is busy (scan deferred)
+     */
+    RoamScanRequest nextScan(uint32_t nowMs, bool radioIdle);
+
+    /**
+     * @brief One access point of a configured network found by a scan
+     */
+    void reportScanResult(const uint8_t* bssid, uint8_t channel, int8_t network,
+                          int8_t rssi, uint32_t nowMs);
+
+    /**
+     * @brief The scan from nextScan() finished (or failed)
+     */
+    void scanFinished();
+
+    /**
+     * @brief Candidate to roam to now, or nullptr to stay
+     */
+    const RoamCandidate* pickRoamTarget(uint32_t nowMs) const;
+
+    /**
+     * @brief Candidates for a reconnect, strongest fresh ones first
+     * @return Number written to @p out
+     */
+    uint8_t rank(const RoamCandidate** out, uint8_t max, uint32_t nowMs) const;
+
+    /**
+     * @brief A roam to @p target is starting
+     */
+    void roamStarted(const RoamCandidate& target, uint32_t nowMs);
+
+    /**
+     * @brief A reconnect after link loss is starting
+     */
+    void reconnectStarted() { m_stats.reconnects++; }
+
+    /**
+     * @brief @p bssid refused a connect
+     */
+    void connectFailed(const uint8_t* bssid, uint32_t nowMs);
+
+    bool isConnected() const { return m_connected; }
+    bool isScanning() const { return m_scanning; }
+    int8_t getLinkRssi() const { return (int8_t)(m_linkRssiQ4 / 16); }
+    uint8_t getCount() const { return m_count; }
+    const RoamCandidate& getCandidate(uint8_t index) const { return m_candidates[index]; }
+    const RoamStats& getStats() const { return m_stats; }
+};
+
+#endif // WIFI_ROAMER_H
@@ -0,0 +1,188 @@
+#ifndef WS_FANOUT_H
+#define WS_FANOUT_H
+
+/**
+ * @file WsFanout.h
+ * @brief WebSocket broadcast fan-out with shared frames and per-client queues
+ * @version 1.0.0
+ * @date 2024
+ *
+ * A broadcast is serialized once into a reference-counted WsFrame that every
+ * client queue points at. service() drains the queues round-robin from the
+ * main loop within a time budget, so one client on a weak link no longer
+ * stalls the loop for all the others:
+ * - Snapshot frames (status, beacons) coalesce: a newer one replaces the
+ *   one still waiting in the queue, so the latest state wins
+ * - A full queue drops its oldest frame, snapshots before events
+ * - Slow or failed sends earn strikes; WS_SLOW_CLIENT_STRIKES in a row
+ *   disconnect the client
+ */
+
+#include <Arduino.h>
+#include "ESP32_S3_Config.h"
+
+// ==========================================
+// FRAMES
+// ==========================================
+
+/**
+ * @brief What a frame carries (decides coalescing and drop order)
+ */
+enum class WsFrameKind : uint8_t {
+    STATUS = 0,             ///< System status snapshot (latest wins)
+    BEACONS,                ///< Beacon list snapshot (latest wins)
+    ALERT,                  ///< Proximity alert event
+    RESPONSE,               ///< Command response or error
+    STREAM                  ///< Subscribed live-feed frame (WsStreamHub)
+};
+
+/**
+ * @brief Serialized text frame shared by every queue it is in
+ */
+struct WsFrame {
+    WsFrameKind kind;
+    uint8_t refs;           ///< Creator reference plus one per queue
+    size_t length;
+    char data[1];           ///< length bytes plus NUL
+};
+
+/**
+ * @brief Send one frame to a client
+ * @return true if the transport accepted the whole frame
+ */
+typedef bool (*WsSendFn)(uint8_t client, const char* data, size_t length, void* context);
+
+/**
+ * @brief Close a client that could not keep up
+ */
+typedef void (*WsDropClientFn)(uint8_t client, void* context);
+
+/**
+ * @brief Millisecond clock used to time sends
+ */
+typedef uint32_t (*WsClockFn)();
+
+/**
+ * @brief Fan-out statistics
+ */
+struct WsFanoutStats {
+    uint32_t frames;        ///< Frames created
+    uint32_t liveFrames;    ///< Frames not yet freed
+    uint32_t sent;          ///< Frames delivered to clients
+    uint32_t coalesced;     ///< Queued snapshots replaced by a newer one
+    uint32_t dropped;       ///< Frames dropped from a full queue
+    uint32_t slowSends;     ///< Sends slower than WS_SLOW_SEND_MS or failed
+    uint32_t disconnects;   ///< Clients dropped for being too slow
+    uint32_t maxServiceMs;  ///< Longest service() call
+};
+
+// ==========================================
+// FAN-OUT
+// ==========================================
+
+/**
+ * @brief Per-client bounded send queues fed from shared frames
+ */
+class WsFanout {
+private:
+    struct ClientQueue {
+        bool connected;
+        uint8_t count;
+        uint8_t strikes;
+        WsFrame* frames[WS_CLIENT_QUEUE_DEPTH];
+    };
+
+    ClientQueue m_clients[WS_FANOUT_MAX_CLIENTS];
+    uint8_t m_nextClient;
+    portMUX_TYPE m_mux;
+
+    WsSendFn m_send;
+    WsDropClientFn m_drop;
+    void* m_context;
+    WsClockFn m_clock;
+    WsFanoutStats m_stats;
+
+    /**
+     * @brief Put a frame in a client queue (caller holds m_mux)
+     * @return Frame pushed out of the queue, to be released by the caller
+     */
+    WsFrame* enqueueLocked(ClientQueue& queue, WsFrame* frame);
+
+    /**
+     * @brief Drop one reference; frees the frame on the last one
+     */
+    void release(WsFrame* frame);
+
+    /**
+     * @brief Empty a queue and mark the client gone
+     */
+    void clearClient(uint8_t client);
+
+public:
+    WsFanout();
+
+    /**
+     * @brief Set the transport used by service()
+     */
+    void setTransport(WsSendFn send, WsDropClientFn drop, void* context) {
+        m_send = send;
+        m_drop = drop;
+        m_context = context;
+    }
+
+    void setClock(WsClockFn clock) { m_clock = clock; }
+
+    /**
+     * @brief Allocate a frame of @p length bytes for the caller to fill
+     * @return Frame holding one reference, or nullptr if out of memory
+     */
+    WsFrame* createFrame(WsFrameKind kind, size_t length);
+
+    /**
+     * @brief Allocate a frame holding a copy of @p data
+     */
+    WsFrame* createFrame(WsFrameKind kind, const char* data, size_t length);
+
+    /**
+     * @brief Queue a frame for every connected client (takes the caller's reference)
+     */
+    void broadcast(WsFrame* frame);
+
+    /**
+     * @brief Queue a frame for the clients in @p clientMask (takes the caller's reference)
+     * @param clientMask Bit n set for client n
+     */
+    void multicast(uint8_t clientMask, WsFrame* frame);
+
+    /**
+     * @brief Queue a frame for one client (takes the caller's reference)
+     */
+    void send(uint8_t client, WsFrame* frame);
+
+    void onConnect(uint8_t client);
+    void onDisconnect(uint8_t client);
+
+    /**
+     * @brief Send queued frames until the queues are empty or WS_SEND_BUDGET_MS passes
+     * @return Number of frames sent
+     */
+    uint16_t service();
+
+    uint8_t getClientCount() const;
+
+    /**
+     * @brief Connected clients as a bit mask (bit n = client n)
+     */
+    uint8_t getClientMask() const;
+    uint8_t getQueuedCount(uint8_t client) const;
+    uint8_t getStrikes(uint8_t client) const;
+    const WsFanoutStats& getStats() const { return m_stats; }
+};
+
+/**
+ * @brief Run fan-out self-tests with a simulated transport
+ * @return true if all tests passed
+ */
+bool runWsFanoutTests();
+
+#endif // WS_FANOUT_H
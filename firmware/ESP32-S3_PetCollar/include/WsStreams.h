@@ -0,0 +1,192 @@
+#ifndef WS_STREAMS_H
+#define WS_STREAMS_H
+
+/**
+ * @file WsStreams.h
+ * @brief Subscribed live beacon/position feed for WebSocket clients
+ * @version 1.0.0
+ * @date 2024
+ *
+ * Instead of polling get_beacons/get_status, a client sends
+ *   {"command":"subscribe","streams":{"distance":500,"position":1000,"alerts":0}}
+ * where each value is the minimum interval in milliseconds between frames of
+ * that stream. The collar then pushes compact frames only for those streams:
+ *   {"t":"rssi","b":[["Kitchen",-67,-65]]}      name, raw dBm, smoothed dBm
+ *   {"t":"dist","b":[["Kitchen",123,82]]}       name, distance cm, confidence %
+ *   {"t":"pos","fix":true,"x":120,"y":340,"c":80,"a":50}   cm, %, accuracy cm
+ *   {"t":"zone","from":"none","to":"yard"}
+ *   {"t":"alert","b":"Kitchen","d":45,"m":"buzzer"}
+ *   {"t":"perf","w":12000,"s":[["mqtt",1180,21.3,310.5,840.2]]}
+ *                            window ms; stage, count, p50/p99/max us
+ *
+ * Beacon frames are deltas: only beacons updated since the client's last
+ * frame of that stream. Every WS_STREAM_KEYFRAME_MS (and right after
+ * subscribing) a frame carries the full state with "k":1, so a client that
+ * lost a frame to a full send queue catches up. An interval of 0 on rssi or
+ * distance pushes every packet (calibration); such frames are built once and
+ * shared by all per-packet subscribers. Alerts are events and are always
+ * pushed immediately. Loop timing (perf) is a snapshot of the current
+ * LoopProfiler window, sent at most every PERF_STREAM_MIN_INTERVAL_MS.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "ESP32_S3_Config.h"
+#include "WsFanout.h"
+#include "LoopProfiler.h"
+
+/**
+ * @brief Streams a client can subscribe to
+ */
+enum class WsStream : uint8_t {
+    RSSI = 0,               ///< Raw and smoothed RSSI per beacon
+    DISTANCE,               ///< Filtered distance and confidence per beacon
+    POSITION,               ///< Triangulated collar position
+    ZONE,                   ///< Zone transitions
+    ALERTS,                 ///< Proximity alerts
+    PERF,                   ///< Loop timing per stage
+    COUNT
+};
+
+#define WS_STREAM_BIT(stream) (1 << (uint8_t)(stream))
+
+/**
+ * @brief Latest values of one beacon
+ */
+struct WsStreamBeacon {
+    char name[WS_STREAM_NAME_LENGTH];
+    int16_t rawRssi;
+    int16_t smoothedRssi;
+    float distance;
+    float confidence;
+    uint32_t sequence;      ///< Hub update counter at the last update (0 = empty slot)
+};
+
+/**
+ * @brief Stream statistics
+ */
+struct WsStreamStats {
+    uint32_t deltaFrames;   ///< Rate-limited delta frames sent
+    uint32_t keyframes;     ///< Full-state frames sent
+    uint32_t packetFrames;  ///< Per-packet frames (shared by all per-packet subscribers)
+    uint32_t eventFrames;   ///< Alert frames
+};
+
+/**
+ * @brief Tracks subscriptions and pushes stream frames through WsFanout
+ */
+class WsStreamHub {
+private:
+    struct Subscriber {
+        uint8_t streams;                                ///< WS_STREAM_BIT mask
+        uint16_t intervalMs[(uint8_t)WsStream::COUNT];
+        uint32_t lastSentMs[(uint8_t)WsStream::COUNT];
+        uint32_t sentSequence[(uint8_t)WsStream::COUNT];
+        uint32_t lastKeyframeMs;
+        bool keyframeDue;
+    };
+
+    WsFanout& m_fanout;
+    portMUX_TYPE m_mux;
+    uint32_t m_sequence;
+
+    WsStreamBeacon m_beacons[WS_STREAM_MAX_BEACONS];
+
+    bool m_hasPosition;
+    float m_posX;
+    float m_posY;
+    float m_posConfidence;
+    float m_posAccuracy;
+    uint32_t m_positionSequence;
+
+    char m_zone[WS_STREAM_NAME_LENGTH];
+    char m_previousZone[WS_STREAM_NAME_LENGTH];
+    uint32_t m_zoneSequence;
+
+    Subscriber m_subscribers[WS_FANOUT_MAX_CLIENTS];
+    WsStreamStats m_stats;
+    const LoopProfiler* m_profiler;     ///< Source of perf frames (none = no frames)
+
+    /**
+     * @brief Clients subscribed to @p stream with interval 0 (caller holds m_mux)
+     */
+    uint8_t perPacketMaskLocked(WsStream stream) const;
+
+    /**
+     * @brief Build and queue one client's due frame for a stream
+     */
+    void sendStreamFrame(uint8_t client, WsStream stream, bool keyframe, uint32_t nowMs);
+
+    /**
+     * @brief Serialize @p doc once and queue it for @p clientMask
+     */
+    void queueDocument(uint8_t clientMask, const JsonDocument& doc);
+
+public:
+    explicit WsStreamHub(WsFanout& fanout);
+
+    /**
+     * @brief Replace a client's subscriptions
+     * @param client WebSocket client number
+     * @param streams WS_STREAM_BIT mask (0 = unsubscribe)
+     * @param intervalMs Minimum interval per stream, indexed by WsStream
+     */
+    void subscribe(uint8_t client, uint8_t streams, const uint16_t* intervalMs);
+
+    void unsubscribe(uint8_t client) { subscribe(client, 0, nullptr); }
+
+    /**
+     * @brief Clients with at least one subscription, as a bit mask
+     */
+    uint8_t getSubscriberMask() const;
+
+    uint8_t getStreams(uint8_t client) const {
+        return client < WS_FANOUT_MAX_CLIENTS ? m_subscribers[client].streams : 0;
+    }
+
+    /**
+     * @brief Record a processed BLE packet (safe from the BLE task)
+     */
+    void updateBeacon(const char* name, int16_t rawRssi, int16_t smoothedRssi,
+                      float distance, float confidence);
+
+    void updatePosition(bool hasFix, float x, float y, float confidence, float accuracy);
+    void updateZone(const char* zone);
+
+    /**
+     * @brief Push an alert to subscribers of the alerts stream
+     */
+    void publishAlert(const char* beaconName, float distance, const char* alertMode);
+
+    /**
+     * @brief Profiler whose histograms the perf stream reports
+     */
+    void setProfiler(const LoopProfiler* profiler) { m_profiler = profiler; }
+
+    /**
+     * @brief Send rate-limited frames that are due
+     * @param nowMs Current time in milliseconds
+     */
+    void poll(uint32_t nowMs);
+
+    const WsStreamStats& getStats() const { return m_stats; }
+};
+
+/**
+ * @brief Stream name used by the subscribe command
+ */
+const char* wsStreamToString(WsStream stream);
+
+/**
+ * @brief Parse a stream name
+ * @return WsStream::COUNT if unknown
+ */
+WsStream wsStreamFromString(const char* name);
+
+/**
+ * @brief Run stream subscription self-tests
+ * @return true if all tests passed
+ */
+bool runWsStreamTests();
+
+#endif // WS_STREAMS_H
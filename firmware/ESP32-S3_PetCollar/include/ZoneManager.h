@@ -591,6 +591,12 @@ public:
     void initialize();
     size_t getZoneCount() const;
     String getCurrentZone() const;
+
+    /**
+     * @brief Copy the current zone name without building a String
+     * @return Length of the full name (strlcpy semantics)
+     */
+    size_t getCurrentZone(char* name, size_t size) const;
     size_t getBreachCount() const;
     String getStatusJson() const;
 };
@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "micro_config.h"
+#include "AlertPatternEngine.h"
 
 // Alert modes are already defined in micro_config.h
 
@@ -19,13 +20,30 @@ private:
     int buzzerPin;
     int vibrationPin;
     
-    // Alert pattern state
-    int patternState;
+    // Pulse pattern playback (timer-driven, independent of loop cadence)
+    AlertPatternEngine patternEngine;
     
     // Buzzer control
     int buzzerFrequency;     // Current buzzer frequency in Hz
     int buzzerVolume;        // Current buzzer volume (0-255)
     int vibrationIntensity;  // Current vibration intensity (0-255)
+    
+    // Compile the 500ms on/off pulse for the current mode and play the
+    // remainder of the 5 second alert window
+    void playPulsePattern() {
+        bool buzzer = (mode == ALERT_BUZZER || mode == ALERT_BOTH);
+        bool vibration = (mode == ALERT_VIBRATION || mode == ALERT_BOTH);
+        
+        const PatternStep pulse[] = {
+            {500, (uint16_t)buzzerFrequency, (uint8_t)(buzzer ? buzzerVolume : 0),
+                  (uint8_t)(vibration ? vibrationIntensity : 0)},
+            {500, (uint16_t)buzzerFrequency, 0, 0}
+        };
+        
+        unsigned long elapsed = millis() - alertStartTime;
+        uint8_t repeats = elapsed < 5000 ? (5000 - elapsed + 999) / 1000 : 1;
+        patternEngine.play(pulse, 2, repeats);
+    }
 
 public:
     AlertManager() : 
@@ -36,67 +54,34 @@ public:
         lastUpdateTime(0),
         buzzerPin(BUZZER_PIN),
         vibrationPin(VIBRATION_PIN),
-        patternState(0),
         buzzerFrequency(BUZZER_FREQ),
         buzzerVolume(128),              // Default to 50% volume
         vibrationIntensity(128) {}      // Default to 50% intensity
     
     // Initialize alert system
     bool begin() {
-        // Setup buzzer PWM using Arduino ESP32 core API (new style)
-        ledcAttach(buzzerPin, buzzerFrequency, BUZZER_RESOLUTION);
-        
-        // Setup vibration PWM using Arduino ESP32 core API (new style)
-        ledcAttach(vibrationPin, VIBRATION_FREQ, VIBRATION_RESOLUTION);
-        
-        // Start with everything off
-        ledcWrite(buzzerPin, 0);
-        ledcWrite(vibrationPin, 0);
+        // Attach buzzer and vibration PWM and create the pattern timer
+        if (!patternEngine.begin(buzzerPin, vibrationPin, buzzerFrequency,
+                                 VIBRATION_FREQ, BUZZER_RESOLUTION)) {
+            DEBUG_PRINTLN("Alert manager: pattern engine init failed");
+            return false;
+        }
         
         initialized = true;
         DEBUG_PRINTLN("Alert manager initialized");
         return true;
     }
     
-    // Main update loop
+    // Main update loop - pulse timing runs on the engine timer
     void loop() {
         if (!initialized || !alertActive) {
             return;
         }
         
-        // Update alert pattern
-        unsigned long currentTime = millis();
-        
-        // Pulse the alerts every 500ms when active
-        if (currentTime - lastUpdateTime > 500) {
-            lastUpdateTime = currentTime;
-            patternState = !patternState;
-            
-            // Update outputs based on mode
-            if (mode == ALERT_BUZZER || mode == ALERT_BOTH) {
-                // Update frequency and volume
-                ledcChangeFrequency(buzzerPin, buzzerFrequency, BUZZER_RESOLUTION);
-                
-                // Then set volume via duty cycle
-                if (patternState) {
-                    ledcWrite(buzzerPin, buzzerVolume);
-                } else {
-                    ledcWrite(buzzerPin, 0);
-                }
-            }
-            
-            if (mode == ALERT_VIBRATION || mode == ALERT_BOTH) {
-                if (patternState) {
-                    ledcWrite(vibrationPin, vibrationIntensity);
-                } else {
-                    ledcWrite(vibrationPin, 0);
-                }
-            }
-        }
-        
-        // Auto-stop alerts after 5 seconds to save power
-        if (currentTime - alertStartTime > 5000) {
-            stopAlert();
+        // Pattern ends by itself after 5 seconds to save power
+        if (!patternEngine.isPlaying()) {
+            alertActive = false;
+            alertReason = "";
         }
     }
     
@@ -110,17 +95,7 @@ public:
         alertReason = reason;
         alertStartTime = millis();
         lastUpdateTime = alertStartTime;
-        patternState = 1;
-        
-        // Initial state of outputs
-        if (mode == ALERT_BUZZER || mode == ALERT_BOTH) {
-            ledcChangeFrequency(buzzerPin, buzzerFrequency, BUZZER_RESOLUTION);
-            ledcWrite(buzzerPin, buzzerVolume);
-        }
-        
-        if (mode == ALERT_VIBRATION || mode == ALERT_BOTH) {
-            ledcWrite(vibrationPin, vibrationIntensity);
-        }
+        playPulsePattern();
     }
     
     // Stop any active alert
@@ -129,8 +104,7 @@ public:
         alertReason = "";
         
         // Turn off all outputs
-        ledcWrite(buzzerPin, 0);
-        ledcWrite(vibrationPin, 0);
+        patternEngine.stop();
     }
     
     // Set the alert mode
@@ -169,7 +143,7 @@ public:
         
         // Update frequency if alert is active
         if (alertActive && (mode == ALERT_BUZZER || mode == ALERT_BOTH)) {
-            ledcChangeFrequency(buzzerPin, buzzerFrequency, BUZZER_RESOLUTION);
+            playPulsePattern();
         }
     }
     
@@ -184,8 +158,8 @@ public:
         buzzerVolume = constrain(volume, 0, 255);
         
         // Update volume if alert is active
-        if (alertActive && (mode == ALERT_BUZZER || mode == ALERT_BOTH) && patternState) {
-            ledcWrite(buzzerPin, buzzerVolume);
+        if (alertActive && (mode == ALERT_BUZZER || mode == ALERT_BOTH)) {
+            playPulsePattern();
         }
     }
     
@@ -200,8 +174,8 @@ public:
         vibrationIntensity = constrain(intensity, 0, 255);
         
         // Update intensity if alert is active
-        if (alertActive && (mode == ALERT_VIBRATION || mode == ALERT_BOTH) && patternState) {
-            ledcWrite(vibrationPin, vibrationIntensity);
+        if (alertActive && (mode == ALERT_VIBRATION || mode == ALERT_BOTH)) {
+            playPulsePattern();
         }
     }
     
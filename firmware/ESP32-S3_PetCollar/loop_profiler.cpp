@@ -0,0 +1,211 @@
+/**
+ * @file loop_profiler.cpp
+ * @brief Log-scale latency histograms for loop() stages
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/LoopProfiler.h"
+
+#include <math.h>
+
+static const char* const STAGE_NAMES[] = {
+    "loop", "serial", "web", "mqtt", "roaming", "proximity", "settings",
+    "ble_scan", "display", "alerts", "maintenance", "status", "ble_callback"
+};
+
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == (size_t)PerfStage::COUNT,
+              "One name per stage");
+
+// Reports carry microseconds to 0.1 us; computed in double so they print short
+static double roundTenth(float value) {
+    return round(value * 10.0) / 10.0;
+}
+
+// ==================== HISTOGRAM ====================
+
+void PerfHistogram::reset() {
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_count = 0;
+    m_max = 0;
+}
+
+uint32_t PerfHistogram::bucketLimit(uint16_t bucket) {
+    if (bucket == 0) {
+        return PERF_HISTOGRAM_MIN_CYCLES - 1;
+    }
+    uint8_t msb = PERF_HISTOGRAM_MIN_SHIFT + ((bucket - 1) >> PERF_HISTOGRAM_SUB_BITS);
+    uint32_t sub = (bucket - 1) & ((1 << PERF_HISTOGRAM_SUB_BITS) - 1);
+    uint8_t shift = msb - PERF_HISTOGRAM_SUB_BITS;
+    // Wraps to 0 past the top bucket, so the last limit comes out as UINT32_MAX
+    return (((1UL << PERF_HISTOGRAM_SUB_BITS) + sub + 1) << shift) - 1;
+}
+
+uint32_t PerfHistogram::percentile(uint16_t permille) const {
+    uint32_t count = m_count;
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t target = (uint32_t)(((uint64_t)count * permille + 999) / 1000);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint32_t seen = 0;
+    for (uint16_t bucket = 0; bucket < PERF_HISTOGRAM_BUCKETS; bucket++) {
+        seen += m_buckets[bucket];
+        if (seen >= target) {
+            uint32_t limit = bucketLimit(bucket);
+            return limit < m_max ? limit : m_max;
+        }
+    }
+    return m_max;   // Samples recorded while we were reading
+}
+
+// ==================== PROFILER ====================
+
+LoopProfiler::LoopProfiler() :
+    m_cyclesPerUs(240),
+    m_windowStartMs(0) {}
+
+void LoopProfiler::begin(uint32_t cpuMHz, uint32_t nowMs) {
+    m_cyclesPerUs = cpuMHz > 0 ? cpuMHz : 1;
+    reset(nowMs);
+}
+
+PerfSummary LoopProfiler::summarize(PerfStage stage) const {
+    const PerfHistogram& histogram = m_stages[(uint8_t)stage];
+    PerfSummary summary;
+    summary.count = histogram.getCount();
+    summary.p50Us = cyclesToUs(histogram.percentile(500));
+    summary.p99Us = cyclesToUs(histogram.percentile(990));
+    summary.maxUs = cyclesToUs(histogram.getMax());
+    return summary;
+}
+
+void LoopProfiler::reset(uint32_t nowMs) {
+    for (PerfHistogram& histogram : m_stages) {
+        histogram.reset();
+    }
+    m_windowStartMs = nowMs;
+}
+
+void LoopProfiler::writeJson(JsonArray stages) const {
+    for (uint8_t i = 0; i < (uint8_t)PerfStage::COUNT; i++) {
+        PerfSummary summary = summarize((PerfStage)i);
+        if (summary.count == 0) {
+            continue;
+        }
+        JsonArray entry = stages.createNestedArray();
+        entry.add(STAGE_NAMES[i]);
+        entry.add(summary.count);
+        entry.add(roundTenth(summary.p50Us));
+        entry.add(roundTenth(summary.p99Us));
+        entry.add(roundTenth(summary.maxUs));
+    }
+}
+
+const char* perfStageToString(PerfStage stage) {
+    return stage < PerfStage::COUNT ? STAGE_NAMES[(uint8_t)stage] : "unknown";
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+/**
+ * @brief Every value lands in a bucket whose range holds it and is at most 25% wide
+ */
+bool testBuckets() {
+    Serial.println("📊 Test 1: Log-scale bucket boundaries");
+
+    bool passed = PerfHistogram::bucketOf(0) == 0 &&
+                  PerfHistogram::bucketOf(PERF_HISTOGRAM_MIN_CYCLES - 1) == 0 &&
+                  PerfHistogram::bucketOf(PERF_HISTOGRAM_MIN_CYCLES) == 1 &&
+                  PerfHistogram::bucketOf(UINT32_MAX) == PERF_HISTOGRAM_BUCKETS - 1 &&
+                  PerfHistogram::bucketLimit(PERF_HISTOGRAM_BUCKETS - 1) == UINT32_MAX;
+
+    uint32_t checked = 0;
+    for (uint32_t value = PERF_HISTOGRAM_MIN_CYCLES; value < 0x80000000UL && passed;
+         value += value / 7 + 1) {
+        uint16_t bucket = PerfHistogram::bucketOf(value);
+        uint32_t limit = PerfHistogram::bucketLimit(bucket);
+        uint32_t below = PerfHistogram::bucketLimit(bucket - 1);
+        passed = limit >= value && below < value && limit - value <= value / 4;
+        checked++;
+    }
+
+    Serial.printf("   %u buckets, %lu values checked\n", PERF_HISTOGRAM_BUCKETS, (unsigned long)checked);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief p50/p99 of a known distribution, and a rare spike shows in p99 and max only
+ */
+bool testPercentiles() {
+    Serial.println("📊 Test 2: Percentiles and spikes");
+
+    static PerfHistogram histogram;     // Keep the buckets off the loop stack
+    histogram.reset();
+    for (uint32_t value = 1; value <= 1000; value++) {
+        histogram.record(value * 100);
+    }
+    uint32_t p50 = histogram.percentile(500);
+    uint32_t p99 = histogram.percentile(990);
+    bool passed = p50 >= 50000 && p50 <= 62500 && p99 >= 99000 && p99 <= 100000 &&
+                  histogram.getMax() == 100000 && histogram.getCount() == 1000;
+
+    // 2% of passes stall: invisible in p50, dominant in p99
+    histogram.reset();
+    for (uint32_t i = 0; i < 1000; i++) {
+        histogram.record(i % 50 == 0 ? 2400000 : 4800);
+    }
+    passed = passed && histogram.percentile(500) <= 6000 && histogram.percentile(990) >= 2400000 &&
+             histogram.percentile(0) <= 6000;
+
+    histogram.reset();
+    passed = passed && histogram.percentile(990) == 0;
+
+    Serial.printf("   p50 %lu, p99 %lu cycles for 100..100000\n", (unsigned long)p50, (unsigned long)p99);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A scope around a known delay records it in microseconds
+ */
+bool testScopeTiming() {
+    Serial.println("📊 Test 3: Scoped timer");
+
+    static LoopProfiler profiler;
+    profiler.begin(ESP.getCpuFreqMHz(), millis());
+    for (uint8_t i = 0; i < 5; i++) {
+        PerfScope scope(profiler, PerfStage::SETTINGS);
+        delayMicroseconds(200);
+    }
+    PerfSummary summary = profiler.summarize(PerfStage::SETTINGS);
+    bool passed = summary.count == 5 && summary.maxUs >= 200.0f && summary.maxUs < 400.0f &&
+                  summary.p50Us >= 200.0f && profiler.summarize(PerfStage::LOOP).count == 0;
+
+    profiler.reset(millis());
+    passed = passed && profiler.summarize(PerfStage::SETTINGS).count == 0;
+
+    Serial.printf("   200 us delay measured as p50 %.1f us, max %.1f us\n", summary.p50Us, summary.maxUs);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runLoopProfilerTests() {
+    Serial.println("\n🧪 Running Loop Profiler Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testBuckets();
+    passed &= testPercentiles();
+    passed &= testScopeTiming();
+
+    Serial.printf("\n%s Loop Profiler Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
@@ -3,6 +3,9 @@
 #include "include/AlertManager.h"
 #include "include/WiFiManager.h"
 #include "include/SystemStateManager.h"
+#include "include/LoopProfiler.h"
+#include "include/TraceBuffer.h"
+#include "include/DeferredLog.h"
 #include "include/ZoneManager.h"
 
 // External references to global objects from main .ino file
@@ -130,8 +133,8 @@ void BeaconManager_Enhanced::updateBeacon(const BeaconData& beacon) {
     
     // Debug output showing both raw and filtered values  
     if (DEBUG_DISTANCE && filter.hasEnoughSamples()) {
-        Serial.printf("🔍 Beacon %s: Raw RSSI=%d, Filtered=%d, Distance=%.2f cm\n", 
-                     beacon.name.c_str(), beacon.rssi, filteredRSSI, filteredBeacon.distance);
+        LOGD("🔍 Beacon %s: Raw RSSI=%d, Filtered=%d, Distance=%.2f cm",
+             beacon.name.c_str(), beacon.rssi, filteredRSSI, filteredBeacon.distance);
     }
     
     // Update or add beacon to active list
@@ -148,11 +151,8 @@ void BeaconManager_Enhanced::updateBeacon(const BeaconData& beacon) {
         activeBeacons.push_back(filteredBeacon);
     }
     
-    // Only log when we have enough samples for stable readings
-    if (filter.hasEnoughSamples()) {
-        Serial.printf("🔍 Updated beacon: %s, RSSI: %d dBm, Distance: %.2f cm\n", 
-                     filteredBeacon.name.c_str(), filteredBeacon.rssi, filteredBeacon.distance);
-    }
+    // Runs for every advertisement: trace instead of printing (trace command)
+    TRACE(BEACON_UPDATE, traceNameHash(filteredBeacon.name.c_str()), filteredRSSI);
 }
 
 float BeaconManager_Enhanced::calculateDistance(int rssi) const {
@@ -220,14 +220,14 @@ BeaconConfig* BeaconManager_Enhanced::getBeaconConfig(const String& address) {
             tempConfig.alertActive = proximityConfig.alertActive;
             tempConfig.lastAlertTime = proximityConfig.lastTriggered;
             
-            Serial.printf("✅ Found proximity config for: %s (trigger: %dcm)\n", 
-                         address.c_str(), proximityConfig.triggerDistance);
+            LOGV("✅ Found proximity config for: %s (trigger: %dcm)",
+                 address.c_str(), proximityConfig.triggerDistance);
             
             return &tempConfig;
         }
     }
     
-    Serial.printf("⚠️ No configuration found for beacon: %s\n", address.c_str());
+    LOGV("⚠️ No configuration found for beacon: %s", address.c_str());
     return nullptr;
 }
 
@@ -333,6 +333,17 @@ void BeaconManager_Enhanced::configureProximityBeacon(
                  enableProximityDelay ? String(proximityDelayTime + "ms").c_str() : "none");
 }
 
+bool BeaconManager_Enhanced::removeProximityBeacon(const String& beaconId) {
+    for (auto it = proximityConfigs.begin(); it != proximityConfigs.end(); ++it) {
+        if (it->beaconId == beaconId) {
+            Serial.printf("🗑️ Removed proximity beacon: %s\n", it->beaconName.c_str());
+            proximityConfigs.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
 void BeaconManager_Enhanced::clearProximityConfigurations() {
     proximityConfigs.clear();
     Serial.println("🗑️ Cleared all proximity beacon configurations");
@@ -374,16 +385,18 @@ void BeaconManager_Enhanced::processProximityTriggers() {
             config.inProximityRange = true;
             config.proximityStartTime = currentTime;
             
-            Serial.printf("📍 Entered proximity range for '%s' at %.1fcm (trigger: %dcm)\n",
-                         config.beaconName.c_str(), currentDistance, config.triggerDistance);
+            LOGI("📍 Entered proximity range for '%s' at %.1fcm (trigger: %dcm)",
+                 config.beaconName.c_str(), currentDistance, config.triggerDistance);
+            TRACE(PROXIMITY_ENTER, traceNameHash(config.beaconName.c_str()), currentDistance);
             
         } else if (!beaconInRange && config.inProximityRange) {
             // Exiting proximity range
             config.inProximityRange = false;
             config.proximityStartTime = 0;
             
-            Serial.printf("📍 Exited proximity range for '%s' (%.1fcm)\n",
-                         config.beaconName.c_str(), currentDistance);
+            LOGI("📍 Exited proximity range for '%s' (%.1fcm)",
+                 config.beaconName.c_str(), currentDistance);
+            TRACE(PROXIMITY_EXIT, traceNameHash(config.beaconName.c_str()), currentDistance);
         }
         
         // Check if alert should be triggered
@@ -421,8 +434,8 @@ void BeaconManager_Enhanced::processProximityTriggers() {
             }
             
             // Trigger alert with exact transmitter settings
-            Serial.printf("🚨 PROXIMITY ALERT: '%s' triggered at %.1fcm (configured: %dcm)\n",
-                         config.beaconName.c_str(), currentDistance, config.triggerDistance);
+            LOGI("🚨 PROXIMITY ALERT: '%s' triggered at %.1fcm (configured: %dcm)",
+                 config.beaconName.c_str(), currentDistance, config.triggerDistance);
             
             // Start alert with configured duration and intensity
             alertManager.startAlert(AlertReason::PROXIMITY_TRIGGER, mode);
@@ -438,25 +451,149 @@ void BeaconManager_Enhanced::processProximityTriggers() {
     }
 }
 
+// ==================== ALERT PATTERN COMPILATION ====================
+
+/**
+ * @brief Pattern shape step: level and pitch relative to the caller's settings
+ */
+struct AlertShapeStep {
+    uint16_t durationMs;
+    uint8_t levelPercent;   ///< Output level as % of requested volume/intensity
+    uint8_t pitchPercent;   ///< Buzzer frequency as % of requested frequency
+};
+
+static const AlertShapeStep SHAPE_CONTINUOUS[] = {
+    {1000, 100, 100}
+};
+
+static const AlertShapeStep SHAPE_PULSE_SLOW[] = {
+    {500, 100, 100}, {500, 0, 100}
+};
+
+static const AlertShapeStep SHAPE_PULSE_FAST[] = {
+    {125, 100, 100}, {125, 0, 100}
+};
+
+static const AlertShapeStep SHAPE_TRIPLE_BEEP[] = {
+    {150, 100, 100}, {100, 0, 100},
+    {150, 100, 100}, {100, 0, 100},
+    {150, 100, 100}, {600, 0, 100}
+};
+
+// S (dot 150ms) - O (dash 450ms) - S, standard morse gaps
+static const AlertShapeStep SHAPE_SOS[] = {
+    {150, 100, 100}, {150, 0, 100}, {150, 100, 100}, {150, 0, 100}, {150, 100, 100}, {450, 0, 100},
+    {450, 100, 100}, {150, 0, 100}, {450, 100, 100}, {150, 0, 100}, {450, 100, 100}, {450, 0, 100},
+    {150, 100, 100}, {150, 0, 100}, {150, 100, 100}, {150, 0, 100}, {150, 100, 100}, {1050, 0, 100}
+};
+
+static const AlertShapeStep SHAPE_ESCALATING[] = {
+    {400, 25, 75},  {100, 0, 75},
+    {400, 50, 90},  {100, 0, 90},
+    {400, 75, 110}, {100, 0, 110},
+    {400, 100, 125}, {100, 0, 125}
+};
+
+#define ALERT_SHAPE(table) table, (uint8_t)(sizeof(table) / sizeof(table[0]))
+
+// Waveform library (alert_waveforms.cpp) is indexed by AlertPattern
+static_assert(WAVEFORM_PATTERN_COUNT == (int)AlertPattern::CUSTOM,
+              "Every predefined AlertPattern needs a buzzer waveform");
+
+uint8_t compileAlertPattern(AlertPattern pattern, AlertMode mode, uint8_t volume,
+                            uint8_t intensity, uint16_t frequency,
+                            PatternStep* out, uint8_t maxSteps) {
+    const AlertShapeStep* shape = nullptr;
+    uint8_t shapeSteps = 0;
+    
+    switch (pattern) {
+        case AlertPattern::CONTINUOUS:  shape = ALERT_SHAPE(SHAPE_CONTINUOUS); break;
+        case AlertPattern::PULSE_SLOW:  shape = ALERT_SHAPE(SHAPE_PULSE_SLOW); break;
+        case AlertPattern::PULSE_FAST:  shape = ALERT_SHAPE(SHAPE_PULSE_FAST); break;
+        case AlertPattern::TRIPLE_BEEP: shape = ALERT_SHAPE(SHAPE_TRIPLE_BEEP); break;
+        case AlertPattern::SOS_PATTERN: shape = ALERT_SHAPE(SHAPE_SOS); break;
+        case AlertPattern::ESCALATING:  shape = ALERT_SHAPE(SHAPE_ESCALATING); break;
+        default: return 0;
+    }
+    
+    if (mode == AlertMode::NONE || shapeSteps > maxSteps) {
+        return 0;
+    }
+    
+    bool buzzer = (mode == AlertMode::BUZZER || mode == AlertMode::BOTH);
+    bool vibration = (mode == AlertMode::VIBRATION || mode == AlertMode::BOTH);
+    
+    for (uint8_t i = 0; i < shapeSteps; i++) {
+        out[i].durationMs = shape[i].durationMs;
+        out[i].buzzerFreq = (uint32_t)frequency * shape[i].pitchPercent / 100;
+        out[i].buzzerDuty = buzzer ? (uint32_t)volume * shape[i].levelPercent / 100 : 0;
+        out[i].vibrationDuty = vibration ? (uint32_t)intensity * shape[i].levelPercent / 100 : 0;
+    }
+    return shapeSteps;
+}
+
+uint8_t compileAlertSequence(const AlertSequence& sequence, AlertMode mode,
+                             PatternStep* out, uint8_t maxSteps) {
+    if (mode == AlertMode::NONE || sequence.stepCount > maxSteps) {
+        return 0;
+    }
+    
+    bool buzzer = (mode == AlertMode::BUZZER || mode == AlertMode::BOTH);
+    bool vibration = (mode == AlertMode::VIBRATION || mode == AlertMode::BOTH);
+    uint8_t count = 0;
+    
+    for (uint8_t i = 0; i < sequence.stepCount; i++) {
+        const AlertStep& step = sequence.steps[i];
+        if (step.durationMs == 0) continue;
+        
+        out[count].durationMs = step.durationMs;
+        out[count].buzzerFreq = step.buzzerFreq;
+        out[count].buzzerDuty = buzzer ? step.buzzerVolume : 0;
+        out[count].vibrationDuty = vibration ? step.vibrationIntensity : 0;
+        count++;
+    }
+    return count;
+}
+
+uint8_t alertRepeatsForDuration(const PatternStep* steps, uint8_t count, uint32_t durationMs) {
+    uint32_t cycleMs = AlertPatternEngine::cycleDurationMs(steps, count);
+    if (cycleMs == 0) return 1;
+    
+    uint32_t repeats = (durationMs + cycleMs - 1) / cycleMs;
+    return (uint8_t)constrain(repeats, 1UL, 255UL);
+}
+
 // ==================== ENHANCED ALERT MANAGER IMPLEMENTATIONS ====================
 
+/**
+ * @brief Map proximity-config intensity (1-5) or raw duty (6-255) to a duty
+ */
+static uint8_t intensityToDuty(uint8_t intensity) {
+    if (intensity == 0) return 0;
+    if (intensity <= 5) return intensity * 51;
+    return intensity;
+}
+
 // Constructor
 AlertManager_Enhanced::AlertManager_Enhanced(uint8_t buzzerPin, uint8_t vibrationPin) 
-    : buzzerPin(buzzerPin), vibrationPin(vibrationPin), alertActive(false) {
-    // Constructor implementation
+    : buzzerPin(buzzerPin), vibrationPin(vibrationPin), alertActive(false), waveformBuzzer(false) {
+    arbiter.setHooks(&AlertManager_Enhanced::arbiterStart, &AlertManager_Enhanced::arbiterStop, this);
 }
 
 bool AlertManager_Enhanced::update() {
-    // Update alert states, handle timeouts, etc.
+    // Step timing lives in the engine timer; the arbiter starts the next
+    // queued alert once the current pattern has finished
+    arbiter.update(millis(), !outputsPlaying());
+    alertActive = arbiter.hasActive();
     return alertActive;
 }
 
 bool AlertManager_Enhanced::stopAlert(bool force) {
-    if (alertActive || force) {
-        alertActive = false;
-        digitalWrite(buzzerPin, LOW);
-        digitalWrite(vibrationPin, LOW);
-        Serial.println("🛑 Enhanced alert stopped");
+    bool hadAlerts = arbiter.clear();
+    alertActive = false;
+    
+    if (hadAlerts || force) {
+        LOGI("🛑 Enhanced alert stopped");
         return true;
     }
     return false;
@@ -466,40 +603,168 @@ bool AlertManager_Enhanced::isAlertActive() const {
     return alertActive;
 }
 
+bool AlertManager_Enhanced::outputsPlaying() const {
+#if FEATURE_BUZZER_WAVEFORM
+    if (audioPlayer.isPlaying()) {
+        return true;
+    }
+#endif
+    return patternEngine.isPlaying();
+}
+
 bool AlertManager_Enhanced::initialize() {
-    pinMode(buzzerPin, OUTPUT);
-    pinMode(vibrationPin, OUTPUT);
-    digitalWrite(buzzerPin, LOW);
-    digitalWrite(vibrationPin, LOW);
-    Serial.println("🚨 Enhanced AlertManager initialized");
+#if FEATURE_BUZZER_WAVEFORM
+    // The buzzer pin belongs to I2S; fall back to LEDC if PDM is unavailable
+    waveformBuzzer = audioPlayer.begin(buzzerPin);
+#endif
+    
+    uint8_t enginePin = waveformBuzzer ? ALERT_ENGINE_NO_PIN : buzzerPin;
+    if (!patternEngine.begin(enginePin, vibrationPin, BUZZER_PWM_FREQUENCY_HZ,
+                             VIBRATION_PWM_FREQUENCY_HZ, BUZZER_PWM_RESOLUTION_BITS)) {
+        Serial.println("❌ Enhanced AlertManager: pattern engine unavailable");
+        return false;
+    }
+    Serial.printf("🚨 Enhanced AlertManager initialized (buzzer: %s)\n",
+                 waveformBuzzer ? "I2S waveform" : "LEDC");
     return true;
 }
 
-bool AlertManager_Enhanced::triggerAlert(const AlertConfig& config) {
-    alertActive = true;
+bool AlertManager_Enhanced::playPattern(AlertPattern pattern, AlertMode mode, uint8_t intensity,
+                                        uint32_t durationMs, uint16_t frequency) {
+    PatternStep steps[ALERT_ENGINE_MAX_STEPS];
+    uint8_t duty = intensityToDuty(intensity);
+    uint16_t baseFrequency = frequency ? frequency : BUZZER_PWM_FREQUENCY_HZ;
+    bool buzzer = (mode == AlertMode::BUZZER || mode == AlertMode::BOTH);
+    bool vibration = (mode == AlertMode::VIBRATION || mode == AlertMode::BOTH);
+    if (!buzzer && !vibration) {
+        return false;
+    }
+    
+    // With the waveform buzzer the engine only drives vibration
+    AlertMode engineMode = mode;
+    if (waveformBuzzer && buzzer) {
+        engineMode = vibration ? AlertMode::VIBRATION : AlertMode::NONE;
+    }
+    
+    uint8_t count = compileAlertPattern(pattern, engineMode, duty, duty, baseFrequency,
+                                        steps, ALERT_ENGINE_MAX_STEPS);
+    if (count == 0 && engineMode != AlertMode::NONE) {
+        return false;
+    }
+    
+    // A single continuous step is simply stretched to the requested duration
+    if (count > 0 && pattern == AlertPattern::CONTINUOUS) {
+        steps[0].durationMs = constrain(durationMs, 1UL, 65535UL);
+    }
+    
+#if FEATURE_BUZZER_WAVEFORM
+    if (waveformBuzzer && buzzer) {
+        const WavePattern* wave = getWavePattern((uint8_t)pattern);
+        bool started;
+        if (!wave || pattern == AlertPattern::CONTINUOUS || frequency != 0) {
+            started = audioPlayer.playTone(baseFrequency, constrain(durationMs, 1UL, 65535UL), duty);
+        } else {
+            uint32_t cycleMs = waveCycleDurationMs(wave);
+            uint8_t passes = constrain((durationMs + cycleMs - 1) / cycleMs, 1UL, 255UL);
+            started = audioPlayer.playPattern(wave, passes, duty);
+        }
+        if (!started) {
+            return false;
+        }
+    } else if (waveformBuzzer) {
+        audioPlayer.stop();
+    }
+#endif
     
-    // Activate outputs based on mode
-    if (config.mode == AlertMode::BUZZER || config.mode == AlertMode::BOTH) {
-        digitalWrite(buzzerPin, HIGH);
+    if (count == 0) {
+        patternEngine.stop();
+        return true;
     }
-    if (config.mode == AlertMode::VIBRATION || config.mode == AlertMode::BOTH) {
-        digitalWrite(vibrationPin, HIGH);
+    
+    uint8_t repeats = alertRepeatsForDuration(steps, count, durationMs);
+    return patternEngine.play(steps, count, repeats);
+}
+
+bool AlertManager_Enhanced::arbiterStart(const AlertRequest& request, void* context) {
+    AlertManager_Enhanced* self = static_cast<AlertManager_Enhanced*>(context);
+    
+    // Replacing the engine pattern in place avoids a silent gap on preemption
+    return self->playPattern(request.pattern, request.mode, request.intensity,
+                             request.durationMs, request.frequency);
+}
+
+void AlertManager_Enhanced::arbiterStop(void* context) {
+    AlertManager_Enhanced* self = static_cast<AlertManager_Enhanced*>(context);
+    self->patternEngine.stop();
+#if FEATURE_BUZZER_WAVEFORM
+    self->audioPlayer.stop();
+#endif
+}
+
+ArbiterDecision AlertManager_Enhanced::submitAlert(const AlertRequest& request) {
+    ArbiterDecision decision = arbiter.submit(request, millis());
+    alertActive = arbiter.hasActive();
+    
+    LOGI("🚦 Alert %s: source=%s, priority=%s, pattern=%s",
+         arbiterDecisionToString(decision), alertSourceToString(request.source),
+         alertPriorityToString(request.priority), alertPatternToString(request.pattern));
+    return decision;
+}
+
+bool AlertManager_Enhanced::triggerAlert(const AlertConfig& config) {
+    AlertRequest request;
+    request.source = alertSourceForReason(config.reason);
+    request.reason = config.reason;
+    request.priority = alertPriorityForReason(config.reason);
+    request.mode = config.mode;
+    request.pattern = AlertPattern::CONTINUOUS;
+    request.intensity = config.intensity;
+    request.durationMs = config.duration;
+    
+    if (submitAlert(request) == ArbiterDecision::DROPPED) {
+        LOGW("❌ Enhanced alert rejected: mode=%d", (int)config.mode);
+        return false;
     }
     
-    Serial.printf("🚨 Enhanced alert triggered: mode=%d, intensity=%d\n", 
-                 (int)config.mode, config.intensity);
+    LOGI("🚨 Enhanced alert triggered: mode=%d, intensity=%d",
+         (int)config.mode, config.intensity);
     return true;
 }
 
 // Add missing startAlert method
 bool AlertManager_Enhanced::startAlert(AlertReason reason, AlertMode mode, int pattern, int priority, const String& customReason) {
-    AlertConfig config;
-    config.mode = mode;
-    config.intensity = 128; // Default intensity
-    config.duration = 5000; // Default 5 seconds
+    AlertRequest request;
+    request.source = alertSourceForReason(reason);
+    request.reason = reason;
+    request.priority = (priority < 0) ? alertPriorityForReason(reason) :
+                       (AlertPriority)constrain(priority, 0, (int)AlertPriority::CRITICAL);
+    request.mode = mode;
+    request.pattern = (pattern >= 0 && pattern < (int)AlertPattern::CUSTOM) ?
+                      (AlertPattern)pattern : AlertPattern::PULSE_SLOW;
+    request.intensity = BUZZER_DEFAULT_VOLUME;
+    request.durationMs = BUZZER_MAX_DURATION_MS;
+    
+    LOGI("🚨 Starting alert: reason=%d, mode=%d, pattern=%s",
+         (int)reason, (int)mode, alertPatternToString(request.pattern));
+    return submitAlert(request) != ArbiterDecision::DROPPED;
+}
+
+bool AlertManager_Enhanced::playTone(uint16_t frequency, uint16_t durationMs, uint8_t volume) {
+    if (durationMs == 0) {
+        return false;
+    }
+    
+    AlertRequest request;
+    request.source = AlertSource::LOCAL;
+    request.reason = AlertReason::MANUAL_TEST;
+    request.priority = AlertPriority::NORMAL;
+    request.mode = AlertMode::BUZZER;
+    request.pattern = AlertPattern::CONTINUOUS;
+    request.intensity = volume;
+    request.frequency = frequency;
+    request.durationMs = durationMs;
     
-    Serial.printf("🚨 Starting alert: reason=%d, mode=%d\n", (int)reason, (int)mode);
-    return triggerAlert(config);
+    return submitAlert(request) != ArbiterDecision::DROPPED;
 }
 
 AlertMode AlertManager_Enhanced::stringToAlertMode(const String& modeStr) {
@@ -531,8 +796,39 @@ void SystemStateManager::initialize() {
     Serial.println("⚙️ Enhanced SystemStateManager initialized");
 }
 
+void SystemStateManager::beginLoop() {
+    m_loopStartTime = perfCycles();
+}
+
+void SystemStateManager::endLoop() {
+    uint32_t cycles = perfCycles() - m_loopStartTime;
+#if FEATURE_LOOP_PROFILING
+    loopProfiler.record(PerfStage::LOOP, cycles);
+#endif
+    
+    uint32_t elapsedUs = (uint32_t)loopProfiler.cyclesToUs(cycles);
+    PerformanceMetrics& performance = m_systemStatus.performance;
+    m_loopCount++;
+    m_totalLoopTime += elapsedUs;
+    performance.loopIterations = m_loopCount;
+    performance.averageLoopTimeUs = (uint32_t)(m_totalLoopTime / m_loopCount);
+    if (elapsedUs > performance.maxLoopTimeUs) {
+        performance.maxLoopTimeUs = elapsedUs;
+    }
+}
+
+void SystemStateManager::resetPerformanceStats() {
+    m_totalLoopTime = 0;
+    m_loopCount = 0;
+    m_systemStatus.performance.loopIterations = 0;
+    m_systemStatus.performance.averageLoopTimeUs = 0;
+    m_systemStatus.performance.maxLoopTimeUs = 0;
+    loopProfiler.reset(millis());
+}
+
 void SystemStateManager::updateSystemMetrics() {
     // Update system metrics
+    m_systemStatus.performance.update();
     systemStateImpl.lastUpdateTime = millis();
 }
 
@@ -589,6 +885,18 @@ String SystemStateManager::getSystemStatusJSON() const {
     return result;
 }
 
+size_t SystemStateManager::getSystemStateJSON(char* buffer, size_t size) const {
+    StaticJsonDocument<192> doc;
+    doc["status"] = "ok";
+    doc["battery"] = systemStateImpl.batteryPercent;
+    doc["errors"] = systemStateImpl.errorCount;
+    doc["proximityAlerts"] = systemStateImpl.proximityAlertCount;
+    doc["beaconsDetected"] = systemStateImpl.totalBeaconsDetected;
+    
+    size_t length = serializeJson(doc, buffer, size);
+    return length < size ? length : 0;
+}
+
 // ==================== ENHANCED ZONE MANAGER IMPLEMENTATIONS ====================
 
 void ZoneManager_Enhanced::initialize() {
@@ -604,6 +912,10 @@ String ZoneManager_Enhanced::getCurrentZone() const {
     return "none"; // Simple implementation
 }
 
+size_t ZoneManager_Enhanced::getCurrentZone(char* name, size_t size) const {
+    return strlcpy(name, "none", size); // Simple implementation
+}
+
 size_t ZoneManager_Enhanced::getBreachCount() const {
     return 0; // Simple implementation
 }
@@ -0,0 +1,475 @@
+/**
+ * @file mqtt_outbox.cpp
+ * @brief Flash/PSRAM ring log with batched, paced MQTT replay (no Arduino dependencies)
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/MqttOutbox.h"
+
+#include <string.h>
+
+// ==================== LOG FORMAT ====================
+//
+// Sector:  [magic "OBX1" | sector sequence] [record] [record] ... [0xFF...]
+// Record:  [header 12 bytes] [topic] [payload] [pad to 4 bytes]
+//
+// The body is written before the header, so a record torn by a reset has
+// no magic byte and is treated as the end of its sector. Retiring a
+// published record clears its state byte in place.
+
+#define OUTBOX_SECTOR_MAGIC         0x3158424FUL   // "OBX1"
+#define OUTBOX_SECTOR_HEADER_SIZE   8
+#define OUTBOX_RECORD_MAGIC         0xA5
+#define OUTBOX_STATE_PENDING        0xFF
+#define OUTBOX_STATE_ACKED          0x00
+#define OUTBOX_RECORD_HEADER_SIZE   12
+
+struct OutboxRecordHeader {
+    uint8_t magic;
+    uint8_t state;
+    uint8_t kind;
+    uint8_t topicLength;
+    uint16_t payloadLength;
+    uint16_t crc;
+    uint32_t sequence;
+};
+
+static_assert(sizeof(OutboxRecordHeader) == OUTBOX_RECORD_HEADER_SIZE, "Outbox record header layout");
+
+static uint32_t recordSize(const OutboxRecordHeader& header) {
+    return (OUTBOX_RECORD_HEADER_SIZE + header.topicLength + header.payloadLength + 3) & ~3UL;
+}
+
+/**
+ * @brief CRC-16/CCITT-FALSE
+ */
+static uint16_t crc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief CRC over a record in m_record layout (everything but magic, state and crc)
+ */
+static uint16_t recordCrc(const uint8_t* record, const OutboxRecordHeader& header) {
+    uint16_t crc = crc16(record + 2, 4);
+    crc = crc16(record + 8, 4, crc);
+    return crc16(record + OUTBOX_RECORD_HEADER_SIZE, header.topicLength + header.payloadLength, crc);
+}
+
+// ==================== RAM STORAGE ====================
+
+RamOutboxStorage::RamOutboxStorage(uint8_t* buffer, size_t size, size_t sectorSize) :
+    m_buffer(buffer),
+    m_size(size),
+    m_sectorSize(sectorSize) {
+}
+
+bool RamOutboxStorage::read(uint32_t offset, void* data, size_t length) {
+    if (!m_buffer || offset + length > m_size) {
+        return false;
+    }
+    memcpy(data, m_buffer + offset, length);
+    return true;
+}
+
+bool RamOutboxStorage::write(uint32_t offset, const void* data, size_t length) {
+    if (!m_buffer || offset + length > m_size) {
+        return false;
+    }
+    // NOR flash can only clear bits
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        m_buffer[offset + i] &= bytes[i];
+    }
+    return true;
+}
+
+bool RamOutboxStorage::eraseSector(uint32_t offset) {
+    if (!m_buffer || offset % m_sectorSize != 0 || offset + m_sectorSize > m_size) {
+        return false;
+    }
+    memset(m_buffer + offset, 0xFF, m_sectorSize);
+    return true;
+}
+
+// ==================== OUTBOX IMPLEMENTATION ====================
+
+MqttOutbox::MqttOutbox() :
+    m_storage(nullptr),
+    m_sectorCount(0),
+    m_sectorSize(0),
+    m_write({0, 0}),
+    m_tail({0, 0}),
+    m_nextSequence(1),
+    m_nextSectorSequence(1),
+    m_pendingCount(0),
+    m_attempts(0),
+    m_failedMs(0),
+    m_tokens(0),
+    m_lastRefillMs(0),
+    m_refillStarted(false),
+    m_ratePerSec(OUTBOX_DRAIN_RATE_PER_SEC),
+    m_publish(nullptr),
+    m_publishContext(nullptr) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool MqttOutbox::sectorValid(uint16_t sector, uint32_t* sectorSequence) {
+    uint32_t header[2];
+    if (!m_storage->read(sectorBase(sector), header, sizeof(header))) {
+        return false;
+    }
+    if (header[0] != OUTBOX_SECTOR_MAGIC || header[1] == 0xFFFFFFFFUL) {
+        return false;
+    }
+    if (sectorSequence) {
+        *sectorSequence = header[1];
+    }
+    return true;
+}
+
+bool MqttOutbox::readHeader(const OutboxCursor& cursor, OutboxRecordHeader& header) {
+    if (cursor.offset + OUTBOX_RECORD_HEADER_SIZE > m_sectorSize) {
+        return false;
+    }
+    if (!m_storage->read(sectorBase(cursor.sector) + cursor.offset, &header, sizeof(header))) {
+        return false;
+    }
+    return header.magic == OUTBOX_RECORD_MAGIC &&
+           header.topicLength <= OUTBOX_MAX_TOPIC_LENGTH &&
+           header.payloadLength <= OUTBOX_MAX_PAYLOAD &&
+           cursor.offset + recordSize(header) <= m_sectorSize;
+}
+
+void MqttOutbox::normalize(OutboxCursor& cursor) {
+    // Move past the end of a sector to the first record of the next used one
+    OutboxRecordHeader header;
+    for (uint16_t guard = 0; guard <= m_sectorCount && cursor != m_write; guard++) {
+        if (sectorValid(cursor.sector) && readHeader(cursor, header)) {
+            return;
+        }
+        cursor.sector = nextSector(cursor.sector);
+        cursor.offset = OUTBOX_SECTOR_HEADER_SIZE;
+    }
+}
+
+void MqttOutbox::step(OutboxCursor& cursor) {
+    OutboxRecordHeader header;
+    if (readHeader(cursor, header)) {
+        cursor.offset += recordSize(header);
+    } else {
+        cursor.offset = m_sectorSize;
+    }
+    normalize(cursor);
+}
+
+bool MqttOutbox::markAcked(const OutboxCursor& cursor) {
+    uint8_t state = OUTBOX_STATE_ACKED;
+    return m_storage->write(sectorBase(cursor.sector) + cursor.offset + 1, &state, 1);
+}
+
+bool MqttOutbox::isErasedFrom(const OutboxCursor& cursor) {
+    uint8_t chunk[32];
+    for (uint32_t offset = cursor.offset; offset < m_sectorSize; offset += sizeof(chunk)) {
+        size_t length = m_sectorSize - offset < sizeof(chunk) ? m_sectorSize - offset : sizeof(chunk);
+        if (!m_storage->read(sectorBase(cursor.sector) + offset, chunk, length)) {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++) {
+            if (chunk[i] != 0xFF) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool MqttOutbox::begin(OutboxStorage* storage) {
+    m_storage = nullptr;
+    if (!storage || storage->sectorSize() < 256 || storage->sectorSize() > 32768 ||
+        storage->size() / storage->sectorSize() < 2) {
+        return false;
+    }
+
+    m_storage = storage;
+    m_sectorSize = storage->sectorSize();
+    m_sectorCount = storage->size() / storage->sectorSize();
+    m_pendingCount = 0;
+    m_attempts = 0;
+
+    // Newest sector holds the write position
+    int32_t newest = -1;
+    uint32_t newestSequence = 0;
+    for (uint16_t sector = 0; sector < m_sectorCount; sector++) {
+        uint32_t sequence;
+        if (sectorValid(sector, &sequence) && (newest < 0 || sequence > newestSequence)) {
+            newest = sector;
+            newestSequence = sequence;
+        }
+    }
+
+    if (newest < 0) {
+        // Empty log: the first append opens sector 0
+        m_write = {(uint16_t)(m_sectorCount - 1), m_sectorSize};
+        m_tail = m_write;
+        m_nextSequence = 1;
+        m_nextSectorSequence = 1;
+        return true;
+    }
+
+    m_nextSectorSequence = newestSequence + 1;
+
+    OutboxRecordHeader header;
+    OutboxCursor end = {(uint16_t)newest, OUTBOX_SECTOR_HEADER_SIZE};
+    while (readHeader(end, header)) {
+        end.offset += recordSize(header);
+    }
+    if (!isErasedFrom(end)) {
+        // Torn write after the last good record: leave this sector alone
+        end.offset = m_sectorSize;
+    }
+    m_write = end;
+
+    // Oldest to newest: sectors were filled in ring order after the newest one
+    uint32_t maxSequence = 0;
+    bool foundTail = false;
+    m_tail = m_write;
+    for (uint16_t i = 1; i <= m_sectorCount; i++) {
+        uint16_t sector = (newest + i) % m_sectorCount;
+        if (!sectorValid(sector)) {
+            continue;
+        }
+        OutboxCursor cursor = {sector, OUTBOX_SECTOR_HEADER_SIZE};
+        while ((sector != newest || cursor.offset < m_write.offset) && readHeader(cursor, header)) {
+            if (header.sequence > maxSequence) {
+                maxSequence = header.sequence;
+            }
+            if (header.state == OUTBOX_STATE_PENDING) {
+                m_pendingCount++;
+                if (!foundTail) {
+                    m_tail = cursor;
+                    foundTail = true;
+                }
+            }
+            cursor.offset += recordSize(header);
+        }
+    }
+
+    m_nextSequence = maxSequence + 1;
+    m_stats.recovered = m_pendingCount;
+    return true;
+}
+
+void MqttOutbox::openNextSector() {
+    uint16_t next = nextSector(m_write.sector);
+
+    if (m_pendingCount > 0 && m_tail.sector == next) {
+        // Full: the oldest sector still holds unpublished records
+        OutboxRecordHeader header;
+        OutboxCursor cursor = m_tail;
+        while (cursor != m_write && cursor.sector == next) {
+            if (readHeader(cursor, header) && header.state == OUTBOX_STATE_PENDING) {
+                m_pendingCount--;
+                m_stats.evicted++;
+            }
+            step(cursor);
+        }
+        m_tail = cursor;
+        m_attempts = 0;
+    }
+
+    m_storage->eraseSector(sectorBase(next));
+    uint32_t sectorHeader[2] = {OUTBOX_SECTOR_MAGIC, m_nextSectorSequence++};
+    m_storage->write(sectorBase(next), sectorHeader, sizeof(sectorHeader));
+
+    m_write = {next, OUTBOX_SECTOR_HEADER_SIZE};
+    if (m_pendingCount == 0) {
+        m_tail = m_write;
+    } else {
+        normalize(m_tail);
+    }
+}
+
+uint32_t MqttOutbox::append(OutboxKind kind, const char* topic, const uint8_t* payload, size_t length) {
+    if (!m_storage) {
+        return 0;
+    }
+
+    size_t topicLength = topic ? strlen(topic) : 0;
+    if (topicLength > OUTBOX_MAX_TOPIC_LENGTH) {
+        topicLength = OUTBOX_MAX_TOPIC_LENGTH;
+    }
+
+    if (length > OUTBOX_MAX_PAYLOAD ||
+        (kind == OutboxKind::TELEMETRY && getFillPercent() >= OUTBOX_TELEMETRY_MAX_FILL_PCT)) {
+        m_stats.refused++;
+        return 0;
+    }
+
+    OutboxRecordHeader header;
+    header.magic = OUTBOX_RECORD_MAGIC;
+    header.state = OUTBOX_STATE_PENDING;
+    header.kind = (uint8_t)kind;
+    header.topicLength = (uint8_t)topicLength;
+    header.payloadLength = (uint16_t)length;
+    header.sequence = m_nextSequence;
+
+    uint32_t size = recordSize(header);
+    if (m_write.offset + size > m_sectorSize) {
+        openNextSector();
+    }
+
+    memcpy(m_record, &header, sizeof(header));
+    if (topicLength > 0) {
+        memcpy(m_record + OUTBOX_RECORD_HEADER_SIZE, topic, topicLength);
+    }
+    if (length > 0) {
+        memcpy(m_record + OUTBOX_RECORD_HEADER_SIZE + topicLength, payload, length);
+    }
+    memset(m_record + OUTBOX_RECORD_HEADER_SIZE + topicLength + length, 0xFF,
+           size - OUTBOX_RECORD_HEADER_SIZE - topicLength - length);
+    header.crc = recordCrc(m_record, header);
+    memcpy(m_record, &header, sizeof(header));
+
+    // Body first, header last: a reset in between leaves no valid record
+    uint32_t base = sectorBase(m_write.sector) + m_write.offset;
+    if (!m_storage->write(base + OUTBOX_RECORD_HEADER_SIZE, m_record + OUTBOX_RECORD_HEADER_SIZE,
+                          size - OUTBOX_RECORD_HEADER_SIZE) ||
+        !m_storage->write(base, m_record, OUTBOX_RECORD_HEADER_SIZE)) {
+        m_stats.refused++;
+        return 0;
+    }
+
+    if (m_pendingCount == 0) {
+        m_tail = m_write;
+    }
+    m_write.offset += size;
+    m_pendingCount++;
+    m_stats.appended++;
+    return m_nextSequence++;
+}
+
+void MqttOutbox::advanceTail() {
+    OutboxRecordHeader header;
+    while (m_tail != m_write) {
+        if (readHeader(m_tail, header) && header.state == OUTBOX_STATE_PENDING) {
+            return;
+        }
+        step(m_tail);
+    }
+}
+
+void MqttOutbox::retire(uint32_t sequence, uint32_t& counter) {
+    OutboxRecordHeader header;
+    OutboxCursor cursor = m_tail;
+    while (cursor != m_write && readHeader(cursor, header) && header.sequence <= sequence) {
+        if (header.state == OUTBOX_STATE_PENDING && markAcked(cursor)) {
+            m_pendingCount--;
+            counter++;
+        }
+        step(cursor);
+    }
+    advanceTail();
+}
+
+void MqttOutbox::refillTokens(uint32_t nowMs) {
+    uint32_t capacity = OUTBOX_BATCH_MAX_RECORDS * 1000UL;
+    if (!m_refillStarted) {
+        m_tokens = capacity;
+        m_lastRefillMs = nowMs;
+        m_refillStarted = true;
+        return;
+    }
+
+    uint32_t elapsed = nowMs - m_lastRefillMs;
+    if (elapsed > 60000) {
+        elapsed = 60000;
+    }
+    m_tokens += elapsed * m_ratePerSec;
+    if (m_tokens > capacity) {
+        m_tokens = capacity;
+    }
+    m_lastRefillMs = nowMs;
+}
+
+uint8_t MqttOutbox::drain(uint32_t nowMs) {
+    if (!m_storage || !m_publish) {
+        return 0;
+    }
+
+    refillTokens(nowMs);
+    if (m_attempts > 0 && nowMs - m_failedMs < OUTBOX_RETRY_MS) {
+        return 0;
+    }
+
+    uint8_t sent = 0;
+    uint32_t bytes = 0;
+    OutboxRecordHeader header;
+
+    while (m_tail != m_write && sent < OUTBOX_BATCH_MAX_RECORDS && m_tokens >= 1000) {
+        if (!readHeader(m_tail, header) || header.state != OUTBOX_STATE_PENDING) {
+            advanceTail();
+            continue;
+        }
+        if (bytes > 0 && bytes + header.payloadLength > OUTBOX_BATCH_MAX_BYTES) {
+            break;
+        }
+
+        size_t length = OUTBOX_RECORD_HEADER_SIZE + header.topicLength + header.payloadLength;
+        if (!m_storage->read(sectorBase(m_tail.sector) + m_tail.offset, m_record, length) ||
+            recordCrc(m_record, header) != header.crc) {
+            retire(header.sequence, m_stats.corrupt);
+            continue;
+        }
+
+        char topic[OUTBOX_MAX_TOPIC_LENGTH + 1];
+        memcpy(topic, m_record + OUTBOX_RECORD_HEADER_SIZE, header.topicLength);
+        topic[header.topicLength] = '\0';
+
+        if (!m_publish(topic, header.sequence,
+                       m_record + OUTBOX_RECORD_HEADER_SIZE + header.topicLength,
+                       header.payloadLength, m_publishContext)) {
+            m_stats.failed++;
+            m_failedMs = nowMs;
+            if (++m_attempts >= OUTBOX_MAX_ATTEMPTS) {
+                // The connection keeps refusing this record; stop holding the log for it
+                retire(header.sequence, m_stats.expired);
+                m_attempts = 0;
+            }
+            break;
+        }
+
+        // QoS 0: accepted by the connection is as delivered as it gets
+        m_attempts = 0;
+        m_tokens -= 1000;
+        retire(header.sequence, m_stats.published);
+        bytes += header.payloadLength;
+        sent++;
+    }
+
+    return sent;
+}
+
+uint8_t MqttOutbox::getFillPercent() const {
+    if (!m_storage || m_pendingCount == 0) {
+        return 0;
+    }
+    uint16_t used = (m_write.sector + m_sectorCount - m_tail.sector) % m_sectorCount + 1;
+    return (uint8_t)(used * 100UL / m_sectorCount);
+}
+
+const char* outboxKindToString(OutboxKind kind) {
+    switch (kind) {
+        case OutboxKind::ALERT: return "ALERT";
+        case OutboxKind::TRANSITION: return "TRANSITION";
+        case OutboxKind::TELEMETRY: return "TELEMETRY";
+        default: return "UNKNOWN";
+    }
+}
@@ -0,0 +1,42 @@
+/**
+ * @file outbox_flash_storage.cpp
+ * @brief Raw flash partition backend for the MQTT outbox
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/OutboxFlashStorage.h"
+
+bool PartitionOutboxStorage::begin(const char* label, size_t maxBytes, size_t offset) {
+    m_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!m_partition || offset % SPI_FLASH_SEC_SIZE != 0 || offset >= m_partition->size) {
+        m_partition = nullptr;
+        m_size = 0;
+        return false;
+    }
+
+    m_offset = offset;
+    m_size = m_partition->size - offset < maxBytes ? m_partition->size - offset : maxBytes;
+    m_size -= m_size % SPI_FLASH_SEC_SIZE;
+    if (m_size < 2 * SPI_FLASH_SEC_SIZE) {
+        m_partition = nullptr;
+        m_size = 0;
+        return false;
+    }
+    return true;
+}
+
+bool PartitionOutboxStorage::read(uint32_t offset, void* data, size_t length) {
+    return m_partition && offset + length <= m_size &&
+           esp_partition_read(m_partition, m_offset + offset, data, length) == ESP_OK;
+}
+
+bool PartitionOutboxStorage::write(uint32_t offset, const void* data, size_t length) {
+    return m_partition && offset + length <= m_size &&
+           esp_partition_write(m_partition, m_offset + offset, data, length) == ESP_OK;
+}
+
+bool PartitionOutboxStorage::eraseSector(uint32_t offset) {
+    return m_partition && offset + SPI_FLASH_SEC_SIZE <= m_size &&
+           esp_partition_erase_range(m_partition, m_offset + offset, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
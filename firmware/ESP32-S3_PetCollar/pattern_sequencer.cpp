@@ -0,0 +1,85 @@
+/**
+ * @file pattern_sequencer.cpp
+ * @brief Absolute-deadline step state machine for compiled alert patterns
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/PatternSequencer.h"
+
+#include <string.h>
+
+// ==================== SEQUENCER IMPLEMENTATION ====================
+
+PatternSequencer::PatternSequencer() :
+    m_stepCount(0),
+    m_step(0),
+    m_repeats(0),
+    m_repeatCount(0),
+    m_playing(false),
+    m_stepDeadlineUs(0),
+    m_maxLatenessUs(0) {
+}
+
+bool PatternSequencer::isValid(const PatternStep* steps, uint8_t count) {
+    if (!steps || count == 0 || count > ALERT_ENGINE_MAX_STEPS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (steps[i].durationMs == 0) {
+            return false; // Zero-length steps would never advance
+        }
+    }
+    return true;
+}
+
+void PatternSequencer::start(const PatternStep* steps, uint8_t count, uint8_t repeats, int64_t nowUs) {
+    memcpy(m_table, steps, count * sizeof(PatternStep));
+    m_stepCount = count;
+    m_step = 0;
+    m_repeats = repeats;
+    m_repeatCount = 0;
+    m_stepDeadlineUs = nowUs + (int64_t)steps[0].durationMs * 1000;
+    m_playing = true;
+}
+
+int64_t PatternSequencer::advance(int64_t nowUs, PatternStep& current) {
+    current = {0, 0, 0, 0};
+    if (!m_playing) {
+        return -1;
+    }
+
+    if (nowUs >= m_stepDeadlineUs) {
+        uint32_t lateness = (uint32_t)(nowUs - m_stepDeadlineUs);
+        if (lateness > m_maxLatenessUs) {
+            m_maxLatenessUs = lateness;
+        }
+    }
+
+    // Consume every step whose deadline has passed; the next deadline is
+    // always derived from the previous one, never from nowUs
+    while (nowUs >= m_stepDeadlineUs) {
+        uint8_t next = m_step + 1;
+        if (next >= m_stepCount) {
+            next = 0;
+            m_repeatCount++;
+            if (m_repeats != ALERT_ENGINE_REPEAT_FOREVER && m_repeatCount >= m_repeats) {
+                m_playing = false;
+                return -1;
+            }
+        }
+        m_step = next;
+        m_stepDeadlineUs += (int64_t)m_table[next].durationMs * 1000;
+    }
+
+    current = m_table[m_step];
+    return m_stepDeadlineUs;
+}
+
+uint32_t PatternSequencer::cycleDurationMs(const PatternStep* steps, uint8_t count) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        total += steps[i].durationMs;
+    }
+    return total;
+}
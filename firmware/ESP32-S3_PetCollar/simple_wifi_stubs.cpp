@@ -1,15 +1,25 @@
 #include "include/WiFiManager.h"
+#include "include/CollarSettings.h"
 #include <WiFi.h>
 #include <ESPmDNS.h>
-#include <Preferences.h>
 
 // FUNCTIONAL WiFiManager implementation for ESP32-S3 Pet Collar
 // This provides working implementations for the methods that the main code needs
 
 // Static storage for this implementation
-static Preferences prefs;
 static String storedMDNSHostname = "";
 static bool isInitialized = false;
+static WiFiFastConnect fastConnect;
+
+static void saveFastConnect() {
+    CollarSettings& settings = collarSettings.edit(millis());
+    if (fastConnect.isValid()) {
+        settings.wifiFast = fastConnect.getRecord();
+    } else {
+        memset(&settings.wifiFast, 0, sizeof(settings.wifiFast));
+    }
+    fastConnect.countSave();
+}
 
 bool WiFiManager::beginEnhanced() {
     Serial.println("🚀 Starting functional WiFi initialization...");
@@ -17,60 +27,63 @@ bool WiFiManager::beginEnhanced() {
     // Set WiFi mode for ESP32-S3 compatibility
     WiFi.mode(WIFI_STA);
     
-    // Initialize preferences for credential storage
-    if (!prefs.begin("wifi_creds", false)) {
-        Serial.println("❌ Failed to initialize WiFi preferences");
-        return false;
-    }
-    
     // Generate unique hostname for mDNS
     uint64_t macAddress = ESP.getEfuseMac();
     storedMDNSHostname = "petcollar-" + String((uint32_t)(macAddress >> 32), HEX) + String((uint32_t)macAddress, HEX);
     WiFi.setHostname(storedMDNSHostname.c_str());
     
-    // Register WiFi event handlers for debugging
-    WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
-        switch (event) {
-            case ARDUINO_EVENT_WIFI_STA_CONNECTED:
-                Serial.printf("✅ WiFi: Connected to AP: %s\n", WiFi.SSID().c_str());
-                break;
-            case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-                Serial.printf("✅ WiFi: Got IP address: %s (Gateway: %s)\n", 
-                             WiFi.localIP().toString().c_str(), WiFi.gatewayIP().toString().c_str());
-                break;
-            case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
-                Serial.printf("❌ WiFi: Disconnected from %s, reason: %d\n", 
-                             WiFi.SSID().c_str(), info.wifi_sta_disconnected.reason);
-                if (info.wifi_sta_disconnected.reason == WIFI_REASON_NO_AP_FOUND) {
-                    Serial.println("   Reason: Access Point not found");
-                } else if (info.wifi_sta_disconnected.reason == WIFI_REASON_AUTH_FAIL) {
-                    Serial.println("   Reason: Authentication failed (wrong password?)");
-                } else if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) {
-                    Serial.println("   Reason: Association left");
-                }
-                break;
-            case ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE:
-                Serial.println("⚠️ WiFi: Auth mode changed");
-                break;
-            case ARDUINO_EVENT_WIFI_STA_START:
-                Serial.println("🔄 WiFi: STA started");
-                break;
-            case ARDUINO_EVENT_WIFI_STA_STOP:
-                Serial.println("🛑 WiFi: STA stopped");
-                break;
-            default:
-                break;
-        }
-    });
+    // Cached AP and lease from the last connection
+    const CollarSettings& settings = collarSettings.get();
+    if (!fastConnect.isValid() && settings.wifiFast.version != 0) {
+        fastConnect.restore(&settings.wifiFast, sizeof(settings.wifiFast));
+    }
     
-    // Load stored credentials and attempt connection
-    String storedSSID = prefs.getString("ssid", "");
-    String storedPassword = prefs.getString("password", "");
+    // Register WiFi event handlers for debugging (once; reconnects call this again)
+    if (!isInitialized) {
+        WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+            switch (event) {
+                case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+                    Serial.printf("✅ WiFi: Connected to AP: %s\n", WiFi.SSID().c_str());
+                    break;
+                case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+                    Serial.printf("✅ WiFi: Got IP address: %s (Gateway: %s)\n", 
+                                 WiFi.localIP().toString().c_str(), WiFi.gatewayIP().toString().c_str());
+                    break;
+                case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+                    Serial.printf("❌ WiFi: Disconnected from %s, reason: %d\n", 
+                                 WiFi.SSID().c_str(), info.wifi_sta_disconnected.reason);
+                    if (info.wifi_sta_disconnected.reason == WIFI_REASON_NO_AP_FOUND) {
+                        Serial.println("   Reason: Access Point not found");
+                    } else if (info.wifi_sta_disconnected.reason == WIFI_REASON_AUTH_FAIL) {
+                        Serial.println("   Reason: Authentication failed (wrong password?)");
+                    } else if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) {
+                        Serial.println("   Reason: Association left");
+                    }
+                    break;
+                case ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE:
+                    Serial.println("⚠️ WiFi: Auth mode changed");
+                    break;
+                case ARDUINO_EVENT_WIFI_STA_START:
+                    Serial.println("🔄 WiFi: STA started");
+                    break;
+                case ARDUINO_EVENT_WIFI_STA_STOP:
+                    Serial.println("🛑 WiFi: STA stopped");
+                    break;
+                default:
+                    break;
+            }
+        });
+    }
     
-    if (storedSSID.length() > 0) {
+    // Stored credentials were loaded with the settings at boot
+    if (settings.wifiSsid[0]) {
+        String storedSSID = settings.wifiSsid;
+        String storedPassword = settings.wifiPassword;
         Serial.printf("📱 Found stored WiFi credentials: %s\n", storedSSID.c_str());
         Serial.printf("🔗 Attempting connection with stored credentials...\n");
-        WiFi.begin(storedSSID.c_str(), storedPassword.c_str());
+        if (!connectFast(storedSSID, storedPassword)) {
+            WiFi.begin(storedSSID.c_str(), storedPassword.c_str());
+        }
     } else {
         Serial.println("📱 No stored WiFi credentials found - will use cached networks");
     }
@@ -102,10 +115,10 @@ bool WiFiManager::addNetworkToCache(const String& ssid, const String& password)
     
     // Store first network as primary
     if (networkCount == 1) {
-        String storedSSID = prefs.getString("ssid", "");
-        if (storedSSID.length() == 0) {
-            prefs.putString("ssid", ssid);
-            prefs.putString("password", password);
+        if (collarSettings.get().wifiSsid[0] == '\0') {
+            CollarSettings& settings = collarSettings.edit(millis());
+            strlcpy(settings.wifiSsid, ssid.c_str(), sizeof(settings.wifiSsid));
+            strlcpy(settings.wifiPassword, password.c_str(), sizeof(settings.wifiPassword));
             Serial.printf("💾 Saved as primary network: %s\n", ssid.c_str());
         }
     }
@@ -157,6 +170,10 @@ bool WiFiManager::startConfigurationAP(bool captive) {
 bool WiFiManager::attemptConnection(const String& ssid, const String& password) {
     Serial.printf("🔗 Attempting controlled connection to: %s\n", ssid.c_str());
     
+    if (connectFast(ssid, password)) {
+        return true;
+    }
+    
     // AGGRESSIVE WiFi reset to clear association counters
     WiFi.disconnect(true);
     WiFi.mode(WIFI_OFF);
@@ -206,6 +223,7 @@ bool WiFiManager::attemptConnection(const String& ssid, const String& password)
     
     if (WiFi.status() == WL_CONNECTED) {
         Serial.printf("\n✅ Connected to: %s\n", ssid.c_str());
+        rememberConnection(millis() - startTime);
         Serial.printf("📡 IP Address: %s\n", WiFi.localIP().toString().c_str());
         Serial.printf("📶 Signal: %d dBm\n", WiFi.RSSI());
         Serial.printf("🏠 Gateway: %s\n", WiFi.gatewayIP().toString().c_str());
@@ -221,5 +239,95 @@ bool WiFiManager::attemptConnection(const String& ssid, const String& password)
     }
 }
 
+// Wait for a targeted WiFi.begin() to associate (and get an address)
+static wl_status_t waitForTargetedJoin(unsigned long startTime) {
+    wl_status_t status = WiFi.status();
+    while (status != WL_CONNECTED && status != WL_CONNECT_FAILED && status != WL_NO_SSID_AVAIL &&
+           millis() - startTime < WIFI_FAST_CONNECT_TIMEOUT_MS) {
+        delay(20);
+        status = WiFi.status();
+    }
+    return status;
+}
+
+// Fast path: no channel scan, and no DHCP while the cached lease is fresh
+bool WiFiManager::connectFast(const String& ssid, const String& password) {
+    WiFiFastPath path = fastConnect.plan(ssid.c_str());
+    if (path == WiFiFastPath::SCAN) {
+        return false;
+    }
+    const WiFiFastRecord& record = fastConnect.getRecord();
+    if (path == WiFiFastPath::FULL) {
+        WiFi.config(IPAddress(record.ip), IPAddress(record.gateway), IPAddress(record.subnet),
+                    IPAddress(record.dns1), IPAddress(record.dns2));
+    } else {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+    
+    Serial.printf("⚡ Fast connect to %s on channel %u (%s)\n", ssid.c_str(), record.channel,
+                 wifiFastPathToString(path));
+    fastConnect.beginAttempt(path);
+    unsigned long startTime = millis();
+    WiFi.begin(ssid.c_str(), password.c_str(), record.channel, record.bssid, true);
+    
+    wl_status_t status = waitForTargetedJoin(startTime);
+    if (status == WL_CONNECTED) {
+        rememberConnection(millis() - startTime);
+        return true;
+    }
+    
+    Serial.printf("⚠️ Fast connect failed (status %d), scanning instead\n", status);
+    WiFi.disconnect();
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);   // Scan path uses DHCP
+    if (fastConnect.recordFailure(millis() - startTime)) {
+        saveFastConnect();
+    }
+    return false;
+}
+
+// Roam: another AP is known by BSSID and channel, so no scan; DHCP since
+// it may be another network
+bool WiFiManager::roamTo(const String& ssid, const String& password, const uint8_t* bssid,
+                         uint8_t channel) {
+    Serial.printf("📶 Roaming to %s %02X:%02X:%02X:%02X:%02X:%02X on channel %u\n", ssid.c_str(),
+                 bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5], channel);
+    WiFi.disconnect();
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    fastConnect.beginAttempt(WiFiFastPath::TARGETED);
+    unsigned long startTime = millis();
+    WiFi.begin(ssid.c_str(), password.c_str(), channel, bssid, true);
+    
+    wl_status_t status = waitForTargetedJoin(startTime);
+    if (status == WL_CONNECTED) {
+        rememberConnection(millis() - startTime);
+        return true;
+    }
+    Serial.printf("⚠️ Roam failed (status %d)\n", status);
+    WiFi.disconnect();
+    return false;
+}
+
+void WiFiManager::rememberConnection(uint32_t elapsedMs) {
+    if (WiFi.status() != WL_CONNECTED) {
+        return;
+    }
+    uint32_t ip = WiFi.localIP();
+    uint32_t gateway = WiFi.gatewayIP();
+    uint32_t subnet = WiFi.subnetMask();
+    uint32_t dns1 = WiFi.dnsIP(0);
+    uint32_t dns2 = WiFi.dnsIP(1);
+    if (fastConnect.recordConnected(WiFi.SSID().c_str(), WiFi.BSSID(), WiFi.channel(),
+                                    ip, gateway, subnet, dns1, dns2, elapsedMs)) {
+        saveFastConnect();
+    }
+    const WiFiFastStats& stats = fastConnect.getStats();
+    Serial.printf("⚡ Connected in %lu ms via %s\n", (unsigned long)stats.lastConnectMs,
+                 wifiFastPathToString(stats.lastPath));
+}
+
+const WiFiFastConnect& WiFiManager::getFastConnect() const {
+    return fastConnect;
+}
+
 // Note: Most methods are already implemented as inline functions in WiFiManager.h
 // Only implementing methods that are declared but not defined in the header 
\ No newline at end of file
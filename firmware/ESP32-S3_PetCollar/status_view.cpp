@@ -0,0 +1,252 @@
+/**
+ * @file status_view.cpp
+ * @brief Retained-mode text fields for the SSD1306 status screen
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/StatusView.h"
+
+#include <stdarg.h>
+
+static_assert(STATUS_VIEW_MAX_CHARS <= 32, "Dirty marks are one bit per character in a uint32_t");
+
+// ==================== FIELDS ====================
+
+StatusView::StatusView(const StatusFieldLayout* layout, uint8_t count, uint32_t timeoutMs) :
+    m_layout(layout),
+    m_fieldCount(min(count, (uint8_t)STATUS_VIEW_MAX_FIELDS)),
+    m_timeoutMs(timeoutMs),
+    m_lastActivityMs(0),
+    m_blanked(false),
+    m_glyphsDrawn(0) {
+    // Matches a cleared frame buffer: blank cells with nothing to draw
+    memset(m_text, ' ', sizeof(m_text));
+    memset(m_dirty, 0, sizeof(m_dirty));
+}
+
+bool StatusView::set(uint8_t field, const char* text, uint32_t nowMs) {
+    if (field >= m_fieldCount) {
+        return false;
+    }
+    uint8_t width = min(m_layout[field].width, (uint8_t)STATUS_VIEW_MAX_CHARS);
+    char* cells = m_text[field];
+    uint32_t changed = 0;
+
+    bool ended = false;
+    for (uint8_t i = 0; i < width; i++) {
+        ended = ended || text[i] == '\0';
+        char c = ended ? ' ' : text[i];
+        if (cells[i] != c) {
+            cells[i] = c;
+            changed |= 1UL << i;
+        }
+    }
+
+    if (changed == 0) {
+        return false;
+    }
+    m_dirty[field] |= changed;
+    if (m_layout[field].wakes) {
+        m_lastActivityMs = nowMs;
+    }
+    return true;
+}
+
+bool StatusView::setf(uint8_t field, uint32_t nowMs, const char* format, ...) {
+    char text[STATUS_VIEW_MAX_CHARS + 1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    return set(field, text, nowMs);
+}
+
+void StatusView::invalidate() {
+    for (uint8_t field = 0; field < m_fieldCount; field++) {
+        uint8_t width = min(m_layout[field].width, (uint8_t)STATUS_VIEW_MAX_CHARS);
+        m_dirty[field] = width == 32 ? 0xFFFFFFFFUL : (1UL << width) - 1;
+    }
+}
+
+bool StatusView::hasDirty() const {
+    for (uint8_t field = 0; field < m_fieldCount; field++) {
+        if (m_dirty[field]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ==================== RENDERING ====================
+
+uint16_t StatusView::render(StatusGlyphWriter writer, void* context, DisplayDirtyPages& pages) {
+    uint16_t drawn = 0;
+    for (uint8_t field = 0; field < m_fieldCount; field++) {
+        uint32_t dirty = m_dirty[field];
+        if (dirty == 0) {
+            continue;
+        }
+        const StatusFieldLayout& layout = m_layout[field];
+        uint8_t first = __builtin_ctz(dirty);
+        uint8_t last = 31 - __builtin_clz(dirty);
+
+        for (uint8_t i = first; i <= last; i++) {
+            if (dirty & (1UL << i)) {
+                writer(context, layout.x + i * STATUS_GLYPH_WIDTH, layout.page, m_text[field][i]);
+                drawn++;
+            }
+        }
+        pages.add(layout.page, layout.x + first * STATUS_GLYPH_WIDTH,
+                  layout.x + (last + 1) * STATUS_GLYPH_WIDTH - 1);
+        m_dirty[field] = 0;
+    }
+    m_glyphsDrawn += drawn;
+    return drawn;
+}
+
+// ==================== BLANKING ====================
+
+bool StatusView::updateBlanking(uint32_t nowMs) {
+    bool blank = m_timeoutMs > 0 && nowMs - m_lastActivityMs >= m_timeoutMs;
+    if (blank == m_blanked) {
+        return false;
+    }
+    m_blanked = blank;
+    return true;
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+enum TestField : uint8_t { TEST_TITLE, TEST_COUNT, TEST_DETAIL, TEST_FIELD_COUNT };
+
+const StatusFieldLayout TEST_LAYOUT[TEST_FIELD_COUNT] = {
+    {0, 0,  9,  false},
+    {0, 64, 10, true},
+    {3, 0,  21, false},
+};
+
+struct GlyphLog {
+    uint8_t count;
+    uint8_t x[32];
+    uint8_t page[32];
+    char c[32];
+};
+
+void logGlyph(void* context, uint8_t x, uint8_t page, char c) {
+    GlyphLog* log = static_cast<GlyphLog*>(context);
+    if (log->count < sizeof(log->c)) {
+        log->x[log->count] = x;
+        log->page[log->count] = page;
+        log->c[log->count] = c;
+        log->count++;
+    }
+}
+
+/**
+ * @brief Only characters that changed are drawn, and only their columns flushed
+ */
+bool testCharacterDirtyTracking() {
+    Serial.println("📊 Test 1: Per-character dirty tracking");
+
+    StatusView view(TEST_LAYOUT, TEST_FIELD_COUNT, 0);
+    GlyphLog log = {};
+    DisplayDirtyPages pages = {};
+
+    view.set(TEST_COUNT, "Beacons:3", 0);
+    view.render(logGlyph, &log, pages);
+    bool passed = log.count == 9 && pages.mask == 0x01 && pages.firstColumn[0] == 64 &&
+                  pages.lastColumn[0] == 64 + 9 * 6 - 1;
+
+    // Same text: nothing to do. One digit: one cell
+    log.count = 0;
+    pages.clear();
+    passed = passed && !view.set(TEST_COUNT, "Beacons:3", 0) && !view.hasDirty();
+    passed = passed && view.setf(TEST_COUNT, 0, "Beacons:%d", 4);
+    view.render(logGlyph, &log, pages);
+    passed = passed && log.count == 1 && log.c[0] == '4' && log.x[0] == 64 + 8 * 6 &&
+             log.page[0] == 0 && pages.getBytes() == 6;
+
+    Serial.printf("   %lu glyphs drawn, last flush %lu bytes (full frame 512)\n",
+                 (unsigned long)view.getGlyphsDrawn(), (unsigned long)pages.getBytes());
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Shorter text blanks its leftovers, long text is cut at the field width
+ */
+bool testPaddingAndInvalidate() {
+    Serial.println("📊 Test 2: Padding, truncation and invalidate");
+
+    StatusView view(TEST_LAYOUT, TEST_FIELD_COUNT, 0);
+    GlyphLog log = {};
+    DisplayDirtyPages pages = {};
+
+    view.set(TEST_DETAIL, "Uptime:120m", 0);
+    view.render(logGlyph, &log, pages);
+    log.count = 0;
+    pages.clear();
+
+    view.set(TEST_DETAIL, "Free:98KB", 0);
+    view.render(logGlyph, &log, pages);
+    bool passed = log.count > 0 && log.c[log.count - 1] == ' ' && pages.mask == 0x08 &&
+                  pages.firstColumn[3] == 0 && pages.lastColumn[3] == 11 * 6 - 1;
+
+    // A title longer than 9 characters never spills into the next field
+    log.count = 0;
+    pages.clear();
+    view.set(TEST_TITLE, "PetCollar ESP32-S3", 0);
+    view.render(logGlyph, &log, pages);
+    passed = passed && log.count == 9 && pages.lastColumn[0] == 9 * 6 - 1;
+
+    // After invalidate() every cell of every field is drawn again
+    log.count = 0;
+    pages.clear();
+    view.invalidate();
+    uint16_t drawn = view.render(logGlyph, &log, pages);
+    passed = passed && drawn == 9 + 10 + 21 && pages.mask == 0x09;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief The panel blanks after the timeout and wakes on waking fields only
+ */
+bool testBlanking() {
+    Serial.println("📊 Test 3: Inactivity blanking");
+
+    StatusView view(TEST_LAYOUT, TEST_FIELD_COUNT, 1000);
+    view.wake(0);
+    bool passed = !view.updateBlanking(999) && !view.isBlanked();
+    passed = passed && view.updateBlanking(1000) && view.isBlanked();
+
+    // The rotating detail line does not wake the panel, a beacon count does
+    view.set(TEST_DETAIL, "Uptime:2m", 1500);
+    passed = passed && !view.updateBlanking(1500) && view.isBlanked() && view.hasDirty();
+    view.set(TEST_COUNT, "Beacons:1", 2000);
+    passed = passed && view.updateBlanking(2000) && !view.isBlanked();
+
+    view.wake(5000);
+    passed = passed && !view.updateBlanking(5999) && view.updateBlanking(6000);
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runStatusViewTests() {
+    Serial.println("\n🧪 Running Status View Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testCharacterDirtyTracking();
+    passed &= testPaddingAndInvalidate();
+    passed &= testBlanking();
+
+    Serial.printf("\n%s Status View Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
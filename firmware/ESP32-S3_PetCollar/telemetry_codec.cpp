@@ -0,0 +1,308 @@
+/**
+ * @file telemetry_codec.cpp
+ * @brief CBOR writer and MQTT message encoders
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/TelemetryCodec.h"
+#include <initializer_list>
+
+// CBOR major types and simple values
+#define CBOR_MAJOR_UINT     0
+#define CBOR_MAJOR_NEGINT   1
+#define CBOR_MAJOR_BYTES    2
+#define CBOR_MAJOR_TEXT     3
+#define CBOR_MAJOR_ARRAY    4
+#define CBOR_MAJOR_MAP      5
+#define CBOR_MAJOR_TAG      6
+#define CBOR_MAJOR_SIMPLE   7
+
+#define CBOR_FALSE          0xF4
+#define CBOR_TRUE           0xF5
+#define CBOR_NULL           0xF6
+#define CBOR_FLOAT32        0xFA
+#define CBOR_BREAK          0xFF
+#define CBOR_INDEFINITE     31
+
+// ==================== CBOR WRITER ====================
+
+CborWriter::CborWriter(uint8_t* buffer, size_t capacity) :
+    m_buffer(buffer),
+    m_capacity(capacity),
+    m_length(0),
+    m_overflow(false) {
+}
+
+void CborWriter::writeRaw(const uint8_t* data, size_t length) {
+    if (m_overflow || length > m_capacity - m_length) {
+        m_overflow = true;
+        return;
+    }
+    memcpy(m_buffer + m_length, data, length);
+    m_length += length;
+}
+
+void CborWriter::writeHead(uint8_t majorType, uint64_t value) {
+    uint8_t head[9];
+    size_t size;
+    uint8_t major = majorType << 5;
+
+    if (value < 24) {
+        head[0] = major | (uint8_t)value;
+        size = 1;
+    } else if (value <= 0xFF) {
+        head[0] = major | 24;
+        head[1] = (uint8_t)value;
+        size = 2;
+    } else if (value <= 0xFFFF) {
+        head[0] = major | 25;
+        head[1] = (uint8_t)(value >> 8);
+        head[2] = (uint8_t)value;
+        size = 3;
+    } else if (value <= 0xFFFFFFFFULL) {
+        head[0] = major | 26;
+        for (int i = 0; i < 4; i++) {
+            head[1 + i] = (uint8_t)(value >> (24 - 8 * i));
+        }
+        size = 5;
+    } else {
+        head[0] = major | 27;
+        for (int i = 0; i < 8; i++) {
+            head[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+        }
+        size = 9;
+    }
+
+    writeRaw(head, size);
+}
+
+void CborWriter::beginMap() {
+    uint8_t head = (CBOR_MAJOR_MAP << 5) | CBOR_INDEFINITE;
+    writeRaw(&head, 1);
+}
+
+void CborWriter::beginArray() {
+    uint8_t head = (CBOR_MAJOR_ARRAY << 5) | CBOR_INDEFINITE;
+    writeRaw(&head, 1);
+}
+
+void CborWriter::endContainer() {
+    uint8_t brk = CBOR_BREAK;
+    writeRaw(&brk, 1);
+}
+
+void CborWriter::writeTag(uint64_t tag) {
+    writeHead(CBOR_MAJOR_TAG, tag);
+}
+
+void CborWriter::writeUInt(uint64_t value) {
+    writeHead(CBOR_MAJOR_UINT, value);
+}
+
+void CborWriter::writeInt(int64_t value) {
+    if (value >= 0) {
+        writeHead(CBOR_MAJOR_UINT, (uint64_t)value);
+    } else {
+        writeHead(CBOR_MAJOR_NEGINT, (uint64_t)(-1 - value));
+    }
+}
+
+void CborWriter::writeFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint8_t out[5] = {
+        CBOR_FLOAT32,
+        (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits
+    };
+    writeRaw(out, sizeof(out));
+}
+
+void CborWriter::writeBool(bool value) {
+    uint8_t out = value ? CBOR_TRUE : CBOR_FALSE;
+    writeRaw(&out, 1);
+}
+
+void CborWriter::writeNull() {
+    uint8_t out = CBOR_NULL;
+    writeRaw(&out, 1);
+}
+
+void CborWriter::writeText(const char* text) {
+    writeText(text ? text : "", text ? strlen(text) : 0);
+}
+
+void CborWriter::writeText(const char* text, size_t length) {
+    writeHead(CBOR_MAJOR_TEXT, length);
+    writeRaw((const uint8_t*)text, length);
+}
+
+void CborWriter::writeBytes(const uint8_t* data, size_t length) {
+    writeHead(CBOR_MAJOR_BYTES, length);
+    writeRaw(data, length);
+}
+
+// ==================== MESSAGE ENCODERS ====================
+
+void beginTelemetryMessage(CborWriter& writer, TelemetryMessage type, const char* deviceId) {
+    writer.reset();
+    writer.writeTag(TELEMETRY_SELF_DESCRIBE_TAG);
+    writer.beginMap();
+    writer.field(TF_SCHEMA, (uint32_t)TELEMETRY_SCHEMA_VERSION);
+    writer.field(TF_MESSAGE, (uint32_t)type);
+    writer.field(TF_DEVICE_ID, deviceId);
+}
+
+static size_t finishMessage(CborWriter& writer) {
+    writer.endContainer();
+    return writer.ok() ? writer.length() : 0;
+}
+
+static bool hasField(uint64_t mask, TelemetryField field) {
+    return (mask & TELEMETRY_FIELD_BIT(field)) != 0;
+}
+
+static bool hasAnyField(uint64_t mask, std::initializer_list<TelemetryField> fields) {
+    for (TelemetryField field : fields) {
+        if (hasField(mask, field)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t encodeTelemetryCbor(CborWriter& writer, const char* deviceId, const TelemetrySnapshot& snapshot,
+                           uint32_t sequence, uint64_t fieldMask, TelemetryMessage type) {
+    beginTelemetryMessage(writer, type, deviceId);
+
+    writer.field(TF_SEQUENCE, sequence);
+    writer.field(TF_TIMESTAMP, snapshot.timestamp);
+    if (hasField(fieldMask, TF_UPTIME)) writer.field(TF_UPTIME, snapshot.uptime);
+    if (hasField(fieldMask, TF_FIRMWARE)) writer.field(TF_FIRMWARE, snapshot.firmware);
+    if (hasField(fieldMask, TF_FREE_HEAP)) writer.field(TF_FREE_HEAP, snapshot.freeHeap);
+
+    if (hasField(fieldMask, TF_WIFI_CONNECTED)) writer.field(TF_WIFI_CONNECTED, snapshot.wifiConnected);
+    if (hasField(fieldMask, TF_WIFI_RSSI)) writer.fieldInt(TF_WIFI_RSSI, snapshot.wifiRssi);
+    if (hasField(fieldMask, TF_LOCAL_IP)) writer.field(TF_LOCAL_IP, snapshot.localIp);
+
+    if (hasField(fieldMask, TF_SYSTEM_STATE)) writer.field(TF_SYSTEM_STATE, (uint32_t)snapshot.systemState);
+    if (hasField(fieldMask, TF_BATTERY_LEVEL)) writer.fieldInt(TF_BATTERY_LEVEL, snapshot.batteryLevel);
+    if (hasField(fieldMask, TF_ALERT_ACTIVE)) writer.field(TF_ALERT_ACTIVE, snapshot.alertActive);
+
+    if (hasAnyField(fieldMask, {TF_TOTAL_ZONES, TF_CURRENT_ZONE, TF_ZONE_BREACHES})) {
+        writer.key(TF_ZONES);
+        writer.beginMap();
+        if (hasField(fieldMask, TF_TOTAL_ZONES)) writer.field(TF_TOTAL_ZONES, (uint32_t)snapshot.totalZones);
+        if (hasField(fieldMask, TF_CURRENT_ZONE)) writer.field(TF_CURRENT_ZONE, snapshot.currentZone);
+        if (hasField(fieldMask, TF_ZONE_BREACHES)) writer.field(TF_ZONE_BREACHES, (uint32_t)snapshot.zoneBreaches);
+        writer.endContainer();
+    }
+
+    if (hasAnyField(fieldMask, {TF_DETECTED_COUNT, TF_ACTIVE_BEACONS, TF_LAST_SCAN})) {
+        writer.key(TF_BEACONS);
+        writer.beginMap();
+        if (hasField(fieldMask, TF_DETECTED_COUNT)) writer.field(TF_DETECTED_COUNT, (uint32_t)snapshot.detectedBeacons);
+        if (hasField(fieldMask, TF_ACTIVE_BEACONS)) writer.field(TF_ACTIVE_BEACONS, (uint32_t)snapshot.activeBeacons);
+        if (hasField(fieldMask, TF_LAST_SCAN)) writer.field(TF_LAST_SCAN, snapshot.lastScan);
+        writer.endContainer();
+    }
+
+    if (hasAnyField(fieldMask, {TF_ENABLED, TF_FILTER_TYPE, TF_IIR_ALPHA, TF_KALMAN_Q, TF_KALMAN_R,
+                                TF_ACTIVE_FILTERS, TF_TOTAL_UPDATES})) {
+        writer.key(TF_TEMPORAL_FILTER);
+        writer.beginMap();
+        if (hasField(fieldMask, TF_ENABLED)) writer.field(TF_ENABLED, snapshot.filterEnabled);
+        if (snapshot.filterEnabled) {
+            if (hasField(fieldMask, TF_FILTER_TYPE)) writer.field(TF_FILTER_TYPE, snapshot.filterType == 0 ? "IIR" : "Kalman");
+            if (hasField(fieldMask, TF_IIR_ALPHA)) writer.field(TF_IIR_ALPHA, snapshot.iirAlpha);
+            if (hasField(fieldMask, TF_KALMAN_Q)) writer.field(TF_KALMAN_Q, snapshot.kalmanQ);
+            if (hasField(fieldMask, TF_KALMAN_R)) writer.field(TF_KALMAN_R, snapshot.kalmanR);
+            if (hasField(fieldMask, TF_ACTIVE_FILTERS)) writer.field(TF_ACTIVE_FILTERS, (uint32_t)snapshot.activeFilters);
+            if (hasField(fieldMask, TF_TOTAL_UPDATES)) writer.field(TF_TOTAL_UPDATES, snapshot.filterUpdates);
+        } else if (type == TelemetryMessage::TELEMETRY_DELTA) {
+            // Filter was turned off since the previous message: clear its fields
+            for (TelemetryField field : {TF_FILTER_TYPE, TF_IIR_ALPHA, TF_KALMAN_Q, TF_KALMAN_R,
+                                         TF_ACTIVE_FILTERS, TF_TOTAL_UPDATES}) {
+                if (hasField(fieldMask, field)) {
+                    writer.key(field);
+                    writer.writeNull();
+                }
+            }
+        }
+        writer.endContainer();
+    }
+
+    if (snapshot.hasPosition) {
+        if (hasAnyField(fieldMask, {TF_POS_X, TF_POS_Y, TF_CONFIDENCE, TF_ACCURACY})) {
+            writer.key(TF_POSITION);
+            writer.beginMap();
+            if (hasField(fieldMask, TF_POS_X)) writer.field(TF_POS_X, snapshot.posX);
+            if (hasField(fieldMask, TF_POS_Y)) writer.field(TF_POS_Y, snapshot.posY);
+            if (hasField(fieldMask, TF_CONFIDENCE)) writer.field(TF_CONFIDENCE, snapshot.posConfidence);
+            if (hasField(fieldMask, TF_ACCURACY)) writer.field(TF_ACCURACY, snapshot.posAccuracy);
+            writer.endContainer();
+        }
+    } else if (type == TelemetryMessage::TELEMETRY_DELTA && hasField(fieldMask, TF_POSITION)) {
+        // Position was lost since the previous message
+        writer.key(TF_POSITION);
+        writer.writeNull();
+    }
+
+    return finishMessage(writer);
+}
+
+size_t encodeAlertCbor(CborWriter& writer, const char* deviceId, const AlertTelemetry& alert) {
+    beginTelemetryMessage(writer, TelemetryMessage::ALERT, deviceId);
+
+    writer.field(TF_TIMESTAMP, alert.timestamp);
+    writer.field(TF_ALERT_TYPE, "proximity");
+    writer.field(TF_BEACON_NAME, alert.beaconName);
+    writer.field(TF_BEACON_ADDRESS, alert.beaconAddress);
+    writer.field(TF_DISTANCE_CM, alert.distanceCm);
+    writer.fieldInt(TF_RSSI, alert.rssi);
+    writer.field(TF_ALERT_MODE, alert.alertMode);
+    writer.field(TF_ALERT_INTENSITY, (uint32_t)alert.intensity);
+    writer.field(TF_ALERT_DURATION, (uint32_t)alert.durationMs);
+    writer.field(TF_TRIGGER_DISTANCE, alert.triggerDistanceCm);
+
+    if (alert.hasPosition) {
+        writer.key(TF_COLLAR_POSITION);
+        writer.beginMap();
+        writer.field(TF_POS_X, alert.posX);
+        writer.field(TF_POS_Y, alert.posY);
+        writer.field(TF_CONFIDENCE, alert.posConfidence);
+        writer.endContainer();
+    }
+
+    return finishMessage(writer);
+}
+
+size_t encodeZoneStatusCbor(CborWriter& writer, const char* deviceId, uint32_t timestamp,
+                            uint16_t zoneCount, const char* currentZone, uint16_t breachCount) {
+    beginTelemetryMessage(writer, TelemetryMessage::ZONES, deviceId);
+
+    writer.field(TF_TIMESTAMP, timestamp);
+    writer.field(TF_ZONE_COUNT, (uint32_t)zoneCount);
+    writer.field(TF_CURRENT_ZONE, currentZone);
+    writer.field(TF_BREACH_COUNT, (uint32_t)breachCount);
+
+    return finishMessage(writer);
+}
+
+size_t encodeLocationCbor(CborWriter& writer, const char* deviceId, uint32_t timestamp,
+                          float x, float y, float confidence, float accuracy) {
+    beginTelemetryMessage(writer, TelemetryMessage::LOCATION, deviceId);
+
+    writer.field(TF_TIMESTAMP, timestamp);
+    writer.key(TF_POSITION);
+    writer.beginMap();
+    writer.field(TF_POS_X, x);
+    writer.field(TF_POS_Y, y);
+    writer.endContainer();
+    writer.field(TF_CONFIDENCE, confidence);
+    writer.field(TF_ACCURACY, accuracy);
+    writer.field(TF_METHOD, "triangulation");
+
+    return finishMessage(writer);
+}
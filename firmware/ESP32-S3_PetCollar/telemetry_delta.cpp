@@ -0,0 +1,419 @@
+/**
+ * @file telemetry_delta.cpp
+ * @brief Keyframe + delta telemetry compression
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/TelemetryDelta.h"
+
+static_assert(TF_SEQUENCE < 64, "Telemetry field masks are 64 bits wide");
+
+// Counters that change on every publish; sent with keyframes only
+#define TELEMETRY_KEYFRAME_ONLY_FIELDS \
+    (TELEMETRY_FIELD_BIT(TF_UPTIME) | TELEMETRY_FIELD_BIT(TF_LAST_SCAN) | TELEMETRY_FIELD_BIT(TF_TOTAL_UPDATES))
+
+// Temporal filter fields that only exist while the filter is enabled
+#define TELEMETRY_FILTER_FIELDS \
+    (TELEMETRY_FIELD_BIT(TF_FILTER_TYPE) | TELEMETRY_FIELD_BIT(TF_IIR_ALPHA) | \
+     TELEMETRY_FIELD_BIT(TF_KALMAN_Q) | TELEMETRY_FIELD_BIT(TF_KALMAN_R) | \
+     TELEMETRY_FIELD_BIT(TF_ACTIVE_FILTERS) | TELEMETRY_FIELD_BIT(TF_TOTAL_UPDATES))
+
+// ==================== ENCODER IMPLEMENTATION ====================
+
+TelemetryDeltaEncoder::TelemetryDeltaEncoder() :
+    m_hasBaseline(false),
+    m_forceKeyframe(false),
+    m_sequence(0),
+    m_sinceKeyframe(0),
+    m_lastKeyframeMs(0),
+    m_pendingFrame(TelemetryFrame::SUPPRESSED),
+    m_pendingMask(0),
+    m_pendingLength(0),
+    m_pendingFullLength(0),
+    m_keyframeInterval(TELEMETRY_KEYFRAME_INTERVAL),
+    m_keyframeMaxMs(TELEMETRY_KEYFRAME_MAX_MS) {
+    memset(&m_lastSent, 0, sizeof(m_lastSent));
+    memset(&m_pending, 0, sizeof(m_pending));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void TelemetryDeltaEncoder::setKeyframeInterval(uint16_t publishes, uint32_t maxMs) {
+    m_keyframeInterval = publishes > 0 ? publishes : 1;
+    m_keyframeMaxMs = maxMs;
+}
+
+uint64_t TelemetryDeltaEncoder::changedFields(const TelemetrySnapshot& current) const {
+    const TelemetrySnapshot& last = m_lastSent;
+    uint64_t mask = 0;
+
+#define MARK_IF(cond, field) if (cond) mask |= TELEMETRY_FIELD_BIT(field)
+
+    MARK_IF(strcmp(current.firmware ? current.firmware : "", last.firmware ? last.firmware : "") != 0, TF_FIRMWARE);
+    MARK_IF(abs((int32_t)current.freeHeap - (int32_t)last.freeHeap) >= (int32_t)m_deadbands.heapBytes, TF_FREE_HEAP);
+
+    MARK_IF(current.wifiConnected != last.wifiConnected, TF_WIFI_CONNECTED);
+    MARK_IF(abs(current.wifiRssi - last.wifiRssi) >= m_deadbands.rssiDbm, TF_WIFI_RSSI);
+    MARK_IF(strcmp(current.localIp, last.localIp) != 0, TF_LOCAL_IP);
+
+    MARK_IF(current.systemState != last.systemState, TF_SYSTEM_STATE);
+    MARK_IF(current.batteryLevel != last.batteryLevel, TF_BATTERY_LEVEL);
+    MARK_IF(current.alertActive != last.alertActive, TF_ALERT_ACTIVE);
+
+    MARK_IF(current.totalZones != last.totalZones, TF_TOTAL_ZONES);
+    MARK_IF(strcmp(current.currentZone, last.currentZone) != 0, TF_CURRENT_ZONE);
+    MARK_IF(current.zoneBreaches != last.zoneBreaches, TF_ZONE_BREACHES);
+
+    MARK_IF(current.detectedBeacons != last.detectedBeacons, TF_DETECTED_COUNT);
+    MARK_IF(current.activeBeacons != last.activeBeacons, TF_ACTIVE_BEACONS);
+
+    MARK_IF(current.filterEnabled != last.filterEnabled, TF_ENABLED);
+    if (current.filterEnabled != last.filterEnabled) {
+        // Turned on: send every parameter. Turned off: clear them once
+        // (encoded as null), since they no longer exist
+        mask |= TELEMETRY_FILTER_FIELDS;
+    } else if (current.filterEnabled) {
+        MARK_IF(current.filterType != last.filterType, TF_FILTER_TYPE);
+        MARK_IF(current.iirAlpha != last.iirAlpha, TF_IIR_ALPHA);
+        MARK_IF(current.kalmanQ != last.kalmanQ, TF_KALMAN_Q);
+        MARK_IF(current.kalmanR != last.kalmanR, TF_KALMAN_R);
+        MARK_IF(current.activeFilters != last.activeFilters, TF_ACTIVE_FILTERS);
+    }
+
+    if (current.hasPosition != last.hasPosition) {
+        // Position appeared (send all of it) or was lost (send null)
+        mask |= TELEMETRY_FIELD_BIT(TF_POSITION) | TELEMETRY_FIELD_BIT(TF_POS_X) |
+                TELEMETRY_FIELD_BIT(TF_POS_Y) | TELEMETRY_FIELD_BIT(TF_CONFIDENCE) |
+                TELEMETRY_FIELD_BIT(TF_ACCURACY);
+    } else if (current.hasPosition) {
+        float dx = current.posX - last.posX;
+        float dy = current.posY - last.posY;
+        if (dx * dx + dy * dy >= m_deadbands.positionM * m_deadbands.positionM) {
+            mask |= TELEMETRY_FIELD_BIT(TF_POS_X) | TELEMETRY_FIELD_BIT(TF_POS_Y);
+        }
+        MARK_IF(fabsf(current.posConfidence - last.posConfidence) >= m_deadbands.confidence, TF_CONFIDENCE);
+        MARK_IF(fabsf(current.posAccuracy - last.posAccuracy) >= m_deadbands.positionM, TF_ACCURACY);
+    }
+
+#undef MARK_IF
+
+    return mask;
+}
+
+TelemetryFrame TelemetryDeltaEncoder::encode(CborWriter& writer, const char* deviceId,
+                                             const TelemetrySnapshot& snapshot, uint32_t nowMs) {
+    m_pending = snapshot;
+
+    bool keyframe = !m_hasBaseline || m_forceKeyframe ||
+                    m_sinceKeyframe + 1 >= m_keyframeInterval ||
+                    (m_keyframeMaxMs > 0 && nowMs - m_lastKeyframeMs >= m_keyframeMaxMs);
+
+    if (keyframe) {
+        m_pendingFrame = TelemetryFrame::KEYFRAME;
+        m_pendingMask = TELEMETRY_ALL_FIELDS;
+    } else {
+        uint64_t changed = changedFields(snapshot);
+        m_pendingMask = changed & ~TELEMETRY_KEYFRAME_ONLY_FIELDS;
+        if (!snapshot.filterEnabled) {
+            // The one-time clear includes the keyframe-only update counter
+            m_pendingMask |= changed & TELEMETRY_FILTER_FIELDS;
+        }
+        m_pendingFrame = m_pendingMask ? TelemetryFrame::DELTA : TelemetryFrame::SUPPRESSED;
+    }
+
+    if (m_pendingFrame == TelemetryFrame::SUPPRESSED) {
+        m_pendingLength = 0;
+        m_stats.suppressed++;
+        return m_pendingFrame;
+    }
+
+    m_pendingLength = encodeTelemetryCbor(writer, deviceId, snapshot, m_sequence + 1, m_pendingMask,
+                                          keyframe ? TelemetryMessage::TELEMETRY
+                                                   : TelemetryMessage::TELEMETRY_DELTA);
+    if (keyframe) {
+        m_pendingFullLength = m_pendingLength;
+    }
+    return m_pendingFrame;
+}
+
+void TelemetryDeltaEncoder::markSent(bool published) {
+    if (m_pendingFrame == TelemetryFrame::SUPPRESSED) {
+        return;
+    }
+
+    if (!published || m_pendingLength == 0) {
+        // The backend may be missing this message; resynchronize with a keyframe
+        m_forceKeyframe = true;
+        m_stats.failed++;
+        return;
+    }
+
+    m_sequence++;
+    m_stats.bytesSent += m_pendingLength;
+    m_stats.fullBytesEquivalent += m_pendingFullLength;
+
+    if (m_pendingFrame == TelemetryFrame::KEYFRAME) {
+        m_lastSent = m_pending;
+        m_hasBaseline = true;
+        m_forceKeyframe = false;
+        m_sinceKeyframe = 0;
+        m_lastKeyframeMs = m_pending.timestamp;
+        m_stats.keyframes++;
+        return;
+    }
+
+    // Only fields that were sent move the baseline; the rest keep drifting
+    // against the value the backend actually holds
+    const TelemetrySnapshot& sent = m_pending;
+    uint64_t mask = m_pendingMask;
+    TelemetrySnapshot& base = m_lastSent;
+
+#define TAKE_IF(field, member) if (mask & TELEMETRY_FIELD_BIT(field)) base.member = sent.member
+
+    TAKE_IF(TF_FIRMWARE, firmware);
+    TAKE_IF(TF_FREE_HEAP, freeHeap);
+    TAKE_IF(TF_WIFI_CONNECTED, wifiConnected);
+    TAKE_IF(TF_WIFI_RSSI, wifiRssi);
+    if (mask & TELEMETRY_FIELD_BIT(TF_LOCAL_IP)) memcpy(base.localIp, sent.localIp, sizeof(base.localIp));
+    TAKE_IF(TF_SYSTEM_STATE, systemState);
+    TAKE_IF(TF_BATTERY_LEVEL, batteryLevel);
+    TAKE_IF(TF_ALERT_ACTIVE, alertActive);
+    TAKE_IF(TF_TOTAL_ZONES, totalZones);
+    if (mask & TELEMETRY_FIELD_BIT(TF_CURRENT_ZONE)) memcpy(base.currentZone, sent.currentZone, sizeof(base.currentZone));
+    TAKE_IF(TF_ZONE_BREACHES, zoneBreaches);
+    TAKE_IF(TF_DETECTED_COUNT, detectedBeacons);
+    TAKE_IF(TF_ACTIVE_BEACONS, activeBeacons);
+    TAKE_IF(TF_ENABLED, filterEnabled);
+    TAKE_IF(TF_FILTER_TYPE, filterType);
+    TAKE_IF(TF_IIR_ALPHA, iirAlpha);
+    TAKE_IF(TF_KALMAN_Q, kalmanQ);
+    TAKE_IF(TF_KALMAN_R, kalmanR);
+    TAKE_IF(TF_ACTIVE_FILTERS, activeFilters);
+    TAKE_IF(TF_POSITION, hasPosition);
+    TAKE_IF(TF_POS_X, posX);
+    TAKE_IF(TF_POS_Y, posY);
+    TAKE_IF(TF_CONFIDENCE, posConfidence);
+    TAKE_IF(TF_ACCURACY, posAccuracy);
+
+#undef TAKE_IF
+
+    base.timestamp = sent.timestamp;
+    m_sinceKeyframe++;
+    m_stats.deltas++;
+}
+
+const char* telemetryFrameToString(TelemetryFrame frame) {
+    switch (frame) {
+        case TelemetryFrame::KEYFRAME: return "KEYFRAME";
+        case TelemetryFrame::DELTA: return "DELTA";
+        case TelemetryFrame::SUPPRESSED: return "SUPPRESSED";
+        default: return "UNKNOWN";
+    }
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+TelemetrySnapshot makeSnapshot(uint32_t timestamp) {
+    TelemetrySnapshot snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.timestamp = timestamp;
+    snapshot.uptime = timestamp;
+    snapshot.firmware = "test";
+    snapshot.freeHeap = 200000;
+    snapshot.wifiConnected = true;
+    snapshot.wifiRssi = -60;
+    strcpy(snapshot.localIp, "192.168.1.50");
+    snapshot.batteryLevel = 80;
+    strcpy(snapshot.currentZone, "yard");
+    snapshot.filterEnabled = true;
+    snapshot.iirAlpha = 0.3f;
+    snapshot.kalmanQ = 0.01f;
+    snapshot.kalmanR = 2.0f;
+    snapshot.hasPosition = true;
+    snapshot.posX = 1.0f;
+    snapshot.posY = 2.0f;
+    snapshot.posConfidence = 0.8f;
+    snapshot.posAccuracy = 0.5f;
+    return snapshot;
+}
+
+/**
+ * @brief Publish one snapshot through the encoder as the sketch does
+ */
+TelemetryFrame publish(TelemetryDeltaEncoder& encoder, CborWriter& writer,
+                       const TelemetrySnapshot& snapshot, bool brokerUp = true) {
+    TelemetryFrame frame = encoder.encode(writer, "001", snapshot, snapshot.timestamp);
+    encoder.markSent(brokerUp);
+    return frame;
+}
+
+/**
+ * @brief Noise inside the deadbands is suppressed; drift past them is sent
+ */
+bool testDeadbands() {
+    Serial.println("📊 Test 1: Deadbands suppress noise but not accumulated drift");
+
+    static uint8_t buffer[TELEMETRY_BUFFER_SIZE];
+    CborWriter writer(buffer, sizeof(buffer));
+    TelemetryDeltaEncoder encoder;
+    TelemetrySnapshot snapshot = makeSnapshot(0);
+
+    bool passed = publish(encoder, writer, snapshot) == TelemetryFrame::KEYFRAME;
+    size_t keyframeLength = encoder.getPendingLength();
+
+    // Counters and small jitter alone publish nothing
+    snapshot = makeSnapshot(30000);
+    snapshot.filterUpdates = 500;
+    snapshot.wifiRssi = -62;
+    snapshot.freeHeap -= 1000;
+    snapshot.posX += 0.1f;
+    passed = passed && publish(encoder, writer, snapshot) == TelemetryFrame::SUPPRESSED;
+
+    // RSSI keeps drifting in small steps until it crosses the deadband
+    snapshot.timestamp = 60000;
+    snapshot.wifiRssi = -64;
+    passed = passed && publish(encoder, writer, snapshot) == TelemetryFrame::DELTA &&
+             encoder.getPendingMask() == TELEMETRY_FIELD_BIT(TF_WIFI_RSSI);
+    size_t deltaLength = encoder.getPendingLength();
+
+    // A state change is exact
+    snapshot.timestamp = 90000;
+    snapshot.alertActive = true;
+    passed = passed && publish(encoder, writer, snapshot) == TelemetryFrame::DELTA &&
+             encoder.getPendingMask() == TELEMETRY_FIELD_BIT(TF_ALERT_ACTIVE);
+
+    Serial.printf("   Keyframe %u bytes, RSSI delta %u bytes\n",
+                 (unsigned)keyframeLength, (unsigned)deltaLength);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Keyframes repeat on schedule and after a publish the broker missed
+ */
+bool testKeyframes() {
+    Serial.println("📊 Test 2: Periodic keyframes and resync after failed publish");
+
+    static uint8_t buffer[TELEMETRY_BUFFER_SIZE];
+    CborWriter writer(buffer, sizeof(buffer));
+    TelemetryDeltaEncoder encoder;
+    encoder.setKeyframeInterval(4, 0);
+
+    uint8_t keyframes = 0;
+    for (uint32_t i = 0; i < 6; i++) {
+        TelemetrySnapshot snapshot = makeSnapshot(i * 30000);
+        snapshot.batteryLevel = 80 - i;    // Always a delta
+        if (publish(encoder, writer, snapshot) == TelemetryFrame::KEYFRAME) {
+            keyframes++;
+        }
+    }
+    bool passed = keyframes == 2 && encoder.getSequence() == 6;
+
+    // Broker missed a delta: sequence does not advance and the next one is a keyframe
+    TelemetrySnapshot snapshot = makeSnapshot(180000);
+    snapshot.batteryLevel = 50;
+    passed = passed && publish(encoder, writer, snapshot, false) == TelemetryFrame::DELTA;
+    passed = passed && encoder.getSequence() == 6;
+    passed = passed && publish(encoder, writer, snapshot) == TelemetryFrame::KEYFRAME;
+
+    Serial.printf("   Keyframes in 6 publishes: %u, sequence: %lu\n",
+                 keyframes, (unsigned long)encoder.getSequence());
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Losing the position fix is sent explicitly
+ */
+bool testPositionLoss() {
+    Serial.println("📊 Test 3: Lost position is published as a removal");
+
+    static uint8_t buffer[TELEMETRY_BUFFER_SIZE];
+    CborWriter writer(buffer, sizeof(buffer));
+    TelemetryDeltaEncoder encoder;
+
+    TelemetrySnapshot snapshot = makeSnapshot(0);
+    publish(encoder, writer, snapshot);
+
+    snapshot.timestamp = 30000;
+    snapshot.hasPosition = false;
+    bool passed = publish(encoder, writer, snapshot) == TelemetryFrame::DELTA &&
+                  (encoder.getPendingMask() & TELEMETRY_FIELD_BIT(TF_POSITION));
+
+    // The encoded payload ends with: key TF_POSITION, null, break
+    const uint8_t* data = writer.data();
+    size_t length = encoder.getPendingLength();
+    passed = passed && length >= 3 && data[length - 3] == TF_POSITION &&
+             data[length - 2] == 0xF6 && data[length - 1] == 0xFF;
+
+    // Still no position: nothing further to say
+    snapshot.timestamp = 60000;
+    passed = passed && publish(encoder, writer, snapshot) == TelemetryFrame::SUPPRESSED;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Turning the filter off clears its fields once
+ */
+bool testFilterDisabled() {
+    Serial.println("📊 Test 4: Disabled temporal filter clears its fields once");
+
+    static uint8_t buffer[TELEMETRY_BUFFER_SIZE];
+    CborWriter writer(buffer, sizeof(buffer));
+    TelemetryDeltaEncoder encoder;
+
+    TelemetrySnapshot snapshot = makeSnapshot(0);
+    snapshot.activeFilters = 3;
+    snapshot.filterUpdates = 100;
+    publish(encoder, writer, snapshot);
+
+    // Parameters left in the snapshot must not leak out while disabled
+    snapshot.timestamp = 30000;
+    snapshot.filterEnabled = false;
+    const uint64_t parameters = TELEMETRY_FIELD_BIT(TF_FILTER_TYPE) | TELEMETRY_FIELD_BIT(TF_IIR_ALPHA) |
+                                TELEMETRY_FIELD_BIT(TF_KALMAN_Q) | TELEMETRY_FIELD_BIT(TF_KALMAN_R) |
+                                TELEMETRY_FIELD_BIT(TF_ACTIVE_FILTERS);
+    bool passed = publish(encoder, writer, snapshot) == TelemetryFrame::DELTA &&
+                  encoder.getPendingMask() == (TELEMETRY_FIELD_BIT(TF_ENABLED) | parameters |
+                                               TELEMETRY_FIELD_BIT(TF_TOTAL_UPDATES));
+
+    // The payload ends with the last cleared field: key TF_TOTAL_UPDATES, null,
+    // then the breaks of the filter map and the message
+    const uint8_t* data = writer.data();
+    size_t length = encoder.getPendingLength();
+    passed = passed && length >= 4 && data[length - 4] == TF_TOTAL_UPDATES &&
+             data[length - 3] == 0xF6 && data[length - 2] == 0xFF && data[length - 1] == 0xFF;
+
+    // Nothing further while it stays off, even if the stale values change
+    snapshot.timestamp = 60000;
+    snapshot.kalmanR = 5.0f;
+    passed = passed && publish(encoder, writer, snapshot) == TelemetryFrame::SUPPRESSED;
+
+    // Turning it back on resends every parameter, changed or not
+    snapshot.timestamp = 90000;
+    snapshot.filterEnabled = true;
+    passed = passed && publish(encoder, writer, snapshot) == TelemetryFrame::DELTA &&
+             encoder.getPendingMask() == (TELEMETRY_FIELD_BIT(TF_ENABLED) | parameters);
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runTelemetryDeltaTests() {
+    Serial.println("\n🧪 Running Telemetry Delta Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testDeadbands();
+    passed &= testKeyframes();
+    passed &= testPositionLoss();
+    passed &= testFilterDisabled();
+
+    Serial.printf("\n%s Telemetry Delta Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file trace_buffer.cpp
+ * @brief Lock-free binary event trace ring
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/TraceBuffer.h"
+
+#define TRACE_EVENT_NAME(name, id, phase, label, arg0, arg1) case TraceEvent::name: return label;
+
+#if FEATURE_TRACE
+static TraceSlot traceSlots[TRACE_BUFFER_RECORDS];
+TraceBuffer traceBuffer(traceSlots, TRACE_BUFFER_RECORDS);
+#endif
+
+// ==================== WRITERS ====================
+
+void IRAM_ATTR TraceBuffer::record(TraceEvent event, int32_t arg0, int32_t arg1) {
+    uint32_t index = m_head.fetch_add(1, std::memory_order_relaxed);
+    TraceSlot& slot = m_slots[index & m_mask];
+
+    // Mark the slot busy before touching it so a reader copying it sees the change
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.record.timestampUs = micros();
+    slot.record.event = (uint16_t)event;
+    slot.record.core = (uint8_t)xPortGetCoreID();
+    slot.record.reserved = 0;
+    slot.record.arg0 = arg0;
+    slot.record.arg1 = arg1;
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+// ==================== READER ====================
+
+size_t TraceBuffer::drain(TraceRecord* out, size_t maxRecords, uint32_t& lost) {
+    uint32_t head = m_head.load(std::memory_order_acquire);
+    uint32_t capacity = m_mask + 1;
+
+    // Everything older than one ring behind the head has been overwritten
+    if (head - m_readCursor > capacity) {
+        uint32_t skipped = head - capacity - m_readCursor;
+        lost += skipped;
+        m_totalLost += skipped;
+        m_readCursor = head - capacity;
+    }
+
+    size_t copied = 0;
+    while (copied < maxRecords && m_readCursor != head) {
+        TraceSlot& slot = m_slots[m_readCursor & m_mask];
+        uint32_t expected = m_readCursor + 1;
+        uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if (sequence != expected) {
+            if (sequence != 0 && (int32_t)(sequence - expected) < 0) {
+                break;      // Claimed but not yet written: stop here, read it next time
+            }
+            // Overwritten by a newer record, or being overwritten right now
+            if (sequence != 0 || m_head.load(std::memory_order_acquire) - m_readCursor > capacity) {
+                lost++;
+                m_totalLost++;
+                m_readCursor++;
+                continue;
+            }
+            break;          // First write of this slot still in progress
+        }
+
+        TraceRecord copy = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            lost++;         // A writer lapped us while copying
+            m_totalLost++;
+            m_readCursor++;
+            continue;
+        }
+
+        out[copied++] = copy;
+        m_readCursor++;
+    }
+    return copied;
+}
+
+size_t TraceBuffer::writeBatch(uint8_t* buffer, size_t capacity) {
+    if (capacity < sizeof(TraceBatchHeader) + sizeof(TraceRecord)) {
+        return 0;
+    }
+    size_t maxRecords = (capacity - sizeof(TraceBatchHeader)) / sizeof(TraceRecord);
+    if (maxRecords > TRACE_BATCH_RECORDS) {
+        maxRecords = TRACE_BATCH_RECORDS;
+    }
+
+    uint32_t lost = 0;
+    TraceRecord* records = (TraceRecord*)(buffer + sizeof(TraceBatchHeader));
+    size_t count = drain(records, maxRecords, lost);
+    if (count == 0 && lost == 0) {
+        return 0;
+    }
+
+    TraceBatchHeader header;
+    memcpy(header.magic, TRACE_BATCH_MAGIC, sizeof(header.magic));
+    header.version = TRACE_BATCH_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.count = (uint16_t)count;
+    header.lost = lost;
+    header.nowUs = micros();
+    memcpy(buffer, &header, sizeof(header));
+    return sizeof(TraceBatchHeader) + count * sizeof(TraceRecord);
+}
+
+void TraceBuffer::clear() {
+    m_readCursor = m_head.load(std::memory_order_acquire);
+}
+
+const char* traceEventToString(TraceEvent event) {
+    switch (event) {
+        TRACE_EVENTS(TRACE_EVENT_NAME)
+    }
+    return "unknown";
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+const uint32_t TEST_RING_SIZE = 64;
+
+void resetSlots(TraceSlot* slots) {
+    for (uint32_t i = 0; i < TEST_RING_SIZE; i++) {
+        slots[i].sequence.store(0);
+    }
+}
+
+/**
+ * @brief Records come back in order with their fields, once
+ */
+bool testRecordAndDrain() {
+    Serial.println("📊 Test 1: Record and drain");
+
+    static TraceSlot slots[TEST_RING_SIZE];
+    resetSlots(slots);
+    TraceBuffer trace(slots, TEST_RING_SIZE);
+
+    uint32_t before = micros();
+    trace.record(TraceEvent::BLE_ADVERT, traceNameHash("Kitchen"), -61);
+    trace.record(TraceEvent::PROXIMITY_CHECK, traceNameHash("Kitchen"), 42);
+    trace.record(TraceEvent::MARK, 7, 0);
+
+    TraceRecord records[8];
+    uint32_t lost = 0;
+    size_t count = trace.drain(records, 8, lost);
+    bool passed = count == 3 && lost == 0 && trace.getPending() == 0 &&
+                  records[0].event == (uint16_t)TraceEvent::BLE_ADVERT &&
+                  records[0].arg0 == traceNameHash("Kitchen") && records[0].arg1 == -61 &&
+                  records[1].arg1 == 42 && records[2].event == (uint16_t)TraceEvent::MARK &&
+                  records[2].arg0 == 7 && records[0].timestampUs - before < 1000000 &&
+                  records[2].timestampUs - records[0].timestampUs < 1000000;
+
+    passed = passed && trace.drain(records, 8, lost) == 0 &&
+             strcmp(traceEventToString(TraceEvent::BLE_SCAN_END), "ble_scan") == 0;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A lapped reader gets the newest ring's worth and counts the rest as lost
+ */
+bool testOverwrite() {
+    Serial.println("📊 Test 2: Overwrite oldest and count losses");
+
+    static TraceSlot slots[TEST_RING_SIZE];
+    resetSlots(slots);
+    TraceBuffer trace(slots, TEST_RING_SIZE);
+
+    for (int32_t i = 0; i < (int32_t)TEST_RING_SIZE + 100; i++) {
+        trace.record(TraceEvent::MARK, i, 0);
+    }
+
+    TraceRecord records[TEST_RING_SIZE];
+    uint32_t lost = 0;
+    size_t count = trace.drain(records, TEST_RING_SIZE, lost);
+    bool passed = count == TEST_RING_SIZE && lost == 100 && records[0].arg0 == 100 &&
+                  records[TEST_RING_SIZE - 1].arg0 == (int32_t)TEST_RING_SIZE + 99 &&
+                  trace.getTotalLost() == 100;
+
+    // clear() skips what has not been read
+    trace.record(TraceEvent::MARK, 1, 0);
+    trace.clear();
+    passed = passed && trace.getPending() == 0 && trace.drain(records, TEST_RING_SIZE, lost) == 0;
+
+    Serial.printf("   %u records kept, %lu lost\n", (unsigned)count, (unsigned long)lost);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Batches carry a header and at most TRACE_BATCH_RECORDS records
+ */
+bool testBatches() {
+    Serial.println("📊 Test 3: Batch framing");
+
+    static TraceSlot slots[TEST_RING_SIZE];
+    resetSlots(slots);
+    TraceBuffer trace(slots, TEST_RING_SIZE);
+    for (int32_t i = 0; i < TRACE_BATCH_RECORDS + 8; i++) {
+        trace.record(TraceEvent::BEACON_UPDATE, i, -70);
+    }
+
+    static uint8_t buffer[TRACE_BATCH_BYTES];
+    TraceBatchHeader header;
+    size_t first = trace.writeBatch(buffer, sizeof(buffer));
+    memcpy(&header, buffer, sizeof(header));
+    bool passed = first == TRACE_BATCH_BYTES && memcmp(header.magic, TRACE_BATCH_MAGIC, 4) == 0 &&
+                  header.version == TRACE_BATCH_VERSION && header.recordSize == sizeof(TraceRecord) &&
+                  header.count == TRACE_BATCH_RECORDS && header.lost == 0;
+
+    size_t second = trace.writeBatch(buffer, sizeof(buffer));
+    TraceRecord last;
+    memcpy(&header, buffer, sizeof(header));
+    memcpy(&last, buffer + sizeof(header) + 7 * sizeof(TraceRecord), sizeof(last));
+    passed = passed && header.count == 8 && second == sizeof(header) + 8 * sizeof(TraceRecord) &&
+             last.arg0 == TRACE_BATCH_RECORDS + 7 && trace.writeBatch(buffer, sizeof(buffer)) == 0;
+
+    Serial.printf("   Batches of %u and %u bytes\n", (unsigned)first, (unsigned)second);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runTraceBufferTests() {
+    Serial.println("\n🧪 Running Trace Buffer Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testRecordAndDrain();
+    passed &= testOverwrite();
+    passed &= testBatches();
+
+    Serial.printf("\n%s Trace Buffer Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
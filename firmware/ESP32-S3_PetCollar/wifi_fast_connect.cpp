@@ -0,0 +1,244 @@
+/**
+ * @file wifi_fast_connect.cpp
+ * @brief Cached access point and DHCP lease for fast WiFi reconnects
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/WiFiFastConnect.h"
+
+// ==================== CACHE IMPLEMENTATION ====================
+
+WiFiFastConnect::WiFiFastConnect() : m_valid(false), m_pendingPath(WiFiFastPath::SCAN) {
+    memset(&m_record, 0, sizeof(m_record));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool WiFiFastConnect::restore(const void* data, size_t length) {
+    if (!data || length != sizeof(WiFiFastRecord)) {
+        return false;
+    }
+    WiFiFastRecord record;
+    memcpy(&record, data, sizeof(record));
+    if (record.version != WIFI_FAST_RECORD_VERSION || record.channel == 0 ||
+        record.ssid[0] == '\0' || memchr(record.ssid, '\0', sizeof(record.ssid)) == nullptr) {
+        return false;
+    }
+    m_record = record;
+    m_valid = true;
+    return true;
+}
+
+WiFiFastPath WiFiFastConnect::plan(const char* ssid) const {
+    if (!m_valid || !ssid || strcmp(ssid, m_record.ssid) != 0) {
+        return WiFiFastPath::SCAN;
+    }
+    if (m_record.ip == 0 || m_record.leaseUses >= WIFI_FAST_LEASE_REUSES) {
+        return WiFiFastPath::TARGETED;
+    }
+    return WiFiFastPath::FULL;
+}
+
+void WiFiFastConnect::beginAttempt(WiFiFastPath path) {
+    m_pendingPath = path;
+    if (path != WiFiFastPath::SCAN) {
+        m_stats.fastAttempts++;
+    }
+}
+
+bool WiFiFastConnect::recordFailure(uint32_t elapsedMs) {
+    m_stats.fastFailures++;
+    m_stats.lastConnectMs = elapsedMs;
+    m_pendingPath = WiFiFastPath::SCAN;   // The fallback scans
+    if (!m_valid) {
+        return false;
+    }
+    if (++m_record.failures >= WIFI_FAST_MAX_FAILURES) {
+        clear();
+    }
+    return true;
+}
+
+bool WiFiFastConnect::recordConnected(const char* ssid, const uint8_t* bssid, uint8_t channel,
+                                      uint32_t ip, uint32_t gateway, uint32_t subnet,
+                                      uint32_t dns1, uint32_t dns2, uint32_t elapsedMs) {
+    WiFiFastPath path = m_pendingPath;
+    m_pendingPath = WiFiFastPath::SCAN;
+    m_stats.lastConnectMs = elapsedMs;
+    m_stats.lastPath = path;
+    if (path == WiFiFastPath::SCAN) {
+        m_stats.scanConnects++;
+    } else {
+        m_stats.fastConnects++;
+    }
+
+    if (!ssid || strlen(ssid) >= sizeof(m_record.ssid) || !bssid || channel == 0) {
+        return false;
+    }
+
+    WiFiFastRecord record;
+    memset(&record, 0, sizeof(record));
+    record.version = WIFI_FAST_RECORD_VERSION;
+    record.channel = channel;
+    memcpy(record.bssid, bssid, sizeof(record.bssid));
+    record.ip = ip;
+    record.gateway = gateway;
+    record.subnet = subnet;
+    record.dns1 = dns1;
+    record.dns2 = dns2;
+    strlcpy(record.ssid, ssid, sizeof(record.ssid));
+    // Only a connect on the cached lease uses it up; DHCP starts it afresh
+    if (path == WiFiFastPath::FULL && m_valid && m_record.leaseUses < 255) {
+        record.leaseUses = m_record.leaseUses + 1;
+    }
+
+    if (m_valid && memcmp(&record, &m_record, sizeof(record)) == 0) {
+        return false;
+    }
+    m_record = record;
+    m_valid = true;
+    return true;
+}
+
+void WiFiFastConnect::clear() {
+    memset(&m_record, 0, sizeof(m_record));
+    m_valid = false;
+}
+
+const char* wifiFastPathToString(WiFiFastPath path) {
+    switch (path) {
+        case WiFiFastPath::TARGETED: return "bssid+dhcp";
+        case WiFiFastPath::FULL:     return "bssid+lease";
+        default:                     return "scan";
+    }
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+const uint8_t TEST_BSSID[6] = {0x24, 0x0A, 0xC4, 0x11, 0x22, 0x33};
+const uint32_t TEST_IP = 0x6401A8C0;        // 192.168.1.100
+const uint32_t TEST_GATEWAY = 0x0101A8C0;   // 192.168.1.1
+const uint32_t TEST_SUBNET = 0x00FFFFFF;
+
+bool connectTest(WiFiFastConnect& cache, const char* ssid, uint8_t channel = 6) {
+    cache.beginAttempt(cache.plan(ssid));
+    return cache.recordConnected(ssid, TEST_BSSID, channel, TEST_IP, TEST_GATEWAY,
+                                 TEST_SUBNET, TEST_GATEWAY, 0, 100);
+}
+
+/**
+ * @brief A scanned connect is cached; the next one to that SSID skips scan and DHCP
+ */
+bool testCacheAfterScan() {
+    Serial.println("📊 Test 1: Connect is cached for the next one");
+
+    WiFiFastConnect cache;
+    bool passed = cache.plan("HomeAP") == WiFiFastPath::SCAN;
+    passed = passed && connectTest(cache, "HomeAP");
+    passed = passed && cache.plan("HomeAP") == WiFiFastPath::FULL &&
+             cache.plan("OtherAP") == WiFiFastPath::SCAN &&
+             cache.getRecord().channel == 6 && cache.getRecord().ip == TEST_IP;
+
+    // Nothing new learned from another scan on the same AP: no flash write
+    cache.beginAttempt(WiFiFastPath::SCAN);
+    passed = passed && !cache.recordConnected("HomeAP", TEST_BSSID, 6, TEST_IP, TEST_GATEWAY,
+                                              TEST_SUBNET, TEST_GATEWAY, 0, 100);
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief The cached lease is renewed through DHCP after WIFI_FAST_LEASE_REUSES uses
+ */
+bool testLeaseRenewal() {
+    Serial.println("📊 Test 2: Cached lease renewed by DHCP periodically");
+
+    WiFiFastConnect cache;
+    connectTest(cache, "HomeAP");
+    bool passed = true;
+    for (uint8_t i = 0; i < WIFI_FAST_LEASE_REUSES; i++) {
+        passed = passed && cache.plan("HomeAP") == WiFiFastPath::FULL && connectTest(cache, "HomeAP");
+    }
+    passed = passed && cache.plan("HomeAP") == WiFiFastPath::TARGETED;
+    connectTest(cache, "HomeAP");
+    passed = passed && cache.getRecord().leaseUses == 0 && cache.plan("HomeAP") == WiFiFastPath::FULL;
+
+    // A roam to another channel replaces the record
+    passed = passed && connectTest(cache, "HomeAP", 11) && cache.getRecord().channel == 11;
+
+    const WiFiFastStats& stats = cache.getStats();
+    passed = passed && stats.scanConnects == 1 && stats.fastConnects == WIFI_FAST_LEASE_REUSES + 2;
+
+    Serial.printf("   Lease reused %d times between DHCP renewals\n", WIFI_FAST_LEASE_REUSES);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Repeated fast-connect failures drop the record
+ */
+bool testFailuresDropRecord() {
+    Serial.println("📊 Test 3: Failing fast connects fall back to scanning");
+
+    WiFiFastConnect cache;
+    connectTest(cache, "HomeAP");
+    bool passed = true;
+
+    // A failure followed by a success keeps the record
+    cache.beginAttempt(cache.plan("HomeAP"));
+    passed = passed && cache.recordFailure(3000) && cache.isValid();
+    connectTest(cache, "HomeAP");
+    passed = passed && cache.getRecord().failures == 0;
+
+    for (uint8_t i = 0; i < WIFI_FAST_MAX_FAILURES; i++) {
+        cache.beginAttempt(cache.plan("HomeAP"));
+        cache.recordFailure(3000);
+    }
+    passed = passed && !cache.isValid() && cache.plan("HomeAP") == WiFiFastPath::SCAN &&
+             cache.getStats().fastFailures == WIFI_FAST_MAX_FAILURES + 1;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Records round-trip through flash; stale or short blobs are ignored
+ */
+bool testRestore() {
+    Serial.println("📊 Test 4: Stored record restore and validation");
+
+    WiFiFastConnect cache;
+    connectTest(cache, "HomeAP");
+    WiFiFastRecord stored = cache.getRecord();
+
+    WiFiFastConnect restored;
+    bool passed = restored.restore(&stored, sizeof(stored)) &&
+                  restored.plan("HomeAP") == WiFiFastPath::FULL;
+
+    WiFiFastConnect rejected;
+    passed = passed && !rejected.restore(&stored, sizeof(stored) - 1);
+    stored.version = WIFI_FAST_RECORD_VERSION + 1;
+    passed = passed && !rejected.restore(&stored, sizeof(stored)) && !rejected.isValid();
+
+    Serial.printf("   Record: %u bytes\n", (unsigned)sizeof(WiFiFastRecord));
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runWiFiFastConnectTests() {
+    Serial.println("\n🧪 Running WiFi Fast Connect Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testCacheAfterScan();
+    passed &= testLeaseRenewal();
+    passed &= testFailuresDropRecord();
+    passed &= testRestore();
+
+    Serial.printf("\n%s WiFi Fast Connect Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file wifi_roamer.cpp
+ * @brief RSSI-ranked access point table and roaming decisions
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/WiFiRoamer.h"
+
+#include <string.h>
+
+// ==================== ROAMER IMPLEMENTATION ====================
+
+WiFiRoamer::WiFiRoamer()
+    : m_count(0),
+      m_connected(false),
+      m_currentNetwork(-1),
+      m_linkRssiQ4(0),
+      m_scanning(false),
+      m_lastScanMs(0),
+      m_lastFullScanMs(0),
+      m_nextChannel(0),
+      m_lastRoamMs(0) {
+    memset(m_candidates, 0, sizeof(m_candidates));
+    memset(m_currentBssid, 0, sizeof(m_currentBssid));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+RoamCandidate* WiFiRoamer::find(const uint8_t* bssid) {
+    for (uint8_t i = 0; i < m_count; i++) {
+        if (memcmp(m_candidates[i].bssid, bssid, 6) == 0) {
+            return &m_candidates[i];
+        }
+    }
+    return nullptr;
+}
+
+bool WiFiRoamer::isCurrent(const RoamCandidate& candidate) const {
+    return m_connected && memcmp(candidate.bssid, m_currentBssid, 6) == 0;
+}
+
+bool WiFiRoamer::isUsable(const RoamCandidate& candidate, uint32_t nowMs) const {
+    return candidate.failedMs == 0 || nowMs - candidate.failedMs >= ROAM_FAIL_BACKOFF_MS;
+}
+
+uint8_t WiFiRoamer::knownChannels(uint8_t* channels) const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < m_count; i++) {
+        uint8_t channel = m_candidates[i].channel;
+        bool seen = false;
+        for (uint8_t j = 0; j < count && !seen; j++) {
+            seen = channels[j] == channel;
+        }
+        if (!seen) {
+            channels[count++] = channel;
+        }
+    }
+    return count;
+}
+
+void WiFiRoamer::setConnected(const uint8_t* bssid, uint8_t channel, int8_t network,
+                              int8_t rssi, uint32_t nowMs) {
+    memcpy(m_currentBssid, bssid, 6);
+    m_currentNetwork = network;
+    m_connected = true;
+    m_linkRssiQ4 = (int16_t)rssi * 16;
+    reportScanResult(bssid, channel, network, rssi, nowMs);
+    RoamCandidate* current = find(bssid);
+    if (current) {
+        current->failedMs = 0;
+    }
+}
+
+void WiFiRoamer::setDisconnected() {
+    m_connected = false;
+}
+
+void WiFiRoamer::reportLinkRssi(int8_t rssi) {
+    if (!m_connected || rssi == 0) {
+        return;     // 0 is what the driver reports without a link
+    }
+    m_linkRssiQ4 += ((int16_t)rssi * 16 - m_linkRssiQ4) / (1 << ROAM_RSSI_SHIFT);
+}
+
+RoamScanRequest WiFiRoamer::nextScan(uint32_t nowMs, bool radioIdle) {
+    RoamScanRequest request = {RoamScanType::NONE, 0};
+    if (!m_connected || m_scanning || !radioIdle) {
+        return request;
+    }
+    bool weak = getLinkRssi() < ROAM_SCAN_RSSI;
+    uint32_t interval = weak ? ROAM_SCAN_FAST_MS : ROAM_SCAN_SLOW_MS;
+    if (m_lastScanMs != 0 && nowMs - m_lastScanMs < interval) {
+        return request;
+    }
+
+    // A good link with nothing else known costs no scans at all
+    uint8_t channels[ROAM_MAX_CANDIDATES];
+    uint8_t channelCount = knownChannels(channels);
+    if (weak && (m_lastFullScanMs == 0 || nowMs - m_lastFullScanMs >= ROAM_FULL_SCAN_MS)) {
+        request.type = RoamScanType::FULL;
+        m_lastFullScanMs = nowMs;
+        m_stats.fullScans++;
+    } else if (channelCount > 1 || (weak && channelCount == 1)) {
+        request.type = RoamScanType::CHANNEL;
+        request.channel = channels[m_nextChannel % channelCount];
+        m_nextChannel = (m_nextChannel + 1) % channelCount;
+        m_stats.channelScans++;
+    } else {
+        return request;
+    }
+    m_scanning = true;
+    m_lastScanMs = nowMs ? nowMs : 1;
+    return request;
+}
+
+void WiFiRoamer::reportScanResult(const uint8_t* bssid, uint8_t channel, int8_t network,
+                                  int8_t rssi, uint32_t nowMs) {
+    RoamCandidate* candidate = find(bssid);
+    if (candidate) {
+        // Average with a recent reading; a stale one says nothing about now
+        if (nowMs - candidate->seenMs < ROAM_CANDIDATE_MAX_AGE_MS) {
+            rssi = (int8_t)(((int16_t)candidate->rssi + rssi) / 2);
+        }
+    } else if (m_count < ROAM_MAX_CANDIDATES) {
+        candidate = &m_candidates[m_count++];
+        memset(candidate, 0, sizeof(*candidate));
+    } else {
+        // Replace the oldest stale entry, or the weakest if all are fresh
+        RoamCandidate* victim = nullptr;
+        bool victimStale = false;
+        for (uint8_t i = 0; i < m_count; i++) {
+            RoamCandidate& entry = m_candidates[i];
+            if (isCurrent(entry)) {
+                continue;
+            }
+            bool stale = nowMs - entry.seenMs >= ROAM_CANDIDATE_MAX_AGE_MS;
+            if (!victim || (stale && !victimStale) ||
+                (stale == victimStale &&
+                 (stale ? entry.seenMs < victim->seenMs : entry.rssi < victim->rssi))) {
+                victim = &entry;
+                victimStale = stale;
+            }
+        }
+        if (!victim || (!victimStale && victim->rssi >= rssi)) {
+            return;
+        }
+        candidate = victim;
+        memset(candidate, 0, sizeof(*candidate));
+    }
+    memcpy(candidate->bssid, bssid, 6);
+    candidate->channel = channel;
+    candidate->network = network;
+    candidate->rssi = rssi;
+    candidate->seenMs = nowMs;
+}
+
+void WiFiRoamer::scanFinished() {
+    m_scanning = false;
+}
+
+const RoamCandidate* WiFiRoamer::pickRoamTarget(uint32_t nowMs) const {
+    if (!m_connected || m_scanning) {
+        return nullptr;
+    }
+    if (m_lastRoamMs != 0 && nowMs - m_lastRoamMs < ROAM_HOLD_MS) {
+        return nullptr;
+    }
+    int8_t link = getLinkRssi();
+    if (link >= ROAM_TRIGGER_RSSI) {
+        return nullptr;
+    }
+    const RoamCandidate* best = nullptr;
+    for (uint8_t i = 0; i < m_count; i++) {
+        const RoamCandidate& candidate = m_candidates[i];
+        if (isCurrent(candidate) || !isUsable(candidate, nowMs) ||
+            nowMs - candidate.seenMs >= ROAM_CANDIDATE_MAX_AGE_MS) {
+            continue;
+        }
+        if (!best || candidate.rssi > best->rssi) {
+            best = &candidate;
+        }
+    }
+    if (best && best->rssi >= link + ROAM_HYSTERESIS_DB) {
+        return best;
+    }
+    return nullptr;
+}
+
+uint8_t WiFiRoamer::rank(const RoamCandidate** out, uint8_t max, uint32_t nowMs) const {
+    const RoamCandidate* ranked[ROAM_MAX_CANDIDATES];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < m_count; i++) {
+        const RoamCandidate& candidate = m_candidates[i];
+        if (isCurrent(candidate) || !isUsable(candidate, nowMs)) {
+            continue;
+        }
+        // Insertion sort: fresh before stale, then strongest first
+        bool fresh = nowMs - candidate.seenMs < ROAM_CANDIDATE_MAX_AGE_MS;
+        uint8_t pos = count;
+        while (pos > 0) {
+            const RoamCandidate* prev = ranked[pos - 1];
+            bool prevFresh = nowMs - prev->seenMs < ROAM_CANDIDATE_MAX_AGE_MS;
+            if (prevFresh > fresh || (prevFresh == fresh && prev->rssi >= candidate.rssi)) {
+                break;
+            }
+            ranked[pos] = prev;
+            pos--;
+        }
+        ranked[pos] = &candidate;
+        count++;
+    }
+    if (count > max) {
+        count = max;
+    }
+    memcpy(out, ranked, count * sizeof(ranked[0]));
+    return count;
+}
+
+void WiFiRoamer::roamStarted(const RoamCandidate& target, uint32_t nowMs) {
+    m_lastRoamMs = nowMs ? nowMs : 1;
+    m_stats.roams++;
+    m_stats.lastRoamFromRssi = getLinkRssi();
+    m_stats.lastRoamToRssi = target.rssi;
+}
+
+void WiFiRoamer::connectFailed(const uint8_t* bssid, uint32_t nowMs) {
+    m_stats.failures++;
+    RoamCandidate* candidate = find(bssid);
+    if (candidate) {
+        candidate->failedMs = nowMs ? nowMs : 1;
+    }
+}
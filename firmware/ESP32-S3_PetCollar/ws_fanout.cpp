@@ -0,0 +1,494 @@
+/**
+ * @file ws_fanout.cpp
+ * @brief WebSocket broadcast fan-out with per-client backpressure
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/WsFanout.h"
+
+static uint32_t defaultClock() {
+    return millis();
+}
+
+static_assert(WS_FANOUT_MAX_CLIENTS <= 8, "Client masks are 8 bits wide");
+
+static bool isSnapshot(WsFrameKind kind) {
+    return kind == WsFrameKind::STATUS || kind == WsFrameKind::BEACONS;
+}
+
+// ==================== FAN-OUT IMPLEMENTATION ====================
+
+WsFanout::WsFanout() :
+    m_nextClient(0),
+    m_send(nullptr),
+    m_drop(nullptr),
+    m_context(nullptr),
+    m_clock(defaultClock) {
+    portMUX_INITIALIZE(&m_mux);
+    memset(m_clients, 0, sizeof(m_clients));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+WsFrame* WsFanout::createFrame(WsFrameKind kind, size_t length) {
+    WsFrame* frame = (WsFrame*)malloc(sizeof(WsFrame) + length);
+    if (!frame) {
+        return nullptr;
+    }
+    frame->kind = kind;
+    frame->refs = 1;
+    frame->length = length;
+    frame->data[length] = '\0';
+
+    portENTER_CRITICAL(&m_mux);
+    m_stats.frames++;
+    m_stats.liveFrames++;
+    portEXIT_CRITICAL(&m_mux);
+    return frame;
+}
+
+WsFrame* WsFanout::createFrame(WsFrameKind kind, const char* data, size_t length) {
+    WsFrame* frame = createFrame(kind, length);
+    if (frame) {
+        memcpy(frame->data, data, length);
+    }
+    return frame;
+}
+
+void WsFanout::release(WsFrame* frame) {
+    if (!frame) {
+        return;
+    }
+
+    portENTER_CRITICAL(&m_mux);
+    bool last = --frame->refs == 0;
+    if (last) {
+        m_stats.liveFrames--;
+    }
+    portEXIT_CRITICAL(&m_mux);
+
+    if (last) {
+        free(frame);
+    }
+}
+
+WsFrame* WsFanout::enqueueLocked(ClientQueue& queue, WsFrame* frame) {
+    frame->refs++;
+
+    // A newer snapshot replaces the one still waiting, in place
+    if (isSnapshot(frame->kind)) {
+        for (uint8_t i = 0; i < queue.count; i++) {
+            if (queue.frames[i]->kind == frame->kind) {
+                WsFrame* replaced = queue.frames[i];
+                queue.frames[i] = frame;
+                m_stats.coalesced++;
+                return replaced;
+            }
+        }
+    }
+
+    WsFrame* dropped = nullptr;
+    if (queue.count == WS_CLIENT_QUEUE_DEPTH) {
+        // Full: give up the oldest snapshot (a newer one will follow), else the oldest event
+        uint8_t victim = 0;
+        for (uint8_t i = 0; i < queue.count; i++) {
+            if (isSnapshot(queue.frames[i]->kind)) {
+                victim = i;
+                break;
+            }
+        }
+        dropped = queue.frames[victim];
+        memmove(&queue.frames[victim], &queue.frames[victim + 1],
+                (queue.count - victim - 1) * sizeof(WsFrame*));
+        queue.count--;
+        m_stats.dropped++;
+    }
+
+    queue.frames[queue.count++] = frame;
+    return dropped;
+}
+
+void WsFanout::broadcast(WsFrame* frame) {
+    multicast(0xFF, frame);
+}
+
+void WsFanout::multicast(uint8_t clientMask, WsFrame* frame) {
+    if (!frame) {
+        return;
+    }
+
+    WsFrame* released[WS_FANOUT_MAX_CLIENTS];
+    uint8_t releasedCount = 0;
+
+    portENTER_CRITICAL(&m_mux);
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        if (m_clients[i].connected && (clientMask & (1 << i))) {
+            WsFrame* old = enqueueLocked(m_clients[i], frame);
+            if (old) {
+                released[releasedCount++] = old;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&m_mux);
+
+    for (uint8_t i = 0; i < releasedCount; i++) {
+        release(released[i]);
+    }
+    release(frame);
+}
+
+void WsFanout::send(uint8_t client, WsFrame* frame) {
+    if (!frame) {
+        return;
+    }
+
+    WsFrame* old = nullptr;
+    portENTER_CRITICAL(&m_mux);
+    if (client < WS_FANOUT_MAX_CLIENTS && m_clients[client].connected) {
+        old = enqueueLocked(m_clients[client], frame);
+    }
+    portEXIT_CRITICAL(&m_mux);
+
+    release(old);
+    release(frame);
+}
+
+void WsFanout::onConnect(uint8_t client) {
+    if (client >= WS_FANOUT_MAX_CLIENTS) {
+        return;
+    }
+    clearClient(client);
+
+    portENTER_CRITICAL(&m_mux);
+    m_clients[client].connected = true;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+void WsFanout::onDisconnect(uint8_t client) {
+    if (client < WS_FANOUT_MAX_CLIENTS) {
+        clearClient(client);
+    }
+}
+
+void WsFanout::clearClient(uint8_t client) {
+    WsFrame* frames[WS_CLIENT_QUEUE_DEPTH];
+    uint8_t count;
+
+    portENTER_CRITICAL(&m_mux);
+    ClientQueue& queue = m_clients[client];
+    count = queue.count;
+    memcpy(frames, queue.frames, count * sizeof(WsFrame*));
+    queue.count = 0;
+    queue.strikes = 0;
+    queue.connected = false;
+    portEXIT_CRITICAL(&m_mux);
+
+    for (uint8_t i = 0; i < count; i++) {
+        release(frames[i]);
+    }
+}
+
+uint16_t WsFanout::service() {
+    if (!m_send) {
+        return 0;
+    }
+
+    uint32_t start = m_clock();
+    uint16_t sent = 0;
+    bool pending = true;
+
+    // One frame per client per round, so a slow client only delays itself
+    while (pending && m_clock() - start < WS_SEND_BUDGET_MS) {
+        pending = false;
+
+        for (uint8_t n = 0; n < WS_FANOUT_MAX_CLIENTS; n++) {
+            uint8_t client = (m_nextClient + n) % WS_FANOUT_MAX_CLIENTS;
+
+            WsFrame* frame = nullptr;
+            portENTER_CRITICAL(&m_mux);
+            ClientQueue& queue = m_clients[client];
+            if (queue.connected && queue.count > 0) {
+                frame = queue.frames[0];
+                memmove(&queue.frames[0], &queue.frames[1], (queue.count - 1) * sizeof(WsFrame*));
+                queue.count--;
+                pending = pending || queue.count > 0;
+            }
+            portEXIT_CRITICAL(&m_mux);
+
+            if (!frame) {
+                continue;
+            }
+
+            uint32_t sendStart = m_clock();
+            bool ok = m_send(client, frame->data, frame->length, m_context);
+            uint32_t elapsed = m_clock() - sendStart;
+            release(frame);
+
+            bool dropClient = false;
+            portENTER_CRITICAL(&m_mux);
+            if (ok) {
+                m_stats.sent++;
+                sent++;
+            }
+            if (!ok || elapsed >= WS_SLOW_SEND_MS) {
+                m_stats.slowSends++;
+                dropClient = ++queue.strikes >= WS_SLOW_CLIENT_STRIKES;
+                if (dropClient) {
+                    m_stats.disconnects++;
+                }
+            } else {
+                queue.strikes = 0;
+            }
+            portEXIT_CRITICAL(&m_mux);
+
+            if (dropClient) {
+                clearClient(client);
+                if (m_drop) {
+                    m_drop(client, m_context);
+                }
+            }
+
+            if (m_clock() - start >= WS_SEND_BUDGET_MS) {
+                pending = true;
+                break;
+            }
+        }
+
+        m_nextClient = (m_nextClient + 1) % WS_FANOUT_MAX_CLIENTS;
+    }
+
+    uint32_t duration = m_clock() - start;
+    if (duration > m_stats.maxServiceMs) {
+        m_stats.maxServiceMs = duration;
+    }
+    return sent;
+}
+
+uint8_t WsFanout::getClientCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        if (m_clients[i].connected) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint8_t WsFanout::getClientMask() const {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        if (m_clients[i].connected) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+uint8_t WsFanout::getQueuedCount(uint8_t client) const {
+    return client < WS_FANOUT_MAX_CLIENTS ? m_clients[client].count : 0;
+}
+
+uint8_t WsFanout::getStrikes(uint8_t client) const {
+    return client < WS_FANOUT_MAX_CLIENTS ? m_clients[client].strikes : 0;
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+/**
+ * @brief Simulated clients: each send advances the clock by the client's latency
+ */
+struct FakeTransport {
+    uint32_t nowMs;
+    uint32_t latencyMs[WS_FANOUT_MAX_CLIENTS];
+    uint16_t received[WS_FANOUT_MAX_CLIENTS];
+    char last[WS_FANOUT_MAX_CLIENTS][32];
+    bool dropped[WS_FANOUT_MAX_CLIENTS];
+};
+
+FakeTransport fake;
+
+uint32_t fakeClock() {
+    return fake.nowMs;
+}
+
+bool fakeSend(uint8_t client, const char* data, size_t length, void*) {
+    fake.nowMs += fake.latencyMs[client];
+    fake.received[client]++;
+    size_t copy = length < sizeof(fake.last[client]) - 1 ? length : sizeof(fake.last[client]) - 1;
+    memcpy(fake.last[client], data, copy);
+    fake.last[client][copy] = '\0';
+    return true;
+}
+
+/**
+ * @brief Like fakeSend() but keeps the first frame received instead of the last
+ */
+bool fakeSendFirst(uint8_t client, const char* data, size_t length, void*) {
+    if (fake.received[client]++ == 0) {
+        size_t copy = length < sizeof(fake.last[client]) - 1 ? length : sizeof(fake.last[client]) - 1;
+        memcpy(fake.last[client], data, copy);
+        fake.last[client][copy] = '\0';
+    }
+    return true;
+}
+
+void fakeDrop(uint8_t client, void*) {
+    fake.dropped[client] = true;
+}
+
+void setupFanout(WsFanout& fanout, uint8_t clients) {
+    memset(&fake, 0, sizeof(fake));
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        fake.latencyMs[i] = 1;
+    }
+    fanout.setTransport(fakeSend, fakeDrop, nullptr);
+    fanout.setClock(fakeClock);
+    for (uint8_t i = 0; i < clients; i++) {
+        fanout.onConnect(i);
+    }
+}
+
+void broadcastText(WsFanout& fanout, WsFrameKind kind, const char* text) {
+    fanout.broadcast(fanout.createFrame(kind, text, strlen(text)));
+}
+
+/**
+ * @brief One frame serves every client and is freed after the last send
+ */
+bool testSharedFrame() {
+    Serial.println("📊 Test 1: Broadcast is serialized once and shared");
+
+    WsFanout fanout;
+    setupFanout(fanout, 3);
+
+    broadcastText(fanout, WsFrameKind::ALERT, "{\"type\":\"proximity_alert\"}");
+    const WsFanoutStats& stats = fanout.getStats();
+    bool passed = stats.frames == 1 && stats.liveFrames == 1;
+
+    fanout.service();
+    passed = passed && stats.sent == 3 && stats.liveFrames == 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        passed = passed && fake.received[i] == 1 && strcmp(fake.last[i], "{\"type\":\"proximity_alert\"}") == 0;
+    }
+
+    Serial.printf("   Frames created: %lu, sends: %lu, live after service: %lu\n",
+                 (unsigned long)stats.frames, (unsigned long)stats.sent, (unsigned long)stats.liveFrames);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Waiting status frames are replaced by the latest; events are kept
+ */
+bool testCoalescing() {
+    Serial.println("📊 Test 2: Superseded status frames coalesce, events do not");
+
+    WsFanout fanout;
+    setupFanout(fanout, 1);
+
+    broadcastText(fanout, WsFrameKind::ALERT, "alert-1");
+    char status[16];
+    for (int i = 1; i <= 5; i++) {
+        snprintf(status, sizeof(status), "status-%d", i);
+        broadcastText(fanout, WsFrameKind::STATUS, status);
+    }
+    broadcastText(fanout, WsFrameKind::ALERT, "alert-2");
+
+    bool passed = fanout.getQueuedCount(0) == 3 && fanout.getStats().coalesced == 4 &&
+                  fanout.getStats().liveFrames == 3;
+
+    fanout.service();
+    passed = passed && fake.received[0] == 3 && strcmp(fake.last[0], "alert-2") == 0;
+
+    // Send order was alert-1, status-5, alert-2: check the status that went out
+    broadcastText(fanout, WsFrameKind::STATUS, "status-6");
+    fanout.service();
+    passed = passed && strcmp(fake.last[0], "status-6") == 0 && fanout.getStats().liveFrames == 0;
+
+    Serial.printf("   Queued after 7 broadcasts: 3, coalesced: %lu\n",
+                 (unsigned long)fanout.getStats().coalesced);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A full queue drops its oldest frames and stays bounded
+ */
+bool testBoundedQueue() {
+    Serial.println("📊 Test 3: Full queue drops oldest frames");
+
+    WsFanout fanout;
+    setupFanout(fanout, 1);
+
+    char alert[16];
+    for (int i = 1; i <= WS_CLIENT_QUEUE_DEPTH + 4; i++) {
+        snprintf(alert, sizeof(alert), "alert-%d", i);
+        broadcastText(fanout, WsFrameKind::ALERT, alert);
+    }
+
+    bool passed = fanout.getQueuedCount(0) == WS_CLIENT_QUEUE_DEPTH &&
+                  fanout.getStats().dropped == 4 &&
+                  fanout.getStats().liveFrames == WS_CLIENT_QUEUE_DEPTH;
+
+    // The first frame still queued is alert-5
+    fanout.setTransport(fakeSendFirst, fakeDrop, nullptr);
+    fanout.service();
+    passed = passed && strcmp(fake.last[0], "alert-5") == 0 && fanout.getStats().liveFrames == 0;
+
+    Serial.printf("   Queue depth %d, dropped %lu, first delivered %s\n", WS_CLIENT_QUEUE_DEPTH,
+                 (unsigned long)fanout.getStats().dropped, fake.last[0]);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief A persistently slow client is disconnected; the others keep up
+ */
+bool testSlowClient() {
+    Serial.println("📊 Test 4: Persistently slow client is disconnected");
+
+    WsFanout fanout;
+    setupFanout(fanout, 3);
+    fake.latencyMs[1] = WS_SLOW_SEND_MS + 30;
+
+    uint32_t rounds = 0;
+    while (!fake.dropped[1] && rounds < 50) {
+        broadcastText(fanout, WsFrameKind::ALERT, "alert");
+        broadcastText(fanout, WsFrameKind::STATUS, "status");
+        fanout.service();
+        fake.nowMs += 100;
+        rounds++;
+    }
+
+    bool passed = fake.dropped[1] && fanout.getClientCount() == 2 &&
+                  fanout.getStats().disconnects == 1 && rounds <= WS_SLOW_CLIENT_STRIKES + 1;
+
+    // Fast clients lose nothing and no frames leak once their queues drain
+    for (int i = 0; i < 10; i++) {
+        fanout.service();
+    }
+    passed = passed && fanout.getStats().dropped == 0 && fanout.getStats().liveFrames == 0 &&
+             fake.received[0] >= rounds && fake.received[2] >= rounds;
+
+    Serial.printf("   Dropped after %lu rounds, fast clients received %u and %u\n",
+                 (unsigned long)rounds, fake.received[0], fake.received[2]);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runWsFanoutTests() {
+    Serial.println("\n🧪 Running WebSocket Fan-out Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testSharedFrame();
+    passed &= testCoalescing();
+    passed &= testBoundedQueue();
+    passed &= testSlowClient();
+
+    Serial.printf("\n%s WebSocket Fan-out Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
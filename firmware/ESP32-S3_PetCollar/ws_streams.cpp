@@ -0,0 +1,568 @@
+/**
+ * @file ws_streams.cpp
+ * @brief Subscribed WebSocket live feed (delta frames per stream)
+ * @version 1.0.0
+ * @date 2024
+ */
+
+#include "include/WsStreams.h"
+
+#define WS_STREAM_DOC_SIZE 1536     // A perf frame with every stage is the largest
+
+static const char* const STREAM_NAMES[] = {"rssi", "distance", "position", "zone", "alerts", "perf"};
+static const char* const FRAME_TYPES[] = {"rssi", "dist", "pos", "zone", "alert", "perf"};
+
+static_assert(sizeof(STREAM_NAMES) / sizeof(STREAM_NAMES[0]) == (size_t)WsStream::COUNT,
+              "One name per stream");
+
+static bool isBeaconStream(WsStream stream) {
+    return stream == WsStream::RSSI || stream == WsStream::DISTANCE;
+}
+
+// Values go out as integers (cm, percent) to keep frames short
+static int32_t toInt(float value, float scale) {
+    return (int32_t)lroundf(value * scale);
+}
+
+/**
+ * @brief Append one beacon entry to a stream frame
+ */
+static void addBeaconEntry(JsonArray& beacons, WsStream stream, const WsStreamBeacon& beacon) {
+    JsonArray entry = beacons.createNestedArray();
+    entry.add((const char*)beacon.name);
+    if (stream == WsStream::RSSI) {
+        entry.add(beacon.rawRssi);
+        entry.add(beacon.smoothedRssi);
+    } else {
+        entry.add(toInt(beacon.distance, 1.0f));
+        entry.add(toInt(beacon.confidence, 100.0f));
+    }
+}
+
+// ==================== HUB IMPLEMENTATION ====================
+
+WsStreamHub::WsStreamHub(WsFanout& fanout) :
+    m_fanout(fanout),
+    m_sequence(0),
+    m_hasPosition(false),
+    m_posX(0.0f),
+    m_posY(0.0f),
+    m_posConfidence(0.0f),
+    m_posAccuracy(0.0f),
+    m_positionSequence(0),
+    m_zoneSequence(0),
+    m_profiler(nullptr) {
+    portMUX_INITIALIZE(&m_mux);
+    memset(m_beacons, 0, sizeof(m_beacons));
+    memset(m_subscribers, 0, sizeof(m_subscribers));
+    memset(&m_stats, 0, sizeof(m_stats));
+    strcpy(m_zone, "none");
+    strcpy(m_previousZone, "none");
+}
+
+void WsStreamHub::subscribe(uint8_t client, uint8_t streams, const uint16_t* intervalMs) {
+    if (client >= WS_FANOUT_MAX_CLIENTS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&m_mux);
+    Subscriber& subscriber = m_subscribers[client];
+    memset(&subscriber, 0, sizeof(subscriber));
+    subscriber.streams = streams;
+    for (uint8_t i = 0; i < (uint8_t)WsStream::COUNT && intervalMs; i++) {
+        subscriber.intervalMs[i] = min((uint16_t)WS_STREAM_MAX_INTERVAL_MS, intervalMs[i]);
+    }
+    uint16_t& perfInterval = subscriber.intervalMs[(uint8_t)WsStream::PERF];
+    perfInterval = max((uint16_t)PERF_STREAM_MIN_INTERVAL_MS, perfInterval);
+    subscriber.keyframeDue = streams != 0;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+uint8_t WsStreamHub::getSubscriberMask() const {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        if (m_subscribers[i].streams) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+uint8_t WsStreamHub::perPacketMaskLocked(WsStream stream) const {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        const Subscriber& subscriber = m_subscribers[i];
+        if ((subscriber.streams & WS_STREAM_BIT(stream)) && !subscriber.keyframeDue &&
+            subscriber.intervalMs[(uint8_t)stream] == 0) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+void WsStreamHub::queueDocument(uint8_t clientMask, const JsonDocument& doc) {
+    size_t length = measureJson(doc);
+    WsFrame* frame = m_fanout.createFrame(WsFrameKind::STREAM, length);
+    if (!frame) {
+        return;
+    }
+    serializeJson(doc, frame->data, length + 1);
+    m_fanout.multicast(clientMask, frame);
+}
+
+void WsStreamHub::updateBeacon(const char* name, int16_t rawRssi, int16_t smoothedRssi,
+                               float distance, float confidence) {
+    WsStreamBeacon beacon;
+    uint8_t rssiMask;
+    uint8_t distanceMask;
+
+    portENTER_CRITICAL(&m_mux);
+    // Same beacon, else an empty slot (sequence 0), else the least recently updated one
+    WsStreamBeacon* slot = nullptr;
+    for (uint8_t i = 0; i < WS_STREAM_MAX_BEACONS && !slot; i++) {
+        if (m_beacons[i].sequence != 0 && strncmp(m_beacons[i].name, name, sizeof(m_beacons[i].name) - 1) == 0) {
+            slot = &m_beacons[i];
+        }
+    }
+    for (uint8_t i = 0; i < WS_STREAM_MAX_BEACONS && !slot; i++) {
+        if (m_beacons[i].sequence == 0) {
+            slot = &m_beacons[i];
+        }
+    }
+    if (!slot) {
+        slot = &m_beacons[0];
+        for (uint8_t i = 1; i < WS_STREAM_MAX_BEACONS; i++) {
+            if (m_beacons[i].sequence < slot->sequence) {
+                slot = &m_beacons[i];
+            }
+        }
+    }
+
+    strncpy(slot->name, name, sizeof(slot->name) - 1);
+    slot->name[sizeof(slot->name) - 1] = '\0';
+    slot->rawRssi = rawRssi;
+    slot->smoothedRssi = smoothedRssi;
+    slot->distance = distance;
+    slot->confidence = confidence;
+    slot->sequence = ++m_sequence;
+    beacon = *slot;
+
+    // Per-packet subscribers get this update now; their deltas start after it
+    rssiMask = perPacketMaskLocked(WsStream::RSSI);
+    distanceMask = perPacketMaskLocked(WsStream::DISTANCE);
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        if (rssiMask & (1 << i)) {
+            m_subscribers[i].sentSequence[(uint8_t)WsStream::RSSI] = beacon.sequence;
+        }
+        if (distanceMask & (1 << i)) {
+            m_subscribers[i].sentSequence[(uint8_t)WsStream::DISTANCE] = beacon.sequence;
+        }
+    }
+    portEXIT_CRITICAL(&m_mux);
+
+    // Static: called per BLE packet on the BLE host task
+    static StaticJsonDocument<256> doc;
+    const WsStream streams[] = {WsStream::RSSI, WsStream::DISTANCE};
+    const uint8_t masks[] = {rssiMask, distanceMask};
+
+    for (uint8_t i = 0; i < 2; i++) {
+        if (masks[i] == 0) {
+            continue;
+        }
+        doc.clear();
+        doc["t"] = FRAME_TYPES[(uint8_t)streams[i]];
+        JsonArray beacons = doc.createNestedArray("b");
+        addBeaconEntry(beacons, streams[i], beacon);
+        queueDocument(masks[i], doc);
+        m_stats.packetFrames++;
+    }
+}
+
+void WsStreamHub::updatePosition(bool hasFix, float x, float y, float confidence, float accuracy) {
+    portENTER_CRITICAL(&m_mux);
+    if (hasFix != m_hasPosition || (hasFix && (x != m_posX || y != m_posY ||
+                                                confidence != m_posConfidence ||
+                                                accuracy != m_posAccuracy))) {
+        m_hasPosition = hasFix;
+        m_posX = x;
+        m_posY = y;
+        m_posConfidence = confidence;
+        m_posAccuracy = accuracy;
+        m_positionSequence = ++m_sequence;
+    }
+    portEXIT_CRITICAL(&m_mux);
+}
+
+void WsStreamHub::updateZone(const char* zone) {
+    portENTER_CRITICAL(&m_mux);
+    if (strncmp(zone, m_zone, sizeof(m_zone) - 1) != 0) {
+        memcpy(m_previousZone, m_zone, sizeof(m_previousZone));
+        strncpy(m_zone, zone, sizeof(m_zone) - 1);
+        m_zone[sizeof(m_zone) - 1] = '\0';
+        m_zoneSequence = ++m_sequence;
+    }
+    portEXIT_CRITICAL(&m_mux);
+}
+
+void WsStreamHub::publishAlert(const char* beaconName, float distance, const char* alertMode) {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < WS_FANOUT_MAX_CLIENTS; i++) {
+        if (m_subscribers[i].streams & WS_STREAM_BIT(WsStream::ALERTS)) {
+            mask |= 1 << i;
+        }
+    }
+    if (mask == 0) {
+        return;
+    }
+
+    StaticJsonDocument<192> doc;
+    doc["t"] = FRAME_TYPES[(uint8_t)WsStream::ALERTS];
+    doc["b"] = beaconName;
+    doc["d"] = toInt(distance, 1.0f);
+    doc["m"] = alertMode;
+    queueDocument(mask, doc);
+    m_stats.eventFrames++;
+}
+
+void WsStreamHub::sendStreamFrame(uint8_t client, WsStream stream, bool keyframe, uint32_t nowMs) {
+    static StaticJsonDocument<WS_STREAM_DOC_SIZE> doc;
+    WsStreamBeacon beacons[WS_STREAM_MAX_BEACONS];
+    uint8_t beaconCount = 0;
+    bool hasFix = false;
+    float position[4] = {0};
+    char zone[WS_STREAM_NAME_LENGTH];
+    char previousZone[WS_STREAM_NAME_LENGTH];
+
+    portENTER_CRITICAL(&m_mux);
+    Subscriber& subscriber = m_subscribers[client];
+    uint8_t index = (uint8_t)stream;
+    uint32_t since = keyframe ? 0 : subscriber.sentSequence[index];
+    bool changed = false;
+
+    if (isBeaconStream(stream)) {
+        for (uint8_t i = 0; i < WS_STREAM_MAX_BEACONS; i++) {
+            if (m_beacons[i].sequence != 0 && m_beacons[i].sequence > since) {
+                beacons[beaconCount++] = m_beacons[i];
+            }
+        }
+        changed = beaconCount > 0;
+    } else if (stream == WsStream::POSITION) {
+        changed = keyframe || m_positionSequence > since;
+        hasFix = m_hasPosition;
+        position[0] = m_posX;
+        position[1] = m_posY;
+        position[2] = m_posConfidence;
+        position[3] = m_posAccuracy;
+    } else if (stream == WsStream::PERF) {
+        changed = m_profiler != nullptr;
+    } else {
+        changed = keyframe || m_zoneSequence > since;
+        memcpy(zone, m_zone, sizeof(zone));
+        memcpy(previousZone, m_previousZone, sizeof(previousZone));
+    }
+
+    if (changed) {
+        subscriber.sentSequence[index] = m_sequence;
+        subscriber.lastSentMs[index] = nowMs;
+    }
+    portEXIT_CRITICAL(&m_mux);
+
+    if (!changed) {
+        return;
+    }
+
+    doc.clear();
+    doc["t"] = FRAME_TYPES[index];
+    if (keyframe) {
+        doc["k"] = 1;
+    }
+
+    if (isBeaconStream(stream)) {
+        JsonArray entries = doc.createNestedArray("b");
+        for (uint8_t i = 0; i < beaconCount; i++) {
+            addBeaconEntry(entries, stream, beacons[i]);
+        }
+    } else if (stream == WsStream::POSITION) {
+        doc["fix"] = hasFix;
+        if (hasFix) {
+            doc["x"] = toInt(position[0], 100.0f);
+            doc["y"] = toInt(position[1], 100.0f);
+            doc["c"] = toInt(position[2], 100.0f);
+            doc["a"] = toInt(position[3], 100.0f);
+        }
+    } else if (stream == WsStream::PERF) {
+        doc["w"] = millis() - m_profiler->getWindowStartMs();
+        m_profiler->writeJson(doc.createNestedArray("s"));
+    } else {
+        doc["from"] = (const char*)previousZone;
+        doc["to"] = (const char*)zone;
+    }
+
+    queueDocument(1 << client, doc);
+    if (keyframe) {
+        m_stats.keyframes++;
+    } else {
+        m_stats.deltaFrames++;
+    }
+}
+
+void WsStreamHub::poll(uint32_t nowMs) {
+    const WsStream stateStreams[] = {WsStream::RSSI, WsStream::DISTANCE, WsStream::POSITION, WsStream::ZONE,
+                                     WsStream::PERF};
+
+    for (uint8_t client = 0; client < WS_FANOUT_MAX_CLIENTS; client++) {
+        Subscriber& subscriber = m_subscribers[client];
+        if (subscriber.streams == 0) {
+            continue;
+        }
+
+        bool keyframe = subscriber.keyframeDue || nowMs - subscriber.lastKeyframeMs >= WS_STREAM_KEYFRAME_MS;
+
+        for (WsStream stream : stateStreams) {
+            uint8_t index = (uint8_t)stream;
+            if (!(subscriber.streams & WS_STREAM_BIT(stream))) {
+                continue;
+            }
+            if (!keyframe) {
+                uint16_t interval = subscriber.intervalMs[index];
+                if (interval == 0 && isBeaconStream(stream)) {
+                    continue;   // Sent per packet by updateBeacon()
+                }
+                if (nowMs - subscriber.lastSentMs[index] < interval) {
+                    continue;
+                }
+            }
+            sendStreamFrame(client, stream, keyframe, nowMs);
+        }
+
+        if (keyframe) {
+            portENTER_CRITICAL(&m_mux);
+            subscriber.keyframeDue = false;
+            subscriber.lastKeyframeMs = nowMs;
+            portEXIT_CRITICAL(&m_mux);
+        }
+    }
+}
+
+const char* wsStreamToString(WsStream stream) {
+    return stream < WsStream::COUNT ? STREAM_NAMES[(uint8_t)stream] : "unknown";
+}
+
+WsStream wsStreamFromString(const char* name) {
+    for (uint8_t i = 0; i < (uint8_t)WsStream::COUNT; i++) {
+        if (strcmp(name, STREAM_NAMES[i]) == 0) {
+            return (WsStream)i;
+        }
+    }
+    return WsStream::COUNT;
+}
+
+// ==================== SELF-TESTS ====================
+
+namespace {
+
+/**
+ * @brief Captures frames per client instead of sending them
+ */
+struct CaptureTransport {
+    uint16_t received[WS_FANOUT_MAX_CLIENTS];
+    char last[WS_FANOUT_MAX_CLIENTS][256];
+};
+
+CaptureTransport capture;
+
+bool captureSend(uint8_t client, const char* data, size_t length, void* context) {
+    capture.received[client]++;
+    size_t copy = min(length, sizeof(capture.last[client]) - 1);
+    memcpy(capture.last[client], data, copy);
+    capture.last[client][copy] = '\0';
+    return true;
+}
+
+void setupHub(WsFanout& fanout, uint8_t clients) {
+    memset(&capture, 0, sizeof(capture));
+    fanout.setTransport(captureSend, nullptr, nullptr);
+    for (uint8_t i = 0; i < clients; i++) {
+        fanout.onConnect(i);
+    }
+}
+
+/**
+ * @brief Rate-limited beacon frames carry only what changed
+ */
+bool testDeltaFrames() {
+    Serial.println("📊 Test 1: Distance stream sends keyframe, then deltas at the max rate");
+
+    WsFanout fanout;
+    WsStreamHub hub(fanout);
+    setupHub(fanout, 1);
+
+    uint16_t intervals[(uint8_t)WsStream::COUNT] = {0};
+    intervals[(uint8_t)WsStream::DISTANCE] = 500;
+    hub.subscribe(0, WS_STREAM_BIT(WsStream::DISTANCE), intervals);
+
+    hub.updateBeacon("Kitchen", -60, -61, 120.0f, 0.8f);
+    hub.updateBeacon("Door", -70, -71, 300.0f, 0.6f);
+    hub.updateBeacon("Bowl", -55, -56, 80.0f, 0.9f);
+
+    hub.poll(1000);
+    fanout.service();
+    bool passed = capture.received[0] == 1 && strstr(capture.last[0], "\"k\":1") &&
+                  strstr(capture.last[0], "Kitchen") && strstr(capture.last[0], "Bowl");
+
+    // One beacon moves; nothing goes out before the interval has passed
+    hub.updateBeacon("Door", -66, -67, 250.0f, 0.6f);
+    hub.poll(1200);
+    fanout.service();
+    passed = passed && capture.received[0] == 1;
+
+    hub.poll(1500);
+    fanout.service();
+    passed = passed && capture.received[0] == 2 &&
+             strcmp(capture.last[0], "{\"t\":\"dist\",\"b\":[[\"Door\",250,60]]}") == 0;
+
+    // No change, no frame
+    hub.poll(2100);
+    fanout.service();
+    passed = passed && capture.received[0] == 2;
+
+    Serial.printf("   Delta frame: %s\n", capture.last[0]);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Per-packet RSSI is built once and shared by every per-packet subscriber
+ */
+bool testPerPacketSharing() {
+    Serial.println("📊 Test 2: Per-packet RSSI frames are shared, unsubscribed clients get none");
+
+    WsFanout fanout;
+    WsStreamHub hub(fanout);
+    setupHub(fanout, 3);
+
+    uint16_t intervals[(uint8_t)WsStream::COUNT] = {0};
+    hub.subscribe(0, WS_STREAM_BIT(WsStream::RSSI), intervals);
+    hub.subscribe(1, WS_STREAM_BIT(WsStream::RSSI), intervals);
+    hub.poll(0);    // Initial keyframes (empty: nothing seen yet)
+    fanout.service();
+
+    uint32_t framesBefore = fanout.getStats().frames;
+    for (int i = 0; i < 5; i++) {
+        hub.updateBeacon("Kitchen", -60 - i, -61, 120.0f, 0.8f);
+    }
+    fanout.service();
+
+    bool passed = fanout.getStats().frames - framesBefore == 5 &&
+                  capture.received[0] == 5 && capture.received[1] == 5 && capture.received[2] == 0 &&
+                  strcmp(capture.last[0], "{\"t\":\"rssi\",\"b\":[[\"Kitchen\",-64,-61]]}") == 0;
+
+    // The poll does not repeat what per-packet frames already delivered
+    hub.poll(1000);
+    fanout.service();
+    passed = passed && capture.received[0] == 5 && hub.getSubscriberMask() == 0x03;
+
+    Serial.printf("   5 packets -> %lu frames, %u + %u sends\n",
+                 (unsigned long)(fanout.getStats().frames - framesBefore),
+                 capture.received[0], capture.received[1]);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Position and zone push on change only; alerts push immediately
+ */
+bool testStateAndEvents() {
+    Serial.println("📊 Test 3: Position/zone on change, alerts immediately");
+
+    WsFanout fanout;
+    WsStreamHub hub(fanout);
+    setupHub(fanout, 1);
+
+    uint16_t intervals[(uint8_t)WsStream::COUNT] = {0};
+    intervals[(uint8_t)WsStream::POSITION] = 1000;
+    hub.subscribe(0, WS_STREAM_BIT(WsStream::POSITION) | WS_STREAM_BIT(WsStream::ZONE) |
+                     WS_STREAM_BIT(WsStream::ALERTS), intervals);
+
+    hub.updatePosition(true, 1.0f, 2.0f, 0.8f, 0.5f);
+    hub.poll(0);
+    fanout.service();
+    bool passed = capture.received[0] == 2;     // Position and zone keyframes
+
+    hub.updatePosition(true, 1.0f, 2.0f, 0.8f, 0.5f);   // Unchanged
+    hub.updateZone("yard");
+    hub.poll(2000);
+    fanout.service();
+    passed = passed && capture.received[0] == 3 &&
+             strcmp(capture.last[0], "{\"t\":\"zone\",\"from\":\"none\",\"to\":\"yard\"}") == 0;
+
+    hub.publishAlert("Kitchen", 45.0f, "buzzer");
+    fanout.service();
+    passed = passed && capture.received[0] == 4 && strstr(capture.last[0], "\"t\":\"alert\"");
+
+    hub.unsubscribe(0);
+    hub.publishAlert("Kitchen", 45.0f, "buzzer");
+    fanout.service();
+    passed = passed && capture.received[0] == 4 && hub.getSubscriberMask() == 0;
+
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+/**
+ * @brief Perf frames report the profiler's stages, no faster than the minimum interval
+ */
+bool testPerfStream() {
+    Serial.println("📊 Test 4: Perf stream snapshots loop timing");
+
+    WsFanout fanout;
+    WsStreamHub hub(fanout);
+    setupHub(fanout, 1);
+
+    static LoopProfiler profiler;
+    profiler.begin(240, 0);
+    for (uint8_t i = 0; i < 3; i++) {
+        profiler.record(PerfStage::MQTT, 240 * 20);     // 20 us
+    }
+
+    // Not attached yet: nothing to report
+    uint16_t intervals[(uint8_t)WsStream::COUNT] = {0};
+    hub.subscribe(0, WS_STREAM_BIT(WsStream::PERF), intervals);
+    hub.poll(0);
+    fanout.service();
+    bool passed = capture.received[0] == 0;
+
+    // Interval 0 is raised to PERF_STREAM_MIN_INTERVAL_MS
+    hub.setProfiler(&profiler);
+    hub.subscribe(0, WS_STREAM_BIT(WsStream::PERF), intervals);
+    hub.poll(0);
+    fanout.service();
+    passed = passed && capture.received[0] == 1 && strstr(capture.last[0], "\"t\":\"perf\"") &&
+             strstr(capture.last[0], "[\"mqtt\",3,") && !strstr(capture.last[0], "\"loop\"");
+
+    hub.poll(PERF_STREAM_MIN_INTERVAL_MS - 1);
+    fanout.service();
+    passed = passed && capture.received[0] == 1;
+    hub.poll(PERF_STREAM_MIN_INTERVAL_MS);
+    fanout.service();
+    passed = passed && capture.received[0] == 2;
+
+    Serial.printf("   Frame: %s\n", capture.last[0]);
+    Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+    return passed;
+}
+
+} // namespace
+
+bool runWsStreamTests() {
+    Serial.println("\n🧪 Running WebSocket Stream Unit Tests...\n");
+
+    bool passed = true;
+    passed &= testDeltaFrames();
+    passed &= testPerPacketSharing();
+    passed &= testStateAndEvents();
+    passed &= testPerfStream();
+
+    Serial.printf("\n%s WebSocket Stream Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+    return passed;
+}
@@ -0,0 +1,118 @@
+/*
+ * Camera Frame Hub
+ * One capture loop feeding every MJPEG viewer
+ *
+ * A single producer task captures and encodes each frame once into a small
+ * ring of reference-counted JPEG buffers. Every viewer has its own sender
+ * task that waits for a new frame, takes a reference to the latest one and
+ * sends it; a viewer that falls behind skips straight to the newest frame
+ * instead of queueing stale ones, so the capture rate does not divide by
+ * the number of viewers.
+ *
+ * Buffers are allocated on first use (in PSRAM when present), reused while
+ * anyone is watching and freed when the last viewer leaves.
+ */
+
+#ifndef CAMERA_FRAME_HUB_H
+#define CAMERA_FRAME_HUB_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+// Simultaneous MJPEG viewers (one sender task each)
+#ifndef CAM_STREAM_MAX_CLIENTS
+#define CAM_STREAM_MAX_CLIENTS 4
+#endif
+
+// Latest frame + one being captured + one held by each viewer, so the
+// producer always finds a free buffer
+#define CAM_FRAME_SLOTS (CAM_STREAM_MAX_CLIENTS + 2)
+
+// Buffer growth step (JPEG sizes vary from frame to frame)
+#define CAM_FRAME_ALLOC_STEP 4096
+
+static_assert(CAM_STREAM_MAX_CLIENTS <= 8, "one event bit per viewer");
+
+// One encoded JPEG frame
+struct CamFrame {
+  uint8_t* data;
+  size_t length;
+  size_t capacity;
+  uint32_t sequence;        // 1, 2, 3... in capture order
+  uint32_t capturedMs;
+  uint8_t refs;             // Hub (if latest) + producer (while filling) + viewers
+};
+
+struct CamStreamStats {
+  uint32_t captured;        // Frames published
+  uint32_t captureErrors;   // Failed captures, encodes or buffer allocations
+  uint32_t sent;            // Frames sent, all viewers
+  uint32_t skipped;         // Frames a slow viewer never sent
+  uint32_t rejected;        // Viewers turned away (all slots busy)
+  uint32_t lastCaptureUs;   // Capture + encode time of the last frame
+  uint32_t bufferBytes;     // Frame buffer memory currently allocated
+};
+
+class CameraFrameHub {
+ public:
+  CameraFrameHub();
+
+  // Create the wake-up event group (call from setup)
+  bool begin();
+
+  // ---- Producer (capture task) ----
+
+  // Claim a free buffer of at least length bytes; fill it, then
+  // publishFrame() it or release() it
+  CamFrame* beginFrame(size_t length);
+
+  // Make a filled frame the latest one and wake every viewer
+  void publishFrame(CamFrame* frame, uint32_t nowMs, uint32_t captureUs);
+
+  void countCaptureError();
+
+  // ---- Viewers (sender tasks) ----
+
+  // Reserve a viewer slot; -1 if all CAM_STREAM_MAX_CLIENTS are busy
+  int8_t addClient();
+
+  // Free a viewer slot; the last viewer out frees the frame buffers
+  void removeClient(int8_t slot);
+
+  // Block until a frame is published after the last wait, or timeout
+  bool waitForFrame(int8_t slot, uint32_t timeoutMs);
+
+  // Reference to the latest frame if it is not afterSequence, else nullptr
+  CamFrame* acquireLatest(uint32_t afterSequence);
+
+  // Drop a reference from beginFrame() or acquireLatest()
+  void release(CamFrame* frame);
+
+  // Account a frame sent by a viewer that previously sent previousSequence
+  void countSent(uint32_t previousSequence, uint32_t sequence);
+
+  uint8_t getClientCount() const { return m_clientCount; }
+  float getCaptureFps() const { return m_captureFps; }
+  CamStreamStats getStats();
+
+ private:
+  CamFrame m_frames[CAM_FRAME_SLOTS];
+  CamFrame* m_latest;
+  uint32_t m_sequence;
+  uint8_t m_clientMask;
+  volatile uint8_t m_clientCount;
+  EventGroupHandle_t m_events;
+  portMUX_TYPE m_mux;
+  CamStreamStats m_stats;
+  uint32_t m_fpsWindowStart;
+  uint32_t m_fpsWindowFrames;
+  float m_captureFps;
+
+  void releaseLocked(CamFrame* frame);
+};
+
+// Self-tests of the buffer refcounts (serial 'u'); true if all passed
+bool runCameraFrameHubTests();
+
+#endif // CAMERA_FRAME_HUB_H
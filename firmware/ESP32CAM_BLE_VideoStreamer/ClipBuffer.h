@@ -0,0 +1,124 @@
+/*
+ * Clip Buffer
+ * Rolling pre-event JPEG history in PSRAM
+ *
+ * Low-rate JPEG frames are kept in a byte ring in PSRAM, oldest evicted
+ * first, so the last CLIP_PRE_MS or more are always on hand. A trigger (a
+ * collar nearby, an HTTP or serial request) marks an event: the clip is the
+ * frames from CLIP_PRE_MS before it to CLIP_POST_MS after it. Clip frames
+ * are pinned in the ring (never evicted) until the clip expires, so serving
+ * /clip reads them in place without copying.
+ */
+
+#ifndef CLIP_BUFFER_H
+#define CLIP_BUFFER_H
+
+#include <Arduino.h>
+
+#define CLIP_RING_BYTES (1536 * 1024)   // PSRAM for frame data
+#define CLIP_MAX_FRAMES 96              // Frames indexed at once
+#define CLIP_FRAME_INTERVAL_MS 500      // 2 fps history
+#define CLIP_PRE_MS 10000               // History before the event
+#define CLIP_POST_MS 5000               // Recording after the event
+#define CLIP_KEEP_MS 300000             // A finished clip stays pinned this long
+
+enum class ClipState : uint8_t {
+  IDLE = 0,                 // Rolling history only
+  RECORDING,                // Event triggered, post-event frames still coming
+  READY                     // Clip complete and pinned
+};
+
+struct ClipStats {
+  uint32_t stored;          // Frames written to the ring
+  uint32_t evicted;         // Oldest frames dropped for new ones
+  uint32_t dropped;         // Frames not stored (too big, or clip pinned the space)
+  uint32_t triggers;
+  uint32_t rejectedTriggers;// A clip was being downloaded
+  uint32_t served;          // Clip downloads
+};
+
+class ClipBuffer {
+ public:
+  ClipBuffer();
+  ~ClipBuffer();
+
+  // Allocate the ring (PSRAM only); false if it is not available
+  bool begin(size_t bytes = CLIP_RING_BYTES);
+  bool isReady() const { return m_arena != nullptr; }
+
+  // ---- Capture task ----
+
+  // A new frame is due for the history
+  bool wantsFrame(uint32_t nowMs) const;
+
+  // Copy a JPEG into the ring
+  bool store(const uint8_t* jpg, size_t length, uint32_t nowMs);
+
+  // ---- Any task ----
+
+  // Mark an event now; extends a clip still recording. false if the current
+  // clip is being downloaded
+  bool trigger(uint32_t nowMs);
+
+  // Advance RECORDING -> READY -> IDLE; call periodically
+  void service(uint32_t nowMs);
+
+  ClipState getState() const { return m_state; }
+  uint32_t getEventMs() const { return m_eventMs; }
+  uint32_t getPostEndMs() const { return m_postEndMs; }
+
+  // ---- Download (HTTP handler) ----
+
+  // Pin the clip for reading; false unless a clip is READY
+  bool beginRead();
+
+  // Frame index of the clip (0 = oldest); false past the end
+  bool readFrame(uint16_t index, const uint8_t** data, size_t* length, uint32_t* capturedMs);
+
+  uint16_t getClipFrameCount() const;
+
+  void endRead();
+
+  uint16_t getFrameCount() const { return m_count; }
+  uint32_t getHistoryMs() const;
+  size_t getCapacity() const { return m_capacity; }
+  ClipStats getStats();
+
+ private:
+  struct Entry {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t capturedMs;
+    uint32_t sequence;
+  };
+
+  uint8_t* m_arena;
+  size_t m_capacity;
+  Entry m_entries[CLIP_MAX_FRAMES];
+  uint16_t m_first;         // Index of the oldest entry
+  uint16_t m_count;
+  uint32_t m_head;          // Arena offset of the next frame
+  uint32_t m_nextSequence;
+  uint32_t m_lastStoreMs;
+
+  volatile ClipState m_state;
+  uint32_t m_eventMs;
+  uint32_t m_postEndMs;
+  uint32_t m_readyMs;
+  uint32_t m_clipFirst;     // Sequence range of the clip
+  uint32_t m_clipLast;      // m_clipFirst - 1 while empty
+  uint8_t m_readers;
+
+  portMUX_TYPE m_mux;
+  ClipStats m_stats;
+
+  const Entry& oldest() const { return m_entries[m_first]; }
+  bool isPinned(const Entry& entry) const;
+  bool evictOldestLocked();
+  const Entry* findLocked(uint32_t sequence) const;
+};
+
+// Self-tests on small rings (serial 'u'); true if all passed or no PSRAM
+bool runClipBufferTests();
+
+#endif // CLIP_BUFFER_H
@@ -38,6 +38,16 @@
 #include "soc/soc.h"           // Disable brownout problems
 #include "soc/rtc_cntl_reg.h"  // Disable brownout problems
 #include "esp_http_server.h"
+#include "esp_idf_version.h"
+#include "CameraFrameHub.h"
+#include "StreamRateController.h"
+#include "MotionDetector.h"
+#include "ClipBuffer.h"
+#include "esp_jpg_decode.h"
+
+// Detached (async) requests let each viewer stream from its own task; older
+// cores serve /stream on the single httpd task, one viewer at a time
+#define CAM_ASYNC_STREAMS (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0))
 
 // Camera pin definitions for AI-Thinker ESP32-CAM
 #define PWDN_GPIO_NUM     32
@@ -80,6 +90,14 @@ const char* password = "VideoBeacon123";
 static const char* _STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
 static const char* _STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
 static const char* _STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+#define STREAM_FRAME_WAIT_MS 1000      // Viewer wake-up when no frame arrives
+#define CAPTURE_TASK_STACK 6144             // JPEG decoder for motion checks
+#define MOTION_CHECK_MS 500                 // Motion detector duty cycle
+#define MOTION_IDLE_FRAMESIZE FRAMESIZE_QVGA  // Sensor size while nobody watches
+#define CLIP_IDLE_FRAMESIZE FRAMESIZE_VGA     // Idle size when the clip history is kept
+#define MOTION_DECODE_MAX_WIDTH 200         // Decode scale keeps frames this narrow
+#define COLLAR_NEARBY_HOLD_MS 30000         // BLE connection counts as a collar this long
+#define STREAM_TASK_STACK 4096
 
 // Persistent storage
 Preferences preferences;
@@ -116,9 +134,33 @@ bool ledState = false;
 bool isAdvertising = true;
 bool configChanged = false;
 bool cameraInitialized = false;
-bool streamingActive = false;
 int batteryLevel = 100;
-int streamClients = 0;
+
+// Shared JPEG frames: one capture task, one sender per viewer
+CameraFrameHub frameHub;
+StreamRateController rateController;
+MotionDetector motionDetector;
+ClipBuffer clipBuffer;
+volatile uint32_t lastCollarSeenMs = 0;
+bool advertisedMotion = false;
+
+// Quality ladder, heaviest first; levels above the size the camera was
+// initialised with are skipped
+const StreamLevel STREAM_LEVELS[] = {
+  {FRAMESIZE_UXGA, 10},
+  {FRAMESIZE_SXGA, 10},
+  {FRAMESIZE_XGA,  12},
+  {FRAMESIZE_SVGA, 12},
+  {FRAMESIZE_VGA,  12},
+  {FRAMESIZE_VGA,  20},
+  {FRAMESIZE_CIF,  20},
+  {FRAMESIZE_QVGA, 25},
+};
+const uint8_t STREAM_LEVEL_COUNT = sizeof(STREAM_LEVELS) / sizeof(STREAM_LEVELS[0]);
+TaskHandle_t captureTaskHandle = NULL;
+#if CAM_ASYNC_STREAMS
+httpd_req_t* streamRequests[CAM_STREAM_MAX_CLIENTS];
+#endif
 
 // BLE objects
 BLEServer* pServer = nullptr;
@@ -137,8 +179,26 @@ struct CameraBeaconMetadata {
   uint8_t cameraStatus;     // Camera status: 0=off, 1=ready, 2=streaming
   uint8_t streamClients;    // Number of active stream clients
   uint16_t uptime;          // Uptime in minutes
+  uint8_t flags;            // CAM_FLAG_* bits (appended; older scanners read 8 bytes)
 } __attribute__((packed));
 
+#define CAM_FLAG_MOTION         0x01  // Motion within MOTION_HOLD_MS
+#define CAM_FLAG_COLLAR_NEARBY  0x02  // A BLE central connected within COLLAR_NEARBY_HOLD_MS
+
+// A central connecting to the beacon (a collar or the app checking in)
+// counts as a nearby collar and wakes the stream like motion does
+class BeaconServerCallbacks : public BLEServerCallbacks {
+  void onConnect(BLEServer* server) override {
+    lastCollarSeenMs = millis();
+    rateController.reportMotion(lastCollarSeenMs);
+    clipBuffer.trigger(lastCollarSeenMs);
+    BLEDevice::startAdvertising();   // Stay visible to other collars
+  }
+  void onDisconnect(BLEServer* server) override {
+    BLEDevice::startAdvertising();
+  }
+};
+
 void setup() {
   Serial.begin(115200);
   delay(1000);
@@ -162,6 +222,8 @@ void setup() {
   
   // Initialize Camera
   initializeCamera();
+  initializeClipBuffer();
+  startCaptureTask();
   
   // Initialize WiFi Access Point
   initializeWiFi();
@@ -201,6 +263,14 @@ void loop() {
   // Update streaming status
   updateStreamingStatus();
   
+  // Finish or expire the event clip
+  clipBuffer.service(millis());
+  
+  // Advertise motion changes without waiting for the periodic refresh
+  if (pAdvertising && isAdvertising && motionDetector.isMotion(millis()) != advertisedMotion) {
+    startAdvertising();
+  }
+  
   // Small delay to prevent excessive CPU usage
   delay(10);
 }
@@ -235,6 +305,7 @@ void initializeCamera() {
     config.frame_size = FRAMESIZE_UXGA;
     config.jpeg_quality = 10;
     config.fb_count = 2;
+    config.grab_mode = CAMERA_GRAB_LATEST;  // Paced capture wants a fresh frame, not a queued one
   } else {
     config.frame_size = FRAMESIZE_SVGA;
     config.jpeg_quality = 12;
@@ -277,6 +348,19 @@ void initializeCamera() {
     s->set_colorbar(s, 0);       // 0 = disable , 1 = enable
   }
   
+  // Start the stream at SVGA (or the largest size initialised, if smaller)
+  uint8_t firstLevel = 0;
+  while (firstLevel + 1 < STREAM_LEVEL_COUNT && STREAM_LEVELS[firstLevel].frameSize > config.frame_size) {
+    firstLevel++;
+  }
+  uint8_t startLevel = 0;
+  while (firstLevel + startLevel + 1 < STREAM_LEVEL_COUNT &&
+         STREAM_LEVELS[firstLevel + startLevel].frameSize > FRAMESIZE_SVGA) {
+    startLevel++;
+  }
+  rateController.begin(STREAM_LEVELS + firstLevel, STREAM_LEVEL_COUNT - firstLevel, startLevel);
+  applyStreamLevel();
+  
   cameraInitialized = true;
   Serial.println("✅ Camera initialized successfully");
 }
@@ -294,76 +378,385 @@ void initializeWiFi() {
   Serial.printf("✅ Camera control: http://%s\n", IP.toString().c_str());
 }
 
-// HTTP streaming handler
-static esp_err_t stream_handler(httpd_req_t *req) {
-  camera_fb_t * fb = NULL;
-  esp_err_t res = ESP_OK;
-  size_t _jpg_buf_len = 0;
-  uint8_t * _jpg_buf = NULL;
-  char * part_buf[64];
-
-  streamClients++;
-  streamingActive = true;
-  
-  res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
-  if(res != ESP_OK){
-    streamClients--;
-    return res;
-  }
-
-  while(true){
-    fb = esp_camera_fb_get();
-    if (!fb) {
-      Serial.println("Camera capture failed");
-      res = ESP_FAIL;
-    } else {
-      if(fb->width > 400){
-        if(fb->format != PIXFORMAT_JPEG){
-          bool jpeg_converted = frame2jpg(fb, 80, &_jpg_buf, &_jpg_buf_len);
-          esp_camera_fb_return(fb);
-          fb = NULL;
-          if(!jpeg_converted){
-            Serial.println("JPEG compression failed");
-            res = ESP_FAIL;
-          }
-        } else {
-          _jpg_buf_len = fb->len;
-          _jpg_buf = fb->buf;
+bool isStreaming() {
+  return frameHub.getClientCount() > 0;
+}
+
+bool isCollarNearby() {
+  return lastCollarSeenMs != 0 && millis() - lastCollarSeenMs < COLLAR_NEARBY_HOLD_MS;
+}
+
+// Keep a pre-event history in PSRAM; boards without it just have no /clip
+void initializeClipBuffer() {
+  if (!psramFound()) {
+    Serial.println("⚠️ No PSRAM: event clips disabled");
+    return;
+  }
+  if (clipBuffer.begin()) {
+    Serial.printf("✅ Clip history: %u KB PSRAM, %d s before / %d s after an event\n",
+                  (unsigned)(clipBuffer.getCapacity() / 1024), CLIP_PRE_MS / 1000, CLIP_POST_MS / 1000);
+  } else {
+    Serial.println("❌ Failed to allocate clip history");
+  }
+}
+
+// Add a frame to the clip history at its own low rate
+void storeClipFrame(const uint8_t* jpg, size_t len) {
+  uint32_t now = millis();
+  if (clipBuffer.wantsFrame(now)) {
+    clipBuffer.store(jpg, len, now);
+  }
+}
+
+void triggerClip(const char* source) {
+  if (!clipBuffer.isReady()) {
+    Serial.println("Clip history not available (no PSRAM)");
+  } else if (clipBuffer.trigger(millis())) {
+    Serial.printf("🎬 Clip event (%s): %u frames of history\n", source, clipBuffer.getFrameCount());
+  } else {
+    Serial.println("Clip is being downloaded, event ignored");
+  }
+}
+
+// esp_jpg_decode reader over an in-memory JPEG
+struct MotionJpegSource {
+  const uint8_t* data;
+  size_t length;
+};
+
+static size_t motionJpegRead(void* arg, size_t index, uint8_t* buf, size_t len) {
+  MotionJpegSource* src = (MotionJpegSource*)arg;
+  if (index >= src->length) return 0;
+  if (index + len > src->length) {
+    len = src->length - index;
+  }
+  if (buf) {
+    memcpy(buf, src->data + index, len);
+  }
+  return len;
+}
+
+// esp_jpg_decode writer: start/end calls carry no data
+static bool motionJpegWrite(void* arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t* data) {
+  if (!data) {
+    return (x != 0 || y != 0) || motionDetector.beginFrame(w, h);
+  }
+  motionDetector.addRgbBlock(x, y, w, h, data);
+  return true;
+}
+
+// Decode a JPEG at reduced scale and run the motion detector on it
+bool checkMotion(const uint8_t* jpg, size_t length, uint16_t width) {
+  int64_t start = esp_timer_get_time();
+  uint8_t scale = JPG_SCALE_NONE;
+  while (scale < JPG_SCALE_8X && (width >> scale) > MOTION_DECODE_MAX_WIDTH) {
+    scale++;
+  }
+
+  MotionJpegSource src = {jpg, length};
+  if (esp_jpg_decode(length, (jpg_scale_t)scale, motionJpegRead, motionJpegWrite, &src) != ESP_OK) {
+    return false;
+  }
+  uint32_t now = millis();
+  bool motion = motionDetector.endFrame(now, (uint32_t)(esp_timer_get_time() - start));
+  if (motion) {
+    rateController.reportMotion(now);
+  }
+  return motion;
+}
+
+// Capture a frame for the motion detector only
+void watchForMotion() {
+  camera_fb_t * fb = esp_camera_fb_get();
+  if (!fb) {
+    frameHub.countCaptureError();
+    return;
+  }
+  if (fb->format == PIXFORMAT_JPEG) {
+    checkMotion(fb->buf, fb->len, fb->width);
+    storeClipFrame(fb->buf, fb->len);
+  }
+  esp_camera_fb_return(fb);
+}
+
+// Capture and encode one frame into the shared ring
+void captureFrame(bool detectMotion) {
+  int64_t start = esp_timer_get_time();
+  camera_fb_t * fb = esp_camera_fb_get();
+  if (!fb) {
+    Serial.println("Camera capture failed");
+    frameHub.countCaptureError();
+    vTaskDelay(pdMS_TO_TICKS(100));
+    return;
+  }
+  uint16_t width = fb->width;
+
+  uint8_t * jpgBuf = fb->buf;
+  size_t jpgLen = fb->len;
+  if (fb->format != PIXFORMAT_JPEG) {
+    // frame2jpg quality runs the other way (100 = best): sensor 10 -> 80
+    bool converted = frame2jpg(fb, 90 - rateController.getLevel().quality, &jpgBuf, &jpgLen);
+    esp_camera_fb_return(fb);
+    fb = NULL;
+    if (!converted) {
+      Serial.println("JPEG compression failed");
+      frameHub.countCaptureError();
+      return;
+    }
+  }
+
+  CamFrame* frame = frameHub.beginFrame(jpgLen);
+  if (frame) {
+    memcpy(frame->data, jpgBuf, jpgLen);
+    frame->length = jpgLen;
+    frameHub.publishFrame(frame, millis(), (uint32_t)(esp_timer_get_time() - start));
+  }
+  if (detectMotion) {
+    checkMotion(jpgBuf, jpgLen, width);
+  }
+  storeClipFrame(jpgBuf, jpgLen);
+
+  if (fb) {
+    esp_camera_fb_return(fb);
+  } else {
+    free(jpgBuf);
+  }
+}
+
+// Push the controller's frame size and quality to the sensor
+void applyStreamLevel() {
+  sensor_t * s = esp_camera_sensor_get();
+  if (s == NULL) return;
+  const StreamLevel& level = rateController.getLevel();
+  s->set_framesize(s, (framesize_t)level.frameSize);
+  s->set_quality(s, level.quality);
+}
+
+// Single producer: streams while someone is watching, paced by the rate
+// controller, and otherwise only checks a small frame for motion every
+// MOTION_CHECK_MS
+static void captureTask(void* param) {
+  uint32_t lastCaptureMs = 0;
+  uint32_t lastMotionCheckMs = 0;
+  bool idleSize = false;       // Sensor at the idle frame size
+  // The clip history is worth watching at a size people can recognise
+  framesize_t idleFrameSize = clipBuffer.isReady() ? CLIP_IDLE_FRAMESIZE : MOTION_IDLE_FRAMESIZE;
+  for (;;) {
+    uint32_t now = millis();
+    bool motionDue = now - lastMotionCheckMs >= MOTION_CHECK_MS;
+
+    if (frameHub.getClientCount() == 0) {
+      if (!idleSize) {
+        sensor_t * s = esp_camera_sensor_get();
+        if (s != NULL) {
+          s->set_framesize(s, idleFrameSize);
         }
+        motionDetector.reset();
+        idleSize = true;
       }
+      if (motionDue) {
+        lastMotionCheckMs = now;
+        watchForMotion();
+      }
+      vTaskDelay(pdMS_TO_TICKS(50));
+      continue;
     }
-    if(res == ESP_OK){
-      size_t hlen = snprintf((char *)part_buf, 64, _STREAM_PART, _jpg_buf_len);
-      res = httpd_resp_send_chunk(req, (const char *)part_buf, hlen);
+
+    if (idleSize || rateController.update(now)) {
+      applyStreamLevel();
+      motionDetector.reset();
+      idleSize = false;
     }
-    if(res == ESP_OK){
-      res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
+    uint32_t elapsed = now - lastCaptureMs;
+    uint32_t interval = rateController.getFrameIntervalMs();
+    if (elapsed < interval) {
+      if (motionDue) {
+        // Keepalive: keep watching between the slow frames
+        lastMotionCheckMs = now;
+        watchForMotion();
+      } else {
+        // Short sleeps so motion or a new viewer ends a keepalive wait promptly
+        vTaskDelay(pdMS_TO_TICKS(min(interval - elapsed, (uint32_t)50)));
+      }
+      continue;
     }
-    if(res == ESP_OK){
-      res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+    lastCaptureMs = now;
+    if (motionDue) {
+      lastMotionCheckMs = now;
+    }
+    captureFrame(motionDue);
+  }
+}
+
+void startCaptureTask() {
+  if (!cameraInitialized || captureTaskHandle) return;
+  if (!frameHub.begin() ||
+      xTaskCreatePinnedToCore(captureTask, "cam_capture", CAPTURE_TASK_STACK, NULL, 5,
+                              &captureTaskHandle, 1) != pdPASS) {
+    Serial.println("❌ Failed to start camera capture task");
+    captureTaskHandle = NULL;
+  }
+}
+
+// Send the latest frame whenever one is published; a slow viewer skips
+// the frames it missed instead of falling further behind
+static esp_err_t sendStreamFrames(httpd_req_t *req, int8_t slot) {
+  char partBuf[64];
+  uint32_t lastSequence = 0;
+
+  esp_err_t res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
+  while (res == ESP_OK) {
+    CamFrame* frame = frameHub.acquireLatest(lastSequence);
+    if (!frame) {
+      frameHub.waitForFrame(slot, STREAM_FRAME_WAIT_MS);
+      continue;
+    }
+
+    size_t hlen = snprintf(partBuf, sizeof(partBuf), _STREAM_PART, frame->length);
+    int64_t sendStart = esp_timer_get_time();
+    res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+    if (res == ESP_OK) {
+      res = httpd_resp_send_chunk(req, partBuf, hlen);
     }
-    if(fb){
-      esp_camera_fb_return(fb);
-      fb = NULL;
-      _jpg_buf = NULL;
-    } else if(_jpg_buf){
-      free(_jpg_buf);
-      _jpg_buf = NULL;
+    if (res == ESP_OK) {
+      res = httpd_resp_send_chunk(req, (const char *)frame->data, frame->length);
     }
-    if(res != ESP_OK){
-      break;
+    if (res == ESP_OK) {
+      rateController.recordSend(slot, (uint32_t)(esp_timer_get_time() - sendStart));
+      frameHub.countSent(lastSequence, frame->sequence);
     }
+    lastSequence = frame->sequence;
+    frameHub.release(frame);
   }
-  
-  streamClients--;
-  if(streamClients <= 0) {
-    streamingActive = false;
-    streamClients = 0;
+  rateController.removeClient(slot);
+  return res;
+}
+
+#if CAM_ASYNC_STREAMS
+// Per-viewer sender task owning a detached request
+static void streamSenderTask(void* param) {
+  int8_t slot = (int8_t)(intptr_t)param;
+  httpd_req_t* req = streamRequests[slot];
+
+  sendStreamFrames(req, slot);
+
+  httpd_req_async_handler_complete(req);
+  streamRequests[slot] = NULL;
+  frameHub.removeClient(slot);
+  vTaskDelete(NULL);
+}
+#endif
+
+// HTTP streaming handler
+static esp_err_t stream_handler(httpd_req_t *req) {
+  int8_t slot = frameHub.addClient();
+  if (slot < 0) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_sendstr(req, "Too many viewers");
+  }
+  rateController.reportMotion(millis());   // Full rate for a new viewer
+
+#if CAM_ASYNC_STREAMS
+  httpd_req_t* asyncReq = NULL;
+  if (httpd_req_async_handler_begin(req, &asyncReq) != ESP_OK) {
+    frameHub.removeClient(slot);
+    return ESP_FAIL;
+  }
+  streamRequests[slot] = asyncReq;
+  if (xTaskCreatePinnedToCore(streamSenderTask, "mjpeg_send", STREAM_TASK_STACK,
+                              (void*)(intptr_t)slot, 4, NULL, 0) != pdPASS) {
+    httpd_req_async_handler_complete(asyncReq);
+    streamRequests[slot] = NULL;
+    frameHub.removeClient(slot);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+#else
+  esp_err_t res = sendStreamFrames(req, slot);
+  frameHub.removeClient(slot);
+  return res;
+#endif
+}
+
+// Event clip: the frames around the last trigger, as MJPEG (plays in a
+// browser <img>) or with ?format=raw as back-to-back JPEGs for saving
+static esp_err_t clip_handler(httpd_req_t *req) {
+  if (!clipBuffer.isReady()) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_sendstr(req, "No clip history (no PSRAM)");
+  }
+  clipBuffer.service(millis());
+  if (clipBuffer.getState() == ClipState::RECORDING) {
+    char retry[12];
+    snprintf(retry, sizeof(retry), "%lu",
+             (unsigned long)((clipBuffer.getPostEndMs() - millis()) / 1000 + 1));
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", retry);
+    return httpd_resp_sendstr(req, "Clip still recording");
+  }
+  if (!clipBuffer.beginRead()) {
+    httpd_resp_set_status(req, "404 Not Found");
+    return httpd_resp_sendstr(req, "No clip; trigger one with POST /clip/trigger");
+  }
+
+  char query[32];
+  char format[8] = "";
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+    httpd_query_key_value(query, "format", format, sizeof(format));
+  }
+  bool raw = strcmp(format, "raw") == 0;
+
+  esp_err_t res;
+  if (raw) {
+    res = httpd_resp_set_type(req, "video/x-motion-jpeg");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"clip.mjpeg\"");
+  } else {
+    res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
+  }
+
+  // Frames are pinned while reading and sent straight from PSRAM
+  char partBuf[64];
+  const uint8_t* data;
+  size_t length;
+  uint32_t capturedMs;
+  for (uint16_t i = 0; res == ESP_OK && clipBuffer.readFrame(i, &data, &length, &capturedMs); i++) {
+    if (!raw) {
+      size_t hlen = snprintf(partBuf, sizeof(partBuf), _STREAM_PART, length);
+      res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+      if (res == ESP_OK) {
+        res = httpd_resp_send_chunk(req, partBuf, hlen);
+      }
+    }
+    if (res == ESP_OK) {
+      res = httpd_resp_send_chunk(req, (const char *)data, length);
+    }
+  }
+  clipBuffer.endRead();
+  if (res == ESP_OK) {
+    res = httpd_resp_send_chunk(req, NULL, 0);
   }
-  
   return res;
 }
 
+// Mark an event now; the clip is ready CLIP_POST_MS later
+static esp_err_t clip_trigger_handler(httpd_req_t *req) {
+  uint32_t now = millis();
+  httpd_resp_set_type(req, "application/json");
+  if (!clipBuffer.isReady()) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_sendstr(req, "{\"error\":\"no clip history\"}");
+  }
+  if (!clipBuffer.trigger(now)) {
+    httpd_resp_set_status(req, "409 Conflict");
+    return httpd_resp_sendstr(req, "{\"error\":\"clip download in progress\"}");
+  }
+  char json[96];
+  snprintf(json, sizeof(json), "{\"readyInMs\":%lu,\"historyMs\":%lu}",
+           (unsigned long)(clipBuffer.getPostEndMs() - now),
+           (unsigned long)clipBuffer.getHistoryMs());
+  return httpd_resp_sendstr(req, json);
+}
+
 // Basic camera control page
 static esp_err_t index_handler(httpd_req_t *req) {
   httpd_resp_set_type(req, "text/html");
@@ -373,13 +766,17 @@ static esp_err_t index_handler(httpd_req_t *req) {
   html += "<p><strong>Location:</strong> " + config.location + "</p>";
   html += "<p><strong>Beacon ID:</strong> " + config.beaconId + "</p>";
   html += "<p><strong>Battery:</strong> " + String(batteryLevel) + "%</p>";
-  html += "<p><strong>Streaming:</strong> " + String(streamingActive ? "Active" : "Inactive") + "</p>";
-  html += "<p><strong>Connected Clients:</strong> " + String(streamClients) + "</p>";
+  html += "<p><strong>Streaming:</strong> " + String(isStreaming() ? "Active" : "Inactive") + "</p>";
+  html += "<p><strong>Connected Clients:</strong> " + String(frameHub.getClientCount()) + "</p>";
   html += "<hr>";
   html += "<h3>Video Stream</h3>";
   html += "<img src='/stream' style='width:100%; max-width:800px;'>";
   html += "<hr>";
   html += "<p><a href='/stream'>Direct Stream Link</a></p>";
+  if (clipBuffer.isReady()) {
+    html += "<form method='post' action='/clip/trigger'><button>Mark Event</button> "
+            "<a href='/clip'>Last Event Clip</a></form>";
+  }
   html += "</body></html>";
   
   return httpd_resp_send(req, html.c_str(), html.length());
@@ -388,6 +785,9 @@ static esp_err_t index_handler(httpd_req_t *req) {
 void startCameraServer() {
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
   config.server_port = 80;
+  // Every viewer keeps its socket open; leave room for page requests
+  config.max_open_sockets = CAM_STREAM_MAX_CLIENTS + 3;
+  config.lru_purge_enable = true;
 
   httpd_uri_t index_uri = {
     .uri       = "/",
@@ -403,10 +803,27 @@ void startCameraServer() {
     .user_ctx  = NULL
   };
 
+  httpd_uri_t clip_uri = {
+    .uri       = "/clip",
+    .method    = HTTP_GET,
+    .handler   = clip_handler,
+    .user_ctx  = NULL
+  };
+
+  // POST only: it changes state, so crawlers and link prefetch must not fire it
+  httpd_uri_t clip_trigger_uri = {
+    .uri       = "/clip/trigger",
+    .method    = HTTP_POST,
+    .handler   = clip_trigger_handler,
+    .user_ctx  = NULL
+  };
+
   Serial.printf("Starting web server on port: '%d'\n", config.server_port);
   if (httpd_start(&camera_httpd, &config) == ESP_OK) {
     httpd_register_uri_handler(camera_httpd, &index_uri);
     httpd_register_uri_handler(camera_httpd, &stream_uri);
+    httpd_register_uri_handler(camera_httpd, &clip_uri);
+    httpd_register_uri_handler(camera_httpd, &clip_trigger_uri);
     Serial.println("✅ Camera web server started successfully");
   } else {
     Serial.println("❌ Failed to start camera web server");
@@ -476,6 +893,9 @@ void initializeBLE() {
   // Create BLE Server
   pServer = BLEDevice::createServer();
   
+  static BeaconServerCallbacks serverCallbacks;
+  pServer->setCallbacks(&serverCallbacks);
+  
   // Get advertising object
   pAdvertising = BLEDevice::getAdvertising();
   
@@ -501,9 +921,12 @@ void startAdvertising() {
   metadata.beaconId = config.beaconId.substring(config.beaconId.length()-2).toInt(); // Last 2 digits
   metadata.batteryLevel = batteryLevel;
   metadata.locationHash = calculateLocationHash(config.location);
-  metadata.cameraStatus = cameraInitialized ? (streamingActive ? 2 : 1) : 0;
-  metadata.streamClients = streamClients;
+  metadata.cameraStatus = cameraInitialized ? (isStreaming() ? 2 : 1) : 0;
+  metadata.streamClients = frameHub.getClientCount();
   metadata.uptime = millis() / 60000; // Uptime in minutes
+  advertisedMotion = motionDetector.isMotion(millis());
+  metadata.flags = (advertisedMotion ? CAM_FLAG_MOTION : 0) |
+                   (isCollarNearby() ? CAM_FLAG_COLLAR_NEARBY : 0);
   
   // Set service data with metadata
   String metadataString = "";
@@ -522,7 +945,7 @@ void startAdvertising() {
   
   Serial.printf("✅ Broadcasting as: %s\n", config.fullName.c_str());
   Serial.printf("✅ Location: %s, ID: %s\n", config.location.c_str(), config.beaconId.c_str());
-  Serial.printf("✅ Camera Status: %s\n", cameraInitialized ? (streamingActive ? "Streaming" : "Ready") : "Offline");
+  Serial.printf("✅ Camera Status: %s\n", cameraInitialized ? (isStreaming() ? "Streaming" : "Ready") : "Offline");
 }
 
 uint8_t calculateLocationHash(const String& location) {
@@ -541,7 +964,7 @@ void handleStatusLED() {
   int blinkInterval;
   if (!cameraInitialized) {
     blinkInterval = 2000; // Slow blink when camera failed
-  } else if (streamingActive) {
+  } else if (isStreaming()) {
     blinkInterval = 200;  // Fast blink when streaming
   } else if (configChanged) {
     blinkInterval = 500;  // Medium blink when config changed
@@ -664,6 +1087,23 @@ void handleSerialCommands() {
         toggleFlashLED();
         break;
         
+      case 'v':
+      case 'V':
+        showStreamStats();
+        break;
+        
+      case 'e':
+      case 'E':
+        triggerClip("serial");
+        break;
+        
+      case 'u':
+      case 'U':
+        runCameraFrameHubTests();
+        runMotionDetectorTests();
+        runClipBufferTests();
+        break;
+        
       case 'h':
       case 'H':
         showCommands();
@@ -810,8 +1250,10 @@ void showStatus() {
   Serial.printf("Uptime: %lu seconds\n", millis() / 1000);
   Serial.printf("BLE Advertising: %s\n", isAdvertising ? "ACTIVE" : "STOPPED");
   Serial.printf("Camera: %s\n", cameraInitialized ? "READY" : "FAILED");
-  Serial.printf("Video Streaming: %s\n", streamingActive ? "ACTIVE" : "INACTIVE");
-  Serial.printf("Stream Clients: %d\n", streamClients);
+  Serial.printf("Video Streaming: %s\n", isStreaming() ? "ACTIVE" : "INACTIVE");
+  Serial.printf("Stream Clients: %d\n", frameHub.getClientCount());
+  Serial.printf("Motion: %s\n", motionDetector.isMotion(millis()) ? "DETECTED" : "none");
+  Serial.printf("Collar Nearby: %s\n", isCollarNearby() ? "YES" : "NO");
   Serial.printf("WiFi AP: %s\n", ssid);
   Serial.printf("Video URL: http://%s/stream\n", WiFi.softAPIP().toString().c_str());
   Serial.printf("Config Changed: %s\n", configChanged ? "YES" : "NO");
@@ -819,6 +1261,58 @@ void showStatus() {
   Serial.println("═══════════════════════════════════");
 }
 
+void showStreamStats() {
+  CamStreamStats stats = frameHub.getStats();
+  Serial.println("═══════════════════════════════════");
+  Serial.println("       VIDEO STREAM STATISTICS");
+  Serial.println("═══════════════════════════════════");
+  Serial.printf("Viewers: %d of %d (%s)\n", frameHub.getClientCount(), CAM_STREAM_MAX_CLIENTS,
+                CAM_ASYNC_STREAMS ? "one task each" : "one at a time");
+  Serial.printf("Capture: %.1f fps, last frame %lu us\n", frameHub.getCaptureFps(),
+                (unsigned long)stats.lastCaptureUs);
+  Serial.printf("Frames: %lu captured, %lu sent, %lu skipped by slow viewers\n",
+                (unsigned long)stats.captured, (unsigned long)stats.sent,
+                (unsigned long)stats.skipped);
+  Serial.printf("Errors: %lu capture, %lu viewers rejected\n",
+                (unsigned long)stats.captureErrors, (unsigned long)stats.rejected);
+  Serial.printf("Frame buffers: %lu bytes\n", (unsigned long)stats.bufferBytes);
+  const StreamLevel& level = rateController.getLevel();
+  const StreamRateStats& rateStats = rateController.getStats();
+  Serial.printf("Level: %u of %u (framesize %u, quality %u)\n",
+                rateController.getLevelIndex() + 1, rateController.getLevelCount(),
+                level.frameSize, level.quality);
+  Serial.printf("Pacing: %lu ms/frame%s, send %lu-%lu ms (target %d ms)\n",
+                (unsigned long)rateController.getFrameIntervalMs(),
+                rateController.isKeepalive() ? " (keepalive, no motion)" : "",
+                (unsigned long)rateController.getFastestSendMs(),
+                (unsigned long)rateController.getSlowestSendMs(), STREAM_TARGET_SEND_MS);
+  Serial.printf("Adjustments: %lu down, %lu up, %lu keepalive periods\n",
+                (unsigned long)rateStats.stepsDown, (unsigned long)rateStats.stepsUp,
+                (unsigned long)rateStats.keepaliveEntries);
+  const MotionStats& motion = motionDetector.getStats();
+  Serial.printf("Motion: %s, %lu events, %lu of %lu checks with motion\n",
+                motionDetector.isMotion(millis()) ? "DETECTED" : "none",
+                (unsigned long)motion.events, (unsigned long)motion.motionFrames,
+                (unsigned long)motion.frames);
+  Serial.printf("Last check: %u of %u cells changed, %lu us\n", motion.lastChangedCells,
+                MOTION_GRID_W * MOTION_GRID_H, (unsigned long)motion.lastCheckUs);
+  if (clipBuffer.isReady()) {
+    static const char* CLIP_STATES[] = {"idle", "recording", "ready"};
+    ClipStats clip = clipBuffer.getStats();
+    Serial.printf("Clip history: %u frames, %lu s, %u KB ring; clip %s (%u frames)\n",
+                  clipBuffer.getFrameCount(), (unsigned long)(clipBuffer.getHistoryMs() / 1000),
+                  (unsigned)(clipBuffer.getCapacity() / 1024),
+                  CLIP_STATES[(uint8_t)clipBuffer.getState()], clipBuffer.getClipFrameCount());
+    Serial.printf("Clip frames: %lu stored, %lu evicted, %lu dropped; %lu events (%lu refused), %lu downloads\n",
+                  (unsigned long)clip.stored, (unsigned long)clip.evicted, (unsigned long)clip.dropped,
+                  (unsigned long)clip.triggers, (unsigned long)clip.rejectedTriggers,
+                  (unsigned long)clip.served);
+  } else {
+    Serial.println("Clip history: disabled (no PSRAM)");
+  }
+  Serial.println("═══════════════════════════════════");
+}
+
 void showCommands() {
   Serial.println("═══════════════════════════════════");
   Serial.println("       AVAILABLE COMMANDS");
@@ -832,6 +1326,9 @@ void showCommands() {
   Serial.println("p - Show preset configurations");
   Serial.println("c - Display current configuration");
   Serial.println("t - Toggle flash LED");
+  Serial.println("v - Show video stream statistics");
+  Serial.println("e - Mark an event (saves a clip for /clip)");
+  Serial.println("u - Run frame hub, motion and clip self-tests");
   Serial.println("h - Show this help menu");
   Serial.println();
   Serial.println("Examples:");
@@ -0,0 +1,84 @@
+/*
+ * Motion Detector
+ * Low-resolution grayscale frame differencing against a background model
+ *
+ * Frames are decoded at reduced scale, converted to gray and averaged into
+ * a MOTION_GRID_W x MOTION_GRID_H grid of cells. Each cell is compared with
+ * a slowly adapting background (exponential average, 8.8 fixed point); a
+ * frame has motion when more than MOTION_AREA_PCT of the cells differ from
+ * the background by more than MOTION_CELL_THRESHOLD gray levels.
+ *
+ * Pixels are accumulated a row at a time through a precomputed column to
+ * cell table, so the inner loop is a straight pass over contiguous memory.
+ */
+
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <Arduino.h>
+
+#define MOTION_GRID_W 32
+#define MOTION_GRID_H 24
+#define MOTION_MAX_WIDTH 256            // Widest decoded frame accepted
+#define MOTION_CELL_THRESHOLD 15        // Gray levels a cell must change by
+#define MOTION_AREA_PCT 3               // Changed cells that make a frame "motion"
+#define MOTION_BG_SHIFT 3               // Background moves 1/8 of the way per frame
+#define MOTION_SETTLE_FRAMES 2          // Frames that only seed the background
+#define MOTION_HOLD_MS 5000             // Motion flag stays up this long
+
+struct MotionStats {
+  uint32_t frames;          // Frames compared
+  uint32_t motionFrames;    // Frames with motion
+  uint32_t events;          // Still -> motion transitions
+  uint32_t rejected;        // Frames too wide or never started
+  uint16_t lastChangedCells;
+  uint32_t lastCheckUs;     // Decode + compare time of the last check
+};
+
+class MotionDetector {
+ public:
+  MotionDetector();
+
+  // Forget the background (after a resolution or exposure change)
+  void reset();
+
+  // Start a decoded frame of width x height pixels
+  bool beginFrame(uint16_t width, uint16_t height);
+
+  // Add a block of RGB888 pixels, as produced by the JPEG decoder
+  void addRgbBlock(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t* rgb);
+
+  // Add one row of 8-bit gray pixels
+  void addGrayRow(uint16_t y, const uint8_t* gray);
+
+  // Compare the frame with the background and update it; true if motion
+  bool endFrame(uint32_t nowMs, uint32_t checkUs);
+
+  // Motion seen within the last MOTION_HOLD_MS
+  bool isMotion(uint32_t nowMs) const {
+    return m_lastMotionMs != 0 && nowMs - m_lastMotionMs < MOTION_HOLD_MS;
+  }
+
+  uint32_t getLastMotionMs() const { return m_lastMotionMs; }
+  const MotionStats& getStats() const { return m_stats; }
+
+ private:
+  uint32_t m_sum[MOTION_GRID_H * MOTION_GRID_W];
+  uint16_t m_count[MOTION_GRID_H * MOTION_GRID_W];
+  uint16_t m_background[MOTION_GRID_H * MOTION_GRID_W];
+  uint8_t m_colCell[MOTION_MAX_WIDTH];
+  uint16_t m_width;
+  uint16_t m_height;
+  bool m_inFrame;
+  uint8_t m_settleFrames;
+  bool m_lastFrameMotion;
+  uint32_t m_lastMotionMs;
+  MotionStats m_stats;
+
+  uint8_t rowCell(uint16_t y) const { return (uint32_t)y * MOTION_GRID_H / m_height; }
+};
+
+// Self-tests on synthetic frames (serial 'u'); true if all passed
+bool runMotionDetectorTests();
+
+#endif // MOTION_DETECTOR_H
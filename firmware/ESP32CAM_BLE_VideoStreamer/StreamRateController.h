@@ -0,0 +1,92 @@
+/*
+ * Stream Rate Controller
+ * Adapts MJPEG frame size, JPEG quality and frame interval to the viewers
+ *
+ * Every sender task reports how long each frame took to send. Once per
+ * STREAM_RATE_ADJUST_MS the controller steps along a ladder of
+ * (frame size, quality) levels so that the slowest viewer sends a frame in
+ * about STREAM_TARGET_SEND_MS, and paces capture to the fastest viewer
+ * (capped at STREAM_MAX_FPS), since the others skip frames anyway.
+ *
+ * With no motion reported for STREAM_IDLE_AFTER_MS the stream drops to one
+ * frame per STREAM_KEEPALIVE_MS, which keeps viewers connected while saving
+ * airtime and heat; motion or a new viewer restores the full rate at once.
+ */
+
+#ifndef STREAM_RATE_CONTROLLER_H
+#define STREAM_RATE_CONTROLLER_H
+
+#include <Arduino.h>
+#include "CameraFrameHub.h"
+
+#ifndef STREAM_TARGET_SEND_MS
+#define STREAM_TARGET_SEND_MS 100      // Per-frame send time aimed for on the slowest viewer
+#endif
+#ifndef STREAM_MAX_FPS
+#define STREAM_MAX_FPS 15
+#endif
+#define STREAM_RATE_ADJUST_MS 1000     // Time between level decisions
+#define STREAM_UPGRADE_HOLD_MS 5000    // No step up this soon after a step down
+#define STREAM_IDLE_AFTER_MS 10000     // No motion this long -> keepalive
+#define STREAM_KEEPALIVE_MS 1000       // Frame interval while idle
+
+// One rung of the quality ladder (values are esp_camera framesize_t and
+// sensor JPEG quality, 0 = best)
+struct StreamLevel {
+  uint8_t frameSize;
+  uint8_t quality;
+};
+
+struct StreamRateStats {
+  uint32_t stepsDown;       // Lighter level chosen (slow viewer)
+  uint32_t stepsUp;         // Heavier level chosen (spare throughput)
+  uint32_t keepaliveEntries;
+};
+
+class StreamRateController {
+ public:
+  StreamRateController();
+
+  // Install the ladder, heaviest level first
+  void begin(const StreamLevel* levels, uint8_t count, uint8_t startLevel);
+
+  // Sender task: one frame took sendUs to send
+  void recordSend(int8_t slot, uint32_t sendUs);
+
+  // Sender task: viewer left
+  void removeClient(int8_t slot);
+
+  // Motion seen (or a new viewer that should get full rate)
+  void reportMotion(uint32_t nowMs);
+
+  // Capture task: re-evaluate; true if the level changed
+  bool update(uint32_t nowMs);
+
+  const StreamLevel& getLevel() const { return m_levels[m_level]; }
+  uint8_t getLevelIndex() const { return m_level; }
+  uint8_t getLevelCount() const { return m_count; }
+  uint32_t getFrameIntervalMs() const { return m_intervalMs; }
+  bool isKeepalive() const { return m_keepalive; }
+  uint32_t getSlowestSendMs() const { return m_slowestUs / 1000; }
+  uint32_t getFastestSendMs() const { return m_fastestUs / 1000; }
+  const StreamRateStats& getStats() const { return m_stats; }
+
+ private:
+  const StreamLevel* m_levels;
+  uint8_t m_count;
+  uint8_t m_level;
+  uint32_t m_sendUs[CAM_STREAM_MAX_CLIENTS];    // Smoothed send time, 0 = no sample
+  uint32_t m_slowestUs;
+  uint32_t m_fastestUs;
+  uint32_t m_intervalMs;
+  uint32_t m_lastAdjustMs;
+  uint32_t m_lastStepDownMs;
+  uint32_t m_lastMotionMs;
+  bool m_keepalive;
+  portMUX_TYPE m_mux;
+  StreamRateStats m_stats;
+
+  void changeLevel(uint8_t level);
+};
+
+#endif // STREAM_RATE_CONTROLLER_H
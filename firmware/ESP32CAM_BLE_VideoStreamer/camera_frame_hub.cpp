@@ -0,0 +1,413 @@
+/*
+ * Camera Frame Hub
+ * Reference-counted JPEG ring shared by the capture task and MJPEG viewers
+ */
+
+#include "CameraFrameHub.h"
+#include <esp_heap_caps.h>
+
+CameraFrameHub::CameraFrameHub()
+  : m_latest(nullptr),
+    m_sequence(0),
+    m_clientMask(0),
+    m_clientCount(0),
+    m_events(nullptr),
+    m_fpsWindowStart(0),
+    m_fpsWindowFrames(0),
+    m_captureFps(0) {
+  portMUX_INITIALIZE(&m_mux);
+  memset(m_frames, 0, sizeof(m_frames));
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool CameraFrameHub::begin() {
+  if (!m_events) {
+    m_events = xEventGroupCreate();
+  }
+  return m_events != nullptr;
+}
+
+void CameraFrameHub::releaseLocked(CamFrame* frame) {
+  if (frame->refs > 0) {
+    frame->refs--;
+  }
+}
+
+CamFrame* CameraFrameHub::beginFrame(size_t length) {
+  CamFrame* frame = nullptr;
+  portENTER_CRITICAL(&m_mux);
+  for (uint8_t i = 0; i < CAM_FRAME_SLOTS; i++) {
+    if (m_frames[i].refs == 0) {
+      frame = &m_frames[i];
+      frame->refs = 1;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&m_mux);
+
+  if (!frame) {
+    countCaptureError();
+    return nullptr;
+  }
+
+  // Only the producer touches a frame it holds alone, so it can grow unlocked
+  if (frame->capacity < length) {
+    size_t capacity = (length + CAM_FRAME_ALLOC_STEP - 1) / CAM_FRAME_ALLOC_STEP * CAM_FRAME_ALLOC_STEP;
+    free(frame->data);
+    frame->data = (uint8_t*)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!frame->data) {
+      frame->data = (uint8_t*)malloc(capacity);
+    }
+    size_t oldCapacity = frame->capacity;
+    frame->capacity = frame->data ? capacity : 0;
+
+    portENTER_CRITICAL(&m_mux);
+    m_stats.bufferBytes = m_stats.bufferBytes - oldCapacity + frame->capacity;
+    portEXIT_CRITICAL(&m_mux);
+
+    if (!frame->data) {
+      release(frame);
+      countCaptureError();
+      return nullptr;
+    }
+  }
+  frame->length = 0;
+  return frame;
+}
+
+void CameraFrameHub::publishFrame(CamFrame* frame, uint32_t nowMs, uint32_t captureUs) {
+  portENTER_CRITICAL(&m_mux);
+  frame->sequence = ++m_sequence;
+  frame->capturedMs = nowMs;
+  // The producer's reference becomes the hub's reference to the latest frame
+  if (m_latest) {
+    releaseLocked(m_latest);
+  }
+  m_latest = frame;
+  m_stats.captured++;
+  m_stats.lastCaptureUs = captureUs;
+  uint8_t waiting = m_clientMask;
+  portEXIT_CRITICAL(&m_mux);
+
+  m_fpsWindowFrames++;
+  if (nowMs - m_fpsWindowStart >= 1000) {
+    m_captureFps = m_fpsWindowFrames * 1000.0f / (nowMs - m_fpsWindowStart);
+    m_fpsWindowStart = nowMs;
+    m_fpsWindowFrames = 0;
+  }
+
+  if (m_events && waiting) {
+    xEventGroupSetBits(m_events, waiting);
+  }
+}
+
+void CameraFrameHub::countCaptureError() {
+  portENTER_CRITICAL(&m_mux);
+  m_stats.captureErrors++;
+  portEXIT_CRITICAL(&m_mux);
+}
+
+int8_t CameraFrameHub::addClient() {
+  int8_t slot = -1;
+  portENTER_CRITICAL(&m_mux);
+  for (uint8_t i = 0; i < CAM_STREAM_MAX_CLIENTS; i++) {
+    if (!(m_clientMask & (1 << i))) {
+      m_clientMask |= (1 << i);
+      m_clientCount++;
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0) {
+    m_stats.rejected++;
+  }
+  portEXIT_CRITICAL(&m_mux);
+
+  if (slot >= 0 && m_events) {
+    xEventGroupClearBits(m_events, 1 << slot);
+  }
+  return slot;
+}
+
+void CameraFrameHub::removeClient(int8_t slot) {
+  if (slot < 0 || slot >= CAM_STREAM_MAX_CLIENTS) {
+    return;
+  }
+
+  uint8_t* toFree[CAM_FRAME_SLOTS];
+  uint8_t freeCount = 0;
+
+  portENTER_CRITICAL(&m_mux);
+  if (m_clientMask & (1 << slot)) {
+    m_clientMask &= ~(1 << slot);
+    m_clientCount--;
+  }
+  if (m_clientCount == 0) {
+    // Nobody watching: drop the latest frame and give the heap back
+    if (m_latest) {
+      releaseLocked(m_latest);
+      m_latest = nullptr;
+    }
+    for (uint8_t i = 0; i < CAM_FRAME_SLOTS; i++) {
+      CamFrame& frame = m_frames[i];
+      if (frame.refs == 0 && frame.data) {
+        toFree[freeCount++] = frame.data;
+        m_stats.bufferBytes -= frame.capacity;
+        frame.data = nullptr;
+        frame.capacity = 0;
+      }
+    }
+  }
+  portEXIT_CRITICAL(&m_mux);
+
+  for (uint8_t i = 0; i < freeCount; i++) {
+    free(toFree[i]);
+  }
+}
+
+bool CameraFrameHub::waitForFrame(int8_t slot, uint32_t timeoutMs) {
+  if (!m_events) {
+    vTaskDelay(pdMS_TO_TICKS(timeoutMs));
+    return false;
+  }
+  EventBits_t bits = xEventGroupWaitBits(m_events, 1 << slot, pdTRUE, pdFALSE,
+                                         pdMS_TO_TICKS(timeoutMs));
+  return (bits & (1 << slot)) != 0;
+}
+
+CamFrame* CameraFrameHub::acquireLatest(uint32_t afterSequence) {
+  CamFrame* frame = nullptr;
+  portENTER_CRITICAL(&m_mux);
+  if (m_latest && m_latest->sequence != afterSequence) {
+    frame = m_latest;
+    frame->refs++;
+  }
+  portEXIT_CRITICAL(&m_mux);
+  return frame;
+}
+
+void CameraFrameHub::release(CamFrame* frame) {
+  if (!frame) {
+    return;
+  }
+  portENTER_CRITICAL(&m_mux);
+  releaseLocked(frame);
+  portEXIT_CRITICAL(&m_mux);
+}
+
+void CameraFrameHub::countSent(uint32_t previousSequence, uint32_t sequence) {
+  portENTER_CRITICAL(&m_mux);
+  m_stats.sent++;
+  if (previousSequence != 0 && sequence - previousSequence > 1) {
+    m_stats.skipped += sequence - previousSequence - 1;
+  }
+  portEXIT_CRITICAL(&m_mux);
+}
+
+CamStreamStats CameraFrameHub::getStats() {
+  portENTER_CRITICAL(&m_mux);
+  CamStreamStats stats = m_stats;
+  portEXIT_CRITICAL(&m_mux);
+  return stats;
+}
+
+// ---- Self-tests ----
+
+namespace {
+
+// Deterministic interleavings (xorshift32)
+uint32_t nextRandom(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// Capture and publish a frame whose bytes all carry its sequence number
+CamFrame* publishTestFrame(CameraFrameHub& hub, size_t length, uint32_t nowMs) {
+  CamFrame* frame = hub.beginFrame(length);
+  if (!frame) {
+    return nullptr;
+  }
+  uint8_t tag = (uint8_t)(hub.getStats().captured + 1);
+  memset(frame->data, tag, length);
+  frame->length = length;
+  hub.publishFrame(frame, nowMs, 0);
+  return frame;
+}
+
+// A held frame still holds what was published into it
+bool frameIntact(const CamFrame* frame) {
+  for (size_t i = 0; i < frame->length; i++) {
+    if (frame->data[i] != (uint8_t)frame->sequence) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whatever frames the viewers hold, the producer gets a buffer and never
+// writes into one still being sent
+bool testProducerAlwaysFindsSlot() {
+  Serial.println("📊 Test 1: Producer finds a free buffer while every viewer holds a frame");
+
+  CameraFrameHub hub;
+  int8_t slots[CAM_STREAM_MAX_CLIENTS];
+  CamFrame* held[CAM_STREAM_MAX_CLIENTS] = {};
+  uint32_t lastSent[CAM_STREAM_MAX_CLIENTS] = {};
+  bool passed = true;
+
+  for (uint8_t v = 0; v < CAM_STREAM_MAX_CLIENTS; v++) {
+    slots[v] = hub.addClient();
+    passed = passed && slots[v] == v;
+  }
+  passed = passed && hub.addClient() < 0 && hub.getStats().rejected == 1;
+
+  // Worst case: every viewer on a different frame, and a newer latest one
+  uint32_t nowMs = 0;
+  for (uint8_t v = 0; v < CAM_STREAM_MAX_CLIENTS && passed; v++) {
+    passed = publishTestFrame(hub, 1000, nowMs += 50) != nullptr;
+    held[v] = hub.acquireLatest(lastSent[v]);
+    passed = passed && held[v] != nullptr;
+    lastSent[v] = held[v] ? held[v]->sequence : 0;
+  }
+  passed = passed && publishTestFrame(hub, 1000, nowMs += 50) != nullptr;
+  passed = passed && publishTestFrame(hub, 1000, nowMs += 50) != nullptr;
+
+  // Then random holds and releases, with frame sizes that force regrowth
+  uint32_t rng = 0x2545F491;
+  for (uint16_t step = 0; step < 2000 && passed; step++) {
+    size_t length = 500 + nextRandom(rng) % (3 * CAM_FRAME_ALLOC_STEP);
+    passed = publishTestFrame(hub, length, nowMs += 50) != nullptr;
+
+    for (uint8_t v = 0; v < CAM_STREAM_MAX_CLIENTS && passed; v++) {
+      uint32_t roll = nextRandom(rng) % 4;
+      if (held[v] && roll == 0) {
+        passed = frameIntact(held[v]);
+        hub.release(held[v]);
+        held[v] = nullptr;
+      } else if (!held[v] && roll == 1) {
+        held[v] = hub.acquireLatest(lastSent[v]);
+        if (held[v]) {
+          lastSent[v] = held[v]->sequence;
+        }
+      }
+    }
+  }
+
+  for (uint8_t v = 0; v < CAM_STREAM_MAX_CLIENTS; v++) {
+    if (held[v]) {
+      passed = passed && frameIntact(held[v]);
+      hub.release(held[v]);
+    }
+    hub.removeClient(slots[v]);
+  }
+
+  CamStreamStats stats = hub.getStats();
+  passed = passed && stats.captureErrors == 0 && stats.bufferBytes == 0;
+  Serial.printf("   %lu frames published, %lu capture errors\n",
+                (unsigned long)stats.captured, (unsigned long)stats.captureErrors);
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// The last viewer out frees idle buffers but not one still being sent
+bool testLastViewerFreesIdleBuffers() {
+  Serial.println("📊 Test 2: Last viewer out frees only unreferenced buffers");
+
+  CameraFrameHub hub;
+  int8_t a = hub.addClient();
+  int8_t b = hub.addClient();
+
+  // Two buffers in rotation: the latest frame and the one being captured
+  bool passed = true;
+  for (uint8_t i = 0; i < 3; i++) {
+    passed = passed && publishTestFrame(hub, 5000, i * 100) != nullptr;
+  }
+  uint32_t rounded = (5000 + CAM_FRAME_ALLOC_STEP - 1) / CAM_FRAME_ALLOC_STEP * CAM_FRAME_ALLOC_STEP;
+  passed = passed && hub.getStats().bufferBytes == 2 * rounded;
+
+  CamFrame* sending = hub.acquireLatest(0);
+  passed = passed && sending != nullptr;
+  if (!passed) {
+    Serial.printf("   Result: %s\n", "FAILED ✗");
+    return false;
+  }
+
+  hub.removeClient(b);
+  passed = passed && hub.getStats().bufferBytes == 2 * rounded;
+
+  // Viewer a is still mid-send of the latest frame when it leaves
+  hub.removeClient(a);
+  passed = passed && hub.getStats().bufferBytes == sending->capacity && frameIntact(sending);
+  passed = passed && hub.acquireLatest(0) == nullptr;
+  hub.release(sending);
+
+  // Its buffer is reused by the next viewer's first frame, then freed with it
+  int8_t c = hub.addClient();
+  passed = passed && publishTestFrame(hub, 5000, 1000) == sending &&
+           hub.getStats().bufferBytes == rounded;
+  hub.removeClient(c);
+  passed = passed && hub.getStats().bufferBytes == 0;
+
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// A slow viewer's skipped frames are counted, a fast one skips none
+bool testSkippedFramesCounted() {
+  Serial.println("📊 Test 3: countSent() counts frames a slow viewer skipped");
+
+  CameraFrameHub hub;
+  int8_t fast = hub.addClient();
+  int8_t slow = hub.addClient();
+  uint32_t fastLast = 0;
+  uint32_t slowLast = 0;
+  bool passed = true;
+
+  for (uint8_t i = 1; i <= 30 && passed; i++) {
+    passed = publishTestFrame(hub, 800, i * 33) != nullptr;
+
+    CamFrame* frame = hub.acquireLatest(fastLast);
+    passed = passed && frame != nullptr && hub.acquireLatest(frame->sequence) == nullptr;
+    if (frame) {
+      hub.countSent(fastLast, frame->sequence);
+      fastLast = frame->sequence;
+      hub.release(frame);
+    }
+
+    // The slow viewer only gets through every third frame
+    if (i % 3 == 0) {
+      frame = hub.acquireLatest(slowLast);
+      passed = passed && frame != nullptr;
+      if (frame) {
+        hub.countSent(slowLast, frame->sequence);
+        slowLast = frame->sequence;
+        hub.release(frame);
+      }
+    }
+  }
+  hub.removeClient(fast);
+  hub.removeClient(slow);
+
+  // Slow viewer: 10 sends, 2 skipped before each but its first
+  CamStreamStats stats = hub.getStats();
+  passed = passed && stats.sent == 30 + 10 && stats.skipped == 9 * 2;
+  Serial.printf("   Sent %lu, skipped %lu\n", (unsigned long)stats.sent, (unsigned long)stats.skipped);
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+} // namespace
+
+bool runCameraFrameHubTests() {
+  Serial.println("\n🧪 Running Camera Frame Hub Unit Tests...\n");
+
+  bool passed = true;
+  passed &= testProducerAlwaysFindsSlot();
+  passed &= testLastViewerFreesIdleBuffers();
+  passed &= testSkippedFramesCounted();
+
+  Serial.printf("\n%s Camera Frame Hub Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+  return passed;
+}
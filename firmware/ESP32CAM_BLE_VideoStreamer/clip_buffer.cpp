@@ -0,0 +1,483 @@
+/*
+ * Clip Buffer
+ * PSRAM byte ring with pinned event clips
+ */
+
+#include "ClipBuffer.h"
+#include <esp_heap_caps.h>
+
+ClipBuffer::ClipBuffer()
+  : m_arena(nullptr),
+    m_capacity(0),
+    m_first(0),
+    m_count(0),
+    m_head(0),
+    m_nextSequence(1),
+    m_lastStoreMs(0),
+    m_state(ClipState::IDLE),
+    m_eventMs(0),
+    m_postEndMs(0),
+    m_readyMs(0),
+    m_clipFirst(1),
+    m_clipLast(0),
+    m_readers(0) {
+  portMUX_INITIALIZE(&m_mux);
+  memset(m_entries, 0, sizeof(m_entries));
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+ClipBuffer::~ClipBuffer() {
+  free(m_arena);
+}
+
+bool ClipBuffer::begin(size_t bytes) {
+  if (m_arena) {
+    return true;
+  }
+  // Internal RAM cannot spare this much; no PSRAM means no history
+  m_arena = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  m_capacity = m_arena ? bytes : 0;
+  return m_arena != nullptr;
+}
+
+bool ClipBuffer::wantsFrame(uint32_t nowMs) const {
+  return m_arena && (m_stats.stored == 0 || nowMs - m_lastStoreMs >= CLIP_FRAME_INTERVAL_MS);
+}
+
+bool ClipBuffer::isPinned(const Entry& entry) const {
+  return m_state != ClipState::IDLE &&
+         entry.sequence >= m_clipFirst && entry.sequence <= m_clipLast;
+}
+
+bool ClipBuffer::evictOldestLocked() {
+  if (m_count == 0 || isPinned(oldest())) {
+    return false;
+  }
+  m_first = (m_first + 1) % CLIP_MAX_FRAMES;
+  m_count--;
+  m_stats.evicted++;
+  if (m_count == 0) {
+    m_head = 0;
+  }
+  return true;
+}
+
+const ClipBuffer::Entry* ClipBuffer::findLocked(uint32_t sequence) const {
+  if (m_count == 0 || sequence < oldest().sequence) {
+    return nullptr;
+  }
+  uint32_t back = sequence - oldest().sequence;
+  if (back >= m_count) {
+    return nullptr;
+  }
+  return &m_entries[(m_first + back) % CLIP_MAX_FRAMES];
+}
+
+bool ClipBuffer::store(const uint8_t* jpg, size_t length, uint32_t nowMs) {
+  if (!m_arena) {
+    return false;
+  }
+  m_lastStoreMs = nowMs;
+  if (length == 0 || length > m_capacity) {
+    portENTER_CRITICAL(&m_mux);
+    m_stats.dropped++;
+    portEXIT_CRITICAL(&m_mux);
+    return false;
+  }
+
+  // Make room: frames leave in FIFO order, which is also arena order from
+  // the head, so only the oldest frame ever needs checking
+  bool room = true;
+  uint32_t offset;
+  portENTER_CRITICAL(&m_mux);
+  if (m_count == CLIP_MAX_FRAMES) {
+    room = evictOldestLocked();
+  }
+  if (room && m_head + length > m_capacity) {
+    // Wrap: everything between the head and the end is older than the
+    // frames at the start of the arena
+    while (room && m_count > 0 && oldest().offset >= m_head) {
+      room = evictOldestLocked();
+    }
+    if (room) {
+      m_head = 0;
+    }
+  }
+  while (room && m_count > 0 && oldest().offset < m_head + length &&
+         oldest().offset + oldest().length > m_head) {
+    room = evictOldestLocked();
+  }
+  if (!room) {
+    m_stats.dropped++;
+  }
+  offset = m_head;
+  portEXIT_CRITICAL(&m_mux);
+
+  if (!room) {
+    return false;
+  }
+
+  // Only this task writes, and readers never see an uncommitted entry
+  memcpy(m_arena + offset, jpg, length);
+
+  portENTER_CRITICAL(&m_mux);
+  Entry& entry = m_entries[(m_first + m_count) % CLIP_MAX_FRAMES];
+  entry.offset = offset;
+  entry.length = length;
+  entry.capturedMs = nowMs;
+  entry.sequence = m_nextSequence++;
+  m_count++;
+  m_head = offset + length;
+  m_stats.stored++;
+  if (m_state == ClipState::RECORDING && (int32_t)(nowMs - m_postEndMs) <= 0) {
+    m_clipLast = entry.sequence;
+  }
+  portEXIT_CRITICAL(&m_mux);
+  return true;
+}
+
+bool ClipBuffer::trigger(uint32_t nowMs) {
+  bool accepted = true;
+  portENTER_CRITICAL(&m_mux);
+  if (m_state == ClipState::RECORDING) {
+    // Another event during the post window: one longer clip
+    m_postEndMs = nowMs + CLIP_POST_MS;
+  } else if (m_readers > 0) {
+    accepted = false;
+  } else {
+    uint32_t first = m_nextSequence;
+    for (uint16_t i = 0; i < m_count; i++) {
+      const Entry& entry = m_entries[(m_first + i) % CLIP_MAX_FRAMES];
+      if (nowMs - entry.capturedMs <= CLIP_PRE_MS) {
+        first = entry.sequence;
+        break;
+      }
+    }
+    m_clipFirst = first;
+    m_clipLast = m_nextSequence - 1;   // Every pre-event frame already stored
+    m_eventMs = nowMs;
+    m_postEndMs = nowMs + CLIP_POST_MS;
+    m_state = ClipState::RECORDING;
+  }
+  if (accepted) {
+    m_stats.triggers++;
+  } else {
+    m_stats.rejectedTriggers++;
+  }
+  portEXIT_CRITICAL(&m_mux);
+  return accepted;
+}
+
+void ClipBuffer::service(uint32_t nowMs) {
+  portENTER_CRITICAL(&m_mux);
+  if (m_state == ClipState::RECORDING && (int32_t)(nowMs - m_postEndMs) > 0) {
+    m_state = ClipState::READY;
+    m_readyMs = nowMs;
+  } else if (m_state == ClipState::READY && m_readers == 0 &&
+             nowMs - m_readyMs > CLIP_KEEP_MS) {
+    m_state = ClipState::IDLE;
+  }
+  portEXIT_CRITICAL(&m_mux);
+}
+
+bool ClipBuffer::beginRead() {
+  bool ok = false;
+  portENTER_CRITICAL(&m_mux);
+  if (m_state == ClipState::READY) {
+    m_readers++;
+    m_stats.served++;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&m_mux);
+  return ok;
+}
+
+bool ClipBuffer::readFrame(uint16_t index, const uint8_t** data, size_t* length, uint32_t* capturedMs) {
+  bool ok = false;
+  portENTER_CRITICAL(&m_mux);
+  uint32_t sequence = m_clipFirst + index;
+  const Entry* entry = sequence <= m_clipLast ? findLocked(sequence) : nullptr;
+  if (entry) {
+    *data = m_arena + entry->offset;
+    *length = entry->length;
+    *capturedMs = entry->capturedMs;
+    ok = true;
+  }
+  portEXIT_CRITICAL(&m_mux);
+  return ok;
+}
+
+uint16_t ClipBuffer::getClipFrameCount() const {
+  if (m_state == ClipState::IDLE || m_clipLast < m_clipFirst) {
+    return 0;
+  }
+  return m_clipLast - m_clipFirst + 1;
+}
+
+void ClipBuffer::endRead() {
+  portENTER_CRITICAL(&m_mux);
+  if (m_readers > 0) {
+    m_readers--;
+  }
+  portEXIT_CRITICAL(&m_mux);
+}
+
+uint32_t ClipBuffer::getHistoryMs() const {
+  if (m_count < 2) {
+    return 0;
+  }
+  const Entry& newest = m_entries[(m_first + m_count - 1) % CLIP_MAX_FRAMES];
+  return newest.capturedMs - oldest().capturedMs;
+}
+
+ClipStats ClipBuffer::getStats() {
+  portENTER_CRITICAL(&m_mux);
+  ClipStats stats = m_stats;
+  portEXIT_CRITICAL(&m_mux);
+  return stats;
+}
+
+// ---- Self-tests ----
+
+namespace {
+
+const size_t TEST_RING_BYTES = 1000;
+const size_t TEST_MAX_FRAME = 300;
+
+// Frame bytes follow from the capture time, so a read can be checked
+uint8_t frameByte(uint32_t capturedMs, size_t i) {
+  return (uint8_t)(capturedMs / 100 * 31 + i);
+}
+
+bool storeFrame(ClipBuffer& clip, size_t length, uint32_t nowMs) {
+  static uint8_t frame[TEST_MAX_FRAME];
+  for (size_t i = 0; i < length; i++) {
+    frame[i] = frameByte(nowMs, i);
+  }
+  return clip.store(frame, length, nowMs);
+}
+
+// Clip frame index holds the frame stored at capturedMs, bytes intact
+bool frameMatches(ClipBuffer& clip, uint16_t index, size_t length, uint32_t capturedMs,
+                  const uint8_t** at = nullptr) {
+  const uint8_t* data = nullptr;
+  size_t got = 0;
+  uint32_t gotMs = 0;
+  if (!clip.readFrame(index, &data, &got, &gotMs) || got != length || gotMs != capturedMs) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] != frameByte(capturedMs, i)) {
+      return false;
+    }
+  }
+  if (at) {
+    *at = data;
+  }
+  return true;
+}
+
+// Trigger at nowMs and run the clip through to READY with a reader on it
+bool finishClip(ClipBuffer& clip, uint32_t nowMs) {
+  if (!clip.trigger(nowMs)) {
+    return false;
+  }
+  clip.service(nowMs + CLIP_POST_MS + 1);
+  return clip.getState() == ClipState::READY && clip.beginRead();
+}
+
+// Frames that no longer fit before the arena end go to its start
+bool testWrapAround() {
+  Serial.println("📊 Test 1: Wrap-around with the head near the arena end");
+
+  ClipBuffer* clip = new ClipBuffer();
+  bool passed = clip->begin(TEST_RING_BYTES);
+
+  // Offsets 0, 300, 600, then 0 (wrap), 300, 550 and 0 again (wrap)
+  const size_t sizes[] = {300, 300, 300, 300, 250, 300, 200};
+  for (uint8_t i = 0; i < 7; i++) {
+    passed = passed && storeFrame(*clip, sizes[i], i * CLIP_FRAME_INTERVAL_MS);
+  }
+  ClipStats stats = clip->getStats();
+  passed = passed && clip->getFrameCount() == 3 && stats.stored == 7 && stats.evicted == 4 &&
+           stats.dropped == 0;
+
+  // The three newest survive intact, the last one back at the arena start
+  const uint8_t* before = nullptr;
+  const uint8_t* wrapped = nullptr;
+  passed = passed && finishClip(*clip, 6 * CLIP_FRAME_INTERVAL_MS) && clip->getClipFrameCount() == 3;
+  passed = passed && frameMatches(*clip, 0, 250, 4 * CLIP_FRAME_INTERVAL_MS, &before);
+  passed = passed && frameMatches(*clip, 1, 300, 5 * CLIP_FRAME_INTERVAL_MS);
+  passed = passed && frameMatches(*clip, 2, 200, 6 * CLIP_FRAME_INTERVAL_MS, &wrapped);
+  passed = passed && wrapped < before;
+  clip->endRead();
+
+  delete clip;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// New frames are dropped rather than written over a pinned clip
+bool testPinnedClipBlocksEviction() {
+  Serial.println("📊 Test 2: Pinned clip frames are never evicted");
+
+  ClipBuffer* clip = new ClipBuffer();
+  bool passed = clip->begin(TEST_RING_BYTES);
+  for (uint8_t i = 0; i < 3; i++) {
+    passed = passed && storeFrame(*clip, 300, i * CLIP_FRAME_INTERVAL_MS);
+  }
+
+  // Every stored frame is in the clip: the post-event frame has nowhere to go
+  passed = passed && clip->trigger(1000) && clip->getState() == ClipState::RECORDING;
+  passed = passed && !storeFrame(*clip, 300, 1500);
+  ClipStats stats = clip->getStats();
+  passed = passed && stats.dropped == 1 && stats.evicted == 0 && clip->getFrameCount() == 3;
+
+  clip->service(1000 + CLIP_POST_MS + 1);
+  passed = passed && clip->beginRead() && clip->getClipFrameCount() == 3;
+  for (uint8_t i = 0; i < 3; i++) {
+    passed = passed && frameMatches(*clip, i, 300, i * CLIP_FRAME_INTERVAL_MS);
+  }
+  clip->endRead();
+
+  // Once the clip expires the ring rolls again
+  uint32_t expiredMs = 1000 + CLIP_POST_MS + CLIP_KEEP_MS + 2;
+  clip->service(expiredMs);
+  passed = passed && clip->getState() == ClipState::IDLE && storeFrame(*clip, 300, expiredMs);
+  passed = passed && clip->getStats().evicted == 1;
+
+  delete clip;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// A second event while recording makes one longer clip
+bool testTriggerExtendsRecording() {
+  Serial.println("📊 Test 3: Trigger during RECORDING extends the post window");
+
+  // Enough history first that the frame index has wrapped
+  const uint32_t firstMs = (CLIP_MAX_FRAMES + 20) * CLIP_FRAME_INTERVAL_MS;
+  const uint32_t secondMs = firstMs + 3000;
+  ClipBuffer* clip = new ClipBuffer();
+  bool passed = clip->begin(64 * 1024);
+  for (uint32_t nowMs = 0; nowMs <= secondMs + 2 * CLIP_POST_MS && passed; nowMs += CLIP_FRAME_INTERVAL_MS) {
+    if (nowMs == firstMs) {
+      passed = clip->trigger(nowMs);
+    } else if (nowMs == secondMs) {
+      passed = clip->trigger(nowMs) && clip->getPostEndMs() == secondMs + CLIP_POST_MS &&
+               clip->getEventMs() == firstMs;
+    }
+    passed = passed && storeFrame(*clip, 100, nowMs);
+    clip->service(nowMs);
+    if (nowMs <= secondMs + CLIP_POST_MS) {
+      passed = passed && (clip->getState() == ClipState::RECORDING) == (nowMs >= firstMs);
+    }
+  }
+  passed = passed && clip->getState() == ClipState::READY && clip->getStats().triggers == 2;
+
+  // From CLIP_PRE_MS before the first event to CLIP_POST_MS after the second
+  uint16_t expected = (secondMs + CLIP_POST_MS - (firstMs - CLIP_PRE_MS)) / CLIP_FRAME_INTERVAL_MS + 1;
+  passed = passed && clip->beginRead() && clip->getClipFrameCount() == expected;
+  passed = passed && frameMatches(*clip, 0, 100, firstMs - CLIP_PRE_MS);
+  passed = passed && frameMatches(*clip, expected - 1, 100, secondMs + CLIP_POST_MS);
+  const uint8_t* data;
+  size_t length;
+  uint32_t capturedMs;
+  passed = passed && !clip->readFrame(expected, &data, &length, &capturedMs);
+  clip->endRead();
+  Serial.printf("   Clip of %u frames\n", clip->getClipFrameCount());
+
+  delete clip;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// A clip being downloaded is neither replaced nor expired
+bool testTriggerRefusedWhileReading() {
+  Serial.println("📊 Test 4: Trigger refused while a reader holds the clip");
+
+  ClipBuffer* clip = new ClipBuffer();
+  bool passed = clip->begin(TEST_RING_BYTES) && storeFrame(*clip, 100, 0);
+  passed = passed && clip->trigger(0) && !clip->beginRead();
+  clip->service(CLIP_POST_MS + 1);
+  passed = passed && clip->beginRead();
+
+  uint32_t lateMs = CLIP_POST_MS + CLIP_KEEP_MS + 2;
+  clip->service(lateMs);
+  passed = passed && clip->getState() == ClipState::READY;
+  passed = passed && !clip->trigger(lateMs) && clip->getStats().rejectedTriggers == 1;
+  passed = passed && frameMatches(*clip, 0, 100, 0);
+
+  clip->endRead();
+  passed = passed && clip->trigger(lateMs) && clip->getState() == ClipState::RECORDING &&
+           clip->getStats().triggers == 2 && clip->getStats().served == 1;
+
+  delete clip;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// Clip indexes stay right after older frames leave the ring, and an
+// evicted frame is never handed out
+bool testReadAfterEviction() {
+  Serial.println("📊 Test 5: readFrame() after frames were evicted");
+
+  ClipBuffer* clip = new ClipBuffer();
+  bool passed = clip->begin(TEST_RING_BYTES);
+  const uint32_t times[] = {0, 5000, 10000, 12000};
+  for (uint8_t i = 0; i < 4; i++) {
+    passed = passed && storeFrame(*clip, 200, times[i]);
+  }
+
+  // The clip starts at 5000; the frame at 0 is evicted for the wrapped
+  // post-event frame, the next one would overwrite the clip and is dropped
+  passed = passed && clip->trigger(14000);
+  passed = passed && storeFrame(*clip, 200, 14500) && storeFrame(*clip, 200, 15000);
+  passed = passed && !storeFrame(*clip, 200, 15500);
+  ClipStats stats = clip->getStats();
+  passed = passed && stats.evicted == 1 && stats.dropped == 1;
+
+  clip->service(14000 + CLIP_POST_MS + 1);
+  passed = passed && clip->beginRead() && clip->getClipFrameCount() == 5;
+  passed = passed && frameMatches(*clip, 0, 200, 5000) && frameMatches(*clip, 3, 200, 14500) &&
+           frameMatches(*clip, 4, 200, 15000);
+  clip->endRead();
+
+  // After expiry the clip's frames roll out and reads of them fail
+  uint32_t nowMs = 14000 + CLIP_POST_MS + CLIP_KEEP_MS + 2;
+  clip->service(nowMs);
+  for (uint8_t i = 0; i < 5; i++) {
+    passed = passed && storeFrame(*clip, 200, nowMs += CLIP_FRAME_INTERVAL_MS);
+  }
+  const uint8_t* data;
+  size_t length;
+  uint32_t capturedMs;
+  passed = passed && clip->getState() == ClipState::IDLE &&
+           !clip->readFrame(0, &data, &length, &capturedMs);
+
+  delete clip;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+} // namespace
+
+bool runClipBufferTests() {
+  Serial.println("\n🧪 Running Clip Buffer Unit Tests...\n");
+
+  ClipBuffer probe;
+  if (!probe.begin(TEST_RING_BYTES)) {
+    Serial.println("⚠️ No PSRAM, clip buffer tests skipped\n");
+    return true;
+  }
+
+  bool passed = true;
+  passed &= testWrapAround();
+  passed &= testPinnedClipBlocksEviction();
+  passed &= testTriggerExtendsRecording();
+  passed &= testTriggerRefusedWhileReading();
+  passed &= testReadAfterEviction();
+
+  Serial.printf("\n%s Clip Buffer Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+  return passed;
+}
@@ -52,8 +52,12 @@ struct CameraBeaconMetadata {
   uint8_t cameraStatus;     // Camera status: 0=off, 1=ready, 2=streaming
   uint8_t streamClients;    // Number of active stream clients
   uint16_t uptime;          // Uptime in minutes
+  uint8_t flags;            // CAM_FLAG_* (newer firmware only, check the length)
 } __attribute__((packed));
 
+#define CAM_FLAG_MOTION         0x01  // Motion within the last few seconds
+#define CAM_FLAG_COLLAR_NEARBY  0x02  // A BLE central connected recently
+
 // Helper function to get camera status string
 String getCameraStatusString(uint8_t status) {
   switch(status) {
@@ -112,7 +116,7 @@ private:
           }
         }
         
-        if (serviceDataStr.length() >= sizeof(CameraBeaconMetadata)) {
+        if (serviceDataStr.length() >= offsetof(CameraBeaconMetadata, flags)) {
           hasMetadata = true;
           
           // Convert String to byte array
@@ -121,8 +125,9 @@ private:
           }
           
           // Decode camera beacon metadata
-          if (serviceDataStr.length() >= sizeof(CameraBeaconMetadata)) {
+          if (serviceDataStr.length() >= offsetof(CameraBeaconMetadata, flags)) {
             CameraBeaconMetadata* camData = (CameraBeaconMetadata*)serviceDataStr.c_str();
+            uint8_t flags = serviceDataStr.length() >= sizeof(CameraBeaconMetadata) ? camData->flags : 0;
             
             if (camData->version == 3) { // Camera beacon version
               isCameraBeacon = true;
@@ -143,6 +148,7 @@ private:
               Serial.printf("📹 Camera Beacon: %s\n", devName.c_str());
               Serial.printf("   Status: %s\n", getCameraStatusString(cameraStatus).c_str());
               Serial.printf("   Clients: %d\n", streamClients);
+              Serial.printf("   Motion: %s\n", (flags & CAM_FLAG_MOTION) ? "yes" : "no");
               Serial.printf("   Type: %s\n", beaconType.c_str());
             }
           }
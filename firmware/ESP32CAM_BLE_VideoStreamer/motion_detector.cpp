@@ -0,0 +1,332 @@
+/*
+ * Motion Detector
+ * Grid-averaged grayscale differencing
+ */
+
+#include "MotionDetector.h"
+
+MotionDetector::MotionDetector()
+  : m_width(0),
+    m_height(0),
+    m_inFrame(false),
+    m_lastFrameMotion(false),
+    m_lastMotionMs(0) {
+  memset(&m_stats, 0, sizeof(m_stats));
+  memset(m_background, 0, sizeof(m_background));
+  reset();
+}
+
+void MotionDetector::reset() {
+  m_settleFrames = MOTION_SETTLE_FRAMES;
+  m_inFrame = false;
+}
+
+bool MotionDetector::beginFrame(uint16_t width, uint16_t height) {
+  if (width == 0 || height == 0 || width > MOTION_MAX_WIDTH) {
+    m_inFrame = false;
+    m_stats.rejected++;
+    return false;
+  }
+  if (width != m_width || height != m_height) {
+    m_width = width;
+    m_height = height;
+    for (uint16_t x = 0; x < width; x++) {
+      m_colCell[x] = (uint32_t)x * MOTION_GRID_W / width;
+    }
+    reset();
+  }
+  memset(m_sum, 0, sizeof(m_sum));
+  memset(m_count, 0, sizeof(m_count));
+  m_inFrame = true;
+  return true;
+}
+
+void MotionDetector::addRgbBlock(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t* rgb) {
+  if (!m_inFrame || x >= m_width || y >= m_height) {
+    return;
+  }
+  uint16_t cols = min((uint16_t)(m_width - x), w);
+  uint16_t rows = min((uint16_t)(m_height - y), h);
+  for (uint16_t row = 0; row < rows; row++) {
+    const uint8_t* px = rgb + (uint32_t)row * w * 3;
+    uint32_t* sums = m_sum + rowCell(y + row) * MOTION_GRID_W;
+    uint16_t* counts = m_count + rowCell(y + row) * MOTION_GRID_W;
+    const uint8_t* cells = m_colCell + x;
+    for (uint16_t col = 0; col < cols; col++, px += 3) {
+      // Symmetric in R and B, so decoder channel order does not matter
+      uint8_t cell = cells[col];
+      sums[cell] += (px[0] + 2 * px[1] + px[2]) >> 2;
+      counts[cell]++;
+    }
+  }
+}
+
+void MotionDetector::addGrayRow(uint16_t y, const uint8_t* gray) {
+  if (!m_inFrame || y >= m_height) {
+    return;
+  }
+  uint32_t* sums = m_sum + rowCell(y) * MOTION_GRID_W;
+  uint16_t* counts = m_count + rowCell(y) * MOTION_GRID_W;
+  for (uint16_t x = 0; x < m_width; x++) {
+    uint8_t cell = m_colCell[x];
+    sums[cell] += gray[x];
+    counts[cell]++;
+  }
+}
+
+bool MotionDetector::endFrame(uint32_t nowMs, uint32_t checkUs) {
+  if (!m_inFrame) {
+    m_stats.rejected++;
+    return false;
+  }
+  m_inFrame = false;
+
+  bool seeding = m_settleFrames > 0;
+  uint16_t changed = 0;
+  uint16_t cells = 0;
+  for (uint16_t i = 0; i < MOTION_GRID_H * MOTION_GRID_W; i++) {
+    if (m_count[i] == 0) {
+      continue;
+    }
+    cells++;
+    uint16_t mean = m_sum[i] / m_count[i];
+    if (seeding) {
+      m_background[i] = mean << 8;
+      continue;
+    }
+    int16_t diff = (int16_t)mean - (int16_t)(m_background[i] >> 8);
+    if (diff > MOTION_CELL_THRESHOLD || diff < -MOTION_CELL_THRESHOLD) {
+      changed++;
+    }
+    int32_t target = (int32_t)mean << 8;
+    m_background[i] = (uint16_t)((int32_t)m_background[i] + ((target - (int32_t)m_background[i]) >> MOTION_BG_SHIFT));
+  }
+
+  m_stats.lastCheckUs = checkUs;
+  if (seeding) {
+    m_settleFrames--;
+    return false;
+  }
+
+  m_stats.frames++;
+  m_stats.lastChangedCells = changed;
+  bool motion = cells > 0 && (uint32_t)changed * 100 > (uint32_t)cells * MOTION_AREA_PCT;
+  if (motion) {
+    m_stats.motionFrames++;
+    if (!m_lastFrameMotion && !isMotion(nowMs)) {
+      m_stats.events++;
+    }
+    m_lastMotionMs = nowMs ? nowMs : 1;
+  }
+  m_lastFrameMotion = motion;
+  return motion;
+}
+
+// ---- Self-tests ----
+
+namespace {
+
+const uint16_t TEST_WIDTH = 64;     // 2x2 pixels per cell
+const uint16_t TEST_HEIGHT = 48;
+const uint16_t TEST_CELLS = MOTION_GRID_W * MOTION_GRID_H;
+
+// Feed a frame in 8x8 RGB blocks, as the JPEG decoder does, with every
+// pixel at its cell's gray level; returns endFrame()
+bool feedFrame(MotionDetector& detector, uint16_t width, uint16_t height,
+               const uint8_t* cellGray, uint32_t nowMs) {
+  uint8_t block[8 * 8 * 3];
+  if (!detector.beginFrame(width, height)) {
+    return false;
+  }
+  for (uint16_t by = 0; by < height; by += 8) {
+    for (uint16_t bx = 0; bx < width; bx += 8) {
+      uint8_t* px = block;
+      for (uint16_t y = by; y < by + 8; y++) {
+        for (uint16_t x = bx; x < bx + 8; x++, px += 3) {
+          uint8_t gray = 0;
+          if (x < width && y < height) {
+            gray = cellGray[(uint32_t)y * MOTION_GRID_H / height * MOTION_GRID_W +
+                            (uint32_t)x * MOTION_GRID_W / width];
+          }
+          px[0] = px[1] = px[2] = gray;
+        }
+      }
+      detector.addRgbBlock(bx, by, 8, 8, block);
+    }
+  }
+  return detector.endFrame(nowMs, 0);
+}
+
+// Seeded at gray 100, then one frame with a patch of cells moved by delta
+bool patchMotion(uint16_t changedCells, int16_t delta, uint16_t& seen) {
+  static uint8_t cells[TEST_CELLS];
+  MotionDetector* detector = new MotionDetector();
+  memset(cells, 100, sizeof(cells));
+  feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, 100);
+  feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, 200);
+
+  // A patch in the middle of the grid
+  memset(cells + TEST_CELLS / 3, 100 + delta, changedCells);
+  bool motion = feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, 300);
+  seen = detector->getStats().lastChangedCells;
+  delete detector;
+  return motion;
+}
+
+// Settle frames only seed the background, whatever they show
+bool testSettleFrames() {
+  Serial.println("📊 Test 1: Settle frames seed the background without motion");
+
+  static uint8_t cells[TEST_CELLS];
+  MotionDetector* detector = new MotionDetector();
+
+  memset(cells, 100, sizeof(cells));
+  bool passed = !feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, 100);
+
+  // The last settle frame is the background, even after a jump
+  memset(cells, 200, sizeof(cells));
+  for (uint8_t i = 1; i < MOTION_SETTLE_FRAMES; i++) {
+    passed = passed && !feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, 100 + i * 100);
+  }
+  passed = passed && detector->getStats().frames == 0;
+
+  passed = passed && !feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, 1000);
+  const MotionStats& stats = detector->getStats();
+  passed = passed && stats.frames == 1 && stats.lastChangedCells == 0 && stats.rejected == 0 &&
+           !detector->isMotion(1000);
+
+  delete detector;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// Motion needs more than MOTION_AREA_PCT of the cells past MOTION_CELL_THRESHOLD
+bool testAreaThreshold() {
+  Serial.println("📊 Test 2: Changed area and level thresholds");
+
+  uint16_t needed = TEST_CELLS * MOTION_AREA_PCT / 100 + 1;
+  uint16_t seen = 0;
+  bool passed = !patchMotion(needed - 1, MOTION_CELL_THRESHOLD + 1, seen) && seen == needed - 1;
+  passed = passed && !patchMotion(needed, MOTION_CELL_THRESHOLD, seen) && seen == 0;
+  passed = passed && patchMotion(needed, MOTION_CELL_THRESHOLD + 1, seen) && seen == needed;
+  passed = passed && patchMotion(needed, -(MOTION_CELL_THRESHOLD + 1), seen) && seen == needed;
+  Serial.printf("   %u of %u cells raise motion\n", needed, TEST_CELLS);
+
+  // Motion again within MOTION_HOLD_MS is the same event
+  static uint8_t still[TEST_CELLS];
+  static uint8_t moved[TEST_CELLS];
+  memset(still, 100, sizeof(still));
+  memset(moved, 100, sizeof(moved));
+  memset(moved + TEST_CELLS / 3, 140, needed);
+
+  MotionDetector* detector = new MotionDetector();
+  feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, still, 100);
+  feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, still, 200);
+  passed = passed && feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, moved, 1000);
+  passed = passed && !feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, still, 1500) && detector->isMotion(1500);
+  passed = passed && feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, moved, 2000);
+  passed = passed && !feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, still, 2500);
+  passed = passed && detector->getStats().events == 1;
+  passed = passed && !detector->isMotion(2000 + MOTION_HOLD_MS);
+  passed = passed && feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, moved, 2000 + MOTION_HOLD_MS);
+  passed = passed && detector->getStats().events == 2 && detector->getStats().motionFrames == 3;
+
+  delete detector;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// A lasting change is absorbed at the MOTION_BG_SHIFT rate; slow drift never trips
+bool testBackgroundConvergence() {
+  Serial.println("📊 Test 3: Background converges at the MOTION_BG_SHIFT rate");
+
+  static uint8_t cells[TEST_CELLS];
+  MotionDetector* detector = new MotionDetector();
+  uint32_t nowMs = 0;
+  memset(cells, 100, sizeof(cells));
+  for (uint8_t i = 0; i <= MOTION_SETTLE_FRAMES; i++) {
+    feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, nowMs += 100);
+  }
+
+  // Each frame closes 1/2^MOTION_BG_SHIFT of the remaining gap
+  float gap = 100;
+  uint16_t expected = 0;
+  while (gap > MOTION_CELL_THRESHOLD) {
+    expected++;
+    gap -= gap / (1 << MOTION_BG_SHIFT);
+  }
+
+  memset(cells, 200, sizeof(cells));
+  uint16_t motionFrames = 0;
+  bool settled = false;
+  bool passed = true;
+  for (uint8_t i = 0; i < 60; i++) {
+    bool motion = feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, nowMs += 100);
+    passed = passed && !(settled && motion);
+    if (motion) {
+      motionFrames++;
+    } else {
+      settled = true;
+    }
+  }
+  passed = passed && settled && motionFrames >= expected && motionFrames <= expected + 1;
+  Serial.printf("   Motion for %u frames after a step (expected %u)\n", motionFrames, expected);
+
+  // Lighting drifting a level per frame keeps the background just behind it
+  for (uint8_t level = 201; level < 255; level++) {
+    memset(cells, level, sizeof(cells));
+    passed = passed && !feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, nowMs += 100);
+  }
+
+  delete detector;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+// A new frame size re-seeds the background; bad frames are rejected
+bool testResolutionChange() {
+  Serial.println("📊 Test 4: Resolution change resets the model");
+
+  static uint8_t cells[TEST_CELLS];
+  MotionDetector* detector = new MotionDetector();
+  memset(cells, 100, sizeof(cells));
+  for (uint8_t i = 0; i <= MOTION_SETTLE_FRAMES; i++) {
+    feedFrame(*detector, TEST_WIDTH, TEST_HEIGHT, cells, 100 + i * 100);
+  }
+  bool passed = detector->getStats().frames == 1;
+
+  // Half size and twice as bright: seeded again, not compared
+  memset(cells, 200, sizeof(cells));
+  for (uint8_t i = 0; i <= MOTION_SETTLE_FRAMES; i++) {
+    passed = passed && !feedFrame(*detector, TEST_WIDTH / 2, TEST_HEIGHT / 2, cells, 1000 + i * 100);
+  }
+  passed = passed && detector->getStats().frames == 2 && detector->getStats().lastChangedCells == 0;
+
+  passed = passed && !detector->beginFrame(MOTION_MAX_WIDTH + 1, TEST_HEIGHT);
+  passed = passed && !detector->endFrame(2000, 0);
+  passed = passed && !detector->beginFrame(0, TEST_HEIGHT);
+  passed = passed && detector->getStats().rejected == 3;
+
+  // Rejected frames leave the model as it was
+  passed = passed && !feedFrame(*detector, TEST_WIDTH / 2, TEST_HEIGHT / 2, cells, 2100);
+  passed = passed && detector->getStats().frames == 3;
+
+  delete detector;
+  Serial.printf("   Result: %s\n", passed ? "PASSED ✓" : "FAILED ✗");
+  return passed;
+}
+
+} // namespace
+
+bool runMotionDetectorTests() {
+  Serial.println("\n🧪 Running Motion Detector Unit Tests...\n");
+
+  bool passed = true;
+  passed &= testSettleFrames();
+  passed &= testAreaThreshold();
+  passed &= testBackgroundConvergence();
+  passed &= testResolutionChange();
+
+  Serial.printf("\n%s Motion Detector Unit Tests Complete!\n\n", passed ? "✅" : "❌");
+  return passed;
+}
@@ -0,0 +1,124 @@
+/*
+ * Stream Rate Controller
+ * Send-time driven quality ladder and capture pacing
+ */
+
+#include "StreamRateController.h"
+
+static const StreamLevel DEFAULT_LEVEL = {0, 12};
+
+StreamRateController::StreamRateController()
+  : m_levels(&DEFAULT_LEVEL),
+    m_count(1),
+    m_level(0),
+    m_slowestUs(0),
+    m_fastestUs(0),
+    m_intervalMs(1000 / STREAM_MAX_FPS),
+    m_lastAdjustMs(0),
+    m_lastStepDownMs(0),
+    m_lastMotionMs(0),
+    m_keepalive(false) {
+  portMUX_INITIALIZE(&m_mux);
+  memset(m_sendUs, 0, sizeof(m_sendUs));
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void StreamRateController::begin(const StreamLevel* levels, uint8_t count, uint8_t startLevel) {
+  if (!levels || count == 0) {
+    return;
+  }
+  m_levels = levels;
+  m_count = count;
+  m_level = startLevel < count ? startLevel : count - 1;
+}
+
+void StreamRateController::recordSend(int8_t slot, uint32_t sendUs) {
+  if (slot < 0 || slot >= CAM_STREAM_MAX_CLIENTS) {
+    return;
+  }
+  portENTER_CRITICAL(&m_mux);
+  uint32_t& smoothed = m_sendUs[slot];
+  if (smoothed == 0) {
+    smoothed = sendUs ? sendUs : 1;
+  } else {
+    smoothed = (uint32_t)((int32_t)smoothed + ((int32_t)sendUs - (int32_t)smoothed) / 4);
+  }
+  portEXIT_CRITICAL(&m_mux);
+}
+
+void StreamRateController::removeClient(int8_t slot) {
+  if (slot < 0 || slot >= CAM_STREAM_MAX_CLIENTS) {
+    return;
+  }
+  portENTER_CRITICAL(&m_mux);
+  m_sendUs[slot] = 0;
+  portEXIT_CRITICAL(&m_mux);
+}
+
+void StreamRateController::reportMotion(uint32_t nowMs) {
+  portENTER_CRITICAL(&m_mux);
+  m_lastMotionMs = nowMs;
+  portEXIT_CRITICAL(&m_mux);
+}
+
+void StreamRateController::changeLevel(uint8_t level) {
+  m_level = level;
+  // Old send times describe the previous level
+  portENTER_CRITICAL(&m_mux);
+  memset(m_sendUs, 0, sizeof(m_sendUs));
+  portEXIT_CRITICAL(&m_mux);
+}
+
+bool StreamRateController::update(uint32_t nowMs) {
+  uint32_t slowest = 0;
+  uint32_t fastest = 0;
+  portENTER_CRITICAL(&m_mux);
+  for (uint8_t i = 0; i < CAM_STREAM_MAX_CLIENTS; i++) {
+    uint32_t sendUs = m_sendUs[i];
+    if (sendUs == 0) {
+      continue;
+    }
+    if (sendUs > slowest) {
+      slowest = sendUs;
+    }
+    if (fastest == 0 || sendUs < fastest) {
+      fastest = sendUs;
+    }
+  }
+  uint32_t lastMotionMs = m_lastMotionMs;
+  portEXIT_CRITICAL(&m_mux);
+  m_slowestUs = slowest;
+  m_fastestUs = fastest;
+
+  bool idle = nowMs - lastMotionMs > STREAM_IDLE_AFTER_MS;
+  if (idle && !m_keepalive) {
+    m_stats.keepaliveEntries++;
+  }
+  m_keepalive = idle;
+
+  if (m_keepalive) {
+    m_intervalMs = STREAM_KEEPALIVE_MS;
+  } else {
+    m_intervalMs = max((uint32_t)(1000 / STREAM_MAX_FPS), fastest / 1000);
+  }
+
+  if (slowest == 0 || nowMs - m_lastAdjustMs < STREAM_RATE_ADJUST_MS) {
+    return false;
+  }
+  m_lastAdjustMs = nowMs;
+
+  uint32_t targetUs = STREAM_TARGET_SEND_MS * 1000UL;
+  if (slowest > targetUs + targetUs / 4 && m_level + 1 < m_count) {
+    changeLevel(m_level + 1);
+    m_lastStepDownMs = nowMs;
+    m_stats.stepsDown++;
+    return true;
+  }
+  if (slowest < targetUs / 2 && m_level > 0 && !m_keepalive &&
+      nowMs - m_lastStepDownMs >= STREAM_UPGRADE_HOLD_MS) {
+    changeLevel(m_level - 1);
+    m_stats.stepsUp++;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file alert_engine_test.cpp
+ * @brief Host test of the alert pattern step sequencer against a fake clock
+ *
+ * Runs the firmware's PatternSequencer (the state machine behind
+ * AlertPatternEngine) with simulated time. One copy is advanced the way
+ * the esp_timer callback does it, on its own deadlines plus dispatch
+ * latency; another is advanced from a simulated loop() that stalls for a
+ * BLE scan and a blocking MQTT reconnect. Outputs are compared with the
+ * nominal pattern every 50 us.
+ *
+ * Build and run from firmware/tools:
+ *   g++ -std=c++17 -O2 -I../ESP32-S3_PetCollar alert_engine_test.cpp \
+ *       ../ESP32-S3_PetCollar/pattern_sequencer.cpp -o alert_engine_test
+ *   ./alert_engine_test
+ *
+ * Exits non-zero if any scenario fails.
+ */
+
+#include "include/PatternSequencer.h"
+
+#include <cstdio>
+
+// ==================== HELPERS ====================
+
+/**
+ * @brief Buzzer duty the pattern should be producing at a given time
+ */
+static uint8_t nominalDutyAt(const PatternStep* steps, uint8_t count, uint8_t repeats, int64_t tUs) {
+    int64_t cycleUs = (int64_t)PatternSequencer::cycleDurationMs(steps, count) * 1000;
+    int64_t pass = tUs / cycleUs;
+    if (repeats != ALERT_ENGINE_REPEAT_FOREVER && pass >= repeats) {
+        return 0;
+    }
+
+    int64_t offset = tUs % cycleUs;
+    for (uint8_t i = 0; i < count; i++) {
+        int64_t stepUs = (int64_t)steps[i].durationMs * 1000;
+        if (offset < stepUs) {
+            return steps[i].buzzerDuty;
+        }
+        offset -= stepUs;
+    }
+    return 0;
+}
+
+/**
+ * @brief Longest stretch an output spent away from the nominal pattern
+ */
+struct StepErrorMeter {
+    int64_t mismatchSince = -1;
+    int64_t maxErrorUs = 0;
+
+    void sample(int64_t now, int64_t tickUs, uint8_t actual, uint8_t nominal) {
+        if (actual == nominal) {
+            mismatchSince = -1;
+            return;
+        }
+        if (mismatchSince < 0) {
+            mismatchSince = now;
+        }
+        if (now - mismatchSince + tickUs > maxErrorUs) {
+            maxErrorUs = now - mismatchSince + tickUs;
+        }
+    }
+};
+
+static bool report(const char* name, bool passed) {
+    printf("   Result: %s\n\n", passed ? "PASSED" : "FAILED");
+    if (!passed) {
+        fprintf(stderr, "FAILED: %s\n", name);
+    }
+    return passed;
+}
+
+// ==================== SCENARIOS ====================
+
+/**
+ * @brief Late callbacks must not shift the step schedule
+ */
+static bool testLateCallbacks() {
+    printf("Test 1: Absolute deadlines with late timer callbacks\n");
+
+    const PatternStep steps[] = {
+        {100, 2000, 200, 0},
+        {50,  0,    0,   0},
+        {250, 3000, 255, 0}
+    };
+    const int64_t expected[] = {100000, 150000, 400000, 500000, 550000, 800000};
+    const uint32_t latencyUs[] = {0, 700, 2500, 50, 0, 900};
+
+    PatternSequencer sequencer;
+    PatternStep current;
+    sequencer.start(steps, 3, 2, 0);
+    int64_t deadline = sequencer.advance(0, current);
+    bool passed = current.buzzerDuty == 200;
+
+    for (int i = 0; i < 6 && passed; i++) {
+        if (deadline != expected[i]) {
+            printf("   Deadline %d: expected %lld us, got %lld us\n",
+                   i, (long long)expected[i], (long long)deadline);
+            passed = false;
+            break;
+        }
+        deadline = sequencer.advance(deadline + latencyUs[i], current);
+    }
+
+    passed = passed && deadline == -1 && !sequencer.isPlaying() && current.buzzerDuty == 0;
+    passed = passed && sequencer.getMaxLatenessUs() == 2500;
+    printf("   Max lateness %u us\n", sequencer.getMaxLatenessUs());
+    return report("late callbacks", passed);
+}
+
+/**
+ * @brief Timer-driven playback stays on schedule while loop() stalls
+ */
+static bool testLoopStalls() {
+    printf("Test 2: Step timing under simulated loop stalls\n");
+
+    const PatternStep steps[] = {
+        {125, 2000, 180, 180},
+        {125, 0,    0,   0}
+    };
+    const uint8_t repeats = 4;
+    const int64_t endUs = 1100000;
+    const int64_t tickUs = 50;
+    const int64_t timerDispatchUs = 150;    // esp_timer task wake-up latency
+
+    PatternSequencer timerSequencer;
+    PatternSequencer loopSequencer;
+    PatternStep timerOut, loopOut;
+    timerSequencer.start(steps, 2, repeats, 0);
+    loopSequencer.start(steps, 2, repeats, 0);
+    int64_t timerDeadline = timerSequencer.advance(0, timerOut);
+    loopSequencer.advance(0, loopOut);
+
+    int64_t nextLoopUs = 10000;
+    StepErrorMeter timerError, loopError;
+
+    for (int64_t now = 0; now <= endUs; now += tickUs) {
+        // The timer fires on its own schedule regardless of what loop() is doing
+        if (timerDeadline >= 0 && now >= timerDeadline + timerDispatchUs) {
+            timerDeadline = timerSequencer.advance(now, timerOut);
+        }
+
+        // loop() runs every 10 ms but stalls 300 ms for a BLE scan and
+        // 450 ms for a blocking MQTT reconnect
+        if (now >= nextLoopUs) {
+            loopSequencer.advance(now, loopOut);
+            if (nextLoopUs == 120000) {
+                nextLoopUs += 300000;
+            } else if (nextLoopUs == 500000) {
+                nextLoopUs += 450000;
+            } else {
+                nextLoopUs += 10000;
+            }
+        }
+
+        uint8_t nominal = nominalDutyAt(steps, 2, repeats, now);
+        timerError.sample(now, tickUs, timerOut.buzzerDuty, nominal);
+        loopError.sample(now, tickUs, loopOut.buzzerDuty, nominal);
+    }
+
+    printf("   Timer-driven max step error %lld us\n", (long long)timerError.maxErrorUs);
+    printf("   Loop-driven max step error  %lld us (for comparison)\n", (long long)loopError.maxErrorUs);
+
+    bool passed = timerError.maxErrorUs <= 1000 && loopError.maxErrorUs > 1000 &&
+                  !timerSequencer.isPlaying() && timerOut.buzzerDuty == 0;
+    return report("loop stalls", passed);
+}
+
+/**
+ * @brief A stall longer than several steps skips them without drifting
+ */
+static bool testStallSkipsSteps() {
+    printf("Test 3: One callback after a long stall catches up in place\n");
+
+    const PatternStep steps[] = {
+        {100, 2500, 255, 100},
+        {100, 0,    0,   0}
+    };
+
+    PatternSequencer sequencer;
+    PatternStep current;
+    sequencer.start(steps, 2, ALERT_ENGINE_REPEAT_FOREVER, 0);
+
+    // 5 ms into the 11th step: step 10 is the first step of a pass again
+    int64_t deadline = sequencer.advance(1005000, current);
+    bool passed = deadline == 1100000 && sequencer.getCurrentStep() == 0 &&
+                  current.buzzerDuty == 255 && sequencer.isPlaying();
+    passed = passed && sequencer.getMaxLatenessUs() == 905000;
+
+    deadline = sequencer.advance(1100000, current);
+    passed = passed && deadline == 1200000 && current.buzzerDuty == 0;
+
+    printf("   Next deadline %lld us, step %u\n", (long long)deadline, sequencer.getCurrentStep());
+    return report("stall catch-up", passed);
+}
+
+/**
+ * @brief Stopping mid-pattern ends it; invalid tables are refused
+ */
+static bool testStopAndValidation() {
+    printf("Test 4: Stop mid-pattern and table validation\n");
+
+    const PatternStep forever[] = {
+        {200, 2500, 255, 100},
+        {200, 0,    0,   0}
+    };
+    const PatternStep invalid[] = {
+        {100, 2000, 128, 0},
+        {0,   0,    0,   0}
+    };
+
+    PatternSequencer sequencer;
+    PatternStep current;
+    sequencer.start(forever, 2, ALERT_ENGINE_REPEAT_FOREVER, 0);
+    bool passed = sequencer.advance(5000000, current) > 5000000 && sequencer.isPlaying();
+
+    sequencer.stop();
+    passed = passed && !sequencer.isPlaying();
+    passed = passed && sequencer.advance(6000000, current) == -1 &&
+             current.buzzerDuty == 0 && current.vibrationDuty == 0;
+
+    passed = passed && PatternSequencer::isValid(forever, 2);
+    passed = passed && !PatternSequencer::isValid(invalid, 2);
+    passed = passed && !PatternSequencer::isValid(forever, 0);
+    passed = passed && !PatternSequencer::isValid(nullptr, 2);
+    passed = passed && !PatternSequencer::isValid(forever, ALERT_ENGINE_MAX_STEPS + 1);
+    return report("stop and validation", passed);
+}
+
+int main() {
+    printf("\nAlert Pattern Sequencer Tests\n\n");
+
+    bool passed = true;
+    passed &= testLateCallbacks();
+    passed &= testLoopStalls();
+    passed &= testStallSkipsSteps();
+    passed &= testStopAndValidation();
+
+    printf("%s\n", passed ? "All alert engine tests passed" : "Alert engine tests FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file config_store_test.cpp
+ * @brief Host test of the settings store's wear leveling and power-cut safety
+ *
+ * Runs the firmware's ConfigStore over RAM storage with NOR flash semantics.
+ * A fault-injecting wrapper cuts power at every byte of a save (and part way
+ * through erases); after each "reboot" the store must come back with either
+ * the previous or the new settings, never a mix and never nothing.
+ *
+ * Build and run from firmware/tools:
+ *   g++ -std=c++17 -O2 -I../ESP32-S3_PetCollar config_store_test.cpp \
+ *       ../ESP32-S3_PetCollar/config_store.cpp ../ESP32-S3_PetCollar/mqtt_outbox.cpp \
+ *       -o config_store_test
+ *   ./config_store_test
+ *
+ * Exits non-zero if any scenario fails.
+ */
+
+#include "include/ConfigStore.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define SECTOR_SIZE     4096
+#define SECTOR_COUNT    4
+#define PAYLOAD_SIZE    1700    // About the size of the collar's settings record
+
+// ==================== FAULTY STORAGE ====================
+
+/**
+ * @brief RAM flash that loses power after a byte budget is spent
+ */
+class FaultyStorage : public OutboxStorage {
+public:
+    std::vector<uint8_t> flash;
+    RamOutboxStorage ram;
+    long budget = -1;               ///< Bytes still written before the cut (-1 = no cut)
+    bool dead = false;
+    std::vector<uint32_t> erases;
+
+    FaultyStorage() :
+        flash(SECTOR_SIZE * SECTOR_COUNT, 0xFF),
+        ram(flash.data(), flash.size(), SECTOR_SIZE),
+        erases(SECTOR_COUNT, 0) {}
+
+    void reboot() {
+        budget = -1;
+        dead = false;
+    }
+
+    size_t size() const override { return ram.size(); }
+    size_t sectorSize() const override { return ram.sectorSize(); }
+    bool read(uint32_t offset, void* data, size_t length) override {
+        return ram.read(offset, data, length);
+    }
+
+    bool write(uint32_t offset, const void* data, size_t length) override {
+        if (dead) {
+            return false;
+        }
+        if (budget >= 0 && (long)length > budget) {
+            ram.write(offset, data, budget);     // Torn write
+            dead = true;
+            return false;
+        }
+        if (budget >= 0) {
+            budget -= length;
+        }
+        return ram.write(offset, data, length);
+    }
+
+    bool eraseSector(uint32_t offset) override {
+        if (dead) {
+            return false;
+        }
+        if (budget == 0) {
+            // Erase interrupted half way: the tail keeps old data
+            memset(flash.data() + offset, 0xFF, SECTOR_SIZE / 2);
+            dead = true;
+            return false;
+        }
+        erases[offset / SECTOR_SIZE]++;
+        return ram.eraseSector(offset);
+    }
+};
+
+// ==================== HELPERS ====================
+
+static void fillPayload(uint8_t* payload, uint32_t seed) {
+    for (uint32_t i = 0; i < PAYLOAD_SIZE; i++) {
+        payload[i] = (uint8_t)(seed * 31 + i * 7);
+    }
+}
+
+/**
+ * @brief Boot a fresh store on @p storage and return the generation seed it holds (0 = none/bad)
+ */
+static uint32_t bootAndIdentify(FaultyStorage& storage, const std::vector<uint32_t>& seeds) {
+    ConfigStore store;
+    if (!store.begin(&storage) || !store.hasRecord() || store.getLength() != PAYLOAD_SIZE) {
+        return 0;
+    }
+    uint8_t loaded[PAYLOAD_SIZE];
+    uint8_t expected[PAYLOAD_SIZE];
+    store.load(loaded, sizeof(loaded));
+    for (uint32_t seed : seeds) {
+        fillPayload(expected, seed);
+        if (memcmp(loaded, expected, PAYLOAD_SIZE) == 0) {
+            return seed;
+        }
+    }
+    return 0;
+}
+
+static bool report(const char* name, bool passed) {
+    printf("   Result: %s\n\n", passed ? "PASSED" : "FAILED");
+    if (!passed) {
+        fprintf(stderr, "FAILED: %s\n", name);
+    }
+    return passed;
+}
+
+// ==================== SCENARIOS ====================
+
+/**
+ * @brief Records survive a reboot with their version and length
+ */
+static bool scenarioRoundTrip() {
+    printf("📊 Scenario 1: Save, reboot, load\n");
+    FaultyStorage storage;
+    ConfigStore store;
+    bool passed = store.begin(&storage) && !store.hasRecord();
+
+    uint8_t payload[PAYLOAD_SIZE];
+    fillPayload(payload, 1);
+    passed = passed && store.save(payload, PAYLOAD_SIZE, 3);
+    fillPayload(payload, 2);
+    passed = passed && store.save(payload, PAYLOAD_SIZE, 3);
+
+    ConfigStore rebooted;
+    passed = passed && rebooted.begin(&storage) && rebooted.hasRecord() &&
+             rebooted.getVersion() == 3 && rebooted.getStats().generation == 2 &&
+             bootAndIdentify(storage, {1, 2}) == 2;
+
+    // Short reads for a smaller (older) schema
+    uint8_t head[16];
+    passed = passed && rebooted.load(head, sizeof(head)) == sizeof(head) &&
+             memcmp(head, payload, sizeof(head)) == 0;
+    printf("   Record: %u bytes + %u header, %u per %u-byte sector\n",
+           PAYLOAD_SIZE, CONFIG_STORE_HEADER_SIZE,
+           SECTOR_SIZE / ((PAYLOAD_SIZE + CONFIG_STORE_HEADER_SIZE + 3) & ~3u), SECTOR_SIZE);
+    return report("round trip", passed);
+}
+
+/**
+ * @brief Erases rotate evenly over every sector
+ */
+static bool scenarioWearLeveling() {
+    printf("📊 Scenario 2: Wear leveling over 2000 saves\n");
+    FaultyStorage storage;
+    ConfigStore store;
+    bool passed = store.begin(&storage);
+
+    uint8_t payload[PAYLOAD_SIZE];
+    for (uint32_t seed = 1; seed <= 2000 && passed; seed++) {
+        fillPayload(payload, seed);
+        passed = store.save(payload, PAYLOAD_SIZE, 1);
+        // Reboot now and then: the write position must be recovered
+        if (seed % 97 == 0) {
+            passed = passed && store.begin(&storage);
+        }
+    }
+
+    uint32_t minErases = storage.erases[0], maxErases = storage.erases[0];
+    for (uint32_t erases : storage.erases) {
+        minErases = erases < minErases ? erases : minErases;
+        maxErases = erases > maxErases ? erases : maxErases;
+    }
+    printf("   Erases per sector: %u..%u\n", minErases, maxErases);
+    passed = passed && maxErases - minErases <= 1 && bootAndIdentify(storage, {2000}) == 2000;
+    return report("wear leveling", passed);
+}
+
+/**
+ * @brief Power cut at every byte of several saves, including sector switches
+ */
+static bool scenarioPowerCuts() {
+    printf("📊 Scenario 3: Power cut at every byte of a save\n");
+    bool passed = true;
+    uint32_t cuts = 0;
+    uint32_t recordBytes = PAYLOAD_SIZE + CONFIG_STORE_HEADER_SIZE;
+
+    // Saves 1..6 cover appends and the move into a fresh sector
+    for (uint32_t save = 1; save <= 6 && passed; save++) {
+        for (long cut = 0; cut <= (long)recordBytes && passed; cut++) {
+            FaultyStorage storage;
+            ConfigStore store;
+            store.begin(&storage);
+            uint8_t payload[PAYLOAD_SIZE];
+            for (uint32_t seed = 1; seed < save; seed++) {
+                fillPayload(payload, seed);
+                store.save(payload, PAYLOAD_SIZE, 1);
+            }
+
+            storage.budget = cut;
+            fillPayload(payload, save);
+            bool saved = store.save(payload, PAYLOAD_SIZE, 1);
+            storage.reboot();
+            cuts++;
+
+            uint32_t held = bootAndIdentify(storage, {save, save - 1});
+            // A completed save must be what boots; otherwise the previous one
+            passed = saved ? held == save : (held == save || held == save - 1 || (save == 1 && held == 0));
+
+            // The store keeps working after the cut
+            ConfigStore recovered;
+            recovered.begin(&storage);
+            fillPayload(payload, 99);
+            passed = passed && recovered.save(payload, PAYLOAD_SIZE, 1) &&
+                     bootAndIdentify(storage, {99}) == 99;
+            if (!passed) {
+                printf("   Failed at save %u, cut after %ld bytes\n", save, cut);
+            }
+        }
+    }
+    printf("   %u power cuts, settings always intact\n", cuts);
+    return report("power cuts", passed);
+}
+
+/**
+ * @brief A corrupted current record falls back to the one before it
+ */
+static bool scenarioBitRot() {
+    printf("📊 Scenario 4: Corrupted record falls back\n");
+    FaultyStorage storage;
+    ConfigStore store;
+    store.begin(&storage);
+    uint8_t payload[PAYLOAD_SIZE];
+    fillPayload(payload, 1);
+    store.save(payload, PAYLOAD_SIZE, 1);
+    fillPayload(payload, 2);
+    store.save(payload, PAYLOAD_SIZE, 1);
+
+    // Flip a bit in the middle of the second record's payload
+    uint32_t second = (PAYLOAD_SIZE + CONFIG_STORE_HEADER_SIZE + 3) & ~3u;
+    storage.flash[second + CONFIG_STORE_HEADER_SIZE + 100] ^= 0x01;
+
+    ConfigStore rebooted;
+    rebooted.begin(&storage);
+    bool passed = rebooted.getStats().corrupt == 1 && bootAndIdentify(storage, {1, 2}) == 1;
+
+    // The next save must not land on the damaged bytes
+    fillPayload(payload, 3);
+    passed = passed && rebooted.save(payload, PAYLOAD_SIZE, 1) && bootAndIdentify(storage, {3}) == 3;
+    return report("bit rot", passed);
+}
+
+int main() {
+    printf("\n🧪 Config Store Host Test\n\n");
+    bool passed = true;
+    passed &= scenarioRoundTrip();
+    passed &= scenarioWearLeveling();
+    passed &= scenarioPowerCuts();
+    passed &= scenarioBitRot();
+    printf("%s Config Store Host Test Complete!\n\n", passed ? "✅" : "❌");
+    return passed ? 0 : 1;
+}
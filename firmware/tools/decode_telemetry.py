@@ -0,0 +1,271 @@
+#!/usr/bin/env python3
+"""
+CBOR Telemetry Decoder for PetCollar MQTT payloads
+Turns integer-keyed CBOR messages back into the named JSON the firmware
+publishes in its default format.
+
+Field names come from the TELEMETRY_FIELDS table in
+ESP32-S3_PetCollar/include/TelemetryCodec.h, so the decoder follows the
+firmware schema without a second copy of it.
+
+Usage:
+    decode_telemetry.py payload.bin
+    decode_telemetry.py --hex "d9d9f7bf0001..."
+    mosquitto_sub -t 'pet-collar/+/telemetry' -C 1 | decode_telemetry.py
+    decode_telemetry.py --stream payloads.txt   (one hex payload per line)
+
+--stream rebuilds each device's full telemetry from keyframes (message 1)
+and deltas (message 5), the way a backend consumer has to.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+from pathlib import Path
+
+DEFAULT_HEADER = (Path(__file__).resolve().parent.parent /
+                  "ESP32-S3_PetCollar" / "include" / "TelemetryCodec.h")
+
+SELF_DESCRIBE_TAG = 55799
+MESSAGE_TELEMETRY = 1
+MESSAGE_TELEMETRY_DELTA = 5
+BREAK = object()
+
+
+def load_field_names(header_path):
+    """Read FIELD(NAME, id, "json") entries from the firmware header"""
+    content = Path(header_path).read_text(encoding="utf-8")
+    fields = {}
+    for match in re.finditer(r'FIELD\(\s*\w+\s*,\s*(\d+)\s*,\s*"([^"]+)"\s*\)', content):
+        fields[int(match.group(1))] = match.group(2)
+
+    version_match = re.search(r'#define\s+TELEMETRY_SCHEMA_VERSION\s+(\d+)', content)
+    version = int(version_match.group(1)) if version_match else None
+    return fields, version
+
+
+class CborDecoder:
+    """Decoder for the CBOR subset the firmware emits (RFC 8949)"""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def read(self, count):
+        if self.pos + count > len(self.data):
+            raise ValueError("truncated payload at byte %d" % self.pos)
+        chunk = self.data[self.pos:self.pos + count]
+        self.pos += count
+        return chunk
+
+    def read_argument(self, info):
+        if info < 24:
+            return info
+        if info == 24:
+            return self.read(1)[0]
+        if info == 25:
+            return struct.unpack(">H", self.read(2))[0]
+        if info == 26:
+            return struct.unpack(">I", self.read(4))[0]
+        if info == 27:
+            return struct.unpack(">Q", self.read(8))[0]
+        if info == 31:
+            return None
+        raise ValueError("reserved additional info %d" % info)
+
+    def decode(self):
+        initial = self.read(1)[0]
+        major = initial >> 5
+        info = initial & 0x1F
+
+        if major == 7:
+            return self.decode_simple(info)
+
+        arg = self.read_argument(info)
+
+        if major == 0:
+            return arg
+        if major == 1:
+            return -1 - arg
+        if major in (2, 3):
+            if arg is None:
+                raise ValueError("indefinite strings are not used by the firmware")
+            raw = self.read(arg)
+            return raw.hex() if major == 2 else raw.decode("utf-8")
+        if major == 4:
+            return self.decode_items(arg, lambda: self.decode())
+        if major == 5:
+            pairs = self.decode_items(arg, lambda: (self.decode(), self.decode()))
+            return dict(pairs)
+        if major == 6:
+            return ("tag", arg, self.decode())
+        raise ValueError("unknown major type %d" % major)
+
+    def decode_items(self, count, decode_item):
+        items = []
+        if count is None:
+            while self.data[self.pos] != 0xFF:
+                items.append(decode_item())
+            self.pos += 1
+        else:
+            for _ in range(count):
+                items.append(decode_item())
+        return items
+
+    def decode_simple(self, info):
+        if info == 20:
+            return False
+        if info == 21:
+            return True
+        if info in (22, 23):
+            return None
+        if info == 25:
+            return decode_half(struct.unpack(">H", self.read(2))[0])
+        if info == 26:
+            return struct.unpack(">f", self.read(4))[0]
+        if info == 27:
+            return struct.unpack(">d", self.read(8))[0]
+        if info == 31:
+            return BREAK
+        raise ValueError("unsupported simple value %d" % info)
+
+
+def decode_half(bits):
+    """Decode an IEEE 754 half-precision float"""
+    return struct.unpack(">e", struct.pack(">H", bits))[0]
+
+
+def name_fields(value, fields):
+    """Replace integer map keys with their schema names, recursively"""
+    if isinstance(value, dict):
+        return {fields.get(k, "field_%s" % k) if isinstance(k, int) else k:
+                name_fields(v, fields) for k, v in value.items()}
+    if isinstance(value, list):
+        return [name_fields(v, fields) for v in value]
+    if isinstance(value, float):
+        return round(value, 6)
+    return value
+
+
+def decode_payload(payload, fields, schema_version=None):
+    """Decode one MQTT payload (CBOR or plain JSON) into a dict"""
+    if payload[:1] in (b"{", b"["):
+        return json.loads(payload.decode("utf-8"))
+
+    item = CborDecoder(payload).decode()
+    if isinstance(item, tuple) and item[1] == SELF_DESCRIBE_TAG:
+        item = item[2]
+    if not isinstance(item, dict):
+        raise ValueError("payload is not a telemetry map")
+
+    message_schema = item.get(0)
+    if schema_version is not None and message_schema is not None and message_schema > schema_version:
+        print("Warning: payload schema %d is newer than header schema %d"
+              % (message_schema, schema_version), file=sys.stderr)
+
+    return name_fields(item, fields)
+
+
+def merge_delta(state, delta):
+    """Apply a delta map onto state; null values remove the field"""
+    for key, value in delta.items():
+        if value is None:
+            state.pop(key, None)
+        elif isinstance(value, dict) and isinstance(state.get(key), dict):
+            merge_delta(state[key], value)
+        else:
+            state[key] = value
+    return state
+
+
+class TelemetryState:
+    """Reconstructs full telemetry per device from keyframes and deltas"""
+
+    def __init__(self):
+        self.devices = {}
+
+    def apply(self, message):
+        """Apply one decoded message; returns the device state or None if out of sync"""
+        device_id = message.get("device_id")
+        message_type = message.get("message")
+        sequence = message.get("sequence")
+
+        if message_type == MESSAGE_TELEMETRY:
+            self.devices[device_id] = {"sequence": sequence, "state": json.loads(json.dumps(message))}
+            return self.devices[device_id]["state"]
+
+        if message_type != MESSAGE_TELEMETRY_DELTA:
+            return message
+
+        device = self.devices.get(device_id)
+        if device is None or device["sequence"] is None or sequence != device["sequence"] + 1:
+            # Missed a message: drop state until the next keyframe
+            print("Warning: sequence gap for device %s at %s, waiting for keyframe"
+                  % (device_id, sequence), file=sys.stderr)
+            self.devices.pop(device_id, None)
+            return None
+
+        device["sequence"] = sequence
+        merge_delta(device["state"], message)
+        device["state"]["message"] = MESSAGE_TELEMETRY
+        return device["state"]
+
+
+def decode_stream(lines, fields, schema_version):
+    """Decode newline-separated hex payloads, printing reconstructed state"""
+    state = TelemetryState()
+    for line in lines:
+        line = line.strip()
+        if not line:
+            continue
+        payload = bytes.fromhex(line)
+        message = decode_payload(payload, fields, schema_version)
+        result = state.apply(message)
+        if result is not None:
+            print("# %d bytes, message %s, sequence %s"
+                  % (len(payload), message.get("message"), message.get("sequence")))
+            print(json.dumps(result, indent=2))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode PetCollar CBOR telemetry to JSON")
+    parser.add_argument("file", nargs="?", help="Binary payload file (default: stdin)")
+    parser.add_argument("--hex", help="Payload as a hex string")
+    parser.add_argument("--stream", action="store_true",
+                        help="Input is one hex payload per line; rebuild state from deltas")
+    parser.add_argument("--header", default=str(DEFAULT_HEADER),
+                        help="Path to TelemetryCodec.h")
+    args = parser.parse_args()
+
+    fields, schema_version = load_field_names(args.header)
+
+    if args.stream:
+        source = open(args.file, encoding="utf-8") if args.file else sys.stdin
+        try:
+            return decode_stream(source, fields, schema_version)
+        except ValueError as e:
+            print("Error: %s" % e, file=sys.stderr)
+            return 1
+
+    if args.hex:
+        payload = bytes.fromhex(re.sub(r"\s+", "", args.hex))
+    elif args.file:
+        payload = Path(args.file).read_bytes()
+    else:
+        payload = sys.stdin.buffer.read()
+
+    try:
+        decoded = decode_payload(payload, fields, schema_version)
+    except ValueError as e:
+        print("Error: %s" % e, file=sys.stderr)
+        return 1
+
+    print(json.dumps(decoded, indent=2))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
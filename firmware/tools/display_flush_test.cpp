@@ -0,0 +1,270 @@
+/**
+ * @file display_flush_test.cpp
+ * @brief Host test of the SSD1306 display flusher against a fake panel
+ *
+ * Runs the firmware's DisplayFlusher over FakeSsd1306, which decodes the
+ * SSD1306 command and data streams into its own GDDRAM. Each scenario
+ * draws into a render buffer, hands spans over as updateDisplay() does,
+ * and compares the panel's GDDRAM with what was drawn. The last scenario
+ * flushes from a second thread while the main thread keeps drawing, the
+ * way the flush task and loop() share the flusher on the collar.
+ *
+ * Build and run from firmware/tools:
+ *   g++ -std=c++17 -O2 -pthread -I../ESP32-S3_PetCollar display_flush_test.cpp \
+ *       ../ESP32-S3_PetCollar/display_flusher.cpp -o display_flush_test
+ *   ./display_flush_test
+ *
+ * Exits non-zero if any scenario fails.
+ */
+
+#include "include/DisplayFlusher.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#define PANEL_ADDRESS   0x3C
+#define PANEL_WIDTH     128
+#define PANEL_PAGES     4
+#define FRAME_BYTES     (PANEL_WIDTH * PANEL_PAGES)
+
+// ==================== HELPERS ====================
+
+/**
+ * @brief Whether the fake panel's GDDRAM holds this frame
+ */
+static bool panelMatches(const FakeSsd1306& panel, const uint8_t* frame) {
+    for (uint8_t page = 0; page < PANEL_PAGES; page++) {
+        if (memcmp(panel.getGddram() + page * SSD1306_MAX_WIDTH, frame + page * PANEL_WIDTH,
+                   PANEL_WIDTH) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fillPattern(uint8_t* frame, uint8_t seed) {
+    for (uint16_t i = 0; i < FRAME_BYTES; i++) {
+        frame[i] = (uint8_t)(i * 37 + seed);
+    }
+}
+
+static uint32_t fakeClockUs = 0;
+
+static uint32_t fakeClock() {
+    fakeClockUs += 250;     // Every reading is a quarter millisecond later
+    return fakeClockUs;
+}
+
+static bool report(const char* name, bool passed) {
+    printf("   Result: %s\n\n", passed ? "PASSED" : "FAILED");
+    if (!passed) {
+        fprintf(stderr, "FAILED: %s\n", name);
+    }
+    return passed;
+}
+
+// ==================== SCENARIOS ====================
+
+/**
+ * @brief A full frame, then one glyph's span, end up in GDDRAM
+ */
+static bool testFlushToPanel() {
+    printf("Test 1: Frame and span flushes reach GDDRAM\n");
+
+    static uint8_t render[FRAME_BYTES];
+    static uint8_t front[FRAME_BYTES];
+    FakeSsd1306 panel(PANEL_ADDRESS);
+    DisplayFlusher flusher(panel, PANEL_ADDRESS, front, PANEL_WIDTH, PANEL_PAGES);
+    flusher.begin(render);
+    flusher.setClock(fakeClock);
+
+    fillPattern(render, 1);
+    DisplayDirtyPages pages = {};
+    pages.addAll(PANEL_PAGES, PANEL_WIDTH);
+    flusher.submit(pages);
+    bool passed = flusher.isBusy() && flusher.service() && !flusher.isBusy() &&
+                  panelMatches(panel, render);
+
+    // 128-byte pages go out as a window and two data writes each
+    passed = passed && panel.getWrites() == PANEL_PAGES * 3 && panel.getDataBytes() == FRAME_BYTES;
+
+    // One glyph on page 2: one window and 6 bytes
+    uint32_t writesBefore = panel.getWrites();
+    for (uint8_t column = 10; column < 16; column++) {
+        render[2 * PANEL_WIDTH + column] ^= 0xFF;
+    }
+    pages.clear();
+    pages.add(2, 10, 15);
+    flusher.submit(pages);
+    flusher.service();
+    DisplayFlushStats stats = flusher.getStats();
+    passed = passed && panelMatches(panel, render) && panel.getWrites() == writesBefore + 2 &&
+             stats.bytes == FRAME_BYTES + 6 && stats.flushes == 2 && stats.maxFlushUs == 250 &&
+             !flusher.service();
+
+    printf("   %u writes, %u bytes\n", panel.getWrites(), stats.bytes);
+    return report("flush to panel", passed);
+}
+
+/**
+ * @brief Drawing after a handover never changes what is in flight
+ */
+static bool testDoubleBuffering() {
+    printf("Test 2: Render while a flush is in flight\n");
+
+    static uint8_t render[FRAME_BYTES];
+    static uint8_t front[FRAME_BYTES];
+    FakeSsd1306 panel(PANEL_ADDRESS);
+    DisplayFlusher flusher(panel, PANEL_ADDRESS, front, PANEL_WIDTH, PANEL_PAGES);
+    flusher.begin(render);
+
+    memset(render, 0, sizeof(render));
+    render[0] = 0x11;
+    DisplayDirtyPages first = {};
+    first.add(0, 0, 5);
+    flusher.submit(first);
+
+    // The loop keeps drawing: the same span again and another page
+    render[0] = 0x22;
+    render[3 * PANEL_WIDTH + 100] = 0x33;
+    DisplayDirtyPages second = {};
+    second.add(0, 0, 5);
+    second.add(3, 100, 100);
+    flusher.submit(second);
+    bool passed = flusher.getStats().deferred == 1 && front[0] == 0x11 && front[3 * PANEL_WIDTH + 100] == 0;
+
+    // The in-flight snapshot goes out, then the deferred spans on the next submit
+    flusher.service();
+    passed = passed && panel.getGddram()[0] == 0x11 && panel.getGddram()[3 * SSD1306_MAX_WIDTH + 100] == 0;
+    DisplayDirtyPages none = {};
+    flusher.submit(none);
+    flusher.service();
+    passed = passed && panelMatches(panel, render) && !flusher.isBusy();
+
+    return report("double buffering", passed);
+}
+
+/**
+ * @brief Panel power, bus errors and the address scan
+ */
+static bool testPowerErrorsAndScan() {
+    printf("Test 3: Panel power, bus errors and I2C scan\n");
+
+    static uint8_t render[FRAME_BYTES];
+    static uint8_t front[FRAME_BYTES];
+    FakeSsd1306 panel(PANEL_ADDRESS);
+    DisplayFlusher flusher(panel, PANEL_ADDRESS, front, PANEL_WIDTH, PANEL_PAGES);
+    flusher.begin(render);
+
+    flusher.setPanelOn(false);
+    bool passed = flusher.isBusy() && flusher.service() && !panel.isOn();
+    flusher.setPanelOn(true);
+    passed = passed && flusher.service() && panel.isOn() && !flusher.service();
+
+    // A NACKed page is counted and dropped; the flusher is free again
+    fillPattern(render, 7);
+    DisplayDirtyPages pages = {};
+    pages.add(1, 0, 31);
+    panel.failNextWrites(1);
+    flusher.submit(pages);
+    flusher.service();
+    passed = passed && flusher.getStats().busErrors == 1 && !flusher.isBusy() && panel.getDataBytes() == 0;
+
+    uint8_t found[4];
+    uint8_t count = scanI2cAddresses(panel, found, sizeof(found));
+    passed = passed && count == 1 && found[0] == PANEL_ADDRESS;
+
+    return report("power, errors and scan", passed);
+}
+
+/**
+ * @brief A flush thread and a drawing thread leave the panel equal to the frame
+ */
+static bool testConcurrentFlushes() {
+    printf("Test 4: Flush thread racing a drawing loop\n");
+
+    static uint8_t render[FRAME_BYTES];
+    static uint8_t front[FRAME_BYTES];
+    FakeSsd1306 panel(PANEL_ADDRESS);
+    DisplayFlusher flusher(panel, PANEL_ADDRESS, front, PANEL_WIDTH, PANEL_PAGES);
+    flusher.begin(render);
+
+    // The flusher starts where display.begin() leaves the panel: on
+    const uint8_t displayOn[] = {SSD1306_CONTROL_COMMANDS, SSD1306_CMD_DISPLAY_ON};
+    panel.write(PANEL_ADDRESS, displayOn, sizeof(displayOn));
+
+    // Stands in for the FreeRTOS task and its notification
+    std::atomic<uint32_t> notifications(0);
+    std::atomic<bool> running(true);
+    flusher.setWakeHook([](void* context) {
+        static_cast<std::atomic<uint32_t>*>(context)->fetch_add(1);
+    }, &notifications);
+
+    std::thread task([&]() {
+        uint32_t seen = 0;
+        while (running.load()) {
+            uint32_t now = notifications.load();
+            if (now == seen) {
+                std::this_thread::yield();
+                continue;
+            }
+            seen = now;
+            flusher.service();
+        }
+    });
+
+    std::mt19937 rng(1234);
+    bool wasBlanked = false;
+    for (uint32_t frame = 0; frame < 20000; frame++) {
+        DisplayDirtyPages pages = {};
+        uint8_t glyphs = 1 + rng() % 4;
+        for (uint8_t g = 0; g < glyphs; g++) {
+            uint8_t page = rng() % PANEL_PAGES;
+            uint8_t x = (rng() % (PANEL_WIDTH / 6)) * 6;
+            for (uint8_t column = x; column < x + 6; column++) {
+                render[page * PANEL_WIDTH + column] = (uint8_t)rng();
+            }
+            pages.add(page, x, x + 5);
+        }
+        flusher.submit(pages);
+        if (frame % 1000 == 999) {
+            wasBlanked = !wasBlanked;
+            flusher.setPanelOn(!wasBlanked);
+        }
+    }
+
+    // Let the loop keep submitting (empty) until deferred spans are out
+    flusher.setPanelOn(true);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (flusher.isBusy() && std::chrono::steady_clock::now() < deadline) {
+        DisplayDirtyPages none = {};
+        flusher.submit(none);
+        std::this_thread::yield();
+    }
+    running.store(false);
+    task.join();
+
+    DisplayFlushStats stats = flusher.getStats();
+    bool passed = !flusher.isBusy() && panelMatches(panel, render) && panel.isOn() &&
+                  stats.busErrors == 0 && stats.flushes > 0;
+
+    printf("   %u flushes, %u deferred, %u bytes\n", stats.flushes, stats.deferred, stats.bytes);
+    return report("concurrent flushes", passed);
+}
+
+int main() {
+    printf("\nDisplay Flusher Fake Panel Tests\n\n");
+
+    bool passed = true;
+    passed &= testFlushToPanel();
+    passed &= testDoubleBuffering();
+    passed &= testPowerErrorsAndScan();
+    passed &= testConcurrentFlushes();
+
+    printf("%s\n", passed ? "All display flush tests passed" : "Display flush tests FAILED");
+    return passed ? 0 : 1;
+}
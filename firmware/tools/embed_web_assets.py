@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+Embed gzip-compressed web assets in the PetCollar firmware
+
+Compresses every file in ESP32-S3_PetCollar/web/ and writes
+ESP32-S3_PetCollar/include/WebAssets.h, which the HTTP server serves as-is
+with Content-Encoding: gzip. Compression happens once here instead of on
+the collar, and the ETag is a hash of the compressed bytes, so browsers
+revalidate for free until the asset changes.
+
+Re-run after editing anything in web/:
+    embed_web_assets.py
+    embed_web_assets.py --check     (exit 1 if WebAssets.h is out of date)
+"""
+
+import argparse
+import gzip
+import hashlib
+import sys
+from pathlib import Path
+
+SKETCH_DIR = Path(__file__).resolve().parent.parent / "ESP32-S3_PetCollar"
+WEB_DIR = SKETCH_DIR / "web"
+HEADER = SKETCH_DIR / "include" / "WebAssets.h"
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+}
+
+
+def url_path(path):
+    """web/index.html is served at "/", everything else at its file name."""
+    relative = path.relative_to(WEB_DIR).as_posix()
+    return "/" if relative == "index.html" else "/" + relative
+
+
+def symbol(path):
+    name = path.relative_to(WEB_DIR).as_posix().upper()
+    return "WEB_ASSET_" + "".join(c if c.isalnum() else "_" for c in name)
+
+
+def compress(data):
+    # mtime=0 keeps the output (and the ETag) reproducible
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def render(assets):
+    lines = [
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "/**",
+        " * @file WebAssets.h",
+        " * @brief Gzip-compressed static web assets",
+        " * @version 1.0.0",
+        " * @date 2024",
+        " *",
+        " * Generated by firmware/tools/embed_web_assets.py from ESP32-S3_PetCollar/web/.",
+        " * Do not edit by hand; edit the source file and re-run the script.",
+        " */",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "/**",
+        " * @brief One precompressed asset",
+        " */",
+        "struct WebAsset {",
+        "    const char* path;           ///< URL path",
+        "    const char* contentType;",
+        "    const uint8_t* data;        ///< gzip stream",
+        "    size_t length;",
+        "    size_t originalLength;      ///< Size before compression",
+        "    const char* etag;           ///< Quoted hash of the gzip stream",
+        "};",
+        "",
+    ]
+    for asset in assets:
+        lines.append(f"// {asset['source']}: {asset['original']} -> {len(asset['gz'])} bytes")
+        lines.append(f"static const uint8_t {asset['symbol']}[] PROGMEM = {{")
+        gz = asset["gz"]
+        for offset in range(0, len(gz), 16):
+            chunk = ", ".join(f"0x{b:02x}" for b in gz[offset:offset + 16])
+            lines.append(f"    {chunk},")
+        lines.append("};")
+        lines.append("")
+    lines.append("static const WebAsset WEB_ASSETS[] = {")
+    for asset in assets:
+        lines.append(f"    {{\"{asset['path']}\", \"{asset['type']}\", {asset['symbol']}, "
+                     f"sizeof({asset['symbol']}), {asset['original']}, \"\\\"{asset['etag']}\\\"\"}},")
+    lines.append("};")
+    lines.append("")
+    lines.append("static const size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);")
+    lines.append("")
+    lines.append("#endif // WEB_ASSETS_H")
+    return "\n".join(lines) + "\n"
+
+
+def collect():
+    assets = []
+    for path in sorted(WEB_DIR.rglob("*")):
+        if not path.is_file():
+            continue
+        content_type = CONTENT_TYPES.get(path.suffix.lower())
+        if content_type is None:
+            print(f"skipping {path.name}: unknown content type", file=sys.stderr)
+            continue
+        data = path.read_bytes()
+        gz = compress(data)
+        assets.append({
+            "source": path.relative_to(SKETCH_DIR).as_posix(),
+            "path": url_path(path),
+            "type": content_type,
+            "symbol": symbol(path),
+            "original": len(data),
+            "gz": gz,
+            "etag": hashlib.sha1(gz).hexdigest()[:12],
+        })
+    return assets
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--check", action="store_true",
+                        help="only verify that WebAssets.h matches web/")
+    args = parser.parse_args()
+
+    assets = collect()
+    if not assets:
+        sys.exit(f"no assets in {WEB_DIR}")
+    header = render(assets)
+
+    if args.check:
+        current = HEADER.read_text() if HEADER.exists() else ""
+        if current != header:
+            sys.exit(f"{HEADER.name} is out of date; run {Path(__file__).name}")
+        print(f"{HEADER.name} is up to date")
+        return
+
+    HEADER.write_text(header)
+    for asset in assets:
+        print(f"{asset['path']:<16} {asset['original']:>6} -> {len(asset['gz']):>6} bytes  "
+              f"({asset['type']})")
+    print(f"wrote {HEADER}")
+
+
+if __name__ == "__main__":
+    main()
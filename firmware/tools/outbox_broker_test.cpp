@@ -0,0 +1,350 @@
+/**
+ * @file outbox_broker_test.cpp
+ * @brief Host test of the MQTT store-and-forward outbox against a mock broker
+ *
+ * Runs the firmware's MqttOutbox over RAM storage with NOR flash semantics
+ * and a simulated clock. The mock broker connection goes offline and back,
+ * refuses publishes, and records everything subscribers would receive.
+ *
+ * Build and run from firmware/tools:
+ *   g++ -std=c++17 -O2 -I../ESP32-S3_PetCollar outbox_broker_test.cpp \
+ *       ../ESP32-S3_PetCollar/mqtt_outbox.cpp -o outbox_broker_test
+ *   ./outbox_broker_test
+ *
+ * Exits non-zero if any scenario fails.
+ */
+
+#include "include/MqttOutbox.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// ==================== MOCK BROKER ====================
+
+/**
+ * @brief Stands in for the broker connection and the subscribers behind it
+ */
+struct MockBroker {
+    bool online = true;
+    uint32_t refuseEvery = 0;       ///< Refuse every Nth publish (0 = never)
+    uint32_t refuseSequence = 0;    ///< Always refuse this record (0 = none)
+
+    std::vector<uint32_t> received;             ///< Sequence of every publish, with duplicates
+    std::map<uint32_t, std::string> delivered;  ///< Unique records by sequence
+    std::vector<uint32_t> publishTimes;
+    std::vector<uint32_t> attemptTimes;         ///< Every publish call, refused or not
+    std::vector<uint32_t> refusalTimes;
+
+    uint32_t nowMs = 0;
+
+    static bool publish(const char* topic, uint32_t sequence, const uint8_t* payload,
+                        size_t length, void* context) {
+        MockBroker* broker = static_cast<MockBroker*>(context);
+        if (!broker->online) {
+            return false;
+        }
+        broker->attemptTimes.push_back(broker->nowMs);
+        if ((broker->refuseEvery > 0 && broker->attemptTimes.size() % broker->refuseEvery == 0) ||
+            sequence == broker->refuseSequence) {
+            broker->refusalTimes.push_back(broker->nowMs);
+            return false;
+        }
+        broker->received.push_back(sequence);
+        broker->publishTimes.push_back(broker->nowMs);
+        broker->delivered[sequence] = std::string(topic) + ":" +
+                                      std::string(reinterpret_cast<const char*>(payload), length);
+        return true;
+    }
+};
+
+/**
+ * @brief Advance simulated time, draining the outbox like maintainMQTTConnection()
+ */
+static void run(MqttOutbox& outbox, MockBroker& broker, uint32_t durationMs, uint32_t stepMs = 50) {
+    uint32_t end = broker.nowMs + durationMs;
+    while (broker.nowMs < end) {
+        if (broker.online) {
+            outbox.drain(broker.nowMs);
+        }
+        broker.nowMs += stepMs;
+    }
+}
+
+static uint32_t appendAlerts(MqttOutbox& outbox, uint32_t count, uint32_t first) {
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        char payload[64];
+        int length = snprintf(payload, sizeof(payload), "{\"alert\":%u,\"beacon\":\"Kitchen\"}", first + i);
+        last = outbox.append(OutboxKind::ALERT, "alert", reinterpret_cast<uint8_t*>(payload), length);
+    }
+    return last;
+}
+
+static bool report(const char* name, bool passed) {
+    printf("   Result: %s\n\n", passed ? "PASSED" : "FAILED");
+    if (!passed) {
+        fprintf(stderr, "FAILED: %s\n", name);
+    }
+    return passed;
+}
+
+// ==================== SCENARIOS ====================
+
+static const size_t SECTOR_SIZE = 1024;
+
+/**
+ * @brief A backlog raised offline drains in order, in bounded, paced batches
+ */
+static bool testOutageDrain() {
+    printf("Test 1: 60 alerts during an outage drain after reconnect\n");
+
+    std::vector<uint8_t> memory(16 * SECTOR_SIZE, 0xFF);
+    RamOutboxStorage storage(memory.data(), memory.size(), SECTOR_SIZE);
+    MqttOutbox outbox;
+    MockBroker broker;
+    outbox.begin(&storage);
+    outbox.setPublisher(MockBroker::publish, &broker);
+
+    broker.online = false;
+    appendAlerts(outbox, 60, 0);
+    run(outbox, broker, 5000);
+    bool passed = broker.received.empty() && outbox.getPendingCount() == 60;
+
+    broker.online = true;
+    run(outbox, broker, 30000);
+
+    passed = passed && outbox.isEmpty() && broker.delivered.size() == 60;
+    passed = passed && broker.received.size() == 60;   // Each record published once
+    passed = passed && broker.delivered[1].compare(0, 6, "alert:") == 0;
+
+    // In order, starting from sequence 1
+    for (size_t i = 0; i < broker.received.size(); i++) {
+        passed = passed && broker.received[i] == i + 1;
+    }
+
+    // Pacing: never more than one batch in any one-second window beyond the burst
+    uint32_t maxInWindow = 0;
+    for (size_t i = 0; i < broker.publishTimes.size(); i++) {
+        uint32_t inWindow = 0;
+        for (size_t j = i; j < broker.publishTimes.size() &&
+                           broker.publishTimes[j] < broker.publishTimes[i] + 1000; j++) {
+            inWindow++;
+        }
+        if (inWindow > maxInWindow) maxInWindow = inWindow;
+    }
+    passed = passed && maxInWindow <= OUTBOX_BATCH_MAX_RECORDS + OUTBOX_DRAIN_RATE_PER_SEC;
+
+    uint32_t drainMs = broker.publishTimes.back() - broker.publishTimes.front();
+    printf("   Delivered %zu, max %u per second, drained in %u ms\n",
+           broker.delivered.size(), maxInWindow, drainMs);
+    return report("outage drain", passed);
+}
+
+/**
+ * @brief Refused publishes are retried in order and delivered exactly once
+ */
+static bool testRefusedPublishes() {
+    printf("Test 2: Refused publishes are retried without duplicates\n");
+
+    std::vector<uint8_t> memory(16 * SECTOR_SIZE, 0xFF);
+    RamOutboxStorage storage(memory.data(), memory.size(), SECTOR_SIZE);
+    MqttOutbox outbox;
+    MockBroker broker;
+    broker.refuseEvery = 3;
+    outbox.begin(&storage);
+    outbox.setPublisher(MockBroker::publish, &broker);
+
+    appendAlerts(outbox, 24, 0);
+    run(outbox, broker, 60000);
+
+    const OutboxStats& stats = outbox.getStats();
+    bool passed = outbox.isEmpty() && broker.received.size() == 24 && stats.failed > 0 &&
+                  stats.expired == 0 && stats.published == 24;
+    for (size_t i = 0; i < broker.received.size(); i++) {
+        passed = passed && broker.received[i] == i + 1;
+    }
+
+    // Nothing is published within OUTBOX_RETRY_MS of a refusal
+    for (uint32_t refusedMs : broker.refusalTimes) {
+        for (uint32_t attemptMs : broker.attemptTimes) {
+            passed = passed && (attemptMs <= refusedMs || attemptMs >= refusedMs + OUTBOX_RETRY_MS);
+        }
+    }
+    printf("   Publishes %zu for 24 records, %u refused\n", broker.received.size(), stats.failed);
+    return report("refused publishes", passed);
+}
+
+/**
+ * @brief A record the connection always refuses is expired, not retried forever
+ */
+static bool testStuckRecord() {
+    printf("Test 3: A record refused every time expires after OUTBOX_MAX_ATTEMPTS\n");
+
+    std::vector<uint8_t> memory(16 * SECTOR_SIZE, 0xFF);
+    RamOutboxStorage storage(memory.data(), memory.size(), SECTOR_SIZE);
+    MqttOutbox outbox;
+    MockBroker broker;
+    broker.refuseSequence = 3;
+    outbox.begin(&storage);
+    outbox.setPublisher(MockBroker::publish, &broker);
+
+    appendAlerts(outbox, 6, 0);
+
+    // Refusals spaced OUTBOX_RETRY_MS apart; a reconnect starts the count again
+    run(outbox, broker, (OUTBOX_MAX_ATTEMPTS - 1) * OUTBOX_RETRY_MS - 100);
+    outbox.onDisconnect();
+    bool passed = outbox.getPendingCount() == 4 && outbox.getStats().expired == 0;
+    uint32_t refusedBefore = outbox.getStats().failed;
+
+    run(outbox, broker, (OUTBOX_MAX_ATTEMPTS + 1) * OUTBOX_RETRY_MS);
+    const OutboxStats& stats = outbox.getStats();
+    passed = passed && refusedBefore == OUTBOX_MAX_ATTEMPTS - 1 &&
+             stats.failed == refusedBefore + OUTBOX_MAX_ATTEMPTS && stats.expired == 1 &&
+             outbox.isEmpty() && broker.delivered.size() == 5 && broker.delivered.count(3) == 0;
+
+    printf("   Refused %u times, expired %u, delivered %zu\n",
+           stats.failed, stats.expired, broker.delivered.size());
+    return report("stuck record", passed);
+}
+
+/**
+ * @brief Pending records and the sequence counter survive a reboot
+ */
+static bool testRebootRecovery() {
+    printf("Test 4: Unpublished records survive a reboot\n");
+
+    std::vector<uint8_t> memory(8 * SECTOR_SIZE, 0xFF);
+    RamOutboxStorage storage(memory.data(), memory.size(), SECTOR_SIZE);
+    MockBroker broker;
+    bool passed = true;
+
+    {
+        MqttOutbox outbox;
+        outbox.begin(&storage);
+        outbox.setPublisher(MockBroker::publish, &broker);
+        appendAlerts(outbox, 30, 0);
+
+        // One batch goes out, then the collar resets
+        outbox.drain(broker.nowMs);
+        passed = outbox.getPendingCount() == 30 - OUTBOX_BATCH_MAX_RECORDS;
+    }
+
+    MqttOutbox rebooted;
+    rebooted.begin(&storage);
+    rebooted.setPublisher(MockBroker::publish, &broker);
+    passed = passed && rebooted.getPendingCount() == 30 - OUTBOX_BATCH_MAX_RECORDS &&
+             rebooted.getNextSequence() == 31 && rebooted.getStats().recovered == 22;
+
+    uint32_t sequence = appendAlerts(rebooted, 1, 30);
+    passed = passed && sequence == 31;
+
+    run(rebooted, broker, 30000);
+    passed = passed && rebooted.isEmpty() && broker.delivered.size() == 31;
+
+    printf("   Recovered %u pending, next sequence %u\n",
+           rebooted.getStats().recovered, sequence);
+    return report("reboot recovery", passed);
+}
+
+/**
+ * @brief A full log evicts the oldest alerts and refuses telemetry early
+ */
+static bool testFullLog() {
+    printf("Test 5: Full log evicts oldest records and gates telemetry\n");
+
+    std::vector<uint8_t> memory(4 * SECTOR_SIZE, 0xFF);
+    RamOutboxStorage storage(memory.data(), memory.size(), SECTOR_SIZE);
+    MqttOutbox outbox;
+    MockBroker broker;
+    outbox.begin(&storage);
+    outbox.setPublisher(MockBroker::publish, &broker);
+
+    // Telemetry is refused once half the log is in use
+    uint8_t telemetry[200];
+    memset(telemetry, 'T', sizeof(telemetry));
+    uint32_t accepted = 0;
+    for (int i = 0; i < 40; i++) {
+        if (outbox.append(OutboxKind::TELEMETRY, "telemetry", telemetry, sizeof(telemetry))) {
+            accepted++;
+        }
+    }
+    bool passed = outbox.getStats().refused > 0 && outbox.getFillPercent() <= 75;
+
+    // Alerts keep coming and push out the oldest records
+    uint32_t last = appendAlerts(outbox, 200, 0);
+    const OutboxStats& stats = outbox.getStats();
+    passed = passed && stats.evicted > 0 && last == accepted + 200;
+
+    run(outbox, broker, 120000);
+    passed = passed && outbox.isEmpty() && broker.received.back() == last;
+
+    // What survived is the newest, contiguous run
+    uint32_t first = broker.received.front();
+    passed = passed && broker.delivered.size() == last - first + 1;
+
+    printf("   Telemetry accepted %u of 40, evicted %u, delivered %zu newest\n",
+           accepted, stats.evicted, broker.delivered.size());
+    return report("full log", passed);
+}
+
+/**
+ * @brief A record torn by a reset mid-write is ignored on recovery
+ */
+static bool testTornWrite() {
+    printf("Test 6: Torn write and corrupt record are skipped\n");
+
+    std::vector<uint8_t> memory(4 * SECTOR_SIZE, 0xFF);
+    RamOutboxStorage storage(memory.data(), memory.size(), SECTOR_SIZE);
+    MockBroker broker;
+
+    size_t tornOffset;
+    {
+        MqttOutbox outbox;
+        outbox.begin(&storage);
+        appendAlerts(outbox, 5, 0);
+
+        // Simulate a reset after the body of a sixth record was written
+        tornOffset = 8;
+        for (int i = 0; i < 5; i++) {
+            tornOffset += (12 + 5 + 30 + 3) & ~3;   // Same size as appendAlerts records
+        }
+        memset(memory.data() + tornOffset + 12, 0x42, 20);
+    }
+
+    // Flip a payload bit in record 2 (flash bit rot)
+    size_t secondRecord = 8 + ((12 + 5 + 30 + 3) & ~3);
+    memory[secondRecord + 12 + 8] ^= 0x01;
+
+    MqttOutbox outbox;
+    outbox.begin(&storage);
+    outbox.setPublisher(MockBroker::publish, &broker);
+    bool passed = outbox.getPendingCount() == 5;
+
+    // New records go to a fresh sector, not on top of the torn bytes
+    uint32_t sequence = appendAlerts(outbox, 1, 5);
+    run(outbox, broker, 30000);
+
+    passed = passed && sequence == 6 && outbox.isEmpty() && outbox.getStats().corrupt == 1 &&
+             broker.delivered.size() == 5 && broker.delivered.count(2) == 0;
+
+    printf("   Delivered %zu, corrupt %u\n", broker.delivered.size(), outbox.getStats().corrupt);
+    return report("torn write", passed);
+}
+
+int main() {
+    printf("\nMQTT Outbox Mock Broker Tests\n\n");
+
+    bool passed = true;
+    passed &= testOutageDrain();
+    passed &= testRefusedPublishes();
+    passed &= testStuckRecord();
+    passed &= testRebootRecovery();
+    passed &= testFullLog();
+    passed &= testTornWrite();
+
+    printf("%s\n", passed ? "All outbox tests passed" : "Outbox tests FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file render_alert_wavs.cpp
+ * @brief Render every collar alert waveform to a WAV file for review
+ *
+ * Uses the same waveform tables and renderer as the firmware, and repeats
+ * one prerendered cycle the way AlertAudioPlayer does, so what you hear is
+ * what the I2S PDM buzzer path plays.
+ *
+ * Build and run from firmware/tools:
+ *   g++ -std=c++17 -O2 -I../ESP32-S3_PetCollar render_alert_wavs.cpp \
+ *       ../ESP32-S3_PetCollar/alert_waveforms.cpp -o render_alert_wavs
+ *   ./render_alert_wavs [output-dir]
+ *
+ * The output directory is created if it does not exist. Each pattern is
+ * repeated to fill at least three seconds (one pass for patterns longer
+ * than that).
+ */
+
+#include "include/AlertWaveforms.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+static const uint32_t MIN_RENDER_MS = 3000;
+
+static void writeLE16(FILE* f, uint16_t v) {
+    fputc(v & 0xFF, f);
+    fputc(v >> 8, f);
+}
+
+static void writeLE32(FILE* f, uint32_t v) {
+    writeLE16(f, v & 0xFFFF);
+    writeLE16(f, v >> 16);
+}
+
+static bool writeWav(const std::string& path, const std::vector<int16_t>& samples) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+
+    uint32_t dataBytes = samples.size() * sizeof(int16_t);
+    fwrite("RIFF", 1, 4, f);
+    writeLE32(f, 36 + dataBytes);
+    fwrite("WAVE", 1, 4, f);
+
+    fwrite("fmt ", 1, 4, f);
+    writeLE32(f, 16);                               // PCM header size
+    writeLE16(f, 1);                                // PCM
+    writeLE16(f, 1);                                // Mono
+    writeLE32(f, WAVEFORM_SAMPLE_RATE_HZ);
+    writeLE32(f, WAVEFORM_SAMPLE_RATE_HZ * 2);      // Byte rate
+    writeLE16(f, 2);                                // Block align
+    writeLE16(f, 16);                               // Bits per sample
+
+    fwrite("data", 1, 4, f);
+    writeLE32(f, dataBytes);
+    for (int16_t s : samples) {
+        writeLE16(f, (uint16_t)s);
+    }
+
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    std::string outDir = argc > 1 ? argv[1] : ".";
+    int failures = 0;
+
+    std::error_code error;
+    std::filesystem::create_directories(outDir, error);
+    if (error) {
+        fprintf(stderr, "cannot create output directory %s: %s\n", outDir.c_str(), error.message().c_str());
+        return 1;
+    }
+
+    for (uint8_t id = 0; id < WAVEFORM_PATTERN_COUNT; id++) {
+        const WavePattern* pattern = getWavePattern(id);
+        uint32_t cycleMs = waveCycleDurationMs(pattern);
+        uint8_t repeats = (uint8_t)((MIN_RENDER_MS + cycleMs - 1) / cycleMs);
+
+        std::vector<int16_t> cycle(waveCycleSamples(pattern));
+        renderWaveCycle(pattern, 255, cycle.data(), cycle.size());
+
+        std::vector<int16_t> samples;
+        for (uint8_t pass = 0; pass < repeats; pass++) {
+            samples.insert(samples.end(), cycle.begin(), cycle.end());
+        }
+
+        std::string path = outDir + "/alert_" + pattern->name + ".wav";
+        if (writeWav(path, samples)) {
+            printf("%-40s %2u x %5u ms  %7zu samples\n", path.c_str(), repeats, cycleMs, samples.size());
+        } else {
+            fprintf(stderr, "failed to write %s\n", path.c_str());
+            failures++;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""
+Trace Converter for PetCollar binary event traces
+Turns the batches sent by the collar's trace command into Chrome trace
+JSON, viewable as a timeline in chrome://tracing or ui.perfetto.dev.
+
+Event names, phases and argument names come from the TRACE_EVENTS table
+in ESP32-S3_PetCollar/include/TraceBuffer.h, so the converter follows
+the firmware without a second copy of it.
+
+Usage:
+    trace_to_chrome.py serial.log -o trace.json      (lines "TRACE <hex>")
+    mosquitto_sub -t 'pet-collar/+/diagnostics/trace' -N > trace.bin
+    trace_to_chrome.py trace.bin -o trace.json       (concatenated batches)
+    trace_to_chrome.py --names Kitchen,Door serial.log
+
+Beacon arguments are FNV-1a hashes of the beacon name; --names maps them
+back. Records overwritten before they were read show as "trace_lost"
+markers on the timeline.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+from pathlib import Path
+
+DEFAULT_HEADER = (Path(__file__).resolve().parent.parent /
+                  "ESP32-S3_PetCollar" / "include" / "TraceBuffer.h")
+
+BATCH_HEADER = struct.Struct("<4sBBHII")
+RECORD = struct.Struct("<IHBBii")
+MAGIC = b"PCTR"
+SUPPORTED_VERSION = 1
+
+
+def load_events(header_path):
+    """Read EVENT(NAME, id, 'phase', "name", "arg0", "arg1") entries from the firmware header"""
+    content = Path(header_path).read_text(encoding="utf-8")
+    events = {}
+    pattern = r"EVENT\(\s*\w+\s*,\s*(\d+)\s*,\s*'(\w)'\s*,\s*\"([^\"]*)\"\s*,\s*\"([^\"]*)\"\s*,\s*\"([^\"]*)\"\s*\)"
+    for match in re.finditer(pattern, content):
+        events[int(match.group(1))] = {
+            "phase": match.group(2),
+            "name": match.group(3),
+            "args": [match.group(4), match.group(5)],
+        }
+    return events
+
+
+def name_hash(name):
+    """FNV-1a as traceNameHash() computes it, as a signed 32-bit value"""
+    value = 2166136261
+    for byte in name.encode("utf-8"):
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value - (1 << 32) if value >= (1 << 31) else value
+
+
+def read_batches(data):
+    """Yield (lost, records) for each batch in a byte string"""
+    pos = 0
+    while pos < len(data):
+        if len(data) - pos < BATCH_HEADER.size:
+            raise ValueError("truncated batch header at byte %d" % pos)
+        magic, version, record_size, count, lost, _now_us = BATCH_HEADER.unpack_from(data, pos)
+        if magic != MAGIC:
+            raise ValueError("bad batch magic at byte %d" % pos)
+        if version != SUPPORTED_VERSION or record_size != RECORD.size:
+            raise ValueError("unsupported trace version %d (record size %d)" % (version, record_size))
+        pos += BATCH_HEADER.size
+        end = pos + count * RECORD.size
+        if end > len(data):
+            raise ValueError("truncated batch at byte %d" % pos)
+        records = [RECORD.unpack_from(data, offset) for offset in range(pos, end, RECORD.size)]
+        pos = end
+        yield lost, records
+
+
+def read_input(raw):
+    """Binary batches as they came over MQTT/WebSocket, or a serial log"""
+    if raw.startswith(MAGIC):
+        return raw
+    text = raw.decode("utf-8", errors="replace")
+    return b"".join(bytes.fromhex(match.group(1))
+                    for match in re.finditer(r"TRACE ([0-9a-fA-F]+)", text))
+
+
+def convert(data, events, names):
+    """Build Chrome trace events; timestamps are unwrapped from 32-bit micros()"""
+    trace_events = []
+    cores = set()
+    last_raw = None
+    timestamp = 0
+
+    for lost, records in read_batches(data):
+        if lost:
+            trace_events.append({"name": "trace_lost", "ph": "i", "s": "g", "ts": timestamp,
+                                 "pid": 1, "tid": 0, "args": {"records": lost}})
+
+        for raw_us, event_id, core, _reserved, arg0, arg1 in records:
+            if last_raw is not None:
+                delta = (raw_us - last_raw) & 0xFFFFFFFF
+                timestamp += delta - (1 << 32) if delta >= (1 << 31) else delta
+            last_raw = raw_us
+            cores.add(core)
+
+            event = events.get(event_id, {"phase": "i", "name": "event_%d" % event_id,
+                                          "args": ["arg0", "arg1"]})
+            entry = {"name": event["name"], "cat": "collar", "ph": event["phase"],
+                     "ts": timestamp, "pid": 1, "tid": core}
+            if event["phase"] == "i":
+                entry["s"] = "t"
+
+            args = {}
+            for label, value in zip(event["args"], (arg0, arg1)):
+                if not label:
+                    continue
+                if label == "beacon":
+                    value = names.get(value, "%08x" % (value & 0xFFFFFFFF))
+                args[label] = value
+            if args:
+                entry["args"] = args
+            trace_events.append(entry)
+
+    for core in sorted(cores):
+        trace_events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": core,
+                             "args": {"name": "core %d" % core}})
+    trace_events.append({"name": "process_name", "ph": "M", "pid": 1,
+                         "args": {"name": "PetCollar"}})
+    return {"traceEvents": trace_events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert PetCollar traces to Chrome trace JSON")
+    parser.add_argument("files", nargs="*", help="Serial logs or binary batches (default: stdin)")
+    parser.add_argument("-o", "--output", help="Output file (default: stdout)")
+    parser.add_argument("--names", default="",
+                        help="Comma-separated beacon names to show instead of hashes")
+    parser.add_argument("--header", default=str(DEFAULT_HEADER),
+                        help="Path to TraceBuffer.h")
+    args = parser.parse_args()
+
+    events = load_events(args.header)
+    names = {name_hash(name): name for name in args.names.split(",") if name}
+
+    if args.files:
+        data = b"".join(read_input(Path(path).read_bytes()) for path in args.files)
+    else:
+        data = read_input(sys.stdin.buffer.read())
+
+    try:
+        trace = convert(data, events, names)
+    except ValueError as e:
+        print("Error: %s" % e, file=sys.stderr)
+        return 1
+
+    output = json.dumps(trace, indent=1)
+    if args.output:
+        Path(args.output).write_text(output, encoding="utf-8")
+        print("%d events written to %s" % (len(trace["traceEvents"]), args.output), file=sys.stderr)
+    else:
+        print(output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,385 @@
+/**
+ * @file wifi_roaming_test.cpp
+ * @brief Host test of the WiFi roaming engine against simulated RSSI curves
+ *
+ * Runs the firmware's WiFiRoamer with a simulated clock and access points
+ * whose RSSI follows a piecewise-linear curve plus noise, as the collar
+ * would see walking between mesh nodes. Each walk is also run with the
+ * old behaviour (stay on the AP until the link drops, notice it at the
+ * next maintenance check, reconnect with a full scan) and the outage
+ * times are compared.
+ *
+ * Build and run from firmware/tools:
+ *   g++ -std=c++17 -O2 -I../ESP32-S3_PetCollar wifi_roaming_test.cpp \
+ *       ../ESP32-S3_PetCollar/wifi_roamer.cpp -o wifi_roaming_test
+ *   ./wifi_roaming_test
+ *
+ * Exits non-zero if any scenario fails.
+ */
+
+#include "include/WiFiRoamer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// ==================== SIMULATED RADIO ====================
+
+static const uint32_t STEP_MS = 100;
+static const uint32_t LINK_SAMPLE_MS = 1000;        // WiFi.RSSI() poll in the loop
+static const int LINK_LOSS_RSSI = -88;              // Beacons lost below this
+static const int CONNECT_MIN_RSSI = -85;            // Association fails below this
+static const int SCAN_MIN_RSSI = -92;               // Weakest AP a scan reports
+static const uint32_t CHANNEL_SCAN_MS = 120;        // Passive dwell on one channel
+static const uint32_t FULL_SCAN_MS = 13 * CHANNEL_SCAN_MS;
+static const uint32_t TARGETED_CONNECT_MS = 400;    // Known BSSID and channel, DHCP
+static const uint32_t SCAN_CONNECT_MS = 4000;       // Full scan, then DHCP
+static const uint32_t MAINTENANCE_MS = 30000;       // Old loss detection period
+
+struct CurvePoint {
+    uint32_t ms;
+    int rssi;
+};
+
+/**
+ * @brief One mesh node: fixed BSSID and channel, RSSI along the walk
+ */
+struct SimAp {
+    uint8_t bssid[6];
+    uint8_t channel;
+    std::vector<CurvePoint> curve;
+    bool refuses = false;   ///< MAC filter or full client table
+
+    int rssiAt(uint32_t ms) const {
+        if (ms <= curve.front().ms) {
+            return curve.front().rssi;
+        }
+        for (size_t i = 1; i < curve.size(); i++) {
+            if (ms <= curve[i].ms) {
+                const CurvePoint& a = curve[i - 1];
+                const CurvePoint& b = curve[i];
+                return a.rssi + (int)((int64_t)(b.rssi - a.rssi) * (ms - a.ms) / (b.ms - a.ms));
+            }
+        }
+        return curve.back().rssi;
+    }
+};
+
+/**
+ * @brief Deterministic +-3 dB measurement noise
+ */
+struct Noise {
+    uint32_t state = 12345;
+    int next() {
+        state = state * 1103515245UL + 12345UL;
+        return (int)((state >> 16) % 7) - 3;
+    }
+};
+
+struct WalkResult {
+    uint32_t outageMs = 0;
+    uint32_t drops = 0;
+    RoamStats stats = {};
+};
+
+static SimAp makeAp(uint8_t id, uint8_t channel, std::vector<CurvePoint> curve) {
+    SimAp ap;
+    const uint8_t bssid[6] = {0x24, 0x0A, 0xC4, 0x00, 0x00, id};
+    memcpy(ap.bssid, bssid, 6);
+    ap.channel = channel;
+    ap.curve = curve;
+    return ap;
+}
+
+static int strongestAp(const std::vector<SimAp>& aps, uint32_t now) {
+    int best = -1;
+    for (size_t i = 0; i < aps.size(); i++) {
+        if (!aps[i].refuses && aps[i].rssiAt(now) >= CONNECT_MIN_RSSI &&
+            (best < 0 || aps[i].rssiAt(now) > aps[best].rssiAt(now))) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+static int findAp(const std::vector<SimAp>& aps, const uint8_t* bssid) {
+    for (size_t i = 0; i < aps.size(); i++) {
+        if (memcmp(aps[i].bssid, bssid, 6) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Walk with the roamer driving scans, roams and reconnects
+ */
+static WalkResult walkWithRoamer(const std::vector<SimAp>& aps, uint32_t durationMs) {
+    WiFiRoamer roamer;
+    Noise noise;
+    WalkResult result;
+
+    int current = strongestAp(aps, 0);
+    roamer.setConnected(aps[current].bssid, aps[current].channel, 0, aps[current].rssiAt(0), 0);
+
+    int connectingTo = -1;
+    uint32_t busyUntil = 0;             // Connect in progress
+    RoamScanRequest scan = {RoamScanType::NONE, 0};
+    uint32_t scanDoneAt = 0;
+    std::vector<const RoamCandidate*> tries;
+
+    for (uint32_t now = STEP_MS; now <= durationMs; now += STEP_MS) {
+        if (current < 0) {
+            result.outageMs += STEP_MS;
+        }
+
+        // Finish a connect
+        if (connectingTo >= 0) {
+            if (now < busyUntil) {
+                continue;
+            }
+            const SimAp& ap = aps[connectingTo];
+            if (!ap.refuses && ap.rssiAt(now) >= CONNECT_MIN_RSSI) {
+                current = connectingTo;
+                roamer.setConnected(ap.bssid, ap.channel, 0, ap.rssiAt(now) + noise.next(), now);
+            } else {
+                roamer.connectFailed(ap.bssid, now);
+            }
+            connectingTo = -1;
+        }
+
+        // Reconnect after a loss: ranked candidates first, then a full scan
+        if (current < 0) {
+            if (tries.empty()) {
+                const RoamCandidate* ranked[ROAM_MAX_CANDIDATES];
+                uint8_t count = roamer.rank(ranked, ROAM_MAX_CANDIDATES, now);
+                tries.assign(ranked, ranked + count);
+                roamer.reconnectStarted();
+                if (tries.empty()) {
+                    connectingTo = strongestAp(aps, now);
+                    busyUntil = now + SCAN_CONNECT_MS;
+                    continue;
+                }
+            }
+            connectingTo = findAp(aps, tries.front()->bssid);
+            tries.erase(tries.begin());
+            busyUntil = now + TARGETED_CONNECT_MS;
+            continue;
+        }
+        tries.clear();
+
+        // Link loss
+        if (aps[current].rssiAt(now) < LINK_LOSS_RSSI) {
+            current = -1;
+            result.drops++;
+            roamer.setDisconnected();
+            if (scan.type != RoamScanType::NONE) {
+                roamer.scanFinished();
+                scan.type = RoamScanType::NONE;
+            }
+            continue;
+        }
+        if (now % LINK_SAMPLE_MS == 0) {
+            roamer.reportLinkRssi((int8_t)(aps[current].rssiAt(now) + noise.next()));
+        }
+
+        // Background scans
+        if (scan.type == RoamScanType::NONE) {
+            scan = roamer.nextScan(now, true);
+            scanDoneAt = now + (scan.type == RoamScanType::FULL ? FULL_SCAN_MS : CHANNEL_SCAN_MS);
+        } else if (now >= scanDoneAt) {
+            for (const SimAp& ap : aps) {
+                int rssi = ap.rssiAt(now) + noise.next();
+                if (rssi >= SCAN_MIN_RSSI &&
+                    (scan.type == RoamScanType::FULL || ap.channel == scan.channel)) {
+                    roamer.reportScanResult(ap.bssid, ap.channel, 0, (int8_t)rssi, now);
+                }
+            }
+            roamer.scanFinished();
+            scan.type = RoamScanType::NONE;
+        }
+
+        // Proactive roam
+        const RoamCandidate* target = roamer.pickRoamTarget(now);
+        if (target) {
+            roamer.roamStarted(*target, now);
+            connectingTo = findAp(aps, target->bssid);
+            busyUntil = now + TARGETED_CONNECT_MS;
+            current = -1;
+            roamer.setDisconnected();
+        }
+    }
+    result.stats = roamer.getStats();
+    return result;
+}
+
+/**
+ * @brief Walk with the old behaviour: sticky AP, loss noticed by maintenance
+ */
+static WalkResult walkSticky(const std::vector<SimAp>& aps, uint32_t durationMs) {
+    WalkResult result;
+    int current = strongestAp(aps, 0);
+    uint32_t busyUntil = 0;
+    bool connecting = false;
+
+    for (uint32_t now = STEP_MS; now <= durationMs; now += STEP_MS) {
+        if (current >= 0 && !connecting) {
+            if (aps[current].rssiAt(now) < LINK_LOSS_RSSI) {
+                current = -1;
+                result.drops++;
+            }
+            continue;
+        }
+        result.outageMs += STEP_MS;
+        if (connecting) {
+            if (now >= busyUntil) {
+                current = strongestAp(aps, now);
+                connecting = false;
+            }
+        } else if (now % MAINTENANCE_MS == 0) {
+            connecting = true;
+            busyUntil = now + SCAN_CONNECT_MS;
+        }
+    }
+    return result;
+}
+
+static bool report(const char* name, bool passed) {
+    printf("   Result: %s\n\n", passed ? "PASSED" : "FAILED");
+    if (!passed) {
+        fprintf(stderr, "FAILED: %s\n", name);
+    }
+    return passed;
+}
+
+static void printWalk(const char* label, const WalkResult& result) {
+    printf("   %-8s outage %5u ms, %u drops, %u roams, %u reconnects, %u channel / %u full scans\n",
+           label, result.outageMs, result.drops, result.stats.roams, result.stats.reconnects,
+           result.stats.channelScans, result.stats.fullScans);
+}
+
+// ==================== SCENARIOS ====================
+
+/**
+ * @brief Yard node fades out while the house node comes in
+ */
+static bool testYardToHouse() {
+    printf("Test 1: Yard-to-house walk roams before the link drops\n");
+
+    std::vector<SimAp> aps = {
+        makeAp(1, 1, {{0, -50}, {20000, -55}, {90000, -93}, {120000, -95}}),
+        makeAp(2, 6, {{0, -92}, {30000, -88}, {100000, -50}, {120000, -48}}),
+    };
+    WalkResult roamed = walkWithRoamer(aps, 120000);
+    WalkResult sticky = walkSticky(aps, 120000);
+    printWalk("roamer", roamed);
+    printWalk("sticky", sticky);
+
+    bool passed = roamed.drops == 0 && roamed.stats.roams == 1 &&
+                  roamed.outageMs <= 2 * TARGETED_CONNECT_MS &&
+                  sticky.outageMs >= 10 * roamed.outageMs;
+    return report("yard to house", passed);
+}
+
+/**
+ * @brief Two nodes at similar strength must not ping-pong
+ */
+static bool testHysteresis() {
+    printf("Test 2: Similar APs do not ping-pong\n");
+
+    std::vector<SimAp> aps = {
+        makeAp(1, 1, {{0, -74}, {300000, -75}}),
+        makeAp(2, 11, {{0, -76}, {300000, -73}}),
+    };
+    WalkResult roamed = walkWithRoamer(aps, 300000);
+    printWalk("roamer", roamed);
+
+    bool passed = roamed.stats.roams == 0 && roamed.outageMs == 0;
+    return report("hysteresis", passed);
+}
+
+/**
+ * @brief Out to the yard and back: one roam each way, none in between
+ */
+static bool testRoundTrip() {
+    printf("Test 3: House-yard-house round trip\n");
+
+    std::vector<SimAp> aps = {
+        makeAp(1, 6, {{0, -48}, {60000, -92}, {120000, -92}, {180000, -48}}),
+        makeAp(2, 1, {{0, -92}, {60000, -50}, {120000, -50}, {180000, -92}}),
+    };
+    WalkResult roamed = walkWithRoamer(aps, 180000);
+    WalkResult sticky = walkSticky(aps, 180000);
+    printWalk("roamer", roamed);
+    printWalk("sticky", sticky);
+
+    bool passed = roamed.drops == 0 && roamed.stats.roams == 2 &&
+                  sticky.outageMs >= 10 * roamed.outageMs;
+    return report("round trip", passed);
+}
+
+/**
+ * @brief A node that refuses the collar is backed off, not retried every scan
+ */
+static bool testRefusingAp() {
+    printf("Test 4: Refusing AP is backed off\n");
+
+    std::vector<SimAp> aps = {
+        makeAp(1, 1, {{0, -60}, {30000, -80}, {120000, -84}}),
+        makeAp(2, 6, {{0, -85}, {30000, -60}, {120000, -55}}),
+    };
+    aps[1].refuses = true;
+    WalkResult roamed = walkWithRoamer(aps, 120000);
+    printWalk("roamer", roamed);
+
+    // Roams fail at most once per backoff period after the first chance
+    uint32_t allowed = 120000 / ROAM_FAIL_BACKOFF_MS + 1;
+    bool passed = roamed.stats.failures >= 1 && roamed.stats.failures <= allowed &&
+                  roamed.drops == 0;
+    return report("refusing AP", passed);
+}
+
+/**
+ * @brief Reconnect order: fresh strongest first, stale last, refused skipped
+ */
+static bool testRanking() {
+    printf("Test 5: Reconnect ranking\n");
+
+    WiFiRoamer roamer;
+    const uint8_t a[6] = {1, 0, 0, 0, 0, 1};
+    const uint8_t b[6] = {1, 0, 0, 0, 0, 2};
+    const uint8_t c[6] = {1, 0, 0, 0, 0, 3};
+    const uint8_t d[6] = {1, 0, 0, 0, 0, 4};
+    roamer.reportScanResult(a, 1, 0, -40, 0);            // Strong but stale by now
+    roamer.reportScanResult(b, 6, 0, -70, 40000);
+    roamer.reportScanResult(c, 11, 1, -60, 40000);
+    roamer.reportScanResult(d, 6, 0, -50, 40000);
+    roamer.connectFailed(d, 41000);
+
+    const RoamCandidate* ranked[ROAM_MAX_CANDIDATES];
+    uint8_t count = roamer.rank(ranked, ROAM_MAX_CANDIDATES, 45000);
+    bool passed = count == 3 && ranked[0]->bssid[5] == 3 && ranked[1]->bssid[5] == 2 &&
+                  ranked[2]->bssid[5] == 1;
+    passed = passed && roamer.rank(ranked, 1, 45000) == 1 && ranked[0]->bssid[5] == 3;
+
+    printf("   Order:");
+    for (uint8_t i = 0; i < count; i++) {
+        printf(" %02X(%d dBm)", ranked[i]->bssid[5], ranked[i]->rssi);
+    }
+    printf("\n");
+    return report("ranking", passed);
+}
+
+int main() {
+    printf("\nWiFi Roaming Simulation Tests\n\n");
+
+    bool passed = true;
+    passed &= testYardToHouse();
+    passed &= testHysteresis();
+    passed &= testRoundTrip();
+    passed &= testRefusingAp();
+    passed &= testRanking();
+
+    printf("%s\n", passed ? "All roaming tests passed" : "Roaming tests FAILED");
+    return passed ? 0 : 1;
+}
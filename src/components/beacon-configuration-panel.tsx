@@ -438,10 +438,10 @@ export function BeaconConfigurationPanel({
     }
 
     try {
-      const { getMQTTClient } = await import('@/lib/mqtt-client');
+      const { getMQTTClient, MQTT_TOPICS } = await import('@/lib/mqtt-client');
       const mqttClient = getMQTTClient();
       
-      const topic = `pet-collar/${collarId}/beacon-config`;
+      const topic = MQTT_TOPICS.COLLAR_COMMAND(collarId);
       const payload = {
         cmd: 'configure_beacon',
         device_id: collarId,
@@ -491,38 +491,58 @@ export function BeaconConfigurationPanel({
   };
 
   // Send all beacon configurations to collar via MQTT
+  // When the collar has reported its config hashes, only the differences are sent
   const syncAllConfigurationsToCollar = async (collarId: string = '001'): Promise<number> => {
     if (!isConnected) {
       console.warn('⚠️ Cannot sync to collar: Not connected');
       return 0;
     }
 
-    if (configurations.length === 0) {
-      console.log('📝 No beacon configurations to sync');
-      return 0;
-    }
-
     try {
-      const { getMQTTClient } = await import('@/lib/mqtt-client');
+      const { getMQTTClient, MQTT_TOPICS } = await import('@/lib/mqtt-client');
+      const { buildProximityDelta, toProximityPayload } = await import('@/lib/proximity-sync');
       const mqttClient = getMQTTClient();
+      const { toast } = await import('sonner');
       
-      const topic = `pet-collar/${collarId}/beacon-config-batch`;
+      const topic = MQTT_TOPICS.COLLAR_COMMAND(collarId);
+      const beacons = configurations.map(toProximityPayload);
+      const collarState = mqttClient.getProximityState(collarId);
+
+      // ✨ DIFFERENTIAL SYNC - the collar's last report says what it already has
+      // (after a "resync" report the entry hashes are current, so a delta still works)
+      if (collarState) {
+        const delta = buildProximityDelta(collarState, beacons);
+        if (!delta) {
+          console.log(`✅ Collar already holds these ${beacons.length} beacon configurations`);
+          toast.success('Already in Sync', {
+            description: `Collar already has all ${beacons.length} beacon settings`
+          });
+          return 0;
+        }
+
+        const payload = { cmd: 'proximity-sync', device_id: collarId, ...delta };
+        console.log(`📡 Syncing beacon changes to collar (${delta.upsert.length} changed, ${delta.remove.length} removed):`, payload);
+        
+        if (!await mqttClient.publish(topic, JSON.stringify(payload))) {
+          throw new Error('Failed to publish MQTT message');
+        }
+        toast.success('Configurations Synced', {
+          description: `${delta.upsert.length} changed, ${delta.remove.length} removed`
+        });
+        return delta.upsert.length + delta.remove.length;
+      }
+
+      if (configurations.length === 0) {
+        console.log('📝 No beacon configurations to sync');
+        return 0;
+      }
+
+      // Collar state unknown: send the full set (the collar keeps unchanged beacons' runtime state)
       const payload = {
         cmd: 'configure_beacons_batch',
         device_id: collarId,
-        beacons: configurations.map(config => ({
-          id: config.id,
-          name: config.name,
-          macAddress: config.macAddress,
-          alertMode: config.alertMode,
-          
-          // ✨ EXACT TRANSMITTER SETTINGS FOR EACH BEACON
-          triggerDistance: config.proximitySettings.triggerDistance,
-          alertDuration: config.proximitySettings.alertDuration,
-          alertIntensity: config.proximitySettings.alertIntensity,
-          enableProximityDelay: config.proximitySettings.enableProximityDelay,
-          proximityDelayTime: config.proximitySettings.proximityDelayTime,
-          cooldownPeriod: config.proximitySettings.cooldownPeriod,
+        beacons: configurations.map((config, index) => ({
+          ...beacons[index],
           safeZone: config.safeZone,
           boundaryAlert: config.boundaryAlert
         }))
@@ -534,7 +554,6 @@ export function BeaconConfigurationPanel({
       
       if (success) {
         console.log(`✅ Successfully synced ${configurations.length} beacon configurations to collar`);
-        const { toast } = await import('sonner');
         toast.success('All Configurations Synced', {
           description: `${configurations.length} beacon settings sent to collar`
         });
@@ -6,6 +6,7 @@
  */
 
 import mqtt, { MqttClient, IClientOptions } from 'mqtt';
+import type { CollarProximityState } from './proximity-sync';
 
 // MQTT connection configuration
 const MQTT_CONFIG: IClientOptions = {
@@ -45,8 +46,11 @@ export const MQTT_TOPICS = {
   COLLAR_BEACONS_WILDCARD: 'pet-collar/+/beacon-detection',
   COLLAR_ALERTS: (collarId: string) => `pet-collar/${collarId}/alert`,
   COLLAR_ALERTS_WILDCARD: 'pet-collar/+/alert',
+  COLLAR_PROXIMITY_CONFIG: (collarId: string) => `pet-collar/${collarId}/proximity-config`,
+  COLLAR_PROXIMITY_CONFIG_WILDCARD: 'pet-collar/+/proximity-config',
   
-  // Commands to collar
+  // Commands to collar (JSON with a "cmd" key, or the command name as subtopic)
+  COLLAR_COMMAND: (collarId: string) => `pet-collar/${collarId}/command`,
   COLLAR_COMMAND_BUZZ: (collarId: string) => `pet-collar/${collarId}/command/buzz`,
   COLLAR_COMMAND_ZONE: (collarId: string) => `pet-collar/${collarId}/command/zone`,
   COLLAR_COMMAND_LOCATE: (collarId: string) => `pet-collar/${collarId}/command/locate`,
@@ -120,10 +124,12 @@ export class CollarMQTTClient {
   private client: MqttClient | null = null;
   private isConnected = false;
   private reconnectTimeout: ReturnType<typeof setTimeout> | null = null;
+  private proximityStates = new Map<string, CollarProximityState>();
   
   // Event handlers
   public onCollarTelemetry?: (collarId: string, data: CollarTelemetryData) => void;
   public onCollarStatus?: (collarId: string, data: CollarStatusData) => void;
+  public onCollarProximityState?: (collarId: string, state: CollarProximityState) => void;
   public onConnect?: () => void;
   public onDisconnect?: () => void;
   public onError?: (error: Error) => void;
@@ -195,7 +201,8 @@ export class CollarMQTTClient {
       MQTT_TOPICS.COLLAR_ZONES_WILDCARD,
       MQTT_TOPICS.COLLAR_LOCATION_WILDCARD,
       MQTT_TOPICS.COLLAR_BEACONS_WILDCARD,
-      MQTT_TOPICS.COLLAR_ALERTS_WILDCARD
+      MQTT_TOPICS.COLLAR_ALERTS_WILDCARD,
+      MQTT_TOPICS.COLLAR_PROXIMITY_CONFIG_WILDCARD
     ];
     
     topics.forEach(topic => {
@@ -249,6 +256,13 @@ export class CollarMQTTClient {
           
         }
       } else if (topic.includes('/alert')) {
+      } else if (topic.includes('/proximity-config')) {
+        // Retained: arrives on every (re)subscribe, so the last state is always known
+        const state: CollarProximityState = JSON.parse(messageStr);
+        if (typeof state.hash === 'string' && state.entries) {
+          this.proximityStates.set(collarId, state);
+          this.onCollarProximityState?.(collarId, state);
+        }
       }
       
     } catch (error) {
@@ -316,6 +330,11 @@ export class CollarMQTTClient {
     });
   }
 
+  // Last proximity config state the collar reported, if any
+  public getProximityState(collarId: string): CollarProximityState | undefined {
+    return this.proximityStates.get(collarId);
+  }
+
   public getConnectionStatus(): { connected: boolean; client_id?: string } {
     return {
       connected: this.isConnected,
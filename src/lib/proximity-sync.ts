@@ -0,0 +1,166 @@
+/**
+ * 🔁 Differential proximity configuration sync with the collar
+ *
+ * The collar keeps its proximity beacon configs in flash and publishes
+ * (retained) on `pet-collar/<id>/proximity-config`:
+ *
+ *   { hash, count, result, entries: { <beacon id>: <entry hash> } }
+ *
+ * Instead of resending every config, the dashboard diffs its own list
+ * against those entry hashes and sends one `proximity-sync` command with
+ * only the added/changed beacons and the removed ids. The collar applies it
+ * only if `base` is still its current set hash, so a stale delta turns into
+ * a `resync` report rather than a wrong set.
+ *
+ * The hashes must match the firmware's proximitySettingHash()
+ * (firmware/ESP32-S3_PetCollar/collar_settings.cpp): 32-bit FNV-1a over
+ * "id|name|mac|alertMode|distance|duration|intensity|delay(0/1)|delayTime|cooldown"
+ * with strings cut to the collar's field sizes, and the set hash is the sum
+ * of the entry hashes.
+ */
+
+export interface ProximityBeaconPayload {
+  id: string;
+  name: string;
+  macAddress: string;
+  alertMode: string;
+  triggerDistance: number;
+  alertDuration: number;
+  alertIntensity: number;
+  enableProximityDelay: boolean;
+  proximityDelayTime: number;
+  cooldownPeriod: number;
+}
+
+export interface CollarProximityState {
+  device_id: string;
+  result: 'report' | 'ok' | 'mismatch' | 'resync';
+  hash: string;
+  count: number;
+  entries: Record<string, string>;
+}
+
+export interface ProximityDelta {
+  base: string;
+  upsert: ProximityBeaconPayload[];
+  remove: string[];
+  hash: string;
+}
+
+// Bytes the collar stores per string field (ProximitySetting, including the NUL)
+const FIELD_BYTES = {
+  id: 24,
+  name: 32,
+  macAddress: 18,
+  alertMode: 14
+} as const;
+
+const encoder = new TextEncoder();
+
+function toUint(value: unknown, fallback: number, max: number): number {
+  const number = typeof value === 'number' && Number.isFinite(value) ? Math.round(value) : fallback;
+  return Math.min(Math.max(number, 0), max);
+}
+
+/**
+ * Normalize a beacon the way the collar stores it (defaults, integer ranges)
+ */
+export function toProximityPayload(config: {
+  id: string;
+  name: string;
+  macAddress?: string;
+  alertMode?: string;
+  proximitySettings: {
+    triggerDistance: number;
+    alertDuration: number;
+    alertIntensity: number;
+    enableProximityDelay: boolean;
+    proximityDelayTime: number;
+    cooldownPeriod: number;
+  };
+}): ProximityBeaconPayload {
+  const settings = config.proximitySettings;
+  return {
+    id: config.id,
+    name: config.name,
+    macAddress: config.macAddress || '',
+    alertMode: config.alertMode || 'buzzer',
+    triggerDistance: toUint(settings.triggerDistance, 5, 0xffff),
+    alertDuration: toUint(settings.alertDuration, 2000, 0x7fffffff),
+    alertIntensity: toUint(settings.alertIntensity, 3, 0xff),
+    enableProximityDelay: Boolean(settings.enableProximityDelay),
+    proximityDelayTime: toUint(settings.proximityDelayTime, 0, 0x7fffffff),
+    cooldownPeriod: toUint(settings.cooldownPeriod, 5000, 0x7fffffff)
+  };
+}
+
+function fieldBytes(value: string, size: number): Uint8Array {
+  return encoder.encode(value).subarray(0, size - 1);
+}
+
+// The id the collar keys its entries by
+function storedId(id: string): string {
+  return new TextDecoder().decode(fieldBytes(id, FIELD_BYTES.id));
+}
+
+export function formatProximityHash(hash: number): string {
+  return (hash >>> 0).toString(16).padStart(8, '0');
+}
+
+/**
+ * Hash of one beacon config, identical to the collar's
+ */
+export function proximityEntryHash(beacon: ProximityBeaconPayload): number {
+  const parts: Uint8Array[] = [
+    fieldBytes(beacon.id, FIELD_BYTES.id),
+    fieldBytes(beacon.name, FIELD_BYTES.name),
+    fieldBytes(beacon.macAddress, FIELD_BYTES.macAddress),
+    fieldBytes(beacon.alertMode, FIELD_BYTES.alertMode),
+    encoder.encode(String(beacon.triggerDistance)),
+    encoder.encode(String(beacon.alertDuration)),
+    encoder.encode(String(beacon.alertIntensity)),
+    encoder.encode(beacon.enableProximityDelay ? '1' : '0'),
+    encoder.encode(String(beacon.proximityDelayTime)),
+    encoder.encode(String(beacon.cooldownPeriod))
+  ];
+
+  let hash = 0x811c9dc5;
+  parts.forEach((part, index) => {
+    if (index > 0) {
+      hash = Math.imul(hash ^ 0x7c, 16777619) >>> 0;   // '|'
+    }
+    for (const byte of part) {
+      hash = Math.imul(hash ^ byte, 16777619) >>> 0;
+    }
+  });
+  return hash;
+}
+
+/**
+ * Hash of a whole set (order does not matter)
+ */
+export function proximitySetHash(beacons: ProximityBeaconPayload[]): number {
+  return beacons.reduce((sum, beacon) => (sum + proximityEntryHash(beacon)) >>> 0, 0);
+}
+
+/**
+ * Changes that bring the collar's reported set to `beacons`
+ * @returns null when the collar already holds exactly this set
+ */
+export function buildProximityDelta(
+  state: CollarProximityState,
+  beacons: ProximityBeaconPayload[]
+): ProximityDelta | null {
+  const target = formatProximityHash(proximitySetHash(beacons));
+  if (state.hash === target && state.count === beacons.length) {
+    return null;
+  }
+
+  const wanted = new Set(beacons.map(beacon => storedId(beacon.id)));
+  const upsert = beacons.filter(beacon =>
+    state.entries[storedId(beacon.id)] !== formatProximityHash(proximityEntryHash(beacon))
+  );
+  const remove = Object.keys(state.entries).filter(id => !wanted.has(id));
+
+  return { base: state.hash, upsert, remove, hash: target };
+}